@@ -0,0 +1,278 @@
+/*
+ * perf-common.h - Shared harness for the syscall micro-benchmarks
+ *
+ * Every benchmark describes one operation (plus optional per-thread setup
+ * and teardown) and hands it to perf_main(), which parses the common
+ * command line, runs the operation on one or more threads, records the
+ * latency of every call and reports mean, percentiles and throughput.
+ *
+ * Common usage: <benchmark> [-t threads] [-j] [-s size] [-r] <path> [iterations]
+ *
+ *   -t N   run N threads, each doing <iterations> operations
+ *   -j     print a single JSON object instead of the text report
+ *   -s N   I/O size in bytes (pread/pwrite only)
+ *   -r     random instead of sequential offsets (pread/pwrite only)
+ */
+
+#ifndef PERF_COMMON_H
+#define PERF_COMMON_H
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define DEFAULT_ITERATIONS 100000
+#define WARMUP_ITERATIONS  1000
+#define DEFAULT_IO_SIZE    4096
+#define HISTOGRAM_BUCKETS  40
+
+struct perf_opts {
+    const char *path;
+    long iterations;
+    int threads;
+    int json;
+    size_t size;
+    int random;
+};
+
+/* Per-thread state handed to the benchmark callbacks */
+struct perf_thread {
+    int id;
+    const struct perf_opts *opts;
+    /* Benchmark-owned state, set up by the setup callback */
+    void *ctx;
+    unsigned int seed;
+    long long *samples;
+};
+
+struct perf_bench {
+    /* Name shown in the report, e.g. "open()+close()" */
+    const char *name;
+    /* Whether -s/-r apply to this benchmark */
+    int uses_size;
+    /* Optional: prepare per-thread state; return -1 with errno set on error */
+    int (*setup)(struct perf_thread *t);
+    /* One measured operation; return -1 with errno set on error */
+    int (*op)(struct perf_thread *t, long i);
+    /* Optional: release per-thread state */
+    void (*teardown)(struct perf_thread *t);
+};
+
+static inline long long perf_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static const struct perf_bench *perf_current;
+static pthread_barrier_t perf_barrier;
+
+static void perf_fail(const struct perf_thread *t, const char *what)
+{
+    fprintf(stderr, "%s: thread %d: %s: %s\n", perf_current->name, t->id, what,
+            strerror(errno));
+    exit(1);
+}
+
+static void *perf_thread_main(void *arg)
+{
+    struct perf_thread *t = arg;
+    const struct perf_bench *bench = perf_current;
+    long i;
+
+    if (bench->setup && bench->setup(t) < 0)
+        perf_fail(t, "setup");
+
+    for (i = 0; i < WARMUP_ITERATIONS; i++) {
+        if (bench->op(t, i) < 0)
+            perf_fail(t, "warmup");
+    }
+
+    /* Start all threads together so the measured phases overlap */
+    pthread_barrier_wait(&perf_barrier);
+
+    for (i = 0; i < t->opts->iterations; i++) {
+        long long start = perf_now_ns();
+        if (bench->op(t, WARMUP_ITERATIONS + i) < 0)
+            perf_fail(t, "op");
+        t->samples[i] = perf_now_ns() - start;
+    }
+
+    pthread_barrier_wait(&perf_barrier);
+
+    if (bench->teardown)
+        bench->teardown(t);
+    return NULL;
+}
+
+static int perf_cmp_ll(const void *a, const void *b)
+{
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static long long perf_percentile(const long long *sorted, long n, double p)
+{
+    long rank = (long)(p * n + 0.999999);
+    if (rank < 1)
+        rank = 1;
+    if (rank > n)
+        rank = n;
+    return sorted[rank - 1];
+}
+
+/* Bucket i counts samples in [2^i, 2^(i+1)) ns; bucket 0 also takes 0 ns */
+static int perf_bucket(long long ns)
+{
+    int b = 0;
+    while (ns > 1 && b < HISTOGRAM_BUCKETS - 1) {
+        ns >>= 1;
+        b++;
+    }
+    return b;
+}
+
+static void perf_usage(const char *prog, const struct perf_bench *bench)
+{
+    fprintf(stderr, "Usage: %s [-t threads] [-j]%s <path> [iterations]\n", prog,
+            bench->uses_size ? " [-s size] [-r]" : "");
+}
+
+static int perf_main(int argc, char *argv[], const struct perf_bench *bench)
+{
+    struct perf_opts opts = {
+        .iterations = DEFAULT_ITERATIONS,
+        .threads = 1,
+        .size = DEFAULT_IO_SIZE,
+    };
+    struct perf_thread *threads;
+    pthread_t *tids;
+    long long *all, start, elapsed, sum = 0;
+    long histogram[HISTOGRAM_BUCKETS] = { 0 };
+    long total, i;
+    double avg_ns, ops_per_sec;
+    int opt, t, last_bucket = 0;
+
+    while ((opt = getopt(argc, argv, "t:js:r")) != -1) {
+        switch (opt) {
+        case 't':
+            opts.threads = atoi(optarg);
+            break;
+        case 'j':
+            opts.json = 1;
+            break;
+        case 's':
+            opts.size = strtoul(optarg, NULL, 0);
+            break;
+        case 'r':
+            opts.random = 1;
+            break;
+        default:
+            perf_usage(argv[0], bench);
+            return 1;
+        }
+    }
+
+    if (optind >= argc) {
+        perf_usage(argv[0], bench);
+        return 1;
+    }
+    opts.path = argv[optind];
+    if (optind + 1 < argc)
+        opts.iterations = atol(argv[optind + 1]);
+
+    if (opts.iterations <= 0 || opts.threads <= 0 || opts.size == 0) {
+        fprintf(stderr, "Invalid iteration count, thread count or size\n");
+        return 1;
+    }
+
+    perf_current = bench;
+    total = opts.iterations * opts.threads;
+    all = calloc(total, sizeof(*all));
+    threads = calloc(opts.threads, sizeof(*threads));
+    tids = calloc(opts.threads, sizeof(*tids));
+    if (!all || !threads || !tids) {
+        perror("calloc");
+        return 1;
+    }
+
+    /* The main thread joins the barrier to time the measured phase */
+    pthread_barrier_init(&perf_barrier, NULL, opts.threads + 1);
+    for (t = 0; t < opts.threads; t++) {
+        threads[t].id = t;
+        threads[t].opts = &opts;
+        threads[t].seed = 0x9e3779b9u * (t + 1);
+        threads[t].samples = all + (long)t * opts.iterations;
+        if (pthread_create(&tids[t], NULL, perf_thread_main, &threads[t]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+
+    pthread_barrier_wait(&perf_barrier);
+    start = perf_now_ns();
+    pthread_barrier_wait(&perf_barrier);
+    elapsed = perf_now_ns() - start;
+
+    for (t = 0; t < opts.threads; t++)
+        pthread_join(tids[t], NULL);
+
+    for (i = 0; i < total; i++) {
+        sum += all[i];
+        histogram[perf_bucket(all[i])]++;
+    }
+    qsort(all, total, sizeof(*all), perf_cmp_ll);
+    avg_ns = (double)sum / total;
+    ops_per_sec = total * 1e9 / elapsed;
+
+    if (opts.json) {
+        printf("{\"benchmark\":\"%s\",\"path\":\"%s\",\"threads\":%d,\"iterations\":%ld",
+               bench->name, opts.path, opts.threads, opts.iterations);
+        if (bench->uses_size)
+            printf(",\"size\":%zu,\"random\":%s", opts.size, opts.random ? "true" : "false");
+        printf(",\"total_ns\":%lld,\"avg_ns\":%.1f,\"p50_ns\":%lld,\"p99_ns\":%lld,"
+               "\"p999_ns\":%lld,\"max_ns\":%lld,\"ops_per_sec\":%.0f,\"histogram\":[",
+               elapsed, avg_ns, perf_percentile(all, total, 0.50),
+               perf_percentile(all, total, 0.99), perf_percentile(all, total, 0.999),
+               all[total - 1], ops_per_sec);
+        for (i = 0; i < HISTOGRAM_BUCKETS; i++) {
+            if (histogram[i])
+                last_bucket = i;
+        }
+        /* [upper bound in ns, count] per power-of-two bucket */
+        for (i = 0; i <= last_bucket; i++)
+            printf("%s[%lld,%ld]", i ? "," : "", 2LL << i, histogram[i]);
+        printf("]}\n");
+    } else {
+        printf("%s micro-benchmark\n", bench->name);
+        printf("-------------------------------\n");
+        printf("Path:         %s\n", opts.path);
+        if (bench->uses_size)
+            printf("I/O size:     %zu bytes (%s)\n", opts.size,
+                   opts.random ? "random" : "sequential");
+        printf("Threads:      %d\n", opts.threads);
+        printf("Iterations:   %ld per thread\n", opts.iterations);
+        printf("Total time:   %.3f ms\n", elapsed / 1000000.0);
+        printf("Avg latency:  %.1f ns\n", avg_ns);
+        printf("P50 latency:  %lld ns\n", perf_percentile(all, total, 0.50));
+        printf("P99 latency:  %lld ns\n", perf_percentile(all, total, 0.99));
+        printf("P999 latency: %lld ns\n", perf_percentile(all, total, 0.999));
+        printf("Max latency:  %lld ns\n", all[total - 1]);
+        printf("Throughput:   %.0f ops/sec\n", ops_per_sec);
+    }
+
+    free(all);
+    free(threads);
+    free(tids);
+    return 0;
+}
+
+#endif /* PERF_COMMON_H */
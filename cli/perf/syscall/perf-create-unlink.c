@@ -0,0 +1,51 @@
+/*
+ * perf-create-unlink.c - Micro-benchmark for creating and unlinking a file
+ *
+ * Each operation creates an empty file in <directory> with
+ * open(O_CREAT|O_EXCL), closes it and unlinks it. Threads use distinct
+ * names in the same directory.
+ *
+ * Usage: ./perf-create-unlink [-t threads] [-j] <directory> [iterations]
+ */
+
+#include "perf-common.h"
+
+#include <fcntl.h>
+#include <limits.h>
+
+static int setup(struct perf_thread *t)
+{
+    t->ctx = malloc(PATH_MAX);
+    if (!t->ctx)
+        return -1;
+    snprintf(t->ctx, PATH_MAX, "%s/perf-create-%d-%d", t->opts->path, (int)getpid(), t->id);
+    return 0;
+}
+
+static int op(struct perf_thread *t, long i)
+{
+    int fd;
+
+    (void)i;
+    fd = open(t->ctx, O_CREAT | O_EXCL | O_WRONLY, 0644);
+    if (fd < 0)
+        return -1;
+    close(fd);
+    return unlink(t->ctx);
+}
+
+static void teardown(struct perf_thread *t)
+{
+    free(t->ctx);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct perf_bench bench = {
+        .name = "create+unlink",
+        .setup = setup,
+        .op = op,
+        .teardown = teardown,
+    };
+    return perf_main(argc, argv, &bench);
+}
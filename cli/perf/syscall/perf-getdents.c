@@ -0,0 +1,53 @@
+/*
+ * perf-getdents.c - Micro-benchmark for listing a directory with getdents64()
+ *
+ * Each operation opens the directory, reads all of its entries and closes
+ * it, so the latency is that of a full listing.
+ *
+ * Usage: ./perf-getdents [-t threads] [-j] <directory> [iterations]
+ */
+
+#include "perf-common.h"
+
+#include <fcntl.h>
+#include <sys/syscall.h>
+
+#define DIRENT_BUF_SIZE (64 * 1024)
+
+static int setup(struct perf_thread *t)
+{
+    t->ctx = malloc(DIRENT_BUF_SIZE);
+    return t->ctx ? 0 : -1;
+}
+
+static int op(struct perf_thread *t, long i)
+{
+    long n;
+    int fd;
+
+    (void)i;
+    fd = open(t->opts->path, O_RDONLY | O_DIRECTORY);
+    if (fd < 0)
+        return -1;
+    do {
+        n = syscall(SYS_getdents64, fd, t->ctx, DIRENT_BUF_SIZE);
+    } while (n > 0);
+    close(fd);
+    return n < 0 ? -1 : 0;
+}
+
+static void teardown(struct perf_thread *t)
+{
+    free(t->ctx);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct perf_bench bench = {
+        .name = "getdents64()",
+        .setup = setup,
+        .op = op,
+        .teardown = teardown,
+    };
+    return perf_main(argc, argv, &bench);
+}
@@ -0,0 +1,46 @@
+/*
+ * perf-mkdir-rmdir.c - Micro-benchmark for mkdir() and rmdir()
+ *
+ * Each operation creates a directory in <directory> and removes it again.
+ * Threads use distinct names in the same directory.
+ *
+ * Usage: ./perf-mkdir-rmdir [-t threads] [-j] <directory> [iterations]
+ */
+
+#include "perf-common.h"
+
+#include <limits.h>
+#include <sys/stat.h>
+
+static int setup(struct perf_thread *t)
+{
+    t->ctx = malloc(PATH_MAX);
+    if (!t->ctx)
+        return -1;
+    snprintf(t->ctx, PATH_MAX, "%s/perf-mkdir-%d-%d", t->opts->path, (int)getpid(), t->id);
+    return 0;
+}
+
+static int op(struct perf_thread *t, long i)
+{
+    (void)i;
+    if (mkdir(t->ctx, 0755) < 0)
+        return -1;
+    return rmdir(t->ctx);
+}
+
+static void teardown(struct perf_thread *t)
+{
+    free(t->ctx);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct perf_bench bench = {
+        .name = "mkdir()+rmdir()",
+        .setup = setup,
+        .op = op,
+        .teardown = teardown,
+    };
+    return perf_main(argc, argv, &bench);
+}
@@ -0,0 +1,73 @@
+/*
+ * perf-pread.c - Micro-benchmark for pread()
+ *
+ * Reads <size> bytes per call, walking the file sequentially (wrapping at
+ * the end) or at random size-aligned offsets with -r. The file should be
+ * several times larger than the I/O size.
+ *
+ * Usage: ./perf-pread [-t threads] [-j] [-s size] [-r] <file> [iterations]
+ */
+
+#include "perf-common.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+struct ctx {
+    int fd;
+    char *buf;
+    /* Number of size-aligned blocks in the file */
+    long blocks;
+};
+
+static int setup(struct perf_thread *t)
+{
+    struct ctx *c = calloc(1, sizeof(*c));
+    struct stat st;
+
+    if (!c)
+        return -1;
+    c->fd = open(t->opts->path, O_RDONLY);
+    if (c->fd < 0 || fstat(c->fd, &st) < 0)
+        return -1;
+    c->blocks = st.st_size / (off_t)t->opts->size;
+    if (c->blocks == 0) {
+        errno = EINVAL;
+        return -1;
+    }
+    c->buf = malloc(t->opts->size);
+    if (!c->buf)
+        return -1;
+    t->ctx = c;
+    return 0;
+}
+
+static int op(struct perf_thread *t, long i)
+{
+    struct ctx *c = t->ctx;
+    long block = t->opts->random ? (long)(rand_r(&t->seed) % c->blocks) : i % c->blocks;
+    off_t offset = (off_t)block * t->opts->size;
+
+    return pread(c->fd, c->buf, t->opts->size, offset) < 0 ? -1 : 0;
+}
+
+static void teardown(struct perf_thread *t)
+{
+    struct ctx *c = t->ctx;
+
+    close(c->fd);
+    free(c->buf);
+    free(c);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct perf_bench bench = {
+        .name = "pread()",
+        .uses_size = 1,
+        .setup = setup,
+        .op = op,
+        .teardown = teardown,
+    };
+    return perf_main(argc, argv, &bench);
+}
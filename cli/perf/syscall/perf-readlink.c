@@ -0,0 +1,26 @@
+/*
+ * perf-readlink.c - Micro-benchmark for readlink()
+ *
+ * Usage: ./perf-readlink [-t threads] [-j] <symlink> [iterations]
+ */
+
+#include "perf-common.h"
+
+#include <limits.h>
+
+static int op(struct perf_thread *t, long i)
+{
+    char target[PATH_MAX];
+
+    (void)i;
+    return readlink(t->opts->path, target, sizeof(target)) < 0 ? -1 : 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct perf_bench bench = {
+        .name = "readlink()",
+        .op = op,
+    };
+    return perf_main(argc, argv, &bench);
+}
@@ -0,0 +1,63 @@
+/*
+ * perf-rename.c - Micro-benchmark for rename()
+ *
+ * Each thread creates a file in <directory> and renames it back and forth
+ * between two names; each operation is one rename.
+ *
+ * Usage: ./perf-rename [-t threads] [-j] <directory> [iterations]
+ */
+
+#include "perf-common.h"
+
+#include <fcntl.h>
+#include <limits.h>
+
+struct ctx {
+    char names[2][PATH_MAX];
+};
+
+static int setup(struct perf_thread *t)
+{
+    struct ctx *c = calloc(1, sizeof(*c));
+    int fd;
+
+    if (!c)
+        return -1;
+    snprintf(c->names[0], PATH_MAX, "%s/perf-rename-%d-%d.a", t->opts->path, (int)getpid(),
+             t->id);
+    snprintf(c->names[1], PATH_MAX, "%s/perf-rename-%d-%d.b", t->opts->path, (int)getpid(),
+             t->id);
+    fd = open(c->names[0], O_CREAT | O_WRONLY | O_TRUNC, 0644);
+    if (fd < 0)
+        return -1;
+    close(fd);
+    t->ctx = c;
+    return 0;
+}
+
+static int op(struct perf_thread *t, long i)
+{
+    struct ctx *c = t->ctx;
+
+    return rename(c->names[i % 2], c->names[(i + 1) % 2]);
+}
+
+static void teardown(struct perf_thread *t)
+{
+    struct ctx *c = t->ctx;
+
+    unlink(c->names[0]);
+    unlink(c->names[1]);
+    free(c);
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct perf_bench bench = {
+        .name = "rename()",
+        .setup = setup,
+        .op = op,
+        .teardown = teardown,
+    };
+    return perf_main(argc, argv, &bench);
+}
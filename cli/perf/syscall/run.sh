@@ -2,17 +2,29 @@
 #
 # Benchmark syscall performance across different scenarios:
 #   1. Native filesystem
-#   2. AgentFS (file in base layer)
-#   3. AgentFS (file copied up to delta layer)
+#   2. AgentFS (target in base layer)
+#   3. AgentFS (target copied up to delta layer)
+#
+# Usage: ./run.sh [-t THREADS] [-j RESULTS.json] [ITERATIONS]
 #
 
 set -e
 
 SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
 CLI_DIR="$(cd "$SCRIPT_DIR/../.." && pwd)"
-TEST_FILE="$SCRIPT_DIR/hello.txt"
-ITERATIONS="${1:-100000}"
 AGENTFS="$CLI_DIR/target/release/agentfs"
+THREADS=1
+JSON_OUT=""
+
+while getopts "t:j:" opt; do
+    case "$opt" in
+        t) THREADS="$OPTARG" ;;
+        j) JSON_OUT="$OPTARG" ;;
+        *) echo "Usage: $0 [-t THREADS] [-j RESULTS.json] [ITERATIONS]"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+ITERATIONS="${1:-100000}"
 
 # Build benchmarks if needed
 make -C "$SCRIPT_DIR" -s
@@ -24,64 +36,145 @@ if [ ! -x "$AGENTFS" ]; then
     exit 1
 fi
 
+# Fixtures live under the script directory so that `agentfs run` sees them
+# in its base layer.
+FIXTURES="$SCRIPT_DIR/fixtures.$$"
+trap 'rm -rf "$FIXTURES"' EXIT
+mkdir -p "$FIXTURES/dir" "$FIXTURES/work"
+cp "$SCRIPT_DIR/hello.txt" "$FIXTURES/hello.txt"
+dd if=/dev/zero of="$FIXTURES/data.bin" bs=1M count=64 status=none
+ln -s hello.txt "$FIXTURES/link"
+(cd "$FIXTURES/dir" && seq -f "entry-%05g" 1 10000 | xargs touch)
+
+# Results of every run as one JSON object per line, collected when -j is set
+JSON_LINES=""
+
 # Extract metrics from benchmark output
-extract_latency() {
-    grep "Avg latency:" | awk '{print $3}'
+extract() {
+    grep "$1" | awk '{print $3}'
+}
+
+# Run a command in the given scenario and print its output
+run_in() {
+    local scenario="$1"
+    local setup="$2"
+    shift 2
+
+    case "$scenario" in
+        native) "$@" 2>&1 ;;
+        base) "$AGENTFS" run "$@" 2>&1 ;;
+        delta) "$AGENTFS" run sh -c "$setup && exec \"\$@\"" sh "$@" 2>&1 ;;
+    esac
+}
+
+# Record one scenario: sets LAT_<scenario>, P50_..., P99_..., P999_..., OPS_...
+measure() {
+    local scenario="$1"
+    local setup="$2"
+    shift 2
+    local output
+
+    output=$(run_in "$scenario" "$setup" "$@" -t "$THREADS" "${ARGS[@]}" "$TARGET" "$ITERATIONS")
+    eval "LAT_$scenario=$(echo "$output" | extract 'Avg latency:')"
+    eval "P50_$scenario=$(echo "$output" | extract 'P50 latency:')"
+    eval "P99_$scenario=$(echo "$output" | extract 'P99 latency:')"
+    eval "P999_$scenario=$(echo "$output" | extract 'P999 latency:')"
+    eval "OPS_$scenario=$(echo "$output" | grep 'Throughput:' | awk '{print $2}')"
+
+    if [ -n "$JSON_OUT" ]; then
+        local json
+        json=$(run_in "$scenario" "$setup" "$@" -j -t "$THREADS" "${ARGS[@]}" "$TARGET" "$ITERATIONS")
+        JSON_LINES+="{\"scenario\":\"$scenario\",\"result\":$json}"$'\n'
+    fi
 }
 
-extract_throughput() {
-    grep "Throughput:" | awk '{print $2}'
+print_row() {
+    local label="$1"
+    local scenario="$2"
+    local lat p50 p99 p999 ops overhead
+
+    eval "lat=\$LAT_$scenario p50=\$P50_$scenario p99=\$P99_$scenario"
+    eval "p999=\$P999_$scenario ops=\$OPS_$scenario"
+    if [ "$scenario" = native ]; then
+        overhead="-"
+    else
+        overhead="$(awk -v a="$lat" -v b="$LAT_native" 'BEGIN { printf "%.1f %%", (a / b - 1) * 100 }')"
+    fi
+    printf "%-18s %10s %10s %10s %10s %12s %10s\n" "$label" "$lat" "$p50" "$p99" "$p999" "$ops" "$overhead"
 }
 
 # Run a benchmark for all three scenarios
+#
+#   run_benchmark NAME TARGET DELTA_SETUP BENCHMARK [ARGS...]
+#
+# TARGET is the file or directory the benchmark operates on and DELTA_SETUP
+# is a shell command that copies it up into the delta layer.
 run_benchmark() {
     local name="$1"
-    local benchmark="$2"
+    local delta_setup="$3"
+    local benchmark="$4"
+    TARGET="$2"
+    shift 4
+    ARGS=("$@")
 
     echo "=============================================="
     echo "$name"
     echo "=============================================="
-    echo "Iterations: $ITERATIONS"
+    echo "Iterations: $ITERATIONS per thread, threads: $THREADS"
     echo ""
 
-    # Test 1: Native filesystem
     echo "[1/3] Native filesystem..."
-    NATIVE_OUTPUT=$("$benchmark" "$TEST_FILE" "$ITERATIONS" 2>&1)
-    NATIVE_LATENCY=$(echo "$NATIVE_OUTPUT" | extract_latency)
-    NATIVE_THROUGHPUT=$(echo "$NATIVE_OUTPUT" | extract_throughput)
-
-    # Test 2: AgentFS (file in base layer)
+    measure native "" "$benchmark"
     echo "[2/3] AgentFS (base layer)..."
-    AGENTFS_BASE_OUTPUT=$("$AGENTFS" run "$benchmark" "$TEST_FILE" "$ITERATIONS" 2>&1)
-    AGENTFS_BASE_LATENCY=$(echo "$AGENTFS_BASE_OUTPUT" | extract_latency)
-    AGENTFS_BASE_THROUGHPUT=$(echo "$AGENTFS_BASE_OUTPUT" | extract_throughput)
-
-    # Test 3: AgentFS (file copied up to delta)
+    measure base "" "$benchmark"
     echo "[3/3] AgentFS (delta layer)..."
-    AGENTFS_DELTA_OUTPUT=$("$AGENTFS" run sh -c "
-        touch '$TEST_FILE'
-        '$benchmark' '$TEST_FILE' '$ITERATIONS'
-    " 2>&1)
-    AGENTFS_DELTA_LATENCY=$(echo "$AGENTFS_DELTA_OUTPUT" | extract_latency)
-    AGENTFS_DELTA_THROUGHPUT=$(echo "$AGENTFS_DELTA_OUTPUT" | extract_throughput)
-
-    # Calculate overhead percentages
-    AGENTFS_BASE_OVERHEAD=$(echo "scale=1; (($AGENTFS_BASE_LATENCY / $NATIVE_LATENCY) - 1) * 100" | bc)
-    AGENTFS_DELTA_OVERHEAD=$(echo "scale=1; (($AGENTFS_DELTA_LATENCY / $NATIVE_LATENCY) - 1) * 100" | bc)
-
-    # Results
+    measure delta "$delta_setup" "$benchmark"
+
+    # Results (latencies in ns)
     echo ""
     echo "Results:"
-    echo "----------------------------------------------"
-    printf "%-25s %10s %12s %10s\n" "Scenario" "Latency" "Throughput" "Overhead"
-    printf "%-25s %10s %12s %10s\n" "--------" "-------" "----------" "--------"
-    printf "%-25s %8s ns %10s/s %10s\n" "Native" "$NATIVE_LATENCY" "$NATIVE_THROUGHPUT" "-"
-    printf "%-25s %8s ns %10s/s %8s %%\n" "AgentFS (base)" "$AGENTFS_BASE_LATENCY" "$AGENTFS_BASE_THROUGHPUT" "$AGENTFS_BASE_OVERHEAD"
-    printf "%-25s %8s ns %10s/s %8s %%\n" "AgentFS (delta)" "$AGENTFS_DELTA_LATENCY" "$AGENTFS_DELTA_THROUGHPUT" "$AGENTFS_DELTA_OVERHEAD"
-    echo "----------------------------------------------"
+    echo "---------------------------------------------------------------------------------"
+    printf "%-18s %10s %10s %10s %10s %12s %10s\n" "Scenario" "Avg" "P50" "P99" "P999" "Ops/sec" "Overhead"
+    printf "%-18s %10s %10s %10s %10s %12s %10s\n" "--------" "---" "---" "---" "----" "-------" "--------"
+    print_row "Native" native
+    print_row "AgentFS (base)" base
+    print_row "AgentFS (delta)" delta
+    echo "---------------------------------------------------------------------------------"
     echo ""
 }
 
-# Run all benchmarks
-run_benchmark "open()+close() Micro-Benchmark" "$SCRIPT_DIR/perf-open-close"
-run_benchmark "statx() Micro-Benchmark" "$SCRIPT_DIR/perf-statx"
+# Copy a file up into the delta layer by rewriting it in place. Merely
+# touching it is not enough: timestamp-only setattr does not copy up.
+copy_up_file() {
+    echo "cp '$1' '$1.tmp' && mv '$1.tmp' '$1'"
+}
+
+# Materialize a directory in the delta layer by creating an entry in it.
+copy_up_dir() {
+    echo "touch '$1/.delta'"
+}
+
+HELLO="$FIXTURES/hello.txt"
+DATA="$FIXTURES/data.bin"
+DIR="$FIXTURES/dir"
+WORK="$FIXTURES/work"
+B="$SCRIPT_DIR"
+
+run_benchmark "open()+close() Micro-Benchmark" "$HELLO" "$(copy_up_file "$HELLO")" "$B/perf-open-close"
+run_benchmark "statx() Micro-Benchmark" "$HELLO" "$(copy_up_file "$HELLO")" "$B/perf-statx"
+run_benchmark "readlink() Micro-Benchmark" "$FIXTURES/link" "ln -sf hello.txt '$FIXTURES/link'" "$B/perf-readlink"
+run_benchmark "pread() 4K sequential" "$DATA" "$(copy_up_file "$DATA")" "$B/perf-pread" -s 4096
+run_benchmark "pread() 4K random" "$DATA" "$(copy_up_file "$DATA")" "$B/perf-pread" -s 4096 -r
+run_benchmark "pread() 1M sequential" "$DATA" "$(copy_up_file "$DATA")" "$B/perf-pread" -s 1048576
+run_benchmark "pwrite() 4K sequential" "$DATA" "$(copy_up_file "$DATA")" "$B/perf-pwrite" -s 4096
+run_benchmark "pwrite() 4K random" "$DATA" "$(copy_up_file "$DATA")" "$B/perf-pwrite" -s 4096 -r
+run_benchmark "pwrite() 1M sequential" "$DATA" "$(copy_up_file "$DATA")" "$B/perf-pwrite" -s 1048576
+run_benchmark "getdents64() 10k entries" "$DIR" "$(copy_up_dir "$DIR")" "$B/perf-getdents"
+run_benchmark "create+unlink Micro-Benchmark" "$WORK" "$(copy_up_dir "$WORK")" "$B/perf-create-unlink"
+run_benchmark "mkdir()+rmdir() Micro-Benchmark" "$WORK" "$(copy_up_dir "$WORK")" "$B/perf-mkdir-rmdir"
+run_benchmark "rename() Micro-Benchmark" "$WORK" "$(copy_up_dir "$WORK")" "$B/perf-rename"
+
+if [ -n "$JSON_OUT" ]; then
+    printf "%s" "$JSON_LINES" > "$JSON_OUT"
+    echo "JSON results written to $JSON_OUT"
+fi
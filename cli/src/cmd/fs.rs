@@ -1,6 +1,7 @@
 use std::collections::VecDeque;
+use std::sync::Arc;
 
-use agentfs_sdk::AgentFSOptions;
+use agentfs_sdk::{AgentFSOptions, FileSystem};
 use anyhow::{Context, Result as AnyhowResult};
 use turso::Value;
 
@@ -160,10 +161,40 @@ fn file_type_char(mode: u32) -> char {
     }
 }
 
-/// Check if a path exists in the host filesystem (base layer)
-fn path_exists_in_base(base_path: &str, rel_path: &str) -> bool {
-    let full_path = format!("{}{}", base_path, rel_path);
-    std::path::Path::new(&full_path).exists()
+/// The layer below the delta of an overlay database
+enum BaseLayer {
+    /// Host directory of an overlay
+    Host(String),
+    /// Filesystem of the parent a session was forked from
+    Parent(Arc<dyn FileSystem>),
+}
+
+impl BaseLayer {
+    /// Type of `path` in the base layer, or None if it doesn't exist there
+    async fn file_type(&self, path: &str) -> AnyhowResult<Option<char>> {
+        match self {
+            BaseLayer::Host(base_path) => {
+                let full_path = format!("{}{}", base_path, path);
+                let path = std::path::Path::new(&full_path);
+                if !path.exists() && !path.is_symlink() {
+                    return Ok(None);
+                }
+                Ok(Some(if path.is_dir() {
+                    'd'
+                } else if path.is_symlink() {
+                    'l'
+                } else if path.is_file() {
+                    'f'
+                } else {
+                    '?'
+                }))
+            }
+            BaseLayer::Parent(fs) => Ok(fs
+                .lstat(path)
+                .await?
+                .map(|stats| file_type_char(stats.mode))),
+        }
+    }
 }
 
 pub async fn diff_filesystem(id_or_path: String) -> AnyhowResult<()> {
@@ -175,16 +206,17 @@ pub async fn diff_filesystem(id_or_path: String) -> AnyhowResult<()> {
         .context("Failed to open agent")?;
 
     // Check if overlay is enabled
-    let base_path = match agent.is_overlay_enabled().await? {
-        Some(path) => path,
-        None => {
-            println!("No diff (non-overlay filesystem)");
-            return Ok(());
-        }
+    let base = if let Some(base_path) = agent.is_overlay_enabled().await? {
+        eprintln!("Base: {}", base_path);
+        BaseLayer::Host(base_path)
+    } else if let Some(parent) = agent.parent_filesystem().await? {
+        eprintln!("Parent: {}", agent.fork_parent().await?.unwrap_or_default());
+        BaseLayer::Parent(parent)
+    } else {
+        println!("No diff (non-overlay filesystem)");
+        return Ok(());
     };
 
-    eprintln!("Base: {}", base_path);
-
     // Collect all changes
     let mut changes: Vec<(ChangeType, char, String)> = Vec::new();
 
@@ -199,7 +231,7 @@ pub async fn diff_filesystem(id_or_path: String) -> AnyhowResult<()> {
         let mode = agent.get_file_mode(path).await?.unwrap_or(0);
         let type_char = file_type_char(mode);
 
-        if path_exists_in_base(&base_path, path) {
+        if base.file_type(path).await?.is_some() {
             // File exists in both - it was modified (copy-on-write)
             changes.push((ChangeType::Modified, type_char, path.clone()));
         } else {
@@ -211,17 +243,7 @@ pub async fn diff_filesystem(id_or_path: String) -> AnyhowResult<()> {
     // Process whiteouts (deleted files)
     for path in &whiteouts {
         // Determine file type from base if possible, otherwise use '?'
-        let full_path = format!("{}{}", base_path, path);
-        let base_path_obj = std::path::Path::new(&full_path);
-        let type_char = if base_path_obj.is_dir() {
-            'd'
-        } else if base_path_obj.is_symlink() {
-            'l'
-        } else if base_path_obj.is_file() {
-            'f'
-        } else {
-            '?'
-        };
+        let type_char = base.file_type(path).await?.unwrap_or('?');
 
         changes.push((ChangeType::Deleted, type_char, path.clone()));
     }
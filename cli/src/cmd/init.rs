@@ -1,7 +1,7 @@
 use std::path::PathBuf;
 use std::time::{SystemTime, UNIX_EPOCH};
 
-use agentfs_sdk::{agentfs_dir, AgentFS, AgentFSOptions, OverlayFS};
+use agentfs_sdk::{agentfs_dir, filesystem, AgentFS, AgentFSOptions, Compression, OverlayFS};
 use anyhow::{Context, Result as AnyhowResult};
 use turso::sync::{PartialBootstrapStrategy, PartialSyncOpts};
 
@@ -88,6 +88,10 @@ pub async fn init_database(
     sync_options: SyncCommandOptions,
     force: bool,
     base: Option<PathBuf>,
+    from: Option<String>,
+    dedup: bool,
+    compression: Option<String>,
+    extents: bool,
 ) -> AnyhowResult<()> {
     // Generate ID if not provided
     let id = id.unwrap_or_else(|| {
@@ -116,9 +120,30 @@ pub async fn init_database(
         }
     }
 
+    // Resolve the agent to fork from
+    let parent = match from {
+        Some(from) => {
+            let parent = AgentFSOptions::resolve(&from)?.db_path()?;
+            if parent == ":memory:" {
+                anyhow::bail!("Cannot fork from an in-memory database");
+            }
+            Some(
+                std::fs::canonicalize(&parent)
+                    .context("Failed to canonicalize parent path")?
+                    .to_string_lossy()
+                    .to_string(),
+            )
+        }
+        None => None,
+    };
+
     // Check if agent already exists
     let db_path = agentfs_dir().join(format!("{}.db", &id));
     if db_path.exists() {
+        let canonical = db_path.canonicalize()?.to_string_lossy().to_string();
+        if parent.as_deref() == Some(canonical.as_str()) {
+            anyhow::bail!("Agent '{}' cannot be forked from itself", id);
+        }
         if force {
             for entry in std::fs::read_dir(agentfs_dir())? {
                 let entry = entry?;
@@ -141,11 +166,41 @@ pub async fn init_database(
     if let Some(base_path) = base.as_ref() {
         open_options = open_options.with_base(base_path);
     }
+    if let Some(parent) = parent.as_ref() {
+        open_options = open_options.with_parent(parent);
+    }
+    if dedup {
+        open_options = open_options.with_dedup();
+    }
+    let compression = compression.map(|c| c.parse::<Compression>()).transpose()?;
+    if let Some(compression) = compression {
+        open_options = open_options.with_compression(compression);
+    }
+    if extents {
+        open_options = open_options.with_extents();
+    }
 
     // Use the SDK to initialize the database - this ensures consistency
     // The SDK will create .agentfs directory and database file
     let (synced_db, agent) = create_agentfs(open_options, sync_options).await?;
 
+    // Synced databases are opened without the local options
+    if dedup {
+        filesystem::AgentFS::init_dedup(&agent.get_connection())
+            .await
+            .context("Failed to enable chunk deduplication")?;
+    }
+    if let Some(compression) = compression {
+        filesystem::AgentFS::init_compression(&agent.get_connection(), compression)
+            .await
+            .context("Failed to enable chunk compression")?;
+    }
+    if extents {
+        filesystem::AgentFS::init_extents(&agent.get_connection())
+            .await
+            .context("Failed to enable extents")?;
+    }
+
     // If base is provided, initialize the overlay schema using the SDK
     if let Some(base_path) = base {
         let base_path_str = base_path
@@ -166,6 +221,19 @@ pub async fn init_database(
         eprintln!("Created overlay filesystem: {}", db_path.display());
         eprintln!("Agent ID: {}", id);
         eprintln!("Base: {}", base_path.display());
+    } else if let Some(parent) = parent {
+        // Synced databases are opened without the local options
+        OverlayFS::init_fork_schema(&agent.get_connection(), &parent)
+            .await
+            .context("Failed to initialize fork schema")?;
+
+        if let Some(synced_db) = synced_db {
+            synced_db.push().await?;
+        }
+
+        eprintln!("Created forked filesystem: {}", db_path.display());
+        eprintln!("Agent ID: {}", id);
+        eprintln!("Parent: {}", parent);
     } else {
         if let Some(synced_db) = synced_db {
             synced_db.push().await?;
@@ -1,15 +1,25 @@
-use agentfs_sdk::{AgentFS, AgentFSOptions, Stats};
+use agentfs_sdk::{AgentFS, AgentFSOptions, BoxedFile, Stats};
 use anyhow::{Context, Result};
 use serde::{Deserialize, Serialize};
 use serde_json::{json, Value as JsonValue};
-use std::collections::HashSet;
+use std::collections::{HashSet, VecDeque};
 use std::io::{self, BufRead, Write};
 use std::path::Path;
 use std::sync::Arc;
 use tokio::sync::Mutex;
+use tokio::task::JoinSet;
 
 use crate::cmd::init::open_agentfs;
 
+/// Bytes read from a file when a range gives no length
+const DEFAULT_READ_LENGTH: u64 = 256 * 1024;
+
+/// Bytes a single `read_many` call returns across all of its files
+const MAX_READ_MANY_BYTES: u64 = 4 * 1024 * 1024;
+
+/// Entries a `tree` call returns unless it asks for fewer
+const MAX_TREE_ENTRIES: usize = 10_000;
+
 /// Main entry point for MCP server command
 pub async fn handle_mcp_server_command(
     id_or_path: String,
@@ -207,6 +217,18 @@ impl McpServer {
                 let params: StatParams = serde_json::from_value(arguments)?;
                 self.handle_stat(params).await?
             }
+            "read_many" => {
+                let params: ReadManyParams = serde_json::from_value(arguments)?;
+                self.handle_read_many(params).await?
+            }
+            "stat_many" => {
+                let params: StatManyParams = serde_json::from_value(arguments)?;
+                self.handle_stat_many(params).await?
+            }
+            "tree" => {
+                let params: TreeParams = serde_json::from_value(arguments)?;
+                self.handle_tree(params).await?
+            }
             "access" => {
                 let params: AccessParams = serde_json::from_value(arguments)?;
                 self.handle_access(params).await?
@@ -275,7 +297,9 @@ impl McpServer {
         if self.is_tool_enabled("read_file") {
             tools.push(json!({
                 "name": "read_file",
-                "description": "Read file contents from the filesystem",
+                "description": "Read file contents from the filesystem. With an offset or length, \
+                    returns JSON with the content of the range, the file size and, if the range \
+                    stopped before the end of the file, the next_offset to continue from.",
                 "inputSchema": {
                     "type": "object",
                     "properties": {
@@ -287,6 +311,14 @@ impl McpServer {
                             "type": "string",
                             "enum": ["utf8", "base64"],
                             "description": "Encoding to use for file contents (default: utf8)"
+                        },
+                        "offset": {
+                            "type": "integer",
+                            "description": "Byte offset to start reading at (default: 0)"
+                        },
+                        "length": {
+                            "type": "integer",
+                            "description": "Maximum number of bytes to read (default: to the end of the file)"
                         }
                     },
                     "required": ["path"]
@@ -294,6 +326,52 @@ impl McpServer {
             }));
         }
 
+        if self.is_tool_enabled("read_many") {
+            tools.push(json!({
+                "name": "read_many",
+                "description": format!(
+                    "Read byte ranges of several files in one call. Each result has the file size and, \
+                     if the range stopped before the end of the file, the next_offset to continue from. \
+                     A range without a length reads up to {} bytes, and one call returns at most {} \
+                     bytes in total. Files that fail to read report an error without failing the others.",
+                    DEFAULT_READ_LENGTH, MAX_READ_MANY_BYTES
+                ),
+                "inputSchema": {
+                    "type": "object",
+                    "properties": {
+                        "files": {
+                            "type": "array",
+                            "description": "Files to read, in the order their results are returned",
+                            "items": {
+                                "type": "object",
+                                "properties": {
+                                    "path": {
+                                        "type": "string",
+                                        "description": "Path to the file to read"
+                                    },
+                                    "offset": {
+                                        "type": "integer",
+                                        "description": "Byte offset to start reading at (default: 0)"
+                                    },
+                                    "length": {
+                                        "type": "integer",
+                                        "description": "Maximum number of bytes to read"
+                                    }
+                                },
+                                "required": ["path"]
+                            }
+                        },
+                        "encoding": {
+                            "type": "string",
+                            "enum": ["utf8", "base64"],
+                            "description": "Encoding to use for file contents (default: utf8)"
+                        }
+                    },
+                    "required": ["files"]
+                }
+            }));
+        }
+
         if self.is_tool_enabled("write_file") {
             tools.push(json!({
                 "name": "write_file",
@@ -413,6 +491,54 @@ impl McpServer {
             }));
         }
 
+        if self.is_tool_enabled("stat_many") {
+            tools.push(json!({
+                "name": "stat_many",
+                "description": "Get metadata of several paths in one call. Missing paths have null stats.",
+                "inputSchema": {
+                    "type": "object",
+                    "properties": {
+                        "paths": {
+                            "type": "array",
+                            "items": { "type": "string" },
+                            "description": "Paths to stat"
+                        }
+                    },
+                    "required": ["paths"]
+                }
+            }));
+        }
+
+        if self.is_tool_enabled("tree") {
+            tools.push(json!({
+                "name": "tree",
+                "description": format!(
+                    "List a directory recursively with the type and size of every entry. \
+                     Symlinks are listed but not followed. Returns at most {} entries, \
+                     shallower ones first, and sets truncated if there were more.",
+                    MAX_TREE_ENTRIES
+                ),
+                "inputSchema": {
+                    "type": "object",
+                    "properties": {
+                        "path": {
+                            "type": "string",
+                            "description": "Path to the directory to list"
+                        },
+                        "max_depth": {
+                            "type": "integer",
+                            "description": "Levels of subdirectories to descend into (default: unlimited, 1 lists only the directory itself)"
+                        },
+                        "max_entries": {
+                            "type": "integer",
+                            "description": "Maximum number of entries to return"
+                        }
+                    },
+                    "required": ["path"]
+                }
+            }));
+        }
+
         if self.is_tool_enabled("access") {
             tools.push(json!({
                 "name": "access",
@@ -576,6 +702,26 @@ struct ReadFileParams {
     path: String,
     #[serde(default)]
     encoding: Option<String>,
+    #[serde(default)]
+    offset: Option<u64>,
+    #[serde(default)]
+    length: Option<u64>,
+}
+
+#[derive(Debug, Serialize, Deserialize)]
+struct ReadRange {
+    path: String,
+    #[serde(default)]
+    offset: Option<u64>,
+    #[serde(default)]
+    length: Option<u64>,
+}
+
+#[derive(Debug, Serialize, Deserialize)]
+struct ReadManyParams {
+    files: Vec<ReadRange>,
+    #[serde(default)]
+    encoding: Option<String>,
 }
 
 #[derive(Debug, Serialize, Deserialize)]
@@ -614,6 +760,20 @@ struct StatParams {
     path: String,
 }
 
+#[derive(Debug, Serialize, Deserialize)]
+struct StatManyParams {
+    paths: Vec<String>,
+}
+
+#[derive(Debug, Serialize, Deserialize)]
+struct TreeParams {
+    path: String,
+    #[serde(default)]
+    max_depth: Option<usize>,
+    #[serde(default)]
+    max_entries: Option<usize>,
+}
+
 #[derive(Debug, Serialize, Deserialize)]
 struct AccessParams {
     path: String,
@@ -644,6 +804,14 @@ impl McpServer {
     async fn handle_read_file(&self, params: ReadFileParams) -> Result<String> {
         let path = normalize_path(&params.path)?;
 
+        if params.offset.is_some() || params.length.is_some() {
+            let base64 = params.encoding.as_deref() == Some("base64");
+            let file = OpenRange::open(&self.agentfs, path, params.offset.unwrap_or(0)).await?;
+            let length = params.length.unwrap_or(u64::MAX);
+            let range = file.read(length, base64).await?;
+            return Ok(serde_json::to_string_pretty(&range)?);
+        }
+
         let data = self
             .agentfs
             .fs
@@ -788,6 +956,141 @@ impl McpServer {
         Ok(serde_json::to_string_pretty(&StatsResponse::from(stats))?)
     }
 
+    /// Read ranges of several files
+    ///
+    /// The files are opened and then read concurrently, spread over the
+    /// reader connections, and the results come back in request order. The
+    /// byte budget is shared out in request order by what each range can
+    /// actually return, so short files don't use up more than their size.
+    async fn handle_read_many(&self, params: ReadManyParams) -> Result<String> {
+        let base64 = params.encoding.as_deref() == Some("base64");
+        let count = params.files.len();
+
+        let mut opens = JoinSet::new();
+        for (index, range) in params.files.into_iter().enumerate() {
+            let agentfs = self.agentfs.clone();
+            opens.spawn(async move {
+                let file = match normalize_path(&range.path) {
+                    Ok(path) => OpenRange::open(&agentfs, path, range.offset.unwrap_or(0)).await,
+                    Err(e) => Err(e),
+                };
+                (index, range, file)
+            });
+        }
+        let mut opened: Vec<Option<_>> = (0..count).map(|_| None).collect();
+        while let Some(open) = opens.join_next().await {
+            let (index, range, file) = open?;
+            opened[index] = Some((range, file));
+        }
+
+        let mut budget = MAX_READ_MANY_BYTES;
+        let mut reads = JoinSet::new();
+        let mut results = vec![JsonValue::Null; count];
+        for (index, slot) in opened.into_iter().enumerate() {
+            let Some((range, file)) = slot else {
+                continue;
+            };
+            let file = match file {
+                Ok(file) => file,
+                Err(e) => {
+                    results[index] = json!({ "path": range.path, "error": format!("{:#}", e) });
+                    continue;
+                }
+            };
+            // Ranges past the budget come back empty, with a next_offset
+            let length = range
+                .length
+                .unwrap_or(DEFAULT_READ_LENGTH)
+                .min(file.remaining())
+                .min(budget);
+            budget -= length;
+            reads.spawn(async move {
+                let result = match file.read(length, base64).await {
+                    Ok(range) => serde_json::to_value(range).unwrap_or(JsonValue::Null),
+                    Err(e) => json!({ "path": range.path, "error": format!("{:#}", e) }),
+                };
+                (index, result)
+            });
+        }
+
+        while let Some(read) = reads.join_next().await {
+            let (index, result) = read?;
+            results[index] = result;
+        }
+
+        Ok(serde_json::to_string_pretty(&results)?)
+    }
+
+    /// Get metadata of several paths
+    async fn handle_stat_many(&self, params: StatManyParams) -> Result<String> {
+        let mut results = Vec::with_capacity(params.paths.len());
+
+        for path in params.paths {
+            let stats = match normalize_path(&path) {
+                Ok(normalized) => self
+                    .agentfs
+                    .fs
+                    .stat(&normalized)
+                    .await
+                    .context("Failed to stat"),
+                Err(e) => Err(e),
+            };
+            results.push(match stats {
+                Ok(stats) => json!({ "path": path, "stats": stats.map(StatsResponse::from) }),
+                Err(e) => json!({ "path": path, "error": format!("{:#}", e) }),
+            });
+        }
+
+        Ok(serde_json::to_string_pretty(&results)?)
+    }
+
+    /// List a directory tree
+    ///
+    /// Walks breadth-first with one `readdir_inode` per directory, so entry
+    /// stats come with the listing and no path is resolved twice.
+    async fn handle_tree(&self, params: TreeParams) -> Result<String> {
+        let path = normalize_path(&params.path)?;
+        let max_depth = params.max_depth.unwrap_or(usize::MAX);
+        let max_entries = params
+            .max_entries
+            .unwrap_or(MAX_TREE_ENTRIES)
+            .min(MAX_TREE_ENTRIES);
+
+        let fs = &self.agentfs.fs;
+        let root = fs
+            .readdir_plus(&path)
+            .await
+            .context("Failed to read directory")?
+            .ok_or_else(|| anyhow::anyhow!("Directory not found: {}", path))?;
+
+        let mut entries = Vec::new();
+        let mut truncated = false;
+        let mut pending = VecDeque::from([(path.clone(), root, 1)]);
+        'walk: while let Some((dir, listing, depth)) = pending.pop_front() {
+            let prefix = if dir == "/" { "" } else { dir.as_str() };
+            for entry in listing {
+                if entries.len() == max_entries {
+                    truncated = true;
+                    break 'walk;
+                }
+                let entry_path = format!("{}/{}", prefix, entry.name);
+                if entry.stats.is_directory() && depth < max_depth {
+                    if let Some(children) = fs.readdir_inode(entry.stats.ino).await? {
+                        pending.push_back((entry_path.clone(), children, depth + 1));
+                    }
+                }
+                entries.push(TreeEntry::new(entry_path, &entry.stats));
+            }
+        }
+        entries.sort_by(|a, b| a.path.cmp(&b.path));
+
+        Ok(serde_json::to_string_pretty(&json!({
+            "path": path,
+            "entries": entries,
+            "truncated": truncated
+        }))?)
+    }
+
     /// Test if path exists
     async fn handle_access(&self, params: AccessParams) -> Result<String> {
         let path = normalize_path(&params.path)?;
@@ -845,22 +1148,28 @@ impl McpServer {
         resources: &'a mut Vec<JsonValue>,
     ) -> std::pin::Pin<Box<dyn std::future::Future<Output = Result<()>> + Send + 'a>> {
         Box::pin(async move {
-            let entries = match self.agentfs.fs.readdir(path).await? {
+            let entries = match self.agentfs.fs.readdir_plus(path).await? {
                 Some(entries) => entries,
                 None => return Ok(()),
             };
 
             for entry in entries {
                 let full_path = if path == "/" {
-                    format!("/{}", entry)
+                    format!("/{}", entry.name)
                 } else {
-                    format!("{}/{}", path, entry)
+                    format!("{}/{}", path, entry.name)
                 };
 
-                let stats = match self.agentfs.fs.stat(&full_path).await? {
-                    Some(s) => s,
-                    None => continue,
+                // Only symlinks need another lookup to find what they point to
+                let stats = if entry.stats.is_symlink() {
+                    match self.agentfs.fs.stat(&full_path).await? {
+                        Some(s) => s,
+                        None => continue,
+                    }
+                } else {
+                    entry.stats
                 };
+                let entry = entry.name;
 
                 if stats.is_file() {
                     resources.push(json!({
@@ -895,10 +1204,147 @@ impl McpServer {
     }
 }
 
+/// A file opened for reading a range from `offset`
+struct OpenRange {
+    path: String,
+    file: BoxedFile,
+    offset: u64,
+    size: u64,
+}
+
+impl OpenRange {
+    /// Open the file at `path`, clamping `offset` to its size
+    async fn open(agentfs: &AgentFS, path: String, offset: u64) -> Result<Self> {
+        let file = agentfs
+            .fs
+            .open(&path)
+            .await
+            .with_context(|| format!("Failed to open file: {}", path))?;
+        let stats = file.fstat().await.context("Failed to stat file")?;
+        if !stats.is_file() {
+            anyhow::bail!("Not a file: {}", path);
+        }
+        let size = stats.size.max(0) as u64;
+        Ok(Self {
+            path,
+            file,
+            offset: offset.min(size),
+            size,
+        })
+    }
+
+    /// Bytes from the offset to the end of the file
+    fn remaining(&self) -> u64 {
+        self.size - self.offset
+    }
+
+    /// Read up to `length` bytes
+    ///
+    /// UTF-8 content that ends inside a character stops before it, and
+    /// `next_offset` then points at that character. A non-empty range too
+    /// short for the first character is extended to hold it, so paging
+    /// through a file always makes progress.
+    async fn read(self, length: u64, base64: bool) -> Result<FileRange> {
+        let Self {
+            path,
+            file,
+            offset,
+            size,
+        } = self;
+        let mut data = file
+            .pread(offset, length.min(size - offset))
+            .await
+            .context("Failed to read file")?;
+        let at_eof = offset + data.len() as u64 == size;
+
+        // An incomplete character at the end is left for the next range
+        if !base64 {
+            if let Err(e) = std::str::from_utf8(&data) {
+                if e.error_len().is_some() || at_eof {
+                    anyhow::bail!("File is not valid UTF-8. Use encoding=base64 for binary files.");
+                }
+                if e.valid_up_to() == 0 {
+                    // A character is at most 4 bytes long
+                    let more = file
+                        .pread(offset, 4.min(size - offset))
+                        .await
+                        .context("Failed to read file")?;
+                    let valid = match std::str::from_utf8(&more) {
+                        Ok(valid) => valid,
+                        Err(e) => std::str::from_utf8(&more[..e.valid_up_to()])?,
+                    };
+                    let Some(first) = valid.chars().next() else {
+                        anyhow::bail!(
+                            "File is not valid UTF-8. Use encoding=base64 for binary files."
+                        );
+                    };
+                    data = more[..first.len_utf8()].to_vec();
+                } else {
+                    data.truncate(e.valid_up_to());
+                }
+            }
+        }
+
+        let end = offset + data.len() as u64;
+        let content = if base64 {
+            base64_encode(&data)
+        } else {
+            String::from_utf8(data)?
+        };
+        Ok(FileRange {
+            path,
+            offset,
+            size,
+            content,
+            next_offset: (end < size).then_some(end),
+        })
+    }
+}
+
 // ============================================================================
 // Response types
 // ============================================================================
 
+/// Part of a file returned by `read_many`, or by `read_file` with a range
+#[derive(Debug, Serialize)]
+struct FileRange {
+    path: String,
+    offset: u64,
+    /// Size of the whole file
+    size: u64,
+    content: String,
+    /// Where the next range starts, unless this one reached the end of the file
+    next_offset: Option<u64>,
+}
+
+/// One entry of a `tree` listing
+#[derive(Debug, Serialize)]
+struct TreeEntry {
+    path: String,
+    #[serde(rename = "type")]
+    kind: &'static str,
+    size: i64,
+}
+
+impl TreeEntry {
+    fn new(path: String, stats: &Stats) -> Self {
+        let kind = if stats.is_directory() {
+            "directory"
+        } else if stats.is_symlink() {
+            "symlink"
+        } else if stats.is_file() {
+            "file"
+        } else {
+            "other"
+        };
+        Self {
+            path,
+            kind,
+            size: stats.size,
+        }
+    }
+}
+
 #[derive(Debug, Serialize)]
 struct StatsResponse {
     ino: i64,
@@ -933,3 +1379,189 @@ impl From<Stats> for StatsResponse {
         }
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempfile::NamedTempFile;
+
+    async fn server() -> (McpServer, NamedTempFile) {
+        let file = NamedTempFile::new().unwrap();
+        let path = file.path().to_str().unwrap();
+        let agentfs = AgentFS::open(AgentFSOptions::with_path(path))
+            .await
+            .unwrap();
+        (McpServer::new(agentfs, None), file)
+    }
+
+    /// Call a tool and parse the JSON it returns
+    async fn call(server: &McpServer, name: &str, arguments: JsonValue) -> JsonValue {
+        let result = server
+            .handle_tools_call(json!({ "name": name, "arguments": arguments }))
+            .await
+            .unwrap();
+        let text = result["content"][0]["text"].as_str().unwrap();
+        serde_json::from_str(text).unwrap()
+    }
+
+    #[tokio::test]
+    async fn read_many_pages_through_files() {
+        let (server, _file) = server().await;
+        let fs = &server.agentfs.fs;
+        fs.write_file("/a.txt", "héllo wörld".as_bytes())
+            .await
+            .unwrap();
+        fs.write_file("/b.txt", b"second").await.unwrap();
+
+        let results = call(
+            &server,
+            "read_many",
+            json!({ "files": [
+                { "path": "a.txt", "length": 2 },
+                { "path": "/b.txt", "offset": 3 },
+                { "path": "/missing.txt" }
+            ] }),
+        )
+        .await;
+
+        // The range ends inside "é", so it stops before it
+        assert_eq!(results[0]["content"], "h");
+        assert_eq!(results[0]["size"], 13);
+        assert_eq!(results[0]["next_offset"], 1);
+        assert_eq!(results[1]["content"], "ond");
+        assert_eq!(results[1]["next_offset"], JsonValue::Null);
+        assert!(results[2]["error"]
+            .as_str()
+            .unwrap()
+            .contains("/missing.txt"));
+
+        let results = call(
+            &server,
+            "read_many",
+            json!({ "files": [{ "path": "/a.txt", "offset": 1 }] }),
+        )
+        .await;
+        assert_eq!(results[0]["content"], "éllo wörld");
+
+        // A range shorter than its first character still returns it
+        let results = call(
+            &server,
+            "read_many",
+            json!({ "files": [{ "path": "/a.txt", "offset": 1, "length": 1 }] }),
+        )
+        .await;
+        assert_eq!(results[0]["content"], "é");
+        assert_eq!(results[0]["next_offset"], 3);
+    }
+
+    #[tokio::test]
+    async fn read_many_charges_bytes_read() {
+        let (server, _file) = server().await;
+        for i in 0..20 {
+            let path = format!("/f{}.txt", i);
+            server
+                .agentfs
+                .fs
+                .write_file(&path, path.as_bytes())
+                .await
+                .unwrap();
+        }
+
+        // Without a length each range may read DEFAULT_READ_LENGTH bytes,
+        // but only what the small files hold counts against the budget
+        let files: Vec<_> = (0..20)
+            .map(|i| json!({ "path": format!("/f{}.txt", i) }))
+            .collect();
+        let results = call(&server, "read_many", json!({ "files": files })).await;
+        for (i, result) in results.as_array().unwrap().iter().enumerate() {
+            assert_eq!(result["content"], format!("/f{}.txt", i));
+            assert_eq!(result["next_offset"], JsonValue::Null);
+        }
+    }
+
+    #[tokio::test]
+    async fn read_file_range_reports_next_offset() {
+        let (server, _file) = server().await;
+        server
+            .agentfs
+            .fs
+            .write_file("/r.txt", b"0123456789")
+            .await
+            .unwrap();
+
+        let range = call(
+            &server,
+            "read_file",
+            json!({ "path": "/r.txt", "offset": 2, "length": 3 }),
+        )
+        .await;
+        assert_eq!(range["content"], "234");
+        assert_eq!(range["size"], 10);
+        assert_eq!(range["next_offset"], 5);
+
+        let range = call(
+            &server,
+            "read_file",
+            json!({ "path": "/r.txt", "offset": 5 }),
+        )
+        .await;
+        assert_eq!(range["content"], "56789");
+        assert_eq!(range["next_offset"], JsonValue::Null);
+    }
+
+    #[tokio::test]
+    async fn stat_many_reports_missing_paths() {
+        let (server, _file) = server().await;
+        server.agentfs.fs.mkdir("/dir").await.unwrap();
+
+        let results = call(
+            &server,
+            "stat_many",
+            json!({ "paths": ["/dir", "/missing", "../escape"] }),
+        )
+        .await;
+        assert_eq!(results[0]["stats"]["is_directory"], true);
+        assert_eq!(results[1]["stats"], JsonValue::Null);
+        assert!(results[2]["error"].is_string());
+    }
+
+    #[tokio::test]
+    async fn tree_lists_recursively() {
+        let (server, _file) = server().await;
+        let fs = &server.agentfs.fs;
+        fs.mkdir("/src").await.unwrap();
+        fs.mkdir("/src/bin").await.unwrap();
+        fs.write_file("/src/bin/main.rs", b"fn main() {}")
+            .await
+            .unwrap();
+        fs.write_file("/src/lib.rs", b"").await.unwrap();
+        fs.write_file("/README", b"readme").await.unwrap();
+
+        let tree = call(&server, "tree", json!({ "path": "/" })).await;
+        let paths: Vec<&str> = tree["entries"]
+            .as_array()
+            .unwrap()
+            .iter()
+            .map(|entry| entry["path"].as_str().unwrap())
+            .collect();
+        assert_eq!(
+            paths,
+            [
+                "/README",
+                "/src",
+                "/src/bin",
+                "/src/bin/main.rs",
+                "/src/lib.rs"
+            ]
+        );
+        assert_eq!(tree["entries"][3]["type"], "file");
+        assert_eq!(tree["entries"][3]["size"], 12);
+        assert_eq!(tree["truncated"], false);
+
+        let tree = call(&server, "tree", json!({ "path": "/src", "max_depth": 1 })).await;
+        assert_eq!(tree["entries"].as_array().unwrap().len(), 2);
+        let tree = call(&server, "tree", json!({ "path": "/", "max_entries": 2 })).await;
+        assert_eq!(tree["entries"].as_array().unwrap().len(), 2);
+        assert_eq!(tree["truncated"], true);
+    }
+}
@@ -1,14 +1,21 @@
-use agentfs_sdk::{get_mounts, AgentFSOptions, FileSystem, HostFS, Mount, OverlayFS};
+use agentfs_sdk::{
+    filesystem::overlayfs::NEGATIVE_ENTRY_TTL, get_mounts, AgentFSOptions, FileSystem, HostFS,
+    Mount, OverlayFS, DEFAULT_WRITE_BUFFER_BYTES,
+};
 use anyhow::Result;
 use std::{
     io::{self, Write},
     os::unix::fs::MetadataExt,
     path::{Path, PathBuf},
     sync::Arc,
+    time::Duration,
 };
 use turso::value::Value;
 
-use crate::{cmd::init::open_agentfs, fuse::FuseMountOptions};
+use crate::{
+    cmd::init::open_agentfs,
+    fuse::{FuseMountOptions, DEFAULT_TTL},
+};
 
 /// Arguments for the mount command.
 #[derive(Debug, Clone)]
@@ -27,6 +34,16 @@ pub struct MountArgs {
     pub uid: Option<u32>,
     /// Group ID to report for all files (defaults to current group).
     pub gid: Option<u32>,
+    /// Keep the kernel page cache and readdir cache across opens.
+    pub keep_cache: bool,
+    /// Attribute cache timeout in seconds (defaults to until invalidated).
+    pub attr_timeout: Option<u64>,
+    /// Entry cache timeout in seconds (defaults to until invalidated).
+    pub entry_timeout: Option<u64>,
+    /// Negative entry cache timeout in seconds (defaults to `entry_timeout`).
+    pub negative_timeout: Option<u64>,
+    /// Address to serve filesystem metrics on over HTTP.
+    pub metrics_listen: Option<String>,
 }
 
 /// Mount the agent filesystem using FUSE.
@@ -76,21 +93,33 @@ pub fn mount(args: MountArgs) -> Result<()> {
         }
     };
 
-    let fuse_opts = FuseMountOptions {
+    let negative_timeout = args
+        .negative_timeout
+        .or(args.entry_timeout)
+        .map(Duration::from_secs);
+    let mut fuse_opts = FuseMountOptions {
         mountpoint: args.mountpoint,
         auto_unmount: args.auto_unmount,
         allow_root: args.allow_root,
         fsname,
         uid: args.uid,
         gid: args.gid,
+        keep_cache: args.keep_cache,
+        attr_timeout: args.attr_timeout.map_or(DEFAULT_TTL, Duration::from_secs),
+        entry_timeout: args.entry_timeout.map_or(DEFAULT_TTL, Duration::from_secs),
+        negative_timeout: negative_timeout.unwrap_or(DEFAULT_TTL),
     };
 
+    let metrics_listen = args.metrics_listen;
     let mount = move || {
         let rt = crate::get_runtime();
+        if let Some(addr) = &metrics_listen {
+            crate::metrics::serve(&rt, addr)?;
+        }
         let (_db, agentfs) = rt.block_on(open_agentfs(opts))?;
 
         // Check for overlay configuration
-        let fs: Arc<dyn FileSystem> = rt.block_on(async {
+        let (fs, overlay) = rt.block_on(async {
             let conn = agentfs.get_connection();
 
             // Check if fs_overlay_config table exists and has base_path
@@ -112,20 +141,41 @@ pub fn mount(args: MountArgs) -> Result<()> {
                 Err(_) => None, // Table doesn't exist or query failed
             };
 
+            // FUSE flushes every handle on close, so small writes can be
+            // coalesced in memory until then
+            agentfs
+                .fs
+                .set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
+
             if let Some(base_path) = base_path {
                 // Create OverlayFS with HostFS base
                 eprintln!("Using overlay filesystem with base: {}", base_path);
                 let hostfs = HostFS::new(&base_path)?;
                 #[cfg(target_family = "unix")]
                 let hostfs = { hostfs.with_fuse_mountpoint(mountpoint_ino) };
+                let hostfs = hostfs.with_metadata_cache()?;
                 let overlay = OverlayFS::new(Arc::new(hostfs), agentfs.fs);
-                Ok::<Arc<dyn FileSystem>, anyhow::Error>(Arc::new(overlay))
+                Ok::<_, anyhow::Error>((Arc::new(overlay) as Arc<dyn FileSystem>, true))
+            } else if let Some(parent) = agentfs.parent_filesystem().await? {
+                // Forked session stacked on its parent
+                eprintln!(
+                    "Using forked filesystem with parent: {}",
+                    agentfs.fork_parent().await?.unwrap_or_default()
+                );
+                let overlay = OverlayFS::new(parent, agentfs.fs);
+                Ok((Arc::new(overlay) as Arc<dyn FileSystem>, true))
             } else {
                 // Plain AgentFS
-                Ok(Arc::new(agentfs.fs) as Arc<dyn FileSystem>)
+                Ok((Arc::new(agentfs.fs) as Arc<dyn FileSystem>, false))
             }
         })?;
 
+        // The lower layer can gain files without the kernel being told, so
+        // failed lookups are only cached as long as the overlay caches them
+        if overlay && negative_timeout.is_none() {
+            fuse_opts.negative_timeout = NEGATIVE_ENTRY_TTL;
+        }
+
         crate::fuse::mount(fs, fuse_opts, rt)
     };
 
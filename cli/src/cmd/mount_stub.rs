@@ -19,6 +19,16 @@ pub struct MountArgs {
     pub uid: Option<u32>,
     /// Group ID to report for all files (defaults to current group).
     pub gid: Option<u32>,
+    /// Keep the kernel page cache and readdir cache across opens.
+    pub keep_cache: bool,
+    /// Attribute cache timeout in seconds (defaults to until invalidated).
+    pub attr_timeout: Option<u64>,
+    /// Entry cache timeout in seconds (defaults to until invalidated).
+    pub entry_timeout: Option<u64>,
+    /// Negative entry cache timeout in seconds (defaults to `entry_timeout`).
+    pub negative_timeout: Option<u64>,
+    /// Address to serve filesystem metrics on over HTTP.
+    pub metrics_listen: Option<String>,
 }
 
 /// List all currently mounted agentfs filesystems
@@ -10,10 +10,9 @@ use nfsserve::tcp::NFSTcp;
 use std::path::PathBuf;
 use std::sync::Arc;
 use tokio::signal;
-use tokio::sync::Mutex;
 
 use crate::cmd::init::open_agentfs;
-use crate::nfs::AgentNFS;
+use crate::nfs::{AgentNFS, NFS_IO_SIZE};
 
 /// Handle the `nfs` command - start a standalone NFS server.
 pub async fn handle_nfs_command(id_or_path: String, bind: String, port: u32) -> Result<()> {
@@ -35,15 +34,23 @@ pub async fn handle_nfs_command(id_or_path: String, bind: String, port: u32) ->
         .context("Failed to check overlay config")?;
 
     // Create filesystem - either direct AgentFS or overlay with base
-    let fs: Arc<Mutex<dyn FileSystem>> = if let Some(base_str) = base_path {
+    let fs: Arc<dyn FileSystem> = if let Some(base_str) = base_path {
         let hostfs = HostFS::new(&base_str).context("Failed to create HostFS")?;
         let overlay = OverlayFS::new(Arc::new(hostfs), agentfs.fs);
 
         eprintln!("Mode: overlay (base: {})", base_str);
-        Arc::new(Mutex::new(overlay))
+        Arc::new(overlay)
+    } else if let Some(parent) = agentfs
+        .parent_filesystem()
+        .await
+        .context("Failed to open parent filesystem")?
+    {
+        let parent_path = agentfs.fork_parent().await?.unwrap_or_default();
+        eprintln!("Mode: fork (parent: {})", parent_path);
+        Arc::new(OverlayFS::new(parent, agentfs.fs))
     } else {
         eprintln!("Mode: direct AgentFS");
-        Arc::new(Mutex::new(agentfs.fs))
+        Arc::new(agentfs.fs)
     };
 
     // Get current user/group for NFS file ownership
@@ -68,8 +75,8 @@ pub async fn handle_nfs_command(id_or_path: String, bind: String, port: u32) ->
     eprintln!();
     eprintln!("Mount from client:");
     eprintln!(
-        "  mount -t nfs -o vers=3,tcp,port={},mountport={},nolock {}:/ /mnt",
-        port, port, bind
+        "  mount -t nfs -o vers=3,tcp,port={},mountport={},nolock,rsize={},wsize={} {}:/ /mnt",
+        port, port, NFS_IO_SIZE, NFS_IO_SIZE, bind
     );
     eprintln!();
     eprintln!("Press Ctrl+C to stop.");
@@ -22,6 +22,7 @@ pub async fn handle_run_command(
     no_default_allows: bool,
     experimental_sandbox: bool,
     strace: bool,
+    seccomp: bool,
     session: Option<String>,
     command: PathBuf,
     args: Vec<String>,
@@ -31,6 +32,7 @@ pub async fn handle_run_command(
         no_default_allows,
         experimental_sandbox,
         strace,
+        seccomp,
         session,
         command,
         args,
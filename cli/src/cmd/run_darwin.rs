@@ -15,9 +15,8 @@ use nfsserve::tcp::NFSTcp;
 use std::path::{Path, PathBuf};
 use std::process::Command;
 use std::sync::Arc;
-use tokio::sync::Mutex;
 
-use crate::nfs::AgentNFS;
+use crate::nfs::{AgentNFS, NFS_IO_SIZE};
 
 #[cfg(target_os = "macos")]
 use crate::sandbox::darwin::{generate_sandbox_profile, SandboxConfig};
@@ -31,6 +30,7 @@ pub async fn run(
     no_default_allows: bool,
     _experimental_sandbox: bool,
     _strace: bool,
+    _seccomp: bool,
     session_id: Option<String>,
     command: PathBuf,
     args: Vec<String>,
@@ -76,7 +76,7 @@ pub async fn run(
         .await
         .context("Failed to initialize overlay")?;
 
-    let fs: Arc<Mutex<dyn FileSystem>> = Arc::new(Mutex::new(overlay));
+    let fs: Arc<dyn FileSystem> = Arc::new(overlay);
 
     // Get current user/group
     let uid = unsafe { libc::getuid() };
@@ -293,8 +293,8 @@ fn mount_nfs(port: u32, mountpoint: &Path) -> Result<()> {
         .args([
             "-o",
             &format!(
-                "locallocks,vers=3,tcp,port={},mountport={},soft,timeo=10,retrans=2",
-                port, port
+                "locallocks,vers=3,tcp,port={},mountport={},rsize={},wsize={},soft,timeo=10,retrans=2",
+                port, port, NFS_IO_SIZE, NFS_IO_SIZE
             ),
             &format!("127.0.0.1:/"),
             mountpoint.to_str().unwrap(),
@@ -319,8 +319,8 @@ fn mount_nfs(port: u32, mountpoint: &Path) -> Result<()> {
             "nfs",
             "-o",
             &format!(
-                "vers=3,tcp,port={},mountport={},nolock,soft,timeo=10,retrans=2",
-                port, port
+                "vers=3,tcp,port={},mountport={},nolock,rsize={},wsize={},soft,timeo=10,retrans=2",
+                port, port, NFS_IO_SIZE, NFS_IO_SIZE
             ),
             "127.0.0.1:/",
             mountpoint.to_str().unwrap(),
@@ -12,6 +12,7 @@ pub async fn run(
     no_default_allows: bool,
     experimental_sandbox: bool,
     strace: bool,
+    seccomp: bool,
     session: Option<String>,
     command: PathBuf,
     args: Vec<String>,
@@ -23,11 +24,14 @@ pub async fn run(
         if session.is_some() {
             eprintln!("Warning: --session is not supported with --experimental-sandbox, ignoring");
         }
-        crate::sandbox::linux_ptrace::run_cmd(strace, command, args).await;
+        crate::sandbox::linux_ptrace::run_cmd(strace, seccomp, command, args).await;
     } else {
         if strace {
             eprintln!("Warning: --strace is only supported with --experimental-sandbox, ignoring");
         }
+        if seccomp {
+            eprintln!("Warning: --seccomp is only supported with --experimental-sandbox, ignoring");
+        }
         crate::sandbox::linux::run_cmd(allow, no_default_allows, session, command, args).await?;
     }
     Ok(())
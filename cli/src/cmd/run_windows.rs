@@ -11,6 +11,7 @@ pub async fn run(
     _no_default_allows: bool,
     _experimental_sandbox: bool,
     _strace: bool,
+    _seccomp: bool,
     _session: Option<String>,
     _command: PathBuf,
     _args: Vec<String>,
@@ -1,16 +1,28 @@
-use agentfs_sdk::{toolcalls::ToolCall, AgentFSOptions, ToolCalls};
+use agentfs_sdk::{
+    toolcalls::ToolCall, AgentFSOptions, TimelineCursor, TimelineFilter, ToolCallStatus, ToolCalls,
+};
 use anyhow::{Context, Result as AnyhowResult};
 use chrono::TimeZone;
+use std::collections::BTreeSet;
 use std::io::Write;
 use std::str::FromStr;
+use std::time::Duration;
 
 use crate::cmd::init::open_agentfs;
 
+/// Tool calls fetched per query
+const TIMELINE_PAGE_SIZE: i64 = 500;
+
+/// How often `--follow` checks for new tool calls
+const FOLLOW_POLL_INTERVAL: Duration = Duration::from_millis(500);
+
 /// Output format for timeline display
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub enum OutputFormat {
     Table,
     Json,
+    /// One JSON object per line
+    Ndjson,
 }
 
 impl FromStr for OutputFormat {
@@ -20,6 +32,7 @@ impl FromStr for OutputFormat {
         match s {
             "table" => Ok(OutputFormat::Table),
             "json" => Ok(OutputFormat::Json),
+            "ndjson" => Ok(OutputFormat::Ndjson),
             _ => anyhow::bail!("Invalid format: {}", s),
         }
     }
@@ -32,6 +45,8 @@ pub struct TimelineOptions {
     pub filter: Option<String>,
     pub status: Option<String>,
     pub format: String,
+    /// Keep printing tool calls as they are recorded
+    pub follow: bool,
 }
 
 /// Display agent action timeline from tool call audit log
@@ -49,29 +64,255 @@ pub async fn show_timeline(
         .await
         .context("Failed to create tool calls tracker")?;
 
-    // Query tool calls
-    let mut calls = toolcalls
-        .recent(Some(options.limit))
-        .await
-        .context("Failed to query tool calls")?;
+    let filter = TimelineFilter {
+        name: options.filter.clone(),
+        status: options.status.as_deref().map(ToolCallStatus::from),
+    };
+    let output_format: OutputFormat = options.format.parse()?;
+    let mut writer = TimelineWriter::new(stdout, output_format);
 
-    // Apply filters
-    if let Some(tool_name) = &options.filter {
-        calls.retain(|call| call.name == *tool_name);
+    if options.follow {
+        if output_format == OutputFormat::Json {
+            anyhow::bail!("--follow needs --format table or ndjson");
+        }
+        return follow_timeline(
+            &mut writer,
+            &toolcalls,
+            &filter,
+            options.limit,
+            FOLLOW_POLL_INTERVAL,
+        )
+        .await;
     }
 
-    if let Some(status_filter) = &options.status {
-        calls.retain(|call| call.status.to_string() == *status_filter);
+    write_timeline(
+        &mut writer,
+        &toolcalls,
+        &filter,
+        options.limit,
+        TIMELINE_PAGE_SIZE,
+    )
+    .await?;
+    writer.finish()
+}
+
+/// Write the newest `limit` calls, newest first, a page at a time
+async fn write_timeline<W: Write>(
+    writer: &mut TimelineWriter<'_, W>,
+    toolcalls: &ToolCalls,
+    filter: &TimelineFilter,
+    limit: i64,
+    page_size: i64,
+) -> AnyhowResult<()> {
+    let mut cursor = None;
+    let mut remaining = limit;
+    while remaining > 0 {
+        let want = remaining.min(page_size);
+        let page = toolcalls
+            .page_before(filter, cursor, want)
+            .await
+            .context("Failed to query tool calls")?;
+        for call in &page {
+            writer.write(call)?;
+        }
+        writer.flush()?;
+
+        if (page.len() as i64) < want {
+            break;
+        }
+        remaining -= want;
+        cursor = page.last().map(TimelineCursor::from);
     }
+    Ok(())
+}
 
-    // Format and display
-    let output_format: OutputFormat = options.format.parse()?;
-    match output_format {
-        OutputFormat::Table => format_table(stdout, &calls)?,
-        OutputFormat::Json => format_json(stdout, &calls)?,
+/// Write the newest `limit` calls oldest first, then keep writing new ones
+/// as they are inserted
+///
+/// Calls are inserted as pending and completed later, so with a success or
+/// error status filter a call can start to match after it was first seen.
+/// The IDs of such pending calls are kept and checked again on each poll;
+/// they are written once they complete with the wanted status.
+async fn follow_timeline<W: Write>(
+    writer: &mut TimelineWriter<'_, W>,
+    toolcalls: &ToolCalls,
+    filter: &TimelineFilter,
+    limit: i64,
+    poll_interval: Duration,
+) -> AnyhowResult<()> {
+    let mut window = Vec::new();
+    let mut cursor = None;
+    while (window.len() as i64) < limit {
+        let want = (limit - window.len() as i64).min(TIMELINE_PAGE_SIZE);
+        let page = toolcalls
+            .page_before(filter, cursor, want)
+            .await
+            .context("Failed to query tool calls")?;
+        cursor = page.last().map(TimelineCursor::from);
+        let done = (page.len() as i64) < want;
+        window.extend(page);
+        if done {
+            break;
+        }
     }
 
-    Ok(())
+    let mut last_id = window.iter().map(|call| call.id).max().unwrap_or(0);
+    for call in window.iter().rev() {
+        writer.write(call)?;
+    }
+    writer.flush()?;
+    drop(window);
+
+    let track_pending = filter
+        .status
+        .as_ref()
+        .is_some_and(|status| *status != ToolCallStatus::Pending);
+    let inserted_filter = TimelineFilter {
+        name: filter.name.clone(),
+        status: if track_pending {
+            None
+        } else {
+            filter.status.clone()
+        },
+    };
+    let mut pending = BTreeSet::new();
+    if track_pending {
+        // Later calls are seen by the first poll below
+        let pending_filter = TimelineFilter {
+            name: filter.name.clone(),
+            status: Some(ToolCallStatus::Pending),
+        };
+        let mut cursor = None;
+        loop {
+            let page = toolcalls
+                .page_before(&pending_filter, cursor, TIMELINE_PAGE_SIZE)
+                .await
+                .context("Failed to query tool calls")?;
+            pending.extend(page.iter().map(|call| call.id).filter(|&id| id <= last_id));
+            if (page.len() as i64) < TIMELINE_PAGE_SIZE {
+                break;
+            }
+            cursor = page.last().map(TimelineCursor::from);
+        }
+    }
+
+    loop {
+        let page = toolcalls
+            .inserted_after(&inserted_filter, last_id, TIMELINE_PAGE_SIZE)
+            .await
+            .context("Failed to query tool calls")?;
+        if let Some(last) = page.last() {
+            last_id = last.id;
+        }
+        for call in &page {
+            if matches_status(filter, call) {
+                writer.write(call)?;
+            } else if call.status == ToolCallStatus::Pending {
+                pending.insert(call.id);
+            }
+        }
+
+        let mut completed = Vec::new();
+        for &id in &pending {
+            let call = toolcalls
+                .get(id)
+                .await
+                .context("Failed to query tool calls")?;
+            match call {
+                Some(call) if call.status == ToolCallStatus::Pending => {}
+                Some(call) => {
+                    if matches_status(filter, &call) {
+                        writer.write(&call)?;
+                    }
+                    completed.push(id);
+                }
+                None => completed.push(id),
+            }
+        }
+        for id in completed {
+            pending.remove(&id);
+        }
+        writer.flush()?;
+
+        if page.is_empty() {
+            tokio::time::sleep(poll_interval).await;
+        }
+    }
+}
+
+fn matches_status(filter: &TimelineFilter, call: &ToolCall) -> bool {
+    filter
+        .status
+        .as_ref()
+        .map_or(true, |status| *status == call.status)
+}
+
+/// Writes tool calls one at a time in the chosen output format
+struct TimelineWriter<'a, W: Write> {
+    stdout: &'a mut W,
+    format: OutputFormat,
+    rows: usize,
+}
+
+impl<'a, W: Write> TimelineWriter<'a, W> {
+    fn new(stdout: &'a mut W, format: OutputFormat) -> Self {
+        Self {
+            stdout,
+            format,
+            rows: 0,
+        }
+    }
+
+    fn write(&mut self, call: &ToolCall) -> AnyhowResult<()> {
+        match self.format {
+            OutputFormat::Table => {
+                if self.rows == 0 {
+                    write_table_header(self.stdout)?;
+                }
+                write_table_row(self.stdout, call)?;
+            }
+            OutputFormat::Json => {
+                // Same layout as pretty-printing the whole array at once
+                let json = serde_json::to_string_pretty(call)
+                    .context("Failed to serialize tool call to JSON")?;
+                write!(
+                    self.stdout,
+                    "{}",
+                    if self.rows == 0 { "[\n" } else { ",\n" }
+                )?;
+                for (i, line) in json.lines().enumerate() {
+                    if i > 0 {
+                        writeln!(self.stdout)?;
+                    }
+                    write!(self.stdout, "  {}", line)?;
+                }
+            }
+            OutputFormat::Ndjson => {
+                serde_json::to_writer(&mut *self.stdout, call)
+                    .context("Failed to serialize tool call to JSON")?;
+                writeln!(self.stdout)?;
+            }
+        }
+        self.rows += 1;
+        Ok(())
+    }
+
+    fn flush(&mut self) -> AnyhowResult<()> {
+        self.stdout.flush()?;
+        Ok(())
+    }
+
+    /// End the output once all calls have been written
+    fn finish(self) -> AnyhowResult<()> {
+        match self.format {
+            OutputFormat::Table if self.rows == 0 => writeln!(self.stdout, "No tool calls found")?,
+            OutputFormat::Json if self.rows == 0 => writeln!(self.stdout, "[]")?,
+            OutputFormat::Json => writeln!(self.stdout, "\n]")?,
+            OutputFormat::Table | OutputFormat::Ndjson => {}
+        }
+        self.stdout.flush()?;
+        Ok(())
+    }
 }
 
 /// Truncate a string to a maximum length, adding ellipsis if truncated
@@ -92,45 +333,31 @@ fn format_timestamp(timestamp: i64) -> String {
         .unwrap_or_else(|| format!("Invalid timestamp: {}", timestamp))
 }
 
-/// Format tool calls in table format
-fn format_table(stdout: &mut impl Write, calls: &[ToolCall]) -> AnyhowResult<()> {
-    if calls.is_empty() {
-        writeln!(stdout, "No tool calls found")?;
-        return Ok(());
-    }
-
-    // Print header
+/// Print the table header
+fn write_table_header(stdout: &mut impl Write) -> AnyhowResult<()> {
     writeln!(
         stdout,
         "{:<4} {:<20} {:<10} {:>10} {:<20}",
         "ID", "TOOL", "STATUS", "DURATION", "STARTED"
     )?;
-
-    // Print rows
-    for call in calls {
-        let tool_name = truncate_with_ellipsis(&call.name, 20);
-        let status = call.status.to_string();
-        let duration = call
-            .duration_ms
-            .map(|ms| format!("{}ms", ms))
-            .unwrap_or_else(|| String::from("--"));
-        let timestamp = format_timestamp(call.started_at);
-
-        writeln!(
-            stdout,
-            "{:<4} {:<20} {:<10} {:>10} {:<20}",
-            call.id, tool_name, status, duration, timestamp
-        )?;
-    }
-
     Ok(())
 }
 
-/// Format tool calls as JSON
-fn format_json(stdout: &mut impl Write, calls: &[ToolCall]) -> AnyhowResult<()> {
-    let json =
-        serde_json::to_string_pretty(calls).context("Failed to serialize tool calls to JSON")?;
-    writeln!(stdout, "{}", json)?;
+/// Print one tool call as a table row
+fn write_table_row(stdout: &mut impl Write, call: &ToolCall) -> AnyhowResult<()> {
+    let tool_name = truncate_with_ellipsis(&call.name, 20);
+    let status = call.status.to_string();
+    let duration = call
+        .duration_ms
+        .map(|ms| format!("{}ms", ms))
+        .unwrap_or_else(|| String::from("--"));
+    let timestamp = format_timestamp(call.started_at);
+
+    writeln!(
+        stdout,
+        "{:<4} {:<20} {:<10} {:>10} {:<20}",
+        call.id, tool_name, status, duration, timestamp
+    )?;
     Ok(())
 }
 
@@ -156,6 +383,7 @@ mod tests {
             filter: None,
             status: None,
             format: "table".to_string(),
+            follow: false,
         }
     }
 
@@ -329,4 +557,152 @@ mod tests {
         assert!(output.contains("very_long_tool_na..."));
         assert!(!output.contains("very_long_tool_name_that_exceeds_twenty_characters"));
     }
+
+    #[tokio::test]
+    async fn test_timeline_pages() {
+        let (agentfs, _path, _file) = create_test_agentfs().await;
+
+        // Several calls per second, so pages split ties on started_at
+        for i in 0..7 {
+            agentfs
+                .tools
+                .record(
+                    &format!("tool_{}", i),
+                    100 + i / 3,
+                    101 + i / 3,
+                    None,
+                    None,
+                    None,
+                )
+                .await
+                .unwrap();
+        }
+
+        let toolcalls = ToolCalls::from_connection(agentfs.get_connection())
+            .await
+            .unwrap();
+        let mut buf = Vec::new();
+        let mut writer = TimelineWriter::new(&mut buf, OutputFormat::Ndjson);
+        write_timeline(&mut writer, &toolcalls, &TimelineFilter::default(), 6, 2)
+            .await
+            .unwrap();
+        writer.finish().unwrap();
+
+        let names: Vec<String> = String::from_utf8(buf)
+            .unwrap()
+            .lines()
+            .map(|line| serde_json::from_str::<ToolCall>(line).unwrap().name)
+            .collect();
+        let expected: Vec<String> = (1..7).rev().map(|i| format!("tool_{}", i)).collect();
+        assert_eq!(names, expected);
+    }
+
+    #[tokio::test]
+    async fn test_timeline_json_format() {
+        let (agentfs, path, _file) = create_test_agentfs().await;
+
+        agentfs.tools.start("tool_a", None).await.unwrap();
+        agentfs.tools.start("tool_b", None).await.unwrap();
+
+        let mut buf = Vec::new();
+        let options = TimelineOptions {
+            format: "json".to_string(),
+            ..default_options()
+        };
+        show_timeline(&mut buf, &path, &options).await.unwrap();
+
+        let output = String::from_utf8(buf).unwrap();
+        let calls: Vec<ToolCall> = serde_json::from_str(&output).unwrap();
+        assert_eq!(calls.len(), 2);
+        assert_eq!(output, serde_json::to_string_pretty(&calls).unwrap() + "\n");
+    }
+
+    #[tokio::test]
+    async fn test_timeline_follow() {
+        let (agentfs, _path, _file) = create_test_agentfs().await;
+
+        agentfs.tools.start("old_0", None).await.unwrap();
+        agentfs.tools.start("old_1", None).await.unwrap();
+        agentfs.tools.start("old_2", None).await.unwrap();
+
+        let toolcalls = ToolCalls::from_connection(agentfs.get_connection())
+            .await
+            .unwrap();
+        let mut buf = Vec::new();
+        let filter = TimelineFilter::default();
+        let mut writer = TimelineWriter::new(&mut buf, OutputFormat::Ndjson);
+        let follow = follow_timeline(
+            &mut writer,
+            &toolcalls,
+            &filter,
+            2,
+            Duration::from_millis(10),
+        );
+        let insert = async {
+            tokio::time::sleep(Duration::from_millis(50)).await;
+            agentfs.tools.start("new_0", None).await.unwrap();
+            agentfs.tools.start("new_1", None).await.unwrap();
+            tokio::time::sleep(Duration::from_millis(100)).await;
+        };
+        tokio::select! {
+            result = follow => panic!("follow returned: {:?}", result),
+            _ = insert => {}
+        }
+        drop(writer);
+
+        let names: Vec<String> = String::from_utf8(buf)
+            .unwrap()
+            .lines()
+            .map(|line| serde_json::from_str::<ToolCall>(line).unwrap().name)
+            .collect();
+        assert_eq!(names, ["old_1", "old_2", "new_0", "new_1"]);
+    }
+
+    #[tokio::test]
+    async fn test_timeline_follow_status_sees_later_completions() {
+        let (agentfs, _path, _file) = create_test_agentfs().await;
+
+        let slow = agentfs.tools.start("slow", None).await.unwrap();
+        let done = agentfs.tools.start("done", None).await.unwrap();
+        agentfs.tools.success(done, None).await.unwrap();
+
+        let toolcalls = ToolCalls::from_connection(agentfs.get_connection())
+            .await
+            .unwrap();
+        let mut buf = Vec::new();
+        let filter = TimelineFilter {
+            name: None,
+            status: Some(ToolCallStatus::Success),
+        };
+        let mut writer = TimelineWriter::new(&mut buf, OutputFormat::Ndjson);
+        let follow = follow_timeline(
+            &mut writer,
+            &toolcalls,
+            &filter,
+            10,
+            Duration::from_millis(10),
+        );
+        let complete = async {
+            let new = agentfs.tools.start("new", None).await.unwrap();
+            let failed = agentfs.tools.start("failed", None).await.unwrap();
+            tokio::time::sleep(Duration::from_millis(50)).await;
+            agentfs.tools.success(slow, None).await.unwrap();
+            tokio::time::sleep(Duration::from_millis(50)).await;
+            agentfs.tools.error(failed, "boom").await.unwrap();
+            agentfs.tools.success(new, None).await.unwrap();
+            tokio::time::sleep(Duration::from_millis(100)).await;
+        };
+        tokio::select! {
+            result = follow => panic!("follow returned: {:?}", result),
+            _ = complete => {}
+        }
+        drop(writer);
+
+        let names: Vec<String> = String::from_utf8(buf)
+            .unwrap()
+            .lines()
+            .map(|line| serde_json::from_str::<ToolCall>(line).unwrap().name)
+            .collect();
+        assert_eq!(names, ["done", "slow", "new"]);
+    }
 }
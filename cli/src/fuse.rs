@@ -1,26 +1,29 @@
 use agentfs_sdk::error::Error as SdkError;
-use agentfs_sdk::{BoxedFile, FileSystem, Stats};
+use agentfs_sdk::{
+    BoxedDirStream, BoxedFile, DirEntry, FileSystem, FsError, Stats, DIR_STREAM_BATCH,
+};
 use fuser::{
     consts::{
-        FUSE_ASYNC_READ, FUSE_CACHE_SYMLINKS, FUSE_NO_OPENDIR_SUPPORT, FUSE_PARALLEL_DIROPS,
-        FUSE_WRITEBACK_CACHE,
+        FOPEN_CACHE_DIR, FOPEN_KEEP_CACHE, FUSE_ASYNC_READ, FUSE_CACHE_SYMLINKS,
+        FUSE_PARALLEL_DIROPS, FUSE_WRITEBACK_CACHE,
     },
-    FileAttr, FileType, Filesystem, KernelConfig, MountOption, ReplyAttr, ReplyCreate, ReplyData,
-    ReplyDirectory, ReplyDirectoryPlus, ReplyEmpty, ReplyEntry, ReplyOpen, ReplyStatfs, ReplyWrite,
-    Request,
+    FileAttr, FileType, Filesystem, KernelConfig, MountOption, Notifier, ReplyAttr, ReplyCreate,
+    ReplyData, ReplyDirectory, ReplyDirectoryPlus, ReplyEmpty, ReplyEntry, ReplyOpen, ReplyStatfs,
+    ReplyWrite, Request, Session,
 };
 use parking_lot::Mutex;
 use std::{
-    collections::HashMap,
-    ffi::OsStr,
+    collections::{HashMap, VecDeque},
+    ffi::{OsStr, OsString},
+    future::Future,
     path::{Path, PathBuf},
     sync::{
         atomic::{AtomicU64, Ordering},
-        Arc,
+        Arc, OnceLock,
     },
     time::{Duration, SystemTime, UNIX_EPOCH},
 };
-use tokio::runtime::Runtime;
+use tokio::{runtime::Runtime, sync::RwLock};
 
 /// Convert an SDK error to an errno code for FUSE replies.
 ///
@@ -36,9 +39,15 @@ fn error_to_errno(e: &SdkError) -> i32 {
     }
 }
 
-/// Cache entries never expire - we explicitly invalidate on mutations.
-/// This is safe because we are the only writer to the filesystem.
-const TTL: Duration = Duration::MAX;
+/// Default attribute and entry timeout: cache entries never expire and we
+/// explicitly invalidate on mutations. This is safe because we are the only
+/// writer to the filesystem.
+pub const DEFAULT_TTL: Duration = Duration::MAX;
+
+/// Maximum number of background (async read and writeback) requests the
+/// kernel may keep in flight. The kernel default of 12 is too low once
+/// requests are served concurrently.
+const MAX_BACKGROUND: u16 = 64;
 
 /// Options for mounting an agent filesystem via FUSE.
 #[derive(Debug, Clone)]
@@ -55,6 +64,15 @@ pub struct FuseMountOptions {
     pub uid: Option<u32>,
     /// Group ID to report for all files (defaults to current group).
     pub gid: Option<u32>,
+    /// Keep the kernel page cache (and readdir cache) across opens.
+    pub keep_cache: bool,
+    /// How long the kernel may cache file attributes.
+    pub attr_timeout: Duration,
+    /// How long the kernel may cache name lookups.
+    pub entry_timeout: Duration,
+    /// How long the kernel may cache failed name lookups. Zero disables
+    /// negative entries.
+    pub negative_timeout: Duration,
 }
 
 /// Tracks an open file handle
@@ -63,18 +81,99 @@ struct OpenFile {
     file: BoxedFile,
 }
 
-struct AgentFSFuse {
+/// Tracks an open directory handle.
+///
+/// The kernel lists a directory in several readdir calls, each passing the
+/// offset of the last entry it consumed. The handle keeps the directory
+/// stream open between calls, so each call resumes where the previous one
+/// stopped instead of listing the directory again.
+///
+/// Offsets 0 and 1 are "." and ".."; entry `n` of the stream has offset
+/// `n + 2`.
+struct OpenDir {
+    /// Stream over the directory's entries, opened on first use
+    stream: Option<BoxedDirStream>,
+    /// Entries read from the stream but not yet accepted by the kernel
+    pending: VecDeque<DirEntry>,
+    /// Offset of the first pending entry
+    next_offset: i64,
+}
+
+impl OpenDir {
+    fn new() -> Self {
+        Self {
+            stream: None,
+            pending: VecDeque::new(),
+            next_offset: 2,
+        }
+    }
+
+    /// Position the handle at `offset`, restarting the stream if the kernel
+    /// seeks backwards (rewinddir).
+    async fn seek(&mut self, fs: &dyn FileSystem, ino: u64, offset: i64) -> Result<(), SdkError> {
+        let offset = offset.max(2);
+        if offset < self.next_offset {
+            *self = Self::new();
+        }
+        while self.next_offset < offset {
+            if self.peek(fs, ino).await?.is_none() {
+                break;
+            }
+            self.advance();
+        }
+        Ok(())
+    }
+
+    /// The entry at `next_offset`, or `None` at the end of the directory.
+    async fn peek(&mut self, fs: &dyn FileSystem, ino: u64) -> Result<Option<&DirEntry>, SdkError> {
+        if self.pending.is_empty() {
+            if self.stream.is_none() {
+                let stream = fs.opendir_inode(ino as i64).await?;
+                self.stream = Some(stream.ok_or(FsError::NotFound)?);
+            }
+            let stream = self.stream.as_mut().unwrap();
+            self.pending
+                .extend(stream.next_batch(DIR_STREAM_BATCH).await?);
+        }
+        Ok(self.pending.front())
+    }
+
+    /// Mark the entry at `next_offset` as returned to the kernel.
+    fn advance(&mut self) {
+        self.pending.pop_front();
+        self.next_offset += 1;
+    }
+}
+
+/// State shared between the FUSE session thread and the request handlers
+/// running on the Tokio runtime.
+struct FuseState {
     fs: Arc<dyn FileSystem>,
-    runtime: Runtime,
-    path_cache: Arc<Mutex<HashMap<u64, String>>>,
+    path_cache: Mutex<HashMap<u64, String>>,
+    /// Lookup count of each inode, as the kernel counts it: one for every
+    /// entry replied with, until the kernel forgets them
+    lookups: Mutex<HashMap<u64, u64>>,
     /// Maps file handle -> open file state
-    open_files: Arc<Mutex<HashMap<u64, OpenFile>>>,
-    /// Next file handle to allocate
+    open_files: Mutex<HashMap<u64, OpenFile>>,
+    /// Maps directory handle -> open directory state
+    open_dirs: Mutex<HashMap<u64, Arc<tokio::sync::Mutex<OpenDir>>>>,
+    /// Next file or directory handle to allocate
     next_fh: AtomicU64,
     /// User ID to report for all files (set at mount time)
     uid: u32,
     /// Group ID to report for all files (set at mount time)
     gid: u32,
+    /// Reply with FOPEN_KEEP_CACHE / FOPEN_CACHE_DIR on open
+    keep_cache: bool,
+    /// Attribute timeout handed to the kernel
+    attr_ttl: Duration,
+    /// Entry timeout handed to the kernel
+    entry_ttl: Duration,
+    /// Timeout of negative entries handed to the kernel
+    negative_ttl: Duration,
+    /// Channel for pushing cache invalidations to the kernel, set once the
+    /// session is created
+    notifier: OnceLock<Notifier>,
     /// Lossy string representation of the absolute mountpoint path.
     /// This is used to avoid looking up ourselves inside ourselves,
     /// e.g., when we mount an under filesystem `/` at /mntpnt,
@@ -82,6 +181,16 @@ struct AgentFSFuse {
     /// to lookup `/mntpnt` from he under filesystem, which will hit our mountpoint again,
     /// causing a deadlock.
     mountpoint_path: String,
+    /// Orders request handlers against each other. Read-only requests hold
+    /// the lock shared and run concurrently; requests that mutate the
+    /// filesystem hold it exclusively, because the filesystem layers run
+    /// their transactions on a single database connection.
+    op_lock: RwLock<()>,
+}
+
+struct AgentFSFuse {
+    state: Arc<FuseState>,
+    runtime: Runtime,
 }
 
 impl Filesystem for AgentFSFuse {
@@ -95,16 +204,15 @@ impl Filesystem for AgentFSFuse {
     ///   directory, improving performance for parallel file access patterns.
     /// - Cache symlinks: caches readlink responses, avoiding repeated round-trips
     ///   for symlink resolution.
-    /// - No opendir support: skips opendir/releasedir calls since we don't track
-    ///   directory handles, reducing round-trips for directory operations.
+    ///
+    /// The background request limit is raised so that the kernel actually
+    /// keeps enough requests in flight for the concurrent dispatch to matter.
     fn init(&mut self, _req: &Request, config: &mut KernelConfig) -> Result<(), libc::c_int> {
-        let _ = config.add_capabilities(
-            FUSE_ASYNC_READ
-                | FUSE_WRITEBACK_CACHE
-                | FUSE_PARALLEL_DIROPS
-                | FUSE_CACHE_SYMLINKS
-                | FUSE_NO_OPENDIR_SUPPORT,
-        );
+        let capabilities =
+            FUSE_ASYNC_READ | FUSE_WRITEBACK_CACHE | FUSE_PARALLEL_DIROPS | FUSE_CACHE_SYMLINKS;
+        let _ = config.add_capabilities(capabilities);
+        let _ = config.set_max_background(MAX_BACKGROUND);
+        let _ = config.set_congestion_threshold(MAX_BACKGROUND * 3 / 4);
         Ok(())
     }
 
@@ -114,47 +222,58 @@ impl Filesystem for AgentFSFuse {
 
     /// Looks up a directory entry by name within a parent directory.
     ///
-    /// Resolves `name` under the directory identified by `parent` inode, stats the
-    /// resulting path, and caches the inode-to-path mapping on success.
+    /// Resolves `name` directly under the `parent` inode, without walking the
+    /// full path again, and caches the inode-to-path mapping on success for
+    /// the path-based mutating operations. Misses are replied as negative
+    /// entries, so the kernel stops asking for names that don't exist, such
+    /// as the `PATH` and include directory probes of build tools.
     fn lookup(&mut self, _req: &Request, parent: u64, name: &OsStr, reply: ReplyEntry) {
-        let Some(path) = self.lookup_path(parent, name) else {
+        let Some(path) = self.state.lookup_path(parent, name) else {
             reply.error(libc::ENOENT);
             return;
         };
-        let fs = self.fs.clone();
-        let (result, path) = self.runtime.block_on(async move {
-            let result = fs.lstat(&path).await;
-            (result, path)
-        });
-        match result {
-            Ok(Some(stats)) => {
-                let attr = fillattr(&stats, self.uid, self.gid);
-                self.add_path(attr.ino, path);
-                reply.entry(&TTL, &attr, 0);
+        let Some(name) = name.to_str().map(str::to_owned) else {
+            reply.error(libc::ENOENT);
+            return;
+        };
+        self.spawn_shared(move |state| async move {
+            match state.fs.lookup(parent as i64, &name).await {
+                Ok(Some(stats)) => {
+                    let attr = fillattr(&stats, state.uid, state.gid);
+                    state.add_entry(attr.ino, path);
+                    reply.entry(&state.entry_ttl, &attr, 0);
+                }
+                Ok(None) if state.negative_ttl.is_zero() => reply.error(libc::ENOENT),
+                Ok(None) => reply.entry(&state.negative_ttl, &negative_attr(), 0),
+                Err(e) => reply.error(error_to_errno(&e)),
             }
-            Ok(None) => reply.error(libc::ENOENT),
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+        });
+    }
+
+    /// Drops lookups the kernel no longer holds.
+    ///
+    /// Runs exclusively, as it may drop filesystem state a concurrent lookup
+    /// of the same inode is about to hand out again.
+    fn forget(&mut self, _req: &Request, ino: u64, nlookup: u64) {
+        self.spawn_exclusive(move |state| async move {
+            state.forget(ino, nlookup);
+        });
     }
 
     /// Retrieves file attributes for a given inode.
     ///
     /// Returns metadata (size, permissions, timestamps, etc.) for the file or
-    /// directory identified by `ino`. Root inode (1) is handled specially.
+    /// directory identified by `ino`, addressed by inode rather than path.
     fn getattr(&mut self, _req: &Request, ino: u64, _fh: Option<u64>, reply: ReplyAttr) {
-        let Some(path) = self.get_path(ino) else {
-            reply.error(libc::ENOENT);
-            return;
-        };
-
-        let fs = self.fs.clone();
-        let result = self.runtime.block_on(async move { fs.lstat(&path).await });
-
-        match result {
-            Ok(Some(stats)) => reply.attr(&TTL, &fillattr(&stats, self.uid, self.gid)),
-            Ok(None) => reply.error(libc::ENOENT),
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+        self.spawn_shared(move |state| async move {
+            match state.fs.getattr(ino as i64).await {
+                Ok(Some(stats)) => {
+                    reply.attr(&state.attr_ttl, &fillattr(&stats, state.uid, state.gid))
+                }
+                Ok(None) => reply.error(libc::ENOENT),
+                Err(e) => reply.error(error_to_errno(&e)),
+            }
+        });
     }
 
     /// Reads the target of a symbolic link.
@@ -162,21 +281,17 @@ impl Filesystem for AgentFSFuse {
     /// Returns the path that the symlink points to. This is called by operations
     /// like `ls -l` to display symlink targets.
     fn readlink(&mut self, _req: &Request, ino: u64, reply: ReplyData) {
-        let Some(path) = self.get_path(ino) else {
+        let Some(path) = self.state.get_path(ino) else {
             reply.error(libc::ENOENT);
             return;
         };
-
-        let fs = self.fs.clone();
-        let result = self
-            .runtime
-            .block_on(async move { fs.readlink(&path).await });
-
-        match result {
-            Ok(Some(target)) => reply.data(target.as_bytes()),
-            Ok(None) => reply.error(libc::ENOENT),
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+        self.spawn_shared(move |state| async move {
+            match state.fs.readlink(&path).await {
+                Ok(Some(target)) => reply.data(target.as_bytes()),
+                Ok(None) => reply.error(libc::ENOENT),
+                Err(e) => reply.error(error_to_errno(&e)),
+            }
+        });
     }
 
     /// Sets file attributes, handling truncate and chmod operations.
@@ -201,320 +316,260 @@ impl Filesystem for AgentFSFuse {
         _flags: Option<u32>,
         reply: ReplyAttr,
     ) {
-        // Handle chmod
-        if let Some(new_mode) = mode {
-            let Some(path) = self.path_cache.lock().get(&ino).cloned() else {
-                reply.error(libc::ENOENT);
-                return;
-            };
+        let Some(path) = self.state.get_path(ino) else {
+            reply.error(libc::ENOENT);
+            return;
+        };
 
-            let fs = self.fs.clone();
-            let result = self
-                .runtime
-                .block_on(async move { fs.chmod(&path, new_mode).await });
+        // Use file handle if available (ftruncate)
+        let file = match (size, fh) {
+            (Some(_), Some(fh)) => match self.state.get_file(fh) {
+                Some(file) => Some(file),
+                None => {
+                    reply.error(libc::EBADF);
+                    return;
+                }
+            },
+            _ => None,
+        };
 
-            if let Err(e) = result {
-                reply.error(error_to_errno(&e));
-                return;
+        self.spawn_exclusive(move |state| async move {
+            // Handle chmod
+            if let Some(new_mode) = mode {
+                if let Err(e) = state.fs.chmod(&path, new_mode).await {
+                    reply.error(error_to_errno(&e));
+                    return;
+                }
             }
-        }
 
-        // Handle truncate
-        if let Some(new_size) = size {
-            let result = if let Some(fh) = fh {
-                // Use file handle if available (ftruncate)
-                let file = {
-                    let open_files = self.open_files.lock();
-                    open_files.get(&fh).map(|f| f.file.clone())
+            // Handle truncate
+            if let Some(new_size) = size {
+                let result = match file {
+                    Some(file) => file.truncate(new_size).await,
+                    // Open file and truncate via file handle
+                    None => match state.fs.open(&path).await {
+                        Ok(file) => file.truncate(new_size).await,
+                        Err(e) => Err(e),
+                    },
                 };
 
-                if let Some(file) = file {
-                    self.runtime
-                        .block_on(async move { file.truncate(new_size).await })
-                } else {
-                    reply.error(libc::EBADF);
+                if let Err(e) = result {
+                    reply.error(error_to_errno(&e));
                     return;
                 }
-            } else {
-                // Open file and truncate via file handle
-                let Some(path) = self.path_cache.lock().get(&ino).cloned() else {
-                    reply.error(libc::ENOENT);
-                    return;
-                };
-
-                let fs = self.fs.clone();
-                self.runtime.block_on(async move {
-                    let file = fs.open(&path).await?;
-                    file.truncate(new_size).await
-                })
-            };
-
-            if let Err(e) = result {
-                reply.error(error_to_errno(&e));
-                return;
             }
-        }
-
-        // Return updated attributes
-        let Some(path) = self.get_path(ino) else {
-            reply.error(libc::ENOENT);
-            return;
-        };
-
-        let fs = self.fs.clone();
-        let result = self.runtime.block_on(async move { fs.stat(&path).await });
 
-        match result {
-            Ok(Some(stats)) => reply.attr(&TTL, &fillattr(&stats, self.uid, self.gid)),
-            Ok(None) => reply.error(libc::ENOENT),
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+            // Return updated attributes
+            match state.fs.getattr(ino as i64).await {
+                Ok(Some(stats)) => {
+                    reply.attr(&state.attr_ttl, &fillattr(&stats, state.uid, state.gid))
+                }
+                Ok(None) => reply.error(libc::ENOENT),
+                Err(e) => reply.error(error_to_errno(&e)),
+            }
+        });
     }
 
     // ─────────────────────────────────────────────────────────────
     // Directory Operations
     // ─────────────────────────────────────────────────────────────
 
+    /// Opens a directory.
+    ///
+    /// Allocates a directory handle that keeps the listing's position across
+    /// readdir calls. When caches are kept, also lets the kernel cache the
+    /// directory's readdir results.
+    fn opendir(&mut self, _req: &Request, _ino: u64, _flags: i32, reply: ReplyOpen) {
+        let fh = self.state.alloc_fh();
+        self.state
+            .open_dirs
+            .lock()
+            .insert(fh, Arc::new(tokio::sync::Mutex::new(OpenDir::new())));
+        let flags = if self.state.keep_cache {
+            FOPEN_KEEP_CACHE | FOPEN_CACHE_DIR
+        } else {
+            0
+        };
+        reply.opened(fh, flags);
+    }
+
+    /// Releases a directory handle.
+    fn releasedir(&mut self, _req: &Request, _ino: u64, fh: u64, _flags: i32, reply: ReplyEmpty) {
+        self.state.open_dirs.lock().remove(&fh);
+        reply.ok();
+    }
+
     /// Reads directory entries for the given inode.
     ///
     /// Returns "." and ".." entries followed by the directory contents.
     /// Each entry's inode is cached for subsequent lookups.
     ///
-    /// Uses readdir_plus to fetch entries with stats in a single query,
-    /// avoiding N+1 database queries.
+    /// Entries come from the directory handle's stream, which resumes at
+    /// `offset` instead of listing the whole directory on every call.
     fn readdir(
         &mut self,
         _req: &Request,
         ino: u64,
-        _fh: u64,
+        fh: u64,
         offset: i64,
         mut reply: ReplyDirectory,
     ) {
-        let Some(path) = self.get_path(ino) else {
+        let Some(path) = self.state.get_path(ino) else {
             reply.error(libc::ENOENT);
             return;
         };
+        let dir = self.state.get_dir(fh);
+        self.spawn_shared(move |state| async move {
+            let mut dir = dir.lock().await;
 
-        let fs = self.fs.clone();
-        let (entries_result, path) = self.runtime.block_on(async move {
-            let result = fs.readdir_plus(&path).await;
-            (result, path)
-        });
-
-        let entries = match entries_result {
-            Ok(Some(entries)) => entries,
-            Ok(None) => {
-                reply.error(libc::ENOENT);
-                return;
-            }
-            Err(e) => {
-                reply.error(error_to_errno(&e));
+            if offset < 1 && reply.add(ino, 1, FileType::Directory, ".") {
+                reply.ok();
                 return;
             }
-        };
-
-        // Determine parent inode for ".." entry
-        let parent_ino = if ino == 1 {
-            1 // Root's parent is itself
-        } else {
-            let parent_path = Path::new(&path)
-                .parent()
-                .map(|p| {
-                    let s = p.to_string_lossy().to_string();
-                    if s.is_empty() {
-                        "/".to_string()
+            if offset < 2 {
+                // Determine parent inode for ".."
+                let parent_ino = if ino == 1 {
+                    1 // Root's parent is itself
+                } else {
+                    let parent_path = parent_path(&path);
+                    if parent_path == "/" {
+                        1
                     } else {
-                        s
+                        match state.fs.stat(&parent_path).await {
+                            Ok(Some(stats)) => stats.ino as u64,
+                            _ => 1, // Fallback to root if parent lookup fails
+                        }
                     }
-                })
-                .unwrap_or_else(|| "/".to_string());
-
-            if parent_path == "/" {
-                1
-            } else {
-                let fs = self.fs.clone();
-                match self
-                    .runtime
-                    .block_on(async move { fs.stat(&parent_path).await })
-                {
-                    Ok(Some(stats)) => stats.ino as u64,
-                    _ => 1, // Fallback to root if parent lookup fails
+                };
+                if reply.add(parent_ino, 2, FileType::Directory, "..") {
+                    reply.ok();
+                    return;
                 }
             }
-        };
-
-        let mut all_entries = vec![
-            (ino, FileType::Directory, "."),
-            (parent_ino, FileType::Directory, ".."),
-        ];
-
-        // Process entries with stats already available (no N+1 queries!)
-        for entry in &entries {
-            let entry_path = if path == "/" {
-                format!("/{}", entry.name)
-            } else {
-                format!("{}/{}", path, entry.name)
-            };
 
-            let kind = if entry.stats.is_directory() {
-                FileType::Directory
-            } else if entry.stats.is_symlink() {
-                FileType::Symlink
-            } else {
-                FileType::RegularFile
-            };
+            if let Err(e) = dir.seek(state.fs.as_ref(), ino, offset).await {
+                reply.error(error_to_errno(&e));
+                return;
+            }
+            loop {
+                let entry_offset = dir.next_offset + 1;
+                let entry = match dir.peek(state.fs.as_ref(), ino).await {
+                    Ok(Some(entry)) => entry,
+                    Ok(None) => break,
+                    Err(e) => {
+                        reply.error(error_to_errno(&e));
+                        return;
+                    }
+                };
 
-            self.add_path(entry.stats.ino as u64, entry_path);
-            all_entries.push((entry.stats.ino as u64, kind, entry.name.as_str()));
-        }
+                let kind = if entry.stats.is_directory() {
+                    FileType::Directory
+                } else if entry.stats.is_symlink() {
+                    FileType::Symlink
+                } else {
+                    FileType::RegularFile
+                };
+                let entry_ino = entry.stats.ino as u64;
+                state.add_path(entry_ino, child_path(&path, &entry.name));
 
-        for (i, entry) in all_entries.iter().enumerate().skip(offset as usize) {
-            if reply.add(entry.0, (i + 1) as i64, entry.1, entry.2) {
-                break;
+                if reply.add(entry_ino, entry_offset, kind, &entry.name) {
+                    break;
+                }
+                dir.advance();
             }
-        }
-        reply.ok();
+            reply.ok();
+        });
     }
 
     /// Reads directory entries with full attributes for the given inode.
     ///
     /// This is an optimized version that returns both directory entries and
     /// their attributes in a single call, reducing kernel/userspace round trips.
-    /// Uses readdir_plus to fetch entries with stats in a single database query.
+    /// Entries and their stats come from the directory handle's stream, like
+    /// `readdir`.
     fn readdirplus(
         &mut self,
         _req: &Request,
         ino: u64,
-        _fh: u64,
+        fh: u64,
         offset: i64,
         mut reply: ReplyDirectoryPlus,
     ) {
-        let Some(path) = self.get_path(ino) else {
+        let Some(path) = self.state.get_path(ino) else {
             reply.error(libc::ENOENT);
             return;
         };
-
-        let fs = self.fs.clone();
-        let (entries_result, path) = self.runtime.block_on(async move {
-            let result = fs.readdir_plus(&path).await;
-            (result, path)
-        });
-
-        let entries = match entries_result {
-            Ok(Some(entries)) => entries,
-            Ok(None) => {
-                reply.error(libc::ENOENT);
-                return;
-            }
-            Err(e) => {
-                reply.error(error_to_errno(&e));
-                return;
-            }
-        };
-
-        // Get current directory stats for "."
-        let fs = self.fs.clone();
-        let path_for_stat = path.clone();
-        let dir_stats = self
-            .runtime
-            .block_on(async move { fs.stat(&path_for_stat).await })
-            .ok()
-            .flatten();
-
-        // Determine parent inode and stats for ".." entry
-        let (parent_ino, parent_stats) = if ino == 1 {
-            (1u64, dir_stats.clone()) // Root's parent is itself
-        } else {
-            let parent_path = Path::new(&path)
-                .parent()
-                .map(|p| {
-                    let s = p.to_string_lossy().to_string();
-                    if s.is_empty() {
-                        "/".to_string()
+        let dir = self.state.get_dir(fh);
+        self.spawn_shared(move |state| async move {
+            let mut dir = dir.lock().await;
+            let uid = state.uid;
+            let gid = state.gid;
+
+            // Stats for "." and ".." are only needed on the first call
+            if offset < 2 {
+                let dir_stats = state.fs.getattr(ino as i64).await.ok().flatten();
+                let (parent_ino, parent_stats) = if ino == 1 {
+                    (1u64, dir_stats.clone()) // Root's parent is itself
+                } else {
+                    let parent_path = parent_path(&path);
+                    let parent_stats = state.fs.stat(&parent_path).await.ok().flatten();
+                    if parent_path == "/" {
+                        (1u64, parent_stats)
                     } else {
-                        s
+                        let parent_ino = parent_stats.as_ref().map(|s| s.ino as u64).unwrap_or(1);
+                        (parent_ino, parent_stats)
                     }
-                })
-                .unwrap_or_else(|| "/".to_string());
-
-            if parent_path == "/" {
-                let fs = self.fs.clone();
-                let parent_stats = self
-                    .runtime
-                    .block_on(async move { fs.stat(&parent_path).await })
-                    .ok()
-                    .flatten();
-                (1u64, parent_stats)
-            } else {
-                let fs = self.fs.clone();
-                let parent_stats = self
-                    .runtime
-                    .block_on(async move { fs.stat(&parent_path).await })
-                    .ok()
-                    .flatten();
-                let parent_ino = parent_stats.as_ref().map(|s| s.ino as u64).unwrap_or(1);
-                (parent_ino, parent_stats)
-            }
-        };
-
-        // Build the entries list with full attributes
-        let uid = self.uid;
-        let gid = self.gid;
-
-        let mut offset_counter = 0i64;
+                };
 
-        // Add "." entry
-        if offset <= offset_counter {
-            if let Some(ref stats) = dir_stats {
-                let attr = fillattr(stats, uid, gid);
-                if reply.add(ino, offset_counter + 1, ".", &TTL, &attr, 0) {
-                    reply.ok();
-                    return;
+                if offset < 1 {
+                    if let Some(ref stats) = dir_stats {
+                        let attr = fillattr(stats, uid, gid);
+                        if reply.add(ino, 1, ".", &state.entry_ttl, &attr, 0) {
+                            reply.ok();
+                            return;
+                        }
+                    }
                 }
-            }
-        }
-        offset_counter += 1;
-
-        // Add ".." entry
-        if offset <= offset_counter {
-            if let Some(ref stats) = parent_stats {
-                let attr = fillattr(stats, uid, gid);
-                if reply.add(parent_ino, offset_counter + 1, "..", &TTL, &attr, 0) {
-                    reply.ok();
-                    return;
+                if let Some(ref stats) = parent_stats {
+                    let attr = fillattr(stats, uid, gid);
+                    if reply.add(parent_ino, 2, "..", &state.entry_ttl, &attr, 0) {
+                        reply.ok();
+                        return;
+                    }
                 }
             }
-        }
-        offset_counter += 1;
 
-        // Add directory entries with their attributes
-        for entry in &entries {
-            if offset <= offset_counter {
-                let entry_path = if path == "/" {
-                    format!("/{}", entry.name)
-                } else {
-                    format!("{}/{}", path, entry.name)
+            if let Err(e) = dir.seek(state.fs.as_ref(), ino, offset).await {
+                reply.error(error_to_errno(&e));
+                return;
+            }
+            loop {
+                let entry_offset = dir.next_offset + 1;
+                let entry = match dir.peek(state.fs.as_ref(), ino).await {
+                    Ok(Some(entry)) => entry,
+                    Ok(None) => break,
+                    Err(e) => {
+                        reply.error(error_to_errno(&e));
+                        return;
+                    }
                 };
 
                 let attr = fillattr(&entry.stats, uid, gid);
-                self.add_path(entry.stats.ino as u64, entry_path);
-
                 if reply.add(
-                    entry.stats.ino as u64,
-                    offset_counter + 1,
+                    attr.ino,
+                    entry_offset,
                     &entry.name,
-                    &TTL,
+                    &state.entry_ttl,
                     &attr,
                     0,
                 ) {
-                    reply.ok();
-                    return;
+                    break;
                 }
+                state.add_entry(attr.ino, child_path(&path, &entry.name));
+                dir.advance();
             }
-            offset_counter += 1;
-        }
-
-        reply.ok();
+            reply.ok();
+        });
     }
 
     /// Creates a new directory.
@@ -530,42 +585,31 @@ impl Filesystem for AgentFSFuse {
         _umask: u32,
         reply: ReplyEntry,
     ) {
-        let Some(path) = self.lookup_path(parent, name) else {
+        let Some(path) = self.state.lookup_path(parent, name) else {
             reply.error(libc::ENOENT);
             return;
         };
-
-        let fs = self.fs.clone();
-        let (result, path) = self.runtime.block_on(async move {
-            let result = fs.mkdir(&path).await;
-            (result, path)
-        });
-
-        if let Err(e) = result {
-            reply.error(error_to_errno(&e));
-            return;
-        }
-
-        // Get the new directory's stats
-        let fs = self.fs.clone();
-        let (stat_result, path) = self.runtime.block_on(async move {
-            let result = fs.stat(&path).await;
-            (result, path)
-        });
-
-        match stat_result {
-            Ok(Some(stats)) => {
-                let attr = fillattr(&stats, self.uid, self.gid);
-                self.add_path(attr.ino, path);
-                reply.entry(&TTL, &attr, 0);
-            }
-            Ok(None) => {
-                reply.error(libc::ENOENT);
-            }
-            Err(e) => {
+        self.spawn_exclusive(move |state| async move {
+            if let Err(e) = state.fs.mkdir(&path).await {
                 reply.error(error_to_errno(&e));
+                return;
             }
-        }
+
+            // Get the new directory's stats
+            match state.fs.lstat(&path).await {
+                Ok(Some(stats)) => {
+                    let attr = fillattr(&stats, state.uid, state.gid);
+                    state.add_entry(attr.ino, path);
+                    reply.entry(&state.entry_ttl, &attr, 0);
+                }
+                Ok(None) => {
+                    reply.error(libc::ENOENT);
+                }
+                Err(e) => {
+                    reply.error(error_to_errno(&e));
+                }
+            }
+        });
     }
 
     /// Removes an empty directory.
@@ -573,70 +617,55 @@ impl Filesystem for AgentFSFuse {
     /// Verifies the target is a directory and is empty before removal.
     /// Returns `ENOTDIR` if not a directory, `ENOTEMPTY` if not empty.
     fn rmdir(&mut self, _req: &Request, parent: u64, name: &OsStr, reply: ReplyEmpty) {
-        let Some(path) = self.lookup_path(parent, name) else {
+        let Some(path) = self.state.lookup_path(parent, name) else {
             reply.error(libc::ENOENT);
             return;
         };
+        self.spawn_exclusive(move |state| async move {
+            // Verify target is a directory
+            let stats = match state.fs.lstat(&path).await {
+                Ok(Some(s)) => s,
+                Ok(None) => {
+                    reply.error(libc::ENOENT);
+                    return;
+                }
+                Err(e) => {
+                    reply.error(error_to_errno(&e));
+                    return;
+                }
+            };
 
-        // Verify target is a directory
-        let fs = self.fs.clone();
-        let (stat_result, path) = self.runtime.block_on(async move {
-            let result = fs.lstat(&path).await;
-            (result, path)
-        });
-
-        let stats = match stat_result {
-            Ok(Some(s)) => s,
-            Ok(None) => {
-                reply.error(libc::ENOENT);
+            if !stats.is_directory() {
+                reply.error(libc::ENOTDIR);
                 return;
             }
-            Err(e) => {
-                reply.error(error_to_errno(&e));
-                return;
-            }
-        };
 
-        if !stats.is_directory() {
-            reply.error(libc::ENOTDIR);
-            return;
-        }
-
-        // Verify directory is empty
-        let fs = self.fs.clone();
-        let (readdir_result, path) = self.runtime.block_on(async move {
-            let result = fs.readdir(&path).await;
-            (result, path)
-        });
-
-        match readdir_result {
-            Ok(Some(entries)) if !entries.is_empty() => {
-                reply.error(libc::ENOTEMPTY);
-                return;
-            }
-            Ok(None) => {
-                reply.error(libc::ENOENT);
-                return;
-            }
-            Err(e) => {
-                reply.error(error_to_errno(&e));
-                return;
+            // Verify directory is empty
+            match state.fs.readdir(&path).await {
+                Ok(Some(entries)) if !entries.is_empty() => {
+                    reply.error(libc::ENOTEMPTY);
+                    return;
+                }
+                Ok(None) => {
+                    reply.error(libc::ENOENT);
+                    return;
+                }
+                Err(e) => {
+                    reply.error(error_to_errno(&e));
+                    return;
+                }
+                Ok(Some(_)) => {} // Empty directory, proceed
             }
-            Ok(Some(_)) => {} // Empty directory, proceed
-        }
-
-        // Remove the directory
-        let ino = stats.ino as u64;
-        let fs = self.fs.clone();
-        let result = self.runtime.block_on(async move { fs.remove(&path).await });
 
-        match result {
-            Ok(()) => {
-                self.drop_path(ino);
-                reply.ok();
+            // Remove the directory
+            match state.fs.remove(&path).await {
+                Ok(()) => {
+                    state.drop_path(stats.ino as u64);
+                    reply.ok();
+                }
+                Err(e) => reply.error(error_to_errno(&e)),
             }
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+        });
     }
 
     // ─────────────────────────────────────────────────────────────
@@ -657,32 +686,27 @@ impl Filesystem for AgentFSFuse {
         _flags: i32,
         reply: ReplyCreate,
     ) {
-        let Some(path) = self.lookup_path(parent, name) else {
+        let Some(path) = self.state.lookup_path(parent, name) else {
             reply.error(libc::ENOENT);
             return;
         };
+        self.spawn_exclusive(move |state| async move {
+            // Create file with mode, get stats and file handle in one operation
+            match state.fs.create_file(&path, mode).await {
+                Ok((stats, file)) => {
+                    let attr = fillattr(&stats, state.uid, state.gid);
+                    state.add_entry(attr.ino, path);
 
-        // Create file with mode, get stats and file handle in one operation
-        let fs = self.fs.clone();
-        let path_for_create = path.clone();
-        let result = self
-            .runtime
-            .block_on(async move { fs.create_file(&path_for_create, mode).await });
-
-        match result {
-            Ok((stats, file)) => {
-                let attr = fillattr(&stats, self.uid, self.gid);
-                self.add_path(attr.ino, path);
-
-                let fh = self.alloc_fh();
-                self.open_files.lock().insert(fh, OpenFile { file });
+                    let fh = state.alloc_fh();
+                    state.open_files.lock().insert(fh, OpenFile { file });
 
-                reply.created(&TTL, &attr, 0, fh, 0);
-            }
-            Err(e) => {
-                reply.error(error_to_errno(&e));
+                    reply.created(&state.entry_ttl, &attr, 0, fh, state.open_flags());
+                }
+                Err(e) => {
+                    reply.error(error_to_errno(&e));
+                }
             }
-        }
+        });
     }
 
     /// Creates a symbolic link.
@@ -696,7 +720,7 @@ impl Filesystem for AgentFSFuse {
         target: &Path,
         reply: ReplyEntry,
     ) {
-        let Some(path) = self.lookup_path(parent, link_name) else {
+        let Some(path) = self.state.lookup_path(parent, link_name) else {
             reply.error(libc::ENOENT);
             return;
         };
@@ -706,38 +730,28 @@ impl Filesystem for AgentFSFuse {
             return;
         };
 
-        let fs = self.fs.clone();
         let target_owned = target_str.to_string();
-        let (result, path) = self.runtime.block_on(async move {
-            let result = fs.symlink(&target_owned, &path).await;
-            (result, path)
-        });
-
-        if let Err(e) = result {
-            reply.error(error_to_errno(&e));
-            return;
-        }
-
-        // Get the new symlink's stats
-        let fs = self.fs.clone();
-        let (stat_result, path) = self.runtime.block_on(async move {
-            let result = fs.lstat(&path).await;
-            (result, path)
-        });
-
-        match stat_result {
-            Ok(Some(stats)) => {
-                let attr = fillattr(&stats, self.uid, self.gid);
-                self.add_path(attr.ino, path);
-                reply.entry(&TTL, &attr, 0);
-            }
-            Ok(None) => {
-                reply.error(libc::ENOENT);
-            }
-            Err(e) => {
+        self.spawn_exclusive(move |state| async move {
+            if let Err(e) = state.fs.symlink(&target_owned, &path).await {
                 reply.error(error_to_errno(&e));
+                return;
             }
-        }
+
+            // Get the new symlink's stats
+            match state.fs.lstat(&path).await {
+                Ok(Some(stats)) => {
+                    let attr = fillattr(&stats, state.uid, state.gid);
+                    state.add_entry(attr.ino, path);
+                    reply.entry(&state.entry_ttl, &attr, 0);
+                }
+                Ok(None) => {
+                    reply.error(libc::ENOENT);
+                }
+                Err(e) => {
+                    reply.error(error_to_errno(&e));
+                }
+            }
+        });
     }
 
     /// Creates a hard link.
@@ -753,107 +767,97 @@ impl Filesystem for AgentFSFuse {
         reply: ReplyEntry,
     ) {
         // Get the path for the source inode
-        let Some(oldpath) = self.get_path(ino) else {
+        let Some(oldpath) = self.state.get_path(ino) else {
             reply.error(libc::ENOENT);
             return;
         };
 
         // Get the path for the new link
-        let Some(newpath) = self.lookup_path(newparent, newname) else {
+        let Some(newpath) = self.state.lookup_path(newparent, newname) else {
             reply.error(libc::ENOENT);
             return;
         };
 
-        let fs = self.fs.clone();
-        let (result, newpath) = self.runtime.block_on(async move {
-            let result = fs.link(&oldpath, &newpath).await;
-            (result, newpath)
-        });
-
-        if let Err(e) = result {
-            reply.error(error_to_errno(&e));
-            return;
-        }
-
-        // Get the new link's stats
-        let fs = self.fs.clone();
-        let (stat_result, newpath) = self.runtime.block_on(async move {
-            let result = fs.lstat(&newpath).await;
-            (result, newpath)
-        });
-
-        match stat_result {
-            Ok(Some(stats)) => {
-                let attr = fillattr(&stats, self.uid, self.gid);
-                self.add_path(attr.ino, newpath);
-                reply.entry(&TTL, &attr, 0);
-            }
-            Ok(None) => {
-                reply.error(libc::ENOENT);
-            }
-            Err(e) => {
+        self.spawn_exclusive(move |state| async move {
+            if let Err(e) = state.fs.link(&oldpath, &newpath).await {
                 reply.error(error_to_errno(&e));
+                return;
             }
-        }
+
+            // Get the new link's stats
+            match state.fs.lstat(&newpath).await {
+                Ok(Some(stats)) => {
+                    let attr = fillattr(&stats, state.uid, state.gid);
+                    state.add_entry(attr.ino, newpath);
+                    reply.entry(&state.entry_ttl, &attr, 0);
+                }
+                Ok(None) => {
+                    reply.error(libc::ENOENT);
+                }
+                Err(e) => {
+                    reply.error(error_to_errno(&e));
+                }
+            }
+        });
     }
 
     /// Removes a file (unlinks it from the directory).
     ///
     /// Gets the file's inode before removal to clean up the path cache.
     fn unlink(&mut self, _req: &Request, parent: u64, name: &OsStr, reply: ReplyEmpty) {
-        let Some(path) = self.lookup_path(parent, name) else {
+        let Some(path) = self.state.lookup_path(parent, name) else {
             reply.error(libc::ENOENT);
             return;
         };
+        self.spawn_exclusive(move |state| async move {
+            // Get inode before removing so we can uncache
+            let stats = match state.fs.lstat(&path).await {
+                Ok(Some(s)) => s,
+                Ok(None) => {
+                    reply.error(libc::ENOENT);
+                    return;
+                }
+                Err(e) => {
+                    reply.error(error_to_errno(&e));
+                    return;
+                }
+            };
 
-        // Get inode before removing so we can uncache
-        let fs = self.fs.clone();
-        let (stat_result, path) = self.runtime.block_on(async move {
-            let result = fs.lstat(&path).await;
-            (result, path)
-        });
-
-        let stats = match &stat_result {
-            Ok(Some(s)) => s,
-            Ok(None) => {
-                reply.error(libc::ENOENT);
-                return;
-            }
-            Err(e) => {
-                reply.error(error_to_errno(e));
+            if stats.is_directory() {
+                reply.error(libc::EISDIR);
                 return;
             }
-        };
-
-        if stats.is_directory() {
-            reply.error(libc::EISDIR);
-            return;
-        }
 
-        let ino = stats.ino as u64;
-        let nlink = stats.nlink;
-
-        let fs = self.fs.clone();
-        let result = self.runtime.block_on(async move { fs.remove(&path).await });
+            match state.fs.remove(&path).await {
+                Ok(()) => {
+                    // Only drop from path_cache if this was the last link.
+                    // If nlink > 1, there are other hard links that still reference
+                    // this inode, and the path_cache entry points to one of them.
+                    if stats.nlink <= 1 {
+                        state.drop_path(stats.ino as u64);
+                    }
+                    reply.ok();
 
-        match result {
-            Ok(()) => {
-                // Only drop from path_cache if this was the last link.
-                // If nlink > 1, there are other hard links that still reference
-                // this inode, and the path_cache entry points to one of them.
-                if nlink <= 1 {
-                    self.drop_path(ino);
+                    // The other links still carry the old link count
+                    if stats.nlink > 1 {
+                        state.invalidate_inode(stats.ino as u64);
+                    }
                 }
-                reply.ok();
+                Err(e) => reply.error(error_to_errno(&e)),
             }
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+        });
     }
 
     /// Renames a file or directory.
     ///
     /// Moves `name` from `parent` to `newname` under `newparent`. Updates the
     /// path cache accordingly, removing any replaced destination entry.
+    ///
+    /// Renaming a directory in an overlay copies it into the delta, which
+    /// gives the directories below it new inode numbers, so once the reply is
+    /// sent the kernel is told to drop its cached dentries for the moved
+    /// subtree. A replaced destination is invalidated as well, since other
+    /// hard links to it keep cached attributes with the old link count.
     fn rename(
         &mut self,
         _req: &Request,
@@ -864,56 +868,59 @@ impl Filesystem for AgentFSFuse {
         _flags: u32,
         reply: ReplyEmpty,
     ) {
-        let Some(from_path) = self.lookup_path(parent, name) else {
+        let Some(from_path) = self.state.lookup_path(parent, name) else {
             reply.error(libc::ENOENT);
             return;
         };
 
-        let Some(to_path) = self.lookup_path(newparent, newname) else {
+        let Some(to_path) = self.state.lookup_path(newparent, newname) else {
             reply.error(libc::ENOENT);
             return;
         };
+        let newname = newname.to_os_string();
+
+        self.spawn_exclusive(move |state| async move {
+            // Get source inode before rename so we can update cache
+            let src = state.fs.lstat(&from_path).await.ok().flatten();
+
+            // Check if destination exists and get its inode for cache cleanup
+            let dst_ino = state
+                .fs
+                .stat(&to_path)
+                .await
+                .ok()
+                .flatten()
+                .map(|s| s.ino as u64);
+
+            // Perform the rename
+            match state.fs.rename(&from_path, &to_path).await {
+                Ok(()) => {
+                    // Update path cache: remove old path, add new path
+                    let moved_dir = src.as_ref().is_some_and(|s| s.is_directory());
+                    if let Some(stats) = &src {
+                        let ino = stats.ino as u64;
+                        state.drop_path(ino);
+                        if moved_dir {
+                            state.rename_subtree(&from_path, &to_path);
+                        }
+                        state.add_path(ino, to_path);
+                    }
+                    // Remove destination from cache if it was replaced
+                    if let Some(ino) = dst_ino {
+                        state.drop_path(ino);
+                    }
+                    reply.ok();
 
-        // Get source inode before rename so we can update cache
-        let fs = self.fs.clone();
-        let (src_stat, from_path) = self.runtime.block_on(async move {
-            let result = fs.stat(&from_path).await;
-            (result, from_path)
-        });
-
-        let src_ino = src_stat.ok().flatten().map(|s| s.ino as u64);
-
-        // Check if destination exists and get its inode for cache cleanup
-        let fs = self.fs.clone();
-        let (dst_stat, to_path) = self.runtime.block_on(async move {
-            let result = fs.stat(&to_path).await;
-            (result, to_path)
-        });
-
-        let dst_ino = dst_stat.ok().flatten().map(|s| s.ino as u64);
-
-        // Perform the rename
-        let fs = self.fs.clone();
-        let (result, to_path) = self.runtime.block_on(async move {
-            let result = fs.rename(&from_path, &to_path).await;
-            (result, to_path)
-        });
-
-        match result {
-            Ok(()) => {
-                // Update path cache: remove old path, add new path
-                if let Some(ino) = src_ino {
-                    self.drop_path(ino);
-                    self.add_path(ino, to_path);
-                }
-                // Remove destination from cache if it was replaced
-                if let Some(ino) = dst_ino {
-                    self.drop_path(ino);
+                    if moved_dir {
+                        state.invalidate_entry(newparent, newname);
+                    }
+                    if let Some(ino) = dst_ino {
+                        state.invalidate_inode(ino);
+                    }
                 }
-                reply.ok();
+                Err(e) => reply.error(error_to_errno(&e)),
             }
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+        });
     }
 
     // ─────────────────────────────────────────────────────────────
@@ -923,26 +930,20 @@ impl Filesystem for AgentFSFuse {
     /// Opens a file for reading or writing.
     ///
     /// Allocates a file handle and opens the file in the filesystem layer.
+    /// When caches are kept, the kernel reuses the pages cached by earlier
+    /// opens instead of dropping them; all writes go through this mount, so
+    /// the cached pages can't go stale behind its back.
     fn open(&mut self, _req: &Request, ino: u64, _flags: i32, reply: ReplyOpen) {
-        let Some(path) = self.get_path(ino) else {
-            reply.error(libc::ENOENT);
-            return;
-        };
-
-        let fs = self.fs.clone();
-        let path_clone = path.clone();
-        let result = self
-            .runtime
-            .block_on(async move { fs.open(&path_clone).await });
-
-        match result {
-            Ok(file) => {
-                let fh = self.alloc_fh();
-                self.open_files.lock().insert(fh, OpenFile { file });
-                reply.opened(fh, 0);
+        self.spawn_shared(move |state| async move {
+            match state.fs.open_inode(ino as i64).await {
+                Ok(file) => {
+                    let fh = state.alloc_fh();
+                    state.open_files.lock().insert(fh, OpenFile { file });
+                    reply.opened(fh, state.open_flags());
+                }
+                Err(e) => reply.error(error_to_errno(&e)),
             }
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+        });
     }
 
     /// Reads data using the file handle.
@@ -957,23 +958,16 @@ impl Filesystem for AgentFSFuse {
         _lock: Option<u64>,
         reply: ReplyData,
     ) {
-        let file = {
-            let open_files = self.open_files.lock();
-            let Some(open_file) = open_files.get(&fh) else {
-                reply.error(libc::EBADF);
-                return;
-            };
-            open_file.file.clone()
+        let Some(file) = self.state.get_file(fh) else {
+            reply.error(libc::EBADF);
+            return;
         };
-
-        let result = self
-            .runtime
-            .block_on(async move { file.pread(offset as u64, size as u64).await });
-
-        match result {
-            Ok(data) => reply.data(&data),
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+        self.spawn_shared(move |_state| async move {
+            match file.pread(offset as u64, size as u64).await {
+                Ok(data) => reply.data(&data),
+                Err(e) => reply.error(error_to_errno(&e)),
+            }
+        });
     }
 
     /// Writes data using the file handle.
@@ -989,67 +983,61 @@ impl Filesystem for AgentFSFuse {
         _lock_owner: Option<u64>,
         reply: ReplyWrite,
     ) {
-        let file = {
-            let open_files = self.open_files.lock();
-            let Some(open_file) = open_files.get(&fh) else {
-                reply.error(libc::EBADF);
-                return;
-            };
-            open_file.file.clone()
+        let Some(file) = self.state.get_file(fh) else {
+            reply.error(libc::EBADF);
+            return;
         };
-
-        let data_len = data.len();
-        let data_vec = data.to_vec();
-        let result = self
-            .runtime
-            .block_on(async move { file.pwrite(offset as u64, &data_vec).await });
-
-        match result {
-            Ok(()) => reply.written(data_len as u32),
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+        let data = data.to_vec();
+        self.spawn_exclusive(move |_state| async move {
+            match file.pwrite(offset as u64, &data).await {
+                Ok(()) => reply.written(data.len() as u32),
+                Err(e) => reply.error(error_to_errno(&e)),
+            }
+        });
     }
 
     /// Flushes data to the backend storage.
     ///
-    /// Since writes go directly to the database, this is a no-op.
+    /// Called on every close of a file descriptor; writes the handle's
+    /// buffered data to the filesystem layer.
     fn flush(&mut self, _req: &Request, _ino: u64, fh: u64, _lock_owner: u64, reply: ReplyEmpty) {
-        let open_files = self.open_files.lock();
-        if open_files.contains_key(&fh) {
-            reply.ok();
-        } else {
+        let Some(file) = self.state.get_file(fh) else {
             reply.error(libc::EBADF);
-        }
+            return;
+        };
+        self.spawn_exclusive(move |_state| async move {
+            match file.flush().await {
+                Ok(()) => reply.ok(),
+                Err(e) => reply.error(error_to_errno(&e)),
+            }
+        });
     }
 
     /// Synchronizes file data to persistent storage using the file handle.
     ///
     /// This now uses the file handle's fsync which knows which layer(s) the
     /// file exists in, avoiding errors when a file only exists in one layer.
+    ///
+    /// Runs shared, so concurrent fsyncs can share one durable commit; the
+    /// filesystem's writer lock orders the writes they flush.
     fn fsync(&mut self, _req: &Request, _ino: u64, fh: u64, _datasync: bool, reply: ReplyEmpty) {
-        let file = {
-            let open_files = self.open_files.lock();
-            match open_files.get(&fh) {
-                Some(open_file) => open_file.file.clone(),
-                None => {
-                    reply.error(libc::EBADF);
-                    return;
-                }
-            }
+        let Some(file) = self.state.get_file(fh) else {
+            reply.error(libc::EBADF);
+            return;
         };
-
-        let result = self.runtime.block_on(async move { file.fsync().await });
-
-        match result {
-            Ok(()) => reply.ok(),
-            Err(e) => reply.error(error_to_errno(&e)),
-        }
+        self.spawn_shared(move |_state| async move {
+            match file.fsync().await {
+                Ok(()) => reply.ok(),
+                Err(e) => reply.error(error_to_errno(&e)),
+            }
+        });
     }
 
     /// Releases (closes) an open file handle.
     ///
-    /// Removes the file handle from the open files table.
-    /// Since writes go directly to the database, no flushing is needed.
+    /// Removes the file handle from the open files table and writes back
+    /// anything still buffered, e.g. from writeback of a mapping that
+    /// outlived the last close.
     fn release(
         &mut self,
         _req: &Request,
@@ -1060,8 +1048,16 @@ impl Filesystem for AgentFSFuse {
         _flush: bool,
         reply: ReplyEmpty,
     ) {
-        self.open_files.lock().remove(&fh);
-        reply.ok();
+        let Some(open_file) = self.state.open_files.lock().remove(&fh) else {
+            reply.ok();
+            return;
+        };
+        self.spawn_exclusive(move |_state| async move {
+            match open_file.file.flush().await {
+                Ok(()) => reply.ok(),
+                Err(e) => reply.error(error_to_errno(&e)),
+            }
+        });
     }
 
     /// Returns filesystem statistics.
@@ -1072,62 +1068,113 @@ impl Filesystem for AgentFSFuse {
         const TOTAL_INODES: u64 = 1_000_000; // Virtual limit
         const MAX_NAMELEN: u32 = 255;
 
-        let fs = self.fs.clone();
-        let result = self.runtime.block_on(async move { fs.statfs().await });
-
-        let (used_blocks, used_inodes) = match result {
-            Ok(stats) => {
-                let used_blocks = stats.bytes_used.div_ceil(BLOCK_SIZE);
-                (used_blocks, stats.inodes)
-            }
-            Err(_) => (0, 1), // Fallback: just root inode
-        };
+        self.spawn_shared(move |state| async move {
+            let (used_blocks, used_inodes) = match state.fs.statfs().await {
+                Ok(stats) => {
+                    let used_blocks = stats.bytes_used.div_ceil(BLOCK_SIZE);
+                    (used_blocks, stats.inodes)
+                }
+                Err(_) => (0, 1), // Fallback: just root inode
+            };
 
-        // Report a large virtual capacity so tools don't think we're out of space
-        const TOTAL_BLOCKS: u64 = 1024 * 1024 * 1024; // ~4TB virtual size
-        let free_blocks = TOTAL_BLOCKS.saturating_sub(used_blocks);
-        let free_inodes = TOTAL_INODES.saturating_sub(used_inodes);
-
-        reply.statfs(
-            TOTAL_BLOCKS,
-            free_blocks,
-            free_blocks,
-            TOTAL_INODES,
-            free_inodes,
-            BLOCK_SIZE as u32,
-            MAX_NAMELEN,       // namelen: maximum filename length
-            BLOCK_SIZE as u32, // frsize: fragment size
-        );
+            // Report a large virtual capacity so tools don't think we're out of space
+            const TOTAL_BLOCKS: u64 = 1024 * 1024 * 1024; // ~4TB virtual size
+            let free_blocks = TOTAL_BLOCKS.saturating_sub(used_blocks);
+            let free_inodes = TOTAL_INODES.saturating_sub(used_inodes);
+
+            reply.statfs(
+                TOTAL_BLOCKS,
+                free_blocks,
+                free_blocks,
+                TOTAL_INODES,
+                free_inodes,
+                BLOCK_SIZE as u32,
+                MAX_NAMELEN,       // namelen: maximum filename length
+                BLOCK_SIZE as u32, // frsize: fragment size
+            );
+        });
     }
 }
 
 impl AgentFSFuse {
     /// Create a new FUSE filesystem adapter wrapping a FileSystem instance.
     ///
-    /// The provided Tokio runtime is used to execute async FileSystem operations
-    /// from within synchronous FUSE callbacks via `block_on`.
+    /// The provided Tokio runtime executes the async FileSystem operations.
+    /// FUSE callbacks hand each request off to the runtime and return
+    /// immediately, so the session thread keeps reading new requests while
+    /// earlier ones are still being served.
     ///
     /// The uid and gid are used for all file ownership to avoid "dubious ownership"
-    /// errors from tools like git that check file ownership.
+    /// errors from tools like git that check file ownership. Cache behaviour
+    /// and the mountpoint come from the mount options.
     fn new(
         fs: Arc<dyn FileSystem>,
         runtime: Runtime,
         uid: u32,
         gid: u32,
-        mountpoint_path: PathBuf,
+        opts: &FuseMountOptions,
     ) -> Self {
-        Self {
+        let state = FuseState {
             fs,
-            runtime,
-            path_cache: Arc::new(Mutex::new(HashMap::new())),
-            open_files: Arc::new(Mutex::new(HashMap::new())),
+            path_cache: Mutex::new(HashMap::new()),
+            lookups: Mutex::new(HashMap::new()),
+            open_files: Mutex::new(HashMap::new()),
+            open_dirs: Mutex::new(HashMap::new()),
             next_fh: AtomicU64::new(1),
             uid,
             gid,
-            mountpoint_path: mountpoint_path.as_os_str().to_string_lossy().to_string(),
+            keep_cache: opts.keep_cache,
+            attr_ttl: opts.attr_timeout,
+            entry_ttl: opts.entry_timeout,
+            negative_ttl: opts.negative_timeout,
+            notifier: OnceLock::new(),
+            mountpoint_path: opts.mountpoint.as_os_str().to_string_lossy().to_string(),
+            op_lock: RwLock::new(()),
+        };
+        Self {
+            state: Arc::new(state),
+            runtime,
         }
     }
 
+    /// Serve a read-only request on the runtime.
+    ///
+    /// Shared requests run concurrently with each other and wait for any
+    /// in-flight exclusive request to finish. The handler owns the reply
+    /// and must send it before completing.
+    fn spawn_shared<F, Fut>(&self, handler: F)
+    where
+        F: FnOnce(Arc<FuseState>) -> Fut,
+        Fut: Future<Output = ()> + Send + 'static,
+    {
+        let state = self.state.clone();
+        let request = handler(state.clone());
+        self.runtime.spawn(async move {
+            let _guard = state.op_lock.read().await;
+            request.await;
+        });
+    }
+
+    /// Serve a mutating request on the runtime.
+    ///
+    /// Exclusive requests run one at a time and never overlap with shared
+    /// requests, so multi-step operations such as rename observe a stable
+    /// filesystem while they run.
+    fn spawn_exclusive<F, Fut>(&self, handler: F)
+    where
+        F: FnOnce(Arc<FuseState>) -> Fut,
+        Fut: Future<Output = ()> + Send + 'static,
+    {
+        let state = self.state.clone();
+        let request = handler(state.clone());
+        self.runtime.spawn(async move {
+            let _guard = state.op_lock.write().await;
+            request.await;
+        });
+    }
+}
+
+impl FuseState {
     /// Resolve a full path from a parent inode and child name.
     ///
     /// Similar to the Linux kernel's dentry lookup (`d_lookup`), this method
@@ -1141,11 +1188,7 @@ impl AgentFSFuse {
         let parent_path = path_cache.get(&parent_ino)?;
         let name_str = name.to_str()?;
 
-        let path = if parent_path == "/" {
-            format!("/{}", name_str)
-        } else {
-            format!("{}/{}", parent_path, name_str)
-        };
+        let path = child_path(parent_path, name_str);
 
         if path.starts_with(&self.mountpoint_path) {
             // Cut the head off here so we never try to lookup anything that falls within
@@ -1175,6 +1218,37 @@ impl AgentFSFuse {
         path_cache.insert(ino, path);
     }
 
+    /// Record an entry handed to the kernel, which counts it as a lookup.
+    fn add_entry(&self, ino: u64, path: String) {
+        *self.lookups.lock().entry(ino).or_insert(0) += 1;
+        self.add_path(ino, path);
+    }
+
+    /// Drop `nlookup` lookups of an inode, and once none are left, its path
+    /// and whatever the filesystem keeps to serve it by inode.
+    ///
+    /// Called with the op lock held exclusively, so no request is between
+    /// resolving the inode in the filesystem and recording the entry.
+    fn forget(&self, ino: u64, nlookup: u64) {
+        // The root stays resolvable for as long as the mount lives
+        if ino == 1 {
+            return;
+        }
+        {
+            let mut lookups = self.lookups.lock();
+            let Some(count) = lookups.get_mut(&ino) else {
+                return;
+            };
+            *count = count.saturating_sub(nlookup);
+            if *count > 0 {
+                return;
+            }
+            lookups.remove(&ino);
+        }
+        self.drop_path(ino);
+        self.fs.forget(ino as i64);
+    }
+
     /// Remove an inode from the path cache.
     ///
     /// Similar to the Linux kernel's `d_drop()`, this removes the inode's
@@ -1184,6 +1258,76 @@ impl AgentFSFuse {
         path_cache.remove(&ino);
     }
 
+    /// Rewrite the cached paths of everything below a renamed directory.
+    ///
+    /// Similar to the Linux kernel's `d_move()` moving a dentry subtree.
+    fn rename_subtree(&self, from: &str, to: &str) {
+        let prefix = format!("{}/", from);
+        let mut path_cache = self.path_cache.lock();
+        for path in path_cache.values_mut() {
+            if path.starts_with(&prefix) {
+                *path = format!("{}{}", to, &path[from.len()..]);
+            }
+        }
+    }
+
+    /// Flags to reply with when opening a file.
+    fn open_flags(&self) -> u32 {
+        if self.keep_cache {
+            FOPEN_KEEP_CACHE
+        } else {
+            0
+        }
+    }
+
+    /// Drop the kernel's cached attributes and pages for an inode.
+    ///
+    /// The kernel takes the inode lock to process the notification, which
+    /// may be held by a request waiting on `op_lock`, so the notification is
+    /// sent from a blocking task instead of the calling handler.
+    fn invalidate_inode(self: &Arc<Self>, ino: u64) {
+        let state = self.clone();
+        tokio::task::spawn_blocking(move || {
+            if let Some(notifier) = state.notifier.get() {
+                // ENOENT just means the kernel has nothing cached for it
+                let _ = notifier.inval_inode(ino, 0, 0);
+            }
+        });
+    }
+
+    /// Drop the kernel's cached dentry (and anything below it) for a name.
+    ///
+    /// Sent from a blocking task for the same reason as `invalidate_inode`.
+    fn invalidate_entry(self: &Arc<Self>, parent: u64, name: OsString) {
+        let state = self.clone();
+        tokio::task::spawn_blocking(move || {
+            if let Some(notifier) = state.notifier.get() {
+                let _ = notifier.inval_entry(parent, &name);
+            }
+        });
+    }
+
+    /// Look up the file behind an open file handle.
+    ///
+    /// Similar to the Linux kernel's `fget()`, this returns a reference to
+    /// the open file so that it can be used without holding the table lock.
+    fn get_file(&self, fh: u64) -> Option<BoxedFile> {
+        self.open_files.lock().get(&fh).map(|f| f.file.clone())
+    }
+
+    /// Look up the state behind a directory handle.
+    ///
+    /// Handles that were never opened (or already released) get a fresh
+    /// state that lists the directory from the start and skips to the
+    /// requested offset.
+    fn get_dir(&self, fh: u64) -> Arc<tokio::sync::Mutex<OpenDir>> {
+        self.open_dirs
+            .lock()
+            .get(&fh)
+            .cloned()
+            .unwrap_or_else(|| Arc::new(tokio::sync::Mutex::new(OpenDir::new())))
+    }
+
     /// Allocate a new file handle for tracking open files.
     ///
     /// Similar to the Linux kernel's `get_unused_fd()`, this returns a unique
@@ -1193,6 +1337,30 @@ impl AgentFSFuse {
     }
 }
 
+/// Join a directory path and an entry name.
+fn child_path(parent: &str, name: &str) -> String {
+    if parent == "/" {
+        format!("/{}", name)
+    } else {
+        format!("{}/{}", parent, name)
+    }
+}
+
+/// Return the parent directory of a path, with `/` as the parent of itself.
+fn parent_path(path: &str) -> String {
+    Path::new(path)
+        .parent()
+        .map(|p| {
+            let s = p.to_string_lossy().to_string();
+            if s.is_empty() {
+                "/".to_string()
+            } else {
+                s
+            }
+        })
+        .unwrap_or_else(|| "/".to_string())
+}
+
 // ─────────────────────────────────────────────────────────────
 // Attribute Conversion
 // ─────────────────────────────────────────────────────────────
@@ -1238,6 +1406,27 @@ fn fillattr(stats: &Stats, uid: u32, gid: u32) -> FileAttr {
     }
 }
 
+/// Attributes of a negative entry; the kernel only looks at the zero inode
+fn negative_attr() -> FileAttr {
+    FileAttr {
+        ino: 0,
+        size: 0,
+        blocks: 0,
+        atime: UNIX_EPOCH,
+        mtime: UNIX_EPOCH,
+        ctime: UNIX_EPOCH,
+        crtime: UNIX_EPOCH,
+        kind: FileType::RegularFile,
+        perm: 0,
+        nlink: 0,
+        uid: 0,
+        gid: 0,
+        rdev: 0,
+        flags: 0,
+        blksize: 512,
+    }
+}
+
 pub fn mount(
     fs: Arc<dyn FileSystem>,
     opts: FuseMountOptions,
@@ -1248,9 +1437,10 @@ pub fn mount(
     let uid = opts.uid.unwrap_or_else(|| unsafe { libc::getuid() });
     let gid = opts.gid.unwrap_or_else(|| unsafe { libc::getgid() });
 
-    let fs = AgentFSFuse::new(fs, runtime, uid, gid, opts.mountpoint.clone());
+    let fs = AgentFSFuse::new(fs, runtime, uid, gid, &opts);
 
-    fs.add_path(1, "/".to_string());
+    fs.state.add_path(1, "/".to_string());
+    let state = fs.state.clone();
 
     let mut mount_opts = vec![MountOption::FSName(opts.fsname)];
     if opts.auto_unmount {
@@ -1260,7 +1450,9 @@ pub fn mount(
         mount_opts.push(MountOption::AllowRoot);
     }
 
-    fuser::mount2(fs, &opts.mountpoint, &mount_opts)?;
+    let mut session = Session::new(fs, &opts.mountpoint, &mount_opts)?;
+    let _ = state.notifier.set(session.notifier());
+    session.run()?;
 
     Ok(())
 }
@@ -1,4 +1,5 @@
 pub mod cmd;
+pub mod metrics;
 pub mod parser;
 pub mod sandbox;
 
@@ -26,10 +26,23 @@ fn main() {
             id,
             force,
             base,
+            from,
+            dedup,
+            compression,
+            extents,
             sync,
         } => {
             let rt = get_runtime();
-            if let Err(e) = rt.block_on(cmd::init::init_database(id, sync, force, base)) {
+            if let Err(e) = rt.block_on(cmd::init::init_database(
+                id,
+                sync,
+                force,
+                base,
+                from,
+                dedup,
+                compression,
+                extents,
+            )) {
                 eprintln!("Error: {}", e);
                 std::process::exit(1);
             }
@@ -75,6 +88,7 @@ fn main() {
             no_default_allows,
             experimental_sandbox,
             strace,
+            seccomp,
             session,
             command,
             args,
@@ -86,6 +100,7 @@ fn main() {
                 no_default_allows,
                 experimental_sandbox,
                 strace,
+                seccomp,
                 session,
                 command,
                 args,
@@ -102,6 +117,11 @@ fn main() {
             foreground,
             uid,
             gid,
+            keep_cache,
+            attr_timeout,
+            entry_timeout,
+            negative_timeout,
+            metrics_listen,
         } => match (id_or_path, mountpoint) {
             (Some(id_or_path), Some(mountpoint)) => {
                 if let Err(e) = cmd::mount(cmd::MountArgs {
@@ -112,6 +132,11 @@ fn main() {
                     foreground,
                     uid,
                     gid,
+                    keep_cache,
+                    attr_timeout,
+                    entry_timeout,
+                    negative_timeout,
+                    metrics_listen,
                 }) {
                     eprintln!("Error: {}", e);
                     std::process::exit(1);
@@ -138,6 +163,7 @@ fn main() {
             filter,
             status,
             format,
+            follow,
         } => {
             let rt = get_runtime();
             let options = cmd::timeline::TimelineOptions {
@@ -145,6 +171,7 @@ fn main() {
                 filter,
                 status,
                 format,
+                follow,
             };
             if let Err(e) = rt.block_on(cmd::timeline::show_timeline(
                 &mut std::io::stdout(),
@@ -0,0 +1,156 @@
+//! HTTP endpoint serving the filesystem metrics of a running mount.
+//!
+//! `GET /metrics` returns the Prometheus text format and
+//! `GET /metrics.json` the same snapshot as JSON. This is a bare responder
+//! for scrapers and `curl` that answers one request per connection, not a
+//! general purpose HTTP server.
+
+use std::time::Duration;
+
+use anyhow::{Context, Result};
+use tokio::io::{AsyncReadExt, AsyncWriteExt};
+use tokio::net::{TcpListener, TcpStream};
+
+/// Largest request head read before answering
+const MAX_REQUEST_BYTES: usize = 8192;
+
+/// How long a client gets to send its request head
+const REQUEST_TIMEOUT: Duration = Duration::from_secs(5);
+
+/// Pause after a failed accept; errors such as EMFILE last until other
+/// connections close, and retrying at once would spin
+const ACCEPT_BACKOFF: Duration = Duration::from_millis(100);
+
+/// Bind `addr` and serve metrics on it until the runtime shuts down.
+///
+/// Binding happens before this returns, so a bad address is reported to
+/// the caller instead of being lost in the background task.
+pub fn serve(rt: &tokio::runtime::Runtime, addr: &str) -> Result<()> {
+    let listener = rt
+        .block_on(TcpListener::bind(addr))
+        .with_context(|| format!("Failed to listen for metrics on {}", addr))?;
+    rt.spawn(async move {
+        loop {
+            let stream = match listener.accept().await {
+                Ok((stream, _)) => stream,
+                Err(e) => {
+                    tracing::debug!("metrics accept failed: {}", e);
+                    tokio::time::sleep(ACCEPT_BACKOFF).await;
+                    continue;
+                }
+            };
+            tokio::spawn(async move {
+                if let Err(e) = respond(stream, REQUEST_TIMEOUT).await {
+                    tracing::debug!("metrics request failed: {}", e);
+                }
+            });
+        }
+    });
+    Ok(())
+}
+
+async fn respond(mut stream: TcpStream, timeout: Duration) -> std::io::Result<()> {
+    let request = tokio::time::timeout(timeout, read_head(&mut stream))
+        .await
+        .map_err(|_| {
+            std::io::Error::new(std::io::ErrorKind::TimedOut, "no request head in time")
+        })??;
+
+    let (status, content_type, body) = route(&request);
+    let head = format!(
+        "HTTP/1.1 {}\r\nContent-Type: {}\r\nContent-Length: {}\r\nConnection: close\r\n\r\n",
+        status,
+        content_type,
+        body.len()
+    );
+    stream.write_all(head.as_bytes()).await?;
+    stream.write_all(body.as_bytes()).await?;
+    stream.shutdown().await
+}
+
+/// Read up to the end of the request head, the end of the stream or
+/// `MAX_REQUEST_BYTES`
+async fn read_head(stream: &mut TcpStream) -> std::io::Result<Vec<u8>> {
+    let mut request = Vec::new();
+    let mut buf = [0u8; 1024];
+    while !request.windows(4).any(|w| w == b"\r\n\r\n") && request.len() < MAX_REQUEST_BYTES {
+        let n = stream.read(&mut buf).await?;
+        if n == 0 {
+            break;
+        }
+        request.extend_from_slice(&buf[..n]);
+    }
+    Ok(request)
+}
+
+/// Pick the response for a request head
+fn route(request: &[u8]) -> (&'static str, &'static str, String) {
+    let line = request.split(|&b| b == b'\r').next().unwrap_or_default();
+    let mut parts = line.split(|&b| b == b' ');
+    let method = parts.next().unwrap_or_default();
+    let path = parts.next().unwrap_or_default();
+    if method != b"GET" {
+        return ("405 Method Not Allowed", "text/plain", String::new());
+    }
+    match path {
+        b"/metrics" => (
+            "200 OK",
+            "text/plain; version=0.0.4",
+            agentfs_sdk::metrics::render_prometheus(),
+        ),
+        b"/metrics.json" => (
+            "200 OK",
+            "application/json",
+            serde_json::to_string(&agentfs_sdk::metrics::snapshot()).unwrap_or_default(),
+        ),
+        _ => ("404 Not Found", "text/plain", String::new()),
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_route() {
+        let (status, content_type, body) = route(b"GET /metrics HTTP/1.1\r\nHost: x\r\n\r\n");
+        assert_eq!(status, "200 OK");
+        assert_eq!(content_type, "text/plain; version=0.0.4");
+        assert!(body.contains("# TYPE agentfs_op_duration_seconds histogram"));
+
+        let (status, content_type, body) = route(b"GET /metrics.json HTTP/1.1\r\n\r\n");
+        assert_eq!(status, "200 OK");
+        assert_eq!(content_type, "application/json");
+        assert!(body.contains("\"durable_commits\""));
+
+        assert_eq!(route(b"GET / HTTP/1.1\r\n\r\n").0, "404 Not Found");
+        assert_eq!(
+            route(b"POST /metrics HTTP/1.1\r\n\r\n").0,
+            "405 Method Not Allowed"
+        );
+    }
+
+    #[tokio::test]
+    async fn test_respond_times_out_idle_connections() {
+        let listener = TcpListener::bind("127.0.0.1:0").await.unwrap();
+        let addr = listener.local_addr().unwrap();
+
+        let _idle = TcpStream::connect(addr).await.unwrap();
+        let (stream, _) = listener.accept().await.unwrap();
+        let err = respond(stream, Duration::from_millis(50))
+            .await
+            .unwrap_err();
+        assert_eq!(err.kind(), std::io::ErrorKind::TimedOut);
+
+        let mut client = TcpStream::connect(addr).await.unwrap();
+        client
+            .write_all(b"GET /metrics HTTP/1.1\r\n\r\n")
+            .await
+            .unwrap();
+        let (stream, _) = listener.accept().await.unwrap();
+        respond(stream, Duration::from_millis(50)).await.unwrap();
+        let mut response = String::new();
+        client.read_to_string(&mut response).await.unwrap();
+        assert!(response.starts_with("HTTP/1.1 200 OK\r\n"));
+    }
+}
@@ -3,39 +3,131 @@
 //! This module implements nfsserve's NFSFileSystem trait on top of AgentFS's
 //! FileSystem trait, enabling systems to mount AgentFS via NFS without requiring
 //! FUSE or other system extensions.
+//!
+//! Requests that only read run concurrently; requests that change the
+//! filesystem take an exclusive lock, as in the FUSE adapter, so multi-step
+//! operations such as an overlay copy-up or rename are not interleaved.
+//! READ and WRITE go through file handles kept open per fileid, so a stream
+//! of requests for one file opens it once. nfsserve answers every WRITE as
+//! FILE_SYNC and does not pass COMMIT on, so WRITE flushes the handle before
+//! it replies.
 
 use std::collections::HashMap;
-use std::sync::Arc;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex, RwLock};
 
-use agentfs_sdk::{FileSystem, Stats, S_IFDIR, S_IFLNK, S_IFMT, S_IFREG};
+use agentfs_sdk::{BoxedFile, FileSystem, Stats, S_IFDIR, S_IFLNK, S_IFMT, S_IFREG};
 use async_trait::async_trait;
 use nfsserve::nfs::{
     fattr3, fileid3, filename3, ftype3, nfspath3, nfsstat3, nfstime3, sattr3, specdata3,
 };
 use nfsserve::vfs::{DirEntry, NFSFileSystem, ReadDirResult, VFSCapabilities};
-use tokio::sync::{Mutex, RwLock};
 
 /// Root directory inode number
 const ROOT_INO: fileid3 = 1;
 
+/// Most file handles kept open at once
+const MAX_OPEN_HANDLES: usize = 1024;
+
+/// Transfer size to ask clients for in READ and WRITE requests
+pub const NFS_IO_SIZE: u32 = 1024 * 1024;
+
 /// NFS adapter that wraps an AgentFS FileSystem.
 pub struct AgentNFS {
-    /// The underlying filesystem (wrapped in Mutex to serialize operations)
-    fs: Arc<Mutex<dyn FileSystem>>,
-    /// Inode-to-path mapping (async RwLock for use in async methods)
+    /// The underlying filesystem
+    fs: Arc<dyn FileSystem>,
+    /// Taken shared by requests that only read and exclusively by requests
+    /// that change the filesystem
+    op_lock: tokio::sync::RwLock<()>,
+    /// Inode-to-path mapping; never held across an await
     inode_map: RwLock<InodeMap>,
+    /// Open file handles by fileid
+    handles: HandleCache,
     /// User ID for all files
     uid: u32,
     /// Group ID for all files
     gid: u32,
 }
 
+/// Open file handles, keyed by NFS fileid, evicting the least recently
+/// used one when full.
+struct HandleCache {
+    handles: Mutex<HashMap<fileid3, CachedHandle>>,
+    /// Logical clock for recency
+    clock: AtomicU64,
+}
+
+struct CachedHandle {
+    file: BoxedFile,
+    last_used: u64,
+}
+
+impl HandleCache {
+    fn new() -> Self {
+        Self {
+            handles: Mutex::new(HashMap::new()),
+            clock: AtomicU64::new(0),
+        }
+    }
+
+    fn tick(&self) -> u64 {
+        self.clock.fetch_add(1, Ordering::Relaxed)
+    }
+
+    fn get(&self, id: fileid3) -> Option<BoxedFile> {
+        let now = self.tick();
+        let mut handles = self.handles.lock().unwrap();
+        let handle = handles.get_mut(&id)?;
+        handle.last_used = now;
+        Some(handle.file.clone())
+    }
+
+    /// Cache a newly opened handle, returning the handle to use (another
+    /// request may have opened the file first)
+    fn insert(&self, id: fileid3, file: BoxedFile) -> BoxedFile {
+        let now = self.tick();
+        let mut handles = self.handles.lock().unwrap();
+        if let Some(handle) = handles.get_mut(&id) {
+            handle.last_used = now;
+            return handle.file.clone();
+        }
+
+        if handles.len() >= MAX_OPEN_HANDLES {
+            let victim = handles
+                .iter()
+                .min_by_key(|(_, handle)| handle.last_used)
+                .map(|(&id, _)| id);
+            if let Some(victim) = victim {
+                handles.remove(&victim);
+            }
+        }
+        handles.insert(
+            id,
+            CachedHandle {
+                file: file.clone(),
+                last_used: now,
+            },
+        );
+        file
+    }
+
+    /// Forget a handle without flushing it, for files that are gone or were
+    /// replaced
+    fn remove(&self, id: fileid3) {
+        self.handles.lock().unwrap().remove(&id);
+    }
+}
+
 /// Bidirectional mapping between inodes and paths.
 struct InodeMap {
     /// Path to inode
     path_to_ino: HashMap<String, fileid3>,
     /// Inode to path
     ino_to_path: HashMap<fileid3, String>,
+    /// NFS fileid to the underlying filesystem's inode number, learned from
+    /// stats as entries are looked up; lets lookups, getattr and readdir go
+    /// through the inode-addressed FileSystem API instead of path resolution.
+    fs_ino: HashMap<fileid3, i64>,
     /// Next available inode number
     next_ino: fileid3,
 }
@@ -45,11 +137,13 @@ impl InodeMap {
         let mut map = InodeMap {
             path_to_ino: HashMap::new(),
             ino_to_path: HashMap::new(),
+            fs_ino: HashMap::new(),
             next_ino: ROOT_INO + 1,
         };
         // Root directory is always inode 1
         map.path_to_ino.insert("/".to_string(), ROOT_INO);
         map.ino_to_path.insert(ROOT_INO, "/".to_string());
+        map.fs_ino.insert(ROOT_INO, agentfs_sdk::ROOT_INO);
         map
     }
 
@@ -64,18 +158,37 @@ impl InodeMap {
         ino
     }
 
+    /// Like `get_or_create_ino`, also remembering the filesystem inode.
+    fn record(&mut self, path: &str, stats: &Stats) -> fileid3 {
+        let ino = self.get_or_create_ino(path);
+        self.fs_ino.insert(ino, stats.ino);
+        ino
+    }
+
     fn get_path(&self, ino: fileid3) -> Option<String> {
         self.ino_to_path.get(&ino).cloned()
     }
 
-    fn remove_path(&mut self, path: &str) {
-        if let Some(ino) = self.path_to_ino.remove(path) {
-            self.ino_to_path.remove(&ino);
-        }
+    fn get_fs_ino(&self, ino: fileid3) -> Option<i64> {
+        self.fs_ino.get(&ino).copied()
+    }
+
+    fn get_ino(&self, path: &str) -> Option<fileid3> {
+        self.path_to_ino.get(path).copied()
+    }
+
+    fn remove_path(&mut self, path: &str) -> Option<fileid3> {
+        let ino = self.path_to_ino.remove(path)?;
+        self.ino_to_path.remove(&ino);
+        self.fs_ino.remove(&ino);
+        Some(ino)
     }
 
     fn rename_path(&mut self, from: &str, to: &str) {
         if let Some(ino) = self.path_to_ino.remove(from) {
+            // Path-derived inode numbers (HostFS) change on rename; re-learn
+            // the filesystem inode on the next lookup.
+            self.fs_ino.remove(&ino);
             self.ino_to_path.insert(ino, to.to_string());
             self.path_to_ino.insert(to.to_string(), ino);
         }
@@ -84,15 +197,52 @@ impl InodeMap {
 
 impl AgentNFS {
     /// Create a new NFS adapter wrapping the given filesystem.
-    pub fn new(fs: Arc<Mutex<dyn FileSystem>>, uid: u32, gid: u32) -> Self {
+    pub fn new(fs: Arc<dyn FileSystem>, uid: u32, gid: u32) -> Self {
         AgentNFS {
             fs,
+            op_lock: tokio::sync::RwLock::new(()),
             inode_map: RwLock::new(InodeMap::new()),
+            handles: HandleCache::new(),
             uid,
             gid,
         }
     }
 
+    /// Get the open handle of a file, opening it on first use
+    async fn file(&self, id: fileid3) -> Result<BoxedFile, nfsstat3> {
+        if let Some(file) = self.handles.get(id) {
+            return Ok(file);
+        }
+
+        let fs_ino = self.inode_map.read().unwrap().get_fs_ino(id);
+        let file = match fs_ino {
+            Some(ino) => self.fs.open_inode(ino).await,
+            None => {
+                let path = self.get_path(id)?;
+                self.fs.open(&path).await
+            }
+        }
+        .map_err(|_| nfsstat3::NFS3ERR_NOENT)?;
+
+        Ok(self.handles.insert(id, file))
+    }
+
+    /// Get the attributes of a fileid; the caller holds the op lock
+    async fn attr(&self, id: fileid3) -> Result<fattr3, nfsstat3> {
+        let fs_ino = self.inode_map.read().unwrap().get_fs_ino(id);
+        let stats = match fs_ino {
+            Some(ino) => self.fs.getattr(ino).await,
+            None => {
+                let path = self.get_path(id)?;
+                self.fs.lstat(&path).await
+            }
+        }
+        .map_err(|_| nfsstat3::NFS3ERR_IO)?
+        .ok_or(nfsstat3::NFS3ERR_NOENT)?;
+
+        Ok(self.stats_to_fattr(&stats, id))
+    }
+
     /// Convert AgentFS Stats to NFS fattr3.
     fn stats_to_fattr(&self, stats: &Stats, ino: fileid3) -> fattr3 {
         let ftype = match stats.mode & S_IFMT {
@@ -129,10 +279,10 @@ impl AgentNFS {
     }
 
     /// Get path for an inode, returning NOENT error if not found.
-    async fn get_path(&self, ino: fileid3) -> Result<String, nfsstat3> {
+    fn get_path(&self, ino: fileid3) -> Result<String, nfsstat3> {
         self.inode_map
             .read()
-            .await
+            .unwrap()
             .get_path(ino)
             .ok_or(nfsstat3::NFS3ERR_NOENT)
     }
@@ -158,7 +308,8 @@ impl NFSFileSystem for AgentNFS {
     }
 
     async fn lookup(&self, dirid: fileid3, filename: &filename3) -> Result<fileid3, nfsstat3> {
-        let dir_path = self.get_path(dirid).await?;
+        let _op = self.op_lock.read().await;
+        let dir_path = self.get_path(dirid)?;
         let name = std::str::from_utf8(filename).map_err(|_| nfsstat3::NFS3ERR_INVAL)?;
 
         // Handle . and ..
@@ -179,64 +330,56 @@ impl NFSFileSystem for AgentNFS {
             } else {
                 parent_path
             };
-            return Ok(self.inode_map.write().await.get_or_create_ino(&parent_path));
+            return Ok(self
+                .inode_map
+                .write()
+                .unwrap()
+                .get_or_create_ino(&parent_path));
         }
 
         let full_path = Self::join_path(&dir_path, name);
+        let dir_ino = self.inode_map.read().unwrap().get_fs_ino(dirid);
 
-        // Lock filesystem for the duration of these operations
-        let fs = self.fs.lock().await;
-
-        // Check if path exists
-        let stats = fs
-            .lstat(&full_path)
-            .await
-            .map_err(|_| nfsstat3::NFS3ERR_IO)?
-            .ok_or(nfsstat3::NFS3ERR_NOENT)?;
+        let fs = &self.fs;
 
         // Verify parent is a directory
-        let dir_stats = fs
-            .lstat(&dir_path)
-            .await
-            .map_err(|_| nfsstat3::NFS3ERR_IO)?
-            .ok_or(nfsstat3::NFS3ERR_NOENT)?;
-
-        drop(fs); // Release lock before acquiring inode_map lock
-
+        let dir_stats = match dir_ino {
+            Some(ino) => fs.getattr(ino).await,
+            None => fs.lstat(&dir_path).await,
+        }
+        .map_err(|_| nfsstat3::NFS3ERR_IO)?
+        .ok_or(nfsstat3::NFS3ERR_NOENT)?;
         if !dir_stats.is_directory() {
             return Err(nfsstat3::NFS3ERR_NOTDIR);
         }
 
-        let _ = stats; // We just needed to verify it exists
-        Ok(self.inode_map.write().await.get_or_create_ino(&full_path))
-    }
-
-    async fn getattr(&self, id: fileid3) -> Result<fattr3, nfsstat3> {
-        let path = self.get_path(id).await?;
-        let fs = self.fs.lock().await;
+        // Check if the entry exists
         let stats = fs
-            .lstat(&path)
+            .lookup(dir_stats.ino, name)
             .await
             .map_err(|_| nfsstat3::NFS3ERR_IO)?
             .ok_or(nfsstat3::NFS3ERR_NOENT)?;
 
-        Ok(self.stats_to_fattr(&stats, id))
+        Ok(self.inode_map.write().unwrap().record(&full_path, &stats))
     }
 
-    async fn setattr(&self, id: fileid3, setattr: sattr3) -> Result<fattr3, nfsstat3> {
-        let path = self.get_path(id).await?;
+    async fn getattr(&self, id: fileid3) -> Result<fattr3, nfsstat3> {
+        let _op = self.op_lock.read().await;
+        self.attr(id).await
+    }
 
+    async fn setattr(&self, id: fileid3, setattr: sattr3) -> Result<fattr3, nfsstat3> {
+        let _op = self.op_lock.write().await;
         // Handle size change (truncate)
         if let nfsserve::nfs::set_size3::size(size) = setattr.size {
-            let fs = self.fs.lock().await;
-            let file = fs.open(&path).await.map_err(|_| nfsstat3::NFS3ERR_IO)?;
+            let file = self.file(id).await?;
             file.truncate(size)
                 .await
                 .map_err(|_| nfsstat3::NFS3ERR_IO)?;
         }
 
         // Return updated attributes
-        self.getattr(id).await
+        self.attr(id).await
     }
 
     async fn read(
@@ -245,34 +388,30 @@ impl NFSFileSystem for AgentNFS {
         offset: u64,
         count: u32,
     ) -> Result<(Vec<u8>, bool), nfsstat3> {
-        let path = self.get_path(id).await?;
-        let fs = self.fs.lock().await;
-
-        let file = fs.open(&path).await.map_err(|_| nfsstat3::NFS3ERR_NOENT)?;
+        let _op = self.op_lock.read().await;
+        let file = self.file(id).await?;
         let data = file
             .pread(offset, count as u64)
             .await
             .map_err(|_| nfsstat3::NFS3ERR_IO)?;
 
-        // Check if we've reached EOF
-        let stats = file.fstat().await.map_err(|_| nfsstat3::NFS3ERR_IO)?;
-
-        let eof = offset + data.len() as u64 >= stats.size as u64;
+        // Reads only come back short at the end of the file
+        let eof = (data.len() as u64) < count as u64;
         Ok((data, eof))
     }
 
     async fn write(&self, id: fileid3, offset: u64, data: &[u8]) -> Result<fattr3, nfsstat3> {
-        let path = self.get_path(id).await?;
-
-        {
-            let fs = self.fs.lock().await;
-            let file = fs.open(&path).await.map_err(|_| nfsstat3::NFS3ERR_IO)?;
-            file.pwrite(offset, data)
-                .await
-                .map_err(|_| nfsstat3::NFS3ERR_IO)?;
-        }
+        let _op = self.op_lock.write().await;
+        let file = self.file(id).await?;
+        file.pwrite(offset, data)
+            .await
+            .map_err(|_| nfsstat3::NFS3ERR_IO)?;
+        // The reply tells the client the data is stable
+        file.flush().await.map_err(|_| nfsstat3::NFS3ERR_IO)?;
 
-        self.getattr(id).await
+        // The overlay may have just copied the file up; attributes come from
+        // whichever layer now backs the fileid
+        self.attr(id).await
     }
 
     async fn create(
@@ -281,20 +420,25 @@ impl NFSFileSystem for AgentNFS {
         filename: &filename3,
         _attr: sattr3,
     ) -> Result<(fileid3, fattr3), nfsstat3> {
-        let dir_path = self.get_path(dirid).await?;
+        let _op = self.op_lock.write().await;
+        let dir_path = self.get_path(dirid)?;
         let name = std::str::from_utf8(filename).map_err(|_| nfsstat3::NFS3ERR_INVAL)?;
         let full_path = Self::join_path(&dir_path, name);
 
         // Create empty file
-        {
-            let fs = self.fs.lock().await;
-            fs.write_file(&full_path, &[])
-                .await
-                .map_err(|_| nfsstat3::NFS3ERR_IO)?;
-        }
+        self.fs
+            .write_file(&full_path, &[])
+            .await
+            .map_err(|_| nfsstat3::NFS3ERR_IO)?;
 
-        let ino = self.inode_map.write().await.get_or_create_ino(&full_path);
-        let attr = self.getattr(ino).await?;
+        let ino = self
+            .inode_map
+            .write()
+            .unwrap()
+            .get_or_create_ino(&full_path);
+        // An existing file was replaced; don't write through its old handle
+        self.handles.remove(ino);
+        let attr = self.attr(ino).await?;
         Ok((ino, attr))
     }
 
@@ -303,14 +447,14 @@ impl NFSFileSystem for AgentNFS {
         dirid: fileid3,
         filename: &filename3,
     ) -> Result<fileid3, nfsstat3> {
-        let dir_path = self.get_path(dirid).await?;
+        let _op = self.op_lock.write().await;
+        let dir_path = self.get_path(dirid)?;
         let name = std::str::from_utf8(filename).map_err(|_| nfsstat3::NFS3ERR_INVAL)?;
         let full_path = Self::join_path(&dir_path, name);
 
-        let fs = self.fs.lock().await;
-
         // Check if file already exists
-        if fs
+        if self
+            .fs
             .lstat(&full_path)
             .await
             .map_err(|_| nfsstat3::NFS3ERR_IO)?
@@ -320,12 +464,16 @@ impl NFSFileSystem for AgentNFS {
         }
 
         // Create empty file
-        fs.write_file(&full_path, &[])
+        self.fs
+            .write_file(&full_path, &[])
             .await
             .map_err(|_| nfsstat3::NFS3ERR_IO)?;
 
-        drop(fs);
-        Ok(self.inode_map.write().await.get_or_create_ino(&full_path))
+        Ok(self
+            .inode_map
+            .write()
+            .unwrap()
+            .get_or_create_ino(&full_path))
     }
 
     async fn mkdir(
@@ -333,35 +481,40 @@ impl NFSFileSystem for AgentNFS {
         dirid: fileid3,
         dirname: &filename3,
     ) -> Result<(fileid3, fattr3), nfsstat3> {
-        let dir_path = self.get_path(dirid).await?;
+        let _op = self.op_lock.write().await;
+        let dir_path = self.get_path(dirid)?;
         let name = std::str::from_utf8(dirname).map_err(|_| nfsstat3::NFS3ERR_INVAL)?;
         let full_path = Self::join_path(&dir_path, name);
 
-        {
-            let fs = self.fs.lock().await;
-            fs.mkdir(&full_path)
-                .await
-                .map_err(|_| nfsstat3::NFS3ERR_IO)?;
-        }
+        self.fs
+            .mkdir(&full_path)
+            .await
+            .map_err(|_| nfsstat3::NFS3ERR_IO)?;
 
-        let ino = self.inode_map.write().await.get_or_create_ino(&full_path);
-        let attr = self.getattr(ino).await?;
+        let ino = self
+            .inode_map
+            .write()
+            .unwrap()
+            .get_or_create_ino(&full_path);
+        let attr = self.attr(ino).await?;
         Ok((ino, attr))
     }
 
     async fn remove(&self, dirid: fileid3, filename: &filename3) -> Result<(), nfsstat3> {
-        let dir_path = self.get_path(dirid).await?;
+        let _op = self.op_lock.write().await;
+        let dir_path = self.get_path(dirid)?;
         let name = std::str::from_utf8(filename).map_err(|_| nfsstat3::NFS3ERR_INVAL)?;
         let full_path = Self::join_path(&dir_path, name);
 
-        {
-            let fs = self.fs.lock().await;
-            fs.remove(&full_path)
-                .await
-                .map_err(|_| nfsstat3::NFS3ERR_IO)?;
-        }
+        self.fs
+            .remove(&full_path)
+            .await
+            .map_err(|_| nfsstat3::NFS3ERR_IO)?;
 
-        self.inode_map.write().await.remove_path(&full_path);
+        let removed = self.inode_map.write().unwrap().remove_path(&full_path);
+        if let Some(ino) = removed {
+            self.handles.remove(ino);
+        }
         Ok(())
     }
 
@@ -372,25 +525,26 @@ impl NFSFileSystem for AgentNFS {
         to_dirid: fileid3,
         to_filename: &filename3,
     ) -> Result<(), nfsstat3> {
-        let from_dir = self.get_path(from_dirid).await?;
-        let to_dir = self.get_path(to_dirid).await?;
+        let _op = self.op_lock.write().await;
+        let from_dir = self.get_path(from_dirid)?;
+        let to_dir = self.get_path(to_dirid)?;
         let from_name = std::str::from_utf8(from_filename).map_err(|_| nfsstat3::NFS3ERR_INVAL)?;
         let to_name = std::str::from_utf8(to_filename).map_err(|_| nfsstat3::NFS3ERR_INVAL)?;
 
         let from_path = Self::join_path(&from_dir, from_name);
         let to_path = Self::join_path(&to_dir, to_name);
 
-        {
-            let fs = self.fs.lock().await;
-            fs.rename(&from_path, &to_path)
-                .await
-                .map_err(|_| nfsstat3::NFS3ERR_IO)?;
-        }
-
-        self.inode_map
-            .write()
+        self.fs
+            .rename(&from_path, &to_path)
             .await
-            .rename_path(&from_path, &to_path);
+            .map_err(|_| nfsstat3::NFS3ERR_IO)?;
+
+        let mut inode_map = self.inode_map.write().unwrap();
+        // A file the rename replaced is gone
+        if let Some(replaced) = inode_map.get_ino(&to_path) {
+            self.handles.remove(replaced);
+        }
+        inode_map.rename_path(&from_path, &to_path);
         Ok(())
     }
 
@@ -400,15 +554,16 @@ impl NFSFileSystem for AgentNFS {
         start_after: fileid3,
         max_entries: usize,
     ) -> Result<ReadDirResult, nfsstat3> {
-        let dir_path = self.get_path(dirid).await?;
+        let _op = self.op_lock.read().await;
+        let dir_path = self.get_path(dirid)?;
+        let dir_ino = self.inode_map.read().unwrap().get_fs_ino(dirid);
 
-        let entries = {
-            let fs = self.fs.lock().await;
-            fs.readdir_plus(&dir_path)
-                .await
-                .map_err(|_| nfsstat3::NFS3ERR_IO)?
-                .ok_or(nfsstat3::NFS3ERR_NOENT)?
-        };
+        let entries = match dir_ino {
+            Some(ino) => self.fs.readdir_inode(ino).await,
+            None => self.fs.readdir_plus(&dir_path).await,
+        }
+        .map_err(|_| nfsstat3::NFS3ERR_IO)?
+        .ok_or(nfsstat3::NFS3ERR_NOENT)?;
 
         let mut result = ReadDirResult {
             entries: Vec::new(),
@@ -419,9 +574,10 @@ impl NFSFileSystem for AgentNFS {
         let mut skip = start_after > 0;
         let mut skipped_count = 0;
 
+        let mut inode_map = self.inode_map.write().unwrap();
         for entry in &entries {
             let entry_path = Self::join_path(&dir_path, &entry.name);
-            let ino = self.inode_map.write().await.get_or_create_ino(&entry_path);
+            let ino = inode_map.record(&entry_path, &entry.stats);
 
             if skip {
                 if ino == start_after {
@@ -455,28 +611,32 @@ impl NFSFileSystem for AgentNFS {
         symlink: &nfspath3,
         _attr: &sattr3,
     ) -> Result<(fileid3, fattr3), nfsstat3> {
-        let dir_path = self.get_path(dirid).await?;
+        let _op = self.op_lock.write().await;
+        let dir_path = self.get_path(dirid)?;
         let name = std::str::from_utf8(linkname).map_err(|_| nfsstat3::NFS3ERR_INVAL)?;
         let target = std::str::from_utf8(symlink).map_err(|_| nfsstat3::NFS3ERR_INVAL)?;
         let full_path = Self::join_path(&dir_path, name);
 
-        {
-            let fs = self.fs.lock().await;
-            fs.symlink(target, &full_path)
-                .await
-                .map_err(|_| nfsstat3::NFS3ERR_IO)?;
-        }
+        self.fs
+            .symlink(target, &full_path)
+            .await
+            .map_err(|_| nfsstat3::NFS3ERR_IO)?;
 
-        let ino = self.inode_map.write().await.get_or_create_ino(&full_path);
-        let attr = self.getattr(ino).await?;
+        let ino = self
+            .inode_map
+            .write()
+            .unwrap()
+            .get_or_create_ino(&full_path);
+        let attr = self.attr(ino).await?;
         Ok((ino, attr))
     }
 
     async fn readlink(&self, id: fileid3) -> Result<nfspath3, nfsstat3> {
-        let path = self.get_path(id).await?;
+        let _op = self.op_lock.read().await;
+        let path = self.get_path(id)?;
 
-        let fs = self.fs.lock().await;
-        let target = fs
+        let target = self
+            .fs
             .readlink(&path)
             .await
             .map_err(|_| nfsstat3::NFS3ERR_IO)?
@@ -485,3 +645,49 @@ impl NFSFileSystem for AgentNFS {
         Ok(target.into_bytes().into())
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use agentfs_sdk::filesystem::{AgentFS, HostFS, OverlayFS};
+    use tempfile::tempdir;
+
+    #[tokio::test]
+    async fn test_write_then_read_base_layer_file() {
+        let base_dir = tempdir().unwrap();
+        std::fs::write(base_dir.path().join("base.txt"), b"base content").unwrap();
+        let delta_dir = tempdir().unwrap();
+        let db_path = delta_dir.path().join("delta.db");
+        let delta = AgentFS::new(db_path.to_str().unwrap()).await.unwrap();
+        let base = Arc::new(HostFS::new(base_dir.path()).unwrap());
+        let overlay = OverlayFS::new(base, delta);
+        overlay
+            .init(base_dir.path().to_str().unwrap())
+            .await
+            .unwrap();
+        let nfs = AgentNFS::new(Arc::new(overlay), 0, 0);
+
+        let id = nfs
+            .lookup(ROOT_INO, &b"base.txt".as_slice().into())
+            .await
+            .unwrap();
+        // Caches a handle opened on the base layer
+        let (data, _) = nfs.read(id, 0, 64).await.unwrap();
+        assert_eq!(data, b"base content");
+
+        let attr = nfs.write(id, 12, b" and more").await.unwrap();
+        assert_eq!(attr.size, 21);
+        let (data, eof) = nfs.read(id, 0, 64).await.unwrap();
+        assert_eq!(data, b"base content and more");
+        assert!(eof);
+
+        let attr = nfs.write(id, 0, b"BASE").await.unwrap();
+        assert_eq!(attr.size, 21);
+        let (data, _) = nfs.read(id, 0, 64).await.unwrap();
+        assert_eq!(data, b"BASE content and more");
+        assert_eq!(
+            std::fs::read(base_dir.path().join("base.txt")).unwrap(),
+            b"base content"
+        );
+    }
+}
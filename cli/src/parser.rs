@@ -49,6 +49,23 @@ pub enum Command {
         #[arg(long)]
         base: Option<PathBuf>,
 
+        /// Fork from an existing agent (ID or database path) without copying it
+        #[arg(long, value_name = "ID_OR_PATH", conflicts_with = "base", add = ArgValueCompleter::new(id_or_path_completer))]
+        from: Option<String>,
+
+        /// Store identical file chunks only once
+        #[arg(long)]
+        dedup: bool,
+
+        /// Compress file chunks with this codec
+        #[arg(long, value_parser = ["zstd"])]
+        compression: Option<String>,
+
+        /// Store large files in extents of up to 1 MiB instead of one row per
+        /// chunk (not readable by the Python and TypeScript SDKs)
+        #[arg(long)]
+        extents: bool,
+
         #[command(flatten)]
         sync: SyncCommandOptions,
     },
@@ -93,6 +110,12 @@ pub enum Command {
         #[arg(long = "strace")]
         strace: bool,
 
+        /// Stop only on syscalls that take a path or file descriptor, letting
+        /// the rest run natively through a seccomp filter.
+        /// Only used with --experimental-sandbox
+        #[arg(long = "seccomp")]
+        seccomp: bool,
+
         /// Session identifier for sharing delta layer across multiple runs.
         /// If not provided, a unique session ID is generated for each run.
         /// Use the same session ID to share the delta layer between runs.
@@ -135,6 +158,28 @@ pub enum Command {
         /// Group ID to report for all files (defaults to current group)
         #[arg(long)]
         gid: Option<u32>,
+
+        /// Keep the kernel page cache and readdir cache across opens
+        #[arg(long)]
+        keep_cache: bool,
+
+        /// Seconds the kernel may cache file attributes (default: until invalidated)
+        #[arg(long, value_name = "SECS")]
+        attr_timeout: Option<u64>,
+
+        /// Seconds the kernel may cache name lookups (default: until invalidated)
+        #[arg(long, value_name = "SECS")]
+        entry_timeout: Option<u64>,
+
+        /// Seconds the kernel may cache failed name lookups, 0 to disable
+        /// (default: same as --entry-timeout)
+        #[arg(long, value_name = "SECS")]
+        negative_timeout: Option<u64>,
+
+        /// Serve filesystem metrics over HTTP on this address (e.g. 127.0.0.1:9100),
+        /// in Prometheus format at /metrics and as JSON at /metrics.json
+        #[arg(long, value_name = "ADDR")]
+        metrics_listen: Option<String>,
     },
     /// Show differences between base filesystem and delta (overlay mode only)
     Diff {
@@ -160,9 +205,13 @@ pub enum Command {
         #[arg(long, value_parser = ["pending", "success", "error"])]
         status: Option<String>,
 
-        /// Output format
-        #[arg(long, default_value = "table", value_parser = ["table", "json"])]
+        /// Output format (ndjson prints one JSON object per line)
+        #[arg(long, default_value = "table", value_parser = ["table", "json", "ndjson"])]
         format: String,
+
+        /// Keep running and print tool calls as they are recorded
+        #[arg(short = 'f', long)]
+        follow: bool,
     },
     /// Start an NFS server to export an AgentFS filesystem over the network
     /// (deprecated: use `agentfs serve nfs` instead)
@@ -16,7 +16,10 @@
 //! bypassing the FUSE mount entirely.
 
 use super::group_paths_by_parent;
-use agentfs_sdk::{AgentFS, AgentFSOptions, FileSystem, HostFS, OverlayFS};
+use agentfs_sdk::{
+    filesystem::overlayfs::NEGATIVE_ENTRY_TTL, AgentFS, AgentFSOptions, FileSystem, HostFS,
+    OverlayFS, DEFAULT_WRITE_BUFFER_BYTES,
+};
 use anyhow::{bail, Context, Result};
 use std::{
     cmp::Reverse,
@@ -41,7 +44,7 @@ static CHILD_PID: AtomicI32 = AtomicI32::new(0);
 /// First signal forwards to child, second signal sends SIGKILL.
 static TERM_SIGNAL_COUNT: AtomicI32 = AtomicI32::new(0);
 
-use crate::fuse::FuseMountOptions;
+use crate::fuse::{FuseMountOptions, DEFAULT_TTL};
 
 /// Exit code returned when exec fails (standard shell convention for "command not found")
 const EXIT_COMMAND_NOT_FOUND: i32 = 127;
@@ -195,8 +198,16 @@ pub async fn run_cmd(
             .context("Failed to get mountpoint inode")?;
         hostfs.with_fuse_mountpoint(mountpoint_inode)
     };
+    let hostfs = hostfs
+        .with_metadata_cache()
+        .context("Failed to watch the base directory")?;
 
     let base = Arc::new(hostfs);
+    // FUSE flushes every handle on close, so small writes can be coalesced
+    // in memory until then
+    agentfs
+        .fs
+        .set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
     let overlay = OverlayFS::new(base, agentfs.fs);
 
     let cwd_str = cwd
@@ -221,6 +232,14 @@ pub async fn run_cmd(
         fsname: format!("agentfs:{}", session.run_id),
         uid: Some(uid),
         gid: Some(gid),
+        // The sandbox is the only writer to its mount, and build tools
+        // re-read the same headers and libraries many times.
+        keep_cache: true,
+        attr_timeout: DEFAULT_TTL,
+        entry_timeout: DEFAULT_TTL,
+        // Files created on the host show up in the base layer without the
+        // kernel being told
+        negative_timeout: NEGATIVE_ENTRY_TTL,
     };
 
     // Start FUSE in a separate thread
@@ -4,14 +4,14 @@
 //! virtualization. This is experimental and requires root or CAP_SYS_PTRACE.
 
 use agentfs_sandbox::{
-    init_fd_tables, init_mount_table, init_strace, MountTable, Sandbox, SqliteVfs,
+    init_fd_tables, init_mount_table, init_seccomp, init_strace, MountTable, Sandbox, SqliteVfs,
 };
 use reverie_process::Command;
 use reverie_ptrace::TracerBuilder;
 use std::{path::PathBuf, sync::Arc};
 
 /// Run a command using the experimental ptrace-based syscall interception sandbox.
-pub async fn run_cmd(strace: bool, command: PathBuf, args: Vec<String>) {
+pub async fn run_cmd(strace: bool, seccomp: bool, command: PathBuf, args: Vec<String>) {
     eprintln!("Welcome to AgentFS!");
     eprintln!();
 
@@ -37,6 +37,7 @@ pub async fn run_cmd(strace: bool, command: PathBuf, args: Vec<String>) {
     init_mount_table(mount_table);
     init_fd_tables();
     init_strace(strace);
+    init_seccomp(seccomp);
 
     let mut cmd = Command::new(command);
     for arg in args {
@@ -0,0 +1,92 @@
+#include "stress-common.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DEFAULT_WORKERS 8
+#define DEFAULT_ITERATIONS 200
+
+static void usage(const char *prog) {
+    fprintf(stderr, "Usage: %s [-t threads | -p processes] [-n iterations] <base_path>\n", prog);
+    fprintf(stderr, "Example: %s -p 8 /sandbox\n", prog);
+}
+
+int main(int argc, char *argv[]) {
+    struct stress_opts opts = {
+        .workers = DEFAULT_WORKERS,
+        .iterations = DEFAULT_ITERATIONS,
+    };
+    int opt;
+
+    while ((opt = getopt(argc, argv, "t:p:n:")) != -1) {
+        switch (opt) {
+        case 't':
+            opts.workers = atoi(optarg);
+            opts.processes = 0;
+            break;
+        case 'p':
+            opts.workers = atoi(optarg);
+            opts.processes = 1;
+            break;
+        case 'n':
+            opts.iterations = atol(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind + 1 != argc || opts.workers <= 0 || opts.iterations <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    opts.base_path = argv[optind];
+
+    /* Define all test cases */
+    const struct stress_test *tests[] = {
+        &stress_append,
+        &stress_copyup,
+        &stress_readdir,
+    };
+
+    int num_tests = sizeof(tests) / sizeof(tests[0]);
+    int passed = 0;
+    int failed = 0;
+
+    printf("Running stress tests with base_path: %s\n", opts.base_path);
+    printf("Workers: %d %s, %ld iterations each\n", opts.workers,
+           opts.processes ? "processes" : "threads", opts.iterations);
+    printf("===========================================\n\n");
+
+    /* Run all tests */
+    for (int i = 0; i < num_tests; i++) {
+        printf("Running test: %s\n", tests[i]->name);
+        fflush(stdout);
+
+        if (stress_run(tests[i], &opts) == 0) {
+            printf(COLOR_GREEN "PASS: %s" COLOR_RESET "\n\n", tests[i]->name);
+            passed++;
+        } else {
+            printf(COLOR_RED "FAIL: %s" COLOR_RESET "\n\n", tests[i]->name);
+            failed++;
+        }
+    }
+
+    /* Print summary */
+    printf("===========================================\n");
+    printf("Test Summary:\n");
+    printf("  Total:  %d\n", num_tests);
+    printf("  " COLOR_GREEN "Passed: %d" COLOR_RESET "\n", passed);
+    if (failed > 0) {
+        printf("  " COLOR_RED "Failed: %d" COLOR_RESET "\n", failed);
+    } else {
+        printf("  Failed: %d\n", failed);
+    }
+    printf("===========================================\n");
+
+    if (failed == 0) {
+        printf(COLOR_GREEN "All tests passed!" COLOR_RESET "\n");
+    }
+
+    return (failed == 0) ? 0 : 1;
+}
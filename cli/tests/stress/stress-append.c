@@ -0,0 +1,124 @@
+#define _GNU_SOURCE
+#include "stress-common.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * Parallel O_APPEND writers.
+ *
+ * Every worker appends fixed-size records to one shared file. Appends on a
+ * single file must not overwrite or tear each other, so afterwards the file
+ * holds exactly every record, each intact, with each worker's records in
+ * the order it wrote them.
+ */
+
+#define RECORD_SIZE 64
+
+struct append_ctx {
+    char path[512];
+};
+
+static void format_record(char *record, int worker, long seq) {
+    int n = snprintf(record, RECORD_SIZE, "worker=%04d seq=%08ld ", worker, seq);
+    memset(record + n, 'x', RECORD_SIZE - n - 1);
+    record[RECORD_SIZE - 1] = '\n';
+}
+
+static int append_setup(const struct stress_opts *opts, void **ctx) {
+    struct append_ctx *c = calloc(1, sizeof(*c));
+    TEST_ASSERT(c != NULL, "allocate test state");
+    *ctx = c;
+
+    snprintf(c->path, sizeof(c->path), "%s/stress-append.log", opts->base_path);
+    int fd = open(c->path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    TEST_ASSERT_ERRNO(fd >= 0, "create stress-append.log");
+    close(fd);
+    return 0;
+}
+
+static int append_worker(struct stress_worker *w) {
+    const struct append_ctx *c = w->ctx;
+    char record[RECORD_SIZE];
+
+    int fd = open(c->path, O_WRONLY | O_APPEND);
+    TEST_ASSERT_ERRNO(fd >= 0, "open stress-append.log with O_APPEND");
+
+    for (long i = 0; i < w->opts->iterations; i++) {
+        format_record(record, w->id, i);
+        long long start = stress_now_ns();
+        ssize_t n = write(fd, record, RECORD_SIZE);
+        stress_sample(w, start);
+        if (n != RECORD_SIZE) {
+            close(fd);
+            TEST_ASSERT_ERRNO(0, "append should write the whole record");
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+static int append_verify(const struct stress_opts *opts, void *ctx) {
+    const struct append_ctx *c = ctx;
+    long records = (long)opts->workers * opts->iterations;
+    struct stat st;
+
+    TEST_ASSERT_ERRNO(stat(c->path, &st) == 0, "stat stress-append.log");
+    if (st.st_size != (off_t)records * RECORD_SIZE) {
+        fprintf(stderr, "  size is %ld, expected %ld\n", (long)st.st_size,
+                records * RECORD_SIZE);
+        TEST_ASSERT(0, "file should hold every appended record");
+    }
+
+    char *data = malloc(st.st_size);
+    long *next_seq = calloc(opts->workers, sizeof(*next_seq));
+    TEST_ASSERT(data != NULL && next_seq != NULL, "allocate verify buffers");
+
+    int fd = open(c->path, O_RDONLY);
+    TEST_ASSERT_ERRNO(fd >= 0, "open stress-append.log for read");
+    off_t done = 0;
+    while (done < st.st_size) {
+        ssize_t n = pread(fd, data + done, st.st_size - done, done);
+        TEST_ASSERT_ERRNO(n > 0, "read back stress-append.log");
+        done += n;
+    }
+    close(fd);
+
+    int ok = 1;
+    char expected[RECORD_SIZE];
+    for (long r = 0; r < records && ok; r++) {
+        const char *record = data + r * RECORD_SIZE;
+        int worker;
+        long seq;
+        if (sscanf(record, "worker=%d seq=%ld ", &worker, &seq) != 2 || worker < 0 ||
+            worker >= opts->workers) {
+            fprintf(stderr, "  record %ld is corrupt\n", r);
+            ok = 0;
+            break;
+        }
+        format_record(expected, worker, seq);
+        if (memcmp(record, expected, RECORD_SIZE) != 0) {
+            fprintf(stderr, "  record %ld is torn\n", r);
+            ok = 0;
+        } else if (seq != next_seq[worker]) {
+            fprintf(stderr, "  record %ld: worker %d wrote seq %ld, expected %ld\n", r, worker,
+                    seq, next_seq[worker]);
+            ok = 0;
+        }
+        next_seq[worker]++;
+    }
+
+    free(data);
+    free(next_seq);
+    TEST_ASSERT(ok, "every record should be intact and in per-worker order");
+    return 0;
+}
+
+const struct stress_test stress_append = {
+    .name = "append",
+    .setup = append_setup,
+    .worker = append_worker,
+    .verify = append_verify,
+    .cleanup = free,
+};
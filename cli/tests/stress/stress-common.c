@@ -0,0 +1,189 @@
+#define _GNU_SOURCE
+#include "stress-common.h"
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+long long stress_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+void stress_sample(struct stress_worker *w, long long start_ns) {
+    if (w->count < w->capacity) {
+        w->samples[w->count++] = stress_now_ns() - start_ns;
+    }
+}
+
+/* Handed to each worker thread or process */
+struct worker_start {
+    const struct stress_test *test;
+    struct stress_worker *worker;
+    /* Read end of the start pipe; reads hit EOF once the run starts */
+    int start_fd;
+};
+
+static int worker_main(const struct worker_start *start) {
+    char c;
+    /* Wait for the write end to close, so all workers start together */
+    while (read(start->start_fd, &c, 1) < 0 && errno == EINTR) {
+    }
+    return start->test->worker(start->worker);
+}
+
+static void *worker_thread(void *arg) {
+    return (void *)(long)worker_main(arg);
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a;
+    long long y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/* Nearest-rank percentile of sorted samples */
+static long long percentile(const long long *sorted, long n, double p) {
+    long rank = (long)(p * n + 0.999999);
+    if (rank < 1) {
+        rank = 1;
+    }
+    if (rank > n) {
+        rank = n;
+    }
+    return sorted[rank - 1];
+}
+
+/* Allocate zeroed memory that forked workers share with the parent */
+static void *shared_alloc(size_t size) {
+    void *p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return p == MAP_FAILED ? NULL : p;
+}
+
+/* Start all workers, wait for them and return how many failed */
+static int run_workers(const struct stress_test *test, const struct stress_opts *opts,
+                       struct stress_worker *workers, long long *elapsed_ns) {
+    struct worker_start *starts = calloc(opts->workers, sizeof(*starts));
+    pthread_t *threads = calloc(opts->workers, sizeof(*threads));
+    pid_t *pids = calloc(opts->workers, sizeof(*pids));
+    int pipe_fds[2];
+    int started = 0;
+    int failed = 0;
+
+    if (!starts || !threads || !pids || pipe(pipe_fds) != 0) {
+        perror("  stress");
+        free(starts);
+        free(threads);
+        free(pids);
+        return opts->workers;
+    }
+
+    for (int i = 0; i < opts->workers; i++) {
+        starts[i].test = test;
+        starts[i].worker = &workers[i];
+        starts[i].start_fd = pipe_fds[0];
+        if (opts->processes) {
+            fflush(NULL);
+            pids[i] = fork();
+            if (pids[i] == 0) {
+                close(pipe_fds[1]);
+                _exit(worker_main(&starts[i]) == 0 ? 0 : 1);
+            }
+            if (pids[i] < 0) {
+                perror("  fork");
+                break;
+            }
+        } else if (pthread_create(&threads[i], NULL, worker_thread, &starts[i]) != 0) {
+            perror("  pthread_create");
+            break;
+        }
+        started++;
+    }
+    failed = opts->workers - started;
+
+    long long start = stress_now_ns();
+    close(pipe_fds[1]);
+    for (int i = 0; i < started; i++) {
+        if (opts->processes) {
+            int status;
+            if (waitpid(pids[i], &status, 0) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+                failed++;
+            }
+        } else {
+            void *result;
+            pthread_join(threads[i], &result);
+            if (result != NULL) {
+                failed++;
+            }
+        }
+    }
+    *elapsed_ns = stress_now_ns() - start;
+
+    close(pipe_fds[0]);
+    free(starts);
+    free(threads);
+    free(pids);
+    return failed;
+}
+
+int stress_run(const struct stress_test *test, const struct stress_opts *opts) {
+    /* Room for the operations of every iteration plus a few extra samples */
+    long capacity = opts->iterations + 16;
+    struct stress_worker *workers = shared_alloc(opts->workers * sizeof(*workers));
+    long long *samples = shared_alloc(opts->workers * capacity * sizeof(*samples));
+    void *ctx = NULL;
+    long long elapsed_ns = 0;
+    int result = -1;
+
+    if (!workers || !samples) {
+        perror("  mmap");
+        goto out;
+    }
+    if (test->setup(opts, &ctx) != 0) {
+        fprintf(stderr, "  %s: setup failed\n", test->name);
+        goto out;
+    }
+
+    for (int i = 0; i < opts->workers; i++) {
+        workers[i].id = i;
+        workers[i].opts = opts;
+        workers[i].ctx = ctx;
+        workers[i].samples = samples + (long)i * capacity;
+        workers[i].capacity = capacity;
+    }
+
+    int failed = run_workers(test, opts, workers, &elapsed_ns);
+    if (failed > 0) {
+        fprintf(stderr, "  %s: %d of %d workers failed\n", test->name, failed, opts->workers);
+    } else if (test->verify(opts, ctx) == 0) {
+        result = 0;
+    }
+
+    /* Pack every worker's samples together for the percentiles */
+    long total = 0;
+    for (int i = 0; i < opts->workers; i++) {
+        memmove(samples + total, workers[i].samples, workers[i].count * sizeof(*samples));
+        total += workers[i].count;
+    }
+    qsort(samples, total, sizeof(*samples), cmp_ll);
+    if (total > 0) {
+        printf("  RESULT %s %s workers=%d samples=%ld wall_ns=%lld p50_ns=%lld p99_ns=%lld max_ns=%lld\n",
+               test->name, opts->processes ? "processes" : "threads", opts->workers, total,
+               elapsed_ns, percentile(samples, total, 0.50), percentile(samples, total, 0.99),
+               samples[total - 1]);
+    }
+
+out:
+    if (test->cleanup && ctx) {
+        test->cleanup(ctx);
+    }
+    if (workers) {
+        munmap(workers, opts->workers * sizeof(*workers));
+    }
+    if (samples) {
+        munmap(samples, opts->workers * capacity * sizeof(*samples));
+    }
+    return result;
+}
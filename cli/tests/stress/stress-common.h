@@ -0,0 +1,88 @@
+#ifndef STRESS_COMMON_H
+#define STRESS_COMMON_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+/*
+ * Shared harness for the concurrency stress tests.
+ *
+ * A test prepares its fixtures once, then runs the same worker function on
+ * several threads or, with -p, several processes, all started together.
+ * Workers record the latency of the operations under test; afterwards the
+ * test checks the combined result and the harness reports the wall-clock
+ * time and latency percentiles of the run.
+ */
+
+/* Color codes for output */
+#define COLOR_GREEN "\033[0;32m"
+#define COLOR_RED "\033[0;31m"
+#define COLOR_RESET "\033[0m"
+
+/* Test assertion macros */
+#define TEST_ASSERT(condition, message) do { \
+    if (!(condition)) { \
+        fprintf(stderr, COLOR_RED "FAIL: %s" COLOR_RESET "\n", message); \
+        fprintf(stderr, "  at %s:%d\n", __FILE__, __LINE__); \
+        return -1; \
+    } \
+} while (0)
+
+#define TEST_ASSERT_ERRNO(condition, message) do { \
+    if (!(condition)) { \
+        fprintf(stderr, COLOR_RED "FAIL: %s" COLOR_RESET "\n", message); \
+        fprintf(stderr, "  errno=%d (%s) at %s:%d\n", errno, strerror(errno), __FILE__, __LINE__); \
+        return -1; \
+    } \
+} while (0)
+
+struct stress_opts {
+    const char *base_path;
+    /* Number of workers */
+    int workers;
+    /* Whether workers are processes rather than threads */
+    int processes;
+    /* Operations per worker */
+    long iterations;
+};
+
+/* One worker; lives in shared memory so process workers can report back */
+struct stress_worker {
+    int id;
+    const struct stress_opts *opts;
+    /* Test state set up before the workers start, read-only while they run */
+    void *ctx;
+    long long *samples;
+    long capacity;
+    long count;
+};
+
+struct stress_test {
+    const char *name;
+    /* Prepare fixtures and test state; return -1 on error */
+    int (*setup)(const struct stress_opts *opts, void **ctx);
+    /* One worker's share of the load; return -1 on error */
+    int (*worker)(struct stress_worker *w);
+    /* Check the combined result once all workers are done; return -1 on error */
+    int (*verify)(const struct stress_opts *opts, void *ctx);
+    /* Optional: release test state */
+    void (*cleanup)(void *ctx);
+};
+
+/* Monotonic clock in nanoseconds */
+long long stress_now_ns(void);
+
+/* Record the latency of an operation that started at `start_ns` */
+void stress_sample(struct stress_worker *w, long long start_ns);
+
+/* Run a test and print its result line; return 0 if it passed */
+int stress_run(const struct stress_test *test, const struct stress_opts *opts);
+
+/* Stress tests */
+extern const struct stress_test stress_append;
+extern const struct stress_test stress_copyup;
+extern const struct stress_test stress_readdir;
+
+#endif /* STRESS_COMMON_H */
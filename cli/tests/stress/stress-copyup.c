@@ -0,0 +1,159 @@
+#define _GNU_SOURCE
+#include "stress-common.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * Concurrent copy-up of one file.
+ *
+ * All workers open the same pre-existing file for writing at once and then
+ * write their own blocks of it. In an overlay the file lives in the base
+ * layer, so the opens race to copy it up to the delta layer. Afterwards
+ * every block written must hold its writer's data and every other byte
+ * must be unchanged.
+ *
+ * The harness should create "stress-copyup.bin" in the base layer; it is
+ * created here if missing, which still tests the concurrent writes.
+ */
+
+#define BLOCK_SIZE 4096
+#define DEFAULT_FILE_SIZE (8 * 1024 * 1024)
+
+struct copyup_ctx {
+    char path[512];
+    /* Content before the run */
+    unsigned char *original;
+    off_t size;
+    /* Blocks written by each worker */
+    long blocks_per_worker;
+};
+
+static unsigned char block_pattern(long block) {
+    return (unsigned char)(block * 7 + 1);
+}
+
+static int read_all(const char *path, unsigned char *buf, off_t size) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    off_t done = 0;
+    while (done < size) {
+        ssize_t n = pread(fd, buf + done, size - done, done);
+        if (n <= 0) {
+            close(fd);
+            return -1;
+        }
+        done += n;
+    }
+    close(fd);
+    return 0;
+}
+
+static int copyup_setup(const struct stress_opts *opts, void **ctx) {
+    struct copyup_ctx *c = calloc(1, sizeof(*c));
+    TEST_ASSERT(c != NULL, "allocate test state");
+    *ctx = c;
+    struct stat st;
+
+    snprintf(c->path, sizeof(c->path), "%s/stress-copyup.bin", opts->base_path);
+    if (stat(c->path, &st) != 0) {
+        printf("  Note: stress-copyup.bin not found, creating it (no copy-up)\n");
+        int fd = open(c->path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+        TEST_ASSERT_ERRNO(fd >= 0, "create stress-copyup.bin");
+        unsigned char block[BLOCK_SIZE];
+        for (long b = 0; b < DEFAULT_FILE_SIZE / BLOCK_SIZE; b++) {
+            memset(block, (int)(b & 0xff), sizeof(block));
+            TEST_ASSERT_ERRNO(write(fd, block, sizeof(block)) == sizeof(block),
+                              "fill stress-copyup.bin");
+        }
+        close(fd);
+        TEST_ASSERT_ERRNO(stat(c->path, &st) == 0, "stat stress-copyup.bin");
+    }
+
+    /* Reading doesn't copy the file up */
+    c->size = st.st_size;
+    c->original = malloc(c->size);
+    TEST_ASSERT(c->original != NULL, "allocate original content");
+    TEST_ASSERT_ERRNO(read_all(c->path, c->original, c->size) == 0,
+                      "read original stress-copyup.bin");
+
+    c->blocks_per_worker = (c->size / BLOCK_SIZE) / opts->workers;
+    if (c->blocks_per_worker > opts->iterations) {
+        c->blocks_per_worker = opts->iterations;
+    }
+    TEST_ASSERT(c->blocks_per_worker > 0, "stress-copyup.bin should have a block per worker");
+    return 0;
+}
+
+static int copyup_worker(struct stress_worker *w) {
+    const struct copyup_ctx *c = w->ctx;
+    unsigned char block[BLOCK_SIZE];
+
+    long long start = stress_now_ns();
+    int fd = open(c->path, O_WRONLY);
+    stress_sample(w, start);
+    TEST_ASSERT_ERRNO(fd >= 0, "open stress-copyup.bin for write");
+
+    /* Worker i owns blocks i, i + workers, i + 2 * workers, ... */
+    for (long i = 0; i < c->blocks_per_worker; i++) {
+        long b = i * w->opts->workers + w->id;
+        memset(block, block_pattern(b), sizeof(block));
+        start = stress_now_ns();
+        ssize_t n = pwrite(fd, block, sizeof(block), (off_t)b * BLOCK_SIZE);
+        stress_sample(w, start);
+        if (n != BLOCK_SIZE) {
+            close(fd);
+            TEST_ASSERT_ERRNO(0, "pwrite should write the whole block");
+        }
+    }
+
+    close(fd);
+    return 0;
+}
+
+static int copyup_verify(const struct stress_opts *opts, void *ctx) {
+    const struct copyup_ctx *c = ctx;
+    long written = c->blocks_per_worker * opts->workers;
+    struct stat st;
+
+    TEST_ASSERT_ERRNO(stat(c->path, &st) == 0, "stat stress-copyup.bin");
+    TEST_ASSERT(st.st_size == c->size, "size should not change");
+
+    unsigned char *data = malloc(c->size);
+    TEST_ASSERT(data != NULL, "allocate verify buffer");
+    if (read_all(c->path, data, c->size) != 0) {
+        free(data);
+        TEST_ASSERT_ERRNO(0, "read back stress-copyup.bin");
+    }
+
+    int ok = 1;
+    for (off_t off = 0; off < c->size && ok; off++) {
+        long b = off / BLOCK_SIZE;
+        unsigned char expected = b < written ? block_pattern(b) : c->original[off];
+        if (data[off] != expected) {
+            fprintf(stderr, "  byte %ld (block %ld) is %u, expected %u\n", (long)off, b,
+                    data[off], expected);
+            ok = 0;
+        }
+    }
+
+    free(data);
+    TEST_ASSERT(ok, "written blocks should be new and the rest unchanged");
+    return 0;
+}
+
+static void copyup_cleanup(void *ctx) {
+    struct copyup_ctx *c = ctx;
+    free(c->original);
+    free(c);
+}
+
+const struct stress_test stress_copyup = {
+    .name = "copyup",
+    .setup = copyup_setup,
+    .worker = copyup_worker,
+    .verify = copyup_verify,
+    .cleanup = copyup_cleanup,
+};
@@ -0,0 +1,161 @@
+#define _GNU_SOURCE
+#include "stress-common.h"
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+/*
+ * readdir during create/unlink.
+ *
+ * Even workers create and unlink files in one directory while odd workers
+ * list it. Entries that exist for the whole run must show up in every
+ * listing exactly once, and no listing may return a name twice, whatever
+ * happens to the entries around them. Latencies are those of complete
+ * listings.
+ */
+
+#define STABLE_ENTRIES 64
+
+struct readdir_ctx {
+    char dir[512];
+};
+
+static int cmp_str(const void *a, const void *b) {
+    return strcmp(*(char *const *)a, *(char *const *)b);
+}
+
+/*
+ * List the directory once. Returns the number of stable entries seen, or -1
+ * if a name was listed twice or the listing failed.
+ */
+static int list_once(const char *dir, int *churn_seen) {
+    DIR *d = opendir(dir);
+    if (!d) {
+        return -1;
+    }
+    size_t cap = 256, n = 0;
+    char **names = malloc(cap * sizeof(*names));
+    struct dirent *entry;
+    int stable = 0, result = 0;
+
+    while (names && (entry = readdir(d)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (n == cap) {
+            cap *= 2;
+            char **grown = realloc(names, cap * sizeof(*names));
+            if (!grown) {
+                break;
+            }
+            names = grown;
+        }
+        names[n++] = strdup(entry->d_name);
+        if (strncmp(entry->d_name, "stable-", 7) == 0) {
+            stable++;
+        } else if (churn_seen && strncmp(entry->d_name, "churn-", 6) == 0) {
+            (*churn_seen)++;
+        }
+    }
+    closedir(d);
+    if (!names) {
+        return -1;
+    }
+
+    qsort(names, n, sizeof(*names), cmp_str);
+    for (size_t i = 0; i < n; i++) {
+        if (i > 0 && strcmp(names[i - 1], names[i]) == 0) {
+            fprintf(stderr, "  %s listed twice\n", names[i]);
+            result = -1;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        free(names[i]);
+    }
+    free(names);
+    return result < 0 ? -1 : stable;
+}
+
+static int readdir_setup(const struct stress_opts *opts, void **ctx) {
+    struct readdir_ctx *c = calloc(1, sizeof(*c));
+    TEST_ASSERT(c != NULL, "allocate test state");
+    *ctx = c;
+    char path[1024];
+
+    snprintf(c->dir, sizeof(c->dir), "%s/stress-readdir", opts->base_path);
+    TEST_ASSERT_ERRNO(mkdir(c->dir, 0755) == 0 || errno == EEXIST, "mkdir stress-readdir");
+
+    /* Drop churn entries left behind by an interrupted run */
+    DIR *d = opendir(c->dir);
+    TEST_ASSERT_ERRNO(d != NULL, "opendir stress-readdir");
+    struct dirent *entry;
+    while ((entry = readdir(d)) != NULL) {
+        if (strncmp(entry->d_name, "churn-", 6) == 0) {
+            snprintf(path, sizeof(path), "%s/%s", c->dir, entry->d_name);
+            unlink(path);
+        }
+    }
+    closedir(d);
+
+    for (int i = 0; i < STABLE_ENTRIES; i++) {
+        snprintf(path, sizeof(path), "%s/stable-%02d", c->dir, i);
+        int fd = open(path, O_WRONLY | O_CREAT, 0644);
+        TEST_ASSERT_ERRNO(fd >= 0, "create stable entry");
+        close(fd);
+    }
+    return 0;
+}
+
+static int churn(const struct readdir_ctx *c, int worker, long i) {
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/churn-%d-%ld", c->dir, worker, i);
+    int fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+    TEST_ASSERT_ERRNO(fd >= 0, "create churn entry");
+    close(fd);
+    TEST_ASSERT_ERRNO(unlink(path) == 0, "unlink churn entry");
+    return 0;
+}
+
+static int readdir_worker(struct stress_worker *w) {
+    const struct readdir_ctx *c = w->ctx;
+    /* A single worker takes both roles */
+    int lister = w->id % 2 == 1 || w->opts->workers == 1;
+    int churner = w->id % 2 == 0;
+
+    for (long i = 0; i < w->opts->iterations; i++) {
+        if (churner && churn(c, w->id, i) != 0) {
+            return -1;
+        }
+        if (lister) {
+            long long start = stress_now_ns();
+            int stable = list_once(c->dir, NULL);
+            stress_sample(w, start);
+            if (stable != STABLE_ENTRIES) {
+                fprintf(stderr, "  listing %ld saw %d of %d stable entries\n", i, stable,
+                        STABLE_ENTRIES);
+                TEST_ASSERT(0, "every listing should return each entry once");
+            }
+        }
+    }
+    return 0;
+}
+
+static int readdir_verify(const struct stress_opts *opts, void *ctx) {
+    const struct readdir_ctx *c = ctx;
+    int churn_seen = 0;
+    (void)opts;
+
+    int stable = list_once(c->dir, &churn_seen);
+    TEST_ASSERT(stable == STABLE_ENTRIES, "final listing should hold every stable entry");
+    TEST_ASSERT(churn_seen == 0, "final listing should hold no unlinked entries");
+    return 0;
+}
+
+const struct stress_test stress_readdir = {
+    .name = "readdir",
+    .setup = readdir_setup,
+    .worker = readdir_worker,
+    .verify = readdir_verify,
+    .cleanup = free,
+};
@@ -62,7 +62,34 @@ echo "$output" | grep -q "Created agent filesystem: .agentfs/$TEST_AGENT_ID.db"
     exit 1
 }
 
-# Cleanup test database only
+# Test: Forking an existing agent
+FORK_ID="${TEST_AGENT_ID}-fork"
+rm -f ".agentfs/${FORK_ID}.db" ".agentfs/${FORK_ID}.db-shm" ".agentfs/${FORK_ID}.db-wal"
+if ! output=$(cargo run -- init "$FORK_ID" --from "$TEST_AGENT_ID" 2>&1); then
+    echo "FAILED: init --from command failed"
+    echo "Output was: $output"
+    rm -f .agentfs/${TEST_AGENT_ID}*
+    exit 1
+fi
+
+echo "$output" | grep -q "Created forked filesystem: .agentfs/$FORK_ID.db" || {
+    echo "FAILED: Expected fork message not found in init --from output"
+    echo "Output was: $output"
+    rm -f .agentfs/${TEST_AGENT_ID}*
+    exit 1
+}
+
+# Test: Forking from a missing agent should fail
+if cargo run -- init --from "${TEST_AGENT_ID}-missing" 2>&1 | grep -q "not found"; then
+    : # Expected behavior
+else
+    echo "FAILED: init --from should fail when the parent does not exist"
+    rm -f .agentfs/${TEST_AGENT_ID}*
+    exit 1
+fi
+
+# Cleanup test databases only
+rm -f ".agentfs/${FORK_ID}.db" ".agentfs/${FORK_ID}.db-shm" ".agentfs/${FORK_ID}.db-wal"
 rm -f ".agentfs/${TEST_AGENT_ID}.db" ".agentfs/${TEST_AGENT_ID}.db-shm" ".agentfs/${TEST_AGENT_ID}.db-wal"
 
 echo "OK"
@@ -131,6 +131,31 @@ if [ "$DIR_LINKED_CONTENT" != "nested file" ]; then
     exit 1
 fi
 
+# Test that cached entries below a renamed directory still resolve
+cat "$MOUNTPOINT/testdir/nested.txt" > /dev/null
+mv "$MOUNTPOINT/testdir" "$MOUNTPOINT/renamed"
+RENAMED_CONTENT=$(cat "$MOUNTPOINT/renamed/nested.txt")
+if [ "$RENAMED_CONTENT" != "nested file" ]; then
+    echo "FAILED: reading below renamed directory failed"
+    echo "Expected: nested file"
+    echo "Got: $RENAMED_CONTENT"
+    kill $MOUNT_PID 2>/dev/null || true
+    exit 1
+fi
+
+# Test that a directory larger than one readdir reply lists every entry once
+mkdir "$MOUNTPOINT/bigdir"
+(cd "$MOUNTPOINT/bigdir" && seq -f "entry-%05g" 1 3000 | xargs touch)
+LISTED=$(ls -f "$MOUNTPOINT/bigdir" | grep -c '^entry-')
+UNIQUE=$(ls -f "$MOUNTPOINT/bigdir" | grep '^entry-' | sort -u | wc -l)
+if [ "$LISTED" != "3000" ] || [ "$UNIQUE" != "3000" ]; then
+    echo "FAILED: large directory listing mismatch"
+    echo "Expected: 3000 unique entries"
+    echo "Got: $LISTED entries, $UNIQUE unique"
+    kill $MOUNT_PID 2>/dev/null || true
+    exit 1
+fi
+
 # Unmount
 fusermount -u "$MOUNTPOINT"
 
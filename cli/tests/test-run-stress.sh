@@ -0,0 +1,106 @@
+#!/bin/sh
+#
+# Concurrency stress tests through agentfs run (FUSE overlay).
+#
+# Runs the stress tests (parallel O_APPEND writers, concurrent copy-up of
+# one base-layer file, readdir during create/unlink) with worker threads
+# and with worker processes, natively and through the overlay, and prints
+# their wall-clock times and p50/p99 latencies side by side.
+#
+# Requires user namespaces support.
+#
+# Usage: test-run-stress.sh [WORKERS] [ITERATIONS]
+#
+set -e
+
+echo -n "TEST stress (agentfs run - FUSE overlay)... "
+
+DIR="$(dirname "$0")"
+WORKERS="${1:-8}"
+ITERATIONS="${2:-200}"
+
+# Compile the test program
+make -C "$DIR/stress" clean > /dev/null 2>&1
+make -C "$DIR/stress" > /dev/null 2>&1
+
+TEST_DB="agent.db"
+NATIVE_DIR=$(mktemp -d)
+# The overlay runs see the current directory as their base layer
+OVERLAY_DIR="stress-fixtures"
+RESULTS=$(mktemp)
+
+cleanup() {
+    rm -rf "$TEST_DB" "${TEST_DB}-wal" "${TEST_DB}-shm" "$NATIVE_DIR" "$OVERLAY_DIR" "$RESULTS"
+}
+trap cleanup EXIT
+
+# Clean up any existing test database
+rm -f "$TEST_DB" "${TEST_DB}-wal" "${TEST_DB}-shm"
+
+# Initialize the database
+cargo run -- init > /dev/null 2>&1
+
+# The file the copy-up test races on must exist before the run
+for dir in "$NATIVE_DIR" "$OVERLAY_DIR"; do
+    mkdir -p "$dir"
+    dd if=/dev/urandom of="$dir/stress-copyup.bin" bs=1M count=8 status=none
+done
+
+# Run the stress tests once and keep their result lines
+#
+#   stress LABEL COMMAND...
+stress() {
+    label="$1"
+    shift
+    if ! output=$("$@" 2>&1); then
+        echo "FAILED ($label)"
+        echo "Output was: $output"
+        exit 1
+    fi
+    echo "$output" | grep -q "All tests passed!" || {
+        echo "FAILED ($label): 'All tests passed!' not found"
+        echo "Output was: $output"
+        exit 1
+    }
+    echo "$output" | grep "RESULT" | sed "s/^ *RESULT/$label/" >> "$RESULTS"
+}
+
+for mode in -t -p; do
+    stress native "$DIR/stress/test-stress" "$mode" "$WORKERS" -n "$ITERATIONS" "$NATIVE_DIR"
+    # Every run gets a fresh delta layer, so the copy-up test copies up again
+    stress agentfs cargo run -- run "$DIR/stress/test-stress" "$mode" "$WORKERS" \
+        -n "$ITERATIONS" "$OVERLAY_DIR"
+done
+
+echo "OK"
+
+# One row per test and mode; latencies in microseconds, times in milliseconds
+awk '
+function field(name,    i, kv) {
+    for (i = 4; i <= NF; i++) {
+        split($i, kv, "=")
+        if (kv[1] == name)
+            return kv[2]
+    }
+}
+{
+    key = $2 " " $3
+    if (!(key in seen)) {
+        seen[key] = 1
+        order[++n] = key
+    }
+    wall[$1, key] = field("wall_ns") / 1e6
+    p50[$1, key] = field("p50_ns") / 1e3
+    p99[$1, key] = field("p99_ns") / 1e3
+}
+END {
+    printf "%-20s %12s %12s %8s %10s %10s %10s %10s\n", "Test", "Native ms", "AgentFS ms", "Ratio",
+        "Nat p50", "AFS p50", "Nat p99", "AFS p99"
+    for (i = 1; i <= n; i++) {
+        k = order[i]
+        ratio = wall["native", k] > 0 ? wall["agentfs", k] / wall["native", k] : 0
+        printf "%-20s %12.1f %12.1f %7.1fx %10.1f %10.1f %10.1f %10.1f\n", k,
+            wall["native", k], wall["agentfs", k], ratio,
+            p50["native", k], p50["agentfs", k], p99["native", k], p99["agentfs", k]
+    }
+}' "$RESULTS"
@@ -0,0 +1,61 @@
+#!/bin/sh
+#
+# Replay one workload REPS times in the current directory and print the
+# wall-clock time of every repetition as "SAMPLE <workload> <ns>".
+#
+# Runs the same way natively and inside `agentfs run`; run.sh sets up the
+# fixtures it expects.
+#
+# Usage: replay.sh WORKLOAD REPS
+#
+set -e
+
+WORKLOAD="$1"
+REPS="$2"
+
+# Time one command and print its sample
+timed() {
+    start=$(date +%s%N)
+    "$@" > /dev/null 2>&1 || {
+        echo "FAILED: $WORKLOAD: $*" >&2
+        exit 1
+    }
+    end=$(date +%s%N)
+    echo "SAMPLE $WORKLOAD $((end - start))"
+}
+
+i=0
+while [ "$i" -lt "$REPS" ]; do
+    case "$WORKLOAD" in
+        git-clone)
+            rm -rf clone
+            timed git clone -q source.git clone
+            ;;
+        git-checkout)
+            # Alternate between the first and the last commit, which differ
+            # in every file
+            if [ $((i % 2)) -eq 0 ]; then rev=first; else rev=main; fi
+            timed git -C checkout checkout -q "$rev"
+            ;;
+        git-status)
+            timed git -C checkout status --porcelain
+            ;;
+        npm-install)
+            rm -rf npm/node_modules
+            timed npm install --prefix npm --no-audit --no-fund --prefer-offline --silent
+            ;;
+        c-build)
+            make -C cbuild -s clean > /dev/null
+            timed make -C cbuild -s -j"$(nproc)"
+            ;;
+        python-import)
+            # The first repetition also writes the bytecode cache
+            timed python3 -c "import sys; sys.path.insert(0, 'pyimport'); import pkg"
+            ;;
+        *)
+            echo "Unknown workload: $WORKLOAD" >&2
+            exit 1
+            ;;
+    esac
+    i=$((i + 1))
+done
@@ -0,0 +1,218 @@
+#!/bin/bash
+#
+# Timed replays of real workloads, natively and through agentfs run:
+#
+#   git-clone      clone a 2000-file repository
+#   git-checkout   switch between two commits that differ in every file
+#   git-status     status of a clean 2000-file working tree
+#   npm-install    install $NPM_PACKAGES (default: express) from the npm cache
+#   c-build        parallel build of 200 generated C files
+#   python-import  import a generated package of 300 modules
+#
+# Each workload is repeated and timed inside its environment, so the
+# startup of `agentfs run` itself is not counted. Prints the total
+# wall-clock time and the p50/p99 of the repetitions for both runs.
+# Workloads whose tools are missing are skipped; npm-install is also
+# skipped if the packages can't be installed natively first.
+#
+# Requires user namespaces support.
+#
+# Usage: ./run.sh [-r REPS] [WORKLOAD...]
+#
+
+set -e
+
+SCRIPT_DIR="$(cd "$(dirname "$0")" && pwd)"
+CLI_DIR="$(cd "$SCRIPT_DIR/../.." && pwd)"
+AGENTFS="$CLI_DIR/target/release/agentfs"
+REPS=10
+NPM_PACKAGES="${NPM_PACKAGES:-express}"
+
+while getopts "r:" opt; do
+    case "$opt" in
+        r) REPS="$OPTARG" ;;
+        *) echo "Usage: $0 [-r REPS] [WORKLOAD...]"; exit 1 ;;
+    esac
+done
+shift $((OPTIND - 1))
+WORKLOADS=("$@")
+if [ ${#WORKLOADS[@]} -eq 0 ]; then
+    WORKLOADS=(git-clone git-checkout git-status npm-install c-build python-import)
+fi
+
+# Check agentfs binary
+if [ ! -x "$AGENTFS" ]; then
+    echo "Error: agentfs binary not found at $AGENTFS"
+    echo "Run: cargo build --release"
+    exit 1
+fi
+
+# Fixtures live under the script directory so that `agentfs run` sees them
+# in its base layer. Native runs get a copy, keeping the fixtures pristine.
+FIXTURES="$SCRIPT_DIR/fixtures.$$"
+NATIVE="$(mktemp -d)"
+trap 'rm -rf "$FIXTURES" "$NATIVE"' EXIT
+mkdir -p "$FIXTURES"
+
+have() {
+    command -v "$1" > /dev/null 2>&1
+}
+
+# Repository with 2000 files in 50 directories and two commits touching
+# all of them, as a bare repository to clone and as a working tree
+make_git_fixtures() {
+    local src="$FIXTURES/src" d f
+    mkdir -p "$src"
+    git -C "$src" init -q
+    git -C "$src" symbolic-ref HEAD refs/heads/main
+    for d in $(seq -w 1 50); do
+        mkdir -p "$src/dir$d"
+        for f in $(seq -w 1 40); do
+            seq 1 200 | sed "s/^/dir$d file$f line /" > "$src/dir$d/file$f.txt"
+        done
+    done
+    git -C "$src" add -A
+    git -C "$src" -c user.name=agentfs -c user.email=agentfs@example.com commit -q -m first
+    git -C "$src" branch first
+    find "$src" -name '*.txt' -exec sh -c 'echo changed >> "$1"' sh {} \;
+    git -C "$src" -c user.name=agentfs -c user.email=agentfs@example.com commit -q -a -m second
+    git clone -q --bare "$src" "$FIXTURES/source.git"
+    git clone -q "$FIXTURES/source.git" "$FIXTURES/checkout"
+    rm -rf "$src"
+}
+
+# 200 C files sharing a header, built by a Makefile with one rule per object
+make_cbuild_fixtures() {
+    local dir="$FIXTURES/cbuild" i
+    mkdir -p "$dir"
+    printf '#include <stdio.h>\n#include <string.h>\n#include <stdlib.h>\n' > "$dir/common.h"
+    for i in $(seq -w 1 200); do
+        echo "int func$i(int x);" >> "$dir/common.h"
+        cat > "$dir/unit$i.c" <<EOF
+#include "common.h"
+
+static int table$i[64];
+
+int func$i(int x) {
+    for (int i = 0; i < 64; i++)
+        table$i[i] = (x * i) ^ $((10#$i));
+    return table$i[x & 63];
+}
+EOF
+    done
+    {
+        echo '#include "common.h"'
+        echo ""
+        echo "int main(void) {"
+        echo "    int sum = 0;"
+        for i in $(seq -w 1 200); do
+            echo "    sum += func$i(sum);"
+        done
+        echo "    printf(\"%d\\n\", sum);"
+        echo "    return 0;"
+        echo "}"
+    } > "$dir/main.c"
+    cat > "$dir/Makefile" <<'EOF'
+CC = cc
+CFLAGS = -O2
+OBJS = $(patsubst %.c,%.o,$(wildcard *.c))
+
+prog: $(OBJS)
+	$(CC) -o $@ $(OBJS)
+
+%.o: %.c common.h
+	$(CC) $(CFLAGS) -c $< -o $@
+
+clean:
+	rm -f prog $(OBJS)
+
+.PHONY: clean
+EOF
+}
+
+# Package of 300 modules, each importing a few standard library modules
+make_python_fixtures() {
+    local dir="$FIXTURES/pyimport/pkg" i
+    mkdir -p "$dir"
+    : > "$dir/__init__.py"
+    for i in $(seq -w 1 300); do
+        echo "from . import mod$i" >> "$dir/__init__.py"
+        cat > "$dir/mod$i.py" <<EOF
+import json
+import re
+
+PATTERN$i = re.compile(r"item-$i-(\\d+)")
+
+
+class Item$i:
+    def __init__(self, value):
+        self.value = value
+
+    def dump(self):
+        return json.dumps({"id": $((10#$i)), "value": self.value})
+
+
+def parse$i(text):
+    return [Item$i(int(m)) for m in PATTERN$i.findall(text)]
+EOF
+    done
+}
+
+# Install once natively to fill the npm cache and write package-lock.json
+make_npm_fixtures() {
+    local dir="$FIXTURES/npm"
+    mkdir -p "$dir"
+    echo '{ "name": "agentfs-workload", "version": "1.0.0", "private": true }' > "$dir/package.json"
+    # shellcheck disable=SC2086
+    npm install --prefix "$dir" --no-audit --no-fund --silent $NPM_PACKAGES > /dev/null 2>&1 || return 1
+    rm -rf "$dir/node_modules"
+}
+
+# Decide which workloads can run and build their fixtures
+SELECTED=()
+for workload in "${WORKLOADS[@]}"; do
+    case "$workload" in
+        git-*) have git && { [ -d "$FIXTURES/source.git" ] || make_git_fixtures; } ;;
+        npm-install) have npm && { [ -d "$FIXTURES/npm" ] || make_npm_fixtures; } ;;
+        c-build) have cc && have make && make_cbuild_fixtures ;;
+        python-import) have python3 && make_python_fixtures ;;
+        *) echo "Unknown workload: $workload"; exit 1 ;;
+    esac && SELECTED+=("$workload") || echo "Skipping $workload: not available"
+done
+cp -a "$FIXTURES/." "$NATIVE/"
+
+# Print "<count> <total> <p50> <p99>" in milliseconds for a list of
+# nanosecond samples
+summarize() {
+    sort -n | awk '
+    { s[++n] = $1; total += $1 }
+    END {
+        r50 = int(0.50 * n + 0.999999); r99 = int(0.99 * n + 0.999999)
+        printf "%d %.1f %.1f %.1f\n", n, total / 1e6, s[r50] / 1e6, s[r99] / 1e6
+    }'
+}
+
+samples() {
+    grep "^SAMPLE" | awk '{print $3}'
+}
+
+echo "Repetitions: $REPS per workload (times in ms)"
+echo "------------------------------------------------------------------------------------------"
+printf "%-15s %12s %12s %8s %10s %10s %10s %10s\n" "Workload" "Native" "AgentFS" "Ratio" \
+    "Nat p50" "AFS p50" "Nat p99" "AFS p99"
+for workload in "${SELECTED[@]}"; do
+    native=$(cd "$NATIVE" && sh "$SCRIPT_DIR/replay.sh" "$workload" "$REPS" | samples | summarize)
+    # Every run gets a fresh delta layer over the pristine fixtures
+    overlay=$(cd "$FIXTURES" && "$AGENTFS" run sh "$SCRIPT_DIR/replay.sh" "$workload" "$REPS" 2>&1 \
+        | samples | summarize)
+    read -r n_count n_total n_p50 n_p99 <<< "$native"
+    read -r a_count a_total a_p50 a_p99 <<< "$overlay"
+    if [ "$n_count" -ne "$REPS" ] || [ "$a_count" -ne "$REPS" ]; then
+        echo "$workload: $n_count native and $a_count agentfs run repetitions of $REPS succeeded"
+        exit 1
+    fi
+    ratio=$(awk -v a="$a_total" -v b="$n_total" 'BEGIN { printf "%.1fx", (b > 0 ? a / b : 0) }')
+    printf "%-15s %12s %12s %8s %10s %10s %10s %10s\n" "$workload" "$n_total" "$a_total" "$ratio" \
+        "$n_p50" "$a_p50" "$n_p99" "$a_p99"
+done
+echo "------------------------------------------------------------------------------------------"
@@ -5,7 +5,7 @@ pub mod syscall;
 pub mod vfs;
 
 #[cfg(target_os = "linux")]
-pub use sandbox::{init_fd_tables, init_mount_table, init_strace, Sandbox};
+pub use sandbox::{init_fd_tables, init_mount_table, init_seccomp, init_strace, Sandbox};
 pub use vfs::{
     bind::BindVfs,
     mount::{MountConfig, MountTable, MountType},
@@ -2,22 +2,90 @@ use crate::{
     syscall,
     vfs::{fdtable::FdTable, mount::MountTable},
 };
-use reverie::{syscalls::Syscall, Error, Guest, Tool};
+use reverie::{
+    syscalls::{Syscall, Sysno},
+    Error, Guest, Subscription, Tool,
+};
 use std::collections::HashMap;
 use std::sync::{
     atomic::{AtomicBool, Ordering},
-    Mutex, OnceLock,
+    OnceLock, RwLock,
 };
 
 /// Global mount table shared across all threads
 static MOUNT_TABLE: OnceLock<MountTable> = OnceLock::new();
 
 /// Global FD tables, one per process (keyed by pid)
-static FD_TABLES: OnceLock<Mutex<HashMap<i32, FdTable>>> = OnceLock::new();
+static FD_TABLES: OnceLock<RwLock<HashMap<i32, FdTable>>> = OnceLock::new();
 
 /// Global flag to enable strace-like output
 static STRACE_ENABLED: AtomicBool = AtomicBool::new(false);
 
+/// Global flag to stop only on syscalls that need virtualization
+static SECCOMP_ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// Syscalls that take neither a path nor a file descriptor.
+///
+/// `dispatch_syscall` passes these through unchanged, so with seccomp
+/// prefiltering they run without stopping in the tracer. Everything else
+/// still stops: fd-based syscalls need their virtual FD translated, and
+/// syscalls the sandbox doesn't know keep failing with ENOSYS instead of
+/// running against untranslated FDs.
+const UNTRACED_SYSCALLS: &[Sysno] = &[
+    // Signals
+    Sysno::rt_sigaction,
+    Sysno::rt_sigprocmask,
+    Sysno::sigaltstack,
+    Sysno::tgkill,
+    Sysno::tkill,
+    Sysno::kill,
+    // Process information
+    Sysno::getpid,
+    Sysno::getppid,
+    Sysno::gettid,
+    Sysno::getuid,
+    Sysno::geteuid,
+    Sysno::getgid,
+    Sysno::getegid,
+    #[cfg(not(target_arch = "aarch64"))]
+    Sysno::getpgrp,
+    Sysno::getpgid,
+    Sysno::setpgid,
+    Sysno::setsid,
+    Sysno::uname,
+    // Waiting for children
+    Sysno::wait4,
+    Sysno::waitid,
+    // Anonymous memory (mmap can map an FD, so it stays traced)
+    Sysno::brk,
+    Sysno::munmap,
+    Sysno::mprotect,
+    Sysno::mremap,
+    Sysno::madvise,
+    #[cfg(not(target_arch = "aarch64"))]
+    Sysno::arch_prctl,
+    // Threading and synchronization
+    Sysno::set_tid_address,
+    Sysno::set_robust_list,
+    Sysno::futex,
+    Sysno::rseq,
+    // Time
+    #[cfg(not(target_arch = "aarch64"))]
+    Sysno::time,
+    Sysno::clock_gettime,
+    Sysno::clock_getres,
+    Sysno::gettimeofday,
+    Sysno::getrandom,
+    // Resource limits and credentials
+    Sysno::prlimit64,
+    Sysno::getrlimit,
+    Sysno::setrlimit,
+    Sysno::setfsuid,
+    Sysno::setfsgid,
+    Sysno::umask,
+    Sysno::prctl,
+];
+
 /// Initialize the global mount table
 ///
 /// This must be called before spawning the traced process.
@@ -37,7 +105,7 @@ fn get_mount_table() -> &'static MountTable {
 /// This must be called before spawning the traced process.
 pub fn init_fd_tables() {
     FD_TABLES
-        .set(Mutex::new(HashMap::new()))
+        .set(RwLock::new(HashMap::new()))
         .expect("FD tables already initialized");
 }
 
@@ -53,18 +121,38 @@ fn is_strace_enabled() -> bool {
     STRACE_ENABLED.load(Ordering::Relaxed)
 }
 
+/// Initialize seccomp prefiltering
+///
+/// When enabled, the tracer only subscribes to syscalls that may need
+/// virtualizing, and reverie's seccomp filter lets the rest run natively.
+/// strace output then only shows the syscalls that stopped.
+///
+/// This must be called before spawning the traced process.
+pub fn init_seccomp(enabled: bool) {
+    SECCOMP_ENABLED.store(enabled, Ordering::Relaxed);
+}
+
+/// Check if seccomp prefiltering is enabled
+fn is_seccomp_enabled() -> bool {
+    SECCOMP_ENABLED.load(Ordering::Relaxed)
+}
+
 /// Get or create an FD table for a specific process
+///
+/// Runs on every syscall, so the common case only takes the shared lock.
 fn get_fd_table(pid: i32) -> FdTable {
     let tables = FD_TABLES.get().expect("FD tables not initialized");
-    let mut tables = tables.lock().unwrap();
+    if let Some(fd_table) = tables.read().unwrap().get(&pid) {
+        return fd_table.clone();
+    }
 
-    tables.entry(pid).or_default().clone()
+    tables.write().unwrap().entry(pid).or_default().clone()
 }
 
 /// Insert an FD table for a specific process (used for fork/clone)
 pub(crate) fn insert_fd_table(pid: i32, fd_table: FdTable) {
     let tables = FD_TABLES.get().expect("FD tables not initialized");
-    let mut tables = tables.lock().unwrap();
+    let mut tables = tables.write().unwrap();
 
     tables.insert(pid, fd_table);
 }
@@ -92,6 +180,16 @@ impl Tool for Sandbox {
     type GlobalState = ();
     type ThreadState = ();
 
+    fn subscriptions(_cfg: &()) -> Subscription {
+        let mut subscription = Subscription::all();
+        if is_seccomp_enabled() {
+            for &sysno in UNTRACED_SYSCALLS {
+                subscription.disable_syscall(sysno);
+            }
+        }
+        subscription
+    }
+
     async fn handle_syscall_event<T: Guest<Self>>(
         &self,
         guest: &mut T,
@@ -1,13 +1,13 @@
 use crate::{
     sandbox::Sandbox,
-    syscall::translate_path,
+    syscall::{memory, translate_path, translate_read_path},
     vfs::{
         fdtable::{FdEntry, FdTable},
         mount::MountTable,
     },
 };
 use reverie::{
-    syscalls::{MemoryAccess, ReadAddr, Syscall},
+    syscalls::{MemoryAccess, Syscall},
     Error, Guest, Stack,
 };
 use std::mem::MaybeUninit;
@@ -27,7 +27,7 @@ pub async fn handle_openat<T: Guest<Sandbox>>(
 ) -> Result<Option<i64>, Error> {
     if let Some(path_addr) = args.path() {
         // Read the original path from guest memory
-        let mut path: std::path::PathBuf = path_addr.read(&guest.memory())?;
+        let mut path = memory::read_path(&guest.memory(), path_addr)?;
 
         // Handle dirfd resolution for relative paths
         let dirfd = args.dirfd();
@@ -87,7 +87,7 @@ pub async fn handle_openat<T: Guest<Sandbox>>(
                 }
             } else {
                 // For passthrough VFS, translate the path and call the kernel
-                let new_path_addr = translate_path(guest, path_addr, mount_table).await?;
+                let new_path_addr = translate_read_path(guest, &path, mount_table).await?;
 
                 let new_syscall = reverie::syscalls::Openat::new()
                     .with_dirfd(kernel_dirfd)
@@ -151,7 +151,7 @@ pub async fn handle_read<T: Guest<Sandbox>>(
 
     // Get the FD entry
     if let Some(entry) = fd_table.get(virtual_fd) {
-        match entry {
+        match *entry {
             FdEntry::Passthrough { kernel_fd, .. } => {
                 // Passthrough file - rewrite FD and return modified syscall for tail_inject
                 let new_syscall = args.with_fd(kernel_fd);
@@ -160,7 +160,7 @@ pub async fn handle_read<T: Guest<Sandbox>>(
                     new_syscall,
                 )));
             }
-            FdEntry::Virtual { file_ops, .. } => {
+            FdEntry::Virtual { ref file_ops, .. } => {
                 // Virtual file - use FileOps directly
                 let buf_addr = match args.buf() {
                     Some(addr) => addr,
@@ -168,7 +168,7 @@ pub async fn handle_read<T: Guest<Sandbox>>(
                 };
 
                 let buf_len = args.len();
-                let mut buf = vec![0u8; buf_len];
+                let mut buf = memory::Scratch::zeroed(buf_len);
 
                 match file_ops.read(&mut buf).await {
                     Ok(n) => {
@@ -210,7 +210,7 @@ pub async fn handle_write<T: Guest<Sandbox>>(
 
     // Get the FD entry
     if let Some(entry) = fd_table.get(virtual_fd) {
-        match entry {
+        match *entry {
             FdEntry::Passthrough { kernel_fd, .. } => {
                 // Passthrough file - rewrite FD and return modified syscall for tail_inject
                 let new_syscall = args.with_fd(kernel_fd);
@@ -219,7 +219,7 @@ pub async fn handle_write<T: Guest<Sandbox>>(
                     new_syscall,
                 )));
             }
-            FdEntry::Virtual { file_ops, .. } => {
+            FdEntry::Virtual { ref file_ops, .. } => {
                 // Virtual file - use FileOps directly
                 let buf_addr = match args.buf() {
                     Some(addr) => addr,
@@ -227,7 +227,7 @@ pub async fn handle_write<T: Guest<Sandbox>>(
                 };
 
                 let buf_len = args.len();
-                let mut buf = vec![0u8; buf_len];
+                let mut buf = memory::Scratch::zeroed(buf_len);
 
                 // Read data from guest memory
                 guest.memory().read_exact(buf_addr, &mut buf)?;
@@ -268,7 +268,7 @@ pub async fn handle_close<T: Guest<Sandbox>>(
 
     // Translate and deallocate the virtual FD
     if let Some(entry) = fd_table.deallocate(virtual_fd) {
-        match entry {
+        match *entry {
             FdEntry::Passthrough { kernel_fd, .. } => {
                 // Passthrough file - rewrite FD and return modified syscall for tail_inject
                 let new_syscall = args.with_fd(kernel_fd);
@@ -277,7 +277,7 @@ pub async fn handle_close<T: Guest<Sandbox>>(
                     new_syscall,
                 )));
             }
-            FdEntry::Virtual { file_ops, .. } => {
+            FdEntry::Virtual { ref file_ops, .. } => {
                 // Virtualized file - just call close on the FileOps
                 file_ops.close().await.ok();
                 return Ok(crate::syscall::SyscallResult::Value(0)); // Success
@@ -301,11 +301,11 @@ pub async fn handle_dup<T: Guest<Sandbox>>(
 
     // Get the old entry to preserve flags
     if let Some(old_entry) = fd_table.get(old_vfd) {
-        match old_entry {
+        match *old_entry {
             FdEntry::Passthrough {
                 kernel_fd,
                 flags,
-                path,
+                ref path,
             } => {
                 // Duplicate the kernel FD at the kernel level first
                 let new_syscall = reverie::syscalls::Dup::new().with_oldfd(kernel_fd);
@@ -320,7 +320,7 @@ pub async fn handle_dup<T: Guest<Sandbox>>(
                 let entry = FdEntry::Passthrough {
                     kernel_fd: new_kernel_fd,
                     flags,
-                    path,
+                    path: path.clone(),
                 };
 
                 // Allocate a new virtual FD
@@ -357,11 +357,11 @@ pub async fn handle_dup2<T: Guest<Sandbox>>(
         // Get the entry at new_vfd if it exists (we need to close its kernel FD)
         let old_new_entry = fd_table.get(new_vfd);
 
-        match old_entry {
+        match *old_entry {
             FdEntry::Passthrough {
                 kernel_fd: old_kernel_fd,
                 flags: _,
-                path,
+                ref path,
             } => {
                 // Allocate a new kernel FD - we need to duplicate to a fresh FD first,
                 // then close the old one if needed, to avoid race conditions
@@ -378,7 +378,7 @@ pub async fn handle_dup2<T: Guest<Sandbox>>(
 
                 // Close the old kernel FD at new_vfd if it existed
                 if let Some(old_entry) = old_new_entry {
-                    match old_entry {
+                    match *old_entry {
                         FdEntry::Passthrough { kernel_fd, .. } => {
                             let _ = guest
                                 .inject(Syscall::Close(
@@ -386,7 +386,7 @@ pub async fn handle_dup2<T: Guest<Sandbox>>(
                                 ))
                                 .await?;
                         }
-                        FdEntry::Virtual { file_ops, .. } => {
+                        FdEntry::Virtual { ref file_ops, .. } => {
                             // Close the FileOps if it's a virtualized file
                             file_ops.close().await.ok();
                         }
@@ -397,15 +397,15 @@ pub async fn handle_dup2<T: Guest<Sandbox>>(
                 let entry = FdEntry::Passthrough {
                     kernel_fd: new_kernel_fd as i32,
                     flags: 0,
-                    path,
+                    path: path.clone(),
                 };
                 let _ = fd_table.allocate_at(new_vfd, entry);
             }
             FdEntry::Virtual { .. } => {
                 // Virtualized file - close old entry at new_vfd if exists, then duplicate
                 if let Some(old_entry) = old_new_entry {
-                    match old_entry {
-                        FdEntry::Virtual { file_ops, .. } => {
+                    match *old_entry {
+                        FdEntry::Virtual { ref file_ops, .. } => {
                             file_ops.close().await.ok();
                         }
                         FdEntry::Passthrough { kernel_fd, .. } => {
@@ -445,10 +445,10 @@ pub async fn handle_dup3<T: Guest<Sandbox>>(
         // Get the entry at new_vfd if it exists (we need to close its kernel FD)
         let old_new_entry = fd_table.get(new_vfd);
 
-        match old_entry {
+        match *old_entry {
             FdEntry::Passthrough {
                 kernel_fd: old_kernel_fd,
-                path,
+                ref path,
                 ..
             } => {
                 // Allocate a new kernel FD - we need to duplicate to a fresh FD first,
@@ -466,7 +466,7 @@ pub async fn handle_dup3<T: Guest<Sandbox>>(
 
                 // Close the old kernel FD at new_vfd if it existed
                 if let Some(old_entry) = old_new_entry {
-                    match old_entry {
+                    match *old_entry {
                         FdEntry::Passthrough { kernel_fd, .. } => {
                             let _ = guest
                                 .inject(Syscall::Close(
@@ -474,7 +474,7 @@ pub async fn handle_dup3<T: Guest<Sandbox>>(
                                 ))
                                 .await?;
                         }
-                        FdEntry::Virtual { file_ops, .. } => {
+                        FdEntry::Virtual { ref file_ops, .. } => {
                             file_ops.close().await.ok();
                         }
                     }
@@ -488,15 +488,15 @@ pub async fn handle_dup3<T: Guest<Sandbox>>(
                 let entry = FdEntry::Passthrough {
                     kernel_fd: new_kernel_fd as i32,
                     flags: flags.bits(),
-                    path,
+                    path: path.clone(),
                 };
                 let _ = fd_table.allocate_at(new_vfd, entry);
             }
             FdEntry::Virtual { .. } => {
                 // Virtualized file - close old entry at new_vfd if exists, then duplicate
                 if let Some(old_entry) = old_new_entry {
-                    match old_entry {
-                        FdEntry::Virtual { file_ops, .. } => {
+                    match *old_entry {
+                        FdEntry::Virtual { ref file_ops, .. } => {
                             file_ops.close().await.ok();
                         }
                         FdEntry::Passthrough { kernel_fd, .. } => {
@@ -508,11 +508,15 @@ pub async fn handle_dup3<T: Guest<Sandbox>>(
                         }
                     }
                 }
-                let entry = match old_entry {
-                    FdEntry::Virtual { file_ops, path, .. } => FdEntry::Virtual {
-                        file_ops,
+                let entry = match *old_entry {
+                    FdEntry::Virtual {
+                        ref file_ops,
+                        ref path,
+                        ..
+                    } => FdEntry::Virtual {
+                        file_ops: file_ops.clone(),
                         flags: flags.bits(),
-                        path,
+                        path: path.clone(),
                     },
                     _ => unreachable!(),
                 };
@@ -874,13 +878,13 @@ pub async fn handle_poll<T: Guest<Sandbox>>(
         None => return Ok(None),
     };
 
-    // Read the pollfd array from guest memory
-    let mut pollfds: Vec<PollFd> = Vec::with_capacity(nfds as usize);
-    for i in 0..nfds {
-        let offset = i as isize * std::mem::size_of::<PollFd>() as isize;
-        let pollfd: PollFd = unsafe { guest.memory().read_value(fds_addr.offset(offset))? };
-        pollfds.push(pollfd);
-    }
+    // Read the whole pollfd array from guest memory at once
+    let mut bytes = memory::Scratch::zeroed(nfds as usize * std::mem::size_of::<PollFd>());
+    guest
+        .memory()
+        .read_exact(fds_addr.cast::<u8>(), &mut bytes)?;
+    // SAFETY: `pollfd` is plain data; unknown event bits are kept as-is
+    let pollfds: Vec<PollFd> = unsafe { memory::read_array(&bytes) };
 
     // Allocate space on stack for kernel pollfd array
     let mut stack = guest.stack().await;
@@ -893,22 +897,20 @@ pub async fn handle_poll<T: Guest<Sandbox>>(
 
     stack.commit()?;
 
-    // Write kernel pollfds to guest memory
-    for (i, pollfd) in pollfds.iter().enumerate() {
-        let kernel_fd = fd_table.translate(pollfd.fd).unwrap_or(pollfd.fd);
-        let kernel_pollfd = PollFd {
-            fd: kernel_fd,
+    // Write kernel pollfds to guest memory in one write
+    let kernel_pollfds: Vec<PollFd> = pollfds
+        .iter()
+        .map(|pollfd| PollFd {
+            fd: fd_table.translate(pollfd.fd).unwrap_or(pollfd.fd),
             events: pollfd.events,
             revents: reverie::syscalls::PollFlags::empty(),
-        };
-
-        let offset = i as isize * std::mem::size_of::<PollFd>() as isize;
-        unsafe {
-            guest
-                .memory()
-                .write_value(kernel_fds_addr.offset(offset), &kernel_pollfd)?;
-        }
-    }
+        })
+        .collect();
+    // SAFETY: `pollfd` is a kernel ABI struct
+    unsafe { memory::write_array(&kernel_pollfds, &mut bytes) };
+    guest
+        .memory()
+        .write_exact(kernel_fds_addr.cast::<u8>(), &bytes)?;
 
     // Create and inject the syscall with translated FDs
     let new_syscall = reverie::syscalls::Poll::new()
@@ -924,24 +926,25 @@ pub async fn handle_poll<T: Guest<Sandbox>>(
     }
 
     // Read back the kernel pollfds and translate to virtual FDs
-    for i in 0..nfds {
-        let offset = i as isize * std::mem::size_of::<PollFd>() as isize;
-        let kernel_pollfd: PollFd =
-            unsafe { guest.memory().read_value(kernel_fds_addr.offset(offset))? };
-
-        // Write back the revents to the original pollfd array
-        let virt_pollfd = PollFd {
-            fd: pollfds[i as usize].fd, // Keep the virtual FD
-            events: pollfds[i as usize].events,
+    guest
+        .memory()
+        .read_exact(kernel_fds_addr.cast::<u8>(), &mut bytes)?;
+    // SAFETY: as above
+    let kernel_pollfds: Vec<PollFd> = unsafe { memory::read_array(&bytes) };
+
+    // Write back the revents to the original pollfd array, in one write
+    let virt_pollfds: Vec<PollFd> = pollfds
+        .iter()
+        .zip(&kernel_pollfds)
+        .map(|(pollfd, kernel_pollfd)| PollFd {
+            fd: pollfd.fd, // Keep the virtual FD
+            events: pollfd.events,
             revents: kernel_pollfd.revents,
-        };
-
-        unsafe {
-            guest
-                .memory()
-                .write_value(fds_addr.offset(offset), &virt_pollfd)?;
-        }
-    }
+        })
+        .collect();
+    // SAFETY: as above
+    unsafe { memory::write_array(&virt_pollfds, &mut bytes) };
+    guest.memory().write_exact(fds_addr.cast::<u8>(), &bytes)?;
 
     Ok(Some(result))
 }
@@ -960,7 +963,7 @@ pub async fn handle_getdents64<T: Guest<Sandbox>>(
 
     // Get the FD entry
     if let Some(entry) = fd_table.get(virtual_fd) {
-        match entry {
+        match *entry {
             FdEntry::Passthrough { kernel_fd, .. } => {
                 // Passthrough file - rewrite FD and return modified syscall for tail_inject
                 let new_syscall = args.with_fd(kernel_fd as u32);
@@ -969,7 +972,7 @@ pub async fn handle_getdents64<T: Guest<Sandbox>>(
                     new_syscall,
                 )));
             }
-            FdEntry::Virtual { file_ops, .. } => {
+            FdEntry::Virtual { ref file_ops, .. } => {
                 // Virtual file - use FileOps::getdents()
                 match file_ops.getdents().await {
                     Ok(entries) => {
@@ -984,7 +987,7 @@ pub async fn handle_getdents64<T: Guest<Sandbox>>(
                         };
                         let count = args.count() as usize;
 
-                        let mut buf = Vec::new();
+                        let mut buf = memory::Scratch::new();
                         let mut offset = 1i64;
 
                         for (ino, name, d_type) in entries {
@@ -1046,7 +1049,7 @@ pub async fn handle_fstat<T: Guest<Sandbox>>(
 
     // Get the FD entry
     if let Some(entry) = fd_table.get(virtual_fd) {
-        match entry {
+        match *entry {
             FdEntry::Passthrough { kernel_fd, .. } => {
                 // Passthrough file - rewrite FD and return modified syscall for tail_inject
                 let new_syscall = args.with_fd(kernel_fd);
@@ -1055,19 +1058,14 @@ pub async fn handle_fstat<T: Guest<Sandbox>>(
                     new_syscall,
                 )));
             }
-            FdEntry::Virtual { file_ops, .. } => {
+            FdEntry::Virtual { ref file_ops, .. } => {
                 // Virtual file - use FileOps::fstat()
                 match file_ops.fstat().await {
                     Ok(stat_buf) => {
                         // Write the stat result to guest memory
                         if let Some(stat_addr) = args.stat() {
-                            // Convert stat struct to bytes and write
-                            let stat_bytes: &[u8] = unsafe {
-                                std::slice::from_raw_parts(
-                                    &stat_buf as *const _ as *const u8,
-                                    std::mem::size_of::<libc::stat>(),
-                                )
-                            };
+                            // SAFETY: `libc::stat` is a kernel ABI struct
+                            let stat_bytes = unsafe { memory::bytes_of(&stat_buf) };
                             guest
                                 .memory()
                                 .write_exact(stat_addr.0.cast::<u8>(), stat_bytes)?;
@@ -1106,7 +1104,7 @@ pub async fn handle_fstatat<T: Guest<Sandbox>>(
 ) -> Result<crate::syscall::SyscallResult, Error> {
     if let Some(path_addr) = args.path() {
         // Read the original path from guest memory
-        let mut path: std::path::PathBuf = path_addr.read(&guest.memory())?;
+        let mut path = memory::read_path(&guest.memory(), path_addr)?;
 
         // Handle dirfd resolution for relative paths
         let dirfd = args.dirfd();
@@ -1148,13 +1146,8 @@ pub async fn handle_fstatat<T: Guest<Sandbox>>(
                     Ok(stat_buf) => {
                         // Write the stat result to guest memory
                         if let Some(stat_addr) = args.stat() {
-                            // Convert stat struct to bytes and write
-                            let stat_bytes: &[u8] = unsafe {
-                                std::slice::from_raw_parts(
-                                    &stat_buf as *const _ as *const u8,
-                                    std::mem::size_of::<libc::stat>(),
-                                )
-                            };
+                            // SAFETY: `libc::stat` is a kernel ABI struct
+                            let stat_bytes = unsafe { memory::bytes_of(&stat_buf) };
                             guest
                                 .memory()
                                 .write_exact(stat_addr.0.cast::<u8>(), stat_bytes)?;
@@ -1251,7 +1244,7 @@ pub async fn handle_lseek<T: Guest<Sandbox>>(
 
     // Get the FD entry
     if let Some(entry) = fd_table.get(virtual_fd) {
-        match entry {
+        match *entry {
             FdEntry::Passthrough { kernel_fd, .. } => {
                 // Passthrough file - rewrite FD and return modified syscall for tail_inject
                 let new_syscall = args.with_fd(kernel_fd);
@@ -1260,7 +1253,7 @@ pub async fn handle_lseek<T: Guest<Sandbox>>(
                     new_syscall,
                 )));
             }
-            FdEntry::Virtual { file_ops, .. } => {
+            FdEntry::Virtual { ref file_ops, .. } => {
                 // Virtual file - use FileOps::seek()
                 // Convert Whence enum to i32
                 use reverie::syscalls::Whence;
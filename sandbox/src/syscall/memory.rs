@@ -0,0 +1,196 @@
+//! Batched guest memory access.
+//!
+//! Every `MemoryAccess` call costs at least one `process_vm_readv` or
+//! `process_vm_writev` on the traced process, so the handlers move whole
+//! objects (a path, a `pollfd` array, a directory listing) in as few calls
+//! as possible. Buffers for that data come from a per-thread scratch buffer
+//! instead of a fresh allocation per syscall.
+
+use reverie::syscalls::{Addr, AddrMut, Errno, MemoryAccess, PathPtr};
+use reverie::Stack;
+use std::cell::RefCell;
+use std::ffi::OsString;
+use std::ops::{Deref, DerefMut};
+use std::os::unix::ffi::OsStringExt;
+use std::path::PathBuf;
+
+/// Page size of the guest; a read that stays within one page either
+/// succeeds whole or faults
+const PAGE_SIZE: usize = 4096;
+
+/// Longest path the kernel accepts, including the terminating NUL
+const PATH_MAX: usize = libc::PATH_MAX as usize;
+
+/// Largest scratch buffer kept for reuse; bigger ones are freed
+const MAX_SCRATCH_BYTES: usize = 1024 * 1024;
+
+thread_local! {
+    static SCRATCH: RefCell<Vec<u8>> = const { RefCell::new(Vec::new()) };
+}
+
+/// A byte buffer borrowed from the current thread's scratch buffer.
+///
+/// The buffer goes back to whichever thread drops it, so it may be held
+/// across an await.
+pub(crate) struct Scratch {
+    buf: Vec<u8>,
+}
+
+impl Scratch {
+    /// Take an empty scratch buffer
+    pub(crate) fn new() -> Self {
+        let mut buf = SCRATCH.with(|scratch| scratch.take());
+        buf.clear();
+        Self { buf }
+    }
+
+    /// Take a scratch buffer of `len` zero bytes
+    pub(crate) fn zeroed(len: usize) -> Self {
+        let mut scratch = Self::new();
+        scratch.buf.resize(len, 0);
+        scratch
+    }
+}
+
+impl Deref for Scratch {
+    type Target = Vec<u8>;
+
+    fn deref(&self) -> &Vec<u8> {
+        &self.buf
+    }
+}
+
+impl DerefMut for Scratch {
+    fn deref_mut(&mut self) -> &mut Vec<u8> {
+        &mut self.buf
+    }
+}
+
+impl Drop for Scratch {
+    fn drop(&mut self) {
+        if self.buf.capacity() > MAX_SCRATCH_BYTES {
+            return;
+        }
+        let buf = std::mem::take(&mut self.buf);
+        // Keep the larger buffer if another one was returned meanwhile; the
+        // thread-local may already be gone while the thread exits
+        let _ = SCRATCH.try_with(|scratch| {
+            let mut scratch = scratch.borrow_mut();
+            if buf.capacity() > scratch.capacity() {
+                *scratch = buf;
+            }
+        });
+    }
+}
+
+/// Read a NUL-terminated path from guest memory.
+///
+/// Reads up to the end of a page at a time rather than in small fixed
+/// chunks, so a path costs one read unless it crosses a page boundary.
+pub(crate) fn read_path<M: MemoryAccess>(memory: &M, path: PathPtr<'_>) -> Result<PathBuf, Errno> {
+    // SAFETY: PathPtr is a thin wrapper around the guest address of the
+    // string, like the AddrMut<u8> that `translate_path` converts into one.
+    let mut addr = unsafe { std::mem::transmute::<PathPtr<'_>, Addr<'_, u8>>(path) };
+    let mut bytes = Vec::new();
+    loop {
+        let start = bytes.len();
+        let chunk = PAGE_SIZE - addr.as_raw() % PAGE_SIZE;
+        bytes.resize(start + chunk, 0);
+        memory.read_exact(addr, &mut bytes[start..])?;
+
+        if let Some(nul) = bytes[start..].iter().position(|&b| b == 0) {
+            bytes.truncate(start + nul);
+            return Ok(PathBuf::from(OsString::from_vec(bytes)));
+        }
+        if bytes.len() >= PATH_MAX {
+            return Err(Errno::ENAMETOOLONG);
+        }
+        addr = Addr::from_raw(addr.as_raw() + chunk).ok_or(Errno::EFAULT)?;
+    }
+}
+
+/// Reserve `len` bytes on the guest stack and return their address.
+///
+/// The stack hands out typed slots, so this reserves `len` rounded up to
+/// whole words, one word at a time. Like the `pollfd` array in `poll`, the
+/// slots of one reservation are contiguous from the first one on.
+pub(crate) fn reserve_bytes<'a, S: Stack>(stack: &mut S, len: usize) -> AddrMut<'a, u8> {
+    let addr: AddrMut<'a, u64> = stack.reserve();
+    for _ in 1..len.div_ceil(std::mem::size_of::<u64>()) {
+        let _: AddrMut<'a, u64> = stack.reserve();
+    }
+    addr.cast::<u8>()
+}
+
+/// View a plain C struct as its bytes, for writing it to guest memory in one
+/// call.
+///
+/// # Safety
+/// `T` must be a `repr(C)` type without padding that could hold uninitialized
+/// bytes, such as the kernel ABI structs `libc::stat` and `pollfd`.
+pub(crate) unsafe fn bytes_of<T>(value: &T) -> &[u8] {
+    std::slice::from_raw_parts(value as *const T as *const u8, std::mem::size_of::<T>())
+}
+
+/// Read an array of plain C structs out of bytes copied from guest memory.
+///
+/// # Safety
+/// Every bit pattern must be a valid `T`.
+pub(crate) unsafe fn read_array<T>(bytes: &[u8]) -> Vec<T> {
+    bytes
+        .chunks_exact(std::mem::size_of::<T>())
+        .map(|item| std::ptr::read_unaligned(item.as_ptr() as *const T))
+        .collect()
+}
+
+/// Copy an array of plain C structs into `out`, for writing it to guest
+/// memory in one call.
+///
+/// # Safety
+/// As for [`bytes_of`].
+pub(crate) unsafe fn write_array<T>(items: &[T], out: &mut Vec<u8>) {
+    out.clear();
+    for item in items {
+        out.extend_from_slice(bytes_of(item));
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use reverie::syscalls::LocalMemory;
+
+    /// A buffer of `pages` whole pages of `fill` bytes, and its page-aligned
+    /// start address
+    fn pages(pages: usize, fill: u8) -> (Vec<u8>, usize) {
+        let buf = vec![fill; (pages + 1) * PAGE_SIZE];
+        let start = (buf.as_ptr() as usize).next_multiple_of(PAGE_SIZE);
+        (buf, start)
+    }
+
+    fn path_ptr(addr: usize) -> PathPtr<'static> {
+        let addr: Addr<'static, u8> = Addr::from_raw(addr).unwrap();
+        // SAFETY: the inverse of the conversion in `read_path`
+        unsafe { std::mem::transmute::<Addr<'static, u8>, PathPtr<'static>>(addr) }
+    }
+
+    #[test]
+    fn test_read_path_across_page_boundary() {
+        let (mut buf, start) = pages(2, 0);
+        let path = format!("/{}", "d/".repeat(40));
+        // Starts 20 bytes before the end of the first page
+        let offset = start - buf.as_ptr() as usize + PAGE_SIZE - 20;
+        buf[offset..offset + path.len()].copy_from_slice(path.as_bytes());
+
+        let read = read_path(&LocalMemory::new(), path_ptr(start + PAGE_SIZE - 20)).unwrap();
+        assert_eq!(read, PathBuf::from(path));
+    }
+
+    #[test]
+    fn test_read_path_too_long() {
+        // No NUL within PATH_MAX bytes
+        let (_buf, start) = pages(PATH_MAX.div_ceil(PAGE_SIZE) + 1, b'a');
+        let result = read_path(&LocalMemory::new(), path_ptr(start + 10));
+        assert_eq!(result, Err(Errno::ENAMETOOLONG));
+    }
+}
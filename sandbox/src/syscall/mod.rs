@@ -1,4 +1,5 @@
 pub mod file;
+pub(crate) mod memory;
 pub mod process;
 pub mod stat;
 pub mod xattr;
@@ -8,10 +9,10 @@ use crate::{
     vfs::{fdtable::FdTable, mount::MountTable},
 };
 use reverie::{
-    syscalls::{MemoryAccess, PathPtr, ReadAddr, Syscall},
+    syscalls::{MemoryAccess, PathPtr, Syscall},
     Error, Guest, Stack,
 };
-use std::{ffi::CString, path::PathBuf};
+use std::{ffi::CString, path::Path};
 
 /// Common path translation logic for syscalls.
 ///
@@ -45,15 +46,26 @@ pub(crate) async fn translate_path<'a, T: Guest<Sandbox>>(
     mount_table: &MountTable,
 ) -> Result<Option<PathPtr<'a>>, Error> {
     // Read the original path from guest memory
-    let path: PathBuf = path_addr.read(&guest.memory())?;
+    let path = memory::read_path(&guest.memory(), path_addr)?;
+    translate_read_path(guest, &path, mount_table).await
+}
 
+/// Path translation for a path the handler has already read from guest
+/// memory.
+///
+/// Same as [`translate_path`] without reading the path a second time.
+pub(crate) async fn translate_read_path<'a, T: Guest<Sandbox>>(
+    guest: &'a mut T,
+    path: &Path,
+    mount_table: &MountTable,
+) -> Result<Option<PathPtr<'a>>, Error> {
     // Only process valid UTF-8 paths
     if path.to_str().is_none() {
         return Ok(None);
     }
 
     // Resolve through mount table to get the translated host path
-    let (_vfs, translated_path) = match mount_table.resolve(&path) {
+    let (_vfs, translated_path) = match mount_table.resolve(path) {
         Some(result) => result,
         None => return Ok(None), // No mount point matches, use original path
     };
@@ -65,15 +77,14 @@ pub(crate) async fn translate_path<'a, T: Guest<Sandbox>>(
     // Allocate space on the guest stack and write the new path
     let bytes = new_path_cstr.as_bytes_with_nul();
     let mut stack = guest.stack().await;
-    let addr: reverie::syscalls::AddrMut<PathBuf> = stack.reserve();
+    let byte_addr = memory::reserve_bytes(&mut stack, bytes.len());
     stack.commit()?;
 
-    let byte_addr = addr.cast::<u8>();
     guest.memory().write_exact(byte_addr, bytes)?;
 
     // SAFETY: The transmute converts AddrMut<u8> to PathPtr<'a>.
     // This is safe because:
-    // 1. We just allocated `byte_addr` from the guest stack via stack.reserve()
+    // 1. We just allocated `byte_addr` from the guest stack via reserve_bytes()
     // 2. We wrote a valid null-terminated C string to this address
     // 3. Reverie treats these pointer types as thin wrappers around raw pointers
     // 4. PathPtr is a newtype around CStrPtr, which is compatible with a char* pointer
@@ -1,10 +1,10 @@
 use crate::{
     sandbox::Sandbox,
-    syscall::translate_path,
+    syscall::{memory, translate_path, translate_read_path},
     vfs::{fdtable::FdTable, mount::MountTable},
 };
 use reverie::{
-    syscalls::{MemoryAccess, ReadAddr, Syscall},
+    syscalls::{MemoryAccess, Syscall},
     Error, Guest, Stack,
 };
 
@@ -30,7 +30,7 @@ pub async fn handle_statx<T: Guest<Sandbox>>(
 
     if let Some(path_addr) = args.path() {
         // Read the original path from guest memory
-        let path: std::path::PathBuf = path_addr.read(&guest.memory())?;
+        let path = memory::read_path(&guest.memory(), path_addr)?;
 
         // Check if this path matches a mount point
         if let Some((vfs, _translated_path)) = mount_table.resolve(&path) {
@@ -42,7 +42,7 @@ pub async fn handle_statx<T: Guest<Sandbox>>(
             }
         }
 
-        if let Some(new_path_addr) = translate_path(guest, path_addr, mount_table).await? {
+        if let Some(new_path_addr) = translate_read_path(guest, &path, mount_table).await? {
             let new_syscall = reverie::syscalls::Statx::new()
                 .with_dirfd(kernel_dirfd)
                 .with_path(Some(new_path_addr))
@@ -81,7 +81,7 @@ pub async fn handle_newfstatat<T: Guest<Sandbox>>(
 
     if let Some(path_addr) = args.path() {
         // Read the original path from guest memory
-        let path: std::path::PathBuf = path_addr.read(&guest.memory())?;
+        let path = memory::read_path(&guest.memory(), path_addr)?;
 
         // Check if this path matches a mount point
         if let Some((vfs, _translated_path)) = mount_table.resolve(&path) {
@@ -100,13 +100,8 @@ pub async fn handle_newfstatat<T: Guest<Sandbox>>(
                     Ok(stat_buf) => {
                         // Write the stat result to guest memory
                         if let Some(stat_addr) = args.stat() {
-                            // Convert stat struct to bytes and write
-                            let stat_bytes: &[u8] = unsafe {
-                                std::slice::from_raw_parts(
-                                    &stat_buf as *const _ as *const u8,
-                                    std::mem::size_of::<libc::stat>(),
-                                )
-                            };
+                            // SAFETY: `libc::stat` is a kernel ABI struct
+                            let stat_bytes = unsafe { memory::bytes_of(&stat_buf) };
                             guest
                                 .memory()
                                 .write_exact(stat_addr.0.cast::<u8>(), stat_bytes)?;
@@ -126,7 +121,7 @@ pub async fn handle_newfstatat<T: Guest<Sandbox>>(
             }
         }
 
-        if let Some(new_path_addr) = translate_path(guest, path_addr, mount_table).await? {
+        if let Some(new_path_addr) = translate_read_path(guest, &path, mount_table).await? {
             let new_syscall = reverie::syscalls::Newfstatat::new()
                 .with_dirfd(kernel_dirfd)
                 .with_path(Some(new_path_addr))
@@ -168,7 +163,7 @@ pub async fn handle_readlink<T: Guest<Sandbox>>(
     mount_table: &MountTable,
 ) -> Result<Option<i64>, Error> {
     if let Some(path_addr) = args.path() {
-        let path: std::path::PathBuf = path_addr.read(&guest.memory())?;
+        let path = memory::read_path(&guest.memory(), path_addr)?;
 
         // Check if this path matches a mount point
         if let Some((vfs, _translated_path)) = mount_table.resolve(&path) {
@@ -206,7 +201,7 @@ pub async fn handle_readlink<T: Guest<Sandbox>>(
             }
         }
 
-        if let Some(new_path_addr) = translate_path(guest, path_addr, mount_table).await? {
+        if let Some(new_path_addr) = translate_read_path(guest, &path, mount_table).await? {
             let new_syscall = reverie::syscalls::Readlink::new()
                 .with_path(Some(new_path_addr))
                 .with_buf(args.buf())
@@ -238,7 +233,7 @@ pub async fn handle_readlinkat<T: Guest<Sandbox>>(
     };
 
     if let Some(path_addr) = args.path() {
-        let path: std::path::PathBuf = path_addr.read(&guest.memory())?;
+        let path = memory::read_path(&guest.memory(), path_addr)?;
 
         // Check if this path matches a mount point
         if let Some((vfs, _translated_path)) = mount_table.resolve(&path) {
@@ -276,7 +271,7 @@ pub async fn handle_readlinkat<T: Guest<Sandbox>>(
             }
         }
 
-        if let Some(new_path_addr) = translate_path(guest, path_addr, mount_table).await? {
+        if let Some(new_path_addr) = translate_read_path(guest, &path, mount_table).await? {
             let new_syscall = reverie::syscalls::Readlinkat::new()
                 .with_dirfd(kernel_dirfd)
                 .with_path(Some(new_path_addr))
@@ -304,11 +299,11 @@ pub async fn handle_symlink<T: Guest<Sandbox>>(
 ) -> Result<Option<i64>, Error> {
     // Read the linkpath from guest memory
     if let Some(linkpath_addr) = args.linkpath() {
-        let linkpath: std::path::PathBuf = linkpath_addr.read(&guest.memory())?;
+        let linkpath = memory::read_path(&guest.memory(), linkpath_addr)?;
 
         // Read the target from guest memory
         if let Some(target_addr) = args.target() {
-            let target: std::path::PathBuf = target_addr.read(&guest.memory())?;
+            let target = memory::read_path(&guest.memory(), target_addr)?;
 
             // Check if this path matches a mount point
             if let Some((vfs, _translated_path)) = mount_table.resolve(&linkpath) {
@@ -332,7 +327,7 @@ pub async fn handle_symlink<T: Guest<Sandbox>>(
             }
 
             if let Some(new_linkpath_addr) =
-                translate_path(guest, linkpath_addr, mount_table).await?
+                translate_read_path(guest, &linkpath, mount_table).await?
             {
                 let new_syscall = reverie::syscalls::Symlink::new()
                     .with_target(args.target())
@@ -369,10 +364,10 @@ pub async fn handle_symlinkat<T: Guest<Sandbox>>(
 
     // Read linkpath and target from guest memory
     if let Some(linkpath_addr) = args.linkpath() {
-        let linkpath: std::path::PathBuf = linkpath_addr.read(&guest.memory())?;
+        let linkpath = memory::read_path(&guest.memory(), linkpath_addr)?;
 
         if let Some(target_addr) = args.target() {
-            let target: std::path::PathBuf = target_addr.read(&guest.memory())?;
+            let target = memory::read_path(&guest.memory(), target_addr)?;
 
             // Check if this path matches a mount point
             if let Some((vfs, _translated_path)) = mount_table.resolve(&linkpath) {
@@ -396,7 +391,7 @@ pub async fn handle_symlinkat<T: Guest<Sandbox>>(
             }
 
             if let Some(new_linkpath_addr) =
-                translate_path(guest, linkpath_addr, mount_table).await?
+                translate_read_path(guest, &linkpath, mount_table).await?
             {
                 let new_syscall = reverie::syscalls::Symlinkat::new()
                     .with_target(args.target())
@@ -440,10 +435,10 @@ pub async fn handle_linkat<T: Guest<Sandbox>>(
 
     // Read oldpath and newpath from guest memory
     if let Some(oldpath_addr) = args.oldpath() {
-        let oldpath: std::path::PathBuf = oldpath_addr.read(&guest.memory())?;
+        let oldpath = memory::read_path(&guest.memory(), oldpath_addr)?;
 
         if let Some(newpath_addr) = args.newpath() {
-            let newpath: std::path::PathBuf = newpath_addr.read(&guest.memory())?;
+            let newpath = memory::read_path(&guest.memory(), newpath_addr)?;
 
             // Check if newpath matches a mount point with virtual VFS
             if let Some((vfs, _translated_path)) = mount_table.resolve(&newpath) {
@@ -477,33 +472,31 @@ pub async fn handle_linkat<T: Guest<Sandbox>>(
                     // Both paths need translation
                     use std::ffi::CString;
 
-                    let old_cstr =
-                        CString::new(translated_oldpath.to_string_lossy().to_string())
-                            .map_err(|_| reverie::syscalls::Errno::EINVAL)?;
-                    let new_cstr =
-                        CString::new(translated_newpath.to_string_lossy().to_string())
-                            .map_err(|_| reverie::syscalls::Errno::EINVAL)?;
+                    let old_cstr = CString::new(translated_oldpath.to_string_lossy().to_string())
+                        .map_err(|_| reverie::syscalls::Errno::EINVAL)?;
+                    let new_cstr = CString::new(translated_newpath.to_string_lossy().to_string())
+                        .map_err(|_| reverie::syscalls::Errno::EINVAL)?;
 
                     // Allocate space for both paths on guest stack
                     let old_bytes = old_cstr.as_bytes_with_nul();
                     let new_bytes = new_cstr.as_bytes_with_nul();
 
                     let mut stack = guest.stack().await;
-                    let old_addr: reverie::syscalls::AddrMut<std::path::PathBuf> = stack.reserve();
-                    let new_addr: reverie::syscalls::AddrMut<std::path::PathBuf> = stack.reserve();
+                    let old_byte_addr =
+                        memory::reserve_bytes(&mut stack, old_bytes.len() + new_bytes.len());
                     stack.commit()?;
 
-                    let old_byte_addr = old_addr.cast::<u8>();
-                    let new_byte_addr = new_addr.cast::<u8>();
-                    guest.memory().write_exact(old_byte_addr, old_bytes)?;
-                    guest.memory().write_exact(new_byte_addr, new_bytes)?;
+                    // Write both paths back to back, in a single write
+                    let mut bytes = memory::Scratch::new();
+                    bytes.extend_from_slice(old_bytes);
+                    bytes.extend_from_slice(new_bytes);
+                    let new_byte_addr = unsafe { old_byte_addr.offset(old_bytes.len() as isize) };
+                    guest.memory().write_exact(old_byte_addr, &bytes)?;
 
-                    let new_oldpath_ptr: reverie::syscalls::PathPtr = unsafe {
-                        std::mem::transmute(old_byte_addr)
-                    };
-                    let new_newpath_ptr: reverie::syscalls::PathPtr = unsafe {
-                        std::mem::transmute(new_byte_addr)
-                    };
+                    let new_oldpath_ptr: reverie::syscalls::PathPtr =
+                        unsafe { std::mem::transmute(old_byte_addr) };
+                    let new_newpath_ptr: reverie::syscalls::PathPtr =
+                        unsafe { std::mem::transmute(new_byte_addr) };
 
                     let new_syscall = reverie::syscalls::Linkat::new()
                         .with_olddirfd(kernel_olddirfd)
@@ -517,7 +510,7 @@ pub async fn handle_linkat<T: Guest<Sandbox>>(
                 (Some(_), None) => {
                     // Only oldpath needs translation
                     if let Some(new_oldpath_addr) =
-                        translate_path(guest, oldpath_addr, mount_table).await?
+                        translate_read_path(guest, &oldpath, mount_table).await?
                     {
                         let new_syscall = reverie::syscalls::Linkat::new()
                             .with_olddirfd(kernel_olddirfd)
@@ -532,7 +525,7 @@ pub async fn handle_linkat<T: Guest<Sandbox>>(
                 (None, Some(_)) => {
                     // Only newpath needs translation
                     if let Some(new_newpath_addr) =
-                        translate_path(guest, newpath_addr, mount_table).await?
+                        translate_read_path(guest, &newpath, mount_table).await?
                     {
                         let new_syscall = reverie::syscalls::Linkat::new()
                             .with_olddirfd(kernel_olddirfd)
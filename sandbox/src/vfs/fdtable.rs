@@ -1,5 +1,6 @@
 use super::file::BoxedFileOps;
-use std::collections::{BinaryHeap, HashMap};
+use std::collections::HashMap;
+use std::sync::atomic::{AtomicPtr, AtomicUsize, Ordering};
 use std::sync::{Arc, Mutex};
 
 /// Standard file descriptor constants
@@ -8,6 +9,10 @@ const STDOUT_FILENO: i32 = 1;
 const STDERR_FILENO: i32 = 2;
 const FIRST_USER_FD: i32 = 3;
 
+/// FDs below this are kept in a dense array indexed by FD number; the rest
+/// (rare, e.g. from dup2 to a high number) go in a map
+const DENSE_FDS: i32 = 1024;
+
 /// Information about a virtualized file descriptor
 #[derive(Clone)]
 pub enum FdEntry {
@@ -59,194 +64,263 @@ impl FdEntry {
     }
 }
 
-/// Inner state of the FD table, protected by a single mutex
-struct FdTableInner {
-    /// Mapping from virtual FD to kernel FD
-    entries: HashMap<i32, FdEntry>,
-    /// Next virtual FD to allocate (monotonically increasing)
-    next_vfd: i32,
-    /// Min-heap of freed FDs available for reuse (stored as negative for min-heap behavior)
-    free_fds: BinaryHeap<std::cmp::Reverse<i32>>,
+/// An immutable version of the table's contents
+///
+/// Entries are shared between versions, so copying one to make a change
+/// costs a reference count per open FD.
+#[derive(Clone, Default)]
+struct Snapshot {
+    /// Entries for FDs below `DENSE_FDS`, indexed by FD number
+    dense: Vec<Option<Arc<FdEntry>>>,
+    /// Entries for every other FD
+    sparse: HashMap<i32, Arc<FdEntry>>,
+}
+
+impl Snapshot {
+    fn get(&self, vfd: i32) -> Option<&Arc<FdEntry>> {
+        if (0..DENSE_FDS).contains(&vfd) {
+            self.dense.get(vfd as usize)?.as_ref()
+        } else {
+            self.sparse.get(&vfd)
+        }
+    }
+
+    fn contains(&self, vfd: i32) -> bool {
+        self.get(vfd).is_some()
+    }
+
+    fn insert(&mut self, vfd: i32, entry: Arc<FdEntry>) -> Option<Arc<FdEntry>> {
+        if (0..DENSE_FDS).contains(&vfd) {
+            let index = vfd as usize;
+            if index >= self.dense.len() {
+                self.dense.resize(index + 1, None);
+            }
+            self.dense[index].replace(entry)
+        } else {
+            self.sparse.insert(vfd, entry)
+        }
+    }
+
+    fn remove(&mut self, vfd: i32) -> Option<Arc<FdEntry>> {
+        if (0..DENSE_FDS).contains(&vfd) {
+            let entry = self.dense.get_mut(vfd as usize)?.take();
+            while let Some(None) = self.dense.last() {
+                self.dense.pop();
+            }
+            entry
+        } else {
+            self.sparse.remove(&vfd)
+        }
+    }
+
+    /// Lowest FD at or above `min_vfd` that has no entry
+    fn lowest_free(&self, min_vfd: i32) -> i32 {
+        (min_vfd..i32::MAX)
+            .find(|&fd| !self.contains(fd))
+            .expect("File descriptor table exhausted")
+    }
+
+    fn len(&self) -> usize {
+        self.dense.iter().flatten().count() + self.sparse.len()
+    }
+}
+
+/// State shared by all handles to one FD table
+///
+/// The current snapshot is published through `current` and replaced, never
+/// modified, so lookups take no lock. Readers announce themselves in the
+/// counter of the current epoch before loading the pointer. A writer swaps in
+/// the new snapshot, flips the epoch and waits for the readers counted in the
+/// old epoch to leave before releasing the old snapshot. Readers that find
+/// the epoch changed after counting themselves retry, so a reader that loads
+/// the pointer always sees a snapshot at least as new as the epoch it is
+/// counted in.
+struct Shared {
+    /// Raw `Arc<Snapshot>` of the current contents
+    current: AtomicPtr<Snapshot>,
+    /// Index into `readers` for new readers
+    epoch: AtomicUsize,
+    /// Number of readers inside each epoch
+    readers: [AtomicUsize; 2],
+    /// Serializes writers
+    writer: Mutex<()>,
+}
+
+impl Shared {
+    fn new(snapshot: Arc<Snapshot>) -> Self {
+        Self {
+            current: AtomicPtr::new(Arc::into_raw(snapshot) as *mut Snapshot),
+            epoch: AtomicUsize::new(0),
+            readers: [AtomicUsize::new(0), AtomicUsize::new(0)],
+            writer: Mutex::new(()),
+        }
+    }
+
+    /// Run `f` on the current snapshot without locking
+    fn read<R>(&self, f: impl FnOnce(&Snapshot) -> R) -> R {
+        let epoch = loop {
+            let epoch = self.epoch.load(Ordering::SeqCst);
+            self.readers[epoch].fetch_add(1, Ordering::SeqCst);
+            if self.epoch.load(Ordering::SeqCst) == epoch {
+                break epoch;
+            }
+            self.readers[epoch].fetch_sub(1, Ordering::SeqCst);
+        };
+
+        struct Leave<'a>(&'a AtomicUsize);
+        impl Drop for Leave<'_> {
+            fn drop(&mut self) {
+                self.0.fetch_sub(1, Ordering::SeqCst);
+            }
+        }
+        let _leave = Leave(&self.readers[epoch]);
+
+        // SAFETY: the snapshot stays alive until every reader counted in
+        // the epoch it was current in has left
+        f(unsafe { &*self.current.load(Ordering::SeqCst) })
+    }
+
+    /// Run `f` on the current snapshot with writers excluded
+    ///
+    /// If `f` returns a new version, it replaces the current one.
+    fn update<R>(&self, f: impl FnOnce(&Snapshot) -> (Option<Snapshot>, R)) -> R {
+        let _writer = self
+            .writer
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner());
+
+        // SAFETY: only writers release snapshots, and we exclude them
+        let (next, result) = f(unsafe { &*self.current.load(Ordering::SeqCst) });
+        if let Some(next) = next {
+            self.publish(Arc::new(next));
+        }
+        result
+    }
+
+    /// Replace the current snapshot; the caller must hold `writer`
+    fn publish(&self, next: Arc<Snapshot>) {
+        let old = self
+            .current
+            .swap(Arc::into_raw(next) as *mut Snapshot, Ordering::SeqCst);
+        let epoch = self.epoch.load(Ordering::SeqCst);
+        self.epoch.store(epoch ^ 1, Ordering::SeqCst);
+
+        // Lookups hold the snapshot only long enough to clone an entry
+        while self.readers[epoch].load(Ordering::SeqCst) != 0 {
+            std::thread::yield_now();
+        }
+
+        // SAFETY: `old` came from `Arc::into_raw`, and no reader can still
+        // be using it
+        drop(unsafe { Arc::from_raw(old) });
+    }
+
+    /// Take a reference to the current snapshot, for sharing it with a copy
+    /// of the table
+    fn snapshot(&self) -> Arc<Snapshot> {
+        let _writer = self
+            .writer
+            .lock()
+            .unwrap_or_else(|poisoned| poisoned.into_inner());
+        let current = self.current.load(Ordering::SeqCst);
+
+        // SAFETY: `current` came from `Arc::into_raw` and can't be released
+        // while we exclude writers
+        unsafe {
+            Arc::increment_strong_count(current);
+            Arc::from_raw(current)
+        }
+    }
+}
+
+impl Drop for Shared {
+    fn drop(&mut self) {
+        // SAFETY: nobody else can reach `current` any more
+        drop(unsafe { Arc::from_raw(*self.current.get_mut()) });
+    }
 }
 
 /// Per-process file descriptor table that virtualizes file descriptors
 ///
 /// This table maintains a mapping from virtual (process-visible) file descriptors
 /// to kernel (actual) file descriptors. It is thread-safe and can be shared across
-/// threads within the same process.
+/// threads within the same process. Lookups (`translate`, `get`) are lock-free;
+/// changes copy the table and publish the new version, so they are serialized
+/// with each other but never block lookups.
 ///
 /// Note: Clone creates a shallow copy that shares the same underlying FD table.
 /// For fork/clone syscalls, use `deep_clone()` instead.
 #[derive(Clone)]
 pub struct FdTable {
-    inner: Arc<Mutex<FdTableInner>>,
+    inner: Arc<Shared>,
 }
 
 impl FdTable {
     /// Create a new FD table with standard FDs (stdin, stdout, stderr)
     pub fn new() -> Self {
-        let mut entries = HashMap::new();
+        let mut snapshot = Snapshot::default();
 
         // Initialize standard file descriptors (0, 1, 2) as passthrough files
-        entries.insert(
-            STDIN_FILENO,
-            FdEntry::Passthrough {
-                kernel_fd: STDIN_FILENO,
-                flags: 0,
-                path: None,
-            },
-        );
-        entries.insert(
-            STDOUT_FILENO,
-            FdEntry::Passthrough {
-                kernel_fd: STDOUT_FILENO,
-                flags: 0,
-                path: None,
-            },
-        );
-        entries.insert(
-            STDERR_FILENO,
-            FdEntry::Passthrough {
-                kernel_fd: STDERR_FILENO,
-                flags: 0,
-                path: None,
-            },
-        );
+        for fd in [STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO] {
+            snapshot.insert(
+                fd,
+                Arc::new(FdEntry::Passthrough {
+                    kernel_fd: fd,
+                    flags: 0,
+                    path: None,
+                }),
+            );
+        }
 
         Self {
-            inner: Arc::new(Mutex::new(FdTableInner {
-                entries,
-                next_vfd: FIRST_USER_FD,
-                free_fds: BinaryHeap::new(),
-            })),
+            inner: Arc::new(Shared::new(Arc::new(snapshot))),
         }
     }
 
     /// Create a deep clone of this FD table (for fork/clone syscalls)
     ///
-    /// This creates a completely independent copy of the FD table,
-    /// unlike the default Clone which shares the underlying table.
+    /// The copy is independent of this table, unlike the default Clone which
+    /// shares the underlying table. Both start out sharing the current
+    /// contents, which each copies the first time it changes, so forking
+    /// costs the same however many FDs are open.
     pub fn deep_clone(&self) -> Self {
-        let inner = self
-            .inner
-            .lock()
-            .unwrap_or_else(|poisoned| poisoned.into_inner());
-
         Self {
-            inner: Arc::new(Mutex::new(FdTableInner {
-                entries: inner.entries.clone(),
-                next_vfd: inner.next_vfd,
-                free_fds: inner.free_fds.clone(),
-            })),
+            inner: Arc::new(Shared::new(self.inner.snapshot())),
         }
     }
 
     /// Allocate a new virtual FD for the given FdEntry
     ///
     /// This uses the lowest available FD number, as required by POSIX.
-    pub fn allocate(&self, entry: FdEntry) -> i32 {
-        let mut inner = self
-            .inner
-            .lock()
-            .unwrap_or_else(|poisoned| poisoned.into_inner());
-
-        // Try to reuse a freed FD first (POSIX requires lowest available FD)
-        let vfd = if let Some(std::cmp::Reverse(free_fd)) = inner.free_fds.pop() {
-            free_fd
-        } else {
-            // No free FDs, allocate a new one
-            let vfd = inner.next_vfd;
-            if vfd == i32::MAX {
-                // FD exhaustion - search for gaps in allocated FDs
-                // This is a rare edge case
-                (FIRST_USER_FD..i32::MAX)
-                    .find(|fd| !inner.entries.contains_key(fd))
-                    .expect("File descriptor table exhausted")
-            } else {
-                inner.next_vfd += 1;
-                vfd
-            }
-        };
-
-        inner.entries.insert(vfd, entry);
-        vfd
+    /// Passing an `Arc<FdEntry>` shares the entry instead of copying it.
+    pub fn allocate(&self, entry: impl Into<Arc<FdEntry>>) -> i32 {
+        self.allocate_min(FIRST_USER_FD, entry)
     }
 
     /// Allocate a new virtual FD at or above the specified minimum
     ///
     /// This is used for fcntl F_DUPFD and F_DUPFD_CLOEXEC commands.
-    pub fn allocate_min(&self, min_vfd: i32, entry: FdEntry) -> i32 {
-        let mut inner = self
-            .inner
-            .lock()
-            .unwrap_or_else(|poisoned| poisoned.into_inner());
-
-        // Find the lowest available FD >= min_vfd
-        let vfd = (min_vfd..i32::MAX)
-            .find(|fd| !inner.entries.contains_key(fd))
-            .expect("File descriptor table exhausted");
-
-        // Update next_vfd if we allocated beyond it
-        if vfd >= inner.next_vfd {
-            // We just "skipped over" the range [next_vfd, vfd). Those FDs are now
-            // valid, unused, and must be eligible for `allocate()` (lowest-available).
-            let mut fd = inner.next_vfd;
-            while fd < vfd {
-                if fd >= FIRST_USER_FD && !inner.entries.contains_key(&fd) {
-                    inner.free_fds.push(std::cmp::Reverse(fd));
-                }
-                fd = fd.checked_add(1).expect("fd overflow");
-            }
-            inner.next_vfd = vfd + 1;
-        }
-
-        // Remove from free list if it was there
-        inner.free_fds = inner
-            .free_fds
-            .clone()
-            .into_iter()
-            .filter(|&std::cmp::Reverse(fd)| fd != vfd)
-            .collect();
-
-        inner.entries.insert(vfd, entry);
-        vfd
+    pub fn allocate_min(&self, min_vfd: i32, entry: impl Into<Arc<FdEntry>>) -> i32 {
+        let entry = entry.into();
+        self.inner.update(|current| {
+            let vfd = current.lowest_free(min_vfd);
+            let mut next = current.clone();
+            next.insert(vfd, entry);
+            (Some(next), vfd)
+        })
     }
 
     /// Allocate a specific virtual FD (used for dup2)
     ///
     /// Returns the old FdEntry if the VFD was already allocated, which the caller
     /// should close if needed.
-    pub fn allocate_at(&self, vfd: i32, entry: FdEntry) -> Option<FdEntry> {
-        let mut inner = self
-            .inner
-            .lock()
-            .unwrap_or_else(|poisoned| poisoned.into_inner());
-
-        // Remove the FD from free list if it's there
-        // (This is inefficient but dup2 to freed FDs is rare)
-        inner.free_fds = inner
-            .free_fds
-            .clone()
-            .into_iter()
-            .filter(|&std::cmp::Reverse(fd)| fd != vfd)
-            .collect();
-
-        // Update next_vfd if necessary
-        if vfd >= inner.next_vfd {
-            // Like `allocate_min`, allocating at a far FD creates gaps that must remain
-            // available for subsequent `allocate()` calls.
-            let mut fd = inner.next_vfd;
-            while fd < vfd {
-                if fd >= FIRST_USER_FD && !inner.entries.contains_key(&fd) {
-                    inner.free_fds.push(std::cmp::Reverse(fd));
-                }
-                fd = fd.checked_add(1).expect("fd overflow");
-            }
-            inner.next_vfd = vfd + 1;
-        }
-
-        // Insert the new entry and return the old one if it existed
-        inner.entries.insert(vfd, entry)
+    pub fn allocate_at(&self, vfd: i32, entry: impl Into<Arc<FdEntry>>) -> Option<Arc<FdEntry>> {
+        let entry = entry.into();
+        self.inner.update(|current| {
+            let mut next = current.clone();
+            let old = next.insert(vfd, entry);
+            (Some(next), old)
+        })
     }
 
     /// Translate a virtual FD to a kernel FD
@@ -254,52 +328,54 @@ impl FdTable {
     /// Returns the kernel FD if this is a passthrough file, or None if it's a
     /// virtualized file or the VFD doesn't exist.
     pub fn translate(&self, vfd: i32) -> Option<i32> {
-        let inner = self
-            .inner
-            .lock()
-            .unwrap_or_else(|poisoned| poisoned.into_inner());
-        inner.entries.get(&vfd).and_then(|entry| entry.kernel_fd())
+        self.inner
+            .read(|current| current.get(vfd).and_then(|entry| entry.kernel_fd()))
     }
 
     /// Get the full entry for a virtual FD
-    pub fn get(&self, vfd: i32) -> Option<FdEntry> {
-        let inner = self
-            .inner
-            .lock()
-            .unwrap_or_else(|poisoned| poisoned.into_inner());
-        inner.entries.get(&vfd).cloned()
+    pub fn get(&self, vfd: i32) -> Option<Arc<FdEntry>> {
+        self.inner.read(|current| current.get(vfd).cloned())
     }
 
     /// Deallocate a virtual FD and mark it as available for reuse
-    pub fn deallocate(&self, vfd: i32) -> Option<FdEntry> {
-        let mut inner = self
-            .inner
-            .lock()
-            .unwrap_or_else(|poisoned| poisoned.into_inner());
-
-        let entry = inner.entries.remove(&vfd)?;
-
-        // Add to free list for reuse (unless it's a standard FD)
-        if vfd >= FIRST_USER_FD {
-            inner.free_fds.push(std::cmp::Reverse(vfd));
-        }
-
-        Some(entry)
+    pub fn deallocate(&self, vfd: i32) -> Option<Arc<FdEntry>> {
+        self.inner.update(|current| {
+            if !current.contains(vfd) {
+                return (None, None);
+            }
+            let mut next = current.clone();
+            let entry = next.remove(vfd);
+            (Some(next), entry)
+        })
     }
 
     /// Duplicate a virtual FD (for dup syscall)
+    ///
+    /// The new FD shares the entry of the old one.
     pub fn duplicate(&self, old_vfd: i32) -> Option<i32> {
-        let entry = self.get(old_vfd)?;
-        // Allocate a new virtual FD pointing to the same file operations
-        Some(self.allocate(entry))
+        self.inner.update(|current| {
+            let Some(entry) = current.get(old_vfd) else {
+                return (None, None);
+            };
+            let vfd = current.lowest_free(FIRST_USER_FD);
+            let mut next = current.clone();
+            next.insert(vfd, entry.clone());
+            (Some(next), Some(vfd))
+        })
     }
 
     /// Duplicate a virtual FD to a specific new FD (for dup2 syscall)
     ///
     /// Returns the old entry that was at new_vfd if it existed (caller should close it)
-    pub fn duplicate_at(&self, old_vfd: i32, new_vfd: i32) -> Option<FdEntry> {
-        let entry = self.get(old_vfd)?;
-        self.allocate_at(new_vfd, entry)
+    pub fn duplicate_at(&self, old_vfd: i32, new_vfd: i32) -> Option<Arc<FdEntry>> {
+        self.inner.update(|current| {
+            let Some(entry) = current.get(old_vfd) else {
+                return (None, None);
+            };
+            let mut next = current.clone();
+            let old = next.insert(new_vfd, entry.clone());
+            (Some(next), old)
+        })
     }
 }
 
@@ -311,11 +387,9 @@ impl Default for FdTable {
 
 impl std::fmt::Debug for FdTable {
     fn fmt(&self, f: &mut std::fmt::Formatter<'_>) -> std::fmt::Result {
-        let inner = self.inner.lock().unwrap();
+        let entry_count = self.inner.read(|current| current.len());
         f.debug_struct("FdTable")
-            .field("entry_count", &inner.entries.len())
-            .field("next_vfd", &inner.next_vfd)
-            .field("free_fds_count", &inner.free_fds.len())
+            .field("entry_count", &entry_count)
             .finish()
     }
 }
@@ -409,6 +483,81 @@ mod tests {
         assert!(result.is_none());
         assert_eq!(table.translate(10), Some(100));
     }
+
+    #[test]
+    fn test_duplicate_shares_entry() {
+        let table = FdTable::new();
+
+        let vfd1 = table.allocate(FdEntry::Passthrough {
+            kernel_fd: 100,
+            flags: 0,
+            path: None,
+        });
+        let vfd2 = table.duplicate(vfd1).unwrap();
+
+        assert!(Arc::ptr_eq(
+            &table.get(vfd1).unwrap(),
+            &table.get(vfd2).unwrap()
+        ));
+    }
+
+    #[test]
+    fn test_deep_clone_is_independent() {
+        let table = FdTable::new();
+        let vfd = table.allocate(FdEntry::Passthrough {
+            kernel_fd: 100,
+            flags: 0,
+            path: None,
+        });
+
+        let child = table.deep_clone();
+        assert_eq!(child.translate(vfd), Some(100));
+
+        child.deallocate(vfd);
+        let high = child.allocate_at(
+            5000,
+            FdEntry::Passthrough {
+                kernel_fd: 101,
+                flags: 0,
+                path: None,
+            },
+        );
+        assert!(high.is_none());
+
+        assert_eq!(table.translate(vfd), Some(100));
+        assert_eq!(table.translate(5000), None);
+        assert_eq!(child.translate(vfd), None);
+        assert_eq!(child.translate(5000), Some(101));
+    }
+
+    #[test]
+    fn test_concurrent_lookups() {
+        let table = FdTable::new();
+        let stable = table.allocate(FdEntry::Passthrough {
+            kernel_fd: 100,
+            flags: 0,
+            path: None,
+        });
+
+        std::thread::scope(|scope| {
+            for _ in 0..4 {
+                scope.spawn(|| {
+                    for _ in 0..10_000 {
+                        assert_eq!(table.translate(stable), Some(100));
+                    }
+                });
+            }
+            for i in 0..1_000 {
+                let vfd = table.allocate(FdEntry::Passthrough {
+                    kernel_fd: 200 + i,
+                    flags: 0,
+                    path: None,
+                });
+                assert_eq!(table.translate(vfd), Some(200 + i));
+                table.deallocate(vfd);
+            }
+        });
+    }
 }
 
 /// Property tests for `FdTable` correctness.
@@ -1,6 +1,8 @@
 use super::file::{BoxedFileOps, FileOps};
 use super::{Vfs, VfsError, VfsResult};
-use agentfs_sdk::{filesystem::AgentFS, FileSystem};
+use agentfs_sdk::{
+    filesystem::AgentFS, BoxedFile, FileSystem, DEFAULT_FILE_MODE, DEFAULT_WRITE_BUFFER_BYTES,
+};
 use std::os::unix::io::RawFd;
 use std::path::{Path, PathBuf};
 use std::sync::{Arc, Mutex};
@@ -15,8 +17,14 @@ pub struct SqliteVfs {
     fs: Arc<dyn FileSystem>,
     /// The virtual path as seen by the sandboxed process
     mount_point: PathBuf,
+    /// Chunk size of the filesystem, which reads are aligned to
+    chunk_size: u64,
 }
 
+/// Minimum number of chunks a file read fetches, so that small sequential
+/// reads don't each go to the database
+const READ_AHEAD_CHUNKS: u64 = 4;
+
 impl SqliteVfs {
     /// Create a new SQLite VFS
     ///
@@ -32,10 +40,15 @@ impl SqliteVfs {
         let fs = AgentFS::new(db_path_str)
             .await
             .map_err(|e| VfsError::Other(format!("Failed to create filesystem: {}", e)))?;
+        // File handles keep their writes in memory until closed or synced,
+        // then write back only the chunks they touched
+        fs.set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
+        let chunk_size = fs.chunk_size() as u64;
 
         Ok(Self {
             fs: Arc::new(fs) as Arc<dyn FileSystem>,
             mount_point,
+            chunk_size,
         })
     }
 
@@ -112,39 +125,31 @@ impl Vfs for SqliteVfs {
                         position: Arc::new(Mutex::new(0)),
                     }))
                 } else {
-                    // If O_TRUNC is set, skip reading the file and use empty data
-                    let data = if flags & libc::O_TRUNC != 0 {
-                        Vec::new()
-                    } else {
-                        self.fs
-                            .read_file(&relative_path)
-                            .await
-                            .map_err(|e| VfsError::Other(format!("Failed to read file: {}", e)))?
-                            .ok_or(VfsError::NotFound)?
-                    };
-                    Ok(Arc::new(SqliteFileOps {
-                        fs: self.fs.clone(),
-                        path: relative_path,
-                        data: Arc::new(Mutex::new(data)),
-                        offset: Arc::new(Mutex::new(0)),
-                        flags: Mutex::new(flags),
-                        dirty: Arc::new(Mutex::new(flags & libc::O_TRUNC != 0)),
-                    }))
+                    // Open a handle without reading anything; data is read
+                    // and written chunk by chunk as the guest accesses it
+                    let file = self
+                        .fs
+                        .open(&relative_path)
+                        .await
+                        .map_err(|e| VfsError::Other(format!("Failed to open file: {}", e)))?;
+                    if flags & libc::O_TRUNC != 0 {
+                        file.truncate(0).await.map_err(|e| {
+                            VfsError::Other(format!("Failed to truncate file: {}", e))
+                        })?;
+                    }
+                    Ok(Arc::new(SqliteFileOps::new(file, self.chunk_size, flags)))
                 }
             }
             None => {
                 // File doesn't exist - check if O_CREAT is set
                 if flags & libc::O_CREAT != 0 {
-                    let data = Vec::new();
+                    let (_, file) = self
+                        .fs
+                        .create_file(&relative_path, DEFAULT_FILE_MODE)
+                        .await
+                        .map_err(|e| VfsError::Other(format!("Failed to create file: {}", e)))?;
 
-                    Ok(Arc::new(SqliteFileOps {
-                        fs: self.fs.clone(),
-                        path: relative_path,
-                        data: Arc::new(Mutex::new(data)),
-                        offset: Arc::new(Mutex::new(0)),
-                        flags: Mutex::new(flags),
-                        dirty: Arc::new(Mutex::new(true)), // Mark as dirty so it gets written on close
-                    }))
+                    Ok(Arc::new(SqliteFileOps::new(file, self.chunk_size, flags)))
                 } else {
                     // File doesn't exist and O_CREAT not set
                     Err(VfsError::NotFound)
@@ -257,87 +262,144 @@ impl Vfs for SqliteVfs {
         let oldpath_rel = self.translate_to_relative(oldpath)?;
         let newpath_rel = self.translate_to_relative(newpath)?;
 
-        self.fs
-            .link(&oldpath_rel, &newpath_rel)
-            .await
-            .map_err(|e| {
-                let err_msg = e.to_string();
-                if err_msg.contains("does not exist") {
-                    VfsError::NotFound
-                } else if err_msg.contains("already exists") {
-                    VfsError::AlreadyExists
-                } else if err_msg.contains("directory") {
-                    VfsError::PermissionDenied
-                } else {
-                    VfsError::Other(format!("Failed to create hard link: {}", e))
-                }
-            })
+        self.fs.link(&oldpath_rel, &newpath_rel).await.map_err(|e| {
+            let err_msg = e.to_string();
+            if err_msg.contains("does not exist") {
+                VfsError::NotFound
+            } else if err_msg.contains("already exists") {
+                VfsError::AlreadyExists
+            } else if err_msg.contains("directory") {
+                VfsError::PermissionDenied
+            } else {
+                VfsError::Other(format!("Failed to create hard link: {}", e))
+            }
+        })
     }
 }
 
 /// File operations for SQLite VFS files
+///
+/// Reads and writes go through an SDK file handle, which stores the file in
+/// chunks, so the cost of an access depends on the bytes touched rather than
+/// on the size of the file.
 struct SqliteFileOps {
-    fs: Arc<dyn FileSystem>,
-    path: String,
-    data: Arc<Mutex<Vec<u8>>>,
-    offset: Arc<Mutex<i64>>,
+    file: BoxedFile,
+    chunk_size: u64,
+    cursor: tokio::sync::Mutex<Cursor>,
     flags: Mutex<i32>,
-    dirty: Arc<Mutex<bool>>,
+}
+
+/// File offset of an open file, and the data last read around it
+#[derive(Default)]
+struct Cursor {
+    offset: i64,
+    /// Whole chunks read from the file, as their start offset and contents
+    read_ahead: Option<(u64, Vec<u8>)>,
+}
+
+impl Cursor {
+    /// Whether `len` bytes at `offset` can be served from the read-ahead
+    fn covers(&self, offset: u64, len: usize) -> bool {
+        matches!(&self.read_ahead, Some((start, data))
+            if *start <= offset && offset + len as u64 <= start + data.len() as u64)
+    }
+}
+
+impl SqliteFileOps {
+    fn new(file: BoxedFile, chunk_size: u64, flags: i32) -> Self {
+        Self {
+            file,
+            chunk_size,
+            cursor: tokio::sync::Mutex::new(Cursor::default()),
+            flags: Mutex::new(flags),
+        }
+    }
+
+    /// Current size of the file, including writes not yet written back
+    async fn size(&self) -> VfsResult<u64> {
+        let stats = self
+            .file
+            .fstat()
+            .await
+            .map_err(|e| VfsError::Other(format!("Failed to stat: {}", e)))?;
+        Ok(stats.size as u64)
+    }
 }
 
 #[async_trait::async_trait]
 impl FileOps for SqliteFileOps {
     async fn read(&self, buf: &mut [u8]) -> VfsResult<usize> {
-        let data = self.data.lock().unwrap();
-        let mut offset = self.offset.lock().unwrap();
+        let mut cursor = self.cursor.lock().await;
+        let start = cursor.offset as u64;
+
+        if !cursor.covers(start, buf.len()) {
+            // File handles read zeros past the end of the file, so stop there
+            let file_size = self.size().await?;
+            if start >= file_size {
+                cursor.read_ahead = None;
+                return Ok(0);
+            }
 
-        let start = *offset as usize;
-        if start >= data.len() {
-            return Ok(0);
+            // Fetch whole chunks around the request, and at least a few of
+            // them, so the following reads are likely to be covered too
+            let read_start = start - start % self.chunk_size;
+            let size = (start + buf.len() as u64 - read_start)
+                .max(READ_AHEAD_CHUNKS * self.chunk_size)
+                .div_ceil(self.chunk_size)
+                * self.chunk_size;
+            let size = std::cmp::min(size, file_size - read_start);
+            let data = self
+                .file
+                .pread(read_start, size)
+                .await
+                .map_err(|e| VfsError::Other(format!("Failed to read file: {}", e)))?;
+            cursor.read_ahead = Some((read_start, data));
         }
 
-        let end = std::cmp::min(start + buf.len(), data.len());
-        let bytes_read = end - start;
-        buf[..bytes_read].copy_from_slice(&data[start..end]);
-        *offset += bytes_read as i64;
+        let (data_start, data) = cursor.read_ahead.as_ref().unwrap();
+        let from = (start - data_start) as usize;
+        let available = data.get(from..).unwrap_or_default();
+        let bytes_read = std::cmp::min(buf.len(), available.len());
+        buf[..bytes_read].copy_from_slice(&available[..bytes_read]);
+
+        // A read that reached the end of the file isn't kept, so data
+        // appended by others (as with `tail -f`) is seen by the next read
+        if bytes_read < buf.len() {
+            cursor.read_ahead = None;
+        }
+        cursor.offset += bytes_read as i64;
 
         Ok(bytes_read)
     }
 
     async fn write(&self, buf: &[u8]) -> VfsResult<usize> {
-        let mut data = self.data.lock().unwrap();
-        let mut offset = self.offset.lock().unwrap();
-        let flags = *self.flags.lock().unwrap();
+        let mut cursor = self.cursor.lock().await;
+        let flags = self.get_flags();
 
         // Handle O_APPEND: always write at the end of the file
         let start = if flags & libc::O_APPEND != 0 {
-            data.len()
+            self.size().await?
         } else {
-            *offset as usize
+            cursor.offset as u64
         };
 
-        // Extend the buffer if necessary
-        if start + buf.len() > data.len() {
-            data.resize(start + buf.len(), 0);
-        }
-
-        data[start..start + buf.len()].copy_from_slice(buf);
-        *offset = (start + buf.len()) as i64;
-
-        // Mark as dirty since we modified the data
-        *self.dirty.lock().unwrap() = true;
+        self.file
+            .pwrite(start, buf)
+            .await
+            .map_err(|e| VfsError::Other(format!("Failed to write file: {}", e)))?;
+        cursor.read_ahead = None;
+        cursor.offset = (start + buf.len() as u64) as i64;
 
         Ok(buf.len())
     }
 
     async fn seek(&self, offset: i64, whence: i32) -> VfsResult<i64> {
-        let data = self.data.lock().unwrap();
-        let mut current_offset = self.offset.lock().unwrap();
+        let mut cursor = self.cursor.lock().await;
 
         let new_offset = match whence {
             libc::SEEK_SET => offset,
-            libc::SEEK_CUR => *current_offset + offset,
-            libc::SEEK_END => data.len() as i64 + offset,
+            libc::SEEK_CUR => cursor.offset + offset,
+            libc::SEEK_END => self.size().await? as i64 + offset,
             _ => return Err(VfsError::Other("Invalid whence".to_string())),
         };
 
@@ -345,20 +407,17 @@ impl FileOps for SqliteFileOps {
             return Err(VfsError::Other("Invalid offset".to_string()));
         }
 
-        *current_offset = new_offset;
+        cursor.offset = new_offset;
         Ok(new_offset)
     }
 
     async fn fstat(&self) -> VfsResult<libc::stat> {
-        // Get the actual file stats from the filesystem
+        // Get the file stats from the handle, which include buffered writes
         let stats = self
-            .fs
-            .stat(&self.path)
+            .file
+            .fstat()
             .await
-            .map_err(|e| VfsError::Other(format!("Failed to stat: {}", e)))?
-            .ok_or(VfsError::NotFound)?;
-
-        let data = self.data.lock().unwrap();
+            .map_err(|e| VfsError::Other(format!("Failed to stat: {}", e)))?;
 
         // Use MaybeUninit to construct libc::stat safely
         let mut stat: std::mem::MaybeUninit<libc::stat> = std::mem::MaybeUninit::zeroed();
@@ -371,9 +430,9 @@ impl FileOps for SqliteFileOps {
             (*stat_ptr).st_uid = stats.uid;
             (*stat_ptr).st_gid = stats.gid;
             (*stat_ptr).st_rdev = 0;
-            (*stat_ptr).st_size = data.len() as i64;
+            (*stat_ptr).st_size = stats.size;
             (*stat_ptr).st_blksize = 4096;
-            (*stat_ptr).st_blocks = (data.len() as i64 + 4095) / 4096;
+            (*stat_ptr).st_blocks = (stats.size + 4095) / 4096;
             (*stat_ptr).st_atime = stats.atime;
             (*stat_ptr).st_atime_nsec = 0;
             (*stat_ptr).st_mtime = stats.mtime;
@@ -385,24 +444,11 @@ impl FileOps for SqliteFileOps {
     }
 
     async fn fsync(&self) -> VfsResult<()> {
-        // For virtual file, sync means write to database
-        let dirty = *self.dirty.lock().unwrap();
-        if !dirty {
-            return Ok(());
-        }
-
-        let data = self.data.lock().unwrap().clone();
-
-        // Write the data to the database
-        self.fs
-            .write_file(&self.path, &data)
+        // Write back buffered chunks and make them durable
+        self.file
+            .fsync()
             .await
-            .map_err(|e| VfsError::Other(format!("Failed to write file: {}", e)))?;
-
-        // Clear dirty flag after successful write
-        *self.dirty.lock().unwrap() = false;
-
-        Ok(())
+            .map_err(|e| VfsError::Other(format!("Failed to sync file: {}", e)))
     }
 
     async fn fdatasync(&self) -> VfsResult<()> {
@@ -435,8 +481,11 @@ impl FileOps for SqliteFileOps {
     }
 
     async fn close(&self) -> VfsResult<()> {
-        // Ensure all data is written to the database before closing
-        self.fsync().await
+        // Write back the chunks this handle dirtied
+        self.file
+            .flush()
+            .await
+            .map_err(|e| VfsError::Other(format!("Failed to write file: {}", e)))
     }
 
     fn get_flags(&self) -> i32 {
@@ -652,3 +701,121 @@ impl FileOps for SqliteDirectoryOps {
         }
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    async fn create_vfs() -> (SqliteVfs, tempfile::TempDir) {
+        let dir = tempfile::tempdir().unwrap();
+        let vfs = SqliteVfs::new(dir.path().join("vfs.db"), PathBuf::from("/agent"))
+            .await
+            .unwrap();
+        (vfs, dir)
+    }
+
+    fn path(name: &str) -> PathBuf {
+        Path::new("/agent").join(name)
+    }
+
+    async fn write_file(vfs: &SqliteVfs, name: &str, data: &[u8]) {
+        let file = vfs
+            .open(&path(name), libc::O_CREAT | libc::O_WRONLY, 0o644)
+            .await
+            .unwrap();
+        assert_eq!(file.write(data).await.unwrap(), data.len());
+        file.close().await.unwrap();
+    }
+
+    async fn read_file(vfs: &SqliteVfs, name: &str) -> Vec<u8> {
+        let file = vfs.open(&path(name), libc::O_RDONLY, 0).await.unwrap();
+        let mut data = Vec::new();
+        let mut buf = [0u8; 7];
+        loop {
+            let n = file.read(&mut buf).await.unwrap();
+            if n == 0 {
+                return data;
+            }
+            data.extend_from_slice(&buf[..n]);
+        }
+    }
+
+    #[tokio::test]
+    async fn test_short_reads_at_and_past_eof() {
+        let (vfs, _dir) = create_vfs().await;
+        write_file(&vfs, "short.txt", b"hello").await;
+
+        let file = vfs
+            .open(&path("short.txt"), libc::O_RDONLY, 0)
+            .await
+            .unwrap();
+        let mut buf = [0u8; 16];
+        assert_eq!(file.read(&mut buf).await.unwrap(), 5);
+        assert_eq!(&buf[..5], b"hello");
+        assert_eq!(file.read(&mut buf).await.unwrap(), 0);
+
+        file.seek(100, libc::SEEK_SET).await.unwrap();
+        assert_eq!(file.read(&mut buf).await.unwrap(), 0);
+    }
+
+    #[tokio::test]
+    async fn test_append_through_two_handles() {
+        let (vfs, _dir) = create_vfs().await;
+        write_file(&vfs, "log.txt", b"").await;
+
+        let flags = libc::O_WRONLY | libc::O_APPEND;
+        let first = vfs.open(&path("log.txt"), flags, 0).await.unwrap();
+        let second = vfs.open(&path("log.txt"), flags, 0).await.unwrap();
+        first.write(b"one ").await.unwrap();
+        second.write(b"two ").await.unwrap();
+        first.write(b"three").await.unwrap();
+        first.close().await.unwrap();
+        second.close().await.unwrap();
+
+        assert_eq!(read_file(&vfs, "log.txt").await, b"one two three");
+    }
+
+    #[tokio::test]
+    async fn test_truncate_at_open() {
+        let (vfs, _dir) = create_vfs().await;
+        write_file(&vfs, "t.txt", b"old contents").await;
+
+        let file = vfs
+            .open(&path("t.txt"), libc::O_WRONLY | libc::O_TRUNC, 0)
+            .await
+            .unwrap();
+        assert_eq!(file.fstat().await.unwrap().st_size, 0);
+        file.write(b"new").await.unwrap();
+        file.close().await.unwrap();
+
+        assert_eq!(read_file(&vfs, "t.txt").await, b"new");
+    }
+
+    #[tokio::test]
+    async fn test_read_after_append_by_other_handle() {
+        let (vfs, _dir) = create_vfs().await;
+        write_file(&vfs, "tail.txt", b"abc").await;
+
+        let reader = vfs
+            .open(&path("tail.txt"), libc::O_RDONLY, 0)
+            .await
+            .unwrap();
+        let mut buf = [0u8; 16];
+        assert_eq!(reader.read(&mut buf[..2]).await.unwrap(), 2);
+        assert_eq!(&buf[..2], b"ab");
+
+        // The rest of the file was read ahead; the appended bytes still show
+        let writer = vfs
+            .open(&path("tail.txt"), libc::O_WRONLY | libc::O_APPEND, 0)
+            .await
+            .unwrap();
+        writer.write(b"def").await.unwrap();
+        assert_eq!(reader.read(&mut buf).await.unwrap(), 4);
+        assert_eq!(&buf[..4], b"cdef");
+        assert_eq!(reader.read(&mut buf).await.unwrap(), 0);
+
+        writer.write(b"g").await.unwrap();
+        assert_eq!(reader.read(&mut buf).await.unwrap(), 1);
+        assert_eq!(buf[0], b'g');
+    }
+}
@@ -11,3 +11,7 @@ DEFAULT_FILE_MODE = S_IFREG | 0o644  # Regular file, rw-r--r--
 DEFAULT_DIR_MODE = S_IFDIR | 0o755  # Directory, rwxr-xr-x
 
 DEFAULT_CHUNK_SIZE = 4096
+
+# fs_config keys for storage layouts this SDK cannot read or write; a
+# filesystem that sets any of them is refused rather than misread
+UNSUPPORTED_CONFIG_KEYS = ("dedup", "compression", "extent_size")
@@ -14,6 +14,7 @@ from .constants import (
     S_IFLNK,
     S_IFMT,
     S_IFREG,
+    UNSUPPORTED_CONFIG_KEYS,
 )
 from .errors import ErrnoException, FsSyscall
 from .guards import (
@@ -168,6 +169,18 @@ class Filesystem:
         else:
             chunk_size = int(config[0]) if config[0] else DEFAULT_CHUNK_SIZE
 
+        placeholders = ", ".join("?" for _ in UNSUPPORTED_CONFIG_KEYS)
+        cursor = await self._db.execute(
+            f"SELECT key, value FROM fs_config WHERE key IN ({placeholders})",
+            UNSUPPORTED_CONFIG_KEYS,
+        )
+        unsupported = await cursor.fetchone()
+        if unsupported:
+            raise ValueError(
+                f"Unsupported filesystem: fs_config sets {unsupported[0]} = '{unsupported[1]}', "
+                "which this SDK does not implement"
+            )
+
         # Ensure root directory exists
         cursor = await self._db.execute("SELECT ino FROM fs_inode WHERE ino = ?", (self._root_ino,))
         root = await cursor.fetchone()
@@ -1,12 +1,17 @@
 """Key-Value Store implementation"""
 
 import json
-from typing import Any, Dict, List, Optional, TypeVar
+from collections import OrderedDict
+from typing import Any, Dict, Iterable, List, Optional, Tuple, TypeVar, Union
 
 from turso.aio import Connection
 
 T = TypeVar("T")
 
+# Keys per statement in batched operations, well below SQLite's limit on
+# bound parameters
+KEYS_PER_STATEMENT = 256
+
 
 class KvStore:
     """Key-Value store backed by SQLite
@@ -15,24 +20,58 @@ class KvStore:
     for storing arbitrary Python objects.
     """
 
-    def __init__(self, db: Connection):
+    def __init__(self, db: Connection, cache_size: Optional[int] = None):
         """Private constructor - use KvStore.from_database() instead"""
         self._db = db
+        # Serialized values (None for missing keys), least recently used first
+        self._cache: Optional["OrderedDict[str, Optional[str]]"] = (
+            OrderedDict() if cache_size else None
+        )
+        self._cache_size = cache_size or 0
+        # Bumped by every write, so a read that overlapped one doesn't fill
+        # the cache with the old value
+        self._generation = 0
 
     @staticmethod
-    async def from_database(db: Connection) -> "KvStore":
+    async def from_database(db: Connection, cache_size: Optional[int] = None) -> "KvStore":
         """Create a KvStore from an existing database connection
 
         Args:
             db: An existing pyturso.aio Connection
+            cache_size: Keep up to this many recently read values in memory.
+                Writes through this store keep the cache coherent; writes
+                through other connections are not seen, so only use it when
+                this store is the only writer.
 
         Returns:
             Fully initialized KvStore instance
         """
-        kv = KvStore(db)
+        kv = KvStore(db, cache_size)
         await kv._initialize()
         return kv
 
+    def _cache_get(self, key: str) -> Tuple[bool, Optional[str]]:
+        """Look up a serialized value, returning (hit, value)"""
+        if self._cache is None or key not in self._cache:
+            return False, None
+        self._cache.move_to_end(key)
+        return True, self._cache[key]
+
+    def _cache_fill(self, generation: int, key: str, value: Optional[str]) -> None:
+        if self._cache is None or generation != self._generation:
+            return
+        self._cache[key] = value
+        self._cache.move_to_end(key)
+        while len(self._cache) > self._cache_size:
+            self._cache.popitem(last=False)
+
+    def _invalidate(self, keys: Iterable[str]) -> None:
+        if self._cache is None:
+            return
+        self._generation += 1
+        for key in keys:
+            self._cache.pop(key, None)
+
     async def _initialize(self) -> None:
         """Initialize the database schema"""
         # Create the key-value store table if it doesn't exist
@@ -74,6 +113,40 @@ class KvStore:
             (key, serialized_value),
         )
         await self._db.commit()
+        self._invalidate([key])
+
+    async def set_many(self, entries: Union[Dict[str, Any], Iterable[Tuple[str, Any]]]) -> None:
+        """Set several key-value pairs in one transaction
+
+        Args:
+            entries: A mapping or (key, value) pairs; values are JSON serialized
+
+        Example:
+            >>> await kv.set_many({'step:1': {'done': True}, 'step:2': {'done': False}})
+        """
+        items = entries.items() if isinstance(entries, dict) else entries
+        serialized = [(key, json.dumps(value)) for key, value in items]
+        if not serialized:
+            return
+
+        try:
+            for key, value in serialized:
+                await self._db.execute(
+                    """
+                    INSERT INTO kv_store (key, value, updated_at)
+                    VALUES (?, ?, unixepoch())
+                    ON CONFLICT(key) DO UPDATE SET
+                        value = excluded.value,
+                        updated_at = unixepoch()
+                    """,
+                    (key, value),
+                )
+            await self._db.commit()
+        except Exception:
+            await self._db.rollback()
+            raise
+        finally:
+            self._invalidate(key for key, _ in serialized)
 
     async def get(self, key: str, default: Optional[T] = None) -> Optional[T]:
         """Get a value by key
@@ -90,14 +163,56 @@ class KvStore:
             >>> if user:
             >>>     print(user['name'])
         """
-        cursor = await self._db.execute("SELECT value FROM kv_store WHERE key = ?", (key,))
-        row = await cursor.fetchone()
+        hit, serialized = self._cache_get(key)
+        if not hit:
+            generation = self._generation
+            cursor = await self._db.execute("SELECT value FROM kv_store WHERE key = ?", (key,))
+            row = await cursor.fetchone()
+            serialized = row[0] if row else None
+            self._cache_fill(generation, key, serialized)
 
-        if not row:
+        if serialized is None:
             return default
 
         # Deserialize the JSON value
-        return json.loads(row[0])
+        return json.loads(serialized)
+
+    async def get_many(self, keys: List[str], default: Optional[T] = None) -> List[Optional[T]]:
+        """Get the values of several keys with one query per 256 keys
+
+        Args:
+            keys: The keys to retrieve
+            default: Value returned for keys that don't exist
+
+        Returns:
+            The deserialized values, in the order of `keys`
+
+        Example:
+            >>> first, second = await kv.get_many(['step:1', 'step:2'])
+        """
+        found: Dict[str, Optional[str]] = {}
+        missing = []
+        for key in keys:
+            hit, serialized = self._cache_get(key)
+            if hit:
+                found[key] = serialized
+            elif key not in found:
+                found[key] = None
+                missing.append(key)
+
+        generation = self._generation
+        for start in range(0, len(missing), KEYS_PER_STATEMENT):
+            batch = missing[start : start + KEYS_PER_STATEMENT]
+            placeholders = ", ".join("?" for _ in batch)
+            cursor = await self._db.execute(
+                f"SELECT key, value FROM kv_store WHERE key IN ({placeholders})", tuple(batch)
+            )
+            for row in await cursor.fetchall():
+                found[row[0]] = row[1]
+            for key in batch:
+                self._cache_fill(generation, key, found[key])
+
+        return [default if found[key] is None else json.loads(found[key]) for key in keys]
 
     async def list(self, prefix: str) -> List[Dict[str, Any]]:
         """List all keys matching a prefix
@@ -123,6 +238,42 @@ class KvStore:
 
         return [{"key": row[0], "value": json.loads(row[1])} for row in rows]
 
+    async def scan(
+        self, prefix: str = "", after: Optional[str] = None, limit: int = 100
+    ) -> List[Dict[str, Any]]:
+        """List a page of the entries whose keys match a prefix, in key order
+
+        Each page is a range scan of the primary key, so paging through a
+        large prefix costs one pass over it.
+
+        Args:
+            prefix: The prefix to match
+            after: Only return entries with keys after this one; pass the
+                last key of the previous page to get the next
+            limit: Maximum number of entries to return
+
+        Returns:
+            List of dictionaries with 'key' and 'value' fields
+
+        Example:
+            >>> page = await kv.scan('step:', limit=50)
+            >>> while page:
+            >>>     page = await kv.scan('step:', after=page[-1]['key'], limit=50)
+        """
+        upper = _prefix_upper_bound(prefix)
+        cursor = await self._db.execute(
+            """
+            SELECT key, value FROM kv_store
+            WHERE key >= ? AND (? IS NULL OR key < ?) AND (? IS NULL OR key > ?)
+            ORDER BY key
+            LIMIT ?
+            """,
+            (prefix, upper, upper, after, after, limit),
+        )
+        rows = await cursor.fetchall()
+
+        return [{"key": row[0], "value": json.loads(row[1])} for row in rows]
+
     async def delete(self, key: str) -> None:
         """Delete a key-value pair
 
@@ -134,3 +285,49 @@ class KvStore:
         """
         await self._db.execute("DELETE FROM kv_store WHERE key = ?", (key,))
         await self._db.commit()
+        self._invalidate([key])
+
+    async def delete_many(self, keys: List[str]) -> None:
+        """Delete several keys in one transaction
+
+        Args:
+            keys: The keys to delete
+
+        Example:
+            >>> await kv.delete_many(['step:1', 'step:2'])
+        """
+        if not keys:
+            return
+
+        try:
+            for start in range(0, len(keys), KEYS_PER_STATEMENT):
+                batch = keys[start : start + KEYS_PER_STATEMENT]
+                placeholders = ", ".join("?" for _ in batch)
+                await self._db.execute(
+                    f"DELETE FROM kv_store WHERE key IN ({placeholders})", tuple(batch)
+                )
+            await self._db.commit()
+        except Exception:
+            await self._db.rollback()
+            raise
+        finally:
+            self._invalidate(keys)
+
+
+def _prefix_upper_bound(prefix: str) -> Optional[str]:
+    """Smallest string greater than every string starting with `prefix`
+
+    SQLite compares text as UTF-8 bytes, which orders like code points, so
+    bumping the last character that can be bumped gives the bound. Returns
+    None if there is none.
+    """
+    chars = list(prefix)
+    while chars:
+        code = ord(chars.pop()) + 1
+        # Surrogates can't be encoded as UTF-8
+        if 0xD800 <= code <= 0xDFFF:
+            code = 0xE000
+        if code <= 0x10FFFF:
+            chars.append(chr(code))
+            return "".join(chars)
+    return None
@@ -584,6 +584,23 @@ class TestFilesystemDataIntegrity:
             await db.close()
 
 
+    @pytest.mark.parametrize(
+        "key, value", [("dedup", "sha256"), ("compression", "zstd"), ("extent_size", "65536")]
+    )
+    async def test_refuse_unsupported_storage_config(self, key, value):
+        """Should refuse a filesystem using a storage layout it does not implement"""
+        with tempfile.TemporaryDirectory() as tmpdir:
+            db_path = os.path.join(tmpdir, "test.db")
+            db = await connect(db_path)
+            await db.execute("PRAGMA unstable_capture_data_changes_conn('full')")
+            await Filesystem.from_database(db)
+            await db.execute("INSERT INTO fs_config (key, value) VALUES (?, ?)", (key, value))
+            await db.commit()
+
+            with pytest.raises(ValueError, match=key):
+                await Filesystem.from_database(db)
+            await db.close()
+
 @pytest.mark.asyncio
 class TestFilesystemEdgeCases:
     """Filesystem edge case tests"""
@@ -312,3 +312,76 @@ class TestKvStorePersistence:
             assert value == "persist-value"
 
             await db.close()
+
+
+@pytest.mark.asyncio
+class TestKvStoreBatchOperations:
+    """Batched and paged KvStore operations"""
+
+    async def test_get_set_delete_many(self):
+        """Should set, get and delete several keys at once"""
+        with tempfile.TemporaryDirectory() as tmpdir:
+            db_path = os.path.join(tmpdir, "test.db")
+            db = await connect(db_path)
+            await db.execute("PRAGMA unstable_capture_data_changes_conn('full')")
+            kv = await KvStore.from_database(db)
+
+            await kv.set_many({"step:1": 1, "step:2": {"done": True}})
+            values = await kv.get_many(["step:2", "missing", "step:1"])
+            assert values == [{"done": True}, None, 1]
+
+            await kv.delete_many(["step:1", "missing"])
+            assert await kv.get_many(["step:1", "step:2"], default=0) == [0, {"done": True}]
+            await db.close()
+
+    async def test_failed_batches_roll_back(self):
+        """Should leave the store unchanged when a batch fails part way"""
+        with tempfile.TemporaryDirectory() as tmpdir:
+            db_path = os.path.join(tmpdir, "test.db")
+            db = await connect(db_path)
+            await db.execute("PRAGMA unstable_capture_data_changes_conn('full')")
+            kv = await KvStore.from_database(db)
+
+            with pytest.raises(Exception):
+                await kv.set_many([("step:1", 1), (object(), 2)])
+            assert await kv.get("step:1") is None
+
+            keys = [f"k{i}" for i in range(300)]
+            await kv.set_many((key, 0) for key in keys)
+            with pytest.raises(Exception):
+                await kv.delete_many(keys + [object()])
+            assert await kv.get_many(["k0", "k299"]) == [0, 0]
+            await db.close()
+
+    async def test_scan_pages(self):
+        """Should page through keys with a prefix"""
+        with tempfile.TemporaryDirectory() as tmpdir:
+            db_path = os.path.join(tmpdir, "test.db")
+            db = await connect(db_path)
+            await db.execute("PRAGMA unstable_capture_data_changes_conn('full')")
+            kv = await KvStore.from_database(db)
+
+            await kv.set_many([(f"g1:k{i}", i) for i in range(5)] + [("g2:k0", 0)])
+
+            page = await kv.scan("g1:", limit=2)
+            assert page == [{"key": "g1:k0", "value": 0}, {"key": "g1:k1", "value": 1}]
+            page = await kv.scan("g1:", after=page[-1]["key"], limit=10)
+            assert [item["key"] for item in page] == ["g1:k2", "g1:k3", "g1:k4"]
+            await db.close()
+
+    async def test_cache_sees_own_writes(self):
+        """Should keep cached values in step with writes through the store"""
+        with tempfile.TemporaryDirectory() as tmpdir:
+            db_path = os.path.join(tmpdir, "test.db")
+            db = await connect(db_path)
+            await db.execute("PRAGMA unstable_capture_data_changes_conn('full')")
+            kv = await KvStore.from_database(db, cache_size=16)
+
+            assert await kv.get("key") is None
+            await kv.set("key", "first")
+            assert await kv.get("key") == "first"
+            await kv.set_many({"key": "second"})
+            assert await kv.get_many(["key"]) == ["second"]
+            await kv.delete("key")
+            assert await kv.get("key") is None
+            await db.close()
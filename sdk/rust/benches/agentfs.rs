@@ -0,0 +1,241 @@
+//! Performance benchmarks for the AgentFS storage layer.
+//!
+//! Run with: cargo bench --bench agentfs
+//!
+//! Save a baseline before a change and compare against it afterwards:
+//!
+//!     cargo bench --bench agentfs -- --save-baseline main
+//!     cargo bench --bench agentfs -- --baseline main
+
+use agentfs_sdk::filesystem::{AgentFS, DEFAULT_FILE_MODE};
+use criterion::{criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput};
+use std::time::{SystemTime, UNIX_EPOCH};
+use tempfile::{tempdir, TempDir};
+use tokio::runtime::Runtime;
+
+/// Create an empty AgentFS in a fresh temporary directory
+fn new_fs(rt: &Runtime) -> (AgentFS, TempDir) {
+    rt.block_on(async {
+        let dir = tempdir().expect("Failed to create temp dir");
+        let db_path = dir.path().join("bench.db");
+        let fs = AgentFS::new(db_path.to_str().unwrap())
+            .await
+            .expect("Failed to create AgentFS");
+        (fs, dir)
+    })
+}
+
+/// Create `count` empty files in `dir` in a single transaction
+///
+/// Going through `create_file` commits once per file, which makes the 100k
+/// entry fixtures take minutes to build.
+async fn populate_dir(fs: &AgentFS, dir: &str, count: usize) {
+    fs.mkdir(dir).await.expect("Failed to create directory");
+    let parent_ino = fs.lstat(dir).await.unwrap().unwrap().ino;
+    let now = SystemTime::now()
+        .duration_since(UNIX_EPOCH)
+        .unwrap()
+        .as_secs() as i64;
+
+    let conn = fs.get_connection();
+    conn.execute("BEGIN IMMEDIATE", ()).await.unwrap();
+    for i in 0..count {
+        let mut stmt = conn
+            .prepare_cached(
+                "INSERT INTO fs_inode (mode, nlink, uid, gid, size, atime, mtime, ctime)
+                 VALUES (?, 1, 0, 0, 0, ?, ?, ?) RETURNING ino",
+            )
+            .await
+            .unwrap();
+        let row = stmt
+            .query_row((DEFAULT_FILE_MODE as i64, now, now, now))
+            .await
+            .unwrap();
+        let ino = row
+            .get_value(0)
+            .ok()
+            .and_then(|v| v.as_integer().copied())
+            .unwrap();
+
+        let mut stmt = conn
+            .prepare_cached("INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)")
+            .await
+            .unwrap();
+        stmt.execute((format!("file-{:06}", i), parent_ino, ino))
+            .await
+            .unwrap();
+    }
+    conn.execute("COMMIT", ()).await.unwrap();
+}
+
+fn bench_resolve_path(c: &mut Criterion) {
+    let rt = Runtime::new().unwrap();
+    let (fs, _dir) = new_fs(&rt);
+    let depths = [1usize, 4, 16, 64];
+
+    // One directory chain per depth, each ending in a file
+    let paths: Vec<(usize, String)> = rt.block_on(async {
+        let mut paths = Vec::new();
+        for &depth in &depths {
+            let mut path = format!("/d{}", depth);
+            fs.mkdir(&path).await.unwrap();
+            for level in 1..depth {
+                path = format!("{}/l{}", path, level);
+                fs.mkdir(&path).await.unwrap();
+            }
+            let file = format!("{}/file", path);
+            fs.write_file(&file, b"x").await.unwrap();
+            paths.push((depth, file));
+        }
+        paths
+    });
+
+    let mut group = c.benchmark_group("resolve_path");
+    for (depth, path) in &paths {
+        group.bench_with_input(BenchmarkId::new("warm", depth), path, |b, path| {
+            rt.block_on(fs.lstat(path)).unwrap();
+            b.iter(|| rt.block_on(fs.lstat(path)).unwrap());
+        });
+        group.bench_with_input(BenchmarkId::new("cold", depth), path, |b, path| {
+            b.iter_batched(
+                || fs.clear_dentry_cache(),
+                |_| rt.block_on(fs.lstat(path)).unwrap(),
+                BatchSize::PerIteration,
+            );
+        });
+    }
+    group.finish();
+}
+
+fn bench_pread_pwrite(c: &mut Criterion) {
+    let rt = Runtime::new().unwrap();
+    let (fs, _dir) = new_fs(&rt);
+    let chunk = fs.chunk_size() as u64;
+    let file_size = 64 * chunk;
+
+    let file = rt.block_on(async {
+        fs.write_file("/data.bin", &vec![0xab; file_size as usize])
+            .await
+            .unwrap();
+        fs.open("/data.bin").await.unwrap()
+    });
+
+    // (name, offset, length): aligned within one chunk, straddling one
+    // boundary, and spanning many chunks with unaligned ends
+    let cases = [
+        ("aligned_4k", 8 * chunk, 4096),
+        ("straddle_4k", 9 * chunk - 2048, 4096),
+        ("straddle_chunk", 10 * chunk - chunk / 2, chunk),
+        ("span_16_chunks", 20 * chunk + 100, 16 * chunk),
+    ];
+
+    let mut group = c.benchmark_group("pread");
+    for &(name, offset, len) in &cases {
+        group.throughput(Throughput::Bytes(len));
+        group.bench_function(name, |b| {
+            b.iter(|| rt.block_on(file.pread(offset, len)).unwrap());
+        });
+    }
+    group.finish();
+
+    let mut group = c.benchmark_group("pwrite");
+    for &(name, offset, len) in &cases {
+        let data = vec![0xcd; len as usize];
+        group.throughput(Throughput::Bytes(len));
+        group.bench_function(name, |b| {
+            b.iter(|| rt.block_on(file.pwrite(offset, &data)).unwrap());
+        });
+    }
+    group.finish();
+}
+
+fn bench_readdir_plus(c: &mut Criterion) {
+    let rt = Runtime::new().unwrap();
+    let (fs, _dir) = new_fs(&rt);
+    let sizes = [10_000usize, 100_000];
+
+    rt.block_on(async {
+        for &count in &sizes {
+            populate_dir(&fs, &format!("/dir{}", count), count).await;
+        }
+    });
+
+    let mut group = c.benchmark_group("readdir_plus");
+    group.sample_size(10);
+    for &count in &sizes {
+        let path = format!("/dir{}", count);
+        group.throughput(Throughput::Elements(count as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(count), &path, |b, path| {
+            b.iter(|| {
+                let entries = rt.block_on(fs.readdir_plus(path)).unwrap().unwrap();
+                assert_eq!(entries.len(), count);
+            });
+        });
+    }
+    group.finish();
+}
+
+fn bench_parallel_stat(c: &mut Criterion) {
+    let rt = Runtime::new().unwrap();
+    let (fs, _dir) = new_fs(&rt);
+    let count = 1000;
+    rt.block_on(populate_dir(&fs, "/tree", count));
+    let paths: Vec<String> = (0..count).map(|i| format!("/tree/file-{:06}", i)).collect();
+
+    // Every task stats every file, so the work grows with the task count
+    // and flat times mean linear scaling
+    let mut group = c.benchmark_group("parallel_stat");
+    for tasks in [1usize, 4, 8] {
+        group.throughput(Throughput::Elements((tasks * count) as u64));
+        group.bench_with_input(BenchmarkId::from_parameter(tasks), &tasks, |b, &tasks| {
+            b.iter(|| {
+                rt.block_on(async {
+                    let handles: Vec<_> = (0..tasks)
+                        .map(|_| {
+                            let fs = fs.clone();
+                            let paths = paths.clone();
+                            tokio::spawn(async move {
+                                for path in &paths {
+                                    fs.lstat(path).await.unwrap().unwrap();
+                                }
+                            })
+                        })
+                        .collect();
+                    for handle in handles {
+                        handle.await.unwrap();
+                    }
+                })
+            });
+        });
+    }
+    group.finish();
+}
+
+fn bench_write_file(c: &mut Criterion) {
+    let rt = Runtime::new().unwrap();
+    let (fs, _dir) = new_fs(&rt);
+    let sizes = [4 * 1024usize, 64 * 1024, 1024 * 1024, 16 * 1024 * 1024];
+
+    let mut group = c.benchmark_group("write_file");
+    for &size in &sizes {
+        let data = vec![0x5a; size];
+        group.throughput(Throughput::Bytes(size as u64));
+        if size >= 1024 * 1024 {
+            group.sample_size(10);
+        }
+        group.bench_with_input(BenchmarkId::from_parameter(size), &data, |b, data| {
+            b.iter(|| rt.block_on(fs.write_file("/out.bin", data)).unwrap());
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    bench_resolve_path,
+    bench_pread_pwrite,
+    bench_readdir_plus,
+    bench_parallel_stat,
+    bench_write_file
+);
+criterion_main!(benches);
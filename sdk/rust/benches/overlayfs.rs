@@ -1,11 +1,17 @@
 //! Performance benchmarks for OverlayFS operations.
 //!
 //! Run with: cargo bench --bench overlayfs
+//!
+//! Save a baseline before a change and compare against it afterwards:
+//!
+//!     cargo bench --bench overlayfs -- --save-baseline main
+//!     cargo bench --bench overlayfs -- --baseline main
 
+use agentfs_sdk::filesystem::overlayfs::WhiteoutCache;
 use agentfs_sdk::filesystem::{AgentFS, FileSystem, HostFS, OverlayFS};
-use criterion::{criterion_group, criterion_main, Criterion};
+use criterion::{criterion_group, criterion_main, BatchSize, BenchmarkId, Criterion, Throughput};
 use std::sync::Arc;
-use tempfile::tempdir;
+use tempfile::{tempdir, TempDir};
 
 fn bench_remove_file(c: &mut Criterion) {
     let rt = tokio::runtime::Runtime::new().unwrap();
@@ -48,5 +54,90 @@ fn bench_remove_file(c: &mut Criterion) {
     });
 }
 
-criterion_group!(benches, bench_remove_file);
+/// Build a whiteout cache with `count` whiteouts spread over a three-level tree
+fn whiteout_cache(count: usize) -> WhiteoutCache {
+    let cache = WhiteoutCache::new();
+    for i in 0..count {
+        cache.insert(&format!("/w{}/d{}/f{}", i % 100, (i / 100) % 100, i));
+    }
+    cache
+}
+
+fn bench_has_whiteout_ancestor(c: &mut Criterion) {
+    let mut group = c.benchmark_group("has_whiteout_ancestor");
+    for count in [1_000usize, 100_000, 1_000_000] {
+        let cache = whiteout_cache(count);
+        // Whited-out parent, deep path below it
+        let hit = "/w1/d0/f1/a/b/c/d/e";
+        // Shares the first two components with whiteouts, then misses
+        let miss = "/w1/d0/missing/a/b/c/d/e";
+        // No common prefix at all
+        let unrelated = "/src/lib/module/a/b/c/d/e";
+
+        group.bench_with_input(BenchmarkId::new("hit", count), &hit, |b, path| {
+            b.iter(|| assert!(cache.has_whiteout_ancestor(path)));
+        });
+        group.bench_with_input(BenchmarkId::new("miss", count), &miss, |b, path| {
+            b.iter(|| assert!(!cache.has_whiteout_ancestor(path)));
+        });
+        group.bench_with_input(
+            BenchmarkId::new("unrelated", count),
+            &unrelated,
+            |b, path| {
+                b.iter(|| assert!(!cache.has_whiteout_ancestor(path)));
+            },
+        );
+    }
+    group.finish();
+}
+
+/// Create an overlay whose base layer holds `/big.bin` of `size` bytes
+async fn overlay_with_file(size: usize) -> (OverlayFS, TempDir, TempDir) {
+    let base_dir = tempdir().expect("Failed to create base temp dir");
+    let delta_dir = tempdir().expect("Failed to create delta temp dir");
+    std::fs::write(base_dir.path().join("big.bin"), vec![0x42; size])
+        .expect("Failed to write file");
+
+    let base = Arc::new(HostFS::new(base_dir.path()).expect("Failed to create HostFS"));
+    let db_path = delta_dir.path().join("delta.db");
+    let delta = AgentFS::new(db_path.to_str().unwrap())
+        .await
+        .expect("Failed to create AgentFS");
+
+    let overlay = OverlayFS::new(base, delta);
+    overlay
+        .init(base_dir.path().to_str().unwrap())
+        .await
+        .expect("Failed to init overlay");
+
+    (overlay, base_dir, delta_dir)
+}
+
+fn bench_copy_up(c: &mut Criterion) {
+    let rt = tokio::runtime::Runtime::new().unwrap();
+
+    let mut group = c.benchmark_group("copy_up");
+    group.sample_size(10);
+    for size in [1usize << 20, 16 << 20, 64 << 20] {
+        group.throughput(Throughput::Bytes(size as u64));
+        group.bench_function(BenchmarkId::from_parameter(size), |b| {
+            b.iter_batched(
+                || rt.block_on(overlay_with_file(size)),
+                |(overlay, _base_dir, _delta_dir)| {
+                    // chmod on a base file copies its contents into the delta
+                    rt.block_on(overlay.chmod("/big.bin", 0o600)).unwrap();
+                },
+                BatchSize::PerIteration,
+            );
+        });
+    }
+    group.finish();
+}
+
+criterion_group!(
+    benches,
+    bench_remove_file,
+    bench_has_whiteout_ancestor,
+    bench_copy_up
+);
 criterion_main!(benches);
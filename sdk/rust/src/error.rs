@@ -45,6 +45,14 @@ pub enum Error {
     #[error("path is not a directory: {0}")]
     NotADirectory(String),
 
+    /// Parent database of a fork does not exist
+    #[error("parent database does not exist: {0}")]
+    ParentNotFound(String),
+
+    /// Fork that can't be set up or opened
+    #[error("invalid fork: {0}")]
+    InvalidFork(String),
+
     /// Tool call not found
     #[error("tool call not found")]
     ToolCallNotFound,
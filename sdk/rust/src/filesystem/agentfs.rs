@@ -1,1055 +1,2974 @@
 use crate::error::{Error, Result};
+use crate::metrics::{self, Cache, Layer, Op};
 use async_trait::async_trait;
-use lru::LruCache;
-use std::num::NonZeroUsize;
+use std::collections::{BTreeMap, HashMap};
+use std::ops::Range;
 use std::path::Path;
+use std::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
 use std::sync::{Arc, Mutex};
-use std::time::{SystemTime, UNIX_EPOCH};
-use turso::{Builder, Connection, Value};
+use std::time::{Duration, SystemTime, UNIX_EPOCH};
+use turso::{Builder, Connection, Database, Value};
 
+use super::cache::ClockCache;
+use super::chunks::ChunkStore;
+use super::group_commit::GroupCommit;
 use super::{
-    BoxedFile, DirEntry, File, FileSystem, FilesystemStats, FsError, Stats, DEFAULT_DIR_MODE,
-    DEFAULT_FILE_MODE, S_IFLNK, S_IFMT, S_IFREG,
+    BoxedDirStream, BoxedFile, Compression, DirEntry, DirStream, File, FileSystem, FilesystemStats,
+    FsError, Stats, DEFAULT_DIR_MODE, DEFAULT_FILE_MODE, ROOT_INO, S_IFLNK, S_IFMT, S_IFREG,
 };
 
-const ROOT_INO: i64 = 1;
-const DEFAULT_CHUNK_SIZE: usize = 4096;
+pub(crate) const DEFAULT_CHUNK_SIZE: usize = 4096;
+/// Largest row new filesystems store file contents in (256 default chunks).
+const DEFAULT_EXTENT_SIZE: usize = 1024 * 1024;
 const DENTRY_CACHE_MAX_SIZE: usize = 10000;
-
-/// LRU cache for directory entry lookups.
+/// Names remembered as missing, kept apart from the entries that exist.
+const NEGATIVE_DENTRY_CACHE_MAX_SIZE: usize = 10000;
+const ATTR_CACHE_MAX_SIZE: usize = 10000;
+/// Number of chunks moved per read when streaming a file in (1 MiB at the default chunk size).
+const COPY_BATCH_CHUNKS: u64 = 256;
+/// First read-ahead window of a handle that reads sequentially.
+const READAHEAD_MIN_BYTES: u64 = 256 * 1024;
+/// Largest read-ahead window, and so the most prefetched data a handle holds.
+const READAHEAD_MAX_BYTES: u64 = 4 * 1024 * 1024;
+/// Back-to-back reads after which a handle counts as sequential.
+const READAHEAD_TRIGGER: u32 = 2;
+/// Per-inode version counters kept by the attribute cache; inodes share a
+/// counter when their numbers are equal modulo this.
+const INODE_VERSION_STRIPES: usize = 256;
+/// Default number of read-only connections opened alongside the writer.
+pub const DEFAULT_READER_CONNECTIONS: usize = 4;
+/// Suggested cap on buffered writes per open inode, for callers that enable
+/// write buffering with [`AgentFS::set_write_buffer_limit`].
+pub const DEFAULT_WRITE_BUFFER_BYTES: usize = 1024 * 1024;
+
+/// Concurrent cache for directory entry lookups.
 ///
 /// Maps (parent_ino, name) -> child_ino to avoid repeated database queries
 /// during path resolution. For a path like `/a/b/c/d`, this reduces queries
-/// from 4 to potentially 0 on cache hits.
+/// from 4 to potentially 0 on cache hits. Entries live in a sharded
+/// `ClockCache`, so parallel lookups share locks instead of queueing on one.
+///
+/// Names that don't exist are remembered in a separate cache, so the failed
+/// lookups of `PATH`, import and include searches are answered without a
+/// query and can't evict entries that exist.
 struct DentryCache {
-    // Mutex required because LruCache::get() mutates internal order
-    entries: Mutex<LruCache<(i64, String), i64>>,
+    entries: ClockCache<(i64, String), i64>,
+    missing: ClockCache<(i64, String), ()>,
+    /// Bumped whenever a name is created, so a lookup that raced with the
+    /// creation doesn't record a stale miss
+    generation: AtomicU64,
+    /// Whether misses may be recorded; only when reads come from dedicated
+    /// reader connections, which never see uncommitted transactions
+    cache_misses: bool,
 }
 
 impl DentryCache {
-    fn new(max_size: usize) -> Self {
+    fn new(max_size: usize, cache_misses: bool) -> Self {
         Self {
-            entries: Mutex::new(LruCache::new(
-                NonZeroUsize::new(max_size).expect("cache size must be > 0"),
-            )),
+            entries: ClockCache::new(max_size),
+            missing: ClockCache::new(NEGATIVE_DENTRY_CACHE_MAX_SIZE),
+            generation: AtomicU64::new(0),
+            cache_misses,
+        }
+    }
+
+    /// Whether the name is known not to exist
+    fn is_missing(&self, parent_ino: i64, name: &str) -> bool {
+        let missing = self.missing.contains(&(parent_ino, name.to_string()));
+        metrics::cache_lookup(Cache::NegativeDentry, missing);
+        missing
+    }
+
+    /// Current generation; pass it to `insert_missing` after a failed lookup
+    fn generation(&self) -> u64 {
+        self.generation.load(Ordering::SeqCst)
+    }
+
+    /// Remember that a lookup started at `generation` found nothing
+    fn insert_missing(&self, parent_ino: i64, name: &str, generation: u64) {
+        if !self.cache_misses || self.generation() != generation {
+            return;
+        }
+        let key = (parent_ino, name.to_string());
+        self.missing.insert(key.clone(), ());
+        // A creation that got in after the first check may already have
+        // forgotten the name, so check again now that it's recorded
+        if self.generation() != generation {
+            self.missing.remove(&key);
         }
     }
 
-    /// Look up a cached entry (updates LRU order)
+    /// Forget that a name was missing, once it has been created
+    fn forget_missing(&self, parent_ino: i64, name: &str) {
+        self.generation.fetch_add(1, Ordering::SeqCst);
+        self.missing.remove(&(parent_ino, name.to_string()));
+    }
+
+    /// Look up a cached entry
     fn get(&self, parent_ino: i64, name: &str) -> Option<i64> {
-        self.entries
-            .lock()
-            .unwrap()
-            .get(&(parent_ino, name.to_string()))
-            .copied()
+        let ino = self.entries.get(&(parent_ino, name.to_string()));
+        metrics::cache_lookup(Cache::Dentry, ino.is_some());
+        ino
     }
 
-    /// Insert an entry into the cache (evicts LRU entry if full)
+    /// Insert a newly created entry (evicts an entry if full)
     fn insert(&self, parent_ino: i64, name: &str, child_ino: i64) {
+        self.forget_missing(parent_ino, name);
+        self.fill(parent_ino, name, child_ino);
+    }
+
+    /// Insert an entry read from the database
+    fn fill(&self, parent_ino: i64, name: &str, child_ino: i64) {
         self.entries
-            .lock()
-            .unwrap()
-            .put((parent_ino, name.to_string()), child_ino);
+            .insert((parent_ino, name.to_string()), child_ino);
     }
 
     /// Remove an entry from the cache
     fn remove(&self, parent_ino: i64, name: &str) {
-        self.entries
-            .lock()
-            .unwrap()
-            .pop(&(parent_ino, name.to_string()));
+        self.entries.remove(&(parent_ino, name.to_string()));
     }
-}
 
-/// A filesystem backed by SQLite
-#[derive(Clone)]
-pub struct AgentFS {
-    conn: Arc<Connection>,
-    chunk_size: usize,
-    /// Cache for directory entry lookups (shared across clones)
-    dentry_cache: Arc<DentryCache>,
+    /// Remove all entries from the cache
+    fn clear(&self) {
+        self.entries.clear();
+        self.generation.fetch_add(1, Ordering::SeqCst);
+        self.missing.clear();
+    }
 }
 
-/// An open file handle for AgentFS.
+/// Concurrent cache of inode attributes as stored in `fs_inode`.
 ///
-/// This struct holds the inode number resolved at open time, allowing
-/// efficient read/write/fsync operations without path lookups.
-pub struct AgentFSFile {
-    conn: Arc<Connection>,
-    ino: i64,
-    chunk_size: usize,
+/// Filled by stat calls and directory listings, so `lstat` after
+/// `readdir_plus` and repeated `getattr` calls cost no inode query. Buffered
+/// writes are applied on top of cached attributes like on top of stored
+/// ones. Mutations invalidate the inodes they change once committed.
+///
+/// Only enabled with dedicated reader connections, which never see
+/// uncommitted transactions. Every invalidation bumps a generation, so a
+/// read that raced with a mutation doesn't cache what it saw, and a version
+/// of the inode, which says whether data read from it is still current.
+struct AttrCache {
+    entries: ClockCache<i64, Stats>,
+    generation: AtomicU64,
+    /// Bumped by invalidations of the inodes mapping to each stripe
+    versions: Box<[AtomicU64]>,
+    enabled: bool,
 }
 
-#[async_trait]
-impl File for AgentFSFile {
-    async fn pread(&self, offset: u64, size: u64) -> Result<Vec<u8>> {
-        let chunk_size = self.chunk_size as u64;
-        let start_chunk = offset / chunk_size;
-        let end_chunk = (offset + size).saturating_sub(1) / chunk_size;
-
-        let mut stmt = self
-            .conn
-            .prepare_cached("SELECT chunk_index, data FROM fs_data WHERE ino = ? AND chunk_index >= ? AND chunk_index <= ? ORDER BY chunk_index")
-            .await?;
-        let mut rows = stmt
-            .query((self.ino, start_chunk as i64, end_chunk as i64))
-            .await?;
+impl AttrCache {
+    fn new(max_size: usize, enabled: bool) -> Self {
+        Self {
+            entries: ClockCache::new(max_size),
+            generation: AtomicU64::new(0),
+            versions: (0..INODE_VERSION_STRIPES)
+                .map(|_| AtomicU64::new(0))
+                .collect(),
+            enabled,
+        }
+    }
 
-        let mut result = Vec::with_capacity(size as usize);
-        let start_offset_in_chunk = (offset % chunk_size) as usize;
-        let mut next_expected_chunk = start_chunk;
+    fn stripe(&self, ino: i64) -> &AtomicU64 {
+        &self.versions[ino.rem_euclid(INODE_VERSION_STRIPES as i64) as usize]
+    }
 
-        while let Some(row) = rows.next().await? {
-            let chunk_index = row
-                .get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u64;
+    /// Current version of an inode. Changes whenever the inode is
+    /// invalidated, but not when other inodes are, except the few that
+    /// share its counter.
+    fn version(&self, ino: i64) -> u64 {
+        self.stripe(ino).load(Ordering::SeqCst)
+    }
 
-            // Fill gaps with zeros for sparse files
-            while next_expected_chunk < chunk_index && result.len() < size as usize {
-                let skip = if next_expected_chunk == start_chunk {
-                    start_offset_in_chunk
-                } else {
-                    0
-                };
-                let zeros_needed =
-                    std::cmp::min(chunk_size as usize - skip, size as usize - result.len());
-                result.extend(std::iter::repeat_n(0u8, zeros_needed));
-                next_expected_chunk += 1;
-            }
+    /// Current generation; pass it to `insert` along with what was read
+    fn generation(&self) -> u64 {
+        self.generation.load(Ordering::SeqCst)
+    }
 
-            if let Ok(Value::Blob(chunk_data)) = row.get_value(1) {
-                let skip = if chunk_index == start_chunk {
-                    start_offset_in_chunk
-                } else {
-                    0
-                };
-                if skip >= chunk_data.len() {
-                    // Chunk is smaller than skip offset, fill with zeros
-                    let zeros_needed =
-                        std::cmp::min(chunk_size as usize - skip, size as usize - result.len());
-                    result.extend(std::iter::repeat_n(0u8, zeros_needed));
-                } else {
-                    let remaining = size as usize - result.len();
-                    let take = std::cmp::min(chunk_data.len() - skip, remaining);
-                    result.extend_from_slice(&chunk_data[skip..skip + take]);
-
-                    // If chunk is smaller than chunk_size, pad with zeros
-                    let chunk_end = skip + take;
-                    if chunk_end < chunk_size as usize && result.len() < size as usize {
-                        let zeros_needed = std::cmp::min(
-                            chunk_size as usize - chunk_end,
-                            size as usize - result.len(),
-                        );
-                        result.extend(std::iter::repeat_n(0u8, zeros_needed));
-                    }
-                }
-            }
-            next_expected_chunk = chunk_index + 1;
+    /// Cache attributes read by a query started at `generation`
+    fn insert(&self, stats: &Stats, generation: u64) {
+        if !self.enabled || self.generation() != generation {
+            return;
         }
-
-        // Fill any remaining space with zeros (for sparse file tail or missing chunks at end)
-        if result.len() < size as usize {
-            result.resize(size as usize, 0);
+        self.entries.insert(stats.ino, stats.clone());
+        // Same double check as `DentryCache::insert_missing`
+        if self.generation() != generation {
+            self.entries.remove(&stats.ino);
         }
+    }
 
-        Ok(result)
+    /// Drop the cached attributes of an inode after it changed
+    fn invalidate(&self, ino: i64) {
+        self.generation.fetch_add(1, Ordering::SeqCst);
+        self.stripe(ino).fetch_add(1, Ordering::SeqCst);
+        self.entries.remove(&ino);
     }
 
-    async fn pwrite(&self, offset: u64, data: &[u8]) -> Result<()> {
-        if data.is_empty() {
-            return Ok(());
-        }
+    /// Invalidate `ino` when the returned guard is dropped, for mutations
+    /// made of several autocommitted statements that may fail halfway
+    fn invalidate_on_drop(&self, ino: i64) -> AttrInvalidation<'_> {
+        AttrInvalidation { cache: self, ino }
+    }
 
-        // Get current file size
-        let mut stmt = self
-            .conn
-            .prepare_cached("SELECT size FROM fs_inode WHERE ino = ?")
+    /// Fetch the stored attributes of an inode, from the cache if possible
+    async fn fetch(&self, conn: &Connection, ino: i64) -> Result<Option<Stats>> {
+        if let Some(stats) = self.entries.get(&ino) {
+            metrics::cache_lookup(Cache::Attr, true);
+            return Ok(Some(stats));
+        }
+        metrics::cache_lookup(Cache::Attr, false);
+        let generation = self.generation();
+        let mut stmt = conn
+            .prepare_cached("SELECT ino, mode, nlink, uid, gid, size, atime, mtime, ctime FROM fs_inode WHERE ino = ?")
             .await?;
-        let mut rows = stmt.query((self.ino,)).await?;
-        let current_size = if let Some(row) = rows.next().await? {
-            row.get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u64
-        } else {
-            0
+        let mut rows = stmt.query((ino,)).await?;
+        let Some(row) = rows.next().await? else {
+            return Ok(None);
         };
+        let stats = AgentFS::build_stats_from_row(&row)?;
+        self.insert(&stats, generation);
+        Ok(Some(stats))
+    }
 
-        // If writing beyond current size, extend with zeros first
-        if offset > current_size {
-            let zeros = vec![0u8; (offset - current_size) as usize];
-            self.write_data_at_offset(current_size, &zeros).await?;
+    fn clear(&self) {
+        self.generation.fetch_add(1, Ordering::SeqCst);
+        for version in self.versions.iter() {
+            version.fetch_add(1, Ordering::SeqCst);
         }
+        self.entries.clear();
+    }
+}
 
-        // Write the actual data
-        self.write_data_at_offset(offset, data).await?;
+/// Invalidates an inode's cached attributes when dropped
+struct AttrInvalidation<'a> {
+    cache: &'a AttrCache,
+    ino: i64,
+}
 
-        // Update file size and mtime
-        let new_size = std::cmp::max(current_size, offset + data.len() as u64);
-        let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
-        let mut stmt = self
-            .conn
-            .prepare_cached("UPDATE fs_inode SET size = ?, mtime = ? WHERE ino = ?")
-            .await?;
-        stmt.execute((new_size as i64, now, self.ino)).await?;
+impl Drop for AttrInvalidation<'_> {
+    fn drop(&mut self) {
+        self.cache.invalidate(self.ino);
+    }
+}
 
-        Ok(())
+/// Round-robin pool of connections used for read-only queries.
+///
+/// Writes and transactions always go through the writer connection, so a
+/// long `BEGIN IMMEDIATE` no longer stalls lookups and reads. Each reader
+/// query runs in its own implicit read transaction and sees the last
+/// committed snapshot. When no dedicated readers are configured the pool
+/// holds the writer itself.
+struct ReaderPool {
+    conns: Vec<Arc<Connection>>,
+    next: AtomicUsize,
+}
+
+impl ReaderPool {
+    fn new(conns: Vec<Arc<Connection>>) -> Self {
+        assert!(!conns.is_empty(), "reader pool must not be empty");
+        Self {
+            conns,
+            next: AtomicUsize::new(0),
+        }
     }
 
-    async fn truncate(&self, new_size: u64) -> Result<()> {
-        // Get current size
-        let mut stmt = self
-            .conn
-            .prepare_cached("SELECT size FROM fs_inode WHERE ino = ?")
-            .await?;
-        let mut rows = stmt.query((self.ino,)).await?;
-        let current_size = if let Some(row) = rows.next().await? {
-            row.get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u64
-        } else {
-            0
-        };
+    /// Pick the next reader connection
+    fn get(&self) -> &Connection {
+        let idx = self.next.fetch_add(1, Ordering::Relaxed) % self.conns.len();
+        &self.conns[idx]
+    }
+}
 
-        let chunk_size = self.chunk_size as u64;
+/// Serializes changes made through the writer connection.
+///
+/// A connection has a single transaction: a second `BEGIN` fails while one
+/// is open, and statements run meanwhile become part of it and are rolled
+/// back with it. Every change made through the writer connection, whether
+/// a whole transaction or autocommit statements, holds this lock, so
+/// concurrent callers don't need to serialize themselves.
+///
+/// A filesystem opened read-only has no writer, and taking the lock fails
+/// with `FsError::ReadOnly`.
+#[derive(Clone)]
+pub(crate) struct WriterLock(Option<Arc<tokio::sync::Mutex<()>>>);
 
-        self.conn
-            .prepare_cached("BEGIN IMMEDIATE")
-            .await?
-            .execute(())
-            .await?;
+impl Default for WriterLock {
+    fn default() -> Self {
+        Self(Some(Arc::default()))
+    }
+}
 
-        let result: Result<()> = async {
-            if new_size == 0 {
-                // Special case: truncate to zero - just delete all chunks
-                let mut stmt = self
-                    .conn
-                    .prepare_cached("DELETE FROM fs_data WHERE ino = ?")
-                    .await?;
-                stmt.execute((self.ino,)).await?;
-            } else if new_size < current_size {
-                // Shrinking: delete excess chunks and truncate last chunk if needed
-                let last_chunk_idx = (new_size - 1) / chunk_size;
+impl WriterLock {
+    fn read_only() -> Self {
+        Self(None)
+    }
 
-                // Delete all chunks beyond the last one we need
-                self.conn
-                    .execute(
-                        "DELETE FROM fs_data WHERE ino = ? AND chunk_index > ?",
-                        (self.ino, last_chunk_idx as i64),
-                    )
-                    .await?;
+    pub(crate) async fn lock(&self) -> Result<tokio::sync::MutexGuard<'_, ()>> {
+        match &self.0 {
+            Some(lock) => Ok(lock.lock().await),
+            None => Err(FsError::ReadOnly.into()),
+        }
+    }
+}
 
-                // Truncate the last chunk if needed
-                let offset_in_chunk = (new_size % chunk_size) as usize;
-                if offset_in_chunk > 0 {
-                    let mut stmt = self
-                        .conn
-                        .prepare_cached("SELECT data FROM fs_data WHERE ino = ? AND chunk_index = ?")
-                        .await?;
-                    let mut rows = stmt.query((self.ino, last_chunk_idx as i64)).await?;
+/// Writes buffered for one inode that haven't reached the database yet.
+#[derive(Default)]
+struct DirtyChunks {
+    /// Chunk index -> full chunk contents, replacing the stored chunk on flush
+    chunks: BTreeMap<u64, Vec<u8>>,
+    /// File size including buffered writes, `None` while nothing is buffered
+    size: Option<u64>,
+    /// Modification time of the last buffered write
+    mtime: i64,
+    /// Total length of the buffered chunks
+    bytes: usize,
+}
 
-                    if let Some(row) = rows.next().await? {
-                        if let Ok(Value::Blob(mut chunk_data)) = row.get_value(0) {
-                            if chunk_data.len() > offset_in_chunk {
-                                chunk_data.truncate(offset_in_chunk);
-                                let mut stmt = self
-                                    .conn
-                                    .prepare_cached("UPDATE fs_data SET data = ? WHERE ino = ? AND chunk_index = ?")
-                                    .await?;
-                                stmt.execute((Value::Blob(chunk_data), self.ino, last_chunk_idx as i64)).await?;
-                            }
-                        }
-                    }
-                }
-            }
-            // For extending (new_size > current_size), we just update the size
-            // The sparse regions will be handled by pread returning zeros
+impl DirtyChunks {
+    fn is_clean(&self) -> bool {
+        self.size.is_none()
+    }
+}
 
-            // Update the inode size and mtime
-            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
-            let mut stmt = self
-                .conn
-                .prepare_cached("UPDATE fs_inode SET size = ?, mtime = ? WHERE ino = ?")
-                .await?;
-            stmt.execute((new_size as i64, now, self.ino)).await?;
+/// A write buffer, shared by every open handle of an inode.
+///
+/// The lock is held across database calls: a handle reads, writes or
+/// flushes with the buffer locked so it never sees a half-flushed state.
+type WriteBuffer = tokio::sync::Mutex<DirtyChunks>;
 
-            Ok(())
-        }
-        .await;
+/// Write buffers of the inodes with open file handles.
+///
+/// An unaligned write usually touches a chunk that the previous write
+/// touched as well. Buffering whole chunks in memory turns a stream of small
+/// writes into one read of each chunk and one transaction per flush, instead
+/// of a read-modify-write of the chunk and an inode update per call.
+///
+/// Buffers are kept per inode rather than per handle so that all handles of
+/// a file see each other's writes. Dropping the last handle of a file writes
+/// its buffer back in the background, and the buffer stays until it has
+/// been written, so dropping a handle never discards data.
+struct WriteBuffers {
+    /// Cap on the buffered bytes per inode; 0 disables buffering
+    limit: AtomicUsize,
+    buffers: Mutex<HashMap<i64, AttachedBuffer>>,
+}
 
-        if result.is_err() {
-            let _ = self
-                .conn
-                .prepare_cached("ROLLBACK")
-                .await?
-                .execute(())
-                .await;
-            return result;
+/// A write buffer and the number of open handles using it
+struct AttachedBuffer {
+    handles: usize,
+    buffer: Arc<WriteBuffer>,
+}
+
+impl WriteBuffers {
+    fn new() -> Self {
+        Self {
+            limit: AtomicUsize::new(0),
+            buffers: Mutex::new(HashMap::new()),
         }
+    }
 
-        self.conn
-            .prepare_cached("COMMIT")
-            .await?
-            .execute(())
-            .await?;
-        Ok(())
+    fn limit(&self) -> usize {
+        self.limit.load(Ordering::Relaxed)
     }
 
-    async fn fsync(&self) -> Result<()> {
-        self.conn
-            .prepare_cached("PRAGMA synchronous = FULL")
-            .await?
-            .execute(())
-            .await?;
-        self.conn.prepare_cached("BEGIN").await?.execute(()).await?;
-        self.conn
-            .prepare_cached("COMMIT")
-            .await?
-            .execute(())
-            .await?;
-        self.conn
-            .prepare_cached("PRAGMA synchronous = OFF")
-            .await?
-            .execute(())
-            .await?;
-        Ok(())
+    /// Get the buffer for a handle being opened, or `None` when disabled
+    fn attach(&self, ino: i64) -> Option<Arc<WriteBuffer>> {
+        if self.limit() == 0 {
+            return None;
+        }
+        let mut buffers = self.buffers.lock().unwrap();
+        let attached = buffers.entry(ino).or_insert_with(|| AttachedBuffer {
+            handles: 0,
+            buffer: Arc::default(),
+        });
+        attached.handles += 1;
+        Some(attached.buffer.clone())
     }
 
-    async fn fstat(&self) -> Result<Stats> {
-        let mut stmt = self
-            .conn
-            .prepare_cached("SELECT ino, mode, nlink, uid, gid, size, atime, mtime, ctime FROM fs_inode WHERE ino = ?")
-            .await?;
-        let mut rows = stmt.query((self.ino,)).await?;
+    /// Get the buffer of an inode, if it has open handles or unflushed data
+    fn get(&self, ino: i64) -> Option<Arc<WriteBuffer>> {
+        let buffers = self.buffers.lock().unwrap();
+        buffers.get(&ino).map(|attached| attached.buffer.clone())
+    }
 
-        if let Some(row) = rows.next().await? {
-            AgentFS::build_stats_from_row(&row)
-        } else {
-            Err(FsError::NotFound.into())
+    /// Release a handle's reference. Returns true if it was the last handle
+    /// and the buffer still holds writes, which the caller must write back.
+    fn detach(&self, ino: i64, buffer: &Arc<WriteBuffer>) -> bool {
+        let mut buffers = self.buffers.lock().unwrap();
+        let Some(attached) = buffers.get_mut(&ino) else {
+            return false;
+        };
+        if !Arc::ptr_eq(&attached.buffer, buffer) {
+            return false;
         }
+        attached.handles -= 1;
+        if attached.handles > 0 {
+            return false;
+        }
+        if buffer.try_lock().is_ok_and(|dirty| dirty.is_clean()) {
+            buffers.remove(&ino);
+            return false;
+        }
+        true
     }
-}
 
-impl AgentFSFile {
-    /// Write data at a specific offset, handling chunk boundaries.
-    async fn write_data_at_offset(&self, offset: u64, data: &[u8]) -> Result<()> {
-        let chunk_size = self.chunk_size as u64;
-        let mut written = 0usize;
+    /// Drop a written-back buffer unless a handle attached to it meanwhile
+    fn release(&self, ino: i64, buffer: &Arc<WriteBuffer>) {
+        let mut buffers = self.buffers.lock().unwrap();
+        let unused = buffers
+            .get(&ino)
+            .is_some_and(|attached| attached.handles == 0 && Arc::ptr_eq(&attached.buffer, buffer));
+        if unused && buffer.try_lock().is_ok_and(|dirty| dirty.is_clean()) {
+            buffers.remove(&ino);
+        }
+    }
 
-        while written < data.len() {
-            let current_offset = offset + written as u64;
-            let chunk_index = (current_offset / chunk_size) as i64;
-            let offset_in_chunk = (current_offset % chunk_size) as usize;
+    /// Report the size and mtime of writes buffered for `stats.ino`
+    async fn apply(&self, stats: &mut Stats) {
+        if let Some(buffer) = self.get(stats.ino) {
+            apply_dirty(&*buffer.lock().await, stats);
+        }
+    }
 
-            // How much can we write in this chunk?
-            let remaining_in_chunk = self.chunk_size - offset_in_chunk;
-            let remaining_data = data.len() - written;
-            let to_write = std::cmp::min(remaining_in_chunk, remaining_data);
+    fn is_empty(&self) -> bool {
+        self.buffers.lock().unwrap().is_empty()
+    }
 
-            // Get existing chunk data (if any)
-            let mut stmt = self
-                .conn
-                .prepare_cached("SELECT data FROM fs_data WHERE ino = ? AND chunk_index = ?")
-                .await?;
-            let mut rows = stmt.query((self.ino, chunk_index)).await?;
+    /// Forget the buffer of a deleted inode
+    fn discard(&self, ino: i64) {
+        self.buffers.lock().unwrap().remove(&ino);
+    }
+}
 
-            let mut chunk_data = if let Some(row) = rows.next().await? {
-                row.get_value(0)
-                    .ok()
-                    .and_then(|v| {
-                        if let Value::Blob(b) = v {
-                            Some(b.clone())
-                        } else {
-                            None
-                        }
-                    })
-                    .unwrap_or_default()
-            } else {
-                Vec::new()
-            };
+/// A filesystem backed by SQLite
+#[derive(Clone)]
+pub struct AgentFS {
+    /// Writer connection, used for all mutations and transactions
+    conn: Arc<Connection>,
+    /// Held while changing the database through `conn` (shared across clones)
+    writer: WriterLock,
+    /// Read-only connections (shared across clones)
+    readers: Arc<ReaderPool>,
+    chunk_size: usize,
+    /// Layout of file contents in the database
+    chunks: ChunkStore,
+    /// Cache for directory entry lookups (shared across clones)
+    dentry_cache: Arc<DentryCache>,
+    /// Cache for inode attributes (shared across clones)
+    attr_cache: Arc<AttrCache>,
+    /// Buffered writes of open files (shared across clones)
+    write_buffers: Arc<WriteBuffers>,
+    /// Batches fsync requests into shared durable commits
+    group_commit: Arc<GroupCommit>,
+}
 
-            // Extend chunk if needed
-            if chunk_data.len() < offset_in_chunk + to_write {
-                chunk_data.resize(offset_in_chunk + to_write, 0);
-            }
+/// Directory stream for AgentFS.
+///
+/// Pages through `fs_dentry` with keyset queries on `(parent_ino, name)`:
+/// each batch starts after the last name returned, so it costs an index
+/// seek instead of rescanning the entries already handed out.
+struct AgentFSDirStream {
+    readers: Arc<ReaderPool>,
+    dentry_cache: Arc<DentryCache>,
+    attr_cache: Arc<AttrCache>,
+    write_buffers: Arc<WriteBuffers>,
+    ino: i64,
+    /// Name of the last entry returned, empty before the first batch
+    after: String,
+    done: bool,
+}
 
-            // Write data into chunk
-            chunk_data[offset_in_chunk..offset_in_chunk + to_write]
-                .copy_from_slice(&data[written..written + to_write]);
+#[async_trait]
+impl DirStream for AgentFSDirStream {
+    async fn next_batch(&mut self, limit: usize) -> Result<Vec<DirEntry>> {
+        if self.done || limit == 0 {
+            return Ok(Vec::new());
+        }
 
-            // Save chunk
-            let mut stmt = self
-                .conn
-                .prepare_cached(
-                    "INSERT OR REPLACE INTO fs_data (ino, chunk_index, data) VALUES (?, ?, ?)",
-                )
-                .await?;
-            stmt.execute((self.ino, chunk_index, Value::Blob(chunk_data)))
-                .await?;
+        let generation = self.attr_cache.generation();
+        let conn = self.readers.get();
+        let mut stmt = conn
+            .prepare_cached(
+                "SELECT d.name, i.ino, i.mode, i.nlink, i.uid, i.gid, i.size, i.atime, i.mtime, i.ctime
+                 FROM fs_dentry d
+                 JOIN fs_inode i ON d.ino = i.ino
+                 WHERE d.parent_ino = ? AND d.name > ?
+                 ORDER BY d.name
+                 LIMIT ?",
+            )
+            .await?;
+        let mut rows = stmt
+            .query((self.ino, self.after.as_str(), limit as i64))
+            .await?;
 
-            written += to_write;
+        let mut entries = Vec::new();
+        let mut row_count = 0;
+        while let Some(row) = rows.next().await? {
+            row_count += 1;
+            if let Some(entry) = AgentFS::build_dir_entry_from_row(&row) {
+                entries.push(entry);
+            }
+        }
+        fill_caches(
+            &self.dentry_cache,
+            &self.attr_cache,
+            self.ino,
+            &entries,
+            generation,
+        );
+        for entry in &mut entries {
+            self.write_buffers.apply(&mut entry.stats).await;
         }
 
-        Ok(())
+        if row_count < limit {
+            self.done = true;
+        }
+        if let Some(last) = entries.last() {
+            self.after = last.name.clone();
+        }
+        Ok(entries)
     }
 }
 
-impl AgentFS {
-    /// Create a new filesystem
-    pub async fn new(db_path: &str) -> Result<Self> {
-        let db = Builder::new_local(db_path).build().await?;
-        let conn = Arc::new(db.connect()?);
-        Self::from_connection(conn).await
-    }
+/// An open file handle for AgentFS.
+///
+/// This struct holds the inode number resolved at open time, allowing
+/// efficient read/write/fsync operations without path lookups.
+///
+/// When write buffering is enabled, writes stay in memory until the handle
+/// is flushed, fsynced or truncated, or the buffer fills up. Reads, `fstat`
+/// and [`AgentFS::getattr`] see buffered writes; other path-based reads only
+/// see them once flushed.
+pub struct AgentFSFile {
+    conn: Arc<Connection>,
+    writer: WriterLock,
+    readers: Arc<ReaderPool>,
+    attr_cache: Arc<AttrCache>,
+    ino: i64,
+    chunk_size: usize,
+    chunks: ChunkStore,
+    buffers: Arc<WriteBuffers>,
+    /// This inode's write buffer, `None` when buffering is disabled
+    buffer: Option<Arc<WriteBuffer>>,
+    group_commit: Arc<GroupCommit>,
+    readahead: Mutex<Readahead>,
+}
 
-    /// Create a filesystem from an existing connection
-    pub async fn from_connection(conn: Arc<Connection>) -> Result<Self> {
-        // Initialize schema first
-        Self::initialize_schema(&conn).await?;
+/// Access pattern and prefetched data of one file handle.
+///
+/// Once a handle has read back-to-back ranges a few times, a read the
+/// prefetched data doesn't cover also fetches a window past the request,
+/// which doubles on each refill up to `READAHEAD_MAX_BYTES`. The window
+/// holds stored data only, so buffered writes still apply on top. It is
+/// tagged with the inode's version in the attribute cache, which every
+/// committed change to the inode bumps, and ignored once that changes.
+/// Changes to other files leave it alone.
+#[derive(Default)]
+struct Readahead {
+    /// Offset where the last read ended
+    next: u64,
+    /// Back-to-back reads so far
+    streak: u32,
+    /// Size of the next window
+    window: u64,
+    prefetched: Option<Prefetched>,
+}
 
-        // Disable synchronous mode for filesystem fsync() semantics.
-        conn.execute("PRAGMA synchronous = OFF", ()).await?;
+struct Prefetched {
+    offset: u64,
+    data: Vec<u8>,
+    /// Version of the inode before the data was read
+    version: u64,
+}
 
-        // Set busy timeout to handle concurrent access gracefully.
-        // Without this, concurrent transactions fail immediately with SQLITE_BUSY.
-        conn.execute("PRAGMA busy_timeout = 5000", ()).await?;
+impl Readahead {
+    /// Serve a read from the prefetched data, if it is current and covers it
+    fn take(&mut self, offset: u64, size: u64, version: u64) -> Option<Vec<u8>> {
+        let prefetched = self.prefetched.as_ref()?;
+        let end = offset + size;
+        let prefetched_end = prefetched.offset + prefetched.data.len() as u64;
+        if prefetched.version != version || offset < prefetched.offset || end > prefetched_end {
+            metrics::cache_lookup(Cache::Readahead, false);
+            return None;
+        }
+        metrics::cache_lookup(Cache::Readahead, true);
+        let from = (offset - prefetched.offset) as usize;
+        let data = prefetched.data[from..from + size as usize].to_vec();
+        if end == prefetched_end {
+            self.prefetched = None;
+        }
+        self.next = end;
+        Some(data)
+    }
 
-        // Get chunk_size from config (or use default)
-        let chunk_size = Self::read_chunk_size(&conn).await?;
+    /// Record a read that has to go to the database, and return how many
+    /// bytes from `offset` on it should fetch
+    fn plan(&mut self, offset: u64, size: u64) -> u64 {
+        if offset == self.next {
+            self.streak = self.streak.saturating_add(1);
+        } else {
+            self.streak = 0;
+            self.window = 0;
+        }
+        self.next = offset + size;
+        if self.streak < READAHEAD_TRIGGER {
+            return size;
+        }
+        let window = self.window.max(READAHEAD_MIN_BYTES);
+        self.window = std::cmp::min(window * 2, READAHEAD_MAX_BYTES);
+        std::cmp::max(size, window)
+    }
+}
 
-        let fs = Self {
-            conn,
-            chunk_size,
-            dentry_cache: Arc::new(DentryCache::new(DENTRY_CACHE_MAX_SIZE)),
+impl Drop for AgentFSFile {
+    fn drop(&mut self) {
+        let Some(buffer) = self.buffer.take() else {
+            return;
         };
-        Ok(fs)
+        if !self.buffers.detach(self.ino, &buffer) {
+            return;
+        }
+        // The last handle is gone with writes still buffered. Outside a
+        // runtime they stay buffered until the next handle or path-level
+        // operation on the file writes them back.
+        let Ok(runtime) = tokio::runtime::Handle::try_current() else {
+            return;
+        };
+        let file = self.unbuffered();
+        runtime.spawn(async move {
+            let written = file.flush_dirty(&mut *buffer.lock().await).await;
+            if written.is_ok() {
+                file.buffers.release(file.ino, &buffer);
+            }
+        });
     }
+}
 
-    /// Get the configured chunk size
-    pub fn chunk_size(&self) -> usize {
-        self.chunk_size
+#[async_trait]
+impl File for AgentFSFile {
+    async fn pread(&self, offset: u64, size: u64) -> Result<Vec<u8>> {
+        let _timer = metrics::timer(Op::Read, Layer::Delta);
+        if let Some(buffer) = &self.buffer {
+            let dirty = buffer.lock().await;
+            if !dirty.is_clean() {
+                let mut data = self.pread_ahead(offset, size).await?;
+                self.overlay_dirty(&dirty, offset, &mut data);
+                return Ok(data);
+            }
+        }
+        self.pread_ahead(offset, size).await
     }
 
-    /// Get the underlying database connection
-    pub fn get_connection(&self) -> Arc<Connection> {
-        self.conn.clone()
+    async fn pwrite(&self, offset: u64, data: &[u8]) -> Result<()> {
+        let _timer = metrics::timer(Op::Write, Layer::Delta);
+        if data.is_empty() {
+            return Ok(());
+        }
+        let Some(buffer) = &self.buffer else {
+            return self.pwrite_stored(offset, data).await;
+        };
+
+        let mut dirty = buffer.lock().await;
+        self.buffer_write(&mut dirty, offset, data).await?;
+        if dirty.bytes >= self.buffers.limit() {
+            self.flush_dirty(&mut dirty).await?;
+        }
+        Ok(())
     }
 
-    /// Initialize the database schema
-    async fn initialize_schema(conn: &Connection) -> Result<()> {
-        // Create config table
-        conn.execute(
-            "CREATE TABLE IF NOT EXISTS fs_config (
-                key TEXT PRIMARY KEY,
-                value TEXT NOT NULL
-            )",
-            (),
-        )
-        .await?;
+    async fn truncate(&self, new_size: u64) -> Result<()> {
+        let Some(buffer) = &self.buffer else {
+            return self.truncate_stored(new_size).await;
+        };
+        let mut dirty = buffer.lock().await;
+        self.flush_dirty(&mut dirty).await?;
+        self.truncate_stored(new_size).await
+    }
 
-        // Create inode table
-        conn.execute(
-            "CREATE TABLE IF NOT EXISTS fs_inode (
-                ino INTEGER PRIMARY KEY AUTOINCREMENT,
-                mode INTEGER NOT NULL,
-                nlink INTEGER NOT NULL DEFAULT 0,
-                uid INTEGER NOT NULL DEFAULT 0,
-                gid INTEGER NOT NULL DEFAULT 0,
-                size INTEGER NOT NULL DEFAULT 0,
-                atime INTEGER NOT NULL,
-                mtime INTEGER NOT NULL,
-                ctime INTEGER NOT NULL
-            )",
-            (),
-        )
-        .await?;
+    async fn flush(&self) -> Result<()> {
+        if let Some(buffer) = &self.buffer {
+            self.flush_dirty(&mut *buffer.lock().await).await?;
+        }
+        Ok(())
+    }
 
-        // Create directory entry table
-        conn.execute(
-            "CREATE TABLE IF NOT EXISTS fs_dentry (
-                id INTEGER PRIMARY KEY AUTOINCREMENT,
-                name TEXT NOT NULL,
-                parent_ino INTEGER NOT NULL,
-                ino INTEGER NOT NULL,
-                UNIQUE(parent_ino, name)
-            )",
-            (),
-        )
-        .await?;
+    async fn fsync(&self) -> Result<()> {
+        let _timer = metrics::timer(Op::Fsync, Layer::Delta);
+        self.flush().await?;
+        self.group_commit.sync().await
+    }
 
-        // Create index for efficient path lookups
-        conn.execute(
-            "CREATE INDEX IF NOT EXISTS idx_fs_dentry_parent
-            ON fs_dentry(parent_ino, name)",
-            (),
-        )
-        .await?;
+    async fn fstat(&self) -> Result<Stats> {
+        let Some(mut stats) = self.attr_cache.fetch(self.readers.get(), self.ino).await? else {
+            return Err(FsError::NotFound.into());
+        };
+        if let Some(buffer) = &self.buffer {
+            apply_dirty(&*buffer.lock().await, &mut stats);
+        }
+        Ok(stats)
+    }
+}
 
-        // Create data chunks table
-        conn.execute(
-            "CREATE TABLE IF NOT EXISTS fs_data (
-                ino INTEGER NOT NULL,
-                chunk_index INTEGER NOT NULL,
-                data BLOB NOT NULL,
-                PRIMARY KEY (ino, chunk_index)
-            )",
-            (),
-        )
-        .await?;
+/// Cache the names and attributes of directory entries listed by a query
+/// started at attribute cache `generation`
+fn fill_caches(
+    dentry_cache: &DentryCache,
+    attr_cache: &AttrCache,
+    parent_ino: i64,
+    entries: &[DirEntry],
+    generation: u64,
+) {
+    for entry in entries {
+        dentry_cache.fill(parent_ino, &entry.name, entry.stats.ino);
+        attr_cache.insert(&entry.stats, generation);
+    }
+}
 
-        // Create symlink table
-        conn.execute(
-            "CREATE TABLE IF NOT EXISTS fs_symlink (
-                ino INTEGER PRIMARY KEY,
-                target TEXT NOT NULL
-            )",
-            (),
-        )
-        .await?;
+/// Report the size and mtime of buffered writes in `stats`
+fn apply_dirty(dirty: &DirtyChunks, stats: &mut Stats) {
+    if let Some(size) = dirty.size {
+        stats.size = size as i64;
+        stats.mtime = dirty.mtime;
+    }
+}
 
-        // Ensure chunk_size config exists
-        let mut rows = conn
-            .query("SELECT value FROM fs_config WHERE key = 'chunk_size'", ())
-            .await?;
+/// Copy the part of a row stored at byte `row_offset` that overlaps `buf`,
+/// which holds the file from byte `offset` on. Returns the end of the copied
+/// range relative to `buf`, or 0 if they don't overlap.
+fn copy_overlap(buf: &mut [u8], offset: u64, row_offset: u64, row: &[u8]) -> usize {
+    let lo = std::cmp::max(offset, row_offset);
+    let hi = std::cmp::min(offset + buf.len() as u64, row_offset + row.len() as u64);
+    if lo >= hi {
+        return 0;
+    }
+    buf[(lo - offset) as usize..(hi - offset) as usize]
+        .copy_from_slice(&row[(lo - row_offset) as usize..(hi - row_offset) as usize]);
+    (hi - offset) as usize
+}
 
-        if rows.next().await?.is_none() {
-            conn.execute(
-                "INSERT INTO fs_config (key, value) VALUES ('chunk_size', ?)",
-                (DEFAULT_CHUNK_SIZE.to_string(),),
-            )
-            .await?;
+impl AgentFSFile {
+    /// A handle to the same inode that bypasses the write buffer
+    fn unbuffered(&self) -> AgentFSFile {
+        AgentFSFile {
+            conn: self.conn.clone(),
+            writer: self.writer.clone(),
+            readers: self.readers.clone(),
+            attr_cache: self.attr_cache.clone(),
+            ino: self.ino,
+            chunk_size: self.chunk_size,
+            chunks: self.chunks,
+            buffers: self.buffers.clone(),
+            buffer: None,
+            group_commit: self.group_commit.clone(),
+            readahead: Mutex::new(Readahead::default()),
         }
+    }
 
-        // Ensure root directory exists
-        let mut rows = conn
-            .query("SELECT ino FROM fs_inode WHERE ino = ?", (ROOT_INO,))
-            .await?;
-
-        if rows.next().await?.is_none() {
-            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
-            conn.execute(
-                "INSERT INTO fs_inode (ino, mode, nlink, uid, gid, size, atime, mtime, ctime)
-                VALUES (?, ?, 1, 0, 0, 0, ?, ?, ?)",
-                (ROOT_INO, DEFAULT_DIR_MODE as i64, now, now, now),
-            )
-            .await?;
+    /// Read from the database through this handle's read-ahead, ignoring
+    /// buffered writes
+    async fn pread_ahead(&self, offset: u64, size: u64) -> Result<Vec<u8>> {
+        if size == 0 {
+            return Ok(Vec::new());
+        }
+        // Taken before reading, so a change to the file committed meanwhile
+        // discards what this read prefetches
+        let version = self.attr_cache.version(self.ino);
+        let want = {
+            let mut readahead = self.readahead.lock().unwrap();
+            if let Some(data) = readahead.take(offset, size, version) {
+                return Ok(data);
+            }
+            readahead.plan(offset, size)
+        };
+        if want == size {
+            return self.pread_stored(offset, size).await;
         }
 
-        Ok(())
+        // Don't prefetch the zeros past the end of the stored file
+        let stored_size = self
+            .attr_cache
+            .fetch(&self.readers.get(), self.ino)
+            .await?
+            .map_or(0, |stats| stats.size as u64);
+        let want = std::cmp::max(
+            size,
+            std::cmp::min(want, stored_size.saturating_sub(offset)),
+        );
+
+        let mut data = self.pread_stored(offset, want).await?;
+        if want > size {
+            let rest = data.split_off(size as usize);
+            self.readahead.lock().unwrap().prefetched = Some(Prefetched {
+                offset: offset + size,
+                data: rest,
+                version,
+            });
+        }
+        Ok(data)
     }
 
-    /// Read chunk size from config
-    async fn read_chunk_size(conn: &Connection) -> Result<usize> {
-        let mut rows = conn
-            .query("SELECT value FROM fs_config WHERE key = 'chunk_size'", ())
+    /// Read straight from the database, ignoring buffered writes
+    async fn pread_stored(&self, offset: u64, size: u64) -> Result<Vec<u8>> {
+        let chunk_size = self.chunk_size as u64;
+        let start_chunk = offset / chunk_size;
+        let end_chunk = (offset + size).saturating_sub(1) / chunk_size;
+
+        let chunks = self
+            .chunks
+            .read_range(&self.readers.get(), self.ino, start_chunk, end_chunk)
             .await?;
 
-        if let Some(row) = rows.next().await? {
-            let value = row
-                .get_value(0)
-                .ok()
-                .and_then(|v| match v {
-                    Value::Text(s) => s.parse::<usize>().ok(),
-                    Value::Integer(i) => Some(i as usize),
-                    _ => None,
-                })
-                .unwrap_or(DEFAULT_CHUNK_SIZE);
-            Ok(value)
-        } else {
-            Ok(DEFAULT_CHUNK_SIZE)
+        // Whatever no row covers is a hole in a sparse file and reads as zeros
+        let mut result = vec![0u8; size as usize];
+        for (chunk_index, chunk_data) in chunks {
+            copy_overlap(&mut result, offset, chunk_index * chunk_size, &chunk_data);
         }
+        Ok(result)
     }
 
-    /// Normalize a path
-    fn normalize_path(&self, path: &str) -> String {
-        let normalized = path.trim_end_matches('/');
-        let normalized = if normalized.is_empty() {
-            "/"
-        } else if normalized.starts_with('/') {
-            normalized
+    /// Write straight to the database
+    async fn pwrite_stored(&self, offset: u64, data: &[u8]) -> Result<()> {
+        if data.is_empty() {
+            return Ok(());
+        }
+        let _writer = self.writer.lock().await?;
+
+        // Get current file size
+        let mut stmt = self
+            .conn
+            .prepare_cached("SELECT size FROM fs_inode WHERE ino = ?")
+            .await?;
+        let mut rows = stmt.query((self.ino,)).await?;
+        let current_size = if let Some(row) = rows.next().await? {
+            row.get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u64
         } else {
-            return format!("/{}", normalized);
+            0
         };
 
-        // Handle . and .. components
-        let components: Vec<&str> = normalized.split('/').filter(|s| !s.is_empty()).collect();
-        let mut result = Vec::new();
-
-        for component in components {
-            match component {
-                "." => {
-                    // Current directory - skip it
-                    continue;
-                }
-                ".." => {
-                    // Parent directory - only pop if there is a component to pop (don't traverse above root)
-                    if !result.is_empty() {
-                        result.pop();
-                    }
-                }
-                _ => {
-                    result.push(component);
-                }
-            }
+        // If writing beyond current size, extend with zeros first
+        if offset > current_size {
+            let zeros = vec![0u8; (offset - current_size) as usize];
+            self.write_data_at_offset(current_size, &zeros).await?;
         }
 
-        if result.is_empty() {
-            "/".to_string()
-        } else {
-            format!("/{}", result.join("/"))
-        }
-    }
+        // Write the actual data
+        self.write_data_at_offset(offset, data).await?;
 
-    /// Split path into components
-    fn split_path(&self, path: &str) -> Vec<String> {
-        let normalized = self.normalize_path(path);
-        if normalized == "/" {
-            return vec![];
-        }
-        normalized
-            .split('/')
-            .filter(|p| !p.is_empty())
-            .map(|s| s.to_string())
-            .collect()
+        // Update file size and mtime
+        let new_size = std::cmp::max(current_size, offset + data.len() as u64);
+        let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+        let _invalidate = self.attr_cache.invalidate_on_drop(self.ino);
+        let mut stmt = self
+            .conn
+            .prepare_cached("UPDATE fs_inode SET size = ?, mtime = ? WHERE ino = ?")
+            .await?;
+        stmt.execute((new_size as i64, now, self.ino)).await?;
+
+        Ok(())
     }
 
-    /// Look up a child entry by parent inode and name.
-    ///
-    /// This is more efficient than `resolve_path` when you already have the parent inode,
-    /// as it avoids re-resolving all parent path components.
-    async fn lookup_child(&self, parent_ino: i64, name: &str) -> Result<Option<i64>> {
+    /// Truncate the stored file; the write buffer must be clean
+    async fn truncate_stored(&self, new_size: u64) -> Result<()> {
+        let _writer = self.writer.lock().await?;
+        // Get current size
         let mut stmt = self
             .conn
-            .prepare_cached("SELECT ino FROM fs_dentry WHERE parent_ino = ? AND name = ?")
+            .prepare_cached("SELECT size FROM fs_inode WHERE ino = ?")
             .await?;
-        let mut rows = stmt.query((parent_ino, name)).await?;
+        let mut rows = stmt.query((self.ino,)).await?;
+        let current_size = if let Some(row) = rows.next().await? {
+            row.get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u64
+        } else {
+            0
+        };
 
-        let mut found_ino = None;
-        let mut row_count = 0;
+        let chunk_size = self.chunk_size as u64;
 
-        while let Some(row) = rows.next().await? {
-            found_ino = row.get_value(0).ok().and_then(|v| v.as_integer().copied());
-            row_count += 1;
+        self.conn
+            .prepare_cached("BEGIN IMMEDIATE")
+            .await?
+            .execute(())
+            .await?;
+        metrics::transaction();
+
+        let result: Result<()> = async {
+            if new_size == 0 {
+                // Special case: truncate to zero - just delete all chunks
+                self.chunks.delete_from(&self.conn, self.ino, 0).await?;
+            } else if new_size < current_size {
+                // Shrinking: delete excess chunks and truncate last chunk if needed
+                let last_chunk_idx = (new_size - 1) / chunk_size;
+
+                // Delete all chunks beyond the last one we need
+                self.chunks
+                    .delete_from(&self.conn, self.ino, last_chunk_idx + 1)
+                    .await?;
+
+                // Truncate the last chunk if needed
+                let offset_in_chunk = (new_size % chunk_size) as usize;
+                if offset_in_chunk > 0 {
+                    if let Some(mut chunk_data) = self
+                        .chunks
+                        .read(&self.conn, self.ino, last_chunk_idx)
+                        .await?
+                    {
+                        if chunk_data.len() > offset_in_chunk {
+                            chunk_data.truncate(offset_in_chunk);
+                            self.chunks
+                                .write(&self.conn, self.ino, last_chunk_idx, &chunk_data)
+                                .await?;
+                        }
+                    }
+                }
+            }
+            // For extending (new_size > current_size), we just update the size
+            // The sparse regions will be handled by pread returning zeros
+
+            // Update the inode size and mtime
+            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+            let mut stmt = self
+                .conn
+                .prepare_cached("UPDATE fs_inode SET size = ?, mtime = ? WHERE ino = ?")
+                .await?;
+            stmt.execute((new_size as i64, now, self.ino)).await?;
+
+            Ok(())
         }
+        .await;
 
-        if row_count > 1 {
-            return Err(FsError::InvalidPath.into());
+        if result.is_err() {
+            let _ = self
+                .conn
+                .prepare_cached("ROLLBACK")
+                .await?
+                .execute(())
+                .await;
+            return result;
         }
 
-        Ok(found_ino)
+        self.conn
+            .prepare_cached("COMMIT")
+            .await?
+            .execute(())
+            .await?;
+        self.attr_cache.invalidate(self.ino);
+        Ok(())
     }
 
-    /// Get link count for an inode
-    async fn get_link_count(&self, ino: i64) -> Result<u32> {
+    /// Size of the file as stored in the database
+    async fn stored_size(&self) -> Result<u64> {
         let mut stmt = self
             .conn
-            .prepare_cached("SELECT nlink FROM fs_inode WHERE ino = ?")
+            .prepare_cached("SELECT size FROM fs_inode WHERE ino = ?")
             .await?;
-        let mut rows = stmt.query((ino,)).await?;
-
-        if let Some(row) = rows.next().await? {
-            let nlink = row
-                .get_value(0)
+        let mut rows = stmt.query((self.ino,)).await?;
+        Ok(if let Some(row) = rows.next().await? {
+            row.get_value(0)
                 .ok()
                 .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0);
-            Ok(nlink as u32)
+                .unwrap_or(0) as u64
         } else {
-            Ok(0)
-        }
+            0
+        })
     }
 
-    /// Build a Stats object from a database row
-    ///
-    /// The row should contain columns in this order:
-    /// ino, mode, nlink, uid, gid, size, atime, mtime, ctime
-    fn build_stats_from_row(row: &turso::Row) -> Result<Stats> {
-        Ok(Stats {
-            ino: row
-                .get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0),
-            mode: row
-                .get_value(1)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u32,
-            nlink: row
-                .get_value(2)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(1) as u32,
-            uid: row
-                .get_value(3)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u32,
-            gid: row
-                .get_value(4)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u32,
-            size: row
-                .get_value(5)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0),
-            atime: row
-                .get_value(6)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0),
-            mtime: row
-                .get_value(7)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0),
-            ctime: row
-                .get_value(8)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0),
-        })
+    /// Read one stored chunk, empty if it doesn't exist
+    async fn load_chunk(&self, chunk_index: u64) -> Result<Vec<u8>> {
+        Ok(self
+            .chunks
+            .read(&self.conn, self.ino, chunk_index)
+            .await?
+            .unwrap_or_default())
     }
 
-    /// Resolve a path to an inode number
-    async fn resolve_path(&self, path: &str) -> Result<Option<i64>> {
-        let components = self.split_path(path);
-        if components.is_empty() {
-            return Ok(Some(ROOT_INO));
+    /// Apply a write to the buffer, loading each touched chunk the first time
+    async fn buffer_write(&self, dirty: &mut DirtyChunks, offset: u64, data: &[u8]) -> Result<()> {
+        let size = match dirty.size {
+            Some(size) => size,
+            None => self.stored_size().await?,
+        };
+
+        // Like unbuffered writes, writing past end of file zero-fills the gap
+        let gap = vec![0u8; offset.saturating_sub(size) as usize];
+        for (offset, data) in [(size, gap.as_slice()), (offset, data)] {
+            self.buffer_segment(dirty, size, offset, data).await?;
         }
 
-        let mut current_ino = ROOT_INO;
-        for component in components {
-            // Check cache first
-            if let Some(cached_ino) = self.dentry_cache.get(current_ino, &component) {
-                current_ino = cached_ino;
-                continue;
-            }
+        dirty.size = Some(std::cmp::max(size, offset + data.len() as u64));
+        dirty.mtime = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+        Ok(())
+    }
 
-            // Cache miss - query database
-            let mut statement = self
-                .conn
-                .prepare_cached("SELECT ino FROM fs_dentry WHERE parent_ino = ? AND name = ?")
-                .await?;
-            let mut rows = statement.query((current_ino, component.as_str())).await?;
-
-            let mut found_row = None;
-            let mut row_count = 0;
+    /// Copy one contiguous write into the buffered chunks
+    async fn buffer_segment(
+        &self,
+        dirty: &mut DirtyChunks,
+        size: u64,
+        offset: u64,
+        data: &[u8],
+    ) -> Result<()> {
+        let chunk_size = self.chunk_size as u64;
+        let mut written = 0usize;
 
-            while let Some(row) = rows.next().await? {
-                found_row = Some(row);
-                row_count += 1;
+        while written < data.len() {
+            let pos = offset + written as u64;
+            let chunk_index = pos / chunk_size;
+            let offset_in_chunk = (pos % chunk_size) as usize;
+            let to_write = std::cmp::min(self.chunk_size - offset_in_chunk, data.len() - written);
+
+            if !dirty.chunks.contains_key(&chunk_index) {
+                // Only read the stored chunk if some of its bytes survive the
+                // write: not when the write covers it up to end of file, and
+                // not past end of file where nothing is stored.
+                let covered = offset_in_chunk == 0
+                    && (to_write == self.chunk_size || pos + to_write as u64 >= size);
+                let stored = if covered || chunk_index * chunk_size >= size {
+                    Vec::new()
+                } else {
+                    self.load_chunk(chunk_index).await?
+                };
+                dirty.bytes += stored.len();
+                dirty.chunks.insert(chunk_index, stored);
             }
 
-            if row_count > 1 {
-                return Err(FsError::InvalidPath.into());
+            let chunk = dirty.chunks.get_mut(&chunk_index).unwrap();
+            let before = chunk.len();
+            if chunk.len() < offset_in_chunk + to_write {
+                chunk.resize(offset_in_chunk + to_write, 0);
             }
+            chunk[offset_in_chunk..offset_in_chunk + to_write]
+                .copy_from_slice(&data[written..written + to_write]);
+            dirty.bytes += chunk.len() - before;
 
-            if let Some(row) = found_row {
-                let child_ino = row
-                    .get_value(0)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0);
-
-                // Populate cache
-                self.dentry_cache.insert(current_ino, &component, child_ino);
-                current_ino = child_ino;
-            } else {
-                return Ok(None);
-            }
+            written += to_write;
         }
+        Ok(())
+    }
 
-        Ok(Some(current_ino))
+    /// Copy buffered chunks over data read from the database at `offset`
+    fn overlay_dirty(&self, dirty: &DirtyChunks, offset: u64, data: &mut [u8]) {
+        if data.is_empty() {
+            return;
+        }
+        let chunk_size = self.chunk_size as u64;
+        let end = offset + data.len() as u64;
+        let first = offset / chunk_size;
+        let last = (end - 1) / chunk_size;
+
+        for (&chunk_index, chunk) in dirty.chunks.range(first..=last) {
+            let chunk_start = chunk_index * chunk_size;
+            let lo = std::cmp::max(chunk_start, offset);
+            let hi = std::cmp::min(chunk_start + chunk_size, end);
+            // A buffered chunk replaces the stored one, so anything past its
+            // end reads as zeros
+            let filled = std::cmp::min(hi, chunk_start + chunk.len() as u64).max(lo);
+            data[(lo - offset) as usize..(filled - offset) as usize].copy_from_slice(
+                &chunk[(lo - chunk_start) as usize..(filled - chunk_start) as usize],
+            );
+            data[(filled - offset) as usize..(hi - offset) as usize].fill(0);
+        }
     }
 
-    /// Get file statistics without following symlinks
-    pub async fn lstat(&self, path: &str) -> Result<Option<Stats>> {
-        let path = self.normalize_path(path);
-        let ino = match self.resolve_path(&path).await? {
-            Some(ino) => ino,
-            None => return Ok(None),
+    /// Write the buffered chunks and the new size in one transaction
+    async fn flush_dirty(&self, dirty: &mut DirtyChunks) -> Result<()> {
+        let Some(size) = dirty.size else {
+            return Ok(());
         };
 
-        let mut stmt = self
-            .conn
-            .prepare_cached("SELECT ino, mode, nlink, uid, gid, size, atime, mtime, ctime FROM fs_inode WHERE ino = ?")
+        let _writer = self.writer.lock().await?;
+        self.conn
+            .prepare_cached("BEGIN IMMEDIATE")
+            .await?
+            .execute(())
             .await?;
+        metrics::transaction();
 
-        let mut rows = stmt.query((ino,)).await?;
+        let result: Result<()> = async {
+            let mut stmt = self
+                .conn
+                .prepare_cached("UPDATE fs_inode SET size = ?, mtime = ? WHERE ino = ?")
+                .await?;
+            let updated = stmt.execute((size as i64, dirty.mtime, self.ino)).await?;
+            if updated == 0 {
+                // The inode was deleted while its writes were buffered
+                return Ok(());
+            }
 
-        if let Some(row) = rows.next().await? {
-            let stats = Self::build_stats_from_row(&row)?;
-            Ok(Some(stats))
-        } else {
-            Ok(None)
+            self.chunks
+                .write_chunks(&self.conn, self.ino, &dirty.chunks)
+                .await?;
+            Ok(())
         }
-    }
-
-    /// Get file statistics, following symlinks
-    pub async fn stat(&self, path: &str) -> Result<Option<Stats>> {
-        let path = self.normalize_path(path);
+        .await;
 
-        // Follow symlinks with a maximum depth to prevent infinite loops
-        let mut current_path = path;
-        let max_symlink_depth = 40; // Standard limit for symlink following
+        if result.is_err() {
+            let _ = self
+                .conn
+                .prepare_cached("ROLLBACK")
+                .await?
+                .execute(())
+                .await;
+            return result;
+        }
 
-        for _ in 0..max_symlink_depth {
-            let ino = match self.resolve_path(&current_path).await? {
-                Some(ino) => ino,
-                None => return Ok(None),
-            };
+        self.conn
+            .prepare_cached("COMMIT")
+            .await?
+            .execute(())
+            .await?;
+        self.attr_cache.invalidate(self.ino);
+        *dirty = DirtyChunks::default();
+        Ok(())
+    }
 
-            let mut rows = self
-                .conn
-                .query(
-                    "SELECT ino, mode, nlink, uid, gid, size, atime, mtime, ctime FROM fs_inode WHERE ino = ?",
-                    (ino,),
-                )
-                .await?;
+    /// Write data at a specific offset, handling chunk boundaries.
+    async fn write_data_at_offset(&self, offset: u64, data: &[u8]) -> Result<()> {
+        let chunk_size = self.chunk_size as u64;
+        let mut written = 0usize;
 
-            if let Some(row) = rows.next().await? {
-                let mode = row
-                    .get_value(1)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0) as u32;
+        while written < data.len() {
+            let current_offset = offset + written as u64;
+            let chunk_index = current_offset / chunk_size;
+            let offset_in_chunk = (current_offset % chunk_size) as usize;
 
-                // Check if this is a symlink
-                if (mode & S_IFMT) == S_IFLNK {
-                    // Read the symlink target
-                    let target = self
-                        .readlink(&current_path)
-                        .await?
-                        .ok_or(FsError::InvalidPath)?;
+            // How much can we write in this chunk?
+            let remaining_in_chunk = self.chunk_size - offset_in_chunk;
+            let remaining_data = data.len() - written;
+            let to_write = std::cmp::min(remaining_in_chunk, remaining_data);
 
-                    // Resolve target path (handle both absolute and relative paths)
-                    current_path = if target.starts_with('/') {
-                        target
-                    } else {
-                        // Relative path - resolve relative to the symlink's directory
-                        let base_path = Path::new(&current_path);
-                        let parent = base_path.parent().unwrap_or(Path::new("/"));
-                        let joined = parent.join(&target);
-                        joined.to_string_lossy().into_owned()
-                    };
-                    current_path = self.normalize_path(&current_path);
-                    continue; // Follow the symlink
-                }
+            // Get existing chunk data (if any)
+            let mut chunk_data = self.load_chunk(chunk_index).await?;
 
-                // Not a symlink, return the stats
-                let stats = Self::build_stats_from_row(&row)?;
-                return Ok(Some(stats));
-            } else {
-                return Ok(None);
+            // Extend chunk if needed
+            if chunk_data.len() < offset_in_chunk + to_write {
+                chunk_data.resize(offset_in_chunk + to_write, 0);
             }
-        }
 
-        // Too many symlinks
-        Err(FsError::SymlinkLoop.into())
-    }
+            // Write data into chunk
+            chunk_data[offset_in_chunk..offset_in_chunk + to_write]
+                .copy_from_slice(&data[written..written + to_write]);
 
-    /// Create a directory
-    pub async fn mkdir(&self, path: &str) -> Result<()> {
-        let path = self.normalize_path(path);
-        let components = self.split_path(&path);
+            // Save chunk
+            self.chunks
+                .write(&self.conn, self.ino, chunk_index, &chunk_data)
+                .await?;
 
-        if components.is_empty() {
-            return Err(FsError::RootOperation.into());
+            written += to_write;
         }
 
-        let parent_path = if components.len() == 1 {
-            "/".to_string()
+        Ok(())
+    }
+}
+
+impl AgentFS {
+    /// Create a new filesystem
+    pub async fn new(db_path: &str) -> Result<Self> {
+        let db = Builder::new_local(db_path).build().await?;
+        let conn = Arc::new(db.connect()?);
+        // In-memory databases have no WAL for readers to snapshot, so they
+        // stay on a single connection.
+        let readers = if db_path == ":memory:" {
+            0
         } else {
-            format!("/{}", components[..components.len() - 1].join("/"))
+            DEFAULT_READER_CONNECTIONS
         };
+        Self::from_database(&db, conn, readers).await
+    }
 
-        let parent_ino = self
-            .resolve_path(&parent_path)
-            .await?
-            .ok_or(FsError::NotFound)?;
+    /// Create a filesystem from an existing connection
+    ///
+    /// All queries, reads included, go through `conn`. Use
+    /// [`AgentFS::from_database`] to get dedicated reader connections.
+    pub async fn from_connection(conn: Arc<Connection>) -> Result<Self> {
+        Self::from_connections(conn, Vec::new()).await
+    }
 
-        let name = components.last().unwrap();
+    /// Create a filesystem with a writer connection and `readers` additional
+    /// read-only connections opened from `db`
+    pub async fn from_database(
+        db: &Database,
+        conn: Arc<Connection>,
+        readers: usize,
+    ) -> Result<Self> {
+        // Make sure the schema exists before the readers look at it.
+        Self::initialize_schema(&conn).await?;
 
-        // Check if already exists (single query using parent_ino we already have)
-        if self.lookup_child(parent_ino, name).await?.is_some() {
-            return Err(FsError::AlreadyExists.into());
+        let mut reader_conns = Vec::with_capacity(readers);
+        for _ in 0..readers {
+            reader_conns.push(Arc::new(db.connect()?));
         }
+        Self::from_connections(conn, reader_conns).await
+    }
 
-        // Create inode
-        let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
-        let mut stmt = self
-            .conn
-            .prepare(
-                "INSERT INTO fs_inode (mode, uid, gid, size, atime, mtime, ctime)
-                VALUES (?, 0, 0, 0, ?, ?, ?) RETURNING ino",
-            )
-            .await?;
-        let row = stmt
-            .query_row((DEFAULT_DIR_MODE as i64, now, now, now))
-            .await?;
-
-        let ino = row
-            .get_value(0)
-            .ok()
-            .and_then(|v| v.as_integer().copied())
-            .ok_or_else(|| Error::Internal("failed to get inode".to_string()))?;
-
-        // Create directory entry
-        let mut stmt = self
-            .conn
-            .prepare_cached("INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)")
-            .await?;
-        stmt.execute((name.as_str(), parent_ino, ino)).await?;
-
-        // Increment link count
-        let mut stmt = self
-            .conn
-            .prepare_cached("UPDATE fs_inode SET nlink = nlink + 1 WHERE ino = ?")
-            .await?;
-        stmt.execute((ino,)).await?;
-
-        // Populate dentry cache
-        self.dentry_cache.insert(parent_ino, name, ino);
-
-        Ok(())
+    /// Open an existing database for reading only
+    ///
+    /// Neither creates nor upgrades the schema and has no writer: every
+    /// change, through a path or a file handle, fails with
+    /// `FsError::ReadOnly`. Reads are spread across `readers` connections,
+    /// at least one. For the layers below a fork, which are never written.
+    pub async fn open_read_only(db: &Database, readers: usize) -> Result<Self> {
+        let mut conns = Vec::with_capacity(readers.max(1));
+        for _ in 0..readers.max(1) {
+            let conn = Arc::new(db.connect()?);
+            conn.execute("PRAGMA busy_timeout = 5000", ()).await?;
+            conns.push(conn);
+        }
+        let conn = conns[0].clone();
+        let chunk_size = Self::read_chunk_size(&conn).await?;
+        let chunks = ChunkStore::load(&conn).await?;
+        // No connection ever holds an uncommitted transaction of ours, so
+        // the caches are safe even with a single connection
+        let dedicated_readers = true;
+
+        let writer = WriterLock::read_only();
+        Ok(Self {
+            group_commit: Arc::new(GroupCommit::new(conn.clone(), writer.clone())),
+            conn,
+            writer,
+            readers: Arc::new(ReaderPool::new(conns)),
+            chunk_size,
+            chunks,
+            dentry_cache: Arc::new(DentryCache::new(DENTRY_CACHE_MAX_SIZE, dedicated_readers)),
+            attr_cache: Arc::new(AttrCache::new(ATTR_CACHE_MAX_SIZE, dedicated_readers)),
+            write_buffers: Arc::new(WriteBuffers::new()),
+        })
     }
 
-    /// Write data to a file
-    pub async fn write_file(&self, path: &str, data: &[u8]) -> Result<()> {
-        let path = self.normalize_path(path);
-        let components = self.split_path(&path);
+    /// Create a filesystem from a writer connection and a set of reader
+    /// connections to the same database
+    ///
+    /// Mutations and transactions always use `conn`. Read-only operations
+    /// (`stat`, `lstat`, `read_file`, `pread`, `readdir`, `readlink`,
+    /// `statfs` and reads through open file handles) are spread across
+    /// `readers`. An empty `readers` list makes the writer serve reads too.
+    pub async fn from_connections(
+        conn: Arc<Connection>,
+        readers: Vec<Arc<Connection>>,
+    ) -> Result<Self> {
+        // Initialize schema first
+        Self::initialize_schema(&conn).await?;
 
-        if components.is_empty() {
-            return Err(FsError::RootOperation.into());
+        // Disable synchronous mode for filesystem fsync() semantics.
+        conn.execute("PRAGMA synchronous = OFF", ()).await?;
+
+        // Set busy timeout to handle concurrent access gracefully.
+        // Without this, concurrent transactions fail immediately with SQLITE_BUSY.
+        conn.execute("PRAGMA busy_timeout = 5000", ()).await?;
+        for reader in &readers {
+            reader.execute("PRAGMA busy_timeout = 5000", ()).await?;
         }
 
-        let parent_path = if components.len() == 1 {
-            "/".to_string()
+        // Get chunk_size from config (or use default)
+        let chunk_size = Self::read_chunk_size(&conn).await?;
+        let chunks = ChunkStore::load(&conn).await?;
+
+        let dedicated_readers = !readers.is_empty();
+        let readers = if readers.is_empty() {
+            vec![conn.clone()]
         } else {
-            format!("/{}", components[..components.len() - 1].join("/"))
+            readers
         };
 
-        let parent_ino = self
-            .resolve_path(&parent_path)
-            .await?
-            .ok_or(FsError::NotFound)?;
+        let writer = WriterLock::default();
+        let fs = Self {
+            group_commit: Arc::new(GroupCommit::new(conn.clone(), writer.clone())),
+            conn,
+            writer,
+            readers: Arc::new(ReaderPool::new(readers)),
+            chunk_size,
+            chunks,
+            dentry_cache: Arc::new(DentryCache::new(DENTRY_CACHE_MAX_SIZE, dedicated_readers)),
+            attr_cache: Arc::new(AttrCache::new(ATTR_CACHE_MAX_SIZE, dedicated_readers)),
+            write_buffers: Arc::new(WriteBuffers::new()),
+        };
+        Ok(fs)
+    }
 
-        let name = components.last().unwrap();
+    /// Get the configured chunk size
+    pub fn chunk_size(&self) -> usize {
+        self.chunk_size
+    }
 
+    /// Get the largest number of bytes stored in one row of `fs_data`
+    pub fn extent_size(&self) -> usize {
+        self.chunks.extent_size() as usize
+    }
+
+    /// Whether identical chunks are stored once (see [`AgentFS::init_dedup`])
+    pub fn is_dedup(&self) -> bool {
+        self.chunks.is_dedup()
+    }
+
+    /// Enable content-addressed chunk storage on a new filesystem
+    ///
+    /// Chunks are stored once per distinct content, keyed by SHA-256 and
+    /// reference counted, so identical files and copies share storage. The
+    /// mode is recorded in `fs_config` and applies to every later open.
+    ///
+    /// Must run before any file has data, either before the filesystem is
+    /// opened or right after it is created. Does nothing if dedup is already
+    /// enabled.
+    pub async fn init_dedup(conn: &Connection) -> Result<()> {
+        ChunkStore::enable_dedup(conn).await
+    }
+
+    /// Codec chunks are compressed with, if any
+    pub fn compression(&self) -> Option<Compression> {
+        self.chunks.compression()
+    }
+
+    /// Enable chunk compression
+    ///
+    /// Chunks written afterwards are compressed, except those that don't get
+    /// smaller, which are stored raw. Existing chunks stay as they are. The
+    /// codec is recorded in `fs_config`, takes effect on the next open and
+    /// can't be changed once set.
+    pub async fn init_compression(conn: &Connection, compression: Compression) -> Result<()> {
+        ChunkStore::enable_compression(conn, compression).await
+    }
+
+    /// Store large files in extents of up to 1 MiB
+    ///
+    /// Whole groups of chunks written at once are stored in one `fs_data`
+    /// row instead of one row per chunk. Rows already stored stay valid. The
+    /// extent size is recorded in `fs_config`, takes effect on the next open
+    /// and can't be changed once set. Other SDKs that assume one chunk per
+    /// row can't read a filesystem with extents.
+    pub async fn init_extents(conn: &Connection) -> Result<()> {
+        ChunkStore::enable_extents(conn, DEFAULT_EXTENT_SIZE as u64).await
+    }
+
+    /// Drop all cached directory entries and inode attributes
+    ///
+    /// Subsequent path lookups go to the database until the caches warm up
+    /// again. Useful for measuring cold lookups.
+    pub fn clear_dentry_cache(&self) {
+        self.dentry_cache.clear();
+        self.attr_cache.clear();
+    }
+
+    /// Lock held while changing the database through the writer connection
+    pub(crate) fn writer(&self) -> &WriterLock {
+        &self.writer
+    }
+
+    /// Get the underlying database connection
+    pub fn get_connection(&self) -> Arc<Connection> {
+        self.conn.clone()
+    }
+
+    /// Initialize the database schema
+    async fn initialize_schema(conn: &Connection) -> Result<()> {
+        // Create config table
+        conn.execute(
+            "CREATE TABLE IF NOT EXISTS fs_config (
+                key TEXT PRIMARY KEY,
+                value TEXT NOT NULL
+            )",
+            (),
+        )
+        .await?;
+
+        // Create inode table
+        conn.execute(
+            "CREATE TABLE IF NOT EXISTS fs_inode (
+                ino INTEGER PRIMARY KEY AUTOINCREMENT,
+                mode INTEGER NOT NULL,
+                nlink INTEGER NOT NULL DEFAULT 0,
+                uid INTEGER NOT NULL DEFAULT 0,
+                gid INTEGER NOT NULL DEFAULT 0,
+                size INTEGER NOT NULL DEFAULT 0,
+                atime INTEGER NOT NULL,
+                mtime INTEGER NOT NULL,
+                ctime INTEGER NOT NULL
+            )",
+            (),
+        )
+        .await?;
+
+        // Create directory entry table
+        conn.execute(
+            "CREATE TABLE IF NOT EXISTS fs_dentry (
+                id INTEGER PRIMARY KEY AUTOINCREMENT,
+                name TEXT NOT NULL,
+                parent_ino INTEGER NOT NULL,
+                ino INTEGER NOT NULL,
+                UNIQUE(parent_ino, name)
+            )",
+            (),
+        )
+        .await?;
+
+        // Create index for efficient path lookups
+        conn.execute(
+            "CREATE INDEX IF NOT EXISTS idx_fs_dentry_parent
+            ON fs_dentry(parent_ino, name)",
+            (),
+        )
+        .await?;
+
+        // Create data chunks tables
+        ChunkStore::load(conn).await?.create_tables(conn).await?;
+
+        // Create symlink table
+        conn.execute(
+            "CREATE TABLE IF NOT EXISTS fs_symlink (
+                ino INTEGER PRIMARY KEY,
+                target TEXT NOT NULL
+            )",
+            (),
+        )
+        .await?;
+
+        // Ensure chunk_size config exists
+        let mut rows = conn
+            .query("SELECT value FROM fs_config WHERE key = 'chunk_size'", ())
+            .await?;
+
+        if rows.next().await?.is_none() {
+            conn.execute(
+                "INSERT INTO fs_config (key, value) VALUES ('chunk_size', ?)",
+                (DEFAULT_CHUNK_SIZE.to_string(),),
+            )
+            .await?;
+        }
+
+        // Ensure root directory exists
+        let mut rows = conn
+            .query("SELECT ino FROM fs_inode WHERE ino = ?", (ROOT_INO,))
+            .await?;
+
+        if rows.next().await?.is_none() {
+            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+            conn.execute(
+                "INSERT INTO fs_inode (ino, mode, nlink, uid, gid, size, atime, mtime, ctime)
+                VALUES (?, ?, 1, 0, 0, 0, ?, ?, ?)",
+                (ROOT_INO, DEFAULT_DIR_MODE as i64, now, now, now),
+            )
+            .await?;
+        }
+
+        Ok(())
+    }
+
+    /// Read chunk size from config
+    async fn read_chunk_size(conn: &Connection) -> Result<usize> {
+        let mut rows = conn
+            .query("SELECT value FROM fs_config WHERE key = 'chunk_size'", ())
+            .await?;
+
+        if let Some(row) = rows.next().await? {
+            let value = row
+                .get_value(0)
+                .ok()
+                .and_then(|v| match v {
+                    Value::Text(s) => s.parse::<usize>().ok(),
+                    Value::Integer(i) => Some(i as usize),
+                    _ => None,
+                })
+                .unwrap_or(DEFAULT_CHUNK_SIZE);
+            Ok(value)
+        } else {
+            Ok(DEFAULT_CHUNK_SIZE)
+        }
+    }
+
+    /// Normalize a path
+    fn normalize_path(&self, path: &str) -> String {
+        let normalized = path.trim_end_matches('/');
+        let normalized = if normalized.is_empty() {
+            "/"
+        } else if normalized.starts_with('/') {
+            normalized
+        } else {
+            return format!("/{}", normalized);
+        };
+
+        // Handle . and .. components
+        let components: Vec<&str> = normalized.split('/').filter(|s| !s.is_empty()).collect();
+        let mut result = Vec::new();
+
+        for component in components {
+            match component {
+                "." => {
+                    // Current directory - skip it
+                    continue;
+                }
+                ".." => {
+                    // Parent directory - only pop if there is a component to pop (don't traverse above root)
+                    if !result.is_empty() {
+                        result.pop();
+                    }
+                }
+                _ => {
+                    result.push(component);
+                }
+            }
+        }
+
+        if result.is_empty() {
+            "/".to_string()
+        } else {
+            format!("/{}", result.join("/"))
+        }
+    }
+
+    /// Split path into components
+    fn split_path(&self, path: &str) -> Vec<String> {
+        let normalized = self.normalize_path(path);
+        if normalized == "/" {
+            return vec![];
+        }
+        normalized
+            .split('/')
+            .filter(|p| !p.is_empty())
+            .map(|s| s.to_string())
+            .collect()
+    }
+
+    /// Look up a child entry by parent inode and name.
+    ///
+    /// This is more efficient than `resolve_path` when you already have the parent inode,
+    /// as it avoids re-resolving all parent path components.
+    async fn lookup_child(&self, parent_ino: i64, name: &str) -> Result<Option<i64>> {
+        let mut stmt = self
+            .conn
+            .prepare_cached("SELECT ino FROM fs_dentry WHERE parent_ino = ? AND name = ?")
+            .await?;
+        let mut rows = stmt.query((parent_ino, name)).await?;
+
+        let mut found_ino = None;
+        let mut row_count = 0;
+
+        while let Some(row) = rows.next().await? {
+            found_ino = row.get_value(0).ok().and_then(|v| v.as_integer().copied());
+            row_count += 1;
+        }
+
+        if row_count > 1 {
+            return Err(FsError::InvalidPath.into());
+        }
+
+        Ok(found_ino)
+    }
+
+    /// Get link count for an inode
+    async fn get_link_count(&self, ino: i64) -> Result<u32> {
+        let mut stmt = self
+            .conn
+            .prepare_cached("SELECT nlink FROM fs_inode WHERE ino = ?")
+            .await?;
+        let mut rows = stmt.query((ino,)).await?;
+
+        if let Some(row) = rows.next().await? {
+            let nlink = row
+                .get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0);
+            Ok(nlink as u32)
+        } else {
+            Ok(0)
+        }
+    }
+
+    /// Build a Stats object from a database row
+    ///
+    /// The row should contain columns in this order:
+    /// ino, mode, nlink, uid, gid, size, atime, mtime, ctime
+    fn build_stats_from_row(row: &turso::Row) -> Result<Stats> {
+        Ok(Stats {
+            ino: row
+                .get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0),
+            mode: row
+                .get_value(1)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u32,
+            nlink: row
+                .get_value(2)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(1) as u32,
+            uid: row
+                .get_value(3)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u32,
+            gid: row
+                .get_value(4)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u32,
+            size: row
+                .get_value(5)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0),
+            atime: row
+                .get_value(6)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0),
+            mtime: row
+                .get_value(7)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0),
+            ctime: row
+                .get_value(8)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0),
+        })
+    }
+
+    /// Resolve a path to an inode number
+    ///
+    /// Uses the writer connection, so it sees uncommitted changes made inside
+    /// an open transaction.
+    async fn resolve_path(&self, path: &str) -> Result<Option<i64>> {
+        self.resolve_path_on(&self.conn, path, false).await
+    }
+
+    /// Resolve a path to an inode number using a reader connection
+    async fn resolve_path_read(&self, path: &str) -> Result<Option<i64>> {
+        self.resolve_path_on(self.readers.get(), path, true).await
+    }
+
+    /// Resolve a path to an inode number on the given connection
+    ///
+    /// Misses are only cached when `committed` says `conn` can't see an open
+    /// transaction, which could still roll back.
+    async fn resolve_path_on(
+        &self,
+        conn: &Connection,
+        path: &str,
+        committed: bool,
+    ) -> Result<Option<i64>> {
+        let components = self.split_path(path);
+        if components.is_empty() {
+            return Ok(Some(ROOT_INO));
+        }
+
+        let mut current_ino = ROOT_INO;
+        for component in components {
+            // Check cache first
+            if let Some(cached_ino) = self.dentry_cache.get(current_ino, &component) {
+                current_ino = cached_ino;
+                continue;
+            }
+            if self.dentry_cache.is_missing(current_ino, &component) {
+                return Ok(None);
+            }
+
+            // Cache miss - query database
+            let generation = self.dentry_cache.generation();
+            let mut statement = conn
+                .prepare_cached("SELECT ino FROM fs_dentry WHERE parent_ino = ? AND name = ?")
+                .await?;
+            let mut rows = statement.query((current_ino, component.as_str())).await?;
+
+            let mut found_row = None;
+            let mut row_count = 0;
+
+            while let Some(row) = rows.next().await? {
+                found_row = Some(row);
+                row_count += 1;
+            }
+
+            if row_count > 1 {
+                return Err(FsError::InvalidPath.into());
+            }
+
+            if let Some(row) = found_row {
+                let child_ino = row
+                    .get_value(0)
+                    .ok()
+                    .and_then(|v| v.as_integer().copied())
+                    .unwrap_or(0);
+
+                // Populate cache
+                self.dentry_cache.fill(current_ino, &component, child_ino);
+                current_ino = child_ino;
+            } else {
+                if committed {
+                    self.dentry_cache
+                        .insert_missing(current_ino, &component, generation);
+                }
+                return Ok(None);
+            }
+        }
+
+        Ok(Some(current_ino))
+    }
+
+    /// Get file statistics without following symlinks
+    pub async fn lstat(&self, path: &str) -> Result<Option<Stats>> {
+        let _timer = metrics::timer(Op::Getattr, Layer::Delta);
+        let path = self.normalize_path(path);
+        let ino = match self.resolve_path_read(&path).await? {
+            Some(ino) => ino,
+            None => return Ok(None),
+        };
+        self.attrs(ino).await
+    }
+
+    /// Get file statistics, following symlinks
+    pub async fn stat(&self, path: &str) -> Result<Option<Stats>> {
+        let _timer = metrics::timer(Op::Getattr, Layer::Delta);
+        let path = self.normalize_path(path);
+
+        // Follow symlinks with a maximum depth to prevent infinite loops
+        let mut current_path = path;
+        let max_symlink_depth = 40; // Standard limit for symlink following
+
+        for _ in 0..max_symlink_depth {
+            let ino = match self.resolve_path_read(&current_path).await? {
+                Some(ino) => ino,
+                None => return Ok(None),
+            };
+
+            let stats = self.attr_cache.fetch(self.readers.get(), ino).await?;
+
+            if let Some(stats) = stats {
+                // Check if this is a symlink
+                if (stats.mode & S_IFMT) == S_IFLNK {
+                    // Read the symlink target
+                    let target = self
+                        .readlink(&current_path)
+                        .await?
+                        .ok_or(FsError::InvalidPath)?;
+
+                    // Resolve target path (handle both absolute and relative paths)
+                    current_path = if target.starts_with('/') {
+                        target
+                    } else {
+                        // Relative path - resolve relative to the symlink's directory
+                        let base_path = Path::new(&current_path);
+                        let parent = base_path.parent().unwrap_or(Path::new("/"));
+                        let joined = parent.join(&target);
+                        joined.to_string_lossy().into_owned()
+                    };
+                    current_path = self.normalize_path(&current_path);
+                    continue; // Follow the symlink
+                }
+
+                // Not a symlink, return the stats
+                return Ok(Some(self.with_buffered_writes(stats).await));
+            } else {
+                return Ok(None);
+            }
+        }
+
+        // Too many symlinks
+        Err(FsError::SymlinkLoop.into())
+    }
+
+    /// Create a directory
+    pub async fn mkdir(&self, path: &str) -> Result<()> {
+        let _writer = self.writer.lock().await?;
+        let path = self.normalize_path(path);
+        let components = self.split_path(&path);
+
+        if components.is_empty() {
+            return Err(FsError::RootOperation.into());
+        }
+
+        let parent_path = if components.len() == 1 {
+            "/".to_string()
+        } else {
+            format!("/{}", components[..components.len() - 1].join("/"))
+        };
+
+        let parent_ino = self
+            .resolve_path(&parent_path)
+            .await?
+            .ok_or(FsError::NotFound)?;
+
+        let name = components.last().unwrap();
+
+        // Check if already exists (single query using parent_ino we already have)
+        if self.lookup_child(parent_ino, name).await?.is_some() {
+            return Err(FsError::AlreadyExists.into());
+        }
+
+        // Create inode
+        let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+        let mut stmt = self
+            .conn
+            .prepare(
+                "INSERT INTO fs_inode (mode, uid, gid, size, atime, mtime, ctime)
+                VALUES (?, 0, 0, 0, ?, ?, ?) RETURNING ino",
+            )
+            .await?;
+        let row = stmt
+            .query_row((DEFAULT_DIR_MODE as i64, now, now, now))
+            .await?;
+
+        let ino = row
+            .get_value(0)
+            .ok()
+            .and_then(|v| v.as_integer().copied())
+            .ok_or_else(|| Error::Internal("failed to get inode".to_string()))?;
+
+        // Create directory entry
+        let mut stmt = self
+            .conn
+            .prepare_cached("INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)")
+            .await?;
+        stmt.execute((name.as_str(), parent_ino, ino)).await?;
+
+        // Increment link count. Listings may have seen the inode before.
+        let _invalidate = self.attr_cache.invalidate_on_drop(ino);
+        let mut stmt = self
+            .conn
+            .prepare_cached("UPDATE fs_inode SET nlink = nlink + 1 WHERE ino = ?")
+            .await?;
+        stmt.execute((ino,)).await?;
+
+        // Populate dentry cache
+        self.dentry_cache.insert(parent_ino, name, ino);
+
+        Ok(())
+    }
+
+    /// Write data to a file
+    pub async fn write_file(&self, path: &str, data: &[u8]) -> Result<()> {
+        let _buffer = self.lock_buffer(path).await?;
+        let _writer = self.writer.lock().await?;
+        let path = self.normalize_path(path);
+        let components = self.split_path(&path);
+
+        if components.is_empty() {
+            return Err(FsError::RootOperation.into());
+        }
+
+        let parent_path = if components.len() == 1 {
+            "/".to_string()
+        } else {
+            format!("/{}", components[..components.len() - 1].join("/"))
+        };
+
+        let parent_ino = self
+            .resolve_path(&parent_path)
+            .await?
+            .ok_or(FsError::NotFound)?;
+
+        let name = components.last().unwrap();
+
+        self.conn
+            .prepare_cached("BEGIN IMMEDIATE")
+            .await?
+            .execute(())
+            .await?;
+        metrics::transaction();
+
+        let result: Result<i64> = async {
+            let ino = self
+                .create_or_truncate(parent_ino, name, data.len() as u64)
+                .await?;
+
+            self.chunks.write_run(&self.conn, ino, 0, data).await?;
+
+            // Update mode (to regular file), size and mtime
+            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+            let mut stmt = self
+                .conn
+                .prepare_cached("UPDATE fs_inode SET mode = ?, size = ?, mtime = ? WHERE ino = ?")
+                .await?;
+            stmt.execute((DEFAULT_FILE_MODE as i64, data.len() as i64, now, ino))
+                .await?;
+
+            Ok(ino)
+        }
+        .await;
+
+        match result {
+            Ok(ino) => {
+                self.conn
+                    .prepare_cached("COMMIT")
+                    .await?
+                    .execute(())
+                    .await?;
+                // Readers may have missed the entry until now
+                self.dentry_cache.forget_missing(parent_ino, name);
+                self.attr_cache.invalidate(ino);
+                Ok(())
+            }
+            Err(e) => {
+                let _ = self
+                    .conn
+                    .prepare_cached("ROLLBACK")
+                    .await?
+                    .execute(())
+                    .await;
+                Err(e)
+            }
+        }
+    }
+
+    /// Look up `name` under `parent_ino` and drop its data, or create it as a
+    /// new regular file of `size` bytes. Must be called inside a transaction.
+    async fn create_or_truncate(&self, parent_ino: i64, name: &str, size: u64) -> Result<i64> {
+        // Check if file exists (single query using parent_ino we already have)
+        if let Some(ino) = self.lookup_child(parent_ino, name).await? {
+            // Delete existing data
+            self.chunks.delete_from(&self.conn, ino, 0).await?;
+            return Ok(ino);
+        }
+
+        // Create new inode
+        let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+        let mut stmt = self
+            .conn
+            .prepare(
+                "INSERT INTO fs_inode (mode, uid, gid, size, atime, mtime, ctime)
+                VALUES (?, 0, 0, ?, ?, ?, ?) RETURNING ino",
+            )
+            .await?;
+        let row = stmt
+            .query_row((DEFAULT_FILE_MODE as i64, size as i64, now, now, now))
+            .await?;
+
+        let ino = row
+            .get_value(0)
+            .ok()
+            .and_then(|v| v.as_integer().copied())
+            .ok_or_else(|| Error::Internal("failed to get inode".to_string()))?;
+
+        // Create directory entry
+        let mut stmt = self
+            .conn
+            .prepare_cached("INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)")
+            .await?;
+        stmt.execute((name, parent_ino, ino)).await?;
+
+        // Increment link count
+        let mut stmt = self
+            .conn
+            .prepare_cached("UPDATE fs_inode SET nlink = nlink + 1 WHERE ino = ?")
+            .await?;
+        stmt.execute((ino,)).await?;
+
+        // Populate dentry cache for new file
+        self.dentry_cache.insert(parent_ino, name, ino);
+
+        Ok(ino)
+    }
+
+    /// Write a file whose contents are streamed from another file handle.
+    ///
+    /// Copies the first `len` bytes of `src` into `path`, creating or
+    /// replacing it like [`AgentFS::write_file`]. Data moves in batches of
+    /// `COPY_BATCH_CHUNKS` chunks inside a single transaction, so memory use
+    /// stays bounded regardless of file size.
+    ///
+    /// Whole chunks that fall inside `skip` are neither read nor stored and
+    /// read back as zeros. Callers pass the range they are about to
+    /// overwrite so copy-up doesn't move data that is immediately replaced.
+    pub async fn write_file_from(
+        &self,
+        path: &str,
+        src: &dyn File,
+        len: u64,
+        skip: Range<u64>,
+    ) -> Result<()> {
+        let _buffer = self.lock_buffer(path).await?;
+        let _writer = self.writer.lock().await?;
+        let path = self.normalize_path(path);
+        let components = self.split_path(&path);
+
+        if components.is_empty() {
+            return Err(FsError::RootOperation.into());
+        }
+
+        let parent_path = if components.len() == 1 {
+            "/".to_string()
+        } else {
+            format!("/{}", components[..components.len() - 1].join("/"))
+        };
+
+        let parent_ino = self
+            .resolve_path(&parent_path)
+            .await?
+            .ok_or(FsError::NotFound)?;
+
+        let name = components.last().unwrap();
+
+        // Shrink the skipped range to whole chunks. A partial chunk at the end
+        // of the file counts as whole.
+        let chunk_size = self.chunk_size as u64;
+        let skip_start = skip.start.div_ceil(chunk_size) * chunk_size;
+        let skip_end = if skip.end >= len {
+            len
+        } else {
+            skip.end / chunk_size * chunk_size
+        };
+        let ranges = if skip_start < skip_end {
+            [(0, skip_start), (skip_end, len)]
+        } else {
+            [(0, len), (len, len)]
+        };
+
+        self.conn
+            .prepare_cached("BEGIN IMMEDIATE")
+            .await?
+            .execute(())
+            .await?;
+        metrics::transaction();
+
+        let result: Result<i64> = async {
+            let ino = self.create_or_truncate(parent_ino, name, len).await?;
+
+            // Batches end on extent boundaries so whole extents can be stored
+            let extent_size = self.chunks.extent_size();
+            let batch = (chunk_size * COPY_BATCH_CHUNKS).div_ceil(extent_size) * extent_size;
+            let mut size = len;
+            'copy: for (start, end) in ranges {
+                let mut offset = start;
+                while offset < end {
+                    let want = std::cmp::min(batch - offset % batch, end - offset);
+                    let data = src.pread(offset, want).await?;
+                    metrics::copied_up(data.len() as u64);
+                    self.chunks
+                        .write_run(&self.conn, ino, offset / chunk_size, &data)
+                        .await?;
+                    offset += data.len() as u64;
+                    if (data.len() as u64) < want {
+                        // Source got shorter while we were copying
+                        size = offset;
+                        break 'copy;
+                    }
+                }
+            }
+
+            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+            let mut stmt = self
+                .conn
+                .prepare_cached("UPDATE fs_inode SET mode = ?, size = ?, mtime = ? WHERE ino = ?")
+                .await?;
+            stmt.execute((DEFAULT_FILE_MODE as i64, size as i64, now, ino))
+                .await?;
+
+            Ok(ino)
+        }
+        .await;
+
+        match result {
+            Ok(ino) => {
+                self.conn
+                    .prepare_cached("COMMIT")
+                    .await?
+                    .execute(())
+                    .await?;
+                // Readers may have missed the entry until now
+                self.dentry_cache.forget_missing(parent_ino, name);
+                self.attr_cache.invalidate(ino);
+                Ok(())
+            }
+            Err(e) => {
+                let _ = self
+                    .conn
+                    .prepare_cached("ROLLBACK")
+                    .await?
+                    .execute(())
+                    .await;
+                Err(e)
+            }
+        }
+    }
+
+    /// Create a new empty file with the specified mode.
+    ///
+    /// This is an optimized path for FUSE create() that combines inode creation,
+    /// dentry creation, and file handle opening in a single operation.
+    /// Returns both Stats and an open file handle.
+    pub async fn create_file(&self, path: &str, mode: u32) -> Result<(Stats, BoxedFile)> {
+        let _writer = self.writer.lock().await?;
+        let path = self.normalize_path(path);
+        let components = self.split_path(&path);
+
+        if components.is_empty() {
+            return Err(FsError::RootOperation.into());
+        }
+
+        let parent_path = match components.len() {
+            1 => "/".to_string(),
+            _ => format!("/{}", components[..components.len() - 1].join("/")),
+        };
+
+        let parent_ino = self
+            .resolve_path(&parent_path)
+            .await?
+            .ok_or(FsError::NotFound)?;
+
+        let name = components.last().unwrap();
+
+        if self.lookup_child(parent_ino, name).await?.is_some() {
+            return Err(FsError::AlreadyExists.into());
+        }
+
+        // Prepare statements before starting the transaction
+        let mut inode_stmt = self
+            .conn
+            .prepare_cached(
+                "INSERT INTO fs_inode (mode, nlink, uid, gid, size, atime, mtime, ctime)
+                 VALUES (?, 1, 0, 0, 0, ?, ?, ?) RETURNING ino",
+            )
+            .await?;
+        let mut dentry_stmt = self
+            .conn
+            .prepare_cached("INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)")
+            .await?;
+
+        self.conn
+            .prepare_cached("BEGIN IMMEDIATE")
+            .await?
+            .execute(())
+            .await?;
+        metrics::transaction();
+
+        let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+        let file_mode = S_IFREG | (mode & 0o7777);
+
+        let row = inode_stmt
+            .query_row((file_mode as i64, now, now, now))
+            .await?;
+
+        let ino = row
+            .get_value(0)
+            .ok()
+            .and_then(|v| v.as_integer().copied())
+            .ok_or_else(|| Error::Internal("failed to get inode".to_string()))?;
+
+        dentry_stmt
+            .execute((name.as_str(), parent_ino, ino))
+            .await?;
+
+        self.conn
+            .prepare_cached("COMMIT")
+            .await?
+            .execute(())
+            .await?;
+
+        self.dentry_cache.insert(parent_ino, name, ino);
+
+        let stats = Stats {
+            ino,
+            mode: file_mode,
+            nlink: 1,
+            uid: 0,
+            gid: 0,
+            size: 0,
+            atime: now,
+            mtime: now,
+            ctime: now,
+        };
+
+        let file: BoxedFile = Arc::new(self.file_handle(ino));
+
+        Ok((stats, file))
+    }
+
+    /// Read data from a file
+    pub async fn read_file(&self, path: &str) -> Result<Option<Vec<u8>>> {
+        let _buffer = self.lock_buffer(path).await?;
+        let ino = match self.resolve_path_read(path).await? {
+            Some(ino) => ino,
+            None => return Ok(None),
+        };
+
+        let chunks = self.chunks.read_all(&self.readers.get(), ino).await?;
+
+        let mut data = Vec::new();
+        for (_, chunk) in chunks {
+            data.extend_from_slice(&chunk);
+        }
+
+        Ok(Some(data))
+    }
+
+    /// Reads from a file at a given offset.
+    ///
+    /// Similar to POSIX `pread`, this reads up to `size` bytes from the file
+    /// starting at `offset`, without modifying any file cursor.
+    ///
+    /// Returns `Ok(None)` if the file does not exist.
+    pub async fn pread(&self, path: &str, offset: u64, size: u64) -> Result<Option<Vec<u8>>> {
+        let _buffer = self.lock_buffer(path).await?;
+        let ino = match self.resolve_path_read(path).await? {
+            Some(ino) => ino,
+            None => return Ok(None),
+        };
+
+        // Calculate which chunks we need
+        let chunk_size = self.chunk_size as u64;
+        let start_chunk = offset / chunk_size;
+        let end_chunk = (offset + size).saturating_sub(1) / chunk_size;
+
+        let chunks = self
+            .chunks
+            .read_range(&self.readers.get(), ino, start_chunk, end_chunk)
+            .await?;
+
+        // Stop after the last stored byte, zero-filling holes before it
+        let mut result = vec![0u8; size as usize];
+        let mut filled = 0;
+        for (chunk_index, chunk_data) in chunks {
+            let end = copy_overlap(&mut result, offset, chunk_index * chunk_size, &chunk_data);
+            filled = std::cmp::max(filled, end);
+        }
+        result.truncate(filled);
+
+        Ok(Some(result))
+    }
+
+    /// Writes to a file at a given offset.
+    ///
+    /// Similar to POSIX `pwrite`, this writes `data` to the file starting at
+    /// `offset`, without modifying any file cursor.
+    ///
+    /// If the offset is beyond the current file size, the file is extended with zeros.
+    /// If the file does not exist, it will be created.
+    pub async fn pwrite(&self, path: &str, offset: u64, data: &[u8]) -> Result<()> {
+        let _buffer = self.lock_buffer(path).await?;
+        let _writer = self.writer.lock().await?;
+        let path = self.normalize_path(path);
+        let components = self.split_path(&path);
+
+        if components.is_empty() {
+            return Err(FsError::RootOperation.into());
+        }
+
+        let parent_path = if components.len() == 1 {
+            "/".to_string()
+        } else {
+            format!("/{}", components[..components.len() - 1].join("/"))
+        };
+
+        let parent_ino = self
+            .resolve_path(&parent_path)
+            .await?
+            .ok_or(FsError::NotFound)?;
+
+        let name = components.last().unwrap();
+
+        self.conn
+            .prepare_cached("BEGIN IMMEDIATE")
+            .await?
+            .execute(())
+            .await?;
+        metrics::transaction();
+
+        let result: Result<i64> = async {
+            // Get or create the inode
+            let (ino, current_size) = if let Some(ino) = self.resolve_path(&path).await? {
+                // Get current file size
+                let mut stmt = self
+                    .conn
+                    .prepare_cached("SELECT size FROM fs_inode WHERE ino = ?")
+                    .await?;
+                let mut rows = stmt.query((ino,)).await?;
+                let size = if let Some(row) = rows.next().await? {
+                    row.get_value(0)
+                        .ok()
+                        .and_then(|v| v.as_integer().copied())
+                        .unwrap_or(0) as u64
+                } else {
+                    0
+                };
+                (ino, size)
+            } else {
+                // Create new inode
+                let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+                let mut stmt = self
+                    .conn
+                    .prepare(
+                        "INSERT INTO fs_inode (mode, uid, gid, size, atime, mtime, ctime)
+                        VALUES (?, 0, 0, 0, ?, ?, ?) RETURNING ino",
+                    )
+                    .await?;
+                let row = stmt
+                    .query_row((DEFAULT_FILE_MODE as i64, now, now, now))
+                    .await?;
+
+                let ino = row
+                    .get_value(0)
+                    .ok()
+                    .and_then(|v| v.as_integer().copied())
+                    .ok_or_else(|| Error::Internal("failed to get inode".to_string()))?;
+
+                // Create directory entry
+                let mut stmt = self
+                    .conn
+                    .prepare_cached(
+                        "INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)",
+                    )
+                    .await?;
+                stmt.execute((name.as_str(), parent_ino, ino)).await?;
+
+                // Increment link count
+                let mut stmt = self
+                    .conn
+                    .prepare_cached("UPDATE fs_inode SET nlink = nlink + 1 WHERE ino = ?")
+                    .await?;
+                stmt.execute((ino,)).await?;
+
+                (ino, 0)
+            };
+
+            // Handle empty writes - just update mtime
+            if data.is_empty() {
+                let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+                self.conn
+                    .prepare_cached("UPDATE fs_inode SET mtime = ? WHERE ino = ?")
+                    .await?
+                    .execute((now, ino))
+                    .await?;
+                return Ok(ino);
+            }
+
+            let chunk_size = self.chunk_size as u64;
+            let write_end = offset + data.len() as u64;
+
+            // Calculate affected chunk range
+            let start_chunk = offset / chunk_size;
+            let end_chunk = (write_end - 1) / chunk_size;
+
+            // Process each affected chunk
+            for chunk_idx in start_chunk..=end_chunk {
+                let chunk_start = chunk_idx * chunk_size;
+
+                // Calculate what part of data goes into this chunk
+                let data_start = if offset > chunk_start {
+                    (offset - chunk_start) as usize
+                } else {
+                    0
+                };
+                let data_end =
+                    std::cmp::min(chunk_size as usize, (write_end - chunk_start) as usize);
+
+                // Calculate what part of data to copy
+                let src_start = if chunk_start > offset {
+                    (chunk_start - offset) as usize
+                } else {
+                    0
+                };
+                let src_end = std::cmp::min(data.len(), src_start + (data_end - data_start));
+
+                // Read existing chunk if we need to preserve some data
+                let needs_read = data_start > 0 || data_end < chunk_size as usize;
+                let mut chunk_data = if needs_read {
+                    match self.chunks.read(&self.conn, ino, chunk_idx).await? {
+                        Some(mut v) => {
+                            v.resize(chunk_size as usize, 0);
+                            v
+                        }
+                        None => vec![0u8; chunk_size as usize],
+                    }
+                } else {
+                    vec![0u8; chunk_size as usize]
+                };
+
+                // Copy the new data into the chunk
+                chunk_data[data_start..data_end].copy_from_slice(&data[src_start..src_end]);
+
+                // Trim trailing zeros for the last chunk
+                let actual_len = if chunk_idx == end_chunk {
+                    let file_end_in_chunk = (write_end - chunk_start) as usize;
+                    let old_end_in_chunk = if current_size > chunk_start {
+                        std::cmp::min((current_size - chunk_start) as usize, chunk_size as usize)
+                    } else {
+                        0
+                    };
+                    std::cmp::max(file_end_in_chunk, old_end_in_chunk)
+                } else {
+                    chunk_size as usize
+                };
+
+                // Write the chunk, replacing the existing one
+                self.chunks
+                    .write(&self.conn, ino, chunk_idx, &chunk_data[..actual_len])
+                    .await?;
+            }
+
+            // Update size and mtime
+            let new_size = std::cmp::max(current_size, write_end);
+            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+            let mut stmt = self
+                .conn
+                .prepare_cached("UPDATE fs_inode SET size = ?, mtime = ? WHERE ino = ?")
+                .await?;
+            stmt.execute((new_size as i64, now, ino)).await?;
+
+            Ok(ino)
+        }
+        .await;
+
+        match result {
+            Ok(ino) => {
+                self.conn
+                    .prepare_cached("COMMIT")
+                    .await?
+                    .execute(())
+                    .await?;
+                // Readers may have missed the entry until now
+                self.dentry_cache.forget_missing(parent_ino, name);
+                self.attr_cache.invalidate(ino);
+                Ok(())
+            }
+            Err(e) => {
+                let _ = self
+                    .conn
+                    .prepare_cached("ROLLBACK")
+                    .await?
+                    .execute(())
+                    .await;
+                Err(e)
+            }
+        }
+    }
+
+    /// Truncate a file to a specific size.
+    ///
+    /// This operates directly on chunks without loading the entire file into memory:
+    /// - Shrinking: deletes chunks beyond new size, truncates the last chunk if needed
+    /// - Extending: pads with zeros up to the new size
+    pub async fn truncate(&self, path: &str, new_size: u64) -> Result<()> {
+        let _buffer = self.lock_buffer(path).await?;
+        let _writer = self.writer.lock().await?;
+        let path = self.normalize_path(path);
+        let ino = self.resolve_path(&path).await?.ok_or(FsError::NotFound)?;
+
+        // Get current size
+        let mut stmt = self
+            .conn
+            .prepare_cached("SELECT size FROM fs_inode WHERE ino = ?")
+            .await?;
+        let mut rows = stmt.query((ino,)).await?;
+        let current_size = if let Some(row) = rows.next().await? {
+            row.get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u64
+        } else {
+            0
+        };
+
+        let chunk_size = self.chunk_size as u64;
+
+        self.conn
+            .prepare_cached("BEGIN IMMEDIATE")
+            .await?
+            .execute(())
+            .await?;
+        metrics::transaction();
+
+        let result: Result<()> = async {
+            if new_size == 0 {
+                // Special case: truncate to zero - just delete all chunks
+                self.chunks.delete_from(&self.conn, ino, 0).await?;
+            } else if new_size < current_size {
+                // Shrinking: delete excess chunks and truncate last chunk if needed
+                let last_chunk_idx = (new_size - 1) / chunk_size;
+
+                // Delete all chunks beyond the last one we need
+                self.chunks
+                    .delete_from(&self.conn, ino, last_chunk_idx + 1)
+                    .await?;
+
+                // Calculate where in the last chunk the file should end
+                let end_in_last_chunk = ((new_size - 1) % chunk_size) + 1;
+
+                // If the last chunk needs to be truncated (not a full chunk),
+                // read it, truncate, and rewrite
+                if end_in_last_chunk < chunk_size {
+                    if let Some(chunk_data) =
+                        self.chunks.read(&self.conn, ino, last_chunk_idx).await?
+                    {
+                        if chunk_data.len() > end_in_last_chunk as usize {
+                            let truncated = &chunk_data[..end_in_last_chunk as usize];
+                            self.chunks
+                                .write(&self.conn, ino, last_chunk_idx, truncated)
+                                .await?;
+                        }
+                    }
+                }
+            } else if new_size > current_size {
+                // Extending: pad last existing chunk and add zero chunks as needed
+                let last_existing_chunk = if current_size == 0 {
+                    None
+                } else {
+                    Some((current_size - 1) / chunk_size)
+                };
+                let last_new_chunk = (new_size - 1) / chunk_size;
+
+                // Pad the last existing chunk with zeros if it's not full
+                if let Some(last_idx) = last_existing_chunk {
+                    if let Some(chunk_data) = self.chunks.read(&self.conn, ino, last_idx).await? {
+                        let current_chunk_len = chunk_data.len();
+                        let needed_len = if last_idx == last_new_chunk {
+                            // Last existing chunk is also the last new chunk
+                            ((new_size - 1) % chunk_size + 1) as usize
+                        } else {
+                            // Need to fill this chunk completely
+                            chunk_size as usize
+                        };
+
+                        if needed_len > current_chunk_len {
+                            let mut padded = chunk_data;
+                            padded.resize(needed_len, 0);
+                            self.chunks
+                                .write(&self.conn, ino, last_idx, &padded)
+                                .await?;
+                        }
+                    }
+                }
+
+                // Add new zero-filled chunks if needed
+                let start_new_chunk = last_existing_chunk.map(|i| i + 1).unwrap_or(0);
+                for chunk_idx in start_new_chunk..=last_new_chunk {
+                    let chunk_len = if chunk_idx == last_new_chunk {
+                        ((new_size - 1) % chunk_size + 1) as usize
+                    } else {
+                        chunk_size as usize
+                    };
+                    let zeros = vec![0u8; chunk_len];
+                    self.chunks
+                        .write(&self.conn, ino, chunk_idx, &zeros)
+                        .await?;
+                }
+            }
+            // else: new_size == current_size, nothing to do for data
+
+            // Update size and mtime
+            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+            let mut stmt = self
+                .conn
+                .prepare_cached("UPDATE fs_inode SET size = ?, mtime = ? WHERE ino = ?")
+                .await?;
+            stmt.execute((new_size as i64, now, ino)).await?;
+
+            Ok(())
+        }
+        .await;
+
+        match result {
+            Ok(()) => {
+                self.conn
+                    .prepare_cached("COMMIT")
+                    .await?
+                    .execute(())
+                    .await?;
+                self.attr_cache.invalidate(ino);
+                Ok(())
+            }
+            Err(e) => {
+                let _ = self
+                    .conn
+                    .prepare_cached("ROLLBACK")
+                    .await?
+                    .execute(())
+                    .await;
+                Err(e)
+            }
+        }
+    }
+
+    /// List directory contents
+    pub async fn readdir(&self, path: &str) -> Result<Option<Vec<String>>> {
+        let _timer = metrics::timer(Op::Readdir, Layer::Delta);
+        let ino = match self.resolve_path_read(path).await? {
+            Some(ino) => ino,
+            None => return Ok(None),
+        };
+
+        let mut rows = self
+            .readers
+            .get()
+            .query(
+                "SELECT name FROM fs_dentry WHERE parent_ino = ? ORDER BY name",
+                (ino,),
+            )
+            .await?;
+
+        let mut entries = Vec::new();
+        while let Some(row) = rows.next().await? {
+            let name = row
+                .get_value(0)
+                .ok()
+                .and_then(|v| {
+                    if let Value::Text(s) = v {
+                        Some(s.clone())
+                    } else {
+                        None
+                    }
+                })
+                .unwrap_or_default();
+            if !name.is_empty() {
+                entries.push(name);
+            }
+        }
+
+        Ok(Some(entries))
+    }
+
+    /// List directory contents with full statistics (optimized batch query)
+    ///
+    /// Returns entries with their stats in a single JOIN query, avoiding N+1 queries.
+    pub async fn readdir_plus(&self, path: &str) -> Result<Option<Vec<DirEntry>>> {
+        let _timer = metrics::timer(Op::Readdir, Layer::Delta);
+        let ino = match self.resolve_path_read(path).await? {
+            Some(ino) => ino,
+            None => return Ok(None),
+        };
+
+        Ok(Some(self.list_entries(ino).await?))
+    }
+
+    /// Fetch all entries of a directory inode with their stats
+    async fn list_entries(&self, ino: i64) -> Result<Vec<DirEntry>> {
+        let generation = self.attr_cache.generation();
+        // Single JOIN query to get all entry names and their stats (including link count)
+        let mut rows = self
+            .readers
+            .get()
+            .query(
+                "SELECT d.name, i.ino, i.mode, i.nlink, i.uid, i.gid, i.size, i.atime, i.mtime, i.ctime
+                 FROM fs_dentry d
+                 JOIN fs_inode i ON d.ino = i.ino
+                 WHERE d.parent_ino = ?
+                 ORDER BY d.name",
+                (ino,),
+            )
+            .await?;
+
+        let mut entries = Vec::new();
+        while let Some(row) = rows.next().await? {
+            if let Some(entry) = Self::build_dir_entry_from_row(&row) {
+                entries.push(entry);
+            }
+        }
+        fill_caches(
+            &self.dentry_cache,
+            &self.attr_cache,
+            ino,
+            &entries,
+            generation,
+        );
+        for entry in &mut entries {
+            self.write_buffers.apply(&mut entry.stats).await;
+        }
+
+        Ok(entries)
+    }
+
+    /// Build a directory entry from a `name, ino, mode, nlink, uid, gid,
+    /// size, atime, mtime, ctime` row, skipping rows without a name
+    fn build_dir_entry_from_row(row: &turso::Row) -> Option<DirEntry> {
+        let name = row
+            .get_value(0)
+            .ok()
+            .and_then(|v| {
+                if let Value::Text(s) = v {
+                    Some(s.clone())
+                } else {
+                    None
+                }
+            })
+            .unwrap_or_default();
+
+        if name.is_empty() {
+            return None;
+        }
+
+        let entry_ino = row
+            .get_value(1)
+            .ok()
+            .and_then(|v| v.as_integer().copied())
+            .unwrap_or(0);
+
+        let nlink = row
+            .get_value(3)
+            .ok()
+            .and_then(|v| v.as_integer().copied())
+            .unwrap_or(1) as u32;
+
+        let stats = Stats {
+            ino: entry_ino,
+            mode: row
+                .get_value(2)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u32,
+            nlink,
+            uid: row
+                .get_value(4)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u32,
+            gid: row
+                .get_value(5)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u32,
+            size: row
+                .get_value(6)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0),
+            atime: row
+                .get_value(7)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0),
+            mtime: row
+                .get_value(8)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0),
+            ctime: row
+                .get_value(9)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0),
+        };
+
+        Some(DirEntry { name, stats })
+    }
+
+    /// Create a symbolic link
+    pub async fn symlink(&self, target: &str, linkpath: &str) -> Result<()> {
+        let _writer = self.writer.lock().await?;
+        let linkpath = self.normalize_path(linkpath);
+        let components = self.split_path(&linkpath);
+
+        if components.is_empty() {
+            return Err(FsError::RootOperation.into());
+        }
+
+        // Get parent directory
+        let parent_path = if components.len() == 1 {
+            "/".to_string()
+        } else {
+            format!("/{}", components[..components.len() - 1].join("/"))
+        };
+
+        let parent_ino = self
+            .resolve_path(&parent_path)
+            .await?
+            .ok_or(FsError::NotFound)?;
+
+        let name = components.last().unwrap();
+
+        // Check if entry already exists (single query using parent_ino we already have)
+        if self.lookup_child(parent_ino, name).await?.is_some() {
+            return Err(FsError::AlreadyExists.into());
+        }
+
+        // Create inode for symlink
+        let now = SystemTime::now()
+            .duration_since(UNIX_EPOCH)
+            .unwrap()
+            .as_secs() as i64;
+
+        let mode = S_IFLNK | 0o777; // Symlinks typically have 777 permissions
+        let size = target.len() as i64;
+
+        let mut stmt = self
+            .conn
+            .prepare(
+                "INSERT INTO fs_inode (mode, uid, gid, size, atime, mtime, ctime)
+                 VALUES (?, 0, 0, ?, ?, ?, ?) RETURNING ino",
+            )
+            .await?;
+        let row = stmt.query_row((mode, size, now, now, now)).await?;
+
+        // Get the newly created inode
+        let ino = row
+            .get_value(0)
+            .ok()
+            .and_then(|v| v.as_integer().copied())
+            .unwrap_or(0);
+
+        // Store symlink target
         self.conn
-            .prepare_cached("BEGIN IMMEDIATE")
+            .execute(
+                "INSERT INTO fs_symlink (ino, target) VALUES (?, ?)",
+                (ino, target),
+            )
+            .await?;
+
+        // Create directory entry
+        self.conn
+            .execute(
+                "INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)",
+                (name.as_str(), parent_ino, ino),
+            )
+            .await?;
+
+        // Increment link count
+        let _invalidate = self.attr_cache.invalidate_on_drop(ino);
+        self.conn
+            .execute(
+                "UPDATE fs_inode SET nlink = nlink + 1 WHERE ino = ?",
+                (ino,),
+            )
+            .await?;
+
+        // Populate dentry cache
+        self.dentry_cache.insert(parent_ino, name, ino);
+
+        Ok(())
+    }
+
+    /// Create a hard link
+    ///
+    /// Creates a new directory entry `newpath` that refers to the same inode as `oldpath`.
+    /// Both paths will share the same file data and metadata (except for the name).
+    /// The link count (nlink) of the inode is incremented.
+    pub async fn link(&self, oldpath: &str, newpath: &str) -> Result<()> {
+        let _writer = self.writer.lock().await?;
+        let oldpath = self.normalize_path(oldpath);
+        let newpath = self.normalize_path(newpath);
+        let components = self.split_path(&newpath);
+
+        if components.is_empty() {
+            return Err(FsError::RootOperation.into());
+        }
+
+        // Resolve old path to get its inode
+        let ino = self
+            .resolve_path(&oldpath)
             .await?
-            .execute(())
+            .ok_or(FsError::NotFound)?;
+
+        // Check if source is a directory (hard links to directories are not allowed)
+        let mut rows = self
+            .conn
+            .query("SELECT mode FROM fs_inode WHERE ino = ?", (ino,))
+            .await?;
+
+        if let Some(row) = rows.next().await? {
+            let mode = row
+                .get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u32;
+
+            if (mode & S_IFMT) == super::S_IFDIR {
+                return Err(FsError::IsADirectory.into());
+            }
+        } else {
+            return Err(FsError::NotFound.into());
+        }
+
+        // Get parent directory of new path
+        let parent_path = if components.len() == 1 {
+            "/".to_string()
+        } else {
+            format!("/{}", components[..components.len() - 1].join("/"))
+        };
+
+        let parent_ino = self
+            .resolve_path(&parent_path)
+            .await?
+            .ok_or(FsError::NotFound)?;
+
+        let name = components.last().unwrap();
+
+        // Check if new path already exists (single query using parent_ino we already have)
+        if self.lookup_child(parent_ino, name).await?.is_some() {
+            return Err(FsError::AlreadyExists.into());
+        }
+
+        // Create directory entry pointing to the same inode
+        self.conn
+            .execute(
+                "INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)",
+                (name.as_str(), parent_ino, ino),
+            )
+            .await?;
+
+        // Increment link count
+        let _invalidate = self.attr_cache.invalidate_on_drop(ino);
+        self.conn
+            .execute(
+                "UPDATE fs_inode SET nlink = nlink + 1 WHERE ino = ?",
+                (ino,),
+            )
             .await?;
 
-        let result: Result<()> = async {
-            // Check if file exists (single query using parent_ino we already have)
-            let ino = if let Some(ino) = self.lookup_child(parent_ino, name).await? {
-                // Delete existing data
-                let mut stmt = self
-                    .conn
-                    .prepare_cached("DELETE FROM fs_data WHERE ino = ?")
-                    .await?;
-                stmt.execute((ino,)).await?;
-                ino
-            } else {
-                // Create new inode
-                let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
-                let mut stmt = self
-                    .conn
-                    .prepare(
-                        "INSERT INTO fs_inode (mode, uid, gid, size, atime, mtime, ctime)
-                        VALUES (?, 0, 0, ?, ?, ?, ?) RETURNING ino",
-                    )
-                    .await?;
-                let row = stmt
-                    .query_row((DEFAULT_FILE_MODE as i64, data.len() as i64, now, now, now))
-                    .await?;
+        // Populate dentry cache
+        self.dentry_cache.insert(parent_ino, name, ino);
 
-                let ino = row
-                    .get_value(0)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .ok_or_else(|| Error::Internal("failed to get inode".to_string()))?;
+        Ok(())
+    }
 
-                // Create directory entry
-                let mut stmt = self
-                    .conn
-                    .prepare_cached(
-                        "INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)",
-                    )
-                    .await?;
-                stmt.execute((name.as_str(), parent_ino, ino)).await?;
+    /// Read the target of a symbolic link
+    pub async fn readlink(&self, path: &str) -> Result<Option<String>> {
+        let path = self.normalize_path(path);
 
-                // Increment link count
-                let mut stmt = self
-                    .conn
-                    .prepare_cached("UPDATE fs_inode SET nlink = nlink + 1 WHERE ino = ?")
-                    .await?;
-                stmt.execute((ino,)).await?;
+        let ino = match self.resolve_path_read(&path).await? {
+            Some(ino) => ino,
+            None => return Ok(None),
+        };
 
-                // Populate dentry cache for new file
-                self.dentry_cache.insert(parent_ino, name, ino);
+        // Check if it's a symlink by querying the inode
+        let mut rows = self
+            .readers
+            .get()
+            .query("SELECT mode FROM fs_inode WHERE ino = ?", (ino,))
+            .await?;
 
-                ino
-            };
+        if let Some(row) = rows.next().await? {
+            let mode = row
+                .get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u32;
 
-            // Write data in chunks
-            for (chunk_index, chunk) in data.chunks(self.chunk_size).enumerate() {
-                self.conn
-                    .execute(
-                        "INSERT INTO fs_data (ino, chunk_index, data) VALUES (?, ?, ?)",
-                        (ino, chunk_index as i64, chunk),
-                    )
-                    .await?;
+            // Check if it's a symlink
+            if (mode & S_IFMT) != S_IFLNK {
+                return Err(FsError::NotASymlink.into());
             }
-
-            // Update mode (to regular file), size and mtime
-            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
-            let mut stmt = self
-                .conn
-                .prepare_cached("UPDATE fs_inode SET mode = ?, size = ?, mtime = ? WHERE ino = ?")
-                .await?;
-            stmt.execute((DEFAULT_FILE_MODE as i64, data.len() as i64, now, ino))
-                .await?;
-
-            Ok(())
+        } else {
+            return Ok(None);
         }
-        .await;
 
-        match result {
-            Ok(()) => {
-                self.conn
-                    .prepare_cached("COMMIT")
-                    .await?
-                    .execute(())
-                    .await?;
-                Ok(())
-            }
-            Err(e) => {
-                let _ = self
-                    .conn
-                    .prepare_cached("ROLLBACK")
-                    .await?
-                    .execute(())
-                    .await;
-                Err(e)
-            }
+        // Read target from fs_symlink table
+        let mut rows = self
+            .readers
+            .get()
+            .query("SELECT target FROM fs_symlink WHERE ino = ?", (ino,))
+            .await?;
+
+        if let Some(row) = rows.next().await? {
+            let target = row
+                .get_value(0)
+                .ok()
+                .and_then(|v| match v {
+                    Value::Text(s) => Some(s.to_string()),
+                    _ => None,
+                })
+                .ok_or(FsError::InvalidPath)?;
+            Ok(Some(target))
+        } else {
+            Ok(None)
         }
     }
 
-    /// Create a new empty file with the specified mode.
-    ///
-    /// This is an optimized path for FUSE create() that combines inode creation,
-    /// dentry creation, and file handle opening in a single operation.
-    /// Returns both Stats and an open file handle.
-    pub async fn create_file(&self, path: &str, mode: u32) -> Result<(Stats, BoxedFile)> {
+    /// Remove a file or empty directory
+    pub async fn remove(&self, path: &str) -> Result<()> {
+        let _writer = self.writer.lock().await?;
         let path = self.normalize_path(path);
         let components = self.split_path(&path);
 
@@ -1057,9 +2976,35 @@ impl AgentFS {
             return Err(FsError::RootOperation.into());
         }
 
-        let parent_path = match components.len() {
-            1 => "/".to_string(),
-            _ => format!("/{}", components[..components.len() - 1].join("/")),
+        let ino = self.resolve_path(&path).await?.ok_or(FsError::NotFound)?;
+
+        if ino == ROOT_INO {
+            return Err(FsError::RootOperation.into());
+        }
+
+        // Check if directory is empty
+        let mut stmt = self
+            .conn
+            .prepare_cached("SELECT COUNT(*) FROM fs_dentry WHERE parent_ino = ?")
+            .await?;
+        let mut rows = stmt.query((ino,)).await?;
+
+        if let Some(row) = rows.next().await? {
+            let count = row
+                .get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0);
+            if count > 0 {
+                return Err(FsError::NotEmpty.into());
+            }
+        }
+
+        // Get parent directory and name
+        let parent_path = if components.len() == 1 {
+            "/".to_string()
+        } else {
+            format!("/{}", components[..components.len() - 1].join("/"))
         };
 
         let parent_ino = self
@@ -1069,353 +3014,282 @@ impl AgentFS {
 
         let name = components.last().unwrap();
 
-        if self.lookup_child(parent_ino, name).await?.is_some() {
-            return Err(FsError::AlreadyExists.into());
-        }
-
-        // Prepare statements before starting the transaction
-        let mut inode_stmt = self
-            .conn
-            .prepare_cached(
-                "INSERT INTO fs_inode (mode, nlink, uid, gid, size, atime, mtime, ctime)
-                 VALUES (?, 1, 0, 0, 0, ?, ?, ?) RETURNING ino",
-            )
-            .await?;
-        let mut dentry_stmt = self
+        // Delete the specific directory entry (not all entries pointing to this inode)
+        let mut stmt = self
             .conn
-            .prepare_cached("INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)")
-            .await?;
-
-        self.conn
-            .prepare_cached("BEGIN IMMEDIATE")
-            .await?
-            .execute(())
+            .prepare_cached("DELETE FROM fs_dentry WHERE parent_ino = ? AND name = ?")
             .await?;
+        stmt.execute((parent_ino, name.as_str())).await?;
 
-        let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
-        let file_mode = S_IFREG | (mode & 0o7777);
+        // Invalidate cache for this entry
+        self.dentry_cache.remove(parent_ino, name);
 
-        let row = inode_stmt
-            .query_row((file_mode as i64, now, now, now))
+        // Decrement link count
+        let _invalidate = self.attr_cache.invalidate_on_drop(ino);
+        let mut stmt = self
+            .conn
+            .prepare_cached("UPDATE fs_inode SET nlink = nlink - 1 WHERE ino = ?")
             .await?;
+        stmt.execute((ino,)).await?;
 
-        let ino = row
-            .get_value(0)
-            .ok()
-            .and_then(|v| v.as_integer().copied())
-            .ok_or_else(|| Error::Internal("failed to get inode".to_string()))?;
+        // Check if this was the last link to the inode
+        let link_count = self.get_link_count(ino).await?;
+        if link_count == 0 {
+            // Manually handle cascading deletes since we don't use foreign keys
+            // Delete data blocks
+            self.chunks.delete_from(&self.conn, ino, 0).await?;
 
-        dentry_stmt
-            .execute((name.as_str(), parent_ino, ino))
-            .await?;
+            // Delete symlink if exists
+            let mut stmt = self
+                .conn
+                .prepare_cached("DELETE FROM fs_symlink WHERE ino = ?")
+                .await?;
+            stmt.execute((ino,)).await?;
 
-        self.conn
-            .prepare_cached("COMMIT")
-            .await?
-            .execute(())
-            .await?;
+            // Delete inode
+            let mut stmt = self
+                .conn
+                .prepare_cached("DELETE FROM fs_inode WHERE ino = ?")
+                .await?;
+            stmt.execute((ino,)).await?;
+            self.write_buffers.discard(ino);
+        }
 
-        self.dentry_cache.insert(parent_ino, name, ino);
+        Ok(())
+    }
 
-        let stats = Stats {
-            ino,
-            mode: file_mode,
-            nlink: 1,
-            uid: 0,
-            gid: 0,
-            size: 0,
-            atime: now,
-            mtime: now,
-            ctime: now,
-        };
+    /// Change file mode/permissions.
+    ///
+    /// Only modifies the permission bits (lower 12 bits), preserving the file type.
+    pub async fn chmod(&self, path: &str, mode: u32) -> Result<()> {
+        let _writer = self.writer.lock().await?;
+        let path = self.normalize_path(path);
 
-        let file: BoxedFile = Arc::new(AgentFSFile {
-            conn: self.conn.clone(),
-            ino,
-            chunk_size: self.chunk_size,
-        });
+        let ino = self.resolve_path(&path).await?.ok_or(FsError::NotFound)?;
 
-        Ok((stats, file))
-    }
+        // Get current mode to preserve file type bits
+        let mut stmt = self
+            .conn
+            .prepare_cached("SELECT mode FROM fs_inode WHERE ino = ?")
+            .await?;
+        let mut rows = stmt.query((ino,)).await?;
 
-    /// Read data from a file
-    pub async fn read_file(&self, path: &str) -> Result<Option<Vec<u8>>> {
-        let ino = match self.resolve_path(path).await? {
-            Some(ino) => ino,
-            None => return Ok(None),
+        let current_mode = if let Some(row) = rows.next().await? {
+            row.get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u32
+        } else {
+            return Err(FsError::NotFound.into());
         };
 
-        let mut rows = self
+        // Preserve file type bits (upper bits), replace permission bits (lower 12 bits)
+        let new_mode = (current_mode & S_IFMT) | (mode & 0o7777);
+
+        let _invalidate = self.attr_cache.invalidate_on_drop(ino);
+        let mut stmt = self
             .conn
-            .query(
-                "SELECT data FROM fs_data WHERE ino = ? ORDER BY chunk_index",
-                (ino,),
-            )
+            .prepare_cached("UPDATE fs_inode SET mode = ? WHERE ino = ?")
             .await?;
+        stmt.execute((new_mode as i64, ino)).await?;
 
-        let mut data = Vec::new();
-        while let Some(row) = rows.next().await? {
-            if let Ok(Value::Blob(chunk)) = row.get_value(0) {
-                data.extend_from_slice(&chunk);
-            }
-        }
-
-        Ok(Some(data))
+        Ok(())
     }
 
-    /// Reads from a file at a given offset.
-    ///
-    /// Similar to POSIX `pread`, this reads up to `size` bytes from the file
-    /// starting at `offset`, without modifying any file cursor.
+    /// Rename/move a file or directory.
     ///
-    /// Returns `Ok(None)` if the file does not exist.
-    pub async fn pread(&self, path: &str, offset: u64, size: u64) -> Result<Option<Vec<u8>>> {
-        let ino = match self.resolve_path(path).await? {
-            Some(ino) => ino,
-            None => return Ok(None),
-        };
+    /// This operation is atomic - either all changes succeed or none do.
+    pub async fn rename(&self, from: &str, to: &str) -> Result<()> {
+        let _writer = self.writer.lock().await?;
+        let from_path = self.normalize_path(from);
+        let to_path = self.normalize_path(to);
 
-        // Calculate which chunks we need
-        let chunk_size = self.chunk_size as u64;
-        let start_chunk = offset / chunk_size;
-        let end_chunk = (offset + size).saturating_sub(1) / chunk_size;
+        // Cannot rename root
+        if from_path == "/" {
+            return Err(FsError::RootOperation.into());
+        }
 
-        let mut rows = self
-            .conn
-            .query(
-                "SELECT chunk_index, data FROM fs_data WHERE ino = ? AND chunk_index >= ? AND chunk_index <= ? ORDER BY chunk_index",
-                (ino, start_chunk as i64, end_chunk as i64),
-            )
-            .await?;
+        // Get source inode
+        let src_ino = self
+            .resolve_path(&from_path)
+            .await?
+            .ok_or(FsError::NotFound)?;
 
-        let mut result = Vec::with_capacity(size as usize);
-        let start_offset_in_chunk = (offset % chunk_size) as usize;
+        // Get source stats to check if it's a directory
+        let src_stats = self.stat(&from_path).await?.ok_or(FsError::NotFound)?;
 
-        while let Some(row) = rows.next().await? {
-            if let Ok(Value::Blob(chunk_data)) = row.get_value(1) {
-                let skip = if result.is_empty() {
-                    start_offset_in_chunk
-                } else {
-                    0
-                };
-                if skip >= chunk_data.len() {
-                    continue;
-                }
-                let remaining = size as usize - result.len();
-                let take = std::cmp::min(chunk_data.len() - skip, remaining);
-                result.extend_from_slice(&chunk_data[skip..skip + take]);
+        // Prevent renaming a directory into its own subtree (would create a cycle)
+        if src_stats.is_directory() {
+            let from_prefix = format!("{}/", from_path);
+            if to_path.starts_with(&from_prefix) || to_path == from_path {
+                return Err(FsError::InvalidRename.into());
             }
         }
 
-        Ok(Some(result))
-    }
-
-    /// Writes to a file at a given offset.
-    ///
-    /// Similar to POSIX `pwrite`, this writes `data` to the file starting at
-    /// `offset`, without modifying any file cursor.
-    ///
-    /// If the offset is beyond the current file size, the file is extended with zeros.
-    /// If the file does not exist, it will be created.
-    pub async fn pwrite(&self, path: &str, offset: u64, data: &[u8]) -> Result<()> {
-        let path = self.normalize_path(path);
-        let components = self.split_path(&path);
+        // Parse source path to get parent and name
+        let from_components = self.split_path(&from_path);
+        let src_name = from_components.last().ok_or(FsError::InvalidPath)?;
+        let src_parent_path = if from_components.len() == 1 {
+            "/".to_string()
+        } else {
+            format!(
+                "/{}",
+                from_components[..from_components.len() - 1].join("/")
+            )
+        };
+        let src_parent_ino = self
+            .resolve_path(&src_parent_path)
+            .await?
+            .ok_or(FsError::NotFound)?;
 
-        if components.is_empty() {
+        // Parse destination path to get parent and name
+        let to_components = self.split_path(&to_path);
+        if to_components.is_empty() {
             return Err(FsError::RootOperation.into());
         }
-
-        let parent_path = if components.len() == 1 {
+        let dst_name = to_components.last().unwrap();
+        let dst_parent_path = if to_components.len() == 1 {
             "/".to_string()
         } else {
-            format!("/{}", components[..components.len() - 1].join("/"))
+            format!("/{}", to_components[..to_components.len() - 1].join("/"))
         };
-
-        let parent_ino = self
-            .resolve_path(&parent_path)
+        let dst_parent_ino = self
+            .resolve_path(&dst_parent_path)
             .await?
             .ok_or(FsError::NotFound)?;
 
-        let name = components.last().unwrap();
+        // Clone strings for use inside the transaction closure
+        let src_name = src_name.clone();
+        let dst_name = dst_name.clone();
 
         self.conn
             .prepare_cached("BEGIN IMMEDIATE")
             .await?
             .execute(())
             .await?;
+        metrics::transaction();
 
-        let result: Result<()> = async {
-            // Get or create the inode
-            let (ino, current_size) = if let Some(ino) = self.resolve_path(&path).await? {
-                // Get current file size
-                let mut stmt = self
-                    .conn
-                    .prepare_cached("SELECT size FROM fs_inode WHERE ino = ?")
-                    .await?;
-                let mut rows = stmt.query((ino,)).await?;
-                let size = if let Some(row) = rows.next().await? {
-                    row.get_value(0)
-                        .ok()
-                        .and_then(|v| v.as_integer().copied())
-                        .unwrap_or(0) as u64
-                } else {
-                    0
-                };
-                (ino, size)
-            } else {
-                // Create new inode
-                let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
-                let mut stmt = self
-                    .conn
-                    .prepare(
-                        "INSERT INTO fs_inode (mode, uid, gid, size, atime, mtime, ctime)
-                        VALUES (?, 0, 0, 0, ?, ?, ?) RETURNING ino",
-                    )
-                    .await?;
-                let row = stmt
-                    .query_row((DEFAULT_FILE_MODE as i64, now, now, now))
-                    .await?;
-
-                let ino = row
-                    .get_value(0)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .ok_or_else(|| Error::Internal("failed to get inode".to_string()))?;
-
-                // Create directory entry
-                let mut stmt = self
-                    .conn
-                    .prepare_cached(
-                        "INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)",
-                    )
-                    .await?;
-                stmt.execute((name.as_str(), parent_ino, ino)).await?;
-
-                // Increment link count
-                let mut stmt = self
-                    .conn
-                    .prepare_cached("UPDATE fs_inode SET nlink = nlink + 1 WHERE ino = ?")
-                    .await?;
-                stmt.execute((ino,)).await?;
-
-                (ino, 0)
-            };
-
-            // Handle empty writes - just update mtime
-            if data.is_empty() {
-                let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
-                self.conn
-                    .prepare_cached("UPDATE fs_inode SET mtime = ? WHERE ino = ?")
-                    .await?
-                    .execute((now, ino))
-                    .await?;
-                return Ok(());
-            }
-
-            let chunk_size = self.chunk_size as u64;
-            let write_end = offset + data.len() as u64;
-
-            // Calculate affected chunk range
-            let start_chunk = offset / chunk_size;
-            let end_chunk = (write_end - 1) / chunk_size;
-
-            // Process each affected chunk
-            for chunk_idx in start_chunk..=end_chunk {
-                let chunk_start = chunk_idx * chunk_size;
+        let result: Result<Option<i64>> = async {
+            // Check if destination exists (inside transaction for atomicity)
+            let replaced = self.resolve_path(&to_path).await?;
+            if let Some(dst_ino) = replaced {
+                // stat() reads from the reader pool. Nothing has been changed in
+                // this transaction yet, so it sees the same state as the writer.
+                let dst_stats = self.stat(&to_path).await?.ok_or(FsError::NotFound)?;
 
-                // Calculate what part of data goes into this chunk
-                let data_start = if offset > chunk_start {
-                    (offset - chunk_start) as usize
-                } else {
-                    0
-                };
-                let data_end =
-                    std::cmp::min(chunk_size as usize, (write_end - chunk_start) as usize);
+                // Can't replace directory with non-directory
+                if dst_stats.is_directory() && !src_stats.is_directory() {
+                    return Err(FsError::IsADirectory.into());
+                }
 
-                // Calculate what part of data to copy
-                let src_start = if chunk_start > offset {
-                    (chunk_start - offset) as usize
-                } else {
-                    0
-                };
-                let src_end = std::cmp::min(data.len(), src_start + (data_end - data_start));
+                // Can't replace non-directory with directory
+                if !dst_stats.is_directory() && src_stats.is_directory() {
+                    return Err(FsError::NotADirectory.into());
+                }
 
-                // Read existing chunk if we need to preserve some data
-                let needs_read = data_start > 0 || data_end < chunk_size as usize;
-                let mut chunk_data = if needs_read {
-                    let mut rows = self
+                // If destination is directory, it must be empty
+                if dst_stats.is_directory() {
+                    let mut stmt = self
                         .conn
-                        .query(
-                            "SELECT data FROM fs_data WHERE ino = ? AND chunk_index = ?",
-                            (ino, chunk_idx as i64),
-                        )
+                        .prepare_cached("SELECT COUNT(*) FROM fs_dentry WHERE parent_ino = ?")
                         .await?;
-                    if let Some(row) = rows.next().await? {
-                        if let Ok(Value::Blob(data)) = row.get_value(0) {
-                            let mut v = data.clone();
-                            v.resize(chunk_size as usize, 0);
-                            v
-                        } else {
-                            vec![0u8; chunk_size as usize]
-                        }
-                    } else {
-                        vec![0u8; chunk_size as usize]
-                    }
-                } else {
-                    vec![0u8; chunk_size as usize]
-                };
-
-                // Copy the new data into the chunk
-                chunk_data[data_start..data_end].copy_from_slice(&data[src_start..src_end]);
+                    let mut rows = stmt.query((dst_ino,)).await?;
 
-                // Trim trailing zeros for the last chunk
-                let actual_len = if chunk_idx == end_chunk {
-                    let file_end_in_chunk = (write_end - chunk_start) as usize;
-                    let old_end_in_chunk = if current_size > chunk_start {
-                        std::cmp::min((current_size - chunk_start) as usize, chunk_size as usize)
-                    } else {
-                        0
-                    };
-                    std::cmp::max(file_end_in_chunk, old_end_in_chunk)
-                } else {
-                    chunk_size as usize
-                };
+                    if let Some(row) = rows.next().await? {
+                        let count = row
+                            .get_value(0)
+                            .ok()
+                            .and_then(|v| v.as_integer().copied())
+                            .unwrap_or(0);
+                        if count > 0 {
+                            return Err(FsError::NotEmpty.into());
+                        }
+                    }
+                }
 
-                // Write the chunk - delete existing then insert
-                self.conn
-                    .execute(
-                        "DELETE FROM fs_data WHERE ino = ? AND chunk_index = ?",
-                        (ino, chunk_idx as i64),
-                    )
+                // Remove destination entry
+                let mut stmt = self
+                    .conn
+                    .prepare_cached("DELETE FROM fs_dentry WHERE parent_ino = ? AND name = ?")
                     .await?;
-                self.conn
-                    .execute(
-                        "INSERT INTO fs_data (ino, chunk_index, data) VALUES (?, ?, ?)",
-                        (ino, chunk_idx as i64, &chunk_data[..actual_len]),
-                    )
+                stmt.execute((dst_parent_ino, dst_name.as_str())).await?;
+
+                // Decrement link count
+                let mut stmt = self
+                    .conn
+                    .prepare_cached("UPDATE fs_inode SET nlink = nlink - 1 WHERE ino = ?")
                     .await?;
+                stmt.execute((dst_ino,)).await?;
+
+                // Clean up destination inode if no more links
+                let link_count = self.get_link_count(dst_ino).await?;
+                if link_count == 0 {
+                    self.chunks.delete_from(&self.conn, dst_ino, 0).await?;
+                    let mut stmt = self
+                        .conn
+                        .prepare_cached("DELETE FROM fs_symlink WHERE ino = ?")
+                        .await?;
+                    stmt.execute((dst_ino,)).await?;
+                    let mut stmt = self
+                        .conn
+                        .prepare_cached("DELETE FROM fs_inode WHERE ino = ?")
+                        .await?;
+                    stmt.execute((dst_ino,)).await?;
+                    self.write_buffers.discard(dst_ino);
+                }
             }
 
-            // Update size and mtime
-            let new_size = std::cmp::max(current_size, write_end);
-            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
+            // Update the dentry: change parent and/or name
             let mut stmt = self
                 .conn
-                .prepare_cached("UPDATE fs_inode SET size = ?, mtime = ? WHERE ino = ?")
+                .prepare_cached(
+                    "UPDATE fs_dentry SET parent_ino = ?, name = ? WHERE parent_ino = ? AND name = ?",
+                )
                 .await?;
-            stmt.execute((new_size as i64, now, ino)).await?;
+            stmt.execute((
+                dst_parent_ino,
+                dst_name.as_str(),
+                src_parent_ino,
+                src_name.as_str(),
+            ))
+            .await?;
 
-            Ok(())
+            // Update ctime of the inode
+            let now = SystemTime::now()
+                .duration_since(UNIX_EPOCH)
+                .unwrap_or_default()
+                .as_secs() as i64;
+
+            let mut stmt = self
+                .conn
+                .prepare_cached("UPDATE fs_inode SET ctime = ? WHERE ino = ?")
+                .await?;
+            stmt.execute((now, src_ino)).await?;
+
+            Ok(replaced)
         }
         .await;
 
         match result {
-            Ok(()) => {
+            Ok(replaced) => {
                 self.conn
                     .prepare_cached("COMMIT")
                     .await?
                     .execute(())
                     .await?;
+
+                // Invalidate cache for source and destination
+                self.dentry_cache.remove(src_parent_ino, &src_name);
+                self.dentry_cache.remove(dst_parent_ino, &dst_name);
+
+                // Add new entry to cache (source inode is now at destination)
+                self.dentry_cache.insert(dst_parent_ino, &dst_name, src_ino);
+
+                self.attr_cache.invalidate(src_ino);
+                if let Some(dst_ino) = replaced {
+                    self.attr_cache.invalidate(dst_ino);
+                }
+
                 Ok(())
             }
             Err(e) => {
@@ -1430,22 +3304,36 @@ impl AgentFS {
         }
     }
 
-    /// Truncate a file to a specific size.
+    /// Get filesystem statistics
     ///
-    /// This operates directly on chunks without loading the entire file into memory:
-    /// - Shrinking: deletes chunks beyond new size, truncates the last chunk if needed
-    /// - Extending: pads with zeros up to the new size
-    pub async fn truncate(&self, path: &str, new_size: u64) -> Result<()> {
-        let path = self.normalize_path(path);
-        let ino = self.resolve_path(&path).await?.ok_or(FsError::NotFound)?;
+    /// Returns the total number of inodes and bytes used by file contents.
+    pub async fn statfs(&self) -> Result<FilesystemStats> {
+        // Count total inodes
+        let mut stmt = self
+            .readers
+            .get()
+            .prepare_cached("SELECT COUNT(*) FROM fs_inode")
+            .await?;
+        let mut rows = stmt.query(()).await?;
 
-        // Get current size
+        let inodes = if let Some(row) = rows.next().await? {
+            row.get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u64
+        } else {
+            0
+        };
+
+        // Sum total bytes used (from file sizes in inodes)
         let mut stmt = self
-            .conn
-            .prepare_cached("SELECT size FROM fs_inode WHERE ino = ?")
+            .readers
+            .get()
+            .prepare_cached("SELECT COALESCE(SUM(size), 0) FROM fs_inode")
             .await?;
-        let mut rows = stmt.query((ino,)).await?;
-        let current_size = if let Some(row) = rows.next().await? {
+        let mut rows = stmt.query(()).await?;
+
+        let bytes_used = if let Some(row) = rows.next().await? {
             row.get_value(0)
                 .ok()
                 .and_then(|v| v.as_integer().copied())
@@ -1454,2106 +3342,2424 @@ impl AgentFS {
             0
         };
 
-        let chunk_size = self.chunk_size as u64;
+        Ok(FilesystemStats { inodes, bytes_used })
+    }
 
-        self.conn
-            .prepare_cached("BEGIN IMMEDIATE")
-            .await?
-            .execute(())
-            .await?;
+    /// Synchronize file data to persistent storage
+    ///
+    /// Joins the next group commit: a transaction run with FULL synchronous
+    /// mode on behalf of every fsync queued since the previous one. This
+    /// ensures durability while maintaining high performance for normal
+    /// operations, and concurrent fsyncs share one sync.
+    ///
+    /// Note: The path parameter is ignored since all data is in a single database.
+    pub async fn fsync(&self, _path: &str) -> Result<()> {
+        self.group_commit.sync().await
+    }
 
-        let result: Result<()> = async {
-            if new_size == 0 {
-                // Special case: truncate to zero - just delete all chunks
-                let mut stmt = self
-                    .conn
-                    .prepare_cached("DELETE FROM fs_data WHERE ino = ?")
-                    .await?;
-                stmt.execute((ino,)).await?;
-            } else if new_size < current_size {
-                // Shrinking: delete excess chunks and truncate last chunk if needed
-                let last_chunk_idx = (new_size - 1) / chunk_size;
+    /// Set how long an fsync may wait for others to join its commit.
+    ///
+    /// Zero (the default) commits as soon as the previous group commit is
+    /// done; fsyncs arriving while a commit runs still share the next one.
+    /// A small window such as a millisecond trades single-fsync latency for
+    /// fewer syncs under many concurrent writers.
+    pub fn set_fsync_max_wait(&self, max_wait: Duration) {
+        self.group_commit.set_max_wait(max_wait);
+    }
 
-                // Delete all chunks beyond the last one we need
-                self.conn
-                    .execute(
-                        "DELETE FROM fs_data WHERE ino = ? AND chunk_index > ?",
-                        (ino, last_chunk_idx as i64),
-                    )
-                    .await?;
+    /// Open a file and return a file handle.
+    ///
+    /// The returned handle can be used for efficient read/write/fsync operations
+    /// without requiring path lookups on each operation.
+    pub async fn open(&self, path: &str) -> Result<BoxedFile> {
+        let path = self.normalize_path(path);
+        let ino = self.resolve_path(&path).await?.ok_or(FsError::NotFound)?;
 
-                // Calculate where in the last chunk the file should end
-                let end_in_last_chunk = ((new_size - 1) % chunk_size) + 1;
+        Ok(Arc::new(self.file_handle(ino)))
+    }
 
-                // If the last chunk needs to be truncated (not a full chunk),
-                // read it, truncate, and rewrite
-                if end_in_last_chunk < chunk_size {
-                    let mut stmt = self
-                        .conn
-                        .prepare_cached("SELECT data FROM fs_data WHERE ino = ? AND chunk_index = ?")
-                        .await?;
-                    let mut rows = stmt.query((ino, last_chunk_idx as i64)).await?;
+    /// Set the cap on writes buffered per open file, in bytes.
+    ///
+    /// Zero (the default) disables buffering: every `pwrite` on a handle goes
+    /// straight to the database. With buffering enabled, writes are held in
+    /// memory until the handle is flushed, fsynced, truncated or dropped,
+    /// until the cap is reached, or until a path-based read or write of the
+    /// file. Only a flush or fsync reports errors writing them back.
+    /// [`DEFAULT_WRITE_BUFFER_BYTES`] is a reasonable cap.
+    pub fn set_write_buffer_limit(&self, bytes: usize) {
+        self.write_buffers.limit.store(bytes, Ordering::Relaxed);
+    }
 
-                    if let Some(row) = rows.next().await? {
-                        if let Ok(Value::Blob(chunk_data)) = row.get_value(0) {
-                            if chunk_data.len() > end_in_last_chunk as usize {
-                                let truncated = &chunk_data[..end_in_last_chunk as usize];
-                                let mut stmt = self
-                                    .conn
-                                    .prepare_cached("UPDATE fs_data SET data = ? WHERE ino = ? AND chunk_index = ?")
-                                    .await?;
-                                stmt.execute((truncated, ino, last_chunk_idx as i64)).await?;
-                            }
-                        }
-                    }
-                }
-            } else if new_size > current_size {
-                // Extending: pad last existing chunk and add zero chunks as needed
-                let last_existing_chunk = if current_size == 0 {
-                    None
-                } else {
-                    Some((current_size - 1) / chunk_size)
-                };
-                let last_new_chunk = (new_size - 1) / chunk_size;
+    /// Build a handle for an inode, attached to its write buffer
+    fn file_handle(&self, ino: i64) -> AgentFSFile {
+        self.file_handle_with(ino, self.write_buffers.attach(ino))
+    }
 
-                // Pad the last existing chunk with zeros if it's not full
-                if let Some(last_idx) = last_existing_chunk {
-                    let mut stmt = self
-                        .conn
-                        .prepare_cached("SELECT data FROM fs_data WHERE ino = ? AND chunk_index = ?")
-                        .await?;
-                    let mut rows = stmt.query((ino, last_idx as i64)).await?;
+    fn file_handle_with(&self, ino: i64, buffer: Option<Arc<WriteBuffer>>) -> AgentFSFile {
+        AgentFSFile {
+            conn: self.conn.clone(),
+            writer: self.writer.clone(),
+            readers: self.readers.clone(),
+            attr_cache: self.attr_cache.clone(),
+            ino,
+            chunk_size: self.chunk_size,
+            chunks: self.chunks,
+            buffers: self.write_buffers.clone(),
+            buffer,
+            group_commit: self.group_commit.clone(),
+            readahead: Mutex::new(Readahead::default()),
+        }
+    }
 
-                    if let Some(row) = rows.next().await? {
-                        if let Ok(Value::Blob(chunk_data)) = row.get_value(0) {
-                            let current_chunk_len = chunk_data.len();
-                            let needed_len = if last_idx == last_new_chunk {
-                                // Last existing chunk is also the last new chunk
-                                ((new_size - 1) % chunk_size + 1) as usize
-                            } else {
-                                // Need to fill this chunk completely
-                                chunk_size as usize
-                            };
-
-                            if needed_len > current_chunk_len {
-                                let mut padded = chunk_data.clone();
-                                padded.resize(needed_len, 0);
-                                let mut stmt = self
-                                    .conn
-                                    .prepare_cached("UPDATE fs_data SET data = ? WHERE ino = ? AND chunk_index = ?")
-                                    .await?;
-                                stmt.execute((&padded[..], ino, last_idx as i64)).await?;
-                            }
-                        }
-                    }
-                }
+    /// Report the size and mtime of writes still buffered by open handles
+    async fn with_buffered_writes(&self, mut stats: Stats) -> Stats {
+        self.write_buffers.apply(&mut stats).await;
+        stats
+    }
 
-                // Add new zero-filled chunks if needed
-                let start_new_chunk = last_existing_chunk.map(|i| i + 1).unwrap_or(0);
-                for chunk_idx in start_new_chunk..=last_new_chunk {
-                    let chunk_len = if chunk_idx == last_new_chunk {
-                        ((new_size - 1) % chunk_size + 1) as usize
-                    } else {
-                        chunk_size as usize
-                    };
-                    let zeros = vec![0u8; chunk_len];
-                    self.conn
-                        .execute(
-                            "INSERT INTO fs_data (ino, chunk_index, data) VALUES (?, ?, ?)",
-                            (ino, chunk_idx as i64, &zeros[..]),
-                        )
-                        .await?;
+    /// Write back what handles buffered for the file at `path`, keeping its
+    /// buffer locked so they can't buffer more until the guard is dropped.
+    ///
+    /// Path-level reads and writes go to the database directly: reads would
+    /// miss buffered data, and a later flush would overwrite what a write
+    /// stored. Must be called before taking the writer lock.
+    async fn lock_buffer(
+        &self,
+        path: &str,
+    ) -> Result<Option<tokio::sync::OwnedMutexGuard<DirtyChunks>>> {
+        if self.write_buffers.is_empty() {
+            return Ok(None);
+        }
+        let Some(ino) = self.resolve_path_read(path).await? else {
+            return Ok(None);
+        };
+        let Some(buffer) = self.write_buffers.get(ino) else {
+            return Ok(None);
+        };
+        let mut dirty = buffer.lock_owned().await;
+        self.file_handle_with(ino, None)
+            .flush_dirty(&mut dirty)
+            .await?;
+        Ok(Some(dirty))
+    }
+
+    /// Look up a directory entry by parent inode and name
+    ///
+    /// Uses the dentry cache, so repeated lookups cost a single inode query.
+    pub async fn lookup(&self, parent_ino: i64, name: &str) -> Result<Option<Stats>> {
+        let _timer = metrics::timer(Op::Lookup, Layer::Delta);
+        let ino = match self.dentry_cache.get(parent_ino, name) {
+            Some(ino) => ino,
+            None => {
+                if self.dentry_cache.is_missing(parent_ino, name) {
+                    return Ok(None);
                 }
+                let generation = self.dentry_cache.generation();
+                let mut stmt = self
+                    .readers
+                    .get()
+                    .prepare_cached("SELECT ino FROM fs_dentry WHERE parent_ino = ? AND name = ?")
+                    .await?;
+                let mut rows = stmt.query((parent_ino, name)).await?;
+                let Some(row) = rows.next().await? else {
+                    self.dentry_cache
+                        .insert_missing(parent_ino, name, generation);
+                    return Ok(None);
+                };
+                let ino = row
+                    .get_value(0)
+                    .ok()
+                    .and_then(|v| v.as_integer().copied())
+                    .unwrap_or(0);
+                self.dentry_cache.fill(parent_ino, name, ino);
+                ino
             }
-            // else: new_size == current_size, nothing to do for data
+        };
+        self.attrs(ino).await
+    }
 
-            // Update size and mtime
-            let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
-            let mut stmt = self
-                .conn
-                .prepare_cached("UPDATE fs_inode SET size = ?, mtime = ? WHERE ino = ?")
-                .await?;
-            stmt.execute((new_size as i64, now, ino)).await?;
+    /// Get file statistics by inode number
+    pub async fn getattr(&self, ino: i64) -> Result<Option<Stats>> {
+        let _timer = metrics::timer(Op::Getattr, Layer::Delta);
+        self.attrs(ino).await
+    }
 
-            Ok(())
+    /// `getattr` without timing, for operations that time themselves
+    async fn attrs(&self, ino: i64) -> Result<Option<Stats>> {
+        match self.attr_cache.fetch(self.readers.get(), ino).await? {
+            Some(stats) => Ok(Some(self.with_buffered_writes(stats).await)),
+            None => Ok(None),
         }
-        .await;
+    }
 
-        match result {
-            Ok(()) => {
-                self.conn
-                    .prepare_cached("COMMIT")
-                    .await?
-                    .execute(())
-                    .await?;
-                Ok(())
-            }
-            Err(e) => {
-                let _ = self
-                    .conn
-                    .prepare_cached("ROLLBACK")
-                    .await?
-                    .execute(())
-                    .await;
-                Err(e)
-            }
+    /// Open a file by inode number
+    pub async fn open_inode(&self, ino: i64) -> Result<BoxedFile> {
+        if self.attrs(ino).await?.is_none() {
+            return Err(FsError::NotFound.into());
+        }
+
+        Ok(Arc::new(self.file_handle(ino)))
+    }
+
+    /// List directory contents with full statistics by inode number
+    pub async fn readdir_inode(&self, ino: i64) -> Result<Option<Vec<DirEntry>>> {
+        let _timer = metrics::timer(Op::Readdir, Layer::Delta);
+        match self.attrs(ino).await? {
+            Some(stats) if !stats.is_directory() => Err(FsError::NotADirectory.into()),
+            Some(_) => Ok(Some(self.list_entries(ino).await?)),
+            None => Ok(None),
+        }
+    }
+
+    /// Open a stream over the entries of a directory, sorted by name
+    ///
+    /// Like `readdir_plus`, but entries are fetched in batches as the stream
+    /// is read.
+    pub async fn opendir(&self, path: &str) -> Result<Option<BoxedDirStream>> {
+        Ok(self
+            .resolve_path_read(path)
+            .await?
+            .map(|ino| self.dir_stream(ino)))
+    }
+
+    /// Open a stream over the entries of a directory inode, sorted by name
+    pub async fn opendir_inode(&self, ino: i64) -> Result<Option<BoxedDirStream>> {
+        match self.attrs(ino).await? {
+            Some(stats) if !stats.is_directory() => Err(FsError::NotADirectory.into()),
+            Some(_) => Ok(Some(self.dir_stream(ino))),
+            None => Ok(None),
         }
     }
 
-    /// List directory contents
-    pub async fn readdir(&self, path: &str) -> Result<Option<Vec<String>>> {
-        let ino = match self.resolve_path(path).await? {
-            Some(ino) => ino,
-            None => return Ok(None),
-        };
+    fn dir_stream(&self, ino: i64) -> BoxedDirStream {
+        Box::new(AgentFSDirStream {
+            readers: self.readers.clone(),
+            dentry_cache: self.dentry_cache.clone(),
+            attr_cache: self.attr_cache.clone(),
+            write_buffers: self.write_buffers.clone(),
+            ino,
+            after: String::new(),
+            done: false,
+        })
+    }
 
+    /// Get the number of chunks for a given inode (for testing)
+    #[cfg(test)]
+    async fn get_chunk_count(&self, ino: i64) -> Result<i64> {
         let mut rows = self
             .conn
-            .query(
-                "SELECT name FROM fs_dentry WHERE parent_ino = ? ORDER BY name",
-                (ino,),
-            )
+            .query("SELECT COUNT(*) FROM fs_data WHERE ino = ?", (ino,))
             .await?;
 
-        let mut entries = Vec::new();
-        while let Some(row) = rows.next().await? {
-            let name = row
+        if let Some(row) = rows.next().await? {
+            Ok(row
                 .get_value(0)
                 .ok()
-                .and_then(|v| {
-                    if let Value::Text(s) = v {
-                        Some(s.clone())
-                    } else {
-                        None
-                    }
-                })
-                .unwrap_or_default();
-            if !name.is_empty() {
-                entries.push(name);
-            }
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0))
+        } else {
+            Ok(0)
         }
+    }
+}
 
-        Ok(Some(entries))
+#[async_trait]
+impl FileSystem for AgentFS {
+    async fn stat(&self, path: &str) -> Result<Option<Stats>> {
+        AgentFS::stat(self, path).await
     }
 
-    /// List directory contents with full statistics (optimized batch query)
-    ///
-    /// Returns entries with their stats in a single JOIN query, avoiding N+1 queries.
-    pub async fn readdir_plus(&self, path: &str) -> Result<Option<Vec<DirEntry>>> {
-        let ino = match self.resolve_path(path).await? {
-            Some(ino) => ino,
-            None => return Ok(None),
-        };
+    async fn lstat(&self, path: &str) -> Result<Option<Stats>> {
+        AgentFS::lstat(self, path).await
+    }
 
-        // Single JOIN query to get all entry names and their stats (including link count)
-        let mut rows = self
-            .conn
-            .query(
-                "SELECT d.name, i.ino, i.mode, i.nlink, i.uid, i.gid, i.size, i.atime, i.mtime, i.ctime
-                 FROM fs_dentry d
-                 JOIN fs_inode i ON d.ino = i.ino
-                 WHERE d.parent_ino = ?
-                 ORDER BY d.name",
-                (ino,),
-            )
-            .await?;
+    async fn read_file(&self, path: &str) -> Result<Option<Vec<u8>>> {
+        AgentFS::read_file(self, path).await
+    }
 
-        let mut entries = Vec::new();
-        while let Some(row) = rows.next().await? {
-            let name = row
-                .get_value(0)
-                .ok()
-                .and_then(|v| {
-                    if let Value::Text(s) = v {
-                        Some(s.clone())
-                    } else {
-                        None
-                    }
-                })
-                .unwrap_or_default();
+    async fn write_file(&self, path: &str, data: &[u8]) -> Result<()> {
+        AgentFS::write_file(self, path, data).await
+    }
 
-            if name.is_empty() {
-                continue;
-            }
+    async fn readdir(&self, path: &str) -> Result<Option<Vec<String>>> {
+        AgentFS::readdir(self, path).await
+    }
 
-            let entry_ino = row
-                .get_value(1)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0);
+    async fn readdir_plus(&self, path: &str) -> Result<Option<Vec<DirEntry>>> {
+        AgentFS::readdir_plus(self, path).await
+    }
 
-            let nlink = row
-                .get_value(3)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(1) as u32;
+    async fn mkdir(&self, path: &str) -> Result<()> {
+        AgentFS::mkdir(self, path).await
+    }
 
-            let stats = Stats {
-                ino: entry_ino,
-                mode: row
-                    .get_value(2)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0) as u32,
-                nlink,
-                uid: row
-                    .get_value(4)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0) as u32,
-                gid: row
-                    .get_value(5)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0) as u32,
-                size: row
-                    .get_value(6)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0),
-                atime: row
-                    .get_value(7)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0),
-                mtime: row
-                    .get_value(8)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0),
-                ctime: row
-                    .get_value(9)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0),
-            };
+    async fn remove(&self, path: &str) -> Result<()> {
+        AgentFS::remove(self, path).await
+    }
 
-            entries.push(DirEntry { name, stats });
-        }
+    async fn chmod(&self, path: &str, mode: u32) -> Result<()> {
+        AgentFS::chmod(self, path, mode).await
+    }
 
-        Ok(Some(entries))
+    async fn rename(&self, from: &str, to: &str) -> Result<()> {
+        AgentFS::rename(self, from, to).await
     }
 
-    /// Create a symbolic link
-    pub async fn symlink(&self, target: &str, linkpath: &str) -> Result<()> {
-        let linkpath = self.normalize_path(linkpath);
-        let components = self.split_path(&linkpath);
+    async fn symlink(&self, target: &str, linkpath: &str) -> Result<()> {
+        AgentFS::symlink(self, target, linkpath).await
+    }
 
-        if components.is_empty() {
-            return Err(FsError::RootOperation.into());
-        }
+    async fn link(&self, oldpath: &str, newpath: &str) -> Result<()> {
+        AgentFS::link(self, oldpath, newpath).await
+    }
 
-        // Get parent directory
-        let parent_path = if components.len() == 1 {
-            "/".to_string()
-        } else {
-            format!("/{}", components[..components.len() - 1].join("/"))
-        };
+    async fn readlink(&self, path: &str) -> Result<Option<String>> {
+        AgentFS::readlink(self, path).await
+    }
 
-        let parent_ino = self
-            .resolve_path(&parent_path)
-            .await?
-            .ok_or(FsError::NotFound)?;
+    async fn statfs(&self) -> Result<FilesystemStats> {
+        AgentFS::statfs(self).await
+    }
 
-        let name = components.last().unwrap();
+    async fn open(&self, path: &str) -> Result<BoxedFile> {
+        AgentFS::open(self, path).await
+    }
 
-        // Check if entry already exists (single query using parent_ino we already have)
-        if self.lookup_child(parent_ino, name).await?.is_some() {
-            return Err(FsError::AlreadyExists.into());
-        }
+    async fn create_file(&self, path: &str, mode: u32) -> Result<(Stats, BoxedFile)> {
+        AgentFS::create_file(self, path, mode).await
+    }
 
-        // Create inode for symlink
-        let now = SystemTime::now()
-            .duration_since(UNIX_EPOCH)
-            .unwrap()
-            .as_secs() as i64;
+    async fn lookup(&self, parent_ino: i64, name: &str) -> Result<Option<Stats>> {
+        AgentFS::lookup(self, parent_ino, name).await
+    }
 
-        let mode = S_IFLNK | 0o777; // Symlinks typically have 777 permissions
-        let size = target.len() as i64;
+    async fn getattr(&self, ino: i64) -> Result<Option<Stats>> {
+        AgentFS::getattr(self, ino).await
+    }
 
-        let mut stmt = self
-            .conn
-            .prepare(
-                "INSERT INTO fs_inode (mode, uid, gid, size, atime, mtime, ctime)
-                 VALUES (?, 0, 0, ?, ?, ?, ?) RETURNING ino",
-            )
-            .await?;
-        let row = stmt.query_row((mode, size, now, now, now)).await?;
+    async fn open_inode(&self, ino: i64) -> Result<BoxedFile> {
+        AgentFS::open_inode(self, ino).await
+    }
 
-        // Get the newly created inode
-        let ino = row
-            .get_value(0)
-            .ok()
-            .and_then(|v| v.as_integer().copied())
-            .unwrap_or(0);
+    async fn readdir_inode(&self, ino: i64) -> Result<Option<Vec<DirEntry>>> {
+        AgentFS::readdir_inode(self, ino).await
+    }
 
-        // Store symlink target
-        self.conn
-            .execute(
-                "INSERT INTO fs_symlink (ino, target) VALUES (?, ?)",
-                (ino, target),
-            )
-            .await?;
+    async fn opendir(&self, path: &str) -> Result<Option<BoxedDirStream>> {
+        AgentFS::opendir(self, path).await
+    }
 
-        // Create directory entry
-        self.conn
-            .execute(
-                "INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)",
-                (name.as_str(), parent_ino, ino),
-            )
-            .await?;
+    async fn opendir_inode(&self, ino: i64) -> Result<Option<BoxedDirStream>> {
+        AgentFS::opendir_inode(self, ino).await
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use tempfile::tempdir;
+
+    async fn create_test_fs() -> Result<(AgentFS, tempfile::TempDir)> {
+        let dir = tempdir()?;
+        let db_path = dir.path().join("test.db");
+        let fs = AgentFS::new(db_path.to_str().unwrap()).await?;
+        Ok((fs, dir))
+    }
+
+    // ==================== Chunk Size Boundary Tests ====================
+
+    #[tokio::test]
+    async fn test_file_smaller_than_chunk_size() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
+
+        // Write a file smaller than chunk_size (100 bytes)
+        let data = vec![0u8; 100];
+        fs.write_file("/small.txt", &data).await?;
+
+        // Read it back
+        let read_data = fs.read_file("/small.txt").await?.unwrap();
+        assert_eq!(read_data.len(), 100);
+        assert_eq!(read_data, data);
+
+        // Verify only 1 chunk was created
+        let ino = fs.resolve_path("/small.txt").await?.unwrap();
+        let chunk_count = fs.get_chunk_count(ino).await?;
+        assert_eq!(chunk_count, 1);
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn test_file_exactly_chunk_size() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
+
+        // Write exactly chunk_size bytes
+        let chunk_size = fs.chunk_size();
+        let data: Vec<u8> = (0..chunk_size).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/exact.txt", &data).await?;
 
-        // Increment link count
-        self.conn
-            .execute(
-                "UPDATE fs_inode SET nlink = nlink + 1 WHERE ino = ?",
-                (ino,),
-            )
-            .await?;
+        // Read it back
+        let read_data = fs.read_file("/exact.txt").await?.unwrap();
+        assert_eq!(read_data.len(), chunk_size);
+        assert_eq!(read_data, data);
 
-        // Populate dentry cache
-        self.dentry_cache.insert(parent_ino, name, ino);
+        // Verify only 1 chunk was created
+        let ino = fs.resolve_path("/exact.txt").await?.unwrap();
+        let chunk_count = fs.get_chunk_count(ino).await?;
+        assert_eq!(chunk_count, 1);
 
         Ok(())
     }
 
-    /// Create a hard link
-    ///
-    /// Creates a new directory entry `newpath` that refers to the same inode as `oldpath`.
-    /// Both paths will share the same file data and metadata (except for the name).
-    /// The link count (nlink) of the inode is incremented.
-    pub async fn link(&self, oldpath: &str, newpath: &str) -> Result<()> {
-        let oldpath = self.normalize_path(oldpath);
-        let newpath = self.normalize_path(newpath);
-        let components = self.split_path(&newpath);
+    #[tokio::test]
+    async fn test_file_one_byte_over_chunk_size() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        if components.is_empty() {
-            return Err(FsError::RootOperation.into());
-        }
+        // Write chunk_size + 1 bytes
+        let chunk_size = fs.chunk_size();
+        let data: Vec<u8> = (0..=chunk_size).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/overflow.txt", &data).await?;
 
-        // Resolve old path to get its inode
-        let ino = self
-            .resolve_path(&oldpath)
-            .await?
-            .ok_or(FsError::NotFound)?;
+        // Read it back
+        let read_data = fs.read_file("/overflow.txt").await?.unwrap();
+        assert_eq!(read_data.len(), chunk_size + 1);
+        assert_eq!(read_data, data);
 
-        // Check if source is a directory (hard links to directories are not allowed)
-        let mut rows = self
-            .conn
-            .query("SELECT mode FROM fs_inode WHERE ino = ?", (ino,))
-            .await?;
+        // Verify 2 chunks were created
+        let ino = fs.resolve_path("/overflow.txt").await?.unwrap();
+        let chunk_count = fs.get_chunk_count(ino).await?;
+        assert_eq!(chunk_count, 2);
 
-        if let Some(row) = rows.next().await? {
-            let mode = row
-                .get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u32;
+        Ok(())
+    }
 
-            if (mode & S_IFMT) == super::S_IFDIR {
-                return Err(FsError::IsADirectory.into());
-            }
-        } else {
-            return Err(FsError::NotFound.into());
-        }
+    #[tokio::test]
+    async fn test_file_spanning_multiple_chunks() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        // Get parent directory of new path
-        let parent_path = if components.len() == 1 {
-            "/".to_string()
-        } else {
-            format!("/{}", components[..components.len() - 1].join("/"))
-        };
+        // Write ~2.5 chunks worth of data
+        let chunk_size = fs.chunk_size();
+        let data_size = chunk_size * 2 + chunk_size / 2;
+        let data: Vec<u8> = (0..data_size).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/multi.txt", &data).await?;
 
-        let parent_ino = self
-            .resolve_path(&parent_path)
-            .await?
-            .ok_or(FsError::NotFound)?;
+        // Read it back
+        let read_data = fs.read_file("/multi.txt").await?.unwrap();
+        assert_eq!(read_data.len(), data_size);
+        assert_eq!(read_data, data);
 
-        let name = components.last().unwrap();
+        // Verify 3 chunks were created
+        let ino = fs.resolve_path("/multi.txt").await?.unwrap();
+        let chunk_count = fs.get_chunk_count(ino).await?;
+        assert_eq!(chunk_count, 3);
 
-        // Check if new path already exists (single query using parent_ino we already have)
-        if self.lookup_child(parent_ino, name).await?.is_some() {
-            return Err(FsError::AlreadyExists.into());
-        }
+        Ok(())
+    }
 
-        // Create directory entry pointing to the same inode
-        self.conn
-            .execute(
-                "INSERT INTO fs_dentry (name, parent_ino, ino) VALUES (?, ?, ?)",
-                (name.as_str(), parent_ino, ino),
-            )
-            .await?;
+    // ==================== Data Integrity Tests ====================
 
-        // Increment link count
-        self.conn
-            .execute(
-                "UPDATE fs_inode SET nlink = nlink + 1 WHERE ino = ?",
-                (ino,),
-            )
-            .await?;
+    #[tokio::test]
+    async fn test_roundtrip_byte_for_byte() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        // Populate dentry cache
-        self.dentry_cache.insert(parent_ino, name, ino);
+        // Create data that spans chunk boundaries with identifiable patterns
+        let chunk_size = fs.chunk_size();
+        let data_size = chunk_size * 3 + 123; // Odd size spanning 4 chunks
+
+        let data: Vec<u8> = (0..data_size).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/roundtrip.bin", &data).await?;
+
+        let read_data = fs.read_file("/roundtrip.bin").await?.unwrap();
+        assert_eq!(read_data.len(), data_size);
+        assert_eq!(read_data, data, "Data mismatch after roundtrip");
 
         Ok(())
     }
 
-    /// Read the target of a symbolic link
-    pub async fn readlink(&self, path: &str) -> Result<Option<String>> {
-        let path = self.normalize_path(path);
+    #[tokio::test]
+    async fn test_binary_data_with_null_bytes() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        let ino = match self.resolve_path(&path).await? {
-            Some(ino) => ino,
-            None => return Ok(None),
-        };
+        let chunk_size = fs.chunk_size();
+        // Create data with null bytes at chunk boundaries
+        let mut data = vec![0u8; chunk_size * 2 + 100];
+        // Put nulls at the chunk boundary
+        data[chunk_size - 1] = 0;
+        data[chunk_size] = 0;
+        data[chunk_size + 1] = 0;
+        // Put some non-null bytes around
+        data[chunk_size - 2] = 0xFF;
+        data[chunk_size + 2] = 0xFF;
 
-        // Check if it's a symlink by querying the inode
-        let mut rows = self
-            .conn
-            .query("SELECT mode FROM fs_inode WHERE ino = ?", (ino,))
-            .await?;
+        fs.write_file("/nulls.bin", &data).await?;
+        let read_data = fs.read_file("/nulls.bin").await?.unwrap();
 
-        if let Some(row) = rows.next().await? {
-            let mode = row
-                .get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u32;
+        assert_eq!(read_data, data, "Null bytes at chunk boundary corrupted");
 
-            // Check if it's a symlink
-            if (mode & S_IFMT) != S_IFLNK {
-                return Err(FsError::NotASymlink.into());
-            }
-        } else {
-            return Ok(None);
-        }
+        Ok(())
+    }
 
-        // Read target from fs_symlink table
-        let mut rows = self
-            .conn
-            .query("SELECT target FROM fs_symlink WHERE ino = ?", (ino,))
-            .await?;
+    #[tokio::test]
+    async fn test_chunk_ordering() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        if let Some(row) = rows.next().await? {
-            let target = row
-                .get_value(0)
-                .ok()
-                .and_then(|v| match v {
-                    Value::Text(s) => Some(s.to_string()),
-                    _ => None,
-                })
-                .ok_or(FsError::InvalidPath)?;
-            Ok(Some(target))
-        } else {
-            Ok(None)
+        let chunk_size = fs.chunk_size();
+        // Create sequential bytes spanning multiple chunks
+        let data_size = chunk_size * 5;
+        let data: Vec<u8> = (0..data_size).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/sequential.bin", &data).await?;
+
+        let read_data = fs.read_file("/sequential.bin").await?.unwrap();
+
+        // Verify every byte is in the correct position
+        for (i, (&expected, &actual)) in data.iter().zip(read_data.iter()).enumerate() {
+            assert_eq!(
+                expected, actual,
+                "Byte mismatch at position {}: expected {}, got {}",
+                i, expected, actual
+            );
         }
+
+        Ok(())
     }
 
-    /// Remove a file or empty directory
-    pub async fn remove(&self, path: &str) -> Result<()> {
-        let path = self.normalize_path(path);
-        let components = self.split_path(&path);
+    // ==================== Edge Case Tests ====================
 
-        if components.is_empty() {
-            return Err(FsError::RootOperation.into());
-        }
+    #[tokio::test]
+    async fn test_empty_file() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        let ino = self.resolve_path(&path).await?.ok_or(FsError::NotFound)?;
+        // Write empty file
+        fs.write_file("/empty.txt", &[]).await?;
 
-        if ino == ROOT_INO {
-            return Err(FsError::RootOperation.into());
-        }
+        // Read it back
+        let read_data = fs.read_file("/empty.txt").await?.unwrap();
+        assert!(read_data.is_empty());
 
-        // Check if directory is empty
-        let mut stmt = self
-            .conn
-            .prepare_cached("SELECT COUNT(*) FROM fs_dentry WHERE parent_ino = ?")
-            .await?;
-        let mut rows = stmt.query((ino,)).await?;
+        // Verify 0 chunks were created
+        let ino = fs.resolve_path("/empty.txt").await?.unwrap();
+        let chunk_count = fs.get_chunk_count(ino).await?;
+        assert_eq!(chunk_count, 0);
 
-        if let Some(row) = rows.next().await? {
-            let count = row
-                .get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0);
-            if count > 0 {
-                return Err(FsError::NotEmpty.into());
-            }
-        }
+        // Verify size is 0
+        let stats = fs.stat("/empty.txt").await?.unwrap();
+        assert_eq!(stats.size, 0);
 
-        // Get parent directory and name
-        let parent_path = if components.len() == 1 {
-            "/".to_string()
-        } else {
-            format!("/{}", components[..components.len() - 1].join("/"))
-        };
+        Ok(())
+    }
 
-        let parent_ino = self
-            .resolve_path(&parent_path)
-            .await?
-            .ok_or(FsError::NotFound)?;
+    #[tokio::test]
+    async fn test_overwrite_existing_file() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        let name = components.last().unwrap();
+        let chunk_size = fs.chunk_size();
 
-        // Delete the specific directory entry (not all entries pointing to this inode)
-        let mut stmt = self
-            .conn
-            .prepare_cached("DELETE FROM fs_dentry WHERE parent_ino = ? AND name = ?")
-            .await?;
-        stmt.execute((parent_ino, name.as_str())).await?;
+        // Write initial large file (3 chunks)
+        let initial_data: Vec<u8> = (0..chunk_size * 3).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/overwrite.txt", &initial_data).await?;
 
-        // Invalidate cache for this entry
-        self.dentry_cache.remove(parent_ino, name);
+        let ino = fs.resolve_path("/overwrite.txt").await?.unwrap();
+        let initial_chunk_count = fs.get_chunk_count(ino).await?;
+        assert_eq!(initial_chunk_count, 3);
 
-        // Decrement link count
-        let mut stmt = self
-            .conn
-            .prepare_cached("UPDATE fs_inode SET nlink = nlink - 1 WHERE ino = ?")
-            .await?;
-        stmt.execute((ino,)).await?;
+        // Overwrite with smaller file (1 chunk)
+        let new_data = vec![42u8; 100];
+        fs.write_file("/overwrite.txt", &new_data).await?;
 
-        // Check if this was the last link to the inode
-        let link_count = self.get_link_count(ino).await?;
-        if link_count == 0 {
-            // Manually handle cascading deletes since we don't use foreign keys
-            // Delete data blocks
-            let mut stmt = self
-                .conn
-                .prepare_cached("DELETE FROM fs_data WHERE ino = ?")
-                .await?;
-            stmt.execute((ino,)).await?;
+        // Verify old chunks are gone and new data is correct
+        let read_data = fs.read_file("/overwrite.txt").await?.unwrap();
+        assert_eq!(read_data, new_data);
 
-            // Delete symlink if exists
-            let mut stmt = self
-                .conn
-                .prepare_cached("DELETE FROM fs_symlink WHERE ino = ?")
-                .await?;
-            stmt.execute((ino,)).await?;
+        let new_chunk_count = fs.get_chunk_count(ino).await?;
+        assert_eq!(new_chunk_count, 1);
 
-            // Delete inode
-            let mut stmt = self
-                .conn
-                .prepare_cached("DELETE FROM fs_inode WHERE ino = ?")
-                .await?;
-            stmt.execute((ino,)).await?;
-        }
+        // Verify size is updated
+        let stats = fs.stat("/overwrite.txt").await?.unwrap();
+        assert_eq!(stats.size, 100);
 
         Ok(())
     }
 
-    /// Change file mode/permissions.
-    ///
-    /// Only modifies the permission bits (lower 12 bits), preserving the file type.
-    pub async fn chmod(&self, path: &str, mode: u32) -> Result<()> {
-        let path = self.normalize_path(path);
+    #[tokio::test]
+    async fn test_overwrite_with_larger_file() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        let ino = self.resolve_path(&path).await?.ok_or(FsError::NotFound)?;
+        let chunk_size = fs.chunk_size();
 
-        // Get current mode to preserve file type bits
-        let mut stmt = self
-            .conn
-            .prepare_cached("SELECT mode FROM fs_inode WHERE ino = ?")
-            .await?;
-        let mut rows = stmt.query((ino,)).await?;
+        // Write initial small file (1 chunk)
+        let initial_data = vec![1u8; 100];
+        fs.write_file("/grow.txt", &initial_data).await?;
 
-        let current_mode = if let Some(row) = rows.next().await? {
-            row.get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u32
-        } else {
-            return Err(FsError::NotFound.into());
-        };
+        let ino = fs.resolve_path("/grow.txt").await?.unwrap();
+        assert_eq!(fs.get_chunk_count(ino).await?, 1);
 
-        // Preserve file type bits (upper bits), replace permission bits (lower 12 bits)
-        let new_mode = (current_mode & S_IFMT) | (mode & 0o7777);
+        // Overwrite with larger file (3 chunks)
+        let new_data: Vec<u8> = (0..chunk_size * 3).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/grow.txt", &new_data).await?;
 
-        let mut stmt = self
-            .conn
-            .prepare_cached("UPDATE fs_inode SET mode = ? WHERE ino = ?")
-            .await?;
-        stmt.execute((new_mode as i64, ino)).await?;
+        // Verify data is correct
+        let read_data = fs.read_file("/grow.txt").await?.unwrap();
+        assert_eq!(read_data, new_data);
+        assert_eq!(fs.get_chunk_count(ino).await?, 3);
 
         Ok(())
     }
 
-    /// Rename/move a file or directory.
-    ///
-    /// This operation is atomic - either all changes succeed or none do.
-    pub async fn rename(&self, from: &str, to: &str) -> Result<()> {
-        let from_path = self.normalize_path(from);
-        let to_path = self.normalize_path(to);
+    #[tokio::test]
+    async fn test_very_large_file() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        // Cannot rename root
-        if from_path == "/" {
-            return Err(FsError::RootOperation.into());
-        }
+        // Write 1MB file
+        let data_size = 1024 * 1024;
+        let data: Vec<u8> = (0..data_size).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/large.bin", &data).await?;
 
-        // Get source inode
-        let src_ino = self
-            .resolve_path(&from_path)
-            .await?
-            .ok_or(FsError::NotFound)?;
+        let read_data = fs.read_file("/large.bin").await?.unwrap();
+        assert_eq!(read_data.len(), data_size);
+        assert_eq!(read_data, data);
 
-        // Get source stats to check if it's a directory
-        let src_stats = self.stat(&from_path).await?.ok_or(FsError::NotFound)?;
+        // Verify correct number of chunks
+        let chunk_size = fs.chunk_size();
+        let expected_chunks = data_size.div_ceil(chunk_size);
+        let ino = fs.resolve_path("/large.bin").await?.unwrap();
+        let actual_chunks = fs.get_chunk_count(ino).await? as usize;
+        assert_eq!(actual_chunks, expected_chunks);
 
-        // Prevent renaming a directory into its own subtree (would create a cycle)
-        if src_stats.is_directory() {
-            let from_prefix = format!("{}/", from_path);
-            if to_path.starts_with(&from_prefix) || to_path == from_path {
-                return Err(FsError::InvalidRename.into());
-            }
-        }
+        Ok(())
+    }
 
-        // Parse source path to get parent and name
-        let from_components = self.split_path(&from_path);
-        let src_name = from_components.last().ok_or(FsError::InvalidPath)?;
-        let src_parent_path = if from_components.len() == 1 {
-            "/".to_string()
-        } else {
-            format!(
-                "/{}",
-                from_components[..from_components.len() - 1].join("/")
-            )
-        };
-        let src_parent_ino = self
-            .resolve_path(&src_parent_path)
-            .await?
-            .ok_or(FsError::NotFound)?;
+    // ==================== Configuration Tests ====================
 
-        // Parse destination path to get parent and name
-        let to_components = self.split_path(&to_path);
-        if to_components.is_empty() {
-            return Err(FsError::RootOperation.into());
-        }
-        let dst_name = to_components.last().unwrap();
-        let dst_parent_path = if to_components.len() == 1 {
-            "/".to_string()
-        } else {
-            format!("/{}", to_components[..to_components.len() - 1].join("/"))
-        };
-        let dst_parent_ino = self
-            .resolve_path(&dst_parent_path)
-            .await?
-            .ok_or(FsError::NotFound)?;
+    #[tokio::test]
+    async fn test_default_chunk_size() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        // Clone strings for use inside the transaction closure
-        let src_name = src_name.clone();
-        let dst_name = dst_name.clone();
+        assert_eq!(fs.chunk_size(), DEFAULT_CHUNK_SIZE);
+        assert_eq!(fs.chunk_size(), 4096);
 
-        self.conn
-            .prepare_cached("BEGIN IMMEDIATE")
-            .await?
-            .execute(())
-            .await?;
+        Ok(())
+    }
 
-        let result: Result<()> = async {
-            // Check if destination exists (inside transaction for atomicity)
-            if let Some(dst_ino) = self.resolve_path(&to_path).await? {
-                let dst_stats = self.stat(&to_path).await?.ok_or(FsError::NotFound)?;
+    #[tokio::test]
+    async fn test_chunk_size_accessor() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-                // Can't replace directory with non-directory
-                if dst_stats.is_directory() && !src_stats.is_directory() {
-                    return Err(FsError::IsADirectory.into());
-                }
+        let chunk_size = fs.chunk_size();
+        assert!(chunk_size > 0);
 
-                // Can't replace non-directory with directory
-                if !dst_stats.is_directory() && src_stats.is_directory() {
-                    return Err(FsError::NotADirectory.into());
-                }
+        // Write data and verify chunks match expected based on chunk_size
+        let data = vec![0u8; chunk_size * 2 + 1];
+        fs.write_file("/test.bin", &data).await?;
 
-                // If destination is directory, it must be empty
-                if dst_stats.is_directory() {
-                    let mut stmt = self
-                        .conn
-                        .prepare_cached("SELECT COUNT(*) FROM fs_dentry WHERE parent_ino = ?")
-                        .await?;
-                    let mut rows = stmt.query((dst_ino,)).await?;
+        let ino = fs.resolve_path("/test.bin").await?.unwrap();
+        let chunk_count = fs.get_chunk_count(ino).await?;
+        assert_eq!(chunk_count, 3);
 
-                    if let Some(row) = rows.next().await? {
-                        let count = row
-                            .get_value(0)
-                            .ok()
-                            .and_then(|v| v.as_integer().copied())
-                            .unwrap_or(0);
-                        if count > 0 {
-                            return Err(FsError::NotEmpty.into());
-                        }
-                    }
-                }
+        Ok(())
+    }
 
-                // Remove destination entry
-                let mut stmt = self
-                    .conn
-                    .prepare_cached("DELETE FROM fs_dentry WHERE parent_ino = ? AND name = ?")
-                    .await?;
-                stmt.execute((dst_parent_ino, dst_name.as_str())).await?;
+    #[tokio::test]
+    async fn test_config_persistence() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
+
+        // Query fs_config table directly
+        let mut rows = fs
+            .conn
+            .query("SELECT value FROM fs_config WHERE key = 'chunk_size'", ())
+            .await?;
 
-                // Decrement link count
-                let mut stmt = self
-                    .conn
-                    .prepare_cached("UPDATE fs_inode SET nlink = nlink - 1 WHERE ino = ?")
-                    .await?;
-                stmt.execute((dst_ino,)).await?;
+        let row = rows.next().await?.expect("chunk_size config should exist");
+        let value = row
+            .get_value(0)
+            .ok()
+            .and_then(|v| match v {
+                Value::Text(s) => Some(s.clone()),
+                _ => None,
+            })
+            .expect("chunk_size should be a text value");
 
-                // Clean up destination inode if no more links
-                let link_count = self.get_link_count(dst_ino).await?;
-                if link_count == 0 {
-                    let mut stmt = self
-                        .conn
-                        .prepare_cached("DELETE FROM fs_data WHERE ino = ?")
-                        .await?;
-                    stmt.execute((dst_ino,)).await?;
-                    let mut stmt = self
-                        .conn
-                        .prepare_cached("DELETE FROM fs_symlink WHERE ino = ?")
-                        .await?;
-                    stmt.execute((dst_ino,)).await?;
-                    let mut stmt = self
-                        .conn
-                        .prepare_cached("DELETE FROM fs_inode WHERE ino = ?")
-                        .await?;
-                    stmt.execute((dst_ino,)).await?;
-                }
-            }
+        assert_eq!(value, "4096");
 
-            // Update the dentry: change parent and/or name
-            let mut stmt = self
-                .conn
-                .prepare_cached(
-                    "UPDATE fs_dentry SET parent_ino = ?, name = ? WHERE parent_ino = ? AND name = ?",
-                )
-                .await?;
-            stmt.execute((
-                dst_parent_ino,
-                dst_name.as_str(),
-                src_parent_ino,
-                src_name.as_str(),
-            ))
-            .await?;
+        Ok(())
+    }
 
-            // Update ctime of the inode
-            let now = SystemTime::now()
-                .duration_since(UNIX_EPOCH)
-                .unwrap_or_default()
-                .as_secs() as i64;
+    // ==================== Schema Tests ====================
 
-            let mut stmt = self
-                .conn
-                .prepare_cached("UPDATE fs_inode SET ctime = ? WHERE ino = ?")
-                .await?;
-            stmt.execute((now, src_ino)).await?;
+    #[tokio::test]
+    async fn test_chunk_index_uniqueness() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-            Ok(())
-        }
-        .await;
+        // Write a file to create chunks
+        let chunk_size = fs.chunk_size();
+        let data = vec![0u8; chunk_size * 2];
+        fs.write_file("/unique.txt", &data).await?;
 
-        match result {
-            Ok(()) => {
-                self.conn
-                    .prepare_cached("COMMIT")
-                    .await?
-                    .execute(())
-                    .await?;
+        let ino = fs.resolve_path("/unique.txt").await?.unwrap();
 
-                // Invalidate cache for source and destination
-                self.dentry_cache.remove(src_parent_ino, &src_name);
-                self.dentry_cache.remove(dst_parent_ino, &dst_name);
+        // Try to insert a duplicate chunk - should fail due to PRIMARY KEY constraint
+        let result = fs
+            .conn
+            .execute(
+                "INSERT INTO fs_data (ino, chunk_index, data) VALUES (?, 0, ?)",
+                (ino, vec![1u8; 10]),
+            )
+            .await;
 
-                // Add new entry to cache (source inode is now at destination)
-                self.dentry_cache.insert(dst_parent_ino, &dst_name, src_ino);
+        assert!(result.is_err(), "Duplicate chunk_index should be rejected");
 
-                Ok(())
-            }
-            Err(e) => {
-                let _ = self
-                    .conn
-                    .prepare_cached("ROLLBACK")
-                    .await?
-                    .execute(())
-                    .await;
-                Err(e)
-            }
-        }
+        Ok(())
     }
 
-    /// Get filesystem statistics
-    ///
-    /// Returns the total number of inodes and bytes used by file contents.
-    pub async fn statfs(&self) -> Result<FilesystemStats> {
-        // Count total inodes
-        let mut stmt = self
-            .conn
-            .prepare_cached("SELECT COUNT(*) FROM fs_inode")
-            .await?;
-        let mut rows = stmt.query(()).await?;
+    #[tokio::test]
+    async fn test_chunk_ordering_in_database() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        let inodes = if let Some(row) = rows.next().await? {
-            row.get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u64
-        } else {
-            0
-        };
+        let chunk_size = fs.chunk_size();
+        // Create 5 chunks with identifiable data
+        let data_size = chunk_size * 5;
+        let data: Vec<u8> = (0..data_size).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/ordered.bin", &data).await?;
 
-        // Sum total bytes used (from file sizes in inodes)
-        let mut stmt = self
+        let ino = fs.resolve_path("/ordered.bin").await?.unwrap();
+
+        // Query chunks in order
+        let mut rows = fs
             .conn
-            .prepare_cached("SELECT COALESCE(SUM(size), 0) FROM fs_inode")
+            .query(
+                "SELECT chunk_index FROM fs_data WHERE ino = ? ORDER BY chunk_index",
+                (ino,),
+            )
             .await?;
-        let mut rows = stmt.query(()).await?;
 
-        let bytes_used = if let Some(row) = rows.next().await? {
-            row.get_value(0)
+        let mut indices = Vec::new();
+        while let Some(row) = rows.next().await? {
+            let idx = row
+                .get_value(0)
                 .ok()
                 .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0) as u64
-        } else {
-            0
-        };
+                .unwrap_or(-1);
+            indices.push(idx);
+        }
 
-        Ok(FilesystemStats { inodes, bytes_used })
-    }
+        assert_eq!(indices, vec![0, 1, 2, 3, 4]);
 
-    /// Synchronize file data to persistent storage
-    ///
-    /// Temporarily enables FULL synchronous mode, runs a transaction to force
-    /// a checkpoint, then restores OFF mode. This ensures durability while
-    /// maintaining high performance for normal operations.
-    ///
-    /// Note: The path parameter is ignored since all data is in a single database.
-    pub async fn fsync(&self, _path: &str) -> Result<()> {
-        self.conn
-            .prepare_cached("PRAGMA synchronous = FULL")
-            .await?
-            .execute(())
-            .await?;
-        self.conn.prepare_cached("BEGIN").await?.execute(()).await?;
-        self.conn
-            .prepare_cached("COMMIT")
-            .await?
-            .execute(())
-            .await?;
-        self.conn
-            .prepare_cached("PRAGMA synchronous = OFF")
-            .await?
-            .execute(())
-            .await?;
         Ok(())
     }
 
-    /// Open a file and return a file handle.
-    ///
-    /// The returned handle can be used for efficient read/write/fsync operations
-    /// without requiring path lookups on each operation.
-    pub async fn open(&self, path: &str) -> Result<BoxedFile> {
-        let path = self.normalize_path(path);
-        let ino = self.resolve_path(&path).await?.ok_or(FsError::NotFound)?;
+    // ==================== Cleanup Tests ====================
 
-        Ok(Arc::new(AgentFSFile {
-            conn: self.conn.clone(),
-            ino,
-            chunk_size: self.chunk_size,
-        }))
-    }
+    #[tokio::test]
+    async fn test_delete_file_removes_all_chunks() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-    /// Get the number of chunks for a given inode (for testing)
-    #[cfg(test)]
-    async fn get_chunk_count(&self, ino: i64) -> Result<i64> {
-        let mut rows = self
+        let chunk_size = fs.chunk_size();
+        // Create multi-chunk file
+        let data = vec![0u8; chunk_size * 4];
+        fs.write_file("/deleteme.txt", &data).await?;
+
+        let ino = fs.resolve_path("/deleteme.txt").await?.unwrap();
+        assert_eq!(fs.get_chunk_count(ino).await?, 4);
+
+        // Delete the file
+        fs.remove("/deleteme.txt").await?;
+
+        // Verify all chunks are gone
+        let mut rows = fs
             .conn
             .query("SELECT COUNT(*) FROM fs_data WHERE ino = ?", (ino,))
             .await?;
 
-        if let Some(row) = rows.next().await? {
-            Ok(row
-                .get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(0))
-        } else {
-            Ok(0)
-        }
-    }
-}
+        let count = rows
+            .next()
+            .await?
+            .and_then(|r| r.get_value(0).ok().and_then(|v| v.as_integer().copied()))
+            .unwrap_or(-1);
 
-#[async_trait]
-impl FileSystem for AgentFS {
-    async fn stat(&self, path: &str) -> Result<Option<Stats>> {
-        AgentFS::stat(self, path).await
-    }
+        assert_eq!(count, 0, "All chunks should be deleted");
 
-    async fn lstat(&self, path: &str) -> Result<Option<Stats>> {
-        AgentFS::lstat(self, path).await
+        Ok(())
     }
 
-    async fn read_file(&self, path: &str) -> Result<Option<Vec<u8>>> {
-        AgentFS::read_file(self, path).await
-    }
+    #[tokio::test]
+    async fn test_multiple_files_different_sizes() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
+
+        let chunk_size = fs.chunk_size();
+
+        // Create files of various sizes
+        let files = vec![
+            ("/tiny.txt", 10),
+            ("/small.txt", chunk_size / 2),
+            ("/exact.txt", chunk_size),
+            ("/medium.txt", chunk_size * 2 + 100),
+            ("/large.txt", chunk_size * 5),
+        ];
+
+        for (path, size) in &files {
+            let data: Vec<u8> = (0..*size).map(|i| (i % 256) as u8).collect();
+            fs.write_file(path, &data).await?;
+        }
 
-    async fn write_file(&self, path: &str, data: &[u8]) -> Result<()> {
-        AgentFS::write_file(self, path, data).await
-    }
+        // Verify each file has correct data and chunk count
+        for (path, size) in &files {
+            let read_data = fs.read_file(path).await?.unwrap();
+            assert_eq!(read_data.len(), *size, "Size mismatch for {}", path);
 
-    async fn readdir(&self, path: &str) -> Result<Option<Vec<String>>> {
-        AgentFS::readdir(self, path).await
-    }
+            let expected_data: Vec<u8> = (0..*size).map(|i| (i % 256) as u8).collect();
+            assert_eq!(read_data, expected_data, "Data mismatch for {}", path);
 
-    async fn readdir_plus(&self, path: &str) -> Result<Option<Vec<DirEntry>>> {
-        AgentFS::readdir_plus(self, path).await
-    }
+            let expected_chunks = size.div_ceil(chunk_size);
+            let ino = fs.resolve_path(path).await?.unwrap();
+            let actual_chunks = fs.get_chunk_count(ino).await? as usize;
+            assert_eq!(
+                actual_chunks, expected_chunks,
+                "Chunk count mismatch for {}",
+                path
+            );
+        }
 
-    async fn mkdir(&self, path: &str) -> Result<()> {
-        AgentFS::mkdir(self, path).await
+        Ok(())
     }
 
-    async fn remove(&self, path: &str) -> Result<()> {
-        AgentFS::remove(self, path).await
-    }
+    #[tokio::test]
+    async fn test_pread_basic() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-    async fn chmod(&self, path: &str, mode: u32) -> Result<()> {
-        AgentFS::chmod(self, path, mode).await
-    }
+        // Write a file with known content
+        let data: Vec<u8> = (0..100).collect();
+        fs.write_file("/test.txt", &data).await?;
 
-    async fn rename(&self, from: &str, to: &str) -> Result<()> {
-        AgentFS::rename(self, from, to).await
-    }
+        // Read from the beginning
+        let result = fs.pread("/test.txt", 0, 10).await?.unwrap();
+        assert_eq!(result, &data[0..10]);
 
-    async fn symlink(&self, target: &str, linkpath: &str) -> Result<()> {
-        AgentFS::symlink(self, target, linkpath).await
-    }
+        // Read from the middle
+        let result = fs.pread("/test.txt", 50, 20).await?.unwrap();
+        assert_eq!(result, &data[50..70]);
 
-    async fn link(&self, oldpath: &str, newpath: &str) -> Result<()> {
-        AgentFS::link(self, oldpath, newpath).await
-    }
+        // Read from near the end
+        let result = fs.pread("/test.txt", 90, 10).await?.unwrap();
+        assert_eq!(result, &data[90..100]);
 
-    async fn readlink(&self, path: &str) -> Result<Option<String>> {
-        AgentFS::readlink(self, path).await
+        Ok(())
     }
 
-    async fn statfs(&self) -> Result<FilesystemStats> {
-        AgentFS::statfs(self).await
-    }
+    #[tokio::test]
+    async fn test_pread_past_eof() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-    async fn open(&self, path: &str) -> Result<BoxedFile> {
-        AgentFS::open(self, path).await
-    }
+        let data: Vec<u8> = (0..50).collect();
+        fs.write_file("/test.txt", &data).await?;
 
-    async fn create_file(&self, path: &str, mode: u32) -> Result<(Stats, BoxedFile)> {
-        AgentFS::create_file(self, path, mode).await
-    }
-}
+        // Read starting past EOF should return empty
+        let result = fs.pread("/test.txt", 100, 10).await?.unwrap();
+        assert!(result.is_empty());
 
-#[cfg(test)]
-mod tests {
-    use super::*;
-    use tempfile::tempdir;
+        // Read that extends past EOF should return only available data
+        let result = fs.pread("/test.txt", 40, 20).await?.unwrap();
+        assert_eq!(result, &data[40..50]);
 
-    async fn create_test_fs() -> Result<(AgentFS, tempfile::TempDir)> {
-        let dir = tempdir()?;
-        let db_path = dir.path().join("test.db");
-        let fs = AgentFS::new(db_path.to_str().unwrap()).await?;
-        Ok((fs, dir))
+        Ok(())
     }
 
-    // ==================== Chunk Size Boundary Tests ====================
-
     #[tokio::test]
-    async fn test_file_smaller_than_chunk_size() -> Result<()> {
+    async fn test_pread_nonexistent_file() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Write a file smaller than chunk_size (100 bytes)
-        let data = vec![0u8; 100];
-        fs.write_file("/small.txt", &data).await?;
-
-        // Read it back
-        let read_data = fs.read_file("/small.txt").await?.unwrap();
-        assert_eq!(read_data.len(), 100);
-        assert_eq!(read_data, data);
-
-        // Verify only 1 chunk was created
-        let ino = fs.resolve_path("/small.txt").await?.unwrap();
-        let chunk_count = fs.get_chunk_count(ino).await?;
-        assert_eq!(chunk_count, 1);
+        let result = fs.pread("/nonexistent.txt", 0, 10).await?;
+        assert!(result.is_none());
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_file_exactly_chunk_size() -> Result<()> {
+    async fn test_pread_across_chunks() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-
-        // Write exactly chunk_size bytes
         let chunk_size = fs.chunk_size();
-        let data: Vec<u8> = (0..chunk_size).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/exact.txt", &data).await?;
 
-        // Read it back
-        let read_data = fs.read_file("/exact.txt").await?.unwrap();
-        assert_eq!(read_data.len(), chunk_size);
-        assert_eq!(read_data, data);
+        // Create data spanning multiple chunks
+        let data: Vec<u8> = (0..(chunk_size * 3)).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/test.txt", &data).await?;
 
-        // Verify only 1 chunk was created
-        let ino = fs.resolve_path("/exact.txt").await?.unwrap();
-        let chunk_count = fs.get_chunk_count(ino).await?;
-        assert_eq!(chunk_count, 1);
+        // Read across chunk boundary
+        let start = chunk_size - 10;
+        let result = fs.pread("/test.txt", start as u64, 20).await?.unwrap();
+        assert_eq!(result, &data[start..start + 20]);
+
+        // Read spanning multiple chunks
+        let start = chunk_size / 2;
+        let size = chunk_size * 2;
+        let result = fs
+            .pread("/test.txt", start as u64, size as u64)
+            .await?
+            .unwrap();
+        assert_eq!(result, &data[start..start + size]);
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_file_one_byte_over_chunk_size() -> Result<()> {
+    async fn test_pwrite_basic() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Write chunk_size + 1 bytes
-        let chunk_size = fs.chunk_size();
-        let data: Vec<u8> = (0..=chunk_size).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/overflow.txt", &data).await?;
+        // Write initial data
+        let data: Vec<u8> = vec![0; 100];
+        fs.write_file("/test.txt", &data).await?;
 
-        // Read it back
-        let read_data = fs.read_file("/overflow.txt").await?.unwrap();
-        assert_eq!(read_data.len(), chunk_size + 1);
-        assert_eq!(read_data, data);
+        // Overwrite in the middle
+        fs.pwrite("/test.txt", 50, &[1, 2, 3, 4, 5]).await?;
 
-        // Verify 2 chunks were created
-        let ino = fs.resolve_path("/overflow.txt").await?.unwrap();
-        let chunk_count = fs.get_chunk_count(ino).await?;
-        assert_eq!(chunk_count, 2);
+        let result = fs.read_file("/test.txt").await?.unwrap();
+        assert_eq!(result.len(), 100);
+        assert_eq!(&result[50..55], &[1, 2, 3, 4, 5]);
+        assert_eq!(&result[0..50], &vec![0u8; 50][..]);
+        assert_eq!(&result[55..100], &vec![0u8; 45][..]);
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_file_spanning_multiple_chunks() -> Result<()> {
+    async fn test_pwrite_extend_file() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Write ~2.5 chunks worth of data
-        let chunk_size = fs.chunk_size();
-        let data_size = chunk_size * 2 + chunk_size / 2;
-        let data: Vec<u8> = (0..data_size).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/multi.txt", &data).await?;
+        // Write initial data
+        let data: Vec<u8> = vec![1; 50];
+        fs.write_file("/test.txt", &data).await?;
 
-        // Read it back
-        let read_data = fs.read_file("/multi.txt").await?.unwrap();
-        assert_eq!(read_data.len(), data_size);
-        assert_eq!(read_data, data);
+        // Write past EOF - should extend with zeros
+        fs.pwrite("/test.txt", 100, &[2, 2, 2, 2, 2]).await?;
 
-        // Verify 3 chunks were created
-        let ino = fs.resolve_path("/multi.txt").await?.unwrap();
-        let chunk_count = fs.get_chunk_count(ino).await?;
-        assert_eq!(chunk_count, 3);
+        let result = fs.read_file("/test.txt").await?.unwrap();
+        assert_eq!(result.len(), 105);
+        assert_eq!(&result[0..50], &vec![1u8; 50][..]);
+        assert_eq!(&result[50..100], &vec![0u8; 50][..]);
+        assert_eq!(&result[100..105], &[2, 2, 2, 2, 2]);
 
         Ok(())
     }
 
-    // ==================== Data Integrity Tests ====================
-
     #[tokio::test]
-    async fn test_roundtrip_byte_for_byte() -> Result<()> {
+    async fn test_pwrite_creates_file() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Create data that spans chunk boundaries with identifiable patterns
-        let chunk_size = fs.chunk_size();
-        let data_size = chunk_size * 3 + 123; // Odd size spanning 4 chunks
-
-        let data: Vec<u8> = (0..data_size).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/roundtrip.bin", &data).await?;
+        // pwrite to a non-existent file should create it
+        fs.pwrite("/new.txt", 0, &[1, 2, 3]).await?;
 
-        let read_data = fs.read_file("/roundtrip.bin").await?.unwrap();
-        assert_eq!(read_data.len(), data_size);
-        assert_eq!(read_data, data, "Data mismatch after roundtrip");
+        let result = fs.read_file("/new.txt").await?.unwrap();
+        assert_eq!(result, &[1, 2, 3]);
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_binary_data_with_null_bytes() -> Result<()> {
+    async fn test_pwrite_across_chunks() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-
         let chunk_size = fs.chunk_size();
-        // Create data with null bytes at chunk boundaries
-        let mut data = vec![0u8; chunk_size * 2 + 100];
-        // Put nulls at the chunk boundary
-        data[chunk_size - 1] = 0;
-        data[chunk_size] = 0;
-        data[chunk_size + 1] = 0;
-        // Put some non-null bytes around
-        data[chunk_size - 2] = 0xFF;
-        data[chunk_size + 2] = 0xFF;
 
-        fs.write_file("/nulls.bin", &data).await?;
-        let read_data = fs.read_file("/nulls.bin").await?.unwrap();
+        // Create initial data spanning multiple chunks
+        let data: Vec<u8> = vec![0; chunk_size * 3];
+        fs.write_file("/test.txt", &data).await?;
 
-        assert_eq!(read_data, data, "Null bytes at chunk boundary corrupted");
+        // Write across chunk boundary
+        let write_data: Vec<u8> = (0..20).collect();
+        let start = chunk_size - 10;
+        fs.pwrite("/test.txt", start as u64, &write_data).await?;
+
+        let result = fs.read_file("/test.txt").await?.unwrap();
+        assert_eq!(&result[start..start + 20], &write_data[..]);
+
+        // Verify surrounding data is unchanged
+        assert_eq!(&result[0..start], &vec![0u8; start][..]);
+        assert_eq!(
+            &result[start + 20..],
+            &vec![0u8; chunk_size * 3 - start - 20][..]
+        );
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_chunk_ordering() -> Result<()> {
+    async fn test_pread_pwrite_roundtrip() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-
         let chunk_size = fs.chunk_size();
-        // Create sequential bytes spanning multiple chunks
-        let data_size = chunk_size * 5;
-        let data: Vec<u8> = (0..data_size).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/sequential.bin", &data).await?;
 
-        let read_data = fs.read_file("/sequential.bin").await?.unwrap();
+        // Create a file
+        let initial: Vec<u8> = (0..(chunk_size * 2)).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/test.txt", &initial).await?;
+
+        // Write some data at various offsets
+        let patches = vec![
+            (0u64, vec![0xAAu8; 10]),
+            (chunk_size as u64 - 5, vec![0xBB; 10]),
+            (chunk_size as u64 * 2 - 1, vec![0xCC; 1]),
+        ];
+
+        for (offset, data) in &patches {
+            fs.pwrite("/test.txt", *offset, data).await?;
+        }
 
-        // Verify every byte is in the correct position
-        for (i, (&expected, &actual)) in data.iter().zip(read_data.iter()).enumerate() {
-            assert_eq!(
-                expected, actual,
-                "Byte mismatch at position {}: expected {}, got {}",
-                i, expected, actual
-            );
+        // Verify with pread
+        for (offset, expected) in &patches {
+            let result = fs
+                .pread("/test.txt", *offset, expected.len() as u64)
+                .await?
+                .unwrap();
+            assert_eq!(&result, expected);
         }
 
         Ok(())
     }
 
-    // ==================== Edge Case Tests ====================
+    // ─────────────────────────────────────────────────────────────
+    // Truncate Tests
+    // ─────────────────────────────────────────────────────────────
 
     #[tokio::test]
-    async fn test_empty_file() -> Result<()> {
+    async fn test_truncate_to_zero() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Write empty file
-        fs.write_file("/empty.txt", &[]).await?;
+        // Create a file with some data
+        let data: Vec<u8> = (0..100).collect();
+        fs.write_file("/test.txt", &data).await?;
 
-        // Read it back
-        let read_data = fs.read_file("/empty.txt").await?.unwrap();
-        assert!(read_data.is_empty());
+        // Truncate to zero
+        fs.truncate("/test.txt", 0).await?;
 
-        // Verify 0 chunks were created
-        let ino = fs.resolve_path("/empty.txt").await?.unwrap();
-        let chunk_count = fs.get_chunk_count(ino).await?;
-        assert_eq!(chunk_count, 0);
+        // Verify file is empty
+        let result = fs.read_file("/test.txt").await?.unwrap();
+        assert!(result.is_empty());
 
-        // Verify size is 0
-        let stats = fs.stat("/empty.txt").await?.unwrap();
+        // Verify stat shows size 0
+        let stats = fs.stat("/test.txt").await?.unwrap();
         assert_eq!(stats.size, 0);
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_overwrite_existing_file() -> Result<()> {
+    async fn test_truncate_smaller_within_chunk() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        let chunk_size = fs.chunk_size();
-
-        // Write initial large file (3 chunks)
-        let initial_data: Vec<u8> = (0..chunk_size * 3).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/overwrite.txt", &initial_data).await?;
-
-        let ino = fs.resolve_path("/overwrite.txt").await?.unwrap();
-        let initial_chunk_count = fs.get_chunk_count(ino).await?;
-        assert_eq!(initial_chunk_count, 3);
-
-        // Overwrite with smaller file (1 chunk)
-        let new_data = vec![42u8; 100];
-        fs.write_file("/overwrite.txt", &new_data).await?;
-
-        // Verify old chunks are gone and new data is correct
-        let read_data = fs.read_file("/overwrite.txt").await?.unwrap();
-        assert_eq!(read_data, new_data);
+        // Create a file smaller than chunk size
+        let data: Vec<u8> = (0..100).collect();
+        fs.write_file("/test.txt", &data).await?;
 
-        let new_chunk_count = fs.get_chunk_count(ino).await?;
-        assert_eq!(new_chunk_count, 1);
+        // Truncate to 50 bytes
+        fs.truncate("/test.txt", 50).await?;
 
-        // Verify size is updated
-        let stats = fs.stat("/overwrite.txt").await?.unwrap();
-        assert_eq!(stats.size, 100);
+        // Verify data is truncated correctly
+        let result = fs.read_file("/test.txt").await?.unwrap();
+        assert_eq!(result.len(), 50);
+        assert_eq!(result, &data[..50]);
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_overwrite_with_larger_file() -> Result<()> {
+    async fn test_truncate_across_chunk_boundary() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-
         let chunk_size = fs.chunk_size();
 
-        // Write initial small file (1 chunk)
-        let initial_data = vec![1u8; 100];
-        fs.write_file("/grow.txt", &initial_data).await?;
-
-        let ino = fs.resolve_path("/grow.txt").await?.unwrap();
-        assert_eq!(fs.get_chunk_count(ino).await?, 1);
+        // Create a file spanning multiple chunks
+        let data: Vec<u8> = (0..(chunk_size * 3)).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/test.txt", &data).await?;
 
-        // Overwrite with larger file (3 chunks)
-        let new_data: Vec<u8> = (0..chunk_size * 3).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/grow.txt", &new_data).await?;
+        // Truncate to middle of second chunk
+        let new_size = chunk_size + chunk_size / 2;
+        fs.truncate("/test.txt", new_size as u64).await?;
 
-        // Verify data is correct
-        let read_data = fs.read_file("/grow.txt").await?.unwrap();
-        assert_eq!(read_data, new_data);
-        assert_eq!(fs.get_chunk_count(ino).await?, 3);
+        // Verify data
+        let result = fs.read_file("/test.txt").await?.unwrap();
+        assert_eq!(result.len(), new_size);
+        assert_eq!(result, &data[..new_size]);
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_very_large_file() -> Result<()> {
+    async fn test_truncate_extend_file() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Write 1MB file
-        let data_size = 1024 * 1024;
-        let data: Vec<u8> = (0..data_size).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/large.bin", &data).await?;
+        // Create a small file
+        let data: Vec<u8> = (0..50).collect();
+        fs.write_file("/test.txt", &data).await?;
 
-        let read_data = fs.read_file("/large.bin").await?.unwrap();
-        assert_eq!(read_data.len(), data_size);
-        assert_eq!(read_data, data);
+        // Extend to 100 bytes
+        fs.truncate("/test.txt", 100).await?;
 
-        // Verify correct number of chunks
-        let chunk_size = fs.chunk_size();
-        let expected_chunks = data_size.div_ceil(chunk_size);
-        let ino = fs.resolve_path("/large.bin").await?.unwrap();
-        let actual_chunks = fs.get_chunk_count(ino).await? as usize;
-        assert_eq!(actual_chunks, expected_chunks);
+        // Verify size increased
+        let stats = fs.stat("/test.txt").await?.unwrap();
+        assert_eq!(stats.size, 100);
+
+        // Original data should be preserved, rest should be zeros (sparse)
+        let result = fs.read_file("/test.txt").await?.unwrap();
+        assert_eq!(result.len(), 100);
+        assert_eq!(&result[..50], &data[..]);
 
         Ok(())
     }
 
-    // ==================== Configuration Tests ====================
-
     #[tokio::test]
-    async fn test_default_chunk_size() -> Result<()> {
+    async fn test_truncate_nonexistent_file() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        assert_eq!(fs.chunk_size(), DEFAULT_CHUNK_SIZE);
-        assert_eq!(fs.chunk_size(), 4096);
+        // Truncate non-existent file should fail
+        let result = fs.truncate("/nonexistent.txt", 100).await;
+        assert!(result.is_err());
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_chunk_size_accessor() -> Result<()> {
+    async fn test_truncate_at_chunk_boundary() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-
         let chunk_size = fs.chunk_size();
-        assert!(chunk_size > 0);
 
-        // Write data and verify chunks match expected based on chunk_size
-        let data = vec![0u8; chunk_size * 2 + 1];
-        fs.write_file("/test.bin", &data).await?;
+        // Create a file spanning multiple chunks
+        let data: Vec<u8> = (0..(chunk_size * 3)).map(|i| (i % 256) as u8).collect();
+        fs.write_file("/test.txt", &data).await?;
 
-        let ino = fs.resolve_path("/test.bin").await?.unwrap();
-        let chunk_count = fs.get_chunk_count(ino).await?;
-        assert_eq!(chunk_count, 3);
+        // Truncate exactly at chunk boundary
+        fs.truncate("/test.txt", chunk_size as u64).await?;
+
+        // Verify
+        let result = fs.read_file("/test.txt").await?.unwrap();
+        assert_eq!(result.len(), chunk_size);
+        assert_eq!(result, &data[..chunk_size]);
 
         Ok(())
     }
 
+    // ─────────────────────────────────────────────────────────────
+    // Rename Tests
+    // ─────────────────────────────────────────────────────────────
+
     #[tokio::test]
-    async fn test_config_persistence() -> Result<()> {
+    async fn test_rename_file_same_directory() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Query fs_config table directly
-        let mut rows = fs
-            .conn
-            .query("SELECT value FROM fs_config WHERE key = 'chunk_size'", ())
-            .await?;
+        // Create a file
+        let data = b"hello world";
+        fs.write_file("/old.txt", data).await?;
 
-        let row = rows.next().await?.expect("chunk_size config should exist");
-        let value = row
-            .get_value(0)
-            .ok()
-            .and_then(|v| match v {
-                Value::Text(s) => Some(s.clone()),
-                _ => None,
-            })
-            .expect("chunk_size should be a text value");
+        // Rename it
+        fs.rename("/old.txt", "/new.txt").await?;
 
-        assert_eq!(value, "4096");
+        // Old path should not exist
+        assert!(fs.stat("/old.txt").await?.is_none());
+
+        // New path should exist with same data
+        let result = fs.read_file("/new.txt").await?.unwrap();
+        assert_eq!(result, data);
 
         Ok(())
     }
 
-    // ==================== Schema Tests ====================
-
     #[tokio::test]
-    async fn test_chunk_index_uniqueness() -> Result<()> {
+    async fn test_rename_file_to_different_directory() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Write a file to create chunks
-        let chunk_size = fs.chunk_size();
-        let data = vec![0u8; chunk_size * 2];
-        fs.write_file("/unique.txt", &data).await?;
+        // Create directory and file
+        fs.mkdir("/subdir").await?;
+        let data = b"test data";
+        fs.write_file("/file.txt", data).await?;
 
-        let ino = fs.resolve_path("/unique.txt").await?.unwrap();
+        // Move file to subdirectory
+        fs.rename("/file.txt", "/subdir/file.txt").await?;
 
-        // Try to insert a duplicate chunk - should fail due to PRIMARY KEY constraint
-        let result = fs
-            .conn
-            .execute(
-                "INSERT INTO fs_data (ino, chunk_index, data) VALUES (?, 0, ?)",
-                (ino, vec![1u8; 10]),
-            )
-            .await;
+        // Old path should not exist
+        assert!(fs.stat("/file.txt").await?.is_none());
 
-        assert!(result.is_err(), "Duplicate chunk_index should be rejected");
+        // New path should exist
+        let result = fs.read_file("/subdir/file.txt").await?.unwrap();
+        assert_eq!(result, data);
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_chunk_ordering_in_database() -> Result<()> {
-        let (fs, _dir) = create_test_fs().await?;
-
-        let chunk_size = fs.chunk_size();
-        // Create 5 chunks with identifiable data
-        let data_size = chunk_size * 5;
-        let data: Vec<u8> = (0..data_size).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/ordered.bin", &data).await?;
-
-        let ino = fs.resolve_path("/ordered.bin").await?.unwrap();
-
-        // Query chunks in order
-        let mut rows = fs
-            .conn
-            .query(
-                "SELECT chunk_index FROM fs_data WHERE ino = ? ORDER BY chunk_index",
-                (ino,),
-            )
-            .await?;
-
-        let mut indices = Vec::new();
-        while let Some(row) = rows.next().await? {
-            let idx = row
-                .get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .unwrap_or(-1);
-            indices.push(idx);
-        }
+    async fn test_rename_overwrite_existing_file() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-        assert_eq!(indices, vec![0, 1, 2, 3, 4]);
+        // Create two files
+        fs.write_file("/src.txt", b"source").await?;
+        fs.write_file("/dst.txt", b"destination").await?;
+
+        // Rename src to dst (overwrites dst)
+        fs.rename("/src.txt", "/dst.txt").await?;
+
+        // Only dst should exist with src's content
+        assert!(fs.stat("/src.txt").await?.is_none());
+        let result = fs.read_file("/dst.txt").await?.unwrap();
+        assert_eq!(result, b"source");
 
         Ok(())
     }
 
-    // ==================== Cleanup Tests ====================
-
     #[tokio::test]
-    async fn test_delete_file_removes_all_chunks() -> Result<()> {
+    async fn test_rename_directory() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        let chunk_size = fs.chunk_size();
-        // Create multi-chunk file
-        let data = vec![0u8; chunk_size * 4];
-        fs.write_file("/deleteme.txt", &data).await?;
-
-        let ino = fs.resolve_path("/deleteme.txt").await?.unwrap();
-        assert_eq!(fs.get_chunk_count(ino).await?, 4);
-
-        // Delete the file
-        fs.remove("/deleteme.txt").await?;
+        // Create directory with a file inside
+        fs.mkdir("/olddir").await?;
+        fs.write_file("/olddir/file.txt", b"content").await?;
 
-        // Verify all chunks are gone
-        let mut rows = fs
-            .conn
-            .query("SELECT COUNT(*) FROM fs_data WHERE ino = ?", (ino,))
-            .await?;
+        // Rename directory
+        fs.rename("/olddir", "/newdir").await?;
 
-        let count = rows
-            .next()
-            .await?
-            .and_then(|r| r.get_value(0).ok().and_then(|v| v.as_integer().copied()))
-            .unwrap_or(-1);
+        // Old path should not exist
+        assert!(fs.stat("/olddir").await?.is_none());
 
-        assert_eq!(count, 0, "All chunks should be deleted");
+        // New path should exist and contain the file
+        assert!(fs.stat("/newdir").await?.is_some());
+        let result = fs.read_file("/newdir/file.txt").await?.unwrap();
+        assert_eq!(result, b"content");
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_multiple_files_different_sizes() -> Result<()> {
+    async fn test_rename_directory_into_own_subtree_fails() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        let chunk_size = fs.chunk_size();
+        // Create nested directories
+        fs.mkdir("/parent").await?;
+        fs.mkdir("/parent/child").await?;
 
-        // Create files of various sizes
-        let files = vec![
-            ("/tiny.txt", 10),
-            ("/small.txt", chunk_size / 2),
-            ("/exact.txt", chunk_size),
-            ("/medium.txt", chunk_size * 2 + 100),
-            ("/large.txt", chunk_size * 5),
-        ];
+        // Try to rename parent into its child - should fail
+        let result = fs.rename("/parent", "/parent/child/parent").await;
+        assert!(result.is_err());
 
-        for (path, size) in &files {
-            let data: Vec<u8> = (0..*size).map(|i| (i % 256) as u8).collect();
-            fs.write_file(path, &data).await?;
-        }
+        // Original structure should be intact
+        assert!(fs.stat("/parent").await?.is_some());
+        assert!(fs.stat("/parent/child").await?.is_some());
 
-        // Verify each file has correct data and chunk count
-        for (path, size) in &files {
-            let read_data = fs.read_file(path).await?.unwrap();
-            assert_eq!(read_data.len(), *size, "Size mismatch for {}", path);
+        Ok(())
+    }
 
-            let expected_data: Vec<u8> = (0..*size).map(|i| (i % 256) as u8).collect();
-            assert_eq!(read_data, expected_data, "Data mismatch for {}", path);
+    #[tokio::test]
+    async fn test_rename_root_fails() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
 
-            let expected_chunks = size.div_ceil(chunk_size);
-            let ino = fs.resolve_path(path).await?.unwrap();
-            let actual_chunks = fs.get_chunk_count(ino).await? as usize;
-            assert_eq!(
-                actual_chunks, expected_chunks,
-                "Chunk count mismatch for {}",
-                path
-            );
-        }
+        // Try to rename root - should fail
+        let result = fs.rename("/", "/newroot").await;
+        assert!(result.is_err());
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_pread_basic() -> Result<()> {
+    async fn test_rename_to_root_fails() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Write a file with known content
-        let data: Vec<u8> = (0..100).collect();
-        fs.write_file("/test.txt", &data).await?;
+        fs.write_file("/file.txt", b"data").await?;
 
-        // Read from the beginning
-        let result = fs.pread("/test.txt", 0, 10).await?.unwrap();
-        assert_eq!(result, &data[0..10]);
+        // Try to rename to root - should fail
+        let result = fs.rename("/file.txt", "/").await;
+        assert!(result.is_err());
 
-        // Read from the middle
-        let result = fs.pread("/test.txt", 50, 20).await?.unwrap();
-        assert_eq!(result, &data[50..70]);
+        Ok(())
+    }
 
-        // Read from near the end
-        let result = fs.pread("/test.txt", 90, 10).await?.unwrap();
-        assert_eq!(result, &data[90..100]);
+    #[tokio::test]
+    async fn test_rename_nonexistent_source_fails() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
+
+        // Try to rename non-existent file
+        let result = fs.rename("/nonexistent.txt", "/new.txt").await;
+        assert!(result.is_err());
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_pread_past_eof() -> Result<()> {
+    async fn test_rename_overwrite_nonempty_directory_fails() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        let data: Vec<u8> = (0..50).collect();
-        fs.write_file("/test.txt", &data).await?;
+        // Create source directory and target directory with content
+        fs.mkdir("/src").await?;
+        fs.mkdir("/dst").await?;
+        fs.write_file("/dst/file.txt", b"content").await?;
 
-        // Read starting past EOF should return empty
-        let result = fs.pread("/test.txt", 100, 10).await?.unwrap();
-        assert!(result.is_empty());
+        // Try to rename src to dst (dst is not empty) - should fail
+        let result = fs.rename("/src", "/dst").await;
+        assert!(result.is_err());
 
-        // Read that extends past EOF should return only available data
-        let result = fs.pread("/test.txt", 40, 20).await?.unwrap();
-        assert_eq!(result, &data[40..50]);
+        // Both directories should still exist
+        assert!(fs.stat("/src").await?.is_some());
+        assert!(fs.stat("/dst").await?.is_some());
+        assert!(fs.stat("/dst/file.txt").await?.is_some());
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_pread_nonexistent_file() -> Result<()> {
+    async fn test_rename_file_to_directory_fails() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        let result = fs.pread("/nonexistent.txt", 0, 10).await?;
-        assert!(result.is_none());
+        // Create a file and an empty directory
+        fs.write_file("/file.txt", b"data").await?;
+        fs.mkdir("/dir").await?;
+
+        // Try to rename file over directory - should fail
+        let result = fs.rename("/file.txt", "/dir").await;
+        assert!(result.is_err());
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_pread_across_chunks() -> Result<()> {
+    async fn test_rename_directory_to_file_fails() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-        let chunk_size = fs.chunk_size();
-
-        // Create data spanning multiple chunks
-        let data: Vec<u8> = (0..(chunk_size * 3)).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/test.txt", &data).await?;
 
-        // Read across chunk boundary
-        let start = chunk_size - 10;
-        let result = fs.pread("/test.txt", start as u64, 20).await?.unwrap();
-        assert_eq!(result, &data[start..start + 20]);
+        // Create a directory and a file
+        fs.mkdir("/dir").await?;
+        fs.write_file("/file.txt", b"data").await?;
 
-        // Read spanning multiple chunks
-        let start = chunk_size / 2;
-        let size = chunk_size * 2;
-        let result = fs
-            .pread("/test.txt", start as u64, size as u64)
-            .await?
-            .unwrap();
-        assert_eq!(result, &data[start..start + size]);
+        // Try to rename directory over file - should fail
+        let result = fs.rename("/dir", "/file.txt").await;
+        assert!(result.is_err());
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_pwrite_basic() -> Result<()> {
+    async fn test_rename_updates_ctime() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Write initial data
-        let data: Vec<u8> = vec![0; 100];
-        fs.write_file("/test.txt", &data).await?;
+        // Create a file
+        fs.write_file("/old.txt", b"data").await?;
+        let stats_before = fs.stat("/old.txt").await?.unwrap();
 
-        // Overwrite in the middle
-        fs.pwrite("/test.txt", 50, &[1, 2, 3, 4, 5]).await?;
+        // Small delay to ensure time changes
+        tokio::time::sleep(std::time::Duration::from_millis(10)).await;
 
-        let result = fs.read_file("/test.txt").await?.unwrap();
-        assert_eq!(result.len(), 100);
-        assert_eq!(&result[50..55], &[1, 2, 3, 4, 5]);
-        assert_eq!(&result[0..50], &vec![0u8; 50][..]);
-        assert_eq!(&result[55..100], &vec![0u8; 45][..]);
+        // Rename it
+        fs.rename("/old.txt", "/new.txt").await?;
+
+        // ctime should be updated
+        let stats_after = fs.stat("/new.txt").await?.unwrap();
+        assert!(stats_after.ctime >= stats_before.ctime);
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_pwrite_extend_file() -> Result<()> {
+    async fn test_write_file_updates_mode_to_regular_file() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Write initial data
-        let data: Vec<u8> = vec![1; 50];
-        fs.write_file("/test.txt", &data).await?;
+        // Create a target file for the symlink
+        fs.write_file("/target.txt", b"target content").await?;
 
-        // Write past EOF - should extend with zeros
-        fs.pwrite("/test.txt", 100, &[2, 2, 2, 2, 2]).await?;
+        // Create a symlink
+        fs.symlink("/target.txt", "/link.txt").await?;
 
-        let result = fs.read_file("/test.txt").await?.unwrap();
-        assert_eq!(result.len(), 105);
-        assert_eq!(&result[0..50], &vec![1u8; 50][..]);
-        assert_eq!(&result[50..100], &vec![0u8; 50][..]);
-        assert_eq!(&result[100..105], &[2, 2, 2, 2, 2]);
+        // Verify it's a symlink
+        let stats = fs.lstat("/link.txt").await?.unwrap();
+        assert!(stats.is_symlink(), "Should be a symlink before write_file");
+
+        // Overwrite the symlink with write_file
+        fs.write_file("/link.txt", b"new content").await?;
+
+        // Verify it's now a regular file with DEFAULT_FILE_MODE
+        let stats = fs.lstat("/link.txt").await?.unwrap();
+        assert!(stats.is_file(), "Should be a regular file after write_file");
+        assert_eq!(
+            stats.mode, DEFAULT_FILE_MODE,
+            "Mode should be DEFAULT_FILE_MODE after write_file"
+        );
+
+        // Verify the content
+        let content = fs.read_file("/link.txt").await?.unwrap();
+        assert_eq!(content, b"new content");
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_pwrite_creates_file() -> Result<()> {
+    async fn test_chmod_regular_file() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // pwrite to a non-existent file should create it
-        fs.pwrite("/new.txt", 0, &[1, 2, 3]).await?;
+        // Create a file with default permissions
+        fs.write_file("/test.txt", b"content").await?;
+
+        let stats = fs.stat("/test.txt").await?.unwrap();
+        assert_eq!(
+            stats.mode & 0o7777,
+            0o644,
+            "Default file mode should be 0o644"
+        );
+
+        // Change to executable
+        fs.chmod("/test.txt", 0o755).await?;
+
+        let stats = fs.stat("/test.txt").await?.unwrap();
+        assert_eq!(
+            stats.mode & 0o7777,
+            0o755,
+            "Mode should be 0o755 after chmod"
+        );
+        assert!(stats.is_file(), "Should still be a regular file");
+
+        // Change to read-only
+        fs.chmod("/test.txt", 0o444).await?;
 
-        let result = fs.read_file("/new.txt").await?.unwrap();
-        assert_eq!(result, &[1, 2, 3]);
+        let stats = fs.stat("/test.txt").await?.unwrap();
+        assert_eq!(
+            stats.mode & 0o7777,
+            0o444,
+            "Mode should be 0o444 after chmod"
+        );
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_pwrite_across_chunks() -> Result<()> {
+    async fn test_chmod_preserves_file_type() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-        let chunk_size = fs.chunk_size();
-
-        // Create initial data spanning multiple chunks
-        let data: Vec<u8> = vec![0; chunk_size * 3];
-        fs.write_file("/test.txt", &data).await?;
-
-        // Write across chunk boundary
-        let write_data: Vec<u8> = (0..20).collect();
-        let start = chunk_size - 10;
-        fs.pwrite("/test.txt", start as u64, &write_data).await?;
 
-        let result = fs.read_file("/test.txt").await?.unwrap();
-        assert_eq!(&result[start..start + 20], &write_data[..]);
+        // Create a regular file
+        fs.write_file("/file.txt", b"content").await?;
+        fs.chmod("/file.txt", 0o755).await?;
+        let stats = fs.stat("/file.txt").await?.unwrap();
+        assert!(stats.is_file(), "Should remain a regular file after chmod");
 
-        // Verify surrounding data is unchanged
-        assert_eq!(&result[0..start], &vec![0u8; start][..]);
-        assert_eq!(
-            &result[start + 20..],
-            &vec![0u8; chunk_size * 3 - start - 20][..]
+        // Create a directory
+        fs.mkdir("/dir").await?;
+        fs.chmod("/dir", 0o700).await?;
+        let stats = fs.stat("/dir").await?.unwrap();
+        assert!(
+            stats.is_directory(),
+            "Should remain a directory after chmod"
         );
+        assert_eq!(stats.mode & 0o7777, 0o700, "Directory mode should be 0o700");
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_pread_pwrite_roundtrip() -> Result<()> {
+    async fn test_chmod_nonexistent_fails() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-        let chunk_size = fs.chunk_size();
-
-        // Create a file
-        let initial: Vec<u8> = (0..(chunk_size * 2)).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/test.txt", &initial).await?;
-
-        // Write some data at various offsets
-        let patches = vec![
-            (0u64, vec![0xAAu8; 10]),
-            (chunk_size as u64 - 5, vec![0xBB; 10]),
-            (chunk_size as u64 * 2 - 1, vec![0xCC; 1]),
-        ];
-
-        for (offset, data) in &patches {
-            fs.pwrite("/test.txt", *offset, data).await?;
-        }
 
-        // Verify with pread
-        for (offset, expected) in &patches {
-            let result = fs
-                .pread("/test.txt", *offset, expected.len() as u64)
-                .await?
-                .unwrap();
-            assert_eq!(&result, expected);
-        }
+        let result = fs.chmod("/nonexistent.txt", 0o755).await;
+        assert!(result.is_err(), "chmod on nonexistent file should fail");
 
         Ok(())
     }
 
-    // ─────────────────────────────────────────────────────────────
-    // Truncate Tests
-    // ─────────────────────────────────────────────────────────────
-
     #[tokio::test]
-    async fn test_truncate_to_zero() -> Result<()> {
+    async fn test_chmod_symlink() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
 
-        // Create a file with some data
-        let data: Vec<u8> = (0..100).collect();
-        fs.write_file("/test.txt", &data).await?;
-
-        // Truncate to zero
-        fs.truncate("/test.txt", 0).await?;
+        // Create target and symlink
+        fs.write_file("/target.txt", b"content").await?;
+        fs.symlink("/target.txt", "/link.txt").await?;
 
-        // Verify file is empty
-        let result = fs.read_file("/test.txt").await?.unwrap();
-        assert!(result.is_empty());
+        // chmod the symlink path (should work on the symlink inode)
+        fs.chmod("/link.txt", 0o755).await?;
 
-        // Verify stat shows size 0
-        let stats = fs.stat("/test.txt").await?.unwrap();
-        assert_eq!(stats.size, 0);
+        let stats = fs.lstat("/link.txt").await?.unwrap();
+        assert!(stats.is_symlink(), "Should still be a symlink");
 
         Ok(())
     }
 
+    // ==================== Streaming Write Tests ====================
+
     #[tokio::test]
-    async fn test_truncate_smaller_within_chunk() -> Result<()> {
+    async fn test_write_file_from_streams_batches() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        let len = DEFAULT_CHUNK_SIZE * (COPY_BATCH_CHUNKS as usize * 2 + 3) + 7;
+        let data: Vec<u8> = (0..len).map(|i| (i % 251) as u8).collect();
+        fs.write_file("/src.bin", &data).await?;
 
-        // Create a file smaller than chunk size
-        let data: Vec<u8> = (0..100).collect();
-        fs.write_file("/test.txt", &data).await?;
-
-        // Truncate to 50 bytes
-        fs.truncate("/test.txt", 50).await?;
+        let src = fs.open("/src.bin").await?;
+        fs.write_file_from("/dst.bin", src.as_ref(), len as u64, 0..0)
+            .await?;
 
-        // Verify data is truncated correctly
-        let result = fs.read_file("/test.txt").await?.unwrap();
-        assert_eq!(result.len(), 50);
-        assert_eq!(result, &data[..50]);
+        assert_eq!(fs.read_file("/dst.bin").await?.unwrap(), data);
+        let ino = fs.resolve_path("/dst.bin").await?.unwrap();
+        assert_eq!(
+            fs.get_chunk_count(ino).await? as usize,
+            len.div_ceil(DEFAULT_CHUNK_SIZE)
+        );
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_truncate_across_chunk_boundary() -> Result<()> {
+    async fn test_write_file_from_skips_whole_chunks() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-        let chunk_size = fs.chunk_size();
+        let len = DEFAULT_CHUNK_SIZE * 8;
+        fs.write_file("/src.bin", &vec![1u8; len]).await?;
 
-        // Create a file spanning multiple chunks
-        let data: Vec<u8> = (0..(chunk_size * 3)).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/test.txt", &data).await?;
+        // Skip range covers chunks 2..=4 fully and chunks 1 and 5 partially
+        let src = fs.open("/src.bin").await?;
+        let skip = (DEFAULT_CHUNK_SIZE + 1) as u64..(DEFAULT_CHUNK_SIZE * 5 + 1) as u64;
+        fs.write_file_from("/dst.bin", src.as_ref(), len as u64, skip)
+            .await?;
 
-        // Truncate to middle of second chunk
-        let new_size = chunk_size + chunk_size / 2;
-        fs.truncate("/test.txt", new_size as u64).await?;
+        let ino = fs.resolve_path("/dst.bin").await?.unwrap();
+        assert_eq!(fs.get_chunk_count(ino).await?, 5);
 
-        // Verify data
-        let result = fs.read_file("/test.txt").await?.unwrap();
-        assert_eq!(result.len(), new_size);
-        assert_eq!(result, &data[..new_size]);
+        let read = fs.pread("/dst.bin", 0, len as u64).await?.unwrap();
+        assert_eq!(fs.stat("/dst.bin").await?.unwrap().size as usize, len);
+        assert!(read[..DEFAULT_CHUNK_SIZE * 2].iter().all(|&b| b == 1));
+        assert!(read[DEFAULT_CHUNK_SIZE * 2..DEFAULT_CHUNK_SIZE * 5]
+            .iter()
+            .all(|&b| b == 0));
+        assert!(read[DEFAULT_CHUNK_SIZE * 5..].iter().all(|&b| b == 1));
 
         Ok(())
     }
 
+    // ==================== Reader Pool Tests ====================
+
     #[tokio::test]
-    async fn test_truncate_extend_file() -> Result<()> {
+    async fn test_reads_while_writer_holds_transaction() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        fs.write_file("/a.txt", b"committed").await?;
 
-        // Create a small file
-        let data: Vec<u8> = (0..50).collect();
-        fs.write_file("/test.txt", &data).await?;
-
-        // Extend to 100 bytes
-        fs.truncate("/test.txt", 100).await?;
-
-        // Verify size increased
-        let stats = fs.stat("/test.txt").await?.unwrap();
-        assert_eq!(stats.size, 100);
+        // Hold the write lock on the writer connection; reads must still be
+        // served from the reader pool and see the last committed state.
+        let writer = fs.get_connection();
+        writer.execute("BEGIN IMMEDIATE", ()).await?;
+        writer
+            .execute(
+                "UPDATE fs_inode SET size = 0 WHERE ino = (SELECT ino FROM fs_dentry WHERE name = 'a.txt')",
+                (),
+            )
+            .await?;
 
-        // Original data should be preserved, rest should be zeros (sparse)
-        let result = fs.read_file("/test.txt").await?.unwrap();
-        assert_eq!(result.len(), 100);
-        assert_eq!(&result[..50], &data[..]);
+        let stats = fs.lstat("/a.txt").await?.unwrap();
+        assert_eq!(stats.size, 9);
+        assert_eq!(fs.read_file("/a.txt").await?.unwrap(), b"committed");
+        assert_eq!(fs.readdir("/").await?.unwrap(), vec!["a.txt".to_string()]);
 
+        writer.execute("ROLLBACK", ()).await?;
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_truncate_nonexistent_file() -> Result<()> {
-        let (fs, _dir) = create_test_fs().await?;
+    async fn test_open_read_only() -> Result<()> {
+        let (fs, dir) = create_test_fs().await?;
+        fs.mkdir("/dir").await?;
+        fs.write_file("/dir/a.txt", b"stored").await?;
 
-        // Truncate non-existent file should fail
-        let result = fs.truncate("/nonexistent.txt", 100).await;
-        assert!(result.is_err());
+        let db = Builder::new_local(dir.path().join("test.db").to_str().unwrap())
+            .build()
+            .await?;
+        let ro = AgentFS::open_read_only(&db, 2).await?;
+        assert_eq!(ro.read_file("/dir/a.txt").await?.unwrap(), b"stored");
+        assert_eq!(
+            ro.readdir("/dir").await?.unwrap(),
+            vec!["a.txt".to_string()]
+        );
 
+        let read_only =
+            |result: Result<()>| matches!(result, Err(crate::error::Error::Fs(FsError::ReadOnly)));
+        assert!(read_only(ro.write_file("/b.txt", b"x").await));
+        assert!(read_only(ro.mkdir("/sub").await));
+        assert!(read_only(ro.remove("/dir/a.txt").await));
+        let file = ro.open("/dir/a.txt").await?;
+        assert_eq!(file.pread(0, 6).await?, b"stored");
+        assert!(read_only(file.pwrite(0, b"x").await));
+        assert_eq!(fs.read_file("/dir/a.txt").await?.unwrap(), b"stored");
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_truncate_at_chunk_boundary() -> Result<()> {
+    async fn test_concurrent_reads_across_readers() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-        let chunk_size = fs.chunk_size();
-
-        // Create a file spanning multiple chunks
-        let data: Vec<u8> = (0..(chunk_size * 3)).map(|i| (i % 256) as u8).collect();
-        fs.write_file("/test.txt", &data).await?;
-
-        // Truncate exactly at chunk boundary
-        fs.truncate("/test.txt", chunk_size as u64).await?;
+        let data: Vec<u8> = (0..(DEFAULT_CHUNK_SIZE * 3))
+            .map(|i| (i % 251) as u8)
+            .collect();
+        fs.write_file("/shared.bin", &data).await?;
+
+        let mut tasks = Vec::new();
+        for i in 0..(DEFAULT_READER_CONNECTIONS * 4) {
+            let fs = fs.clone();
+            let expected = data.clone();
+            tasks.push(tokio::spawn(async move {
+                let offset = (i * 100) as u64;
+                let read = fs.pread("/shared.bin", offset, 1000).await?.unwrap();
+                assert_eq!(read, &expected[offset as usize..offset as usize + 1000]);
+                Ok::<_, Error>(())
+            }));
+        }
+        for task in tasks {
+            task.await.unwrap()?;
+        }
 
-        // Verify
-        let result = fs.read_file("/test.txt").await?.unwrap();
-        assert_eq!(result.len(), chunk_size);
-        assert_eq!(result, &data[..chunk_size]);
+        // Writes become visible to readers as soon as they commit
+        let file = fs.open("/shared.bin").await?;
+        file.pwrite(0, b"fresh").await?;
+        assert_eq!(file.pread(0, 5).await?, b"fresh");
+        assert_eq!(fs.pread("/shared.bin", 0, 5).await?.unwrap(), b"fresh");
 
         Ok(())
     }
 
-    // ─────────────────────────────────────────────────────────────
-    // Rename Tests
-    // ─────────────────────────────────────────────────────────────
+    // ==================== Inode-Addressed Operation Tests ====================
 
     #[tokio::test]
-    async fn test_rename_file_same_directory() -> Result<()> {
+    async fn test_inode_lookup_getattr_readdir() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        fs.mkdir("/dir").await?;
+        fs.write_file("/dir/file.txt", b"hello").await?;
 
-        // Create a file
-        let data = b"hello world";
-        fs.write_file("/old.txt", data).await?;
+        let dir = fs.lookup(ROOT_INO, "dir").await?.unwrap();
+        assert!(dir.is_directory());
+        let file = fs.lookup(dir.ino, "file.txt").await?.unwrap();
+        assert_eq!(file.size, 5);
+        assert!(fs.lookup(dir.ino, "missing").await?.is_none());
 
-        // Rename it
-        fs.rename("/old.txt", "/new.txt").await?;
+        let attr = fs.getattr(file.ino).await?.unwrap();
+        assert_eq!(attr.ino, file.ino);
+        assert_eq!(attr.size, 5);
+        assert!(fs.getattr(i64::MAX).await?.is_none());
 
-        // Old path should not exist
-        assert!(fs.stat("/old.txt").await?.is_none());
+        let entries = fs.readdir_inode(dir.ino).await?.unwrap();
+        assert_eq!(entries.len(), 1);
+        assert_eq!(entries[0].name, "file.txt");
+        assert_eq!(entries[0].stats.ino, file.ino);
+        assert!(fs.readdir_inode(file.ino).await.is_err());
 
-        // New path should exist with same data
-        let result = fs.read_file("/new.txt").await?.unwrap();
-        assert_eq!(result, data);
+        let handle = fs.open_inode(file.ino).await?;
+        assert_eq!(handle.pread(0, 5).await?, b"hello");
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_rename_file_to_different_directory() -> Result<()> {
+    async fn test_negative_lookups_are_cached() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        fs.mkdir("/dir").await?;
+        let dir = fs.lstat("/dir").await?.unwrap();
+        assert!(fs.lstat("/dir/ghost").await?.is_none());
+        assert!(fs.lookup(dir.ino, "ghost").await?.is_none());
+
+        // An entry created behind the cache's back stays hidden until the
+        // cache is cleared, showing the miss was answered from the cache
+        let conn = fs.get_connection();
+        let (real, _file) = fs.create_file("/dir/real", DEFAULT_FILE_MODE).await?;
+        let real_ino = real.ino;
+        conn.execute(
+            "INSERT INTO fs_dentry (name, parent_ino, ino) VALUES ('ghost', ?, ?)",
+            (dir.ino, real_ino),
+        )
+        .await?;
+        assert!(fs.lstat("/dir/ghost").await?.is_none());
+        fs.clear_dentry_cache();
+        assert_eq!(fs.lstat("/dir/ghost").await?.unwrap().ino, real_ino);
 
-        // Create directory and file
-        fs.mkdir("/subdir").await?;
-        let data = b"test data";
-        fs.write_file("/file.txt", data).await?;
-
-        // Move file to subdirectory
-        fs.rename("/file.txt", "/subdir/file.txt").await?;
-
-        // Old path should not exist
-        assert!(fs.stat("/file.txt").await?.is_none());
-
-        // New path should exist
-        let result = fs.read_file("/subdir/file.txt").await?.unwrap();
-        assert_eq!(result, data);
+        // Every way of creating a name makes a cached miss visible
+        for name in ["m", "w", "c", "s", "l", "r", "p"] {
+            assert!(fs.lstat(&format!("/dir/{}", name)).await?.is_none());
+        }
+        fs.mkdir("/dir/m").await?;
+        fs.write_file("/dir/w", b"w").await?;
+        fs.create_file("/dir/c", DEFAULT_FILE_MODE).await?;
+        fs.symlink("/dir/real", "/dir/s").await?;
+        fs.link("/dir/real", "/dir/l").await?;
+        fs.write_file("/dir/src", b"r").await?;
+        fs.rename("/dir/src", "/dir/r").await?;
+        fs.pwrite("/dir/p", 0, b"p").await?;
+        for name in ["m", "w", "c", "s", "l", "r", "p"] {
+            assert!(
+                fs.lstat(&format!("/dir/{}", name)).await?.is_some(),
+                "/dir/{} should exist",
+                name
+            );
+            assert!(fs.lookup(dir.ino, name).await?.is_some());
+        }
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_rename_overwrite_existing_file() -> Result<()> {
+    async fn test_readdir_plus_fills_attr_cache() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        fs.mkdir("/dir").await?;
+        fs.write_file("/dir/a.txt", b"hello").await?;
+        fs.write_file("/dir/b.txt", b"hi").await?;
+        let entries = fs.readdir_plus("/dir").await?.unwrap();
+        assert_eq!(entries.len(), 2);
+
+        // A change behind the caches' back stays invisible, so lstat was
+        // answered from what readdir_plus fetched
+        fs.get_connection()
+            .execute(
+                "UPDATE fs_inode SET size = 99 WHERE ino = ?",
+                (entries[0].stats.ino,),
+            )
+            .await?;
+        assert_eq!(fs.lstat("/dir/a.txt").await?.unwrap().size, 5);
+        assert_eq!(fs.getattr(entries[0].stats.ino).await?.unwrap().size, 5);
 
-        // Create two files
-        fs.write_file("/src.txt", b"source").await?;
-        fs.write_file("/dst.txt", b"destination").await?;
-
-        // Rename src to dst (overwrites dst)
-        fs.rename("/src.txt", "/dst.txt").await?;
-
-        // Only dst should exist with src's content
-        assert!(fs.stat("/src.txt").await?.is_none());
-        let result = fs.read_file("/dst.txt").await?.unwrap();
-        assert_eq!(result, b"source");
+        fs.clear_dentry_cache();
+        assert_eq!(fs.lstat("/dir/a.txt").await?.unwrap().size, 99);
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_rename_directory() -> Result<()> {
+    async fn test_attr_cache_invalidated_by_mutations() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
-
-        // Create directory with a file inside
-        fs.mkdir("/olddir").await?;
-        fs.write_file("/olddir/file.txt", b"content").await?;
-
-        // Rename directory
-        fs.rename("/olddir", "/newdir").await?;
-
-        // Old path should not exist
-        assert!(fs.stat("/olddir").await?.is_none());
-
-        // New path should exist and contain the file
-        assert!(fs.stat("/newdir").await?.is_some());
-        let result = fs.read_file("/newdir/file.txt").await?.unwrap();
-        assert_eq!(result, b"content");
+        fs.write_file("/a.txt", b"hello").await?;
+        let ino = fs.lstat("/a.txt").await?.unwrap().ino;
+
+        fs.chmod("/a.txt", 0o600).await?;
+        assert_eq!(fs.getattr(ino).await?.unwrap().mode & 0o777, 0o600);
+
+        fs.pwrite("/a.txt", 5, b" world").await?;
+        assert_eq!(fs.lstat("/a.txt").await?.unwrap().size, 11);
+
+        let file = fs.open("/a.txt").await?;
+        file.pwrite(11, b"!").await?;
+        assert_eq!(fs.getattr(ino).await?.unwrap().size, 12);
+        file.truncate(3).await?;
+        assert_eq!(fs.stat("/a.txt").await?.unwrap().size, 3);
+        fs.truncate("/a.txt", 1).await?;
+        assert_eq!(file.fstat().await?.size, 1);
+
+        fs.link("/a.txt", "/b.txt").await?;
+        assert_eq!(fs.getattr(ino).await?.unwrap().nlink, 2);
+        fs.remove("/b.txt").await?;
+        assert_eq!(fs.getattr(ino).await?.unwrap().nlink, 1);
+
+        // Renaming over a file drops the replaced inode
+        fs.write_file("/c.txt", b"c").await?;
+        let replaced = fs.lstat("/c.txt").await?.unwrap().ino;
+        fs.rename("/a.txt", "/c.txt").await?;
+        assert!(fs.getattr(replaced).await?.is_none());
+        assert_eq!(fs.lstat("/c.txt").await?.unwrap().ino, ino);
+
+        fs.write_file("/c.txt", b"rewritten").await?;
+        assert_eq!(fs.getattr(ino).await?.unwrap().size, 9);
+        fs.remove("/c.txt").await?;
+        assert!(fs.getattr(ino).await?.is_none());
 
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_rename_directory_into_own_subtree_fails() -> Result<()> {
+    async fn test_opendir_resumes_after_last_name() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        fs.mkdir("/dir").await?;
+        for i in 0..25 {
+            fs.write_file(&format!("/dir/f{:02}", i), b"x").await?;
+        }
+
+        let mut stream = fs.opendir("/dir").await?.unwrap();
+        let first = stream.next_batch(10).await?;
+        assert_eq!(first.len(), 10);
+        assert_eq!(first[0].name, "f00");
+        assert_eq!(first[9].name, "f09");
+
+        // Changes behind the cursor are not replayed; ones ahead are seen
+        fs.remove("/dir/f03").await?;
+        fs.remove("/dir/f15").await?;
+        fs.write_file("/dir/f99", b"x").await?;
+
+        let mut names = Vec::new();
+        loop {
+            let batch = stream.next_batch(10).await?;
+            if batch.is_empty() {
+                break;
+            }
+            names.extend(batch.into_iter().map(|e| e.name));
+        }
+        let expected: Vec<String> = (10..25)
+            .filter(|&i| i != 15)
+            .map(|i| format!("f{:02}", i))
+            .chain(["f99".to_string()])
+            .collect();
+        assert_eq!(names, expected);
+
+        let dir = fs.lstat("/dir").await?.unwrap();
+        assert!(fs.opendir_inode(dir.ino).await?.is_some());
+        let file = fs.lstat("/dir/f00").await?.unwrap();
+        assert!(fs.opendir_inode(file.ino).await.is_err());
+        assert!(fs.opendir("/missing").await?.is_none());
 
-        // Create nested directories
-        fs.mkdir("/parent").await?;
-        fs.mkdir("/parent/child").await?;
-
-        // Try to rename parent into its child - should fail
-        let result = fs.rename("/parent", "/parent/child/parent").await;
-        assert!(result.is_err());
-
-        // Original structure should be intact
-        assert!(fs.stat("/parent").await?.is_some());
-        assert!(fs.stat("/parent/child").await?.is_some());
-
         Ok(())
     }
 
+    // ==================== Write Buffer Tests ====================
+
     #[tokio::test]
-    async fn test_rename_root_fails() -> Result<()> {
+    async fn test_write_buffer_coalesces_appends() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        fs.set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
+        fs.write_file("/log.txt", b"head:").await?;
+
+        let file = fs.open("/log.txt").await?;
+        let mut expected = b"head:".to_vec();
+        for i in 0..2000 {
+            let line = format!("line {}\n", i);
+            file.pwrite(expected.len() as u64, line.as_bytes()).await?;
+            expected.extend_from_slice(line.as_bytes());
+        }
 
-        // Try to rename root - should fail
-        let result = fs.rename("/", "/newroot").await;
-        assert!(result.is_err());
+        // The handle and inode attributes see the buffered writes
+        assert_eq!(file.pread(0, expected.len() as u64).await?, expected);
+        assert_eq!(file.fstat().await?.size as usize, expected.len());
+        let ino = file.fstat().await?.ino;
+        assert_eq!(
+            fs.getattr(ino).await?.unwrap().size as usize,
+            expected.len()
+        );
 
+        file.flush().await?;
+        assert_eq!(fs.read_file("/log.txt").await?.unwrap(), expected);
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_rename_to_root_fails() -> Result<()> {
+    async fn test_write_buffer_flushes_at_limit() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        fs.set_write_buffer_limit(DEFAULT_CHUNK_SIZE * 2);
+        fs.write_file("/f.bin", b"").await?;
+
+        let file = fs.open("/f.bin").await?;
+        let data: Vec<u8> = (0..DEFAULT_CHUNK_SIZE * 3)
+            .map(|i| (i % 251) as u8)
+            .collect();
+        for (i, piece) in data.chunks(100).enumerate() {
+            file.pwrite((i * 100) as u64, piece).await?;
+        }
 
-        fs.write_file("/file.txt", b"data").await?;
-
-        // Try to rename to root - should fail
-        let result = fs.rename("/file.txt", "/").await;
-        assert!(result.is_err());
+        // Everything up to the last overflow is already stored
+        let stored = fs.read_file("/f.bin").await?.unwrap();
+        assert!(stored.len() >= DEFAULT_CHUNK_SIZE * 2);
+        assert_eq!(stored[..], data[..stored.len()]);
 
+        file.fsync().await?;
+        assert_eq!(fs.read_file("/f.bin").await?.unwrap(), data);
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_rename_nonexistent_source_fails() -> Result<()> {
+    async fn test_concurrent_fsyncs_share_commits() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        fs.set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
+        fs.set_fsync_max_wait(Duration::from_millis(5));
+
+        let mut files = Vec::new();
+        for i in 0..16 {
+            let path = format!("/f{}.txt", i);
+            fs.write_file(&path, b"").await?;
+            files.push((path, fs.open(&format!("/f{}.txt", i)).await?));
+        }
 
-        // Try to rename non-existent file
-        let result = fs.rename("/nonexistent.txt", "/new.txt").await;
-        assert!(result.is_err());
+        let before = fs.group_commit.commits();
+        let tasks: Vec<_> = files
+            .iter()
+            .map(|(path, file)| {
+                let file = file.clone();
+                let data = path.clone().into_bytes();
+                tokio::spawn(async move {
+                    file.pwrite(0, &data).await?;
+                    file.fsync().await
+                })
+            })
+            .collect();
+        for task in tasks {
+            task.await.unwrap()?;
+        }
 
+        // Every fsync returned, but far fewer commits ran than fsyncs
+        assert!(fs.group_commit.commits() - before < files.len() as u64);
+        for (path, _) in &files {
+            assert_eq!(fs.read_file(path).await?.unwrap(), path.as_bytes());
+        }
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_rename_overwrite_nonempty_directory_fails() -> Result<()> {
+    async fn test_sequential_reads_see_later_writes() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        let data: Vec<u8> = (0..3 * 1024 * 1024).map(|i| (i % 251) as u8).collect();
+        fs.write_file("/big.bin", &data).await?;
+
+        // Stream the file in FUSE-sized reads, overwriting a range ahead of
+        // the reader halfway through, as another handle would
+        let reader = fs.open("/big.bin").await?;
+        let writer = fs.open("/big.bin").await?;
+        let mut expected = data.clone();
+        let step = 128 * 1024;
+        for offset in (0..data.len()).step_by(step) {
+            if offset == data.len() / 2 {
+                let at = offset + step + 10;
+                writer.pwrite(at as u64, b"changed").await?;
+                expected[at..at + 7].copy_from_slice(b"changed");
+            }
+            let read = reader.pread(offset as u64, step as u64).await?;
+            assert_eq!(read, &expected[offset..offset + step], "offset {}", offset);
+        }
 
-        // Create source directory and target directory with content
-        fs.mkdir("/src").await?;
-        fs.mkdir("/dst").await?;
-        fs.write_file("/dst/file.txt", b"content").await?;
-
-        // Try to rename src to dst (dst is not empty) - should fail
-        let result = fs.rename("/src", "/dst").await;
-        assert!(result.is_err());
+        // Random reads after the stream still return the right bytes
+        let read = reader.pread(1000, 50).await?;
+        assert_eq!(read, &expected[1000..1050]);
+        Ok(())
+    }
 
-        // Both directories should still exist
-        assert!(fs.stat("/src").await?.is_some());
-        assert!(fs.stat("/dst").await?.is_some());
-        assert!(fs.stat("/dst/file.txt").await?.is_some());
+    #[tokio::test]
+    async fn test_readahead_survives_writes_to_other_files() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
+        let data: Vec<u8> = (0..2 * 1024 * 1024).map(|i| (i % 251) as u8).collect();
+        fs.write_file("/stream.bin", &data).await?;
+        let ino = fs.stat("/stream.bin").await?.unwrap().ino;
+
+        let reader = fs.file_handle(ino);
+        let step = 64 * 1024;
+        let prefetched_at = |reader: &AgentFSFile| {
+            let readahead = reader.readahead.lock().unwrap();
+            readahead.prefetched.as_ref().map(|p| p.offset)
+        };
+        let mut offset = 0;
+        while prefetched_at(&reader).is_none() {
+            reader.pread(offset as u64, step as u64).await?;
+            offset += step;
+        }
 
+        // Writing another file keeps the window: the next read is served
+        // from it rather than fetching a new one
+        let window = prefetched_at(&reader);
+        fs.write_file("/other.txt", b"unrelated").await?;
+        let read = reader.pread(offset as u64, step as u64).await?;
+        assert_eq!(read, &data[offset..offset + step]);
+        assert_eq!(prefetched_at(&reader), window);
+        offset += step;
+
+        // Writing the streamed file drops it
+        fs.write_file("/stream.bin", &data[..offset + 2 * step])
+            .await?;
+        let read = reader.pread(offset as u64, step as u64).await?;
+        assert_eq!(read, &data[offset..offset + step]);
+        assert_ne!(prefetched_at(&reader), window);
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_rename_file_to_directory_fails() -> Result<()> {
+    async fn test_write_buffer_shared_between_handles() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        fs.set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
+        fs.write_file("/shared.txt", b"0123456789").await?;
+
+        let writer = fs.open("/shared.txt").await?;
+        let reader = fs.open("/shared.txt").await?;
+        writer.pwrite(2, b"ab").await?;
+        writer.pwrite(DEFAULT_CHUNK_SIZE as u64 + 5, b"far").await?;
+        assert_eq!(reader.pread(0, 10).await?, b"01ab456789");
+
+        // The gap reads as zeros, and dropping the writing handle keeps its
+        // buffered data
+        drop(writer);
+        let tail = reader.pread(DEFAULT_CHUNK_SIZE as u64, 8).await?;
+        assert_eq!(tail, b"\0\0\0\0\0far");
+        reader.flush().await?;
+
+        let stored = fs.read_file("/shared.txt").await?.unwrap();
+        assert_eq!(stored.len(), DEFAULT_CHUNK_SIZE + 8);
+        assert_eq!(&stored[..10], b"01ab456789");
+        assert_eq!(&stored[DEFAULT_CHUNK_SIZE + 5..], b"far");
+        Ok(())
+    }
 
-        // Create a file and an empty directory
-        fs.write_file("/file.txt", b"data").await?;
-        fs.mkdir("/dir").await?;
-
-        // Try to rename file over directory - should fail
-        let result = fs.rename("/file.txt", "/dir").await;
-        assert!(result.is_err());
+    #[tokio::test]
+    async fn test_write_buffer_truncate_and_remove() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
+        fs.set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
+        fs.write_file("/t.txt", b"").await?;
+
+        let file = fs.open("/t.txt").await?;
+        file.pwrite(0, b"hello world").await?;
+        file.truncate(5).await?;
+        assert_eq!(fs.read_file("/t.txt").await?.unwrap(), b"hello");
+
+        // Writes buffered for a deleted file are dropped on flush
+        let ino = file.fstat().await?.ino;
+        file.pwrite(5, b"!").await?;
+        fs.remove("/t.txt").await?;
+        file.flush().await?;
+        assert_eq!(fs.get_chunk_count(ino).await?, 0);
+        Ok(())
+    }
 
+    #[tokio::test]
+    async fn test_write_buffer_written_back_on_last_close() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
+        fs.set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
+        fs.write_file("/closed.txt", b"").await?;
+
+        let first = fs.open("/closed.txt").await?;
+        let second = fs.open("/closed.txt").await?;
+        first.pwrite(0, b"kept").await?;
+        let ino = first.fstat().await?.ino;
+        drop(first);
+        drop(second);
+
+        // Written back in the background, without a path-level read
+        for _ in 0..100 {
+            if fs.write_buffers.is_empty() {
+                break;
+            }
+            tokio::time::sleep(Duration::from_millis(10)).await;
+        }
+        assert!(fs.write_buffers.is_empty());
+        assert_eq!(fs.get_chunk_count(ino).await?, 1);
+        assert_eq!(fs.read_file("/closed.txt").await?.unwrap(), b"kept");
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_rename_directory_to_file_fails() -> Result<()> {
+    async fn test_path_operations_write_back_buffers() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        fs.set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
+        fs.write_file("/p.txt", b"0123456789").await?;
+        let file = fs.open("/p.txt").await?;
+
+        // Path-level reads see buffered writes
+        file.pwrite(0, b"ab").await?;
+        assert_eq!(fs.read_file("/p.txt").await?.unwrap(), b"ab23456789");
+        file.pwrite(2, b"cd").await?;
+        assert_eq!(fs.pread("/p.txt", 0, 4).await?.unwrap(), b"abcd");
+
+        // A flush after a path-level write doesn't bring back older writes
+        file.pwrite(0, b"stale").await?;
+        fs.write_file("/p.txt", b"fresh").await?;
+        file.flush().await?;
+        assert_eq!(fs.read_file("/p.txt").await?.unwrap(), b"fresh");
+
+        file.pwrite(5, b" data").await?;
+        fs.truncate("/p.txt", 7).await?;
+        file.flush().await?;
+        assert_eq!(fs.read_file("/p.txt").await?.unwrap(), b"fresh d");
+
+        file.pwrite(0, b"F").await?;
+        fs.pwrite("/p.txt", 1, b"R").await?;
+        file.flush().await?;
+        assert_eq!(fs.read_file("/p.txt").await?.unwrap(), b"FResh d");
+        Ok(())
+    }
 
-        // Create a directory and a file
+    #[tokio::test]
+    async fn test_readdir_plus_reports_buffered_sizes() -> Result<()> {
+        let (fs, _dir) = create_test_fs().await?;
+        fs.set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
         fs.mkdir("/dir").await?;
-        fs.write_file("/file.txt", b"data").await?;
+        fs.write_file("/dir/f.txt", b"abc").await?;
 
-        // Try to rename directory over file - should fail
-        let result = fs.rename("/dir", "/file.txt").await;
-        assert!(result.is_err());
+        let file = fs.open("/dir/f.txt").await?;
+        file.pwrite(3, b"defgh").await?;
+        let entries = fs.readdir_plus("/dir").await?.unwrap();
+        assert_eq!(entries[0].stats.size, 8);
 
+        let mut stream = fs.opendir("/dir").await?.unwrap();
+        assert_eq!(stream.next_batch(16).await?[0].stats.size, 8);
         Ok(())
     }
 
-    #[tokio::test]
-    async fn test_rename_updates_ctime() -> Result<()> {
-        let (fs, _dir) = create_test_fs().await?;
+    // ==================== Chunk Deduplication Tests ====================
 
-        // Create a file
-        fs.write_file("/old.txt", b"data").await?;
-        let stats_before = fs.stat("/old.txt").await?.unwrap();
+    async fn create_dedup_fs() -> Result<(AgentFS, tempfile::TempDir)> {
+        create_configured_fs(true, None, false).await
+    }
 
-        // Small delay to ensure time changes
-        tokio::time::sleep(std::time::Duration::from_millis(10)).await;
+    async fn create_configured_fs(
+        dedup: bool,
+        compression: Option<Compression>,
+        extents: bool,
+    ) -> Result<(AgentFS, tempfile::TempDir)> {
+        let dir = tempdir()?;
+        let db_path = dir.path().join("test.db");
+        let db = Builder::new_local(db_path.to_str().unwrap())
+            .build()
+            .await?;
+        let conn = Arc::new(db.connect()?);
+        if dedup {
+            AgentFS::init_dedup(&conn).await?;
+        }
+        if let Some(compression) = compression {
+            AgentFS::init_compression(&conn, compression).await?;
+        }
+        if extents {
+            AgentFS::init_extents(&conn).await?;
+        }
+        let fs = AgentFS::from_database(&db, conn, DEFAULT_READER_CONNECTIONS).await?;
+        Ok((fs, dir))
+    }
 
-        // Rename it
-        fs.rename("/old.txt", "/new.txt").await?;
+    /// Number of distinct stored chunks and the sum of their refcounts
+    async fn dedup_chunk_stats(fs: &AgentFS) -> Result<(i64, i64)> {
+        let mut rows = fs
+            .conn
+            .query(
+                "SELECT COUNT(*), COALESCE(SUM(refcount), 0) FROM fs_chunk",
+                (),
+            )
+            .await?;
+        let row = rows.next().await?.unwrap();
+        let get = |i| {
+            row.get_value(i)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0)
+        };
+        Ok((get(0), get(1)))
+    }
 
-        // ctime should be updated
-        let stats_after = fs.stat("/new.txt").await?.unwrap();
-        assert!(stats_after.ctime >= stats_before.ctime);
+    #[tokio::test]
+    async fn test_dedup_identical_files_share_chunks() -> Result<()> {
+        let (fs, _dir) = create_dedup_fs().await?;
+        assert!(fs.is_dedup());
+        let chunk_size = fs.chunk_size();
 
+        // Two identical chunks and a distinct partial one
+        let mut data = vec![0xaa; 2 * chunk_size];
+        data.extend_from_slice(b"tail");
+        fs.write_file("/a", &data).await?;
+        fs.mkdir("/vendor").await?;
+        fs.write_file("/vendor/a", &data).await?;
+
+        assert_eq!(dedup_chunk_stats(&fs).await?, (2, 6));
+        assert_eq!(fs.read_file("/a").await?.unwrap(), data);
+        assert_eq!(fs.read_file("/vendor/a").await?.unwrap(), data);
+
+        let file = fs.open("/vendor/a").await?;
+        let read = file.pread(chunk_size as u64 - 2, 8).await?;
+        assert_eq!(read, [0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa, 0xaa]);
+        let read = file.pread(2 * chunk_size as u64, 4).await?;
+        assert_eq!(read, b"tail");
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_write_file_updates_mode_to_regular_file() -> Result<()> {
+    async fn test_dedup_refcounts_follow_writes() -> Result<()> {
+        let (fs, _dir) = create_dedup_fs().await?;
+        let chunk_size = fs.chunk_size();
+        let data = vec![0x11; 2 * chunk_size];
+        fs.write_file("/a", &data).await?;
+        fs.write_file("/b", &data).await?;
+        assert_eq!(dedup_chunk_stats(&fs).await?, (1, 4));
+
+        // Overwriting part of a chunk moves that reference to new contents
+        let file = fs.open("/a").await?;
+        file.pwrite(0, b"new").await?;
+        assert_eq!(dedup_chunk_stats(&fs).await?, (2, 4));
+        assert_eq!(&fs.read_file("/a").await?.unwrap()[..4], b"new\x11");
+        assert_eq!(fs.read_file("/b").await?.unwrap(), data);
+
+        // Writing back the original contents drops the new chunk again
+        file.pwrite(0, &[0x11; 3]).await?;
+        assert_eq!(dedup_chunk_stats(&fs).await?, (1, 4));
+
+        fs.truncate("/a", chunk_size as u64).await?;
+        assert_eq!(dedup_chunk_stats(&fs).await?, (1, 3));
+
+        fs.remove("/b").await?;
+        assert_eq!(dedup_chunk_stats(&fs).await?, (1, 1));
+
+        file.truncate(0).await?;
+        assert_eq!(dedup_chunk_stats(&fs).await?, (0, 0));
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn test_init_dedup_requires_empty_filesystem() -> Result<()> {
         let (fs, _dir) = create_test_fs().await?;
+        assert!(!fs.is_dedup());
+        fs.write_file("/a", b"data").await?;
+        assert!(AgentFS::init_dedup(&fs.get_connection()).await.is_err());
+        assert_eq!(fs.read_file("/a").await?.unwrap(), b"data");
+        Ok(())
+    }
 
-        // Create a target file for the symlink
-        fs.write_file("/target.txt", b"target content").await?;
+    // ==================== Chunk Compression Tests ====================
 
-        // Create a symlink
-        fs.symlink("/target.txt", "/link.txt").await?;
+    /// `(compressed, length)` of each stored chunk of a plain-layout file
+    async fn stored_chunks(fs: &AgentFS, path: &str) -> Result<Vec<(i64, i64)>> {
+        let ino = fs.resolve_path(path).await?.unwrap();
+        let mut rows = fs
+            .conn
+            .query(
+                "SELECT compressed, LENGTH(data) FROM fs_data WHERE ino = ? ORDER BY chunk_index",
+                (ino,),
+            )
+            .await?;
+        let mut chunks = Vec::new();
+        while let Some(row) = rows.next().await? {
+            let get = |i| {
+                row.get_value(i)
+                    .ok()
+                    .and_then(|v| v.as_integer().copied())
+                    .unwrap_or(0)
+            };
+            chunks.push((get(0), get(1)));
+        }
+        Ok(chunks)
+    }
 
-        // Verify it's a symlink
-        let stats = fs.lstat("/link.txt").await?.unwrap();
-        assert!(stats.is_symlink(), "Should be a symlink before write_file");
+    /// Bytes that zstd can't shrink
+    fn incompressible(len: usize) -> Vec<u8> {
+        let mut state = 0x2545f4914f6cdd1du64;
+        (0..len)
+            .map(|_| {
+                state ^= state << 13;
+                state ^= state >> 7;
+                state ^= state << 17;
+                state as u8
+            })
+            .collect()
+    }
 
-        // Overwrite the symlink with write_file
-        fs.write_file("/link.txt", b"new content").await?;
+    #[tokio::test]
+    async fn test_compression_round_trip() -> Result<()> {
+        let (fs, _dir) = create_configured_fs(false, Some(Compression::Zstd), false).await?;
+        assert_eq!(fs.compression(), Some(Compression::Zstd));
+        let chunk_size = fs.chunk_size();
 
-        // Verify it's now a regular file with DEFAULT_FILE_MODE
-        let stats = fs.lstat("/link.txt").await?.unwrap();
-        assert!(stats.is_file(), "Should be a regular file after write_file");
+        let text = b"fn main() { println!(\"hello\"); }\n".repeat(3 * chunk_size / 32);
+        fs.write_file("/src.rs", &text).await?;
+        let noise = incompressible(chunk_size);
+        fs.write_file("/noise.bin", &noise).await?;
+
+        let chunks = stored_chunks(&fs, "/src.rs").await?;
+        assert!(chunks
+            .iter()
+            .all(|&(compressed, len)| compressed == 1 && len < chunk_size as i64 / 4));
         assert_eq!(
-            stats.mode, DEFAULT_FILE_MODE,
-            "Mode should be DEFAULT_FILE_MODE after write_file"
+            stored_chunks(&fs, "/noise.bin").await?,
+            [(0, chunk_size as i64)]
         );
 
-        // Verify the content
-        let content = fs.read_file("/link.txt").await?.unwrap();
-        assert_eq!(content, b"new content");
+        assert_eq!(fs.read_file("/src.rs").await?.unwrap(), text);
+        assert_eq!(fs.read_file("/noise.bin").await?.unwrap(), noise);
 
+        // Partial writes decompress, patch and recompress the chunk
+        let file = fs.open("/src.rs").await?;
+        file.pwrite(chunk_size as u64 - 2, b"////").await?;
+        let mut expected = text.clone();
+        expected[chunk_size - 2..chunk_size + 2].copy_from_slice(b"////");
+        assert_eq!(
+            file.pread(chunk_size as u64 - 4, 8).await?,
+            &expected[chunk_size - 4..chunk_size + 4]
+        );
+        fs.truncate("/src.rs", chunk_size as u64 + 10).await?;
+        assert_eq!(
+            fs.read_file("/src.rs").await?.unwrap(),
+            &expected[..chunk_size + 10]
+        );
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_chmod_regular_file() -> Result<()> {
-        let (fs, _dir) = create_test_fs().await?;
+    async fn test_compression_enabled_on_existing_filesystem() -> Result<()> {
+        let dir = tempdir()?;
+        let db_path = dir.path().join("test.db");
+        let text = b"log line\n".repeat(1000);
 
-        // Create a file with default permissions
-        fs.write_file("/test.txt", b"content").await?;
+        let fs = AgentFS::new(db_path.to_str().unwrap()).await?;
+        fs.write_file("/old.log", &text).await?;
+        AgentFS::init_compression(&fs.get_connection(), Compression::Zstd).await?;
+        // Enabling the same codec again is a no-op
+        AgentFS::init_compression(&fs.get_connection(), Compression::Zstd).await?;
+        drop(fs);
 
-        let stats = fs.stat("/test.txt").await?.unwrap();
-        assert_eq!(
-            stats.mode & 0o7777,
-            0o644,
-            "Default file mode should be 0o644"
-        );
+        let fs = AgentFS::new(db_path.to_str().unwrap()).await?;
+        assert_eq!(fs.compression(), Some(Compression::Zstd));
+        assert!(stored_chunks(&fs, "/old.log")
+            .await?
+            .iter()
+            .all(|&(compressed, _)| compressed == 0));
+        assert_eq!(fs.read_file("/old.log").await?.unwrap(), text);
 
-        // Change to executable
-        fs.chmod("/test.txt", 0o755).await?;
+        fs.write_file("/new.log", &text).await?;
+        assert!(stored_chunks(&fs, "/new.log")
+            .await?
+            .iter()
+            .all(|&(compressed, _)| compressed == 1));
+        assert_eq!(fs.read_file("/new.log").await?.unwrap(), text);
+        Ok(())
+    }
 
-        let stats = fs.stat("/test.txt").await?.unwrap();
-        assert_eq!(
-            stats.mode & 0o7777,
-            0o755,
-            "Mode should be 0o755 after chmod"
-        );
-        assert!(stats.is_file(), "Should still be a regular file");
+    #[tokio::test]
+    async fn test_dedup_with_compression() -> Result<()> {
+        let (fs, _dir) = create_configured_fs(true, Some(Compression::Zstd), false).await?;
+        let text = b"{\"tool\": \"ls\", \"ok\": true}\n".repeat(500);
+        fs.write_file("/a.json", &text).await?;
+        fs.write_file("/b.json", &text).await?;
 
-        // Change to read-only
-        fs.chmod("/test.txt", 0o444).await?;
+        let (distinct, refs) = dedup_chunk_stats(&fs).await?;
+        let chunks = text.len().div_ceil(fs.chunk_size()) as i64;
+        assert!(distinct <= chunks);
+        assert_eq!(refs, 2 * chunks);
 
-        let stats = fs.stat("/test.txt").await?.unwrap();
-        assert_eq!(
-            stats.mode & 0o7777,
-            0o444,
-            "Mode should be 0o444 after chmod"
-        );
+        let mut rows = fs
+            .conn
+            .query("SELECT COUNT(*) FROM fs_chunk WHERE compressed = 0", ())
+            .await?;
+        let raw = rows.next().await?.unwrap().get_value(0)?;
+        assert_eq!(raw.as_integer().copied(), Some(0));
 
+        assert_eq!(fs.read_file("/a.json").await?.unwrap(), text);
+        assert_eq!(fs.read_file("/b.json").await?.unwrap(), text);
         Ok(())
     }
 
-    #[tokio::test]
-    async fn test_chmod_preserves_file_type() -> Result<()> {
-        let (fs, _dir) = create_test_fs().await?;
+    // ==================== Extent Tests ====================
 
-        // Create a regular file
-        fs.write_file("/file.txt", b"content").await?;
-        fs.chmod("/file.txt", 0o755).await?;
-        let stats = fs.stat("/file.txt").await?.unwrap();
-        assert!(stats.is_file(), "Should remain a regular file after chmod");
+    fn patterned(len: usize) -> Vec<u8> {
+        (0..len).map(|i| (i % 251) as u8).collect()
+    }
 
-        // Create a directory
-        fs.mkdir("/dir").await?;
-        fs.chmod("/dir", 0o700).await?;
-        let stats = fs.stat("/dir").await?.unwrap();
-        assert!(
-            stats.is_directory(),
-            "Should remain a directory after chmod"
-        );
-        assert_eq!(stats.mode & 0o7777, 0o700, "Directory mode should be 0o700");
+    async fn create_extent_fs() -> Result<(AgentFS, tempfile::TempDir)> {
+        create_configured_fs(false, None, true).await
+    }
 
+    #[tokio::test]
+    async fn test_large_file_stored_in_extents() -> Result<()> {
+        let (fs, _dir) = create_extent_fs().await?;
+        let extent = fs.extent_size();
+        let data = patterned(extent * 3 + DEFAULT_CHUNK_SIZE + 100);
+        fs.write_file("/big.bin", &data).await?;
+
+        let ino = fs.resolve_path("/big.bin").await?.unwrap();
+        assert_eq!(fs.get_chunk_count(ino).await?, 3 + 2);
+        assert_eq!(fs.read_file("/big.bin").await?.unwrap(), data);
+
+        // Reads starting inside an extent and crossing into the next one
+        let file = fs.open("/big.bin").await?;
+        for (offset, len) in [
+            (0, 10),
+            (extent - 7, 20),
+            (extent + 4096 * 9 + 1, 4096),
+            (extent * 3 - 1, DEFAULT_CHUNK_SIZE + 50),
+        ] {
+            let expected = &data[offset..offset + len];
+            assert_eq!(file.pread(offset as u64, len as u64).await?, expected);
+            assert_eq!(
+                fs.pread("/big.bin", offset as u64, len as u64)
+                    .await?
+                    .unwrap(),
+                expected
+            );
+        }
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_chmod_nonexistent_fails() -> Result<()> {
-        let (fs, _dir) = create_test_fs().await?;
-
-        let result = fs.chmod("/nonexistent.txt", 0o755).await;
-        assert!(result.is_err(), "chmod on nonexistent file should fail");
+    async fn test_pwrite_splits_extent() -> Result<()> {
+        let (fs, _dir) = create_extent_fs().await?;
+        let extent = fs.extent_size();
+        let mut data = patterned(extent * 2);
+        fs.write_file("/big.bin", &data).await?;
+        let ino = fs.resolve_path("/big.bin").await?.unwrap();
+
+        let file = fs.open("/big.bin").await?;
+        let offset = extent + DEFAULT_CHUNK_SIZE * 7 + 3;
+        file.pwrite(offset as u64, b"patched").await?;
+        data[offset..offset + 7].copy_from_slice(b"patched");
+
+        // Only the written extent falls back to chunks
+        let chunks_per_extent = (extent / DEFAULT_CHUNK_SIZE) as i64;
+        assert_eq!(fs.get_chunk_count(ino).await?, 1 + chunks_per_extent);
+        assert_eq!(fs.read_file("/big.bin").await?.unwrap(), data);
+        assert_eq!(
+            file.pread(offset as u64 - 1, 9).await?,
+            &data[offset - 1..offset + 8]
+        );
+        Ok(())
+    }
 
+    #[tokio::test]
+    async fn test_truncate_inside_extent() -> Result<()> {
+        let (fs, _dir) = create_extent_fs().await?;
+        let extent = fs.extent_size();
+        let data = patterned(extent * 2);
+        fs.write_file("/big.bin", &data).await?;
+
+        let new_size = extent + DEFAULT_CHUNK_SIZE * 3 + 10;
+        fs.truncate("/big.bin", new_size as u64).await?;
+        assert_eq!(fs.read_file("/big.bin").await?.unwrap(), &data[..new_size]);
+
+        let file = fs.open("/big.bin").await?;
+        file.truncate(extent as u64 / 2).await?;
+        assert_eq!(
+            fs.read_file("/big.bin").await?.unwrap(),
+            &data[..extent / 2]
+        );
         Ok(())
     }
 
     #[tokio::test]
-    async fn test_chmod_symlink() -> Result<()> {
-        let (fs, _dir) = create_test_fs().await?;
+    async fn test_buffered_writes_flush_as_extents() -> Result<()> {
+        let (fs, _dir) = create_extent_fs().await?;
+        fs.set_write_buffer_limit(DEFAULT_WRITE_BUFFER_BYTES);
+        fs.write_file("/seq.bin", b"").await?;
+
+        let data = patterned(fs.extent_size() * 2 + 100);
+        let file = fs.open("/seq.bin").await?;
+        for (i, piece) in data.chunks(128 * 1024).enumerate() {
+            file.pwrite((i * 128 * 1024) as u64, piece).await?;
+        }
+        file.flush().await?;
 
-        // Create target and symlink
-        fs.write_file("/target.txt", b"content").await?;
-        fs.symlink("/target.txt", "/link.txt").await?;
+        let ino = fs.resolve_path("/seq.bin").await?.unwrap();
+        assert_eq!(fs.get_chunk_count(ino).await?, 2 + 1);
+        assert_eq!(fs.read_file("/seq.bin").await?.unwrap(), data);
+        Ok(())
+    }
 
-        // chmod the symlink path (should work on the symlink inode)
-        fs.chmod("/link.txt", 0o755).await?;
+    #[tokio::test]
+    async fn test_extents_with_dedup_and_compression() -> Result<()> {
+        let (fs, _dir) = create_configured_fs(true, Some(Compression::Zstd), true).await?;
+        let extent = fs.extent_size();
+        let mut data = b"extent ".repeat(extent * 2 / 7);
+        fs.write_file("/a.bin", &data).await?;
+        fs.write_file("/b.bin", &data).await?;
+        assert_eq!(fs.read_file("/b.bin").await?.unwrap(), data);
+
+        fs.pwrite("/a.bin", 10, b"X").await?;
+        data[10] = b'X';
+        assert_eq!(fs.read_file("/a.bin").await?.unwrap(), data);
+
+        fs.remove("/a.bin").await?;
+        fs.remove("/b.bin").await?;
+        assert_eq!(dedup_chunk_stats(&fs).await?, (0, 0));
+        Ok(())
+    }
 
-        let stats = fs.lstat("/link.txt").await?.unwrap();
-        assert!(stats.is_symlink(), "Should still be a symlink");
+    #[tokio::test]
+    async fn test_enable_extents_on_existing_filesystem() -> Result<()> {
+        let dir = tempdir()?;
+        let db_path = dir.path().join("test.db");
+        let data = patterned(DEFAULT_EXTENT_SIZE * 2);
+        {
+            // Files are stored one chunk per row unless extents are enabled
+            let fs = AgentFS::new(db_path.to_str().unwrap()).await?;
+            assert_eq!(fs.extent_size(), DEFAULT_CHUNK_SIZE);
+            fs.write_file("/old.bin", &data).await?;
+            let ino = fs.resolve_path("/old.bin").await?.unwrap();
+            assert_eq!(
+                fs.get_chunk_count(ino).await? as usize,
+                data.len() / DEFAULT_CHUNK_SIZE
+            );
+            AgentFS::init_extents(&fs.conn).await?;
+            AgentFS::init_extents(&fs.conn).await?;
+        }
 
+        let fs = AgentFS::new(db_path.to_str().unwrap()).await?;
+        assert_eq!(fs.extent_size(), DEFAULT_EXTENT_SIZE);
+        assert_eq!(fs.read_file("/old.bin").await?.unwrap(), data);
+
+        // Rewritten files pick up extents
+        fs.write_file("/old.bin", &data).await?;
+        let ino = fs.resolve_path("/old.bin").await?.unwrap();
+        assert_eq!(fs.get_chunk_count(ino).await?, 2);
+        assert_eq!(fs.read_file("/old.bin").await?.unwrap(), data);
         Ok(())
     }
 }
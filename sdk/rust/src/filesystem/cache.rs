@@ -0,0 +1,291 @@
+//! Concurrent caches for filesystem metadata.
+//!
+//! `ClockCache` splits its entries across lock shards picked by key hash, so
+//! lookups of different names rarely touch the same lock. Eviction uses the
+//! CLOCK (second chance) algorithm: a hit only sets the entry's reference
+//! bit, which is atomic, so reads take a shared lock and never reorder
+//! anything. Inserting into a full shard sweeps a hand over its slots,
+//! clearing reference bits until it finds an entry that wasn't used since
+//! the last sweep, and replaces it.
+
+use std::borrow::Borrow;
+use std::collections::hash_map::RandomState;
+use std::collections::HashMap;
+use std::hash::{BuildHasher, Hash};
+use std::sync::atomic::{AtomicBool, Ordering};
+use std::sync::RwLock;
+
+/// Number of lock shards; a power of two so the shard is a mask of the hash
+const SHARDS: usize = 16;
+
+pub(crate) struct ClockCache<K, V> {
+    shards: Box<[RwLock<Shard<K, V>>]>,
+    hasher: RandomState,
+}
+
+struct Shard<K, V> {
+    /// Key -> position in `slots`
+    index: HashMap<K, usize>,
+    slots: Vec<Slot<K, V>>,
+    /// Next slot the eviction sweep looks at
+    hand: usize,
+    capacity: usize,
+}
+
+struct Slot<K, V> {
+    key: K,
+    value: V,
+    /// Set on every hit, cleared by the eviction sweep
+    referenced: AtomicBool,
+}
+
+impl<K: Hash + Eq + Clone, V: Clone> ClockCache<K, V> {
+    /// Create a cache holding about `capacity` entries
+    pub(crate) fn new(capacity: usize) -> Self {
+        Self::with_shards(capacity, SHARDS)
+    }
+
+    /// `shards` must be a power of two
+    fn with_shards(capacity: usize, shards: usize) -> Self {
+        assert!(capacity > 0, "cache size must be > 0");
+        let per_shard = capacity.div_ceil(shards);
+        let shards = (0..shards)
+            .map(|_| {
+                RwLock::new(Shard {
+                    index: HashMap::with_capacity(per_shard),
+                    slots: Vec::with_capacity(per_shard),
+                    hand: 0,
+                    capacity: per_shard,
+                })
+            })
+            .collect();
+        Self {
+            shards,
+            hasher: RandomState::new(),
+        }
+    }
+
+    fn shard<Q>(&self, key: &Q) -> &RwLock<Shard<K, V>>
+    where
+        K: Borrow<Q>,
+        Q: Hash + ?Sized,
+    {
+        &self.shards[self.hasher.hash_one(key) as usize & (self.shards.len() - 1)]
+    }
+
+    /// Look up an entry, marking it as recently used
+    pub(crate) fn get<Q>(&self, key: &Q) -> Option<V>
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let shard = self.shard(key).read().unwrap();
+        let slot = &shard.slots[*shard.index.get(key)?];
+        slot.referenced.store(true, Ordering::Relaxed);
+        Some(slot.value.clone())
+    }
+
+    /// Whether `key` is cached, marking it as recently used
+    pub(crate) fn contains<Q>(&self, key: &Q) -> bool
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let shard = self.shard(key).read().unwrap();
+        match shard.index.get(key) {
+            Some(&i) => {
+                shard.slots[i].referenced.store(true, Ordering::Relaxed);
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// Insert or replace an entry, evicting one if the shard is full
+    pub(crate) fn insert(&self, key: K, value: V) {
+        let mut shard = self.shard(&key).write().unwrap();
+        let shard = &mut *shard;
+        if let Some(&i) = shard.index.get(&key) {
+            let slot = &mut shard.slots[i];
+            slot.value = value;
+            *slot.referenced.get_mut() = true;
+            return;
+        }
+
+        let slot = Slot {
+            key: key.clone(),
+            value,
+            referenced: AtomicBool::new(false),
+        };
+        if shard.slots.len() < shard.capacity {
+            shard.index.insert(key, shard.slots.len());
+            shard.slots.push(slot);
+            return;
+        }
+
+        // Sweep until an entry without a second chance turns up. Terminates
+        // within two rounds since every visited bit gets cleared.
+        let victim = loop {
+            let i = shard.hand;
+            shard.hand = (i + 1) % shard.slots.len();
+            if !std::mem::take(shard.slots[i].referenced.get_mut()) {
+                break i;
+            }
+        };
+        let old = std::mem::replace(&mut shard.slots[victim], slot);
+        shard.index.remove(&old.key);
+        shard.index.insert(key, victim);
+    }
+
+    /// Remove an entry
+    pub(crate) fn remove<Q>(&self, key: &Q)
+    where
+        K: Borrow<Q>,
+        Q: Hash + Eq + ?Sized,
+    {
+        let mut shard = self.shard(key).write().unwrap();
+        let Some(i) = shard.index.remove(key) else {
+            return;
+        };
+        shard.slots.swap_remove(i);
+        if i < shard.slots.len() {
+            let moved = shard.slots[i].key.clone();
+            shard.index.insert(moved, i);
+        }
+        if shard.hand >= shard.slots.len() {
+            shard.hand = 0;
+        }
+    }
+
+    /// Remove all entries
+    pub(crate) fn clear(&self) {
+        for shard in self.shards.iter() {
+            let mut shard = shard.write().unwrap();
+            shard.index.clear();
+            shard.slots.clear();
+            shard.hand = 0;
+        }
+    }
+
+    /// Number of cached entries
+    #[cfg(test)]
+    pub(crate) fn len(&self) -> usize {
+        self.shards
+            .iter()
+            .map(|shard| shard.read().unwrap().slots.len())
+            .sum()
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+    use std::sync::Arc;
+
+    #[test]
+    fn test_insert_get_remove() {
+        let cache = ClockCache::new(64);
+        cache.insert((1i64, "a".to_string()), 10i64);
+        cache.insert((1i64, "b".to_string()), 11i64);
+        assert_eq!(cache.get(&(1, "a".to_string())), Some(10));
+        assert!(cache.contains(&(1, "b".to_string())));
+
+        cache.insert((1, "a".to_string()), 12);
+        assert_eq!(cache.get(&(1, "a".to_string())), Some(12));
+        assert_eq!(cache.len(), 2);
+
+        cache.remove(&(1, "a".to_string()));
+        assert_eq!(cache.get(&(1, "a".to_string())), None);
+        assert_eq!(cache.get(&(1, "b".to_string())), Some(11));
+
+        cache.clear();
+        assert_eq!(cache.len(), 0);
+    }
+
+    #[test]
+    fn test_capacity_is_bounded() {
+        let cache = ClockCache::new(SHARDS * 4);
+        for i in 0..10_000i64 {
+            cache.insert(i, i);
+        }
+        assert!(cache.len() <= SHARDS * 4);
+        for i in 9_990..10_000 {
+            if let Some(v) = cache.get(&i) {
+                assert_eq!(v, i);
+            }
+        }
+    }
+
+    #[test]
+    fn test_referenced_entries_survive_eviction() {
+        let cache = ClockCache::with_shards(4, 1);
+        for i in 0..4i64 {
+            cache.insert(i, i);
+        }
+        assert_eq!(cache.get(&0), Some(0));
+        assert_eq!(cache.get(&2), Some(2));
+
+        // The sweep clears the bits of 0 and 2 and takes 1 and 3 instead
+        cache.insert(4, 4);
+        cache.insert(5, 5);
+        assert_eq!(cache.len(), 4);
+        for (key, cached) in [
+            (0, true),
+            (1, false),
+            (2, true),
+            (3, false),
+            (4, true),
+            (5, true),
+        ] {
+            assert_eq!(cache.contains(&key), cached, "key {}", key);
+        }
+    }
+
+    #[test]
+    fn test_remove_keeps_index_consistent() {
+        let cache = ClockCache::with_shards(64, 1);
+        for i in 0..64i64 {
+            cache.insert(i, i * 2);
+        }
+        for i in (0..64i64).step_by(3) {
+            cache.remove(&i);
+        }
+        for i in 0..64i64 {
+            let expected = if i % 3 == 0 { None } else { Some(i * 2) };
+            assert_eq!(cache.get(&i), expected);
+        }
+
+        // Freed slots are reused before anything is evicted
+        for i in (0..64i64).step_by(3) {
+            cache.insert(i, i * 2);
+        }
+        assert_eq!(cache.len(), 64);
+        assert!((0..64i64).all(|i| cache.get(&i) == Some(i * 2)));
+    }
+
+    #[test]
+    fn test_concurrent_access() {
+        let cache = Arc::new(ClockCache::new(1024));
+        let threads: Vec<_> = (0..8i64)
+            .map(|t| {
+                let cache = cache.clone();
+                std::thread::spawn(move || {
+                    for i in 0..10_000i64 {
+                        let key = (t * 10_000 + i) % 2048;
+                        cache.insert(key, key);
+                        if let Some(v) = cache.get(&key) {
+                            assert_eq!(v, key);
+                        }
+                        if i % 7 == 0 {
+                            cache.remove(&key);
+                        }
+                    }
+                })
+            })
+            .collect();
+        for t in threads {
+            t.join().unwrap();
+        }
+        assert!(cache.len() <= 1024 + SHARDS);
+    }
+}
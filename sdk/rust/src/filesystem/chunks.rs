@@ -0,0 +1,849 @@
+//! Storage of file contents.
+//!
+//! Files are split into fixed-size chunks keyed by `(ino, chunk_index)` in
+//! `fs_data`. By default every row holds its chunk's bytes.
+//!
+//! With `extent_size` set in `fs_config`, large files are stored in
+//! extents: a row whose index is a multiple of `extent_size / chunk_size`
+//! may hold up to `extent_size` bytes, covering that many consecutive
+//! chunks, so a 1 GiB file takes about a thousand rows instead of a quarter
+//! million. Rows never overlap. Extents are written for whole files and for
+//! fully rewritten groups of chunks; a partial write into an extent splits
+//! it back into chunks first. Like dedup and compression, extents are
+//! opt-in, since readers that assume one chunk per row can't read them.
+//!
+//! A filesystem in dedup mode (`dedup = sha256` in `fs_config`) stores each
+//! distinct chunk once in `fs_chunk`, keyed by its SHA-256 and reference
+//! counted, and `fs_data` rows only hold the hash. The mode is fixed when the
+//! filesystem is created, like `chunk_size`.
+//!
+//! With `compression` set in `fs_config`, chunks are compressed on write and
+//! the table holding chunk bytes gets a `compressed` flag per row. Chunks
+//! that don't get smaller, and chunks written before compression was
+//! enabled, are stored raw with the flag cleared.
+
+use super::agentfs::DEFAULT_CHUNK_SIZE;
+use crate::error::{Error, Result};
+use sha2::{Digest, Sha256};
+use std::borrow::Cow;
+use std::cell::RefCell;
+use std::collections::BTreeMap;
+use std::str::FromStr;
+use turso::{Connection, Value};
+
+/// `fs_config` key recording the dedup mode
+const DEDUP_KEY: &str = "dedup";
+/// The only supported dedup hash
+const DEDUP_SHA256: &str = "sha256";
+/// `fs_config` key recording the chunk compression codec
+const COMPRESSION_KEY: &str = "compression";
+/// `fs_config` key recording the chunk size
+const CHUNK_SIZE_KEY: &str = "chunk_size";
+/// `fs_config` key recording the largest extent
+const EXTENT_SIZE_KEY: &str = "extent_size";
+/// zstd level used for chunks; low levels keep writes cheap and decompression
+/// speed barely depends on the level
+const ZSTD_LEVEL: i32 = 1;
+
+thread_local! {
+    // Compression contexts are costly to set up, so each thread keeps one
+    static ZSTD_COMPRESSOR: RefCell<Option<zstd::bulk::Compressor<'static>>> =
+        const { RefCell::new(None) };
+    static ZSTD_DECOMPRESSOR: RefCell<Option<zstd::bulk::Decompressor<'static>>> =
+        const { RefCell::new(None) };
+}
+
+/// Compression codec for file chunks
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Compression {
+    /// Zstandard
+    Zstd,
+}
+
+impl Compression {
+    /// Name stored in `fs_config`
+    pub fn as_str(&self) -> &'static str {
+        match self {
+            Compression::Zstd => "zstd",
+        }
+    }
+
+    fn compress(&self, data: &[u8]) -> Result<Vec<u8>> {
+        match self {
+            Compression::Zstd => ZSTD_COMPRESSOR.with(|compressor| {
+                let mut compressor = compressor.borrow_mut();
+                if compressor.is_none() {
+                    *compressor = Some(zstd::bulk::Compressor::new(ZSTD_LEVEL)?);
+                }
+                Ok(compressor.as_mut().unwrap().compress(data)?)
+            }),
+        }
+    }
+
+    fn decompress(&self, data: &[u8]) -> Result<Vec<u8>> {
+        match self {
+            Compression::Zstd => {
+                // Chunks are compressed in one shot, so the frame records its size
+                let size = zstd::zstd_safe::get_frame_content_size(data)
+                    .ok()
+                    .flatten()
+                    .ok_or_else(|| Error::Internal("corrupt compressed chunk".to_string()))?;
+                ZSTD_DECOMPRESSOR.with(|decompressor| {
+                    let mut decompressor = decompressor.borrow_mut();
+                    if decompressor.is_none() {
+                        *decompressor = Some(zstd::bulk::Decompressor::new()?);
+                    }
+                    Ok(decompressor
+                        .as_mut()
+                        .unwrap()
+                        .decompress(data, size as usize)?)
+                })
+            }
+        }
+    }
+}
+
+impl FromStr for Compression {
+    type Err = Error;
+
+    fn from_str(s: &str) -> Result<Self> {
+        match s {
+            "zstd" => Ok(Compression::Zstd),
+            _ => Err(Error::Internal(format!("unsupported compression '{}'", s))),
+        }
+    }
+}
+
+/// How chunk contents are laid out in the database
+#[derive(Debug, Clone, Copy)]
+pub(crate) struct ChunkStore {
+    dedup: bool,
+    compression: Option<Compression>,
+    chunk_size: u64,
+    /// Chunks per extent; 1 when files are only stored in chunks
+    extent_chunks: u64,
+}
+
+impl Default for ChunkStore {
+    fn default() -> Self {
+        Self {
+            dedup: false,
+            compression: None,
+            chunk_size: DEFAULT_CHUNK_SIZE as u64,
+            extent_chunks: 1,
+        }
+    }
+}
+
+impl ChunkStore {
+    /// Read the storage mode from `fs_config`
+    pub(crate) async fn load(conn: &Connection) -> Result<Self> {
+        let mut rows = conn
+            .query(
+                "SELECT key, value FROM fs_config WHERE key IN (?, ?, ?, ?)",
+                (DEDUP_KEY, COMPRESSION_KEY, CHUNK_SIZE_KEY, EXTENT_SIZE_KEY),
+            )
+            .await?;
+        let mut store = Self::default();
+        let mut extent_size = None;
+        while let Some(row) = rows.next().await? {
+            let (Ok(Value::Text(key)), Ok(Value::Text(value))) =
+                (row.get_value(0), row.get_value(1))
+            else {
+                continue;
+            };
+            match key.as_str() {
+                DEDUP_KEY => {
+                    if value != DEDUP_SHA256 {
+                        return Err(Error::Internal(format!(
+                            "unsupported dedup mode '{}'",
+                            value
+                        )));
+                    }
+                    store.dedup = true;
+                }
+                COMPRESSION_KEY => store.compression = Some(value.parse()?),
+                CHUNK_SIZE_KEY => {
+                    if let Ok(chunk_size) = value.parse::<u64>() {
+                        store.chunk_size = chunk_size;
+                    }
+                }
+                _ => extent_size = Some(value),
+            }
+        }
+
+        if let Some(value) = extent_size {
+            match value.parse::<u64>() {
+                Ok(size) if size >= store.chunk_size && size % store.chunk_size == 0 => {
+                    store.extent_chunks = size / store.chunk_size;
+                }
+                _ => {
+                    return Err(Error::Internal(format!(
+                        "invalid extent_size '{}' for {} byte chunks",
+                        value, store.chunk_size
+                    )))
+                }
+            }
+        }
+        Ok(store)
+    }
+
+    /// Whether identical chunks are stored once
+    pub(crate) fn is_dedup(&self) -> bool {
+        self.dedup
+    }
+
+    /// Codec new chunks are compressed with
+    pub(crate) fn compression(&self) -> Option<Compression> {
+        self.compression
+    }
+
+    /// Largest number of bytes stored in one row
+    pub(crate) fn extent_size(&self) -> u64 {
+        self.chunk_size * self.extent_chunks
+    }
+
+    /// Create the chunk tables for this mode. `fs_config` must exist.
+    pub(crate) async fn create_tables(&self, conn: &Connection) -> Result<()> {
+        let compressed = self.compression.is_some();
+        let sql = match (self.dedup, compressed) {
+            (false, false) => {
+                "CREATE TABLE IF NOT EXISTS fs_data (
+                    ino INTEGER NOT NULL,
+                    chunk_index INTEGER NOT NULL,
+                    data BLOB NOT NULL,
+                    PRIMARY KEY (ino, chunk_index)
+                )"
+            }
+            (false, true) => {
+                "CREATE TABLE IF NOT EXISTS fs_data (
+                    ino INTEGER NOT NULL,
+                    chunk_index INTEGER NOT NULL,
+                    data BLOB NOT NULL,
+                    compressed INTEGER NOT NULL DEFAULT 0,
+                    PRIMARY KEY (ino, chunk_index)
+                )"
+            }
+            (true, false) => {
+                "CREATE TABLE IF NOT EXISTS fs_chunk (
+                    hash BLOB PRIMARY KEY,
+                    data BLOB NOT NULL,
+                    refcount INTEGER NOT NULL
+                )"
+            }
+            (true, true) => {
+                "CREATE TABLE IF NOT EXISTS fs_chunk (
+                    hash BLOB PRIMARY KEY,
+                    data BLOB NOT NULL,
+                    refcount INTEGER NOT NULL,
+                    compressed INTEGER NOT NULL DEFAULT 0
+                )"
+            }
+        };
+        conn.execute(sql, ()).await?;
+
+        if self.dedup {
+            conn.execute(
+                "CREATE TABLE IF NOT EXISTS fs_data (
+                    ino INTEGER NOT NULL,
+                    chunk_index INTEGER NOT NULL,
+                    hash BLOB NOT NULL,
+                    PRIMARY KEY (ino, chunk_index)
+                )",
+                (),
+            )
+            .await?;
+        }
+        Ok(())
+    }
+
+    /// Switch a filesystem that doesn't store any file data yet to dedup mode
+    ///
+    /// Does nothing if dedup is already enabled, and fails if files already
+    /// have contents in the plain layout.
+    pub(crate) async fn enable_dedup(conn: &Connection) -> Result<()> {
+        Self::create_config(conn).await?;
+        let mut store = Self::load(conn).await?;
+        if store.dedup {
+            return Ok(());
+        }
+
+        if Self::table_exists(conn, "fs_data").await? {
+            let mut rows = conn.query("SELECT 1 FROM fs_data LIMIT 1", ()).await?;
+            if rows.next().await?.is_some() {
+                return Err(Error::Internal(
+                    "cannot enable dedup on a filesystem that already stores file data".to_string(),
+                ));
+            }
+            // The empty plain table has the wrong columns for dedup mode
+            conn.execute("DROP TABLE fs_data", ()).await?;
+        }
+
+        conn.execute(
+            "INSERT INTO fs_config (key, value) VALUES (?, ?)",
+            (DEDUP_KEY, DEDUP_SHA256),
+        )
+        .await?;
+        store.dedup = true;
+        store.create_tables(conn).await
+    }
+
+    /// Store up to `extent_size` bytes (rounded down to whole chunks) per
+    /// row from the next open on
+    ///
+    /// Rows stored in chunks stay valid. Does nothing if extents are
+    /// already enabled.
+    pub(crate) async fn enable_extents(conn: &Connection, extent_size: u64) -> Result<()> {
+        Self::create_config(conn).await?;
+        let store = Self::load(conn).await?;
+        if store.extent_chunks > 1 {
+            return Ok(());
+        }
+        let extent_size = std::cmp::max(extent_size / store.chunk_size, 1) * store.chunk_size;
+        conn.execute(
+            "INSERT OR REPLACE INTO fs_config (key, value) VALUES (?, ?)",
+            (EXTENT_SIZE_KEY, extent_size.to_string()),
+        )
+        .await?;
+        Ok(())
+    }
+
+    /// Compress chunks written from now on with `compression`
+    ///
+    /// Existing chunks stay raw and remain readable. Does nothing if the
+    /// codec is already enabled, and fails if a different one is.
+    pub(crate) async fn enable_compression(
+        conn: &Connection,
+        compression: Compression,
+    ) -> Result<()> {
+        Self::create_config(conn).await?;
+        let mut store = Self::load(conn).await?;
+        match store.compression {
+            Some(current) if current == compression => return Ok(()),
+            Some(current) => {
+                return Err(Error::Internal(format!(
+                    "filesystem already uses {} compression",
+                    current.as_str()
+                )))
+            }
+            None => {}
+        }
+
+        // Tables created by an earlier open lack the flag column
+        let table = if store.dedup { "fs_chunk" } else { "fs_data" };
+        if Self::table_exists(conn, table).await? {
+            conn.execute(
+                &format!(
+                    "ALTER TABLE {} ADD COLUMN compressed INTEGER NOT NULL DEFAULT 0",
+                    table
+                ),
+                (),
+            )
+            .await?;
+        }
+
+        conn.execute(
+            "INSERT INTO fs_config (key, value) VALUES (?, ?)",
+            (COMPRESSION_KEY, compression.as_str()),
+        )
+        .await?;
+        store.compression = Some(compression);
+        store.create_tables(conn).await
+    }
+
+    /// Read one chunk, `None` if it isn't stored
+    pub(crate) async fn read(
+        &self,
+        conn: &Connection,
+        ino: i64,
+        chunk_index: u64,
+    ) -> Result<Option<Vec<u8>>> {
+        let chunk_size = self.chunk_size as usize;
+        if let Some(mut data) = self.read_row(conn, ino, chunk_index).await? {
+            // An extent starting here holds the following chunks too
+            data.truncate(chunk_size);
+            return Ok(Some(data));
+        }
+
+        let start = self.extent_start(chunk_index);
+        if start == chunk_index {
+            return Ok(None);
+        }
+        let skip = (chunk_index - start) as usize * chunk_size;
+        Ok(self
+            .read_row(conn, ino, start)
+            .await?
+            .filter(|data| data.len() > skip)
+            .map(|data| data[skip..std::cmp::min(data.len(), skip + chunk_size)].to_vec()))
+    }
+
+    /// Read the row stored at `chunk_index`, which may be an extent
+    async fn read_row(
+        &self,
+        conn: &Connection,
+        ino: i64,
+        chunk_index: u64,
+    ) -> Result<Option<Vec<u8>>> {
+        let sql = match (self.dedup, self.compression.is_some()) {
+            (false, false) => "SELECT data, 0 FROM fs_data WHERE ino = ? AND chunk_index = ?",
+            (false, true) => {
+                "SELECT data, compressed FROM fs_data WHERE ino = ? AND chunk_index = ?"
+            }
+            (true, false) => {
+                "SELECT c.data, 0 FROM fs_data d JOIN fs_chunk c ON c.hash = d.hash
+                 WHERE d.ino = ? AND d.chunk_index = ?"
+            }
+            (true, true) => {
+                "SELECT c.data, c.compressed FROM fs_data d JOIN fs_chunk c ON c.hash = d.hash
+                 WHERE d.ino = ? AND d.chunk_index = ?"
+            }
+        };
+        let mut stmt = conn.prepare_cached(sql).await?;
+        let mut rows = stmt.query((ino, chunk_index as i64)).await?;
+        match rows.next().await? {
+            Some(row) => match row.get_value(0) {
+                Ok(Value::Blob(data)) => Ok(Some(self.decode(data, &row)?)),
+                _ => Ok(None),
+            },
+            None => Ok(None),
+        }
+    }
+
+    /// Read the rows covering chunks `first..=last`, in index order
+    ///
+    /// Each row is returned with the index of its first chunk and may be an
+    /// extent reaching before `first` or past `last`.
+    pub(crate) async fn read_range(
+        &self,
+        conn: &Connection,
+        ino: i64,
+        first: u64,
+        last: u64,
+    ) -> Result<Vec<(u64, Vec<u8>)>> {
+        let sql = match (self.dedup, self.compression.is_some()) {
+            (false, false) => {
+                "SELECT data, 0, chunk_index FROM fs_data
+                 WHERE ino = ? AND chunk_index >= ? AND chunk_index <= ?
+                 ORDER BY chunk_index"
+            }
+            (false, true) => {
+                "SELECT data, compressed, chunk_index FROM fs_data
+                 WHERE ino = ? AND chunk_index >= ? AND chunk_index <= ?
+                 ORDER BY chunk_index"
+            }
+            (true, false) => {
+                "SELECT c.data, 0, d.chunk_index FROM fs_data d JOIN fs_chunk c ON c.hash = d.hash
+                 WHERE d.ino = ? AND d.chunk_index >= ? AND d.chunk_index <= ?
+                 ORDER BY d.chunk_index"
+            }
+            (true, true) => {
+                "SELECT c.data, c.compressed, d.chunk_index FROM fs_data d
+                 JOIN fs_chunk c ON c.hash = d.hash
+                 WHERE d.ino = ? AND d.chunk_index >= ? AND d.chunk_index <= ?
+                 ORDER BY d.chunk_index"
+            }
+        };
+        let last = std::cmp::min(last, i64::MAX as u64);
+        let mut stmt = conn.prepare_cached(sql).await?;
+        let mut rows = stmt.query((ino, first as i64, last as i64)).await?;
+
+        let mut chunks = Vec::new();
+        while let Some(row) = rows.next().await? {
+            let chunk_index = row
+                .get_value(2)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u64;
+            if let Ok(Value::Blob(data)) = row.get_value(0) {
+                chunks.push((chunk_index, self.decode(data, &row)?));
+            }
+        }
+
+        // A stored `first` rules out an extent covering it
+        let start = self.extent_start(first);
+        if start != first && chunks.first().map(|(index, _)| *index) != Some(first) {
+            if let Some(data) = self.read_row(conn, ino, start).await? {
+                if data.len() as u64 > (first - start) * self.chunk_size {
+                    chunks.insert(0, (start, data));
+                }
+            }
+        }
+        Ok(chunks)
+    }
+
+    /// Read every stored chunk of a file, in index order
+    pub(crate) async fn read_all(
+        &self,
+        conn: &Connection,
+        ino: i64,
+    ) -> Result<Vec<(u64, Vec<u8>)>> {
+        self.read_range(conn, ino, 0, u64::MAX).await
+    }
+
+    /// Store `data` as chunk `chunk_index` of `ino`, replacing any existing chunk
+    pub(crate) async fn write(
+        &self,
+        conn: &Connection,
+        ino: i64,
+        chunk_index: u64,
+        data: &[u8],
+    ) -> Result<()> {
+        let start = self.extent_start(chunk_index);
+        if let Some(extent) = self.extent_at(conn, ino, start).await? {
+            for (i, chunk) in extent.chunks(self.chunk_size as usize).enumerate() {
+                let index = start + i as u64;
+                if index != chunk_index {
+                    self.write_row(conn, ino, index, chunk).await?;
+                }
+            }
+        }
+        self.write_row(conn, ino, chunk_index, data).await
+    }
+
+    /// Store `data`, the contents of `ino` from chunk `first` on, in as few
+    /// rows as possible. Nothing may be stored past `first` yet.
+    pub(crate) async fn write_run(
+        &self,
+        conn: &Connection,
+        ino: i64,
+        first: u64,
+        data: &[u8],
+    ) -> Result<()> {
+        let extent_size = self.extent_size() as usize;
+        let mut chunk_index = first;
+        let mut pos = 0;
+        while pos < data.len() {
+            let len = if self.extent_chunks > 1
+                && chunk_index % self.extent_chunks == 0
+                && data.len() - pos >= extent_size
+            {
+                extent_size
+            } else {
+                std::cmp::min(self.chunk_size as usize, data.len() - pos)
+            };
+            self.write_row(conn, ino, chunk_index, &data[pos..pos + len])
+                .await?;
+            chunk_index += (len as u64).div_ceil(self.chunk_size);
+            pos += len;
+        }
+        Ok(())
+    }
+
+    /// Store whole chunks of `ino`, merging each complete group of full
+    /// chunks into one extent
+    pub(crate) async fn write_chunks(
+        &self,
+        conn: &Connection,
+        ino: i64,
+        chunks: &BTreeMap<u64, Vec<u8>>,
+    ) -> Result<()> {
+        let span = self.extent_chunks;
+        let mut merged_until = 0;
+        for (&chunk_index, chunk) in chunks {
+            if chunk_index < merged_until {
+                continue;
+            }
+            if span > 1 && chunk_index % span == 0 {
+                let group: Vec<&[u8]> = chunks
+                    .range(chunk_index..chunk_index + span)
+                    .map(|(_, chunk)| chunk.as_slice())
+                    .filter(|chunk| chunk.len() as u64 == self.chunk_size)
+                    .collect();
+                if group.len() as u64 == span {
+                    self.delete_rows(conn, ino, chunk_index + 1, chunk_index + span - 1)
+                        .await?;
+                    self.write_row(conn, ino, chunk_index, &group.concat())
+                        .await?;
+                    merged_until = chunk_index + span;
+                    continue;
+                }
+            }
+            self.write(conn, ino, chunk_index, chunk).await?;
+        }
+        Ok(())
+    }
+
+    /// Store `data` as the row at `chunk_index`, replacing any existing row
+    async fn write_row(
+        &self,
+        conn: &Connection,
+        ino: i64,
+        chunk_index: u64,
+        data: &[u8],
+    ) -> Result<()> {
+        if !self.dedup {
+            if self.compression.is_none() {
+                let mut stmt = conn
+                    .prepare_cached(
+                        "INSERT OR REPLACE INTO fs_data (ino, chunk_index, data) VALUES (?, ?, ?)",
+                    )
+                    .await?;
+                stmt.execute((ino, chunk_index as i64, data)).await?;
+                return Ok(());
+            }
+
+            let (stored, compressed) = self.encode(data)?;
+            let mut stmt = conn
+                .prepare_cached(
+                    "INSERT OR REPLACE INTO fs_data (ino, chunk_index, data, compressed)
+                     VALUES (?, ?, ?, ?)",
+                )
+                .await?;
+            stmt.execute((ino, chunk_index as i64, &stored[..], compressed))
+                .await?;
+            return Ok(());
+        }
+
+        let hash = Sha256::digest(data).to_vec();
+        let old = self.chunk_hash(conn, ino, chunk_index).await?;
+        if old.as_deref() == Some(hash.as_slice()) {
+            return Ok(());
+        }
+
+        // Take the new reference before dropping the old one, so a failure
+        // in between leaks a chunk instead of losing one. Known contents are
+        // not compressed again.
+        let mut stmt = conn
+            .prepare_cached("UPDATE fs_chunk SET refcount = refcount + 1 WHERE hash = ?")
+            .await?;
+        if stmt.execute((hash.as_slice(),)).await? == 0 {
+            if self.compression.is_none() {
+                let mut stmt = conn
+                    .prepare_cached("INSERT INTO fs_chunk (hash, data, refcount) VALUES (?, ?, 1)")
+                    .await?;
+                stmt.execute((hash.as_slice(), data)).await?;
+            } else {
+                let (stored, compressed) = self.encode(data)?;
+                let mut stmt = conn
+                    .prepare_cached(
+                        "INSERT INTO fs_chunk (hash, data, refcount, compressed)
+                         VALUES (?, ?, 1, ?)",
+                    )
+                    .await?;
+                stmt.execute((hash.as_slice(), &stored[..], compressed))
+                    .await?;
+            }
+        }
+
+        let mut stmt = conn
+            .prepare_cached(
+                "INSERT OR REPLACE INTO fs_data (ino, chunk_index, hash) VALUES (?, ?, ?)",
+            )
+            .await?;
+        stmt.execute((ino, chunk_index as i64, hash.as_slice()))
+            .await?;
+
+        if let Some(old) = old {
+            Self::release(conn, &old).await?;
+        }
+        Ok(())
+    }
+
+    /// Delete the chunks of `ino` from `first` on; `0` deletes the whole file
+    pub(crate) async fn delete_from(&self, conn: &Connection, ino: i64, first: u64) -> Result<()> {
+        let start = self.extent_start(first);
+        if start != first {
+            if let Some(extent) = self.extent_at(conn, ino, start).await? {
+                let keep = ((first - start) * self.chunk_size) as usize;
+                if keep < extent.len() {
+                    self.write_row(conn, ino, start, &extent[..keep]).await?;
+                }
+            }
+        }
+        self.delete_rows(conn, ino, first, i64::MAX as u64).await
+    }
+
+    /// Delete the rows of `ino` with index in `first..=last`
+    async fn delete_rows(&self, conn: &Connection, ino: i64, first: u64, last: u64) -> Result<()> {
+        if self.dedup {
+            // One reference per row, even when a file repeats a chunk
+            let mut stmt = conn
+                .prepare_cached(
+                    "SELECT hash FROM fs_data WHERE ino = ? AND chunk_index >= ? AND chunk_index <= ?",
+                )
+                .await?;
+            let mut rows = stmt.query((ino, first as i64, last as i64)).await?;
+            let mut hashes = Vec::new();
+            while let Some(row) = rows.next().await? {
+                if let Ok(Value::Blob(hash)) = row.get_value(0) {
+                    hashes.push(hash);
+                }
+            }
+
+            let mut stmt = conn
+                .prepare_cached(
+                    "DELETE FROM fs_data WHERE ino = ? AND chunk_index >= ? AND chunk_index <= ?",
+                )
+                .await?;
+            stmt.execute((ino, first as i64, last as i64)).await?;
+
+            for hash in hashes {
+                Self::release(conn, &hash).await?;
+            }
+            return Ok(());
+        }
+
+        let mut stmt = conn
+            .prepare_cached(
+                "DELETE FROM fs_data WHERE ino = ? AND chunk_index >= ? AND chunk_index <= ?",
+            )
+            .await?;
+        stmt.execute((ino, first as i64, last as i64)).await?;
+        Ok(())
+    }
+
+    /// Index of the first chunk of the extent that could hold `chunk_index`
+    fn extent_start(&self, chunk_index: u64) -> u64 {
+        chunk_index - chunk_index % self.extent_chunks
+    }
+
+    /// Contents of the extent stored at `start`, `None` if the row there is
+    /// a plain chunk or missing
+    async fn extent_at(&self, conn: &Connection, ino: i64, start: u64) -> Result<Option<Vec<u8>>> {
+        if self.extent_chunks == 1 {
+            return Ok(None);
+        }
+
+        // Only the row at `start` may span the group, and only when no other
+        // rows are stored in it, which the primary key index can tell
+        // without reading any row
+        let mut stmt = conn
+            .prepare_cached(
+                "SELECT chunk_index FROM fs_data
+                 WHERE ino = ? AND chunk_index >= ? AND chunk_index < ?
+                 ORDER BY chunk_index LIMIT 2",
+            )
+            .await?;
+        let mut rows = stmt
+            .query((ino, start as i64, (start + self.extent_chunks) as i64))
+            .await?;
+        let mut indexes = Vec::with_capacity(2);
+        while let Some(row) = rows.next().await? {
+            indexes.push(row.get_value(0).ok().and_then(|v| v.as_integer().copied()));
+        }
+        if indexes != [Some(start as i64)] {
+            return Ok(None);
+        }
+
+        Ok(self
+            .read_row(conn, ino, start)
+            .await?
+            .filter(|data| data.len() as u64 > self.chunk_size))
+    }
+
+    /// Compress a chunk for storage, returning the bytes to store and the
+    /// `compressed` flag. Chunks that don't shrink are stored raw.
+    fn encode<'a>(&self, data: &'a [u8]) -> Result<(Cow<'a, [u8]>, i64)> {
+        if let Some(compression) = self.compression {
+            let compressed = compression.compress(data)?;
+            if compressed.len() < data.len() {
+                return Ok((Cow::Owned(compressed), 1));
+            }
+        }
+        Ok((Cow::Borrowed(data), 0))
+    }
+
+    /// Turn stored chunk bytes back into contents, given the row they were
+    /// read from (the flag is column 1)
+    fn decode(&self, data: Vec<u8>, row: &turso::Row) -> Result<Vec<u8>> {
+        let compressed = row
+            .get_value(1)
+            .ok()
+            .and_then(|v| v.as_integer().copied())
+            .unwrap_or(0);
+        match self.compression {
+            Some(compression) if compressed != 0 => compression.decompress(&data),
+            _ if compressed != 0 => Err(Error::Internal(
+                "compressed chunk without a compression codec".to_string(),
+            )),
+            _ => Ok(data),
+        }
+    }
+
+    /// Hash referenced by one chunk of a file in dedup mode
+    async fn chunk_hash(
+        &self,
+        conn: &Connection,
+        ino: i64,
+        chunk_index: u64,
+    ) -> Result<Option<Vec<u8>>> {
+        let mut stmt = conn
+            .prepare_cached("SELECT hash FROM fs_data WHERE ino = ? AND chunk_index = ?")
+            .await?;
+        let mut rows = stmt.query((ino, chunk_index as i64)).await?;
+        Ok(match rows.next().await? {
+            Some(row) => match row.get_value(0) {
+                Ok(Value::Blob(hash)) => Some(hash),
+                _ => None,
+            },
+            None => None,
+        })
+    }
+
+    /// Drop one reference to a chunk, deleting it with the last one
+    async fn release(conn: &Connection, hash: &[u8]) -> Result<()> {
+        let mut stmt = conn
+            .prepare_cached("UPDATE fs_chunk SET refcount = refcount - 1 WHERE hash = ?")
+            .await?;
+        stmt.execute((hash,)).await?;
+        let mut stmt = conn
+            .prepare_cached("DELETE FROM fs_chunk WHERE hash = ? AND refcount <= 0")
+            .await?;
+        stmt.execute((hash,)).await?;
+        Ok(())
+    }
+
+    async fn create_config(conn: &Connection) -> Result<()> {
+        conn.execute(
+            "CREATE TABLE IF NOT EXISTS fs_config (
+                key TEXT PRIMARY KEY,
+                value TEXT NOT NULL
+            )",
+            (),
+        )
+        .await?;
+        Ok(())
+    }
+
+    async fn table_exists(conn: &Connection, name: &str) -> Result<bool> {
+        let mut rows = conn
+            .query(
+                "SELECT name FROM sqlite_schema WHERE type = 'table' AND name = ?",
+                (name,),
+            )
+            .await?;
+        Ok(rows.next().await?.is_some())
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_compression_names_round_trip() {
+        assert_eq!("zstd".parse::<Compression>().unwrap(), Compression::Zstd);
+        assert_eq!(Compression::Zstd.as_str(), "zstd");
+        assert!("lz4".parse::<Compression>().is_err());
+    }
+
+    #[test]
+    fn test_encode_falls_back_to_raw() -> Result<()> {
+        let store = ChunkStore {
+            compression: Some(Compression::Zstd),
+            ..Default::default()
+        };
+
+        let text = b"abcabcabc".repeat(400);
+        let (stored, compressed) = store.encode(&text)?;
+        assert_eq!(compressed, 1);
+        assert!(stored.len() < text.len());
+        assert_eq!(Compression::Zstd.decompress(&stored)?, text);
+
+        // Too short to be worth a zstd frame
+        let (stored, compressed) = store.encode(b"x")?;
+        assert_eq!(compressed, 0);
+        assert_eq!(&stored[..], b"x");
+        Ok(())
+    }
+}
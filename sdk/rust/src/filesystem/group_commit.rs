@@ -0,0 +1,141 @@
+//! Group commit for fsync.
+//!
+//! The writer connection runs with `synchronous = OFF`, so making data
+//! durable takes a commit with `synchronous = FULL`. Doing that per fsync
+//! serializes concurrent callers behind one full sync each, and lets them
+//! race on the connection-wide pragma. Instead, fsync requests from every
+//! handle queue up here. A single flusher task takes everything queued, runs
+//! one durable commit and acknowledges all of those requests with its
+//! result. Requests arriving while a commit is in flight go into the next
+//! one.
+
+use super::agentfs::WriterLock;
+use crate::error::{Error, Result};
+use crate::metrics;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::sync::{Arc, Mutex};
+use std::time::Duration;
+use tokio::sync::oneshot;
+use turso::Connection;
+
+type Waiter = oneshot::Sender<std::result::Result<(), String>>;
+
+pub(crate) struct GroupCommit {
+    conn: Arc<Connection>,
+    /// Held for each commit, which runs on the shared writer connection
+    writer: WriterLock,
+    state: Mutex<State>,
+    /// How long the flusher waits for more requests before committing, in
+    /// microseconds
+    max_wait_us: AtomicU64,
+    /// Durable commits run so far
+    commits: AtomicU64,
+}
+
+#[derive(Default)]
+struct State {
+    /// Requests for the next commit
+    waiters: Vec<Waiter>,
+    /// Whether a flusher task is running
+    flushing: bool,
+}
+
+impl GroupCommit {
+    pub(crate) fn new(conn: Arc<Connection>, writer: WriterLock) -> Self {
+        Self {
+            conn,
+            writer,
+            state: Mutex::new(State::default()),
+            max_wait_us: AtomicU64::new(0),
+            commits: AtomicU64::new(0),
+        }
+    }
+
+    /// Set how long a request may wait for others to share its commit
+    pub(crate) fn set_max_wait(&self, max_wait: Duration) {
+        self.max_wait_us
+            .store(max_wait.as_micros() as u64, Ordering::Relaxed);
+    }
+
+    /// Number of durable commits run so far
+    #[cfg(test)]
+    pub(crate) fn commits(&self) -> u64 {
+        self.commits.load(Ordering::Relaxed)
+    }
+
+    /// Wait until everything committed before the call is durable
+    pub(crate) async fn sync(self: &Arc<Self>) -> Result<()> {
+        let (tx, rx) = oneshot::channel();
+        let start = {
+            let mut state = self.state.lock().unwrap();
+            state.waiters.push(tx);
+            !std::mem::replace(&mut state.flushing, true)
+        };
+        if start {
+            // A task of its own, so a caller that gives up waiting doesn't
+            // strand the others
+            let this = self.clone();
+            tokio::spawn(async move { this.run().await });
+        }
+        match rx.await {
+            Ok(result) => result.map_err(Error::Internal),
+            Err(_) => Err(Error::Internal("fsync flusher exited".to_string())),
+        }
+    }
+
+    /// Commit batches until no requests are left
+    async fn run(&self) {
+        loop {
+            let max_wait = self.max_wait_us.load(Ordering::Relaxed);
+            if max_wait > 0 {
+                tokio::time::sleep(Duration::from_micros(max_wait)).await;
+            }
+            let waiters = {
+                let mut state = self.state.lock().unwrap();
+                if state.waiters.is_empty() {
+                    state.flushing = false;
+                    return;
+                }
+                std::mem::take(&mut state.waiters)
+            };
+
+            let result = self
+                .commit()
+                .await
+                .map_err(|e| format!("fsync failed: {}", e));
+            self.commits.fetch_add(1, Ordering::Relaxed);
+            metrics::durable_commit();
+            for waiter in waiters {
+                let _ = waiter.send(result.clone());
+            }
+        }
+    }
+
+    /// Temporarily enable FULL synchronous mode and run a transaction to
+    /// force the WAL to disk. Holds the writer lock, so neither the pragma
+    /// nor the transaction lands in the middle of another change.
+    async fn commit(&self) -> Result<()> {
+        let _writer = self.writer.lock().await?;
+        self.conn
+            .prepare_cached("PRAGMA synchronous = FULL")
+            .await?
+            .execute(())
+            .await?;
+        let result = async {
+            self.conn.prepare_cached("BEGIN").await?.execute(()).await?;
+            self.conn
+                .prepare_cached("COMMIT")
+                .await?
+                .execute(())
+                .await?;
+            Ok::<_, Error>(())
+        }
+        .await;
+        self.conn
+            .prepare_cached("PRAGMA synchronous = OFF")
+            .await?
+            .execute(())
+            .await?;
+        result
+    }
+}
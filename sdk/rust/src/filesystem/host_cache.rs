@@ -0,0 +1,534 @@
+//! Metadata cache for `HostFS`, kept coherent with inotify.
+//!
+//! Caches `lstat` results (including paths that don't exist) and directory
+//! listings by virtual path. An entry is only cached while the directory it
+//! lives in is watched, so every host-side change that could make it stale
+//! produces an event: creating, deleting, moving or writing a child, or
+//! changing its attributes. A background thread reads the events and drops
+//! the affected entries; a directory that is deleted or moved takes its
+//! cached subtree and watches with it.
+//!
+//! Events arrive asynchronously, so a host-side edit becomes visible within
+//! the time the watcher takes to wake up. Changes made through `HostFS`
+//! itself invalidate synchronously. A lookup that raced with an event is not
+//! cached, using a generation counter bumped on every invalidation.
+
+// Nothing constructs the cache where inotify is unavailable
+#![cfg_attr(not(target_os = "linux"), allow(dead_code, unused_imports))]
+
+use super::{DirEntry, Stats};
+use crate::error::Result;
+use std::collections::{BTreeMap, HashMap};
+use std::path::{Path, PathBuf};
+use std::sync::{Arc, Mutex};
+
+#[cfg(target_os = "linux")]
+use std::os::fd::{AsRawFd, FromRawFd, OwnedFd};
+#[cfg(target_os = "linux")]
+use std::sync::Weak;
+
+/// Cached stats plus listed entries beyond which everything is dropped.
+/// Watches are kept, so the cache warms up again without new syscalls for
+/// them.
+const MAX_CACHED_ENTRIES: usize = 100_000;
+
+/// Events that can change a directory's children or their attributes
+#[cfg(target_os = "linux")]
+const WATCH_MASK: u32 = libc::IN_ATTRIB
+    | libc::IN_CREATE
+    | libc::IN_DELETE
+    | libc::IN_DELETE_SELF
+    | libc::IN_MODIFY
+    | libc::IN_MOVE_SELF
+    | libc::IN_MOVED_FROM
+    | libc::IN_MOVED_TO
+    | libc::IN_ONLYDIR;
+
+pub(crate) struct MetadataCache {
+    root: PathBuf,
+    inner: Mutex<Inner>,
+    #[cfg(target_os = "linux")]
+    watcher: Arc<Watcher>,
+}
+
+#[derive(Default)]
+struct Inner {
+    /// Path -> lstat result, `None` if the path doesn't exist. Sorted so a
+    /// subtree can be dropped with a range scan.
+    stats: BTreeMap<String, Option<Stats>>,
+    /// Directory path -> entries sorted by name
+    listings: BTreeMap<String, Vec<DirEntry>>,
+    /// Number of stats plus listed entries
+    size: usize,
+    /// Watch descriptor -> watched directory
+    watches: HashMap<i32, String>,
+    /// Watched directory -> watch descriptor
+    watched: BTreeMap<String, i32>,
+    /// Bumped on every invalidation
+    generation: u64,
+}
+
+impl Inner {
+    fn clear(&mut self) {
+        self.stats.clear();
+        self.listings.clear();
+        self.size = 0;
+    }
+
+    fn remove_stats(&mut self, path: &str) {
+        if self.stats.remove(path).is_some() {
+            self.size -= 1;
+        }
+    }
+
+    fn remove_listing(&mut self, path: &str) {
+        if let Some(entries) = self.listings.remove(path) {
+            self.size -= entries.len();
+        }
+    }
+
+    /// Drop everything cached for `path` and below, returning the watches
+    /// that were dropped with it
+    fn remove_subtree(&mut self, path: &str) -> Vec<i32> {
+        let stats: Vec<String> = subtree(&self.stats, path).cloned().collect();
+        for p in stats {
+            self.remove_stats(&p);
+        }
+        let listings: Vec<String> = subtree(&self.listings, path).cloned().collect();
+        for p in listings {
+            self.remove_listing(&p);
+        }
+        let watched: Vec<String> = subtree(&self.watched, path).cloned().collect();
+        watched
+            .into_iter()
+            .filter_map(|p| self.watched.remove(&p))
+            .inspect(|wd| {
+                self.watches.remove(wd);
+            })
+            .collect()
+    }
+}
+
+/// Keys of `map` equal to `path` or below it
+fn subtree<'a, V>(map: &'a BTreeMap<String, V>, path: &'a str) -> impl Iterator<Item = &'a String> {
+    let prefix = if path == "/" {
+        "/".to_string()
+    } else {
+        format!("{}/", path)
+    };
+    // Siblings such as "/dir.orig" sort between "/dir" and "/dir/...", so the
+    // path itself is looked up apart from the range of its descendants
+    let descendants = map
+        .range(prefix.clone()..)
+        .map(|(p, _)| p)
+        .take_while(move |p| p.starts_with(&prefix))
+        .filter(move |p| p.as_str() != path);
+    map.get_key_value(path)
+        .map(|(p, _)| p)
+        .into_iter()
+        .chain(descendants)
+}
+
+/// Parent directory of a normalized virtual path; the root is its own parent
+pub(crate) fn parent_of(path: &str) -> &str {
+    match path.rfind('/') {
+        Some(0) | None => "/",
+        Some(i) => &path[..i],
+    }
+}
+
+impl MetadataCache {
+    /// Create a cache for the host directory `root` and start its watcher
+    #[cfg(target_os = "linux")]
+    pub(crate) fn new(root: &Path) -> Result<Arc<Self>> {
+        let watcher = Arc::new(Watcher::new()?);
+        let cache = Arc::new(Self {
+            root: root.to_path_buf(),
+            inner: Mutex::new(Inner::default()),
+            watcher: watcher.clone(),
+        });
+        let weak = Arc::downgrade(&cache);
+        std::thread::Builder::new()
+            .name("hostfs-inotify".to_string())
+            .spawn(move || watcher.run(weak))?;
+        Ok(cache)
+    }
+
+    /// Cached lstat of `path`: `Some(None)` if it is known not to exist
+    pub(crate) fn stats(&self, path: &str) -> Option<Option<Stats>> {
+        self.inner.lock().unwrap().stats.get(path).cloned()
+    }
+
+    /// Cached listing of the directory `path`
+    pub(crate) fn listing(&self, path: &str) -> Option<Vec<DirEntry>> {
+        self.inner.lock().unwrap().listings.get(path).cloned()
+    }
+
+    /// Make sure `dir` is watched and return the generation to pass to
+    /// the insert methods, or `None` if entries of `dir` can't be cached
+    pub(crate) fn watch(&self, dir: &str) -> Option<u64> {
+        let mut inner = self.inner.lock().unwrap();
+        if !inner.watched.contains_key(dir) {
+            let wd = self.add_watch(dir)?;
+            // Another path leading to the same directory already owns the
+            // watch, and events are reported under that path only
+            if inner.watches.contains_key(&wd) {
+                return None;
+            }
+            inner.watches.insert(wd, dir.to_string());
+            inner.watched.insert(dir.to_string(), wd);
+        }
+        Some(inner.generation)
+    }
+
+    #[cfg(target_os = "linux")]
+    fn add_watch(&self, dir: &str) -> Option<i32> {
+        use std::os::unix::ffi::OsStrExt;
+
+        let host = self.host_path(dir);
+        let host = std::ffi::CString::new(host.as_os_str().as_bytes()).ok()?;
+        // SAFETY: the fd stays open while `self.watcher` lives and `host` is
+        // a valid C string
+        let wd = unsafe {
+            libc::inotify_add_watch(self.watcher.inotify.as_raw_fd(), host.as_ptr(), WATCH_MASK)
+        };
+        (wd >= 0).then_some(wd)
+    }
+
+    #[cfg(not(target_os = "linux"))]
+    fn add_watch(&self, _dir: &str) -> Option<i32> {
+        None
+    }
+
+    #[cfg(target_os = "linux")]
+    fn rm_watches(&self, wds: Vec<i32>) {
+        for wd in wds {
+            // SAFETY: plain syscall on our own inotify fd
+            unsafe {
+                libc::inotify_rm_watch(self.watcher.inotify.as_raw_fd(), wd);
+            }
+        }
+    }
+
+    #[cfg(not(target_os = "linux"))]
+    fn rm_watches(&self, _wds: Vec<i32>) {}
+
+    fn host_path(&self, path: &str) -> PathBuf {
+        let relative = path.trim_start_matches('/');
+        if relative.is_empty() {
+            self.root.clone()
+        } else {
+            self.root.join(relative)
+        }
+    }
+
+    /// Cache the lstat result of `path`, looked up at `generation`
+    pub(crate) fn insert_stats(&self, path: &str, stats: Option<&Stats>, generation: u64) {
+        let mut inner = self.inner.lock().unwrap();
+        if inner.generation != generation {
+            return;
+        }
+        if inner
+            .stats
+            .insert(path.to_string(), stats.cloned())
+            .is_none()
+        {
+            inner.size += 1;
+        }
+        if inner.size > MAX_CACHED_ENTRIES {
+            inner.clear();
+        }
+    }
+
+    /// Cache the listing of `dir` and the stats of its entries, read at
+    /// `generation`
+    pub(crate) fn insert_listing(&self, dir: &str, entries: &[DirEntry], generation: u64) {
+        let mut inner = self.inner.lock().unwrap();
+        if inner.generation != generation {
+            return;
+        }
+        for entry in entries {
+            let path = if dir == "/" {
+                format!("/{}", entry.name)
+            } else {
+                format!("{}/{}", dir, entry.name)
+            };
+            if inner
+                .stats
+                .insert(path, Some(entry.stats.clone()))
+                .is_none()
+            {
+                inner.size += 1;
+            }
+        }
+        inner.remove_listing(dir);
+        inner.size += entries.len();
+        inner.listings.insert(dir.to_string(), entries.to_vec());
+        if inner.size > MAX_CACHED_ENTRIES {
+            inner.clear();
+        }
+    }
+
+    /// Forget `path` after changing it through `HostFS`. With `subtree`,
+    /// everything below it goes too, for removals and renames.
+    pub(crate) fn invalidate(&self, path: &str, subtree: bool) {
+        let mut inner = self.inner.lock().unwrap();
+        inner.generation += 1;
+        inner.remove_stats(path);
+        inner.remove_listing(path);
+        inner.remove_listing(parent_of(path));
+        let dropped = if subtree {
+            inner.remove_subtree(path)
+        } else {
+            Vec::new()
+        };
+        drop(inner);
+        self.rm_watches(dropped);
+    }
+
+    /// Apply one inotify event for the watch `wd`
+    #[cfg(target_os = "linux")]
+    fn handle_event(&self, inner: &mut Inner, wd: i32, mask: u32, name: &str) -> Vec<i32> {
+        inner.generation += 1;
+        if mask & libc::IN_Q_OVERFLOW != 0 {
+            // Events were lost, so nothing cached can be trusted
+            inner.clear();
+            return Vec::new();
+        }
+        let Some(dir) = inner.watches.get(&wd).cloned() else {
+            return Vec::new();
+        };
+
+        if !name.is_empty() {
+            let child = if dir == "/" {
+                format!("/{}", name)
+            } else {
+                format!("{}/{}", dir, name)
+            };
+            inner.remove_stats(&child);
+            inner.remove_listing(&dir);
+            if mask & (libc::IN_CREATE | libc::IN_DELETE | libc::IN_MOVED_FROM | libc::IN_MOVED_TO)
+                != 0
+            {
+                return inner.remove_subtree(&child);
+            }
+            return Vec::new();
+        }
+
+        // An event on the watched directory itself
+        inner.remove_stats(&dir);
+        inner.remove_listing(&dir);
+        inner.remove_listing(parent_of(&dir));
+        if mask & libc::IN_IGNORED != 0 {
+            // The kernel dropped the watch; forget it without removing it
+            inner.watches.remove(&wd);
+            inner.watched.remove(&dir);
+            inner.remove_subtree(&dir);
+            return Vec::new();
+        }
+        if mask & (libc::IN_DELETE_SELF | libc::IN_MOVE_SELF) != 0 {
+            return inner.remove_subtree(&dir);
+        }
+        Vec::new()
+    }
+}
+
+#[cfg(target_os = "linux")]
+impl Drop for MetadataCache {
+    fn drop(&mut self) {
+        self.watcher.wake();
+    }
+}
+
+/// The inotify instance and the eventfd that stops its thread
+#[cfg(target_os = "linux")]
+struct Watcher {
+    inotify: OwnedFd,
+    wake: OwnedFd,
+}
+
+#[cfg(target_os = "linux")]
+impl Watcher {
+    fn new() -> Result<Self> {
+        // SAFETY: plain syscalls; the returned fds are checked and owned
+        unsafe {
+            let inotify = libc::inotify_init1(libc::IN_NONBLOCK | libc::IN_CLOEXEC);
+            if inotify < 0 {
+                return Err(std::io::Error::last_os_error().into());
+            }
+            let inotify = OwnedFd::from_raw_fd(inotify);
+            let wake = libc::eventfd(0, libc::EFD_NONBLOCK | libc::EFD_CLOEXEC);
+            if wake < 0 {
+                return Err(std::io::Error::last_os_error().into());
+            }
+            Ok(Self {
+                inotify,
+                wake: OwnedFd::from_raw_fd(wake),
+            })
+        }
+    }
+
+    fn wake(&self) {
+        let one = 1u64;
+        // SAFETY: writes 8 bytes from a live u64 to our own eventfd
+        unsafe {
+            libc::write(
+                self.wake.as_raw_fd(),
+                &one as *const u64 as *const libc::c_void,
+                8,
+            );
+        }
+    }
+
+    /// Read events until the cache is dropped
+    fn run(&self, cache: Weak<MetadataCache>) {
+        let mut buf = vec![0u8; 64 * 1024];
+        let header = std::mem::size_of::<libc::inotify_event>();
+        loop {
+            let mut fds = [
+                libc::pollfd {
+                    fd: self.inotify.as_raw_fd(),
+                    events: libc::POLLIN,
+                    revents: 0,
+                },
+                libc::pollfd {
+                    fd: self.wake.as_raw_fd(),
+                    events: libc::POLLIN,
+                    revents: 0,
+                },
+            ];
+            // SAFETY: `fds` is a valid array of two pollfds
+            let ready = unsafe { libc::poll(fds.as_mut_ptr(), 2, -1) };
+            if ready < 0 {
+                if std::io::Error::last_os_error().kind() == std::io::ErrorKind::Interrupted {
+                    continue;
+                }
+                return;
+            }
+            if fds[1].revents != 0 {
+                return;
+            }
+
+            // SAFETY: reads into our own buffer, at most its length
+            let n = unsafe {
+                libc::read(
+                    self.inotify.as_raw_fd(),
+                    buf.as_mut_ptr() as *mut libc::c_void,
+                    buf.len(),
+                )
+            };
+            if n <= 0 {
+                continue;
+            }
+            let Some(cache) = cache.upgrade() else {
+                return;
+            };
+
+            let mut inner = cache.inner.lock().unwrap();
+            let mut dropped = Vec::new();
+            let mut offset = 0;
+            while offset + header <= n as usize {
+                // SAFETY: the kernel wrote a whole event header here; the
+                // buffer has no alignment guarantee, hence the unaligned read
+                let event: libc::inotify_event = unsafe {
+                    std::ptr::read_unaligned(buf[offset..].as_ptr() as *const libc::inotify_event)
+                };
+                let name_start = offset + header;
+                let name_end = name_start + event.len as usize;
+                let name = buf[name_start..name_end]
+                    .split(|&b| b == 0)
+                    .next()
+                    .and_then(|name| std::str::from_utf8(name).ok())
+                    .unwrap_or("");
+                dropped.extend(cache.handle_event(&mut inner, event.wd, event.mask, name));
+                offset = name_end;
+            }
+            drop(inner);
+            cache.rm_watches(dropped);
+        }
+    }
+}
+
+#[cfg(all(test, target_os = "linux"))]
+mod tests {
+    use super::*;
+    use std::time::{Duration, Instant};
+    use tempfile::tempdir;
+
+    fn stats(ino: i64) -> Stats {
+        Stats {
+            ino,
+            mode: 0o100644,
+            nlink: 1,
+            uid: 0,
+            gid: 0,
+            size: 0,
+            atime: 0,
+            mtime: 0,
+            ctime: 0,
+        }
+    }
+
+    /// Wait for the watcher thread to process host-side events
+    fn wait_until(mut cond: impl FnMut() -> bool) -> bool {
+        let deadline = Instant::now() + Duration::from_secs(5);
+        while Instant::now() < deadline {
+            if cond() {
+                return true;
+            }
+            std::thread::sleep(Duration::from_millis(10));
+        }
+        false
+    }
+
+    #[test]
+    fn test_parent_of() {
+        assert_eq!(parent_of("/"), "/");
+        assert_eq!(parent_of("/a"), "/");
+        assert_eq!(parent_of("/a/b"), "/a");
+    }
+
+    #[test]
+    fn test_host_events_invalidate() -> Result<()> {
+        let dir = tempdir()?;
+        std::fs::create_dir(dir.path().join("sub"))?;
+        std::fs::create_dir(dir.path().join("sub.orig"))?;
+        let cache = MetadataCache::new(dir.path())?;
+
+        let generation = cache.watch("/sub").unwrap();
+        cache.insert_stats("/sub/a.txt", Some(&stats(1)), generation);
+        cache.insert_stats("/sub/missing", None, generation);
+        assert!(cache.stats("/sub/a.txt").unwrap().is_some());
+        assert!(cache.stats("/sub/missing").unwrap().is_none());
+
+        std::fs::write(dir.path().join("sub/missing"), b"x")?;
+        assert!(wait_until(|| cache.stats("/sub/missing").is_none()));
+        assert!(cache.stats("/sub/a.txt").is_some());
+
+        // A deleted directory takes its cached subtree along, even with a
+        // sibling sorting between it and its children
+        let generation = cache.watch("/").unwrap();
+        cache.insert_stats("/sub", Some(&stats(2)), generation);
+        cache.insert_stats("/sub.orig", Some(&stats(3)), generation);
+        std::fs::remove_file(dir.path().join("sub/missing"))?;
+        std::fs::remove_dir(dir.path().join("sub"))?;
+        assert!(wait_until(
+            || cache.stats("/sub").is_none() && cache.stats("/sub/a.txt").is_none()
+        ));
+        assert!(!cache.inner.lock().unwrap().watched.contains_key("/sub"));
+        assert!(cache.stats("/sub.orig").unwrap().is_some());
+
+        Ok(())
+    }
+
+    #[test]
+    fn test_stale_generation_is_not_cached() -> Result<()> {
+        let dir = tempdir()?;
+        let cache = MetadataCache::new(dir.path())?;
+        let generation = cache.watch("/").unwrap();
+        cache.invalidate("/a", false);
+        cache.insert_stats("/a", Some(&stats(1)), generation);
+        assert!(cache.stats("/a").is_none());
+        Ok(())
+    }
+}
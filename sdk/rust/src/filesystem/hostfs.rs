@@ -1,4 +1,5 @@
 use crate::error::{Error, Result};
+use crate::metrics::{self, Cache, Layer, Op};
 use async_trait::async_trait;
 use std::os::unix::fs::MetadataExt;
 use std::path::PathBuf;
@@ -8,8 +9,10 @@ use tokio::io::{AsyncReadExt, AsyncSeekExt, AsyncWriteExt};
 #[cfg(unix)]
 use libc;
 
-use super::{BoxedFile, DirEntry, File, FileSystem, FilesystemStats, FsError, Stats};
-use std::sync::Arc;
+use super::host_cache::{parent_of, MetadataCache};
+use super::{BoxedFile, DirEntry, File, FileSystem, FilesystemStats, FsError, Stats, ROOT_INO};
+use std::collections::HashMap;
+use std::sync::{Arc, Mutex};
 
 /// A filesystem backed by a host directory (passthrough)
 #[derive(Clone)]
@@ -31,6 +34,13 @@ pub struct HostFS {
     // looking up ourselves in the fuse layer, but `ls /mntpnt` has to pass the fuse layer and come to us.
     #[cfg(target_family = "unix")]
     fuse_mountpoint_inode: Option<u64>,
+    /// Inode -> virtual path for every entry handed out so far.
+    ///
+    /// Host paths can't be opened by inode, so the inode-addressed operations
+    /// map back to the path the synthetic inode was derived from.
+    inodes: Arc<Mutex<HashMap<i64, String>>>,
+    /// Stat and listing cache, see `with_metadata_cache`
+    cache: Option<Arc<MetadataCache>>,
 }
 
 /// An open file handle for HostFS.
@@ -39,20 +49,40 @@ pub struct HostFSFile {
     full_path: PathBuf,
     /// The virtual path (for generating consistent inode numbers in fstat).
     virtual_path: String,
+    cache: Option<Arc<MetadataCache>>,
+}
+
+impl HostFSFile {
+    fn invalidate(&self) {
+        if let Some(cache) = &self.cache {
+            cache.invalidate(cache_key(&self.virtual_path), false);
+        }
+    }
 }
 
 #[async_trait]
 impl File for HostFSFile {
     async fn pread(&self, offset: u64, size: u64) -> Result<Vec<u8>> {
+        let _timer = metrics::timer(Op::Read, Layer::Base);
         let mut file = fs::File::open(&self.full_path).await?;
         file.seek(std::io::SeekFrom::Start(offset)).await?;
         let mut buf = vec![0u8; size as usize];
-        let n = file.read(&mut buf).await?;
+        // A single read() may return less than asked for (tokio caps each
+        // blocking read), so keep going until the buffer is full or EOF.
+        let mut n = 0;
+        while n < buf.len() {
+            let read = file.read(&mut buf[n..]).await?;
+            if read == 0 {
+                break;
+            }
+            n += read;
+        }
         buf.truncate(n);
         Ok(buf)
     }
 
     async fn pwrite(&self, offset: u64, data: &[u8]) -> Result<()> {
+        let _timer = metrics::timer(Op::Write, Layer::Base);
         let mut file = fs::OpenOptions::new()
             .write(true)
             .create(true)
@@ -63,6 +93,7 @@ impl File for HostFSFile {
         file.seek(std::io::SeekFrom::Start(offset)).await?;
         file.write_all(data).await?;
         file.flush().await?;
+        self.invalidate();
         Ok(())
     }
 
@@ -72,10 +103,17 @@ impl File for HostFSFile {
             .open(&self.full_path)
             .await?;
         file.set_len(size).await?;
+        self.invalidate();
+        Ok(())
+    }
+
+    async fn flush(&self) -> Result<()> {
+        // Writes go straight to the host file
         Ok(())
     }
 
     async fn fsync(&self) -> Result<()> {
+        let _timer = metrics::timer(Op::Fsync, Layer::Base);
         let file = fs::OpenOptions::new()
             .write(true)
             .open(&self.full_path)
@@ -103,9 +141,24 @@ impl HostFS {
         Ok(Self {
             root,
             fuse_mountpoint_inode: None,
+            inodes: Arc::new(Mutex::new(HashMap::new())),
+            cache: None,
         })
     }
 
+    /// Cache stat results and directory listings
+    ///
+    /// Entries stay coherent with changes made on the host by watching every
+    /// directory something was cached from with inotify. Host-side changes
+    /// become visible once the watcher thread has seen their event, changes
+    /// made through this HostFS immediately. Writes through a hard link
+    /// outside the watched directories are not noticed.
+    #[cfg(target_os = "linux")]
+    pub fn with_metadata_cache(mut self) -> Result<Self> {
+        self.cache = Some(MetadataCache::new(&self.root)?);
+        Ok(self)
+    }
+
     /// Create a new HostFS rooted at the given directory with a FUSE mountpoint inode
     #[cfg(target_family = "unix")]
     pub fn with_fuse_mountpoint(mut self, inode: u64) -> Self {
@@ -128,15 +181,99 @@ impl HostFS {
         }
     }
 
+    /// Drop cached metadata for `path` after changing it
+    fn invalidate(&self, path: &str, subtree: bool) {
+        if let Some(cache) = &self.cache {
+            cache.invalidate(cache_key(path), subtree);
+        }
+    }
+
+    /// lstat on the host, bypassing the cache
+    async fn lstat_uncached(&self, path: &str) -> Result<Option<Stats>> {
+        let full_path = self.resolve_path(path);
+        match fs::symlink_metadata(&full_path).await {
+            Ok(metadata) => Ok(Some(Self::metadata_to_stats(&metadata, path))),
+            Err(e) if e.kind() == std::io::ErrorKind::NotFound => Ok(None),
+            Err(e) => Err(e.into()),
+        }
+    }
+
+    /// List a directory on the host, bypassing the cache
+    async fn readdir_plus_uncached(&self, path: &str) -> Result<Option<Vec<DirEntry>>> {
+        let full_path = self.resolve_path(path);
+        let mut entries = Vec::new();
+
+        let mut dir = match fs::read_dir(&full_path).await {
+            Ok(d) => d,
+            Err(e) if e.kind() == std::io::ErrorKind::NotFound => return Ok(None),
+            Err(e) if e.raw_os_error() == Some(libc::ENOTDIR) => return Ok(None),
+            Err(e) => return Err(e.into()),
+        };
+
+        while let Some(entry) = dir.next_entry().await? {
+            #[cfg(target_os = "linux")]
+            {
+                if let Some(inode) = self.fuse_mountpoint_inode {
+                    if entry.ino() == inode {
+                        continue;
+                    }
+                }
+            }
+
+            if let Some(name) = entry.file_name().to_str() {
+                // Build the virtual path for this entry
+                let entry_path = if path == "/" {
+                    format!("/{}", name)
+                } else {
+                    format!("{}/{}", path.trim_end_matches('/'), name)
+                };
+
+                // Get metadata for the entry
+                if let Ok(metadata) = entry.metadata().await {
+                    let stats = Self::metadata_to_stats(&metadata, &entry_path);
+                    entries.push(DirEntry {
+                        name: name.to_string(),
+                        stats,
+                    });
+                }
+            }
+        }
+
+        entries.sort_by(|a, b| a.name.cmp(&b.name));
+        Ok(Some(entries))
+    }
+
+    /// Remember the virtual path an inode number was handed out for
+    fn remember(&self, stats: &Stats, path: &str) {
+        if stats.ino != ROOT_INO {
+            self.inodes
+                .lock()
+                .unwrap()
+                .insert(stats.ino, path.to_string());
+        }
+    }
+
+    /// Map an inode number back to its virtual path
+    fn inode_path(&self, ino: i64) -> Option<String> {
+        if ino == ROOT_INO {
+            return Some("/".to_string());
+        }
+        self.inodes.lock().unwrap().get(&ino).cloned()
+    }
+
     /// Convert std::fs::Metadata to Stats
     fn metadata_to_stats(metadata: &std::fs::Metadata, path: &str) -> Stats {
         use std::collections::hash_map::DefaultHasher;
         use std::hash::{Hash, Hasher};
 
         // Generate synthetic inode from path (host inodes may not be meaningful)
-        let mut hasher = DefaultHasher::new();
-        path.hash(&mut hasher);
-        let ino = (hasher.finish() as i64).abs();
+        let ino = if path.trim_matches('/').is_empty() {
+            ROOT_INO
+        } else {
+            let mut hasher = DefaultHasher::new();
+            path.hash(&mut hasher);
+            (hasher.finish() as i64).abs()
+        };
 
         Stats {
             ino,
@@ -150,11 +287,83 @@ impl HostFS {
             ctime: metadata.ctime(),
         }
     }
+
+    /// lstat through the metadata cache, without timing it
+    async fn lstat_cached(&self, path: &str) -> Result<Option<Stats>> {
+        let stats = match &self.cache {
+            Some(cache) => {
+                let key = cache_key(path);
+                let cached = cache.stats(key);
+                metrics::cache_lookup(Cache::HostMetadata, cached.is_some());
+                match cached {
+                    Some(stats) => stats,
+                    None => {
+                        // Watch before looking, so a change right after the
+                        // lookup still produces an event
+                        let generation = cache.watch(parent_of(key));
+                        let stats = self.lstat_uncached(path).await?;
+                        if let Some(generation) = generation {
+                            cache.insert_stats(key, stats.as_ref(), generation);
+                        }
+                        stats
+                    }
+                }
+            }
+            None => self.lstat_uncached(path).await?,
+        };
+        if let Some(stats) = &stats {
+            self.remember(stats, path);
+        }
+        Ok(stats)
+    }
+
+    /// readdir_plus through the metadata cache, without timing it
+    async fn readdir_plus_cached(&self, path: &str) -> Result<Option<Vec<DirEntry>>> {
+        let entries = match &self.cache {
+            Some(cache) => {
+                let key = cache_key(path);
+                let cached = cache.listing(key);
+                metrics::cache_lookup(Cache::HostMetadata, cached.is_some());
+                match cached {
+                    Some(entries) => Some(entries),
+                    None => {
+                        let generation = cache.watch(key);
+                        let entries = self.readdir_plus_uncached(path).await?;
+                        if let (Some(entries), Some(generation)) = (&entries, generation) {
+                            cache.insert_listing(key, entries, generation);
+                        }
+                        entries
+                    }
+                }
+            }
+            None => self.readdir_plus_uncached(path).await?,
+        };
+        let Some(entries) = entries else {
+            return Ok(None);
+        };
+        for entry in &entries {
+            let entry_path = if path == "/" {
+                format!("/{}", entry.name)
+            } else {
+                format!("{}/{}", path.trim_end_matches('/'), entry.name)
+            };
+            self.remember(&entry.stats, &entry_path);
+        }
+        Ok(Some(entries))
+    }
 }
 
 #[async_trait]
 impl FileSystem for HostFS {
     async fn stat(&self, path: &str) -> Result<Option<Stats>> {
+        let _timer = metrics::timer(Op::Getattr, Layer::Base);
+        if self.cache.is_some() {
+            // Only symlinks differ from their lstat result
+            match self.lstat_cached(path).await? {
+                Some(stats) if stats.is_symlink() => {}
+                stats => return Ok(stats),
+            }
+        }
         let full_path = self.resolve_path(path);
         match fs::metadata(&full_path).await {
             Ok(metadata) => Ok(Some(Self::metadata_to_stats(&metadata, path))),
@@ -164,12 +373,8 @@ impl FileSystem for HostFS {
     }
 
     async fn lstat(&self, path: &str) -> Result<Option<Stats>> {
-        let full_path = self.resolve_path(path);
-        match fs::symlink_metadata(&full_path).await {
-            Ok(metadata) => Ok(Some(Self::metadata_to_stats(&metadata, path))),
-            Err(e) if e.kind() == std::io::ErrorKind::NotFound => Ok(None),
-            Err(e) => Err(e.into()),
-        }
+        let _timer = metrics::timer(Op::Getattr, Layer::Base);
+        self.lstat_cached(path).await
     }
 
     async fn read_file(&self, path: &str) -> Result<Option<Vec<u8>>> {
@@ -184,10 +389,19 @@ impl FileSystem for HostFS {
     async fn write_file(&self, path: &str, data: &[u8]) -> Result<()> {
         let full_path = self.resolve_path(path);
         fs::write(&full_path, data).await?;
+        self.invalidate(path, false);
         Ok(())
     }
 
     async fn readdir(&self, path: &str) -> Result<Option<Vec<String>>> {
+        let _timer = metrics::timer(Op::Readdir, Layer::Base);
+        if let Some(cache) = &self.cache {
+            let cached = cache.listing(cache_key(path));
+            metrics::cache_lookup(Cache::HostMetadata, cached.is_some());
+            if let Some(entries) = cached {
+                return Ok(Some(entries.into_iter().map(|entry| entry.name).collect()));
+            }
+        }
         let full_path = self.resolve_path(path);
         let mut entries = Vec::new();
 
@@ -219,52 +433,14 @@ impl FileSystem for HostFS {
     }
 
     async fn readdir_plus(&self, path: &str) -> Result<Option<Vec<DirEntry>>> {
-        let full_path = self.resolve_path(path);
-        let mut entries = Vec::new();
-
-        let mut dir = match fs::read_dir(&full_path).await {
-            Ok(d) => d,
-            Err(e) if e.kind() == std::io::ErrorKind::NotFound => return Ok(None),
-            Err(e) if e.raw_os_error() == Some(libc::ENOTDIR) => return Ok(None),
-            Err(e) => return Err(e.into()),
-        };
-
-        while let Some(entry) = dir.next_entry().await? {
-            #[cfg(target_os = "linux")]
-            {
-                if let Some(inode) = self.fuse_mountpoint_inode {
-                    if entry.ino() == inode {
-                        continue;
-                    }
-                }
-            }
-
-            if let Some(name) = entry.file_name().to_str() {
-                // Build the virtual path for this entry
-                let entry_path = if path == "/" {
-                    format!("/{}", name)
-                } else {
-                    format!("{}/{}", path.trim_end_matches('/'), name)
-                };
-
-                // Get metadata for the entry
-                if let Ok(metadata) = entry.metadata().await {
-                    let stats = Self::metadata_to_stats(&metadata, &entry_path);
-                    entries.push(DirEntry {
-                        name: name.to_string(),
-                        stats,
-                    });
-                }
-            }
-        }
-
-        entries.sort_by(|a, b| a.name.cmp(&b.name));
-        Ok(Some(entries))
+        let _timer = metrics::timer(Op::Readdir, Layer::Base);
+        self.readdir_plus_cached(path).await
     }
 
     async fn mkdir(&self, path: &str) -> Result<()> {
         let full_path = self.resolve_path(path);
         fs::create_dir(&full_path).await?;
+        self.invalidate(path, false);
         Ok(())
     }
 
@@ -277,6 +453,7 @@ impl FileSystem for HostFS {
         } else {
             fs::remove_file(&full_path).await?;
         }
+        self.invalidate(path, true);
         Ok(())
     }
 
@@ -286,6 +463,7 @@ impl FileSystem for HostFS {
         let full_path = self.resolve_path(path);
         let permissions = std::fs::Permissions::from_mode(mode);
         fs::set_permissions(&full_path, permissions).await?;
+        self.invalidate(path, false);
         Ok(())
     }
 
@@ -293,12 +471,15 @@ impl FileSystem for HostFS {
         let from_path = self.resolve_path(from);
         let to_path = self.resolve_path(to);
         fs::rename(&from_path, &to_path).await?;
+        self.invalidate(from, true);
+        self.invalidate(to, true);
         Ok(())
     }
 
     async fn symlink(&self, target: &str, linkpath: &str) -> Result<()> {
         let full_path = self.resolve_path(linkpath);
         tokio::fs::symlink(target, &full_path).await?;
+        self.invalidate(linkpath, false);
         Ok(())
     }
 
@@ -306,6 +487,9 @@ impl FileSystem for HostFS {
         let old_full_path = self.resolve_path(oldpath);
         let new_full_path = self.resolve_path(newpath);
         tokio::fs::hard_link(&old_full_path, &new_full_path).await?;
+        // The link count of the existing entry changed too
+        self.invalidate(oldpath, false);
+        self.invalidate(newpath, false);
         Ok(())
     }
 
@@ -357,6 +541,7 @@ impl FileSystem for HostFS {
         Ok(Arc::new(HostFSFile {
             full_path,
             virtual_path: path.to_string(),
+            cache: self.cache.clone(),
         }))
     }
 
@@ -368,6 +553,52 @@ impl FileSystem for HostFS {
         let file = self.open(path).await?;
         Ok((stats, file))
     }
+
+    async fn lookup(&self, parent_ino: i64, name: &str) -> Result<Option<Stats>> {
+        let _timer = metrics::timer(Op::Lookup, Layer::Base);
+        let Some(parent) = self.inode_path(parent_ino) else {
+            return Ok(None);
+        };
+        let path = if parent == "/" {
+            format!("/{}", name)
+        } else {
+            format!("{}/{}", parent, name)
+        };
+        self.lstat_cached(&path).await
+    }
+
+    async fn getattr(&self, ino: i64) -> Result<Option<Stats>> {
+        let _timer = metrics::timer(Op::Getattr, Layer::Base);
+        match self.inode_path(ino) {
+            Some(path) => self.lstat_cached(&path).await,
+            None => Ok(None),
+        }
+    }
+
+    async fn open_inode(&self, ino: i64) -> Result<BoxedFile> {
+        let path = self.inode_path(ino).ok_or(FsError::NotFound)?;
+        self.open(&path).await
+    }
+
+    async fn readdir_inode(&self, ino: i64) -> Result<Option<Vec<DirEntry>>> {
+        let _timer = metrics::timer(Op::Readdir, Layer::Base);
+        match self.inode_path(ino) {
+            Some(path) => self.readdir_plus_cached(&path).await,
+            None => Ok(None),
+        }
+    }
+
+    fn forget(&self, ino: i64) {
+        self.inodes.lock().unwrap().remove(&ino);
+    }
+}
+
+/// Cache key for a virtual path: no trailing slash except for the root
+fn cache_key(path: &str) -> &str {
+    match path.trim_end_matches('/') {
+        "" => "/",
+        trimmed => trimmed,
+    }
 }
 
 #[cfg(test)]
@@ -485,4 +716,81 @@ mod tests {
 
         Ok(())
     }
+
+    /// Poll until `cond` holds, for changes the inotify thread applies
+    #[cfg(target_os = "linux")]
+    async fn eventually<F, Fut>(mut cond: F) -> Result<bool>
+    where
+        F: FnMut() -> Fut,
+        Fut: std::future::Future<Output = Result<bool>>,
+    {
+        for _ in 0..500 {
+            if cond().await? {
+                return Ok(true);
+            }
+            tokio::time::sleep(std::time::Duration::from_millis(10)).await;
+        }
+        Ok(false)
+    }
+
+    #[cfg(target_os = "linux")]
+    #[tokio::test]
+    async fn test_hostfs_metadata_cache_sees_own_changes() -> Result<()> {
+        let dir = tempdir()?;
+        let fs = HostFS::new(dir.path())?.with_metadata_cache()?;
+
+        fs.mkdir("/subdir").await?;
+        assert_eq!(fs.readdir("/subdir").await?.unwrap(), Vec::<String>::new());
+        assert!(fs.lstat("/subdir/a.txt").await?.is_none());
+
+        // Changes made through the HostFS are visible right away
+        fs.write_file("/subdir/a.txt", b"a").await?;
+        assert_eq!(fs.lstat("/subdir/a.txt").await?.unwrap().size, 1);
+        let entries = fs.readdir_plus("/subdir").await?.unwrap();
+        assert_eq!(entries.len(), 1);
+        assert_eq!(entries[0].name, "a.txt");
+
+        let file = fs.open("/subdir/a.txt").await?;
+        file.pwrite(1, b"bc").await?;
+        assert_eq!(fs.stat("/subdir/a.txt").await?.unwrap().size, 3);
+
+        fs.rename("/subdir", "/moved").await?;
+        assert!(fs.lstat("/subdir/a.txt").await?.is_none());
+        assert!(fs.readdir("/subdir").await?.is_none());
+        assert_eq!(fs.lstat("/moved/a.txt").await?.unwrap().size, 3);
+
+        Ok(())
+    }
+
+    #[cfg(target_os = "linux")]
+    #[tokio::test]
+    async fn test_hostfs_metadata_cache_sees_host_changes() -> Result<()> {
+        let dir = tempdir()?;
+        let fs = HostFS::new(dir.path())?.with_metadata_cache()?;
+        std::fs::create_dir(dir.path().join("subdir"))?;
+        std::fs::write(dir.path().join("subdir/a.txt"), b"a")?;
+
+        assert_eq!(fs.readdir("/subdir").await?.unwrap(), vec!["a.txt"]);
+        assert!(fs.lstat("/subdir/b.txt").await?.is_none());
+        assert_eq!(fs.stat("/subdir/a.txt").await?.unwrap().size, 1);
+
+        // Served from the cache until the watcher reports the changes
+        std::fs::write(dir.path().join("subdir/a.txt"), b"abc")?;
+        std::fs::write(dir.path().join("subdir/b.txt"), b"b")?;
+        assert!(
+            eventually(|| async { Ok(fs.stat("/subdir/a.txt").await?.unwrap().size == 3) }).await?
+        );
+        assert!(eventually(|| async { Ok(fs.lstat("/subdir/b.txt").await?.is_some()) }).await?);
+        assert!(
+            eventually(|| async { Ok(fs.readdir("/subdir").await?.unwrap().len() == 2) }).await?
+        );
+
+        std::fs::remove_file(dir.path().join("subdir/a.txt"))?;
+        std::fs::remove_file(dir.path().join("subdir/b.txt"))?;
+        std::fs::remove_dir(dir.path().join("subdir"))?;
+        assert!(eventually(|| async { Ok(fs.readdir("/subdir").await?.is_none()) }).await?);
+        assert!(eventually(|| async { Ok(fs.lstat("/subdir/a.txt").await?.is_none()) }).await?);
+
+        Ok(())
+    }
 }
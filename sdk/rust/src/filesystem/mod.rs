@@ -1,4 +1,9 @@
 pub mod agentfs;
+pub(crate) mod cache;
+mod chunks;
+mod group_commit;
+#[cfg(unix)]
+mod host_cache;
 #[cfg(unix)]
 pub mod hostfs;
 pub mod overlayfs;
@@ -9,7 +14,8 @@ use std::sync::Arc;
 use thiserror::Error;
 
 // Re-export implementations
-pub use agentfs::AgentFS;
+pub use agentfs::{AgentFS, DEFAULT_WRITE_BUFFER_BYTES};
+pub use chunks::Compression;
 #[cfg(unix)]
 pub use hostfs::HostFS;
 pub use overlayfs::OverlayFS;
@@ -46,6 +52,9 @@ pub enum FsError {
 
     #[error("Cannot rename directory into its own subdirectory")]
     InvalidRename,
+
+    #[error("Read-only filesystem")]
+    ReadOnly,
 }
 
 impl FsError {
@@ -62,10 +71,14 @@ impl FsError {
             FsError::RootOperation => libc::EPERM,
             FsError::SymlinkLoop => libc::ELOOP,
             FsError::InvalidRename => libc::EINVAL,
+            FsError::ReadOnly => libc::EROFS,
         }
     }
 }
 
+/// Inode number of the root directory in every filesystem layer
+pub const ROOT_INO: i64 = 1;
+
 // File types for mode field
 pub const S_IFMT: u32 = 0o170000; // File type mask
 pub const S_IFREG: u32 = 0o100000; // Regular file
@@ -138,6 +151,12 @@ pub trait File: Send + Sync {
     /// Truncate the file to the specified size.
     async fn truncate(&self, size: u64) -> Result<()>;
 
+    /// Write back any data this handle buffers in memory.
+    ///
+    /// Called when a file is closed; buffered data may otherwise only reach
+    /// storage once the buffer fills up.
+    async fn flush(&self) -> Result<()>;
+
     /// Synchronize file data to persistent storage.
     async fn fsync(&self) -> Result<()>;
 
@@ -148,6 +167,48 @@ pub trait File: Send + Sync {
 /// A boxed File trait object for dynamic dispatch.
 pub type BoxedFile = Arc<dyn File>;
 
+/// Number of entries a directory stream fetches per batch by default.
+pub const DIR_STREAM_BATCH: usize = 1024;
+
+/// A cursor over the entries of one directory, in name order.
+///
+/// Each batch resumes after the last entry returned, so listing a large
+/// directory in many small calls costs a single pass over it. Entries
+/// created or removed while the stream is open may or may not be seen,
+/// as with POSIX `readdir`.
+#[async_trait]
+pub trait DirStream: Send {
+    /// Return up to `limit` further entries; an empty batch marks the end.
+    async fn next_batch(&mut self, limit: usize) -> Result<Vec<DirEntry>>;
+}
+
+/// A boxed DirStream trait object for dynamic dispatch.
+pub type BoxedDirStream = Box<dyn DirStream>;
+
+/// Directory stream over entries that were listed up front.
+///
+/// Used by filesystems without a cheaper way to resume a listing.
+pub struct VecDirStream {
+    entries: std::vec::IntoIter<DirEntry>,
+}
+
+impl VecDirStream {
+    /// Create a stream over `entries`, sorting them by name.
+    pub fn new(mut entries: Vec<DirEntry>) -> Self {
+        entries.sort_by(|a, b| a.name.cmp(&b.name));
+        Self {
+            entries: entries.into_iter(),
+        }
+    }
+}
+
+#[async_trait]
+impl DirStream for VecDirStream {
+    async fn next_batch(&mut self, limit: usize) -> Result<Vec<DirEntry>> {
+        Ok(self.entries.by_ref().take(limit).collect())
+    }
+}
+
 /// A trait defining filesystem operations.
 #[async_trait]
 pub trait FileSystem: Send + Sync {
@@ -223,4 +284,63 @@ pub trait FileSystem: Send + Sync {
     /// This is optimized for FUSE create() which needs both atomically.
     /// Fails with AlreadyExists if the file exists.
     async fn create_file(&self, path: &str, mode: u32) -> Result<(Stats, BoxedFile)>;
+
+    // Inode-addressed operations.
+    //
+    // These take the `ino` values reported in `Stats` instead of paths, so
+    // callers that already track inodes (FUSE, NFS) don't have to rebuild a
+    // path and walk it again. The root directory is always `ROOT_INO`.
+    // An inode becomes addressable once it has been returned by one of these
+    // methods or by `lstat`/`create_file`, and stays addressable until it
+    // is passed to `forget`.
+
+    /// Look up `name` in the directory `parent_ino`, without following symlinks
+    ///
+    /// Returns `Ok(None)` if the entry does not exist.
+    async fn lookup(&self, parent_ino: i64, name: &str) -> Result<Option<Stats>>;
+
+    /// Get file statistics for an inode, without following symlinks
+    ///
+    /// Returns `Ok(None)` if the inode does not exist.
+    async fn getattr(&self, ino: i64) -> Result<Option<Stats>>;
+
+    /// Open a file by inode
+    async fn open_inode(&self, ino: i64) -> Result<BoxedFile>;
+
+    /// List a directory by inode, with full statistics for each entry
+    ///
+    /// Returns `Ok(None)` if the directory does not exist.
+    async fn readdir_inode(&self, ino: i64) -> Result<Option<Vec<DirEntry>>>;
+
+    /// Tell the filesystem the caller no longer addresses `ino`
+    ///
+    /// Filesystems that keep state to serve an inode (such as the path it
+    /// was found at) may drop it. The default keeps nothing to drop.
+    fn forget(&self, _ino: i64) {}
+
+    // Directory streams.
+    //
+    // The default implementations list the directory once with
+    // `readdir_plus`/`readdir_inode` and hand out that listing batch by
+    // batch.
+
+    /// Open a stream over the entries of a directory, sorted by name
+    ///
+    /// Returns `Ok(None)` if the directory does not exist.
+    async fn opendir(&self, path: &str) -> Result<Option<BoxedDirStream>> {
+        Ok(self
+            .readdir_plus(path)
+            .await?
+            .map(|entries| Box::new(VecDirStream::new(entries)) as BoxedDirStream))
+    }
+
+    /// Open a stream over the entries of a directory inode, sorted by name
+    ///
+    /// Returns `Ok(None)` if the directory does not exist.
+    async fn opendir_inode(&self, ino: i64) -> Result<Option<BoxedDirStream>> {
+        Ok(self
+            .readdir_inode(ino)
+            .await?
+            .map(|entries| Box::new(VecDirStream::new(entries)) as BoxedDirStream))
+    }
 }
@@ -1,14 +1,18 @@
 use crate::error::Result;
+use crate::metrics::{self, Cache};
 use async_trait::async_trait;
 use std::{
-    collections::{BTreeSet, HashMap, HashSet},
+    cmp::Ordering,
+    collections::{BTreeMap, BTreeSet, HashMap, HashSet, VecDeque},
+    ops::Range,
     sync::{Arc, RwLock},
-    time::{SystemTime, UNIX_EPOCH},
+    time::{Duration, Instant, SystemTime, UNIX_EPOCH},
 };
 use turso::{Connection, Value};
 
 use super::{
-    agentfs::AgentFS, BoxedFile, DirEntry, File, FileSystem, FilesystemStats, FsError, Stats,
+    agentfs::AgentFS, BoxedDirStream, BoxedFile, DirEntry, DirStream, File, FileSystem,
+    FilesystemStats, FsError, Stats, DIR_STREAM_BATCH, ROOT_INO,
 };
 
 /// A path-component trie for efficient whiteout lookups.
@@ -16,18 +20,64 @@ use super::{
 /// This replaces N database queries per is_whiteout() call with a single
 /// in-memory trie traversal. The trie is keyed by path components (split by '/'),
 /// making ancestor lookups O(depth) with early termination.
+///
+/// The overlay fills the trie lazily, one directory at a time, so opening a
+/// delta with a long deletion history doesn't read every whiteout up front.
+/// `loaded` says the whiteouts directly below a node are known, `complete`
+/// that the whole subtree is.
 #[derive(Default, Debug)]
 struct WhiteoutNode {
     /// Child nodes keyed by path component
     children: HashMap<String, WhiteoutNode>,
     /// True if this exact path is a whiteout
     is_whiteout: bool,
+    /// The whiteouts among this node's children are all in the trie
+    loaded: bool,
+    /// The whiteouts anywhere below this node are all in the trie
+    complete: bool,
+}
+
+impl WhiteoutNode {
+    /// A node whose subtree is fully known (and empty)
+    fn complete() -> Self {
+        Self {
+            loaded: true,
+            complete: true,
+            ..Default::default()
+        }
+    }
+
+    /// A node created below `self` by an insert
+    fn child_of(&self) -> Self {
+        if self.complete {
+            Self::complete()
+        } else {
+            Self::default()
+        }
+    }
+}
+
+/// Result of a lookup in a lazily loaded whiteout trie
+#[derive(Debug, PartialEq, Eq)]
+enum WhiteoutLookup<T> {
+    /// The answer, from whiteouts already in the trie
+    Known(T),
+    /// The whiteouts below this directory must be loaded first
+    Load(String),
 }
 
 /// Thread-safe whiteout cache wrapping the trie
-#[derive(Default, Debug)]
+#[derive(Debug)]
 pub struct WhiteoutCache {
     root: RwLock<WhiteoutNode>,
+    /// Whether directories are loaded on demand, see `WhiteoutCache::lazy`
+    lazy: bool,
+}
+
+impl Default for WhiteoutCache {
+    fn default() -> Self {
+        Self::new()
+    }
 }
 
 /// Cache for directories known to exist in the delta layer.
@@ -91,29 +141,314 @@ impl DeltaDirCache {
     }
 }
 
+/// Number of paths remembered as missing from both layers.
+const NEGATIVE_ENTRY_MAX: usize = 10000;
+
+/// How long a path stays remembered as missing. Our own mutations invalidate
+/// it right away, but the base layer may gain files behind our back, so
+/// kernel caches of failed lookups in front of an overlay should not
+/// outlive it either.
+pub const NEGATIVE_ENTRY_TTL: Duration = Duration::from_secs(1);
+
+/// Which layer(s) an overlay entry was found in when it was last resolved.
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum Backing {
+    /// Not resolved since the last change to this path
+    Unknown,
+    /// Only in the base layer
+    Base,
+    /// Only in the delta layer, with the given delta inode
+    Delta(i64),
+    /// In both layers; contents and metadata come from the given delta inode
+    Both(i64),
+}
+
+/// An entry in the overlay inode table.
+#[derive(Debug, Clone)]
+struct InodeEntry {
+    path: String,
+    backing: Backing,
+}
+
+#[derive(Debug)]
+struct InodeTableInner {
+    /// Overlay inode -> entry
+    entries: HashMap<i64, InodeEntry>,
+    /// Path -> overlay inode. Sorted so a subtree can be invalidated with a
+    /// range scan, like `DeltaDirCache`.
+    paths: BTreeMap<String, i64>,
+    /// Paths found in neither layer -> when. Sorted like `paths`.
+    missing: BTreeMap<String, Instant>,
+    /// Insertion order of `missing`, oldest first, for eviction
+    missing_order: VecDeque<String>,
+    /// Bumped on every invalidation
+    generation: u64,
+}
+
+/// Maps overlay inode numbers back to paths and to the layer backing them.
+///
+/// Serves the inode-addressed `FileSystem` operations. Once an entry has been
+/// resolved, `getattr` goes straight to its delta inode (or to the base
+/// layer) instead of walking both layers component by component, and
+/// `lookup` only queries the layers the parent directory exists in.
+///
+/// Mutations invalidate the paths they touch. A resolution that raced with
+/// an invalidation is recorded as `Backing::Unknown`, so stale layer
+/// information is never cached.
+///
+/// Paths that exist in neither layer are remembered for
+/// `NEGATIVE_ENTRY_TTL`, so repeated failing lookups skip both layers.
+#[derive(Debug)]
+struct InodeTable {
+    inner: RwLock<InodeTableInner>,
+}
+
+impl InodeTable {
+    fn new() -> Self {
+        let mut entries = HashMap::new();
+        let mut paths = BTreeMap::new();
+        entries.insert(
+            ROOT_INO,
+            InodeEntry {
+                path: "/".to_string(),
+                backing: Backing::Unknown,
+            },
+        );
+        paths.insert("/".to_string(), ROOT_INO);
+        Self {
+            inner: RwLock::new(InodeTableInner {
+                entries,
+                paths,
+                missing: BTreeMap::new(),
+                missing_order: VecDeque::new(),
+                generation: 0,
+            }),
+        }
+    }
+
+    /// Current generation; pass it to `record` after resolving an entry
+    fn generation(&self) -> u64 {
+        self.inner.read().unwrap().generation
+    }
+
+    fn get(&self, ino: i64) -> Option<InodeEntry> {
+        self.inner.read().unwrap().entries.get(&ino).cloned()
+    }
+
+    /// Remember where `path` was found, as of `generation`
+    fn record(&self, ino: i64, path: &str, backing: Backing, generation: u64) {
+        let mut inner = self.inner.write().unwrap();
+        let backing = if inner.generation == generation {
+            backing
+        } else {
+            Backing::Unknown
+        };
+        if let Some(entry) = inner.entries.get_mut(&ino) {
+            entry.backing = backing;
+            if entry.path == path {
+                return;
+            }
+            let old_path = std::mem::replace(&mut entry.path, path.to_string());
+            if inner.paths.get(&old_path) == Some(&ino) {
+                inner.paths.remove(&old_path);
+            }
+        } else {
+            inner.entries.insert(
+                ino,
+                InodeEntry {
+                    path: path.to_string(),
+                    backing,
+                },
+            );
+        }
+        inner.paths.insert(path.to_string(), ino);
+    }
+
+    /// Whether `path` was recently found in neither layer
+    fn is_missing(&self, path: &str) -> bool {
+        self.inner
+            .read()
+            .unwrap()
+            .missing
+            .get(path)
+            .is_some_and(|found| found.elapsed() < NEGATIVE_ENTRY_TTL)
+    }
+
+    /// Remember that `path` is in neither layer, as of `generation`
+    fn record_missing(&self, path: &str, generation: u64) {
+        let mut inner = self.inner.write().unwrap();
+        if inner.generation != generation {
+            return;
+        }
+        if inner
+            .missing
+            .insert(path.to_string(), Instant::now())
+            .is_none()
+        {
+            inner.missing_order.push_back(path.to_string());
+        }
+        while inner.missing_order.len() > NEGATIVE_ENTRY_MAX {
+            if let Some(oldest) = inner.missing_order.pop_front() {
+                inner.missing.remove(&oldest);
+            }
+        }
+    }
+
+    /// Forget the resolved layers of `path` and everything below it
+    fn invalidate(&self, path: &str) {
+        let mut inner = self.inner.write().unwrap();
+        inner.generation += 1;
+
+        let inos: Vec<i64> = subtree(&inner.paths, path)
+            .iter()
+            .map(|p| inner.paths[p])
+            .collect();
+        for ino in inos {
+            if let Some(entry) = inner.entries.get_mut(&ino) {
+                entry.backing = Backing::Unknown;
+            }
+        }
+
+        // Their order entries stay queued and are dropped on eviction
+        for p in subtree(&inner.missing, path) {
+            inner.missing.remove(&p);
+        }
+    }
+
+    /// Move the entries of `from` and everything below it to `to`, like
+    /// `FuseState::rename_subtree`, dropping the entries `to` replaced
+    fn rename(&self, from: &str, to: &str) {
+        let mut inner = self.inner.write().unwrap();
+        inner.generation += 1;
+
+        let moved: Vec<(String, i64)> = subtree(&inner.paths, from)
+            .into_iter()
+            .filter_map(|p| inner.paths.remove_entry(&p))
+            .collect();
+        for p in subtree(&inner.paths, to) {
+            if let Some(ino) = inner.paths.remove(&p) {
+                inner.entries.remove(&ino);
+            }
+        }
+        for (path, ino) in moved {
+            let path = format!("{}{}", to, &path[from.len()..]);
+            if let Some(entry) = inner.entries.get_mut(&ino) {
+                entry.path = path.clone();
+                entry.backing = Backing::Unknown;
+            }
+            inner.paths.insert(path, ino);
+        }
+    }
+
+    /// Drop the entry of an inode that is no longer addressed, returning it
+    fn forget(&self, ino: i64) -> Option<InodeEntry> {
+        if ino == ROOT_INO {
+            return None;
+        }
+        let mut inner = self.inner.write().unwrap();
+        let entry = inner.entries.remove(&ino)?;
+        if inner.paths.get(&entry.path) == Some(&ino) {
+            inner.paths.remove(&entry.path);
+        }
+        Some(entry)
+    }
+
+    /// Invalidate `paths` when the returned guard is dropped.
+    ///
+    /// Held for the duration of a mutation so the paths are invalidated on
+    /// every exit, including errors after a partial change.
+    fn invalidate_on_drop(&self, paths: &[&str]) -> InvalidateGuard<'_> {
+        InvalidateGuard {
+            table: self,
+            paths: paths.iter().map(|p| p.to_string()).collect(),
+        }
+    }
+}
+
+/// Keys of `map` at or below `path`
+fn subtree<V>(map: &BTreeMap<String, V>, path: &str) -> Vec<String> {
+    let prefix = if path == "/" {
+        "/".to_string()
+    } else {
+        format!("{}/", path)
+    };
+    // Siblings such as "/src.bak" sort between "/src" and "/src/...", so the
+    // path itself is looked up apart from the range of its descendants
+    let descendants = map
+        .range(prefix.clone()..)
+        .map(|(p, _)| p)
+        .take_while(|p| p.starts_with(&prefix))
+        .filter(|p| p.as_str() != path);
+    map.get_key_value(path)
+        .map(|(p, _)| p)
+        .into_iter()
+        .chain(descendants)
+        .cloned()
+        .collect()
+}
+
+struct InvalidateGuard<'a> {
+    table: &'a InodeTable,
+    paths: Vec<String>,
+}
+
+impl Drop for InvalidateGuard<'_> {
+    fn drop(&mut self) {
+        for path in &self.paths {
+            self.table.invalidate(path);
+        }
+    }
+}
+
 impl WhiteoutCache {
-    /// Create an empty whiteout cache
+    /// Create an empty whiteout cache that holds every whiteout there is
     pub fn new() -> Self {
+        Self {
+            root: RwLock::new(WhiteoutNode::complete()),
+            lazy: false,
+        }
+    }
+
+    /// Create a cache whose directories must be loaded before use
+    fn lazy() -> Self {
         Self {
             root: RwLock::new(WhiteoutNode::default()),
+            lazy: true,
         }
     }
 
     /// Check if path or any ancestor is a whiteout - O(depth) with early exit
+    ///
+    /// Only whiteouts already in the cache are considered.
     pub fn has_whiteout_ancestor(&self, path: &str) -> bool {
+        matches!(self.lookup_ancestor(path), WhiteoutLookup::Known(true))
+    }
+
+    /// Check if path or any ancestor is a whiteout, or find the directory
+    /// that needs loading to tell
+    fn lookup_ancestor(&self, path: &str) -> WhiteoutLookup<bool> {
         let root = self.root.read().unwrap();
         let mut node = &*root;
+        let mut current = String::new();
+        let mut components = path.split('/').filter(|s| !s.is_empty()).peekable();
 
-        for component in path.split('/').filter(|s| !s.is_empty()) {
-            if node.is_whiteout {
-                return true; // Ancestor is whiteout, early exit
+        while let Some(component) = components.next() {
+            if !node.loaded {
+                return WhiteoutLookup::Load(dir_or_root(current));
             }
+            current.push('/');
+            current.push_str(component);
             match node.children.get(component) {
+                Some(child) if child.is_whiteout => return WhiteoutLookup::Known(true), // Early exit
                 Some(child) => node = child,
-                None => return false, // Path not in trie, no whiteout
+                // Path not in trie: no whiteout, unless deeper ones aren't loaded
+                None if node.complete || components.peek().is_none() => {
+                    return WhiteoutLookup::Known(false);
+                }
+                None => return WhiteoutLookup::Load(current),
             }
         }
-        node.is_whiteout // Check the final node itself
+        WhiteoutLookup::Known(false)
     }
 
     /// Check if this exact path is a whiteout (not ancestors) - O(depth)
@@ -121,16 +456,43 @@ impl WhiteoutCache {
     /// Unlike `has_whiteout_ancestor`, this only returns true if the exact
     /// path is marked as a whiteout, not if any ancestor is.
     pub fn has_exact_whiteout(&self, path: &str) -> bool {
+        matches!(self.lookup_exact(path), WhiteoutLookup::Known(true))
+    }
+
+    fn lookup_exact(&self, path: &str) -> WhiteoutLookup<bool> {
+        let parent = OverlayFS::parent_path(path);
+        let Some(name) = path.rsplit('/').find(|s| !s.is_empty()) else {
+            return WhiteoutLookup::Known(false); // The root
+        };
+        self.with_dir(&parent, |node| {
+            node.is_some_and(|node| node.children.get(name).is_some_and(|c| c.is_whiteout))
+        })
+    }
+
+    /// Run `f` on the loaded node of `dir`, or `None` if no whiteouts lie
+    /// below it
+    fn with_dir<T>(
+        &self,
+        dir: &str,
+        f: impl FnOnce(Option<&WhiteoutNode>) -> T,
+    ) -> WhiteoutLookup<T> {
         let root = self.root.read().unwrap();
         let mut node = &*root;
+        let mut current = String::new();
 
-        for component in path.split('/').filter(|s| !s.is_empty()) {
+        for component in dir.split('/').filter(|s| !s.is_empty()) {
+            current.push('/');
+            current.push_str(component);
             match node.children.get(component) {
                 Some(child) => node = child,
-                None => return false, // Path not in trie
+                None if node.complete => return WhiteoutLookup::Known(f(None)),
+                None => return WhiteoutLookup::Load(current),
             }
         }
-        node.is_whiteout
+        if !node.loaded {
+            return WhiteoutLookup::Load(dir_or_root(current));
+        }
+        WhiteoutLookup::Known(f(Some(node)))
     }
 
     /// Insert a whiteout path into the cache
@@ -139,11 +501,49 @@ impl WhiteoutCache {
         let mut node = &mut *root;
 
         for component in path.split('/').filter(|s| !s.is_empty()) {
-            node = node.children.entry(component.to_string()).or_default();
+            let child = node.child_of();
+            node = node.children.entry(component.to_string()).or_insert(child);
         }
         node.is_whiteout = true;
     }
 
+    /// Record the whiteouts loaded for `dir`: the names of its whited-out
+    /// children, and whether there are none further down
+    ///
+    /// Does nothing if `dir` got loaded meanwhile, since whiteouts removed
+    /// since then would come back.
+    fn load(&self, dir: &str, names: Vec<String>, complete: bool) {
+        let mut root = self.root.write().unwrap();
+        let mut node = &mut *root;
+
+        for component in dir.split('/').filter(|s| !s.is_empty()) {
+            let child = node.child_of();
+            node = node.children.entry(component.to_string()).or_insert(child);
+        }
+        if node.loaded {
+            return;
+        }
+        for name in names {
+            let child = if complete {
+                WhiteoutNode::complete()
+            } else {
+                WhiteoutNode::default()
+            };
+            node.children.entry(name).or_insert(child).is_whiteout = true;
+        }
+        if complete {
+            // Nodes inserted before the load have nothing below them either
+            let mut pending: Vec<&mut WhiteoutNode> = node.children.values_mut().collect();
+            while let Some(child) = pending.pop() {
+                child.loaded = true;
+                child.complete = true;
+                pending.extend(child.children.values_mut());
+            }
+        }
+        node.loaded = true;
+        node.complete = complete;
+    }
+
     /// Remove a whiteout path from the cache
     ///
     /// Note: This only unmarks the exact path, not ancestors or children.
@@ -165,30 +565,43 @@ impl WhiteoutCache {
     ///
     /// This is used by readdir to filter out deleted entries.
     pub fn get_child_whiteouts(&self, dir_path: &str) -> HashSet<String> {
-        let root = self.root.read().unwrap();
-        let mut node = &*root;
-
-        // Navigate to the directory node
-        for component in dir_path.split('/').filter(|s| !s.is_empty()) {
-            match node.children.get(component) {
-                Some(child) => node = child,
-                None => return HashSet::new(), // Directory not in trie
-            }
+        match self.lookup_children(dir_path) {
+            WhiteoutLookup::Known(names) => names,
+            WhiteoutLookup::Load(_) => HashSet::new(),
         }
+    }
 
-        // Collect children that are whiteouts
-        node.children
-            .iter()
-            .filter(|(_, child)| child.is_whiteout)
-            .map(|(name, _)| name.clone())
-            .collect()
+    fn lookup_children(&self, dir_path: &str) -> WhiteoutLookup<HashSet<String>> {
+        self.with_dir(dir_path, |node| {
+            // Collect children that are whiteouts
+            node.map(|node| {
+                node.children
+                    .iter()
+                    .filter(|(_, child)| child.is_whiteout)
+                    .map(|(name, _)| name.clone())
+                    .collect()
+            })
+            .unwrap_or_default()
+        })
     }
 
     /// Clear all entries from the cache
     pub fn clear(&self) {
         let mut root = self.root.write().unwrap();
-        root.children.clear();
-        root.is_whiteout = false;
+        *root = if self.lazy {
+            WhiteoutNode::default()
+        } else {
+            WhiteoutNode::complete()
+        };
+    }
+}
+
+/// `path` built from components, with the root as "/" instead of ""
+fn dir_or_root(path: String) -> String {
+    if path.is_empty() {
+        "/".to_string()
+    } else {
+        path
     }
 }
 
@@ -259,6 +672,156 @@ pub struct OverlayFS {
     whiteout_cache: WhiteoutCache,
     /// Cache of directories known to exist in delta (avoids repeated stat() calls)
     delta_dir_cache: DeltaDirCache,
+    /// Overlay inode -> path and backing layer, for the inode-addressed operations
+    inodes: Arc<InodeTable>,
+}
+
+/// Get the origin (base) inode for a delta inode, if it was copied up.
+async fn origin_inode(delta: &AgentFS, delta_ino: i64) -> Result<Option<i64>> {
+    let conn = delta.get_connection();
+    let result = conn
+        .prepare_cached("SELECT base_ino FROM fs_origin WHERE delta_ino = ?")
+        .await;
+
+    // Handle case where fs_origin table doesn't exist yet (for existing databases)
+    let mut stmt = match result {
+        Ok(stmt) => stmt,
+        Err(_) => return Ok(None),
+    };
+
+    let mut rows = stmt.query((delta_ino,)).await?;
+
+    if let Some(row) = rows.next().await? {
+        let base_ino = row.get_value(0).ok().and_then(|v| v.as_integer().copied());
+        Ok(base_ino)
+    } else {
+        Ok(None)
+    }
+}
+
+/// One layer's side of an `OverlayDirStream`.
+struct LayerStream {
+    stream: BoxedDirStream,
+    /// Entries fetched from the layer but not merged yet
+    pending: VecDeque<DirEntry>,
+    done: bool,
+}
+
+impl LayerStream {
+    fn new(stream: BoxedDirStream) -> Self {
+        Self {
+            stream,
+            pending: VecDeque::new(),
+            done: false,
+        }
+    }
+
+    /// Make sure the next entry is buffered, unless the layer is exhausted
+    async fn fill(&mut self, batch: usize) -> Result<()> {
+        if self.pending.is_empty() && !self.done {
+            let entries = self.stream.next_batch(batch).await?;
+            if entries.is_empty() {
+                self.done = true;
+            }
+            self.pending.extend(entries);
+        }
+        Ok(())
+    }
+
+    fn head(&self) -> Option<&DirEntry> {
+        self.pending.front()
+    }
+}
+
+/// Directory stream for OverlayFS.
+///
+/// Merges the name-ordered streams of both layers batch by batch instead of
+/// listing either layer in full. Delta entries shadow base entries with the
+/// same name, whited-out base entries are skipped, and entries that also
+/// exist in base (or were copied up from it) report the base inode, like
+/// `stat()` does.
+struct OverlayDirStream {
+    base: Option<LayerStream>,
+    delta: Option<LayerStream>,
+    /// Delta layer, for origin inode lookups
+    delta_fs: AgentFS,
+    inodes: Arc<InodeTable>,
+    /// Normalized path of the directory being listed
+    dir: String,
+    /// Whited-out names in this directory, as of opening the stream
+    whiteouts: HashSet<String>,
+}
+
+#[async_trait]
+impl DirStream for OverlayDirStream {
+    async fn next_batch(&mut self, limit: usize) -> Result<Vec<DirEntry>> {
+        let generation = self.inodes.generation();
+        let batch = limit.clamp(1, DIR_STREAM_BATCH);
+        let mut result = Vec::new();
+
+        while result.len() < limit {
+            if let Some(base) = &mut self.base {
+                base.fill(batch).await?;
+            }
+            if let Some(delta) = &mut self.delta {
+                delta.fill(batch).await?;
+            }
+
+            let base_head = self.base.as_ref().and_then(LayerStream::head);
+            let delta_head = self.delta.as_ref().and_then(LayerStream::head);
+            let order = match (base_head, delta_head) {
+                (None, None) => break,
+                (Some(_), None) => Ordering::Less,
+                (None, Some(_)) => Ordering::Greater,
+                (Some(base), Some(delta)) => base.name.cmp(&delta.name),
+            };
+
+            // A whited-out base entry hides nothing and is never listed
+            let base_entry = match order {
+                Ordering::Less | Ordering::Equal => {
+                    let entry = self.base.as_mut().unwrap().pending.pop_front().unwrap();
+                    (!self.whiteouts.contains(&entry.name)).then_some(entry)
+                }
+                Ordering::Greater => None,
+            };
+            let delta_entry = match order {
+                Ordering::Greater | Ordering::Equal => {
+                    self.delta.as_mut().unwrap().pending.pop_front()
+                }
+                Ordering::Less => None,
+            };
+
+            let (entry, backing) = match (base_entry, delta_entry) {
+                (Some(base), Some(mut delta)) => {
+                    // Use the base inode for consistency with stat()
+                    let delta_ino = delta.stats.ino;
+                    delta.stats.ino = base.stats.ino;
+                    (delta, Backing::Both(delta_ino))
+                }
+                (None, Some(mut delta)) => {
+                    // Only in delta - check for origin mapping (from copy-up)
+                    let delta_ino = delta.stats.ino;
+                    if let Some(origin_ino) = origin_inode(&self.delta_fs, delta_ino).await? {
+                        delta.stats.ino = origin_ino;
+                    }
+                    (delta, Backing::Delta(delta_ino))
+                }
+                (Some(base), None) => (base, Backing::Base),
+                (None, None) => continue,
+            };
+
+            let entry_path = if self.dir == "/" {
+                format!("/{}", entry.name)
+            } else {
+                format!("{}/{}", self.dir, entry.name)
+            };
+            self.inodes
+                .record(entry.stats.ino, &entry_path, backing, generation);
+            result.push(entry);
+        }
+
+        Ok(result)
+    }
 }
 
 /// An open file handle for OverlayFS.
@@ -266,16 +829,17 @@ pub struct OverlayFS {
 /// Tracks which layer(s) the file exists in so that operations like fsync
 /// only operate on the relevant layer(s).
 pub struct OverlayFile {
-    /// File handle for the delta layer (if file exists there).
-    delta_file: Option<BoxedFile>,
+    /// File handle for the delta layer, set on open if the file exists
+    /// there and on copy-up otherwise.
+    delta_file: tokio::sync::OnceCell<BoxedFile>,
     /// File handle for the base layer (if file exists there).
     base_file: Option<BoxedFile>,
     /// Reference to delta for copy-on-write operations.
     delta: AgentFS,
     /// The normalized path for copy-on-write operations.
     path: String,
-    /// Track if we've done copy-on-write (to avoid re-copying).
-    copied_to_delta: std::sync::atomic::AtomicBool,
+    /// Overlay inode table, invalidated on copy-up.
+    inodes: Arc<InodeTable>,
 }
 
 impl OverlayFile {
@@ -294,17 +858,47 @@ impl OverlayFile {
             if self.delta.stat(&current).await?.is_none() {
                 // Create it in delta
                 self.delta.mkdir(&current).await?;
+                self.inodes.invalidate(&current);
             }
         }
         Ok(())
     }
+
+    /// The delta layer handle, copying the file up first if it is only in
+    /// the base layer.
+    ///
+    /// The copy keeps at most the first `keep` bytes of the base file and
+    /// skips the chunks that `replaced` will fully overwrite. Later reads
+    /// and stats of this handle go to the copy.
+    async fn delta_file(&self, keep: u64, replaced: Range<u64>) -> Result<&BoxedFile> {
+        self.delta_file
+            .get_or_try_init(|| async {
+                // Copy-up changes which layer backs this path
+                let _invalidate = self.inodes.invalidate_on_drop(&[&self.path]);
+
+                // Ensure parent directories exist in delta before writing
+                self.ensure_parent_dirs_in_delta().await?;
+
+                if let Some(ref base_file) = self.base_file {
+                    let stats = base_file.fstat().await?;
+                    let len = std::cmp::min(keep, stats.size as u64);
+                    self.delta
+                        .write_file_from(&self.path, base_file.as_ref(), len, replaced)
+                        .await?;
+                } else {
+                    self.delta.write_file(&self.path, &[]).await?;
+                }
+                self.delta.open(&self.path).await
+            })
+            .await
+    }
 }
 
 #[async_trait]
 impl File for OverlayFile {
     async fn pread(&self, offset: u64, size: u64) -> Result<Vec<u8>> {
         // Prefer delta if available
-        if let Some(ref file) = self.delta_file {
+        if let Some(file) = self.delta_file.get() {
             return file.pread(offset, size).await;
         }
         // Fall back to base
@@ -316,87 +910,37 @@ impl File for OverlayFile {
     }
 
     async fn pwrite(&self, offset: u64, data: &[u8]) -> Result<()> {
-        // If we already have a delta file handle, use it directly
-        if let Some(ref delta_file) = self.delta_file {
-            return delta_file.pwrite(offset, data).await;
-        }
-
-        // Copy-on-write if needed
-        if !self
-            .copied_to_delta
-            .load(std::sync::atomic::Ordering::Acquire)
-        {
-            // Ensure parent directories exist in delta before writing
-            self.ensure_parent_dirs_in_delta().await?;
-
-            if let Some(ref base_file) = self.base_file {
-                let stats = base_file.fstat().await?;
-                let base_data = base_file.pread(0, stats.size as u64).await?;
-                self.delta.write_file(&self.path, &base_data).await?;
-            } else {
-                self.delta.write_file(&self.path, &[]).await?;
-            }
-            self.copied_to_delta
-                .store(true, std::sync::atomic::Ordering::Release);
-        }
-
-        // Open file in delta and write using the file handle
-        let delta_file = self.delta.open(&self.path).await?;
-        delta_file.pwrite(offset, data).await
+        // Chunks this write fully replaces don't need to be copied up
+        let end = offset + data.len() as u64;
+        self.delta_file(u64::MAX, offset..end)
+            .await?
+            .pwrite(offset, data)
+            .await
     }
 
     async fn truncate(&self, size: u64) -> Result<()> {
-        // If we already have a delta file handle, use it directly
-        if let Some(ref delta_file) = self.delta_file {
-            return delta_file.truncate(size).await;
-        }
-
-        // Copy-on-write if needed
-        if !self
-            .copied_to_delta
-            .load(std::sync::atomic::Ordering::Acquire)
-        {
-            // Ensure parent directories exist in delta before writing
-            self.ensure_parent_dirs_in_delta().await?;
+        // Only the part of the base file that survives the truncate is copied
+        self.delta_file(size, 0..0).await?.truncate(size).await
+    }
 
-            if let Some(ref base_file) = self.base_file {
-                let stats = base_file.fstat().await?;
-                let base_data = base_file.pread(0, stats.size as u64).await?;
-                self.delta.write_file(&self.path, &base_data).await?;
-            } else {
-                self.delta.write_file(&self.path, &[]).await?;
-            }
-            self.copied_to_delta
-                .store(true, std::sync::atomic::Ordering::Release);
+    async fn flush(&self) -> Result<()> {
+        if let Some(file) = self.delta_file.get() {
+            return file.flush().await;
         }
-
-        // Open file in delta and truncate using the file handle
-        let delta_file = self.delta.open(&self.path).await?;
-        delta_file.truncate(size).await
+        Ok(())
     }
 
     async fn fsync(&self) -> Result<()> {
-        // If we have a delta file handle, use it
-        if let Some(ref delta_file) = self.delta_file {
-            return delta_file.fsync().await;
+        if let Some(file) = self.delta_file.get() {
+            return file.fsync().await;
         }
-
-        // If we did copy-on-write, open and sync
-        if self
-            .copied_to_delta
-            .load(std::sync::atomic::Ordering::Acquire)
-        {
-            let delta_file = self.delta.open(&self.path).await?;
-            return delta_file.fsync().await;
-        }
-
         // File only exists in base (read-only), nothing to sync
         Ok(())
     }
 
     async fn fstat(&self) -> Result<Stats> {
         // Prefer delta stats if available
-        if let Some(ref file) = self.delta_file {
+        if let Some(file) = self.delta_file.get() {
             return file.fstat().await;
         }
         if let Some(ref file) = self.base_file {
@@ -412,35 +956,58 @@ impl OverlayFS {
         Self {
             base,
             delta,
-            whiteout_cache: WhiteoutCache::new(),
+            whiteout_cache: WhiteoutCache::lazy(),
             delta_dir_cache: DeltaDirCache::new(),
+            inodes: Arc::new(InodeTable::new()),
         }
     }
 
-    /// Load all whiteouts from the database into the in-memory cache.
+    /// Load the whiteouts directly below `dir` into the in-memory cache.
     ///
-    /// This is called during init() to populate the cache. The cache is then
-    /// kept in sync via create_whiteout() and remove_whiteout().
-    async fn load_whiteouts_into_cache(&self) -> Result<()> {
+    /// Uses the `parent_path` index, plus a probe of the `path` range below
+    /// `dir` that lets the cache skip loading subtrees without whiteouts.
+    async fn load_whiteouts(&self, dir: &str) -> Result<()> {
         let conn = self.delta.get_connection();
 
-        // Query all whiteouts from the database
-        let result = conn.prepare_cached("SELECT path FROM fs_whiteout").await;
-
+        let result = conn
+            .prepare_cached("SELECT path FROM fs_whiteout WHERE parent_path = ?")
+            .await;
         // Handle case where table doesn't exist yet (fresh database)
         let mut stmt = match result {
             Ok(stmt) => stmt,
-            Err(_) => return Ok(()), // Table doesn't exist, nothing to load
+            Err(_) => {
+                self.whiteout_cache.load(dir, Vec::new(), true);
+                return Ok(());
+            }
         };
 
-        let mut rows = stmt.query(()).await?;
-
+        let mut names = Vec::new();
+        let mut rows = stmt.query((dir,)).await?;
         while let Some(row) = rows.next().await? {
             if let Ok(Value::Text(path)) = row.get_value(0) {
-                self.whiteout_cache.insert(&path);
+                if let Some(name) = path.rsplit('/').next() {
+                    names.push(name.to_string());
+                }
             }
         }
 
+        // Every path below `dir` sorts between "dir/" and "dir0"
+        let (lower, upper) = if dir == "/" {
+            ("/".to_string(), "0".to_string())
+        } else {
+            (format!("{}/", dir), format!("{}0", dir))
+        };
+        let mut stmt = conn
+            .prepare_cached(
+                "SELECT 1 FROM fs_whiteout
+                 WHERE path > ? AND path < ? AND parent_path != ?
+                 LIMIT 1",
+            )
+            .await?;
+        let mut rows = stmt.query((lower.as_str(), upper.as_str(), dir)).await?;
+        let deeper = rows.next().await?.is_some();
+
+        self.whiteout_cache.load(dir, names, !deeper);
         Ok(())
     }
 
@@ -453,6 +1020,20 @@ impl OverlayFS {
     /// base layer represents. This is stored in the delta database so that
     /// tools like `agentfs diff` can determine what files were modified.
     pub async fn init_schema(conn: &Connection, base_path: &str) -> Result<()> {
+        Self::init_layer_schema(conn, "base_path", base_path).await
+    }
+
+    /// Initialize the overlay schema of a session forked from another database.
+    ///
+    /// The base layer of a fork is the filesystem of the database at
+    /// `parent_path` rather than a host directory, so forking copies nothing;
+    /// see [`crate::AgentFS::parent_filesystem`].
+    pub async fn init_fork_schema(conn: &Connection, parent_path: &str) -> Result<()> {
+        Self::init_layer_schema(conn, "parent_path", parent_path).await
+    }
+
+    /// Create the overlay tables and record what the base layer is under `key`
+    async fn init_layer_schema(conn: &Connection, key: &str, value: &str) -> Result<()> {
         conn.execute(
             "CREATE TABLE IF NOT EXISTS fs_whiteout (
                 path TEXT PRIMARY KEY,
@@ -478,8 +1059,8 @@ impl OverlayFS {
         )
         .await?;
         conn.execute(
-            "INSERT OR REPLACE INTO fs_overlay_config (key, value) VALUES ('base_path', ?1)",
-            [Value::Text(base_path.to_string())],
+            "INSERT OR REPLACE INTO fs_overlay_config (key, value) VALUES (?1, ?2)",
+            [Value::Text(key.to_string()), Value::Text(value.to_string())],
         )
         .await?;
         // Track origin inodes for copy-up operations (like Linux overlayfs "trusted.overlay.origin")
@@ -506,8 +1087,8 @@ impl OverlayFS {
     /// tools like `agentfs diff` can determine what files were modified.
     pub async fn init(&self, base_path: &str) -> Result<()> {
         Self::init_schema(&self.delta.get_connection(), base_path).await?;
-        // Load existing whiteouts into the in-memory cache
-        self.load_whiteouts_into_cache().await?;
+        // Whiteouts are loaded per directory on first use
+        self.whiteout_cache.clear();
         Ok(())
     }
 
@@ -551,9 +1132,31 @@ impl OverlayFS {
     /// This also checks parent directories - if /foo is whiteout,
     /// then /foo/bar is also considered deleted.
     ///
-    /// Uses the in-memory cache for O(depth) lookup instead of N database queries.
-    fn is_whiteout(&self, path: &NormalizedPath) -> bool {
-        self.whiteout_cache.has_whiteout_ancestor(&path.0)
+    /// Uses the in-memory cache for O(depth) lookup instead of N database
+    /// queries, once the directories along the path have been loaded.
+    async fn is_whiteout(&self, path: &NormalizedPath) -> Result<bool> {
+        self.query_whiteouts(|cache| cache.lookup_ancestor(&path.0))
+            .await
+    }
+
+    /// Answer a whiteout lookup, loading directories until the cache can
+    async fn query_whiteouts<T>(
+        &self,
+        lookup: impl Fn(&WhiteoutCache) -> WhiteoutLookup<T>,
+    ) -> Result<T> {
+        let mut hit = true;
+        loop {
+            match lookup(&self.whiteout_cache) {
+                WhiteoutLookup::Known(answer) => {
+                    metrics::cache_lookup(Cache::Whiteout, hit);
+                    return Ok(answer);
+                }
+                WhiteoutLookup::Load(dir) => {
+                    hit = false;
+                    self.load_whiteouts(&dir).await?
+                }
+            }
+        }
     }
 
     /// Create a whiteout for a path (marks it as deleted from base)
@@ -563,6 +1166,7 @@ impl OverlayFS {
         let conn = self.delta.get_connection();
         let now = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
 
+        let _writer = self.delta.writer().lock().await?;
         let mut stmt = conn
             .prepare_cached(
                 "INSERT INTO fs_whiteout (path, parent_path, created_at) VALUES (?, ?, ?)
@@ -580,17 +1184,22 @@ impl OverlayFS {
     /// Remove a whiteout (un-delete a path)
     ///
     /// Fast path: if the path is not a whiteout in the cache, skip the DB operation.
-    /// The cache is authoritative (loaded at init, kept in sync with all mutations).
+    /// The cache is authoritative for loaded directories (kept in sync with all
+    /// mutations).
     async fn remove_whiteout(&self, path: &str) -> Result<()> {
         let normalized = self.normalize_path(path);
 
         // Fast path: if not in cache, nothing to remove from DB
-        if !self.whiteout_cache.has_exact_whiteout(&normalized) {
+        let exists = self
+            .query_whiteouts(|cache| cache.lookup_exact(&normalized))
+            .await?;
+        if !exists {
             return Ok(());
         }
 
         let conn = self.delta.get_connection();
 
+        let _writer = self.delta.writer().lock().await?;
         let mut stmt = conn
             .prepare_cached("DELETE FROM fs_whiteout WHERE path = ?")
             .await?;
@@ -603,10 +1212,12 @@ impl OverlayFS {
 
     /// Get all whiteouts that are direct children of a directory
     ///
-    /// Uses the in-memory cache for O(1) lookup instead of database query.
-    fn get_child_whiteouts(&self, dir_path: &str) -> HashSet<String> {
+    /// Uses the in-memory cache for O(1) lookup instead of database query,
+    /// once the directory has been loaded.
+    async fn get_child_whiteouts(&self, dir_path: &str) -> Result<HashSet<String>> {
         let normalized = self.normalize_path(dir_path);
-        self.whiteout_cache.get_child_whiteouts(&normalized)
+        self.query_whiteouts(|cache| cache.lookup_children(&normalized))
+            .await
     }
 
     /// Ensure parent directories exist in delta layer
@@ -623,7 +1234,9 @@ impl OverlayFS {
             self.remove_whiteout(&current).await?;
 
             // Fast path: if directory is cached as existing in delta, skip expensive stat() calls
-            if self.delta_dir_cache.contains(&current) {
+            let cached = self.delta_dir_cache.contains(&current);
+            metrics::cache_lookup(Cache::DeltaDir, cached);
+            if cached {
                 continue;
             }
 
@@ -649,6 +1262,7 @@ impl OverlayFS {
                     // Directory exists in base but not delta, create in delta
                     self.delta.mkdir(&current).await?;
                     self.delta_dir_cache.insert(&current);
+                    self.inodes.invalidate(&current);
                 }
                 Some(_) => {
                     // Exists in base but not a directory
@@ -658,6 +1272,7 @@ impl OverlayFS {
                     // Doesn't exist anywhere, create it
                     self.delta.mkdir(&current).await?;
                     self.delta_dir_cache.insert(&current);
+                    self.inodes.invalidate(&current);
                 }
             }
         }
@@ -680,7 +1295,7 @@ impl OverlayFS {
             let current_normalized = NormalizedPath::from_normalized(current.clone());
 
             // Check for whiteout
-            if self.is_whiteout(&current_normalized) {
+            if self.is_whiteout(&current_normalized).await? {
                 return Ok(false);
             }
 
@@ -699,12 +1314,63 @@ impl OverlayFS {
         Ok(true)
     }
 
+    /// Combine the delta and base `lstat` results for a path into the
+    /// overlay's view and record it in the inode table.
+    ///
+    /// If the file exists in base, the base inode is kept for consistency
+    /// (the kernel caches inodes, so changing them after copy-up breaks
+    /// things) while contents and metadata come from delta.
+    async fn merge_entry(
+        &self,
+        path: &NormalizedPath,
+        delta_stats: Option<Stats>,
+        base_stats: Option<Stats>,
+        generation: u64,
+    ) -> Result<Option<Stats>> {
+        let (stats, backing) = match (delta_stats, base_stats) {
+            (delta_stats, Some(mut base_stats)) => {
+                // Root directory must have inode 1 for FUSE compatibility
+                if *path == "/" {
+                    base_stats.ino = ROOT_INO;
+                }
+
+                // If file also exists in delta (was copied up), use delta's metadata
+                // but keep the base inode for consistency with kernel cache
+                match delta_stats {
+                    Some(mut stats) => {
+                        let delta_ino = stats.ino;
+                        stats.ino = base_stats.ino;
+                        (stats, Backing::Both(delta_ino))
+                    }
+                    None => (base_stats, Backing::Base),
+                }
+            }
+            // File only exists in delta (created there, or a hard link to a copied-up file)
+            // Check if it has an origin mapping from copy-up
+            (Some(mut stats), None) => {
+                let delta_ino = stats.ino;
+                if let Some(base_ino) = self.get_origin_inode(delta_ino).await? {
+                    stats.ino = base_ino;
+                }
+                (stats, Backing::Delta(delta_ino))
+            }
+            (None, None) => {
+                self.inodes.record_missing(path, generation);
+                return Ok(None);
+            }
+        };
+
+        self.inodes.record(stats.ino, path, backing, generation);
+        Ok(Some(stats))
+    }
+
     /// Store origin inode mapping for a copy-up operation.
     ///
     /// This records that a delta inode originated from a base inode,
     /// so stat() can return the original inode number (like Linux overlayfs).
     async fn add_origin_mapping(&self, delta_ino: i64, base_ino: i64) -> Result<()> {
         let conn = self.delta.get_connection();
+        let _writer = self.delta.writer().lock().await?;
         let mut stmt = conn
             .prepare_cached("INSERT OR REPLACE INTO fs_origin (delta_ino, base_ino) VALUES (?, ?)")
             .await?;
@@ -712,27 +1378,28 @@ impl OverlayFS {
         Ok(())
     }
 
-    /// Get the origin (base) inode for a delta inode, if it was copied up.
-    async fn get_origin_inode(&self, delta_ino: i64) -> Result<Option<i64>> {
-        let conn = self.delta.get_connection();
-        let result = conn
-            .prepare_cached("SELECT base_ino FROM fs_origin WHERE delta_ino = ?")
-            .await;
-
-        // Handle case where fs_origin table doesn't exist yet (for existing databases)
-        let mut stmt = match result {
-            Ok(stmt) => stmt,
-            Err(_) => return Ok(None),
+    /// Map the delta copy of `path` to the base inode at `path`, so it keeps
+    /// that inode number once it no longer has a base entry at its path.
+    ///
+    /// Does nothing when `path` is missing from either layer or the delta
+    /// copy already has an origin.
+    async fn keep_origin(&self, path: &str) -> Result<()> {
+        let Some(base_stats) = self.base.lstat(path).await? else {
+            return Ok(());
         };
-
-        let mut rows = stmt.query((delta_ino,)).await?;
-
-        if let Some(row) = rows.next().await? {
-            let base_ino = row.get_value(0).ok().and_then(|v| v.as_integer().copied());
-            Ok(base_ino)
-        } else {
-            Ok(None)
+        let Some(delta_stats) = self.delta.lstat(path).await? else {
+            return Ok(());
+        };
+        if self.get_origin_inode(delta_stats.ino).await?.is_none() {
+            self.add_origin_mapping(delta_stats.ino, base_stats.ino)
+                .await?;
         }
+        Ok(())
+    }
+
+    /// Get the origin (base) inode for a delta inode, if it was copied up.
+    async fn get_origin_inode(&self, delta_ino: i64) -> Result<Option<i64>> {
+        origin_inode(&self.delta, delta_ino).await
     }
 
     /// Remove the origin mapping for a delta inode.
@@ -740,6 +1407,7 @@ impl OverlayFS {
     /// Called when a file is deleted from the delta layer to clean up stale mappings.
     async fn remove_origin_mapping(&self, delta_ino: i64) -> Result<()> {
         let conn = self.delta.get_connection();
+        let _writer = self.delta.writer().lock().await?;
         let result = conn
             .execute("DELETE FROM fs_origin WHERE delta_ino = ?", (delta_ino,))
             .await;
@@ -758,7 +1426,7 @@ impl FileSystem for OverlayFS {
         let normalized = self.normalize_path(path);
 
         // Check for whiteout first
-        if self.is_whiteout(&normalized) {
+        if self.is_whiteout(&normalized).await? {
             return Ok(None);
         }
 
@@ -798,43 +1466,16 @@ impl FileSystem for OverlayFS {
 
     async fn lstat(&self, path: &str) -> Result<Option<Stats>> {
         let normalized = self.normalize_path(path);
+        let generation = self.inodes.generation();
 
-        if self.is_whiteout(&normalized) {
+        if self.is_whiteout(&normalized).await? || self.inodes.is_missing(&normalized) {
             return Ok(None);
         }
 
-        // Check delta first for the file content/stats
         let delta_stats = self.delta.lstat(&normalized).await?;
-
-        // Check base for the stable inode
-        // If file exists in base, use base's inode to maintain consistency
-        // (the kernel caches inodes, so changing them after copy-up breaks things)
-        if let Some(mut base_stats) = self.base.lstat(&normalized).await? {
-            // Root directory must have inode 1 for FUSE compatibility
-            if normalized == "/" {
-                base_stats.ino = 1;
-            }
-
-            // If file also exists in delta (was copied up), use delta's metadata
-            // but keep the base inode for consistency with kernel cache
-            if let Some(mut stats) = delta_stats {
-                stats.ino = base_stats.ino;
-                return Ok(Some(stats));
-            }
-
-            return Ok(Some(base_stats));
-        }
-
-        // File only exists in delta (created there, or a hard link to a copied-up file)
-        // Check if it has an origin mapping from copy-up
-        if let Some(mut stats) = delta_stats {
-            if let Some(base_ino) = self.get_origin_inode(stats.ino).await? {
-                stats.ino = base_ino;
-            }
-            return Ok(Some(stats));
-        }
-
-        Ok(None)
+        let base_stats = self.base.lstat(&normalized).await?;
+        self.merge_entry(&normalized, delta_stats, base_stats, generation)
+            .await
     }
 
     async fn read_file(&self, path: &str) -> Result<Option<Vec<u8>>> {
@@ -845,7 +1486,7 @@ impl FileSystem for OverlayFS {
             return Ok(None);
         }
 
-        if self.is_whiteout(&normalized) {
+        if self.is_whiteout(&normalized).await? {
             return Ok(None);
         }
 
@@ -860,6 +1501,7 @@ impl FileSystem for OverlayFS {
 
     async fn write_file(&self, path: &str, data: &[u8]) -> Result<()> {
         let normalized = self.normalize_path(path);
+        let _invalidate = self.inodes.invalidate_on_drop(&[&normalized]);
 
         // Remove any whiteout for this path
         self.remove_whiteout(&normalized).await?;
@@ -878,12 +1520,12 @@ impl FileSystem for OverlayFS {
         let normalized = self.normalize_path(path);
 
         // Check for whiteout on directory itself
-        if self.is_whiteout(&normalized) {
+        if self.is_whiteout(&normalized).await? {
             return Ok(None);
         }
 
         // Get whiteouts for children
-        let child_whiteouts = self.get_child_whiteouts(&normalized);
+        let child_whiteouts = self.get_child_whiteouts(&normalized).await?;
 
         let mut entries = HashSet::new();
 
@@ -915,66 +1557,27 @@ impl FileSystem for OverlayFS {
     }
 
     async fn readdir_plus(&self, path: &str) -> Result<Option<Vec<DirEntry>>> {
-        let normalized = self.normalize_path(path);
-
-        // Check for whiteout on directory itself
-        if self.is_whiteout(&normalized) {
+        let Some(mut stream) = self.opendir(path).await? else {
             return Ok(None);
-        }
-
-        // Get whiteouts for children
-        let child_whiteouts = self.get_child_whiteouts(&normalized);
-
-        // Use a HashMap to merge entries, with delta taking precedence
-        let mut entries_map = std::collections::HashMap::new();
+        };
 
-        // Get entries from base first (to have their inodes available)
-        let mut base_inodes = std::collections::HashMap::new();
-        if let Some(base_entries) = self.base.readdir_plus(&normalized).await? {
-            for entry in base_entries {
-                if !child_whiteouts.contains(&entry.name) {
-                    base_inodes.insert(entry.name.clone(), entry.stats.ino);
-                    entries_map.insert(entry.name.clone(), entry);
-                }
+        let mut result = Vec::new();
+        loop {
+            let batch = stream.next_batch(DIR_STREAM_BATCH).await?;
+            if batch.is_empty() {
+                break;
             }
+            result.extend(batch);
         }
-
-        // Get entries from delta (these take precedence for content/metadata)
-        // But we need to use the base inode if the file exists in base,
-        // to maintain consistency with stat() which returns base inodes
-        if let Some(delta_entries) = self.delta.readdir_plus(&normalized).await? {
-            for mut entry in delta_entries {
-                // If file exists in base, use base inode for consistency with stat()
-                if let Some(&base_ino) = base_inodes.get(&entry.name) {
-                    entry.stats.ino = base_ino;
-                } else {
-                    // File only in delta - check for origin mapping (from copy-up)
-                    if let Some(origin_ino) = self.get_origin_inode(entry.stats.ino).await? {
-                        entry.stats.ino = origin_ino;
-                    }
-                }
-                entries_map.insert(entry.name.clone(), entry);
-            }
-        }
-
-        // Check if directory exists in either layer
-        let delta_exists = self.delta.stat(&normalized).await?.is_some();
-        let base_exists = self.base.stat(&normalized).await?.is_some();
-
-        if !delta_exists && !base_exists {
-            return Ok(None);
-        }
-
-        let mut result: Vec<_> = entries_map.into_values().collect();
-        result.sort_by(|a, b| a.name.cmp(&b.name));
         Ok(Some(result))
     }
 
     async fn mkdir(&self, path: &str) -> Result<()> {
         let normalized = self.normalize_path(path);
+        let _invalidate = self.inodes.invalidate_on_drop(&[&normalized]);
 
         // Check if already exists (in either layer, not whiteout)
-        if !self.is_whiteout(&normalized)
+        if !self.is_whiteout(&normalized).await?
             && (self.delta.stat(&normalized).await?.is_some()
                 || self.base.stat(&normalized).await?.is_some())
         {
@@ -997,6 +1600,7 @@ impl FileSystem for OverlayFS {
 
     async fn remove(&self, path: &str) -> Result<()> {
         let normalized = self.normalize_path(path);
+        let _invalidate = self.inodes.invalidate_on_drop(&[&normalized]);
 
         // Check if path is a symlink - symlinks don't have children, so skip directory checks
         let is_symlink = if let Some(stats) = self.lstat(&normalized).await? {
@@ -1019,7 +1623,7 @@ impl FileSystem for OverlayFS {
                 for child in base_children {
                     let child_path =
                         NormalizedPath::from_normalized(format!("{}/{}", normalized, child));
-                    if !self.is_whiteout(&child_path) {
+                    if !self.is_whiteout(&child_path).await? {
                         return Err(FsError::NotEmpty.into());
                     }
                 }
@@ -1042,7 +1646,7 @@ impl FileSystem for OverlayFS {
         }
 
         // Check if it exists in base (and not already whiteout) - use lstat to not follow symlinks
-        let exists_in_base = if self.is_whiteout(&normalized) {
+        let exists_in_base = if self.is_whiteout(&normalized).await? {
             false
         } else {
             self.base.lstat(&normalized).await?.is_some()
@@ -1060,9 +1664,10 @@ impl FileSystem for OverlayFS {
 
     async fn chmod(&self, path: &str, mode: u32) -> Result<()> {
         let normalized = self.normalize_path(path);
+        let _invalidate = self.inodes.invalidate_on_drop(&[&normalized]);
 
         // Check if whited-out
-        if self.is_whiteout(&normalized) {
+        if self.is_whiteout(&normalized).await? {
             return Err(FsError::NotFound.into());
         }
 
@@ -1089,11 +1694,9 @@ impl FileSystem for OverlayFS {
                 }
             } else {
                 // For regular files, copy content to delta
-                if let Some(data) = self.base.read_file(&normalized).await? {
-                    self.ensure_parent_dirs(&normalized).await?;
-                    self.delta.write_file(&normalized, &data).await?;
-                    self.delta.chmod(&normalized, mode).await?;
-                }
+                self.ensure_parent_dirs(&normalized).await?;
+                self.copy_up_file(&normalized, &stats).await?;
+                self.delta.chmod(&normalized, mode).await?;
             }
             Ok(())
         } else {
@@ -1104,6 +1707,9 @@ impl FileSystem for OverlayFS {
     async fn rename(&self, from: &str, to: &str) -> Result<()> {
         let from_normalized = self.normalize_path(from);
         let to_normalized = self.normalize_path(to);
+        let _invalidate = self
+            .inodes
+            .invalidate_on_drop(&[&from_normalized, &to_normalized]);
 
         // Renaming to self is a no-op
         if from_normalized == to_normalized {
@@ -1126,10 +1732,8 @@ impl FileSystem for OverlayFS {
                     self.copy_dir_to_delta(&from_normalized).await?;
                 } else {
                     // Copy file to delta
-                    if let Some(data) = self.base.read_file(&from_normalized).await? {
-                        self.ensure_parent_dirs(&from_normalized).await?;
-                        self.delta.write_file(&from_normalized, &data).await?;
-                    }
+                    self.ensure_parent_dirs(&from_normalized).await?;
+                    self.copy_up_file(&from_normalized, &stats).await?;
                 }
             } else {
                 return Err(FsError::NotFound.into());
@@ -1142,8 +1746,12 @@ impl FileSystem for OverlayFS {
         // Ensure parent directories exist at destination
         self.ensure_parent_dirs(&to_normalized).await?;
 
+        // Keep the inode number the source had in base
+        self.keep_origin(&from_normalized).await?;
+
         // Perform rename in delta
         self.delta.rename(&from_normalized, &to_normalized).await?;
+        self.inodes.rename(&from_normalized, &to_normalized);
 
         // Invalidate delta directory cache for both source and destination (and their children)
         self.delta_dir_cache.remove(&from_normalized);
@@ -1159,6 +1767,7 @@ impl FileSystem for OverlayFS {
 
     async fn symlink(&self, target: &str, linkpath: &str) -> Result<()> {
         let normalized = self.normalize_path(linkpath);
+        let _invalidate = self.inodes.invalidate_on_drop(&[&normalized]);
 
         // Remove any whiteout
         self.remove_whiteout(&normalized).await?;
@@ -1173,9 +1782,12 @@ impl FileSystem for OverlayFS {
     async fn link(&self, oldpath: &str, newpath: &str) -> Result<()> {
         let old_normalized = self.normalize_path(oldpath);
         let new_normalized = self.normalize_path(newpath);
+        let _invalidate = self
+            .inodes
+            .invalidate_on_drop(&[&old_normalized, &new_normalized]);
 
         // Check if source is whited out
-        if self.is_whiteout(&old_normalized) {
+        if self.is_whiteout(&old_normalized).await? {
             return Err(FsError::NotFound.into());
         }
 
@@ -1196,18 +1808,14 @@ impl FileSystem for OverlayFS {
                 if stats.is_directory() {
                     return Err(FsError::IsADirectory.into());
                 }
-                // Copy-up: read from base and write to delta
-                if let Some(data) = self.base.read_file(&old_normalized).await? {
-                    self.ensure_parent_dirs(&old_normalized).await?;
-                    self.delta.write_file(&old_normalized, &data).await?;
-
-                    // Store origin mapping: delta_ino -> base_ino
-                    // This ensures stat() returns the original base inode after copy-up
-                    if let Some(delta_stats) = self.delta.lstat(&old_normalized).await? {
-                        self.add_origin_mapping(delta_stats.ino, stats.ino).await?;
-                    }
-                } else {
-                    return Err(FsError::NotFound.into());
+                // Copy-up: stream from base into delta
+                self.ensure_parent_dirs(&old_normalized).await?;
+                self.copy_up_file(&old_normalized, &stats).await?;
+
+                // Store origin mapping: delta_ino -> base_ino
+                // This ensures stat() returns the original base inode after copy-up
+                if let Some(delta_stats) = self.delta.lstat(&old_normalized).await? {
+                    self.add_origin_mapping(delta_stats.ino, stats.ino).await?;
                 }
             } else {
                 return Err(FsError::NotFound.into());
@@ -1221,7 +1829,7 @@ impl FileSystem for OverlayFS {
     async fn readlink(&self, path: &str) -> Result<Option<String>> {
         let normalized = self.normalize_path(path);
 
-        if self.is_whiteout(&normalized) {
+        if self.is_whiteout(&normalized).await? {
             return Ok(None);
         }
 
@@ -1243,7 +1851,7 @@ impl FileSystem for OverlayFS {
         let normalized = self.normalize_path(path);
 
         // Check for whiteout
-        if self.is_whiteout(&normalized) {
+        if self.is_whiteout(&normalized).await? {
             return Err(FsError::NotFound.into());
         }
 
@@ -1263,16 +1871,17 @@ impl FileSystem for OverlayFS {
         }
 
         Ok(Arc::new(OverlayFile {
-            delta_file,
+            delta_file: tokio::sync::OnceCell::new_with(delta_file),
             base_file,
             delta: self.delta.clone(),
             path: normalized.0,
-            copied_to_delta: std::sync::atomic::AtomicBool::new(false),
+            inodes: self.inodes.clone(),
         }))
     }
 
     async fn create_file(&self, path: &str, mode: u32) -> Result<(Stats, BoxedFile)> {
         let normalized = self.normalize_path(path);
+        let _invalidate = self.inodes.invalidate_on_drop(&[&normalized]);
 
         // Remove any whiteout for this path
         self.remove_whiteout(&normalized).await?;
@@ -1284,14 +1893,136 @@ impl FileSystem for OverlayFS {
         self.ensure_parent_dirs(&normalized).await?;
 
         // Create in delta layer
-        self.delta.create_file(&normalized, mode).await
+        let (stats, file) = self.delta.create_file(&normalized, mode).await?;
+        self.inodes.record(
+            stats.ino,
+            &normalized,
+            Backing::Unknown,
+            self.inodes.generation(),
+        );
+        Ok((stats, file))
+    }
+
+    async fn lookup(&self, parent_ino: i64, name: &str) -> Result<Option<Stats>> {
+        let Some(parent) = self.inodes.get(parent_ino) else {
+            return Ok(None);
+        };
+        let generation = self.inodes.generation();
+        let path = NormalizedPath::from_normalized(if parent.path == "/" {
+            format!("/{}", name)
+        } else {
+            format!("{}/{}", parent.path, name)
+        });
+
+        if self.is_whiteout(&path).await? || self.inodes.is_missing(&path) {
+            return Ok(None);
+        }
+
+        // Only ask the layers the parent directory lives in. A directory that
+        // is only in delta has no children in base, and vice versa.
+        let delta_stats = match parent.backing {
+            Backing::Delta(ino) | Backing::Both(ino) => self.delta.lookup(ino, name).await?,
+            Backing::Base => None,
+            Backing::Unknown => self.delta.lstat(&path).await?,
+        };
+        let base_stats = match parent.backing {
+            Backing::Delta(_) => None,
+            Backing::Base | Backing::Both(_) | Backing::Unknown => self.base.lstat(&path).await?,
+        };
+
+        self.merge_entry(&path, delta_stats, base_stats, generation)
+            .await
+    }
+
+    async fn getattr(&self, ino: i64) -> Result<Option<Stats>> {
+        let Some(entry) = self.inodes.get(ino) else {
+            return Ok(None);
+        };
+
+        let cached = match entry.backing {
+            Backing::Delta(delta_ino) | Backing::Both(delta_ino) => {
+                self.delta.getattr(delta_ino).await?
+            }
+            Backing::Base => self.base.lstat(&entry.path).await?,
+            Backing::Unknown => None,
+        };
+        if let Some(mut stats) = cached {
+            stats.ino = ino;
+            return Ok(Some(stats));
+        }
+
+        // Not resolved yet, or gone from the layer it was in
+        self.lstat(&entry.path).await
+    }
+
+    async fn open_inode(&self, ino: i64) -> Result<BoxedFile> {
+        let entry = self.inodes.get(ino).ok_or(FsError::NotFound)?;
+        self.open(&entry.path).await
+    }
+
+    async fn readdir_inode(&self, ino: i64) -> Result<Option<Vec<DirEntry>>> {
+        let Some(entry) = self.inodes.get(ino) else {
+            return Ok(None);
+        };
+        self.readdir_plus(&entry.path).await
+    }
+
+    async fn opendir(&self, path: &str) -> Result<Option<BoxedDirStream>> {
+        let normalized = self.normalize_path(path);
+
+        // Check for whiteout on directory itself
+        if self.is_whiteout(&normalized).await? {
+            return Ok(None);
+        }
+
+        let base = self.base.opendir(&normalized).await?;
+        let delta = self.delta.opendir(&normalized).await?;
+        if base.is_none() && delta.is_none() {
+            return Ok(None);
+        }
+
+        Ok(Some(Box::new(OverlayDirStream {
+            base: base.map(LayerStream::new),
+            delta: delta.map(LayerStream::new),
+            delta_fs: self.delta.clone(),
+            inodes: self.inodes.clone(),
+            whiteouts: self.get_child_whiteouts(&normalized).await?,
+            dir: normalized.as_str().to_string(),
+        })))
+    }
+
+    async fn opendir_inode(&self, ino: i64) -> Result<Option<BoxedDirStream>> {
+        let Some(entry) = self.inodes.get(ino) else {
+            return Ok(None);
+        };
+        self.opendir(&entry.path).await
+    }
+
+    fn forget(&self, ino: i64) {
+        // Entries that may be in base have the base inode number
+        if let Some(entry) = self.inodes.forget(ino) {
+            if !matches!(entry.backing, Backing::Delta(_)) {
+                self.base.forget(ino);
+            }
+        }
     }
 }
 
 impl OverlayFS {
+    /// Copy a regular file from base to delta without buffering it in memory.
+    ///
+    /// The parent directory must already exist in delta.
+    async fn copy_up_file(&self, path: &str, stats: &Stats) -> Result<()> {
+        let file = self.base.open(path).await?;
+        self.delta
+            .write_file_from(path, file.as_ref(), stats.size as u64, 0..0)
+            .await
+    }
+
     /// Recursively copy a directory from base to delta
     async fn copy_dir_to_delta(&self, path: &str) -> Result<()> {
         self.delta.mkdir(path).await?;
+        self.keep_origin(path).await?;
 
         if let Some(entries) = self.base.readdir(path).await? {
             for entry in entries {
@@ -1307,9 +2038,11 @@ impl OverlayFS {
                     } else if stats.is_symlink() {
                         if let Some(target) = self.base.readlink(&entry_path).await? {
                             self.delta.symlink(&target, &entry_path).await?;
+                            self.keep_origin(&entry_path).await?;
                         }
-                    } else if let Some(data) = self.base.read_file(&entry_path).await? {
-                        self.delta.write_file(&entry_path, &data).await?;
+                    } else {
+                        self.copy_up_file(&entry_path, &stats).await?;
+                        self.keep_origin(&entry_path).await?;
                     }
                 }
             }
@@ -1344,6 +2077,27 @@ mod tests {
         Ok((overlay, base_dir, delta_dir))
     }
 
+    #[test]
+    fn test_inode_table_subtree_next_to_sorting_sibling() {
+        // "/src.bak" sorts between "/src" and "/src/main.rs"
+        let table = InodeTable::new();
+        let generation = table.generation();
+        table.record(2, "/src", Backing::Base, generation);
+        table.record(3, "/src.bak", Backing::Base, generation);
+        table.record(4, "/src/main.rs", Backing::Base, generation);
+        table.record_missing("/src/gone", generation);
+
+        table.invalidate("/src");
+        assert_eq!(table.get(4).unwrap().backing, Backing::Unknown);
+        assert_eq!(table.get(3).unwrap().backing, Backing::Base);
+        assert!(!table.is_missing("/src/gone"));
+
+        table.rename("/src", "/dst");
+        assert_eq!(table.get(2).unwrap().path, "/dst");
+        assert_eq!(table.get(4).unwrap().path, "/dst/main.rs");
+        assert_eq!(table.get(3).unwrap().path, "/src.bak");
+    }
+
     #[tokio::test]
     async fn test_overlay_read_from_base() -> Result<()> {
         let (overlay, _base_dir, _delta_dir) = create_test_overlay().await?;
@@ -1388,6 +2142,72 @@ mod tests {
         Ok(())
     }
 
+    #[tokio::test]
+    async fn test_overlay_handle_reads_its_copy_up() -> Result<()> {
+        let (overlay, _base_dir, _delta_dir) = create_test_overlay().await?;
+
+        // The handle was opened on the base layer; later reads and stats
+        // must see the copy its first write made
+        let file = overlay.open("/base.txt").await?;
+        file.pwrite(12, b" and more").await?;
+        assert_eq!(file.pread(0, 64).await?, b"base content and more");
+        assert_eq!(file.fstat().await?.size, 21);
+
+        file.truncate(4).await?;
+        assert_eq!(file.pread(0, 64).await?, b"base");
+        assert_eq!(file.fstat().await?.size, 4);
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn test_overlay_copy_up_large_file_streams() -> Result<()> {
+        let (overlay, base_dir, _delta_dir) = create_test_overlay().await?;
+
+        // Several copy batches plus a partial trailing chunk
+        let chunk_size = overlay.delta().chunk_size();
+        let data: Vec<u8> = (0..(chunk_size * 600 + 123))
+            .map(|i| (i % 251) as u8)
+            .collect();
+        std::fs::write(base_dir.path().join("large.bin"), &data)?;
+
+        // Overwrite a range spanning several whole chunks in the middle
+        let offset = chunk_size * 300 + 17;
+        let patch = vec![0xAAu8; chunk_size * 5];
+        let file = overlay.open("/large.bin").await?;
+        file.pwrite(offset as u64, &patch).await?;
+
+        let mut expected = data.clone();
+        expected[offset..offset + patch.len()].copy_from_slice(&patch);
+        assert_eq!(overlay.read_file("/large.bin").await?.unwrap(), expected);
+
+        // Base file should be unchanged
+        assert_eq!(std::fs::read(base_dir.path().join("large.bin"))?, data);
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn test_overlay_truncate_copies_only_prefix() -> Result<()> {
+        let (overlay, base_dir, _delta_dir) = create_test_overlay().await?;
+
+        let chunk_size = overlay.delta().chunk_size();
+        let data: Vec<u8> = (0..(chunk_size * 10)).map(|i| (i % 13) as u8).collect();
+        std::fs::write(base_dir.path().join("trunc.bin"), &data)?;
+
+        let file = overlay.open("/trunc.bin").await?;
+        file.truncate((chunk_size + 5) as u64).await?;
+
+        let stats = overlay.stat("/trunc.bin").await?.unwrap();
+        assert_eq!(stats.size as usize, chunk_size + 5);
+        assert_eq!(
+            overlay.read_file("/trunc.bin").await?.unwrap(),
+            &data[..chunk_size + 5]
+        );
+
+        Ok(())
+    }
+
     #[tokio::test]
     async fn test_overlay_whiteout() -> Result<()> {
         let (overlay, _base_dir, _delta_dir) = create_test_overlay().await?;
@@ -1684,6 +2504,276 @@ mod tests {
 
         Ok(())
     }
+
+    #[tokio::test]
+    async fn test_overlay_inode_ops_follow_copy_up() -> Result<()> {
+        let (overlay, _base_dir, _delta_dir) = create_test_overlay().await?;
+
+        let subdir = overlay.lookup(ROOT_INO, "subdir").await?.unwrap();
+        let nested = overlay.lookup(subdir.ino, "nested.txt").await?.unwrap();
+        assert_eq!(
+            nested.ino,
+            overlay.lstat("/subdir/nested.txt").await?.unwrap().ino
+        );
+
+        // Copy-up keeps the inode number and getattr sees the delta copy
+        let file = overlay.open_inode(nested.ino).await?;
+        file.pwrite(0, b"NESTED-UPDATED").await?;
+        let attr = overlay.getattr(nested.ino).await?.unwrap();
+        assert_eq!(attr.ino, nested.ino);
+        assert_eq!(attr.size, 14);
+
+        // New delta entries are visible through the base directory's inode
+        overlay.write_file("/subdir/added.txt", b"x").await?;
+        let mut names: Vec<_> = overlay
+            .readdir_inode(subdir.ino)
+            .await?
+            .unwrap()
+            .into_iter()
+            .map(|e| e.name)
+            .collect();
+        names.sort();
+        assert_eq!(names, vec!["added.txt", "nested.txt"]);
+        assert!(overlay.lookup(subdir.ino, "added.txt").await?.is_some());
+
+        // Whiteouts hide the entry from lookup
+        overlay.remove("/subdir/nested.txt").await?;
+        assert!(overlay.lookup(subdir.ino, "nested.txt").await?.is_none());
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn test_overlay_inode_ops_follow_rename() -> Result<()> {
+        let (overlay, _base_dir, _delta_dir) = create_test_overlay().await?;
+        overlay.write_file("/delta.txt", b"delta").await?;
+
+        let base = overlay.lookup(ROOT_INO, "base.txt").await?.unwrap();
+        let delta = overlay.lookup(ROOT_INO, "delta.txt").await?.unwrap();
+        let subdir = overlay.lookup(ROOT_INO, "subdir").await?.unwrap();
+        let nested = overlay.lookup(subdir.ino, "nested.txt").await?.unwrap();
+        assert_eq!(overlay.getattr(base.ino).await?.unwrap().size, 12);
+        assert_eq!(overlay.getattr(nested.ino).await?.unwrap().size, 6);
+
+        overlay.rename("/base.txt", "/moved.txt").await?;
+        overlay.rename("/delta.txt", "/moved-delta.txt").await?;
+        overlay.rename("/subdir", "/moved-dir").await?;
+
+        // The same inodes still resolve, at their new paths
+        let attr = overlay.getattr(base.ino).await?.unwrap();
+        assert_eq!(attr.ino, base.ino);
+        assert_eq!(attr.size, 12);
+        let attr = overlay.getattr(delta.ino).await?.unwrap();
+        assert_eq!(attr.ino, delta.ino);
+        assert_eq!(attr.size, 5);
+        let attr = overlay.getattr(nested.ino).await?.unwrap();
+        assert_eq!(attr.ino, nested.ino);
+        assert_eq!(attr.size, 6);
+        let file = overlay.open_inode(nested.ino).await?;
+        assert_eq!(file.pread(0, 64).await?, b"nested");
+
+        // Lookups at the new paths hand out the same inode numbers
+        let moved = overlay.lookup(ROOT_INO, "moved.txt").await?.unwrap();
+        assert_eq!(moved.ino, base.ino);
+        let dir = overlay.lookup(ROOT_INO, "moved-dir").await?.unwrap();
+        assert_eq!(dir.ino, subdir.ino);
+        let moved = overlay.lookup(dir.ino, "nested.txt").await?.unwrap();
+        assert_eq!(moved.ino, nested.ino);
+        assert!(overlay.lookup(ROOT_INO, "base.txt").await?.is_none());
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn test_overlay_forget() -> Result<()> {
+        let (overlay, _base_dir, _delta_dir) = create_test_overlay().await?;
+
+        let base = overlay.lookup(ROOT_INO, "base.txt").await?.unwrap();
+        assert!(overlay.getattr(base.ino).await?.is_some());
+
+        // A forgotten inode is unknown until it is looked up again
+        overlay.forget(base.ino);
+        assert!(overlay.getattr(base.ino).await?.is_none());
+        let again = overlay.lookup(ROOT_INO, "base.txt").await?.unwrap();
+        assert_eq!(again.ino, base.ino);
+        assert!(overlay.getattr(base.ino).await?.is_some());
+
+        // The root is never forgotten
+        overlay.forget(ROOT_INO);
+        assert!(overlay.getattr(ROOT_INO).await?.is_some());
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn test_overlay_negative_entries() -> Result<()> {
+        let (overlay, base_dir, _delta_dir) = create_test_overlay().await?;
+        let subdir = overlay.lstat("/subdir").await?.unwrap();
+        assert!(overlay.lstat("/late.txt").await?.is_none());
+        assert!(overlay.lookup(subdir.ino, "late.txt").await?.is_none());
+
+        // A base file appearing behind our back shows up once the miss expires
+        std::fs::write(base_dir.path().join("late.txt"), b"late")?;
+        assert!(overlay.lstat("/late.txt").await?.is_none());
+        tokio::time::sleep(NEGATIVE_ENTRY_TTL).await;
+        assert!(overlay.lstat("/late.txt").await?.is_some());
+
+        // Our own mutations are visible right away
+        assert!(overlay.lstat("/new.txt").await?.is_none());
+        assert!(overlay.lstat("/newdir").await?.is_none());
+        overlay.write_file("/new.txt", b"new").await?;
+        overlay.mkdir("/newdir").await?;
+        assert!(overlay.lstat("/new.txt").await?.is_some());
+        assert!(overlay.lstat("/newdir").await?.is_some());
+
+        // Renaming onto a missing path reveals the moved subtree
+        assert!(overlay.lstat("/moved").await?.is_none());
+        assert!(overlay.lstat("/moved/nested.txt").await?.is_none());
+        overlay.rename("/subdir", "/moved").await?;
+        assert!(overlay.lstat("/moved").await?.is_some());
+        let nested = overlay.read_file("/moved/nested.txt").await?.unwrap();
+        assert_eq!(nested, b"nested");
+
+        Ok(())
+    }
+
+    #[test]
+    fn test_whiteout_cache_lazy_load() {
+        let cache = WhiteoutCache::lazy();
+        assert_eq!(
+            cache.lookup_ancestor("/a/b"),
+            WhiteoutLookup::Load("/".to_string())
+        );
+
+        // Something is whited out below the root, but not directly in it
+        cache.load("/", Vec::new(), false);
+        assert_eq!(
+            cache.lookup_ancestor("/a/b"),
+            WhiteoutLookup::Load("/a".to_string())
+        );
+        assert_eq!(cache.lookup_ancestor("/a"), WhiteoutLookup::Known(false));
+
+        cache.load("/a", vec!["b".to_string()], true);
+        assert_eq!(cache.lookup_ancestor("/a/b/c"), WhiteoutLookup::Known(true));
+        assert_eq!(cache.lookup_exact("/a/b"), WhiteoutLookup::Known(true));
+        // Nothing deeper than /a/b, so /a/x needs no load
+        assert_eq!(
+            cache.lookup_ancestor("/a/x/y"),
+            WhiteoutLookup::Known(false)
+        );
+        assert_eq!(
+            cache.lookup_ancestor("/z/y"),
+            WhiteoutLookup::Load("/z".to_string())
+        );
+
+        // A load racing with a removal must not bring the whiteout back
+        cache.remove("/a/b");
+        cache.load("/a", vec!["b".to_string()], true);
+        assert_eq!(cache.lookup_ancestor("/a/b"), WhiteoutLookup::Known(false));
+        assert_eq!(
+            cache.lookup_children("/a"),
+            WhiteoutLookup::Known(HashSet::new())
+        );
+
+        // Inserts below a fully known subtree stay fully known
+        cache.insert("/a/x/y");
+        assert_eq!(
+            cache.lookup_ancestor("/a/x/y/z"),
+            WhiteoutLookup::Known(true)
+        );
+        assert_eq!(
+            cache.lookup_ancestor("/a/x/w"),
+            WhiteoutLookup::Known(false)
+        );
+    }
+
+    #[tokio::test]
+    async fn test_overlay_whiteouts_load_lazily() -> Result<()> {
+        let (overlay, base_dir, _delta_dir) = create_test_overlay().await?;
+        std::fs::create_dir_all(base_dir.path().join("deep/a/b"))?;
+        std::fs::write(base_dir.path().join("deep/a/b/f.txt"), b"f")?;
+        std::fs::write(base_dir.path().join("deep/a/g.txt"), b"g")?;
+
+        overlay.remove("/base.txt").await?;
+        overlay.remove("/subdir/nested.txt").await?;
+        overlay.remove("/deep/a/b/f.txt").await?;
+
+        // A fresh overlay on the same delta starts with nothing loaded
+        let base = overlay.base().clone();
+        let overlay = OverlayFS::new(base, overlay.delta().clone());
+        assert!(overlay.lstat("/deep/a/b/f.txt").await?.is_none());
+        assert!(overlay.lstat("/deep/a/b").await?.is_some());
+        assert!(overlay.lstat("/deep/a/g.txt").await?.is_some());
+        assert!(overlay.lstat("/base.txt").await?.is_none());
+        assert_eq!(
+            overlay.readdir("/subdir").await?.unwrap(),
+            Vec::<String>::new()
+        );
+        assert!(!overlay
+            .readdir("/")
+            .await?
+            .unwrap()
+            .contains(&"base.txt".to_string()));
+
+        // Recreating a deleted file removes its persisted whiteout
+        overlay.write_file("/base.txt", b"again").await?;
+        let overlay = OverlayFS::new(overlay.base().clone(), overlay.delta().clone());
+        assert_eq!(overlay.read_file("/base.txt").await?.unwrap(), b"again");
+        assert!(overlay.lstat("/subdir/nested.txt").await?.is_none());
+
+        Ok(())
+    }
+
+    #[tokio::test]
+    async fn test_overlay_opendir_merges_layers_lazily() -> Result<()> {
+        let (overlay, base_dir, _delta_dir) = create_test_overlay().await?;
+        for i in (0..20).step_by(2) {
+            std::fs::write(base_dir.path().join(format!("subdir/e{:02}", i)), b"base")?;
+        }
+        let copied = overlay.lstat("/subdir/e04").await?.unwrap();
+
+        // Odd names only in delta, e04 copied up, e06 whited out
+        for i in (1..20).step_by(2) {
+            overlay
+                .write_file(&format!("/subdir/e{:02}", i), b"delta")
+                .await?;
+        }
+        overlay.write_file("/subdir/e04", b"updated").await?;
+        overlay.remove("/subdir/e06").await?;
+
+        let subdir = overlay.lookup(ROOT_INO, "subdir").await?.unwrap();
+        let mut stream = overlay.opendir_inode(subdir.ino).await?.unwrap();
+        let mut entries = Vec::new();
+        loop {
+            let batch = stream.next_batch(3).await?;
+            assert!(batch.len() <= 3);
+            if batch.is_empty() {
+                break;
+            }
+            entries.extend(batch);
+        }
+
+        let names: Vec<_> = entries.iter().map(|e| e.name.as_str()).collect();
+        let mut expected: Vec<String> = (0..20)
+            .filter(|&i| i != 6)
+            .map(|i| format!("e{:02}", i))
+            .collect();
+        expected.push("nested.txt".to_string());
+        assert_eq!(names, expected);
+
+        // The copied-up file keeps its base inode and shows delta contents
+        let e04 = entries.iter().find(|e| e.name == "e04").unwrap();
+        assert_eq!(e04.stats.ino, copied.ino);
+        assert_eq!(e04.stats.size, 7);
+
+        // readdir_plus lists the same merged view
+        let listed = overlay.readdir_plus("/subdir").await?.unwrap();
+        assert_eq!(listed.len(), entries.len());
+
+        assert!(overlay.opendir("/missing").await?.is_none());
+
+        Ok(())
+    }
 }
 
 /// Property-based tests using proptest to verify that overlay operations
@@ -1,12 +1,54 @@
-use crate::error::Result;
+use crate::error::{Error, Result};
+use crate::filesystem::agentfs::WriterLock;
+use crate::filesystem::cache::ClockCache;
 use serde::{Deserialize, Serialize};
-use std::sync::Arc;
-use turso::{Builder, Connection};
+use std::collections::HashMap;
+use std::sync::{Arc, Mutex};
+use turso::{Builder, Connection, Value};
+
+/// Keys per statement in batched operations, well below SQLite's limit on
+/// bound parameters
+const KEYS_PER_STATEMENT: usize = 256;
 
 /// A key-value store backed by SQLite
 #[derive(Clone)]
 pub struct KvStore {
     conn: Arc<Connection>,
+    cache: Option<Arc<ValueCache>>,
+    /// Held while changing the database through `conn`
+    writer: WriterLock,
+}
+
+/// Read-through cache of serialized values, including misses.
+///
+/// Writes through the store bump `generation` and drop the keys they
+/// touch while holding its lock, and a lookup only fills the cache if no
+/// write happened since it started, so a slow read never caches a value
+/// that was already overwritten.
+struct ValueCache {
+    values: ClockCache<String, Option<Arc<str>>>,
+    generation: Mutex<u64>,
+}
+
+impl ValueCache {
+    fn generation(&self) -> u64 {
+        *self.generation.lock().unwrap()
+    }
+
+    fn fill(&self, generation: u64, key: &str, value: Option<Arc<str>>) {
+        let current = self.generation.lock().unwrap();
+        if *current == generation {
+            self.values.insert(key.to_string(), value);
+        }
+    }
+
+    fn invalidate<'a>(&self, keys: impl IntoIterator<Item = &'a str>) {
+        let mut current = self.generation.lock().unwrap();
+        *current += 1;
+        for key in keys {
+            self.values.remove(key);
+        }
+    }
 }
 
 impl KvStore {
@@ -16,6 +58,8 @@ impl KvStore {
         let conn = db.connect()?;
         let kv = Self {
             conn: Arc::new(conn),
+            cache: None,
+            writer: WriterLock::default(),
         };
         kv.initialize().await?;
         Ok(kv)
@@ -23,11 +67,36 @@ impl KvStore {
 
     /// Create a KV store from an existing connection
     pub async fn from_connection(conn: Arc<Connection>) -> Result<Self> {
-        let kv = Self { conn };
+        let kv = Self {
+            conn,
+            cache: None,
+            writer: WriterLock::default(),
+        };
         kv.initialize().await?;
         Ok(kv)
     }
 
+    /// Share the lock that serializes changes through the connection with
+    /// the filesystem using the same connection, so a write never lands
+    /// inside one of its transactions or opens a second one
+    pub(crate) fn with_writer(mut self, writer: WriterLock) -> Self {
+        self.writer = writer;
+        self
+    }
+
+    /// Keep up to `capacity` recently read values in memory
+    ///
+    /// Writes through this store (or its clones) keep the cache coherent;
+    /// writes through other connections are not seen until the key is
+    /// evicted, so only enable it when this store is the only writer.
+    pub fn with_cache(mut self, capacity: usize) -> Self {
+        self.cache = Some(Arc::new(ValueCache {
+            values: ClockCache::new(capacity),
+            generation: Mutex::new(0),
+        }));
+        self
+    }
+
     /// Initialize the database schema
     async fn initialize(&self) -> Result<()> {
         self.conn
@@ -56,6 +125,7 @@ impl KvStore {
     /// Set a key-value pair
     pub async fn set<V: Serialize>(&self, key: &str, value: &V) -> Result<()> {
         let serialized = serde_json::to_string(value)?;
+        let _writer = self.writer.lock().await?;
         self.conn
             .execute(
                 "INSERT INTO kv_store (key, value, updated_at)
@@ -66,11 +136,94 @@ impl KvStore {
                 (key, serialized.as_str()),
             )
             .await?;
+        if let Some(cache) = &self.cache {
+            cache.invalidate([key]);
+        }
         Ok(())
     }
 
+    /// Set several key-value pairs in one transaction
+    pub async fn set_many<K: AsRef<str>, V: Serialize>(&self, entries: &[(K, V)]) -> Result<()> {
+        let serialized = entries
+            .iter()
+            .map(|(key, value)| Ok((key.as_ref(), serde_json::to_string(value)?)))
+            .collect::<Result<Vec<_>>>()?;
+        if serialized.is_empty() {
+            return Ok(());
+        }
+
+        let _writer = self.writer.lock().await?;
+        self.conn
+            .prepare_cached("BEGIN IMMEDIATE")
+            .await?
+            .execute(())
+            .await?;
+        let result: Result<()> = async {
+            let mut stmt = self
+                .conn
+                .prepare_cached(
+                    "INSERT INTO kv_store (key, value, updated_at)
+                    VALUES (?, ?, unixepoch())
+                    ON CONFLICT(key) DO UPDATE SET
+                        value = excluded.value,
+                        updated_at = unixepoch()",
+                )
+                .await?;
+            for (key, value) in &serialized {
+                stmt.execute((*key, value.as_str())).await?;
+            }
+            Ok(())
+        }
+        .await;
+        self.finish_transaction(result).await?;
+
+        if let Some(cache) = &self.cache {
+            cache.invalidate(serialized.iter().map(|(key, _)| *key));
+        }
+        Ok(())
+    }
+
+    /// Commit if `result` is Ok, roll back otherwise
+    async fn finish_transaction(&self, result: Result<()>) -> Result<()> {
+        match result {
+            Ok(()) => {
+                self.conn
+                    .prepare_cached("COMMIT")
+                    .await?
+                    .execute(())
+                    .await?;
+                Ok(())
+            }
+            Err(e) => {
+                let _ = self
+                    .conn
+                    .prepare_cached("ROLLBACK")
+                    .await?
+                    .execute(())
+                    .await;
+                Err(e)
+            }
+        }
+    }
+
     /// Get a value by key
     pub async fn get<V: for<'de> Deserialize<'de>>(&self, key: &str) -> Result<Option<V>> {
+        if let Some(cache) = &self.cache {
+            let serialized = match cache.values.get(key) {
+                Some(serialized) => serialized,
+                None => {
+                    let generation = cache.generation();
+                    let serialized = self.get_serialized(key).await?.map(Arc::from);
+                    cache.fill(generation, key, serialized.clone());
+                    serialized
+                }
+            };
+            return match serialized {
+                Some(serialized) => Ok(Some(serde_json::from_str(&serialized)?)),
+                None => Ok(None),
+            };
+        }
+
         let mut rows = self
             .conn
             .query("SELECT value FROM kv_store WHERE key = ?", (key,))
@@ -94,14 +247,166 @@ impl KvStore {
         }
     }
 
+    /// Get the stored JSON of a key
+    async fn get_serialized(&self, key: &str) -> Result<Option<String>> {
+        let mut stmt = self
+            .conn
+            .prepare_cached("SELECT value FROM kv_store WHERE key = ?")
+            .await?;
+        let mut rows = stmt.query((key,)).await?;
+        match rows.next().await? {
+            Some(row) => match row.get_value(0)? {
+                Value::Text(s) => Ok(Some(s)),
+                _ => Err(Error::Internal(format!("invalid value for key {}", key))),
+            },
+            None => Ok(None),
+        }
+    }
+
+    /// Get the values of several keys, in the order of `keys`
+    ///
+    /// Keys are looked up with one query per 256 keys instead of one each.
+    pub async fn get_many<K: AsRef<str>, V: for<'de> Deserialize<'de>>(
+        &self,
+        keys: &[K],
+    ) -> Result<Vec<Option<V>>> {
+        let mut found: HashMap<&str, Option<Arc<str>>> = HashMap::with_capacity(keys.len());
+        let mut missing = Vec::new();
+        for key in keys {
+            let key = key.as_ref();
+            match self.cache.as_ref().and_then(|cache| cache.values.get(key)) {
+                Some(serialized) => {
+                    found.insert(key, serialized);
+                }
+                None => missing.push(key),
+            }
+        }
+        missing.sort_unstable();
+        missing.dedup();
+
+        let generation = self.cache.as_ref().map(|cache| cache.generation());
+        for batch in missing.chunks(KEYS_PER_STATEMENT) {
+            let sql = format!(
+                "SELECT key, value FROM kv_store WHERE key IN ({})",
+                vec!["?"; batch.len()].join(", ")
+            );
+            let params: Vec<Value> = batch.iter().map(|k| Value::Text(k.to_string())).collect();
+            let mut rows = self.conn.query(&sql, params).await?;
+            let mut stored = HashMap::new();
+            while let Some(row) = rows.next().await? {
+                if let (Ok(Value::Text(key)), Ok(Value::Text(value))) =
+                    (row.get_value(0), row.get_value(1))
+                {
+                    stored.insert(key, Arc::<str>::from(value));
+                }
+            }
+            for &key in batch {
+                let serialized = stored.remove(key);
+                if let (Some(cache), Some(generation)) = (&self.cache, generation) {
+                    cache.fill(generation, key, serialized.clone());
+                }
+                found.insert(key, serialized);
+            }
+        }
+
+        keys.iter()
+            .map(|key| match found.get(key.as_ref()) {
+                Some(Some(serialized)) => Ok(Some(serde_json::from_str(serialized)?)),
+                _ => Ok(None),
+            })
+            .collect()
+    }
+
     /// Delete a key
     pub async fn delete(&self, key: &str) -> Result<()> {
+        let _writer = self.writer.lock().await?;
         self.conn
             .execute("DELETE FROM kv_store WHERE key = ?", (key,))
             .await?;
+        if let Some(cache) = &self.cache {
+            cache.invalidate([key]);
+        }
         Ok(())
     }
 
+    /// Delete several keys in one transaction
+    pub async fn delete_many<K: AsRef<str>>(&self, keys: &[K]) -> Result<()> {
+        if keys.is_empty() {
+            return Ok(());
+        }
+
+        let _writer = self.writer.lock().await?;
+        self.conn
+            .prepare_cached("BEGIN IMMEDIATE")
+            .await?
+            .execute(())
+            .await?;
+        let result: Result<()> = async {
+            for batch in keys.chunks(KEYS_PER_STATEMENT) {
+                let sql = format!(
+                    "DELETE FROM kv_store WHERE key IN ({})",
+                    vec!["?"; batch.len()].join(", ")
+                );
+                let params: Vec<Value> = batch
+                    .iter()
+                    .map(|k| Value::Text(k.as_ref().to_string()))
+                    .collect();
+                self.conn.execute(&sql, params).await?;
+            }
+            Ok(())
+        }
+        .await;
+        self.finish_transaction(result).await?;
+
+        if let Some(cache) = &self.cache {
+            cache.invalidate(keys.iter().map(|k| k.as_ref()));
+        }
+        Ok(())
+    }
+
+    /// List entries whose key starts with `prefix`, in key order
+    ///
+    /// Returns at most `limit` entries with keys after `after`; pass the last
+    /// key of one page as `after` to get the next. Each page is a range scan
+    /// of the primary key.
+    pub async fn scan<V: for<'de> Deserialize<'de>>(
+        &self,
+        prefix: &str,
+        after: Option<&str>,
+        limit: usize,
+    ) -> Result<Vec<(String, V)>> {
+        let upper = prefix_upper_bound(prefix);
+        let mut stmt = self
+            .conn
+            .prepare_cached(
+                "SELECT key, value FROM kv_store
+                WHERE key >= ? AND (? IS NULL OR key < ?) AND (? IS NULL OR key > ?)
+                ORDER BY key
+                LIMIT ?",
+            )
+            .await?;
+        let mut rows = stmt
+            .query((
+                prefix,
+                upper.as_deref(),
+                upper.as_deref(),
+                after,
+                after,
+                limit as i64,
+            ))
+            .await?;
+
+        let mut entries = Vec::new();
+        while let Some(row) = rows.next().await? {
+            if let (Ok(Value::Text(key)), Ok(Value::Text(value))) =
+                (row.get_value(0), row.get_value(1))
+            {
+                entries.push((key, serde_json::from_str(&value)?));
+            }
+        }
+        Ok(entries)
+    }
+
     /// List all keys
     pub async fn keys(&self) -> Result<Vec<String>> {
         let mut rows = self.conn.query("SELECT key FROM kv_store", ()).await?;
@@ -120,3 +425,65 @@ impl KvStore {
         Ok(keys)
     }
 }
+
+/// Smallest string greater than every string that starts with `prefix`, or
+/// `None` if there is none (the prefix is empty or all `char::MAX`)
+///
+/// SQLite compares text as UTF-8 bytes, which orders like code points, so
+/// bumping the last character that can be bumped gives the bound.
+fn prefix_upper_bound(prefix: &str) -> Option<String> {
+    let mut chars: Vec<char> = prefix.chars().collect();
+    while let Some(last) = chars.pop() {
+        let next = (last as u32 + 1..=char::MAX as u32).find_map(char::from_u32);
+        if let Some(next) = next {
+            chars.push(next);
+            return Some(chars.into_iter().collect());
+        }
+    }
+    None
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_prefix_upper_bound() {
+        assert_eq!(prefix_upper_bound("user:"), Some("user;".to_string()));
+        assert_eq!(
+            prefix_upper_bound("a\u{d7ff}"),
+            Some("a\u{e000}".to_string())
+        );
+        assert_eq!(prefix_upper_bound("a\u{10ffff}"), Some("b".to_string()));
+        assert_eq!(prefix_upper_bound("\u{10ffff}"), None);
+        assert_eq!(prefix_upper_bound(""), None);
+    }
+
+    #[tokio::test]
+    async fn test_batched_operations() {
+        let kv = KvStore::new(":memory:").await.unwrap().with_cache(64);
+        kv.set_many(&[("step:1", 1), ("step:2", 2), ("step:3", 3), ("other", 0)])
+            .await
+            .unwrap();
+
+        let values: Vec<Option<i64>> = kv
+            .get_many(&["step:2", "missing", "step:1", "step:2"])
+            .await
+            .unwrap();
+        assert_eq!(values, [Some(2), None, Some(1), Some(2)]);
+
+        // Cached, including the miss, and kept coherent by writes
+        kv.set("missing", &5).await.unwrap();
+        kv.delete_many(&["step:1"]).await.unwrap();
+        let values: Vec<Option<i64>> = kv.get_many(&["step:1", "missing"]).await.unwrap();
+        assert_eq!(values, [None, Some(5)]);
+        assert_eq!(kv.get::<i64>("step:2").await.unwrap(), Some(2));
+
+        let page: Vec<(String, i64)> = kv.scan("step:", None, 1).await.unwrap();
+        assert_eq!(page, [("step:2".to_string(), 2)]);
+        let page: Vec<(String, i64)> = kv.scan("step:", Some("step:2"), 10).await.unwrap();
+        assert_eq!(page, [("step:3".to_string(), 3)]);
+        let all: Vec<(String, i64)> = kv.scan("", None, 10).await.unwrap();
+        assert_eq!(all.len(), 4);
+    }
+}
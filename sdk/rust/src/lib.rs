@@ -1,11 +1,12 @@
 pub mod error;
 pub mod filesystem;
 pub mod kvstore;
+pub mod metrics;
 pub mod toolcalls;
 
 use error::{Error, Result};
 use std::{
-    collections::{HashSet, VecDeque},
+    collections::{HashMap, HashSet, VecDeque},
     path::{Path, PathBuf},
     sync::Arc,
 };
@@ -15,11 +16,15 @@ use turso::{Builder, Connection, Value};
 #[cfg(unix)]
 pub use filesystem::HostFS;
 pub use filesystem::{
-    BoxedFile, DirEntry, File, FileSystem, FilesystemStats, FsError, OverlayFS, Stats,
-    DEFAULT_DIR_MODE, DEFAULT_FILE_MODE, S_IFDIR, S_IFLNK, S_IFMT, S_IFREG,
+    BoxedDirStream, BoxedFile, Compression, DirEntry, DirStream, File, FileSystem, FilesystemStats,
+    FsError, OverlayFS, Stats, DEFAULT_DIR_MODE, DEFAULT_FILE_MODE, DEFAULT_WRITE_BUFFER_BYTES,
+    DIR_STREAM_BATCH, ROOT_INO, S_IFDIR, S_IFLNK, S_IFMT, S_IFREG,
 };
 pub use kvstore::KvStore;
-pub use toolcalls::{ToolCall, ToolCallStats, ToolCallStatus, ToolCalls};
+pub use toolcalls::{
+    DurationBucket, TimelineCursor, TimelineFilter, ToolCall, ToolCallStats, ToolCallStatus,
+    ToolCalls,
+};
 
 /// Directory containing agentfs databases
 pub fn agentfs_dir() -> &'static std::path::Path {
@@ -86,6 +91,34 @@ pub struct AgentFSOptions {
     /// Optional base directory for overlay filesystem (copy-on-write).
     /// When set, the filesystem operates as an overlay on top of this directory.
     pub base: Option<PathBuf>,
+    /// Optional parent database to fork from.
+    /// The new database starts out empty and only stores what the fork
+    /// changes on top of the parent's filesystem, which it reads but never
+    /// writes (see [`AgentFS::parent_filesystem`]). Excludes `base`.
+    pub parent: Option<PathBuf>,
+    /// Number of read-only connections the filesystem spreads reads across.
+    /// Defaults to [`filesystem::agentfs::DEFAULT_READER_CONNECTIONS`]; `Some(0)`
+    /// serves reads from the writer connection. Ignored for in-memory databases.
+    pub readers: Option<usize>,
+    /// Store identical file chunks once (see [`filesystem::AgentFS::init_dedup`]).
+    /// Only takes effect on a filesystem without file data; the mode then
+    /// sticks for every later open.
+    pub dedup: bool,
+    /// Compress chunks written from now on (see
+    /// [`filesystem::AgentFS::init_compression`]). Recorded in the database,
+    /// so it also applies to later opens without this option.
+    pub compression: Option<Compression>,
+    /// Store large files in extents (see [`filesystem::AgentFS::init_extents`]).
+    /// Recorded in the database, so it also applies to later opens without
+    /// this option.
+    pub extents: bool,
+    /// Queue tool call records and write them in batches from a background
+    /// thread (see [`ToolCalls::from_connection_buffered`]). Ignored for
+    /// in-memory databases.
+    pub buffered_tool_calls: bool,
+    /// Cache up to this many key-value entries in memory (see
+    /// [`KvStore::with_cache`]).
+    pub kv_cache: Option<usize>,
 }
 
 impl AgentFSOptions {
@@ -125,6 +158,13 @@ impl AgentFSOptions {
             id: Some(id.into()),
             path: None,
             base: None,
+            parent: None,
+            readers: None,
+            dedup: false,
+            compression: None,
+            extents: false,
+            buffered_tool_calls: false,
+            kv_cache: None,
         }
     }
 
@@ -134,6 +174,13 @@ impl AgentFSOptions {
             id: None,
             path: None,
             base: None,
+            parent: None,
+            readers: None,
+            dedup: false,
+            compression: None,
+            extents: false,
+            buffered_tool_calls: false,
+            kv_cache: None,
         }
     }
 
@@ -143,6 +190,13 @@ impl AgentFSOptions {
             id: None,
             path: Some(path.into()),
             base: None,
+            parent: None,
+            readers: None,
+            dedup: false,
+            compression: None,
+            extents: false,
+            buffered_tool_calls: false,
+            kv_cache: None,
         }
     }
 
@@ -152,6 +206,48 @@ impl AgentFSOptions {
         self
     }
 
+    /// Fork from the database at `parent` instead of starting empty
+    pub fn with_parent(mut self, parent: impl Into<PathBuf>) -> Self {
+        self.parent = Some(parent.into());
+        self
+    }
+
+    /// Set the number of read-only connections used by the filesystem
+    pub fn with_readers(mut self, readers: usize) -> Self {
+        self.readers = Some(readers);
+        self
+    }
+
+    /// Enable content-addressed chunk deduplication
+    pub fn with_dedup(mut self) -> Self {
+        self.dedup = true;
+        self
+    }
+
+    /// Enable chunk compression with the given codec
+    pub fn with_compression(mut self, compression: Compression) -> Self {
+        self.compression = Some(compression);
+        self
+    }
+
+    /// Store large files in extents
+    pub fn with_extents(mut self) -> Self {
+        self.extents = true;
+        self
+    }
+
+    /// Write tool call records in the background
+    pub fn with_buffered_tool_calls(mut self) -> Self {
+        self.buffered_tool_calls = true;
+        self
+    }
+
+    /// Cache up to `capacity` key-value entries in memory
+    pub fn with_kv_cache(mut self, capacity: usize) -> Self {
+        self.kv_cache = Some(capacity);
+        self
+    }
+
     /// Resolve an id-or-path string to AgentFSOptions
     ///
     /// Resolution order (first match wins):
@@ -236,6 +332,16 @@ impl AgentFS {
                 return Err(Error::NotADirectory(path.display().to_string()));
             }
         }
+        if let Some(ref path) = options.parent {
+            if options.base.is_some() {
+                return Err(Error::InvalidFork(
+                    "a fork takes its base layer from the parent".to_string(),
+                ));
+            }
+            if !path.is_file() {
+                return Err(Error::ParentNotFound(path.display().to_string()));
+            }
+        }
         let db_path = options.db_path()?;
         let db = Builder::new_local(&db_path).build().await?;
         let conn = db.connect()?;
@@ -246,15 +352,64 @@ impl AgentFS {
             let base_path_str = canonical_base.to_string_lossy().to_string();
             OverlayFS::init_schema(&conn, &base_path_str).await?;
         }
+        // A fork only records its parent, whatever the parent's size
+        if let Some(parent_path) = options.parent {
+            let canonical_parent = std::fs::canonicalize(parent_path)?;
+            let parent_path_str = canonical_parent.to_string_lossy().to_string();
+            OverlayFS::init_fork_schema(&conn, &parent_path_str).await?;
+        }
+
+        if options.dedup {
+            filesystem::AgentFS::init_dedup(&conn).await?;
+        }
+        if let Some(compression) = options.compression {
+            filesystem::AgentFS::init_compression(&conn, compression).await?;
+        }
+        if options.extents {
+            filesystem::AgentFS::init_extents(&conn).await?;
+        }
+
+        // In-memory databases have no WAL for readers to snapshot, so they
+        // stay on a single connection.
+        let readers = if db_path == ":memory:" {
+            0
+        } else {
+            options
+                .readers
+                .unwrap_or(filesystem::agentfs::DEFAULT_READER_CONNECTIONS)
+        };
+
+        let conn = Arc::new(conn);
+        let fs = filesystem::AgentFS::from_database(&db, conn.clone(), readers).await?;
+        let mut kv = KvStore::from_connection(conn.clone())
+            .await?
+            .with_writer(fs.writer().clone());
+        if let Some(capacity) = options.kv_cache {
+            kv = kv.with_cache(capacity);
+        }
+        // The background writer needs a connection of its own, which an
+        // in-memory database cannot share.
+        let tools = if options.buffered_tool_calls && db_path != ":memory:" {
+            ToolCalls::from_connection_buffered(conn.clone(), db.connect()?).await?
+        } else {
+            ToolCalls::from_connection(conn.clone()).await?
+        };
 
-        Self::open_with(conn).await
+        Ok(Self {
+            conn,
+            kv,
+            fs,
+            tools,
+        })
     }
 
     pub async fn open_with(conn: Connection) -> Result<Self> {
         let conn = Arc::new(conn);
 
-        let kv = KvStore::from_connection(conn.clone()).await?;
         let fs = filesystem::AgentFS::from_connection(conn.clone()).await?;
+        let kv = KvStore::from_connection(conn.clone())
+            .await?
+            .with_writer(fs.writer().clone());
         let tools = ToolCalls::from_connection(conn.clone()).await?;
 
         Ok(Self {
@@ -278,8 +433,10 @@ impl AgentFS {
         let conn = db.connect()?;
         let conn = Arc::new(conn);
 
-        let kv = KvStore::from_connection(conn.clone()).await?;
         let fs = filesystem::AgentFS::from_connection(conn.clone()).await?;
+        let kv = KvStore::from_connection(conn.clone())
+            .await?
+            .with_writer(fs.writer().clone());
         let tools = ToolCalls::from_connection(conn.clone()).await?;
 
         Ok(Self {
@@ -299,58 +456,69 @@ impl AgentFS {
     ///
     /// This returns all file and directory paths that exist in the overlay's
     /// delta layer, which represents files that have been added or modified.
+    ///
+    /// Reads all dentries in a single query and joins them into paths in
+    /// memory, instead of querying once per directory.
     pub async fn get_delta_paths(&self) -> Result<HashSet<String>> {
         const ROOT_INO: i64 = 1;
 
-        let mut paths = HashSet::new();
-        let mut queue: VecDeque<(i64, String)> = VecDeque::new();
-        queue.push_back((ROOT_INO, String::new()));
+        // parent_ino -> (name, ino, is_dir) of its entries
+        let mut children: HashMap<i64, Vec<(String, i64, bool)>> = HashMap::new();
+        let mut rows = self
+            .conn
+            .query(
+                "SELECT d.parent_ino, d.name, d.ino, i.mode FROM fs_dentry d
+                 JOIN fs_inode i ON d.ino = i.ino",
+                (),
+            )
+            .await?;
 
-        while let Some((parent_ino, prefix)) = queue.pop_front() {
-            let query = format!(
-                "SELECT d.name, d.ino, i.mode FROM fs_dentry d
-                 JOIN fs_inode i ON d.ino = i.ino
-                 WHERE d.parent_ino = {}
-                 ORDER BY d.name",
-                parent_ino
-            );
+        while let Some(row) = rows.next().await? {
+            let parent_ino: i64 = row
+                .get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0);
 
-            let mut rows = self.conn.query(&query, ()).await?;
+            let name: String = row
+                .get_value(1)
+                .ok()
+                .and_then(|v| {
+                    if let Value::Text(s) = v {
+                        Some(s.clone())
+                    } else {
+                        None
+                    }
+                })
+                .unwrap_or_default();
 
-            while let Some(row) = rows.next().await? {
-                let name: String = row
-                    .get_value(0)
-                    .ok()
-                    .and_then(|v| {
-                        if let Value::Text(s) = v {
-                            Some(s.clone())
-                        } else {
-                            None
-                        }
-                    })
-                    .unwrap_or_default();
+            let ino: i64 = row
+                .get_value(2)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0);
 
-                let ino: i64 = row
-                    .get_value(1)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0);
+            let mode: u32 = row
+                .get_value(3)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0) as u32;
 
-                let mode: u32 = row
-                    .get_value(2)
-                    .ok()
-                    .and_then(|v| v.as_integer().copied())
-                    .unwrap_or(0) as u32;
+            children
+                .entry(parent_ino)
+                .or_default()
+                .push((name, ino, mode & S_IFMT == S_IFDIR));
+        }
 
-                let full_path = if prefix.is_empty() {
-                    format!("/{}", name)
-                } else {
-                    format!("{}/{}", prefix, name)
-                };
+        // Walk from the root so entries of unreachable inodes are skipped
+        let mut paths = HashSet::new();
+        let mut queue: VecDeque<(i64, String)> = VecDeque::new();
+        queue.push_back((ROOT_INO, String::new()));
 
+        while let Some((parent_ino, prefix)) = queue.pop_front() {
+            for (name, ino, is_dir) in children.remove(&parent_ino).unwrap_or_default() {
+                let full_path = format!("{}/{}", prefix, name);
                 paths.insert(full_path.clone());
-
-                let is_dir = mode & S_IFMT == S_IFDIR;
                 if is_dir {
                     queue.push_back((ino, full_path));
                 }
@@ -453,36 +621,120 @@ impl AgentFS {
     ///
     /// Returns the base path if overlay is enabled, None otherwise.
     pub async fn is_overlay_enabled(&self) -> Result<Option<String>> {
-        // Check if fs_overlay_config table exists and has base_path
-        let result = self
-            .conn
-            .query(
-                "SELECT value FROM fs_overlay_config WHERE key = 'base_path'",
-                (),
+        self.overlay_config("base_path").await
+    }
+
+    /// Path of the database this filesystem was forked from, if any
+    pub async fn fork_parent(&self) -> Result<Option<String>> {
+        self.overlay_config("parent_path").await
+    }
+
+    /// Open the filesystem a forked session sits on
+    ///
+    /// Returns None unless this database was created with
+    /// [`AgentFSOptions::with_parent`]. Otherwise the result is the parent's
+    /// filesystem as it presents itself: the parent database, an overlay over
+    /// its base directory, or an overlay over its own parent for forks of
+    /// forks. Mount the fork as an [`OverlayFS`] over it:
+    ///
+    /// ```no_run
+    /// use std::sync::Arc;
+    /// use agentfs_sdk::{AgentFS, AgentFSOptions, OverlayFS};
+    ///
+    /// # async fn example() -> agentfs_sdk::error::Result<()> {
+    /// let options = AgentFSOptions::with_id("attempt-1").with_parent(".agentfs/prepared.db");
+    /// let fork = AgentFS::open(options).await?;
+    /// let parent = fork.parent_filesystem().await?.unwrap();
+    /// let fs = OverlayFS::new(parent, fork.fs);
+    /// # Ok(())
+    /// # }
+    /// ```
+    ///
+    /// The layers below the fork are opened read-only, without touching
+    /// their schema, so any number of forks can share them. Changing the parent afterwards shows through in its forks.
+    pub async fn parent_filesystem(&self) -> Result<Option<Arc<dyn FileSystem>>> {
+        let Some(mut path) = self.fork_parent().await? else {
+            return Ok(None);
+        };
+
+        // Walk up to the oldest ancestor, opening every database on the way
+        let mut layers = Vec::new();
+        let mut seen = HashSet::new();
+        let base_path = loop {
+            if !seen.insert(path.clone()) {
+                return Err(Error::InvalidFork(format!("{} is its own ancestor", path)));
+            }
+            if !Path::new(&path).is_file() {
+                return Err(Error::ParentNotFound(path));
+            }
+            let db = Builder::new_local(&path).build().await?;
+            let ancestor = filesystem::AgentFS::open_read_only(
+                &db,
+                filesystem::agentfs::DEFAULT_READER_CONNECTIONS,
             )
-            .await;
-
-        match result {
-            Ok(mut rows) => {
-                if let Some(row) = rows.next().await? {
-                    let base_path: String = row
-                        .get_value(0)
-                        .ok()
-                        .and_then(|v| {
-                            if let Value::Text(s) = v {
-                                Some(s.clone())
-                            } else {
-                                None
-                            }
-                        })
-                        .unwrap_or_default();
-                    Ok(Some(base_path))
-                } else {
-                    Ok(None)
-                }
+            .await?;
+            let conn = ancestor.get_connection();
+            let next = overlay_config(&conn, "parent_path").await?;
+            let base_path = overlay_config(&conn, "base_path").await?;
+            layers.push(ancestor);
+            match next {
+                Some(next) => path = next,
+                None => break base_path,
+            }
+        };
+
+        let root = layers.pop().expect("at least one ancestor");
+        let mut fs: Arc<dyn FileSystem> = match base_path {
+            #[cfg(unix)]
+            Some(base_path) => Arc::new(OverlayFS::new(Arc::new(HostFS::new(base_path)?), root)),
+            #[cfg(not(unix))]
+            Some(base_path) => {
+                return Err(Error::InvalidFork(format!(
+                    "the base directory {} of {} needs a host filesystem",
+                    base_path, path
+                )))
             }
-            Err(_) => Ok(None), // Table doesn't exist
+            None => Arc::new(root),
+        };
+        while let Some(layer) = layers.pop() {
+            fs = Arc::new(OverlayFS::new(fs, layer));
         }
+        Ok(Some(fs))
+    }
+
+    /// Read a value from the overlay configuration, if the table exists
+    async fn overlay_config(&self, key: &str) -> Result<Option<String>> {
+        overlay_config(&self.conn, key).await
+    }
+}
+
+/// Read a value from the overlay configuration of the database behind `conn`,
+/// if the table exists
+async fn overlay_config(conn: &Connection, key: &str) -> Result<Option<String>> {
+    let result = conn
+        .query("SELECT value FROM fs_overlay_config WHERE key = ?", (key,))
+        .await;
+
+    match result {
+        Ok(mut rows) => {
+            if let Some(row) = rows.next().await? {
+                let value: String = row
+                    .get_value(0)
+                    .ok()
+                    .and_then(|v| {
+                        if let Value::Text(s) = v {
+                            Some(s.clone())
+                        } else {
+                            None
+                        }
+                    })
+                    .unwrap_or_default();
+                Ok(Some(value))
+            } else {
+                Ok(None)
+            }
+        }
+        Err(_) => Ok(None), // Table doesn't exist
     }
 }
 
@@ -593,6 +845,123 @@ mod tests {
         let stats = agentfs.tools.stats_for("test_tool").await.unwrap().unwrap();
         assert_eq!(stats.total_calls, 1);
         assert_eq!(stats.successful, 1);
+        assert_eq!(stats.histogram.len(), 1);
+    }
+
+    #[tokio::test]
+    async fn test_buffered_tool_calls() {
+        let dir = tempfile::tempdir().unwrap();
+        let db_path = dir.path().join("buffered.db");
+        let db_path = db_path.to_str().unwrap();
+
+        let agentfs = AgentFS::open(AgentFSOptions::with_path(db_path).with_buffered_tool_calls())
+            .await
+            .unwrap();
+        let first = agentfs.tools.start("read", None).await.unwrap();
+        let second = agentfs.tools.start("read", None).await.unwrap();
+        assert_eq!(second, first + 1);
+        agentfs.tools.success(first, None).await.unwrap();
+        agentfs.tools.error(second, "boom").await.unwrap();
+        agentfs
+            .tools
+            .record("write", 10, 12, None, None, None)
+            .await
+            .unwrap();
+
+        // Reads through the tracker see queued calls
+        let call = agentfs.tools.get(second).await.unwrap().unwrap();
+        assert_eq!(call.status, ToolCallStatus::Error);
+        assert_eq!(call.error.as_deref(), Some("boom"));
+        let stats = agentfs.tools.stats_for("write").await.unwrap().unwrap();
+        assert_eq!(stats.total_calls, 1);
+        assert_eq!(stats.p50_duration_ms, 2000.0);
+
+        // Completing a call that was flushed already updates its row
+        let third = agentfs.tools.start("read", None).await.unwrap();
+        agentfs.tools.flush().await.unwrap();
+        agentfs.tools.success(third, None).await.unwrap();
+        let pending = agentfs.tools.start("read", None).await.unwrap();
+        drop(agentfs);
+
+        // Dropping the tracker flushed the rest
+        let agentfs = AgentFS::open(AgentFSOptions::with_path(db_path))
+            .await
+            .unwrap();
+        let third = agentfs.tools.get(third).await.unwrap().unwrap();
+        assert_eq!(third.status, ToolCallStatus::Success);
+        let pending = agentfs.tools.get(pending).await.unwrap().unwrap();
+        assert_eq!(pending.status, ToolCallStatus::Pending);
+        let stats = agentfs.tools.stats_for("read").await.unwrap().unwrap();
+        assert_eq!(stats.total_calls, 4);
+        assert_eq!(stats.failed, 1);
+    }
+
+    #[tokio::test]
+    async fn test_fork() {
+        let dir = tempfile::tempdir().unwrap();
+        let parent_path = dir.path().join("parent.db");
+        let parent = AgentFS::open(AgentFSOptions::with_path(parent_path.to_str().unwrap()))
+            .await
+            .unwrap();
+        parent.fs.mkdir("/src").await.unwrap();
+        parent
+            .fs
+            .write_file("/src/main.rs", b"fn main() {}")
+            .await
+            .unwrap();
+        parent.fs.write_file("/README", b"parent").await.unwrap();
+        drop(parent);
+
+        // A fork of a fork sees every layer below it
+        let mut forks = Vec::new();
+        let mut from = parent_path.clone();
+        for name in ["fork.db", "grandchild.db"] {
+            let path = dir.path().join(name);
+            let fork =
+                AgentFS::open(AgentFSOptions::with_path(path.to_str().unwrap()).with_parent(&from))
+                    .await
+                    .unwrap();
+            assert_eq!(
+                fork.fork_parent().await.unwrap().as_deref(),
+                Some(std::fs::canonicalize(&from).unwrap().to_str().unwrap())
+            );
+            assert_eq!(fork.is_overlay_enabled().await.unwrap(), None);
+
+            let base = fork.parent_filesystem().await.unwrap().unwrap();
+            let fs = OverlayFS::new(base, fork.fs);
+            let file = fs.open("/README").await.unwrap();
+            assert_eq!(file.pread(0, 64).await.unwrap(), b"parent");
+            file.pwrite(0, name.as_bytes()).await.unwrap();
+            file.fsync().await.unwrap();
+            forks.push(fs);
+            from = path;
+        }
+
+        // Every fork keeps its own changes, and the parent has none of them
+        let fs = &forks[0];
+        let file = fs.open("/README").await.unwrap();
+        assert_eq!(file.pread(0, 64).await.unwrap(), b"fork.db");
+        let parent = AgentFS::open(AgentFSOptions::with_path(parent_path.to_str().unwrap()))
+            .await
+            .unwrap();
+        assert_eq!(
+            parent.fs.read_file("/README").await.unwrap().unwrap(),
+            b"parent"
+        );
+        let src = forks[1].lookup(ROOT_INO, "src").await.unwrap().unwrap();
+        assert!(forks[1].lookup(src.ino, "main.rs").await.unwrap().is_some());
+    }
+
+    #[tokio::test]
+    async fn test_fork_rejects_missing_parent() {
+        let dir = tempfile::tempdir().unwrap();
+        let path = dir.path().join("fork.db");
+        let result = AgentFS::open(
+            AgentFSOptions::with_path(path.to_str().unwrap())
+                .with_parent(dir.path().join("none.db")),
+        )
+        .await;
+        assert!(matches!(result, Err(Error::ParentNotFound(_))));
     }
 
     #[test]
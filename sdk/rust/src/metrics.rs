@@ -0,0 +1,421 @@
+//! Process-wide filesystem metrics.
+//!
+//! Operation latencies, cache hit counters and write counters are kept in
+//! atomics that the filesystems update as they run, so recording costs a
+//! clock read and a few relaxed additions. They cover every filesystem in
+//! the process. Read them with [`snapshot`], or with [`render_prometheus`]
+//! in the Prometheus text exposition format.
+
+use serde::Serialize;
+use std::fmt::Write;
+use std::sync::atomic::{AtomicU64, Ordering};
+use std::time::Instant;
+
+/// Filesystem operations whose latency is recorded
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Op {
+    /// Looking up a name in a directory
+    Lookup,
+    /// Getting the attributes of a path or inode
+    Getattr,
+    /// Reading from an open file
+    Read,
+    /// Writing to an open file
+    Write,
+    /// Listing a directory
+    Readdir,
+    /// Syncing an open file to storage
+    Fsync,
+}
+
+impl Op {
+    const ALL: [Op; 6] = [
+        Op::Lookup,
+        Op::Getattr,
+        Op::Read,
+        Op::Write,
+        Op::Readdir,
+        Op::Fsync,
+    ];
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Op::Lookup => "lookup",
+            Op::Getattr => "getattr",
+            Op::Read => "read",
+            Op::Write => "write",
+            Op::Readdir => "readdir",
+            Op::Fsync => "fsync",
+        }
+    }
+}
+
+/// Filesystem layer an operation ran against
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Layer {
+    /// The host filesystem (`HostFS`), the base of an overlay
+    Base,
+    /// The database (`AgentFS`), the delta of an overlay or the whole
+    /// filesystem when used on its own
+    Delta,
+}
+
+impl Layer {
+    const ALL: [Layer; 2] = [Layer::Base, Layer::Delta];
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Layer::Base => "base",
+            Layer::Delta => "delta",
+        }
+    }
+}
+
+/// Caches with hit and miss counters
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum Cache {
+    /// Names resolved to inodes in the database
+    Dentry,
+    /// Names known not to exist in the database, checked after a dentry miss
+    NegativeDentry,
+    /// Inode attributes read from the database
+    Attr,
+    /// File data prefetched by sequential reads
+    Readahead,
+    /// Metadata and listings of the host filesystem
+    HostMetadata,
+    /// Overlay whiteouts; a miss loads a directory's whiteouts
+    Whiteout,
+    /// Overlay directories known to exist in the delta layer
+    DeltaDir,
+}
+
+impl Cache {
+    const ALL: [Cache; 7] = [
+        Cache::Dentry,
+        Cache::NegativeDentry,
+        Cache::Attr,
+        Cache::Readahead,
+        Cache::HostMetadata,
+        Cache::Whiteout,
+        Cache::DeltaDir,
+    ];
+
+    pub fn name(self) -> &'static str {
+        match self {
+            Cache::Dentry => "dentry",
+            Cache::NegativeDentry => "negative_dentry",
+            Cache::Attr => "attr",
+            Cache::Readahead => "readahead",
+            Cache::HostMetadata => "host_metadata",
+            Cache::Whiteout => "whiteout",
+            Cache::DeltaDir => "delta_dir",
+        }
+    }
+}
+
+/// Upper bounds of the latency buckets, in microseconds
+const BUCKET_BOUNDS_US: [u64; 12] = [
+    10, 50, 100, 500, 1_000, 5_000, 10_000, 50_000, 100_000, 500_000, 1_000_000, 5_000_000,
+];
+
+/// Latency histogram; the last bucket counts everything above the bounds
+struct Histogram {
+    buckets: [AtomicU64; BUCKET_BOUNDS_US.len() + 1],
+    sum_us: AtomicU64,
+}
+
+impl Histogram {
+    const fn new() -> Self {
+        Self {
+            buckets: [const { AtomicU64::new(0) }; BUCKET_BOUNDS_US.len() + 1],
+            sum_us: AtomicU64::new(0),
+        }
+    }
+
+    fn record(&self, us: u64) {
+        let bucket = BUCKET_BOUNDS_US
+            .iter()
+            .position(|&bound| us <= bound)
+            .unwrap_or(BUCKET_BOUNDS_US.len());
+        self.buckets[bucket].fetch_add(1, Ordering::Relaxed);
+        self.sum_us.fetch_add(us, Ordering::Relaxed);
+    }
+}
+
+struct CacheCounters {
+    hits: AtomicU64,
+    misses: AtomicU64,
+}
+
+struct Metrics {
+    ops: [[Histogram; Layer::ALL.len()]; Op::ALL.len()],
+    caches: [CacheCounters; Cache::ALL.len()],
+    copied_up_bytes: AtomicU64,
+    transactions: AtomicU64,
+    durable_commits: AtomicU64,
+}
+
+static METRICS: Metrics = Metrics {
+    ops: [const { [const { Histogram::new() }; Layer::ALL.len()] }; Op::ALL.len()],
+    caches: [const {
+        CacheCounters {
+            hits: AtomicU64::new(0),
+            misses: AtomicU64::new(0),
+        }
+    }; Cache::ALL.len()],
+    copied_up_bytes: AtomicU64::new(0),
+    transactions: AtomicU64::new(0),
+    durable_commits: AtomicU64::new(0),
+};
+
+/// Records the latency of an operation when dropped
+pub(crate) struct Timer {
+    op: Op,
+    layer: Layer,
+    start: Instant,
+}
+
+impl Drop for Timer {
+    fn drop(&mut self) {
+        let us = self.start.elapsed().as_micros() as u64;
+        METRICS.ops[self.op as usize][self.layer as usize].record(us);
+    }
+}
+
+/// Time an operation until the returned guard is dropped
+pub(crate) fn timer(op: Op, layer: Layer) -> Timer {
+    Timer {
+        op,
+        layer,
+        start: Instant::now(),
+    }
+}
+
+/// Count a lookup in `cache`
+pub(crate) fn cache_lookup(cache: Cache, hit: bool) {
+    let counters = &METRICS.caches[cache as usize];
+    if hit {
+        counters.hits.fetch_add(1, Ordering::Relaxed);
+    } else {
+        counters.misses.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// Count bytes copied from the base layer into the delta layer
+pub(crate) fn copied_up(bytes: u64) {
+    METRICS.copied_up_bytes.fetch_add(bytes, Ordering::Relaxed);
+}
+
+/// Count an explicit write transaction
+pub(crate) fn transaction() {
+    METRICS.transactions.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Count a durable commit made for fsync
+pub(crate) fn durable_commit() {
+    METRICS.durable_commits.fetch_add(1, Ordering::Relaxed);
+}
+
+/// Latency distribution of one operation on one layer
+#[derive(Debug, Clone, Serialize)]
+pub struct OpMetrics {
+    pub op: &'static str,
+    pub layer: &'static str,
+    pub count: u64,
+    pub total_us: u64,
+    /// Cumulative counts of operations at most `le_us` long; the last
+    /// bucket has no bound and equals `count`
+    pub buckets: Vec<LatencyBucket>,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct LatencyBucket {
+    pub le_us: Option<u64>,
+    pub count: u64,
+}
+
+#[derive(Debug, Clone, Serialize)]
+pub struct CacheMetrics {
+    pub cache: &'static str,
+    pub hits: u64,
+    pub misses: u64,
+}
+
+/// Point-in-time copy of the process-wide metrics
+#[derive(Debug, Clone, Serialize)]
+pub struct MetricsSnapshot {
+    /// Operations that ran at least once
+    pub ops: Vec<OpMetrics>,
+    pub caches: Vec<CacheMetrics>,
+    /// Bytes copied from the base layer into the delta layer
+    pub copied_up_bytes: u64,
+    /// Explicit write transactions run on the database
+    pub transactions: u64,
+    /// Durable commits run for fsync, each covering one or more requests
+    pub durable_commits: u64,
+}
+
+/// Take a snapshot of the process-wide metrics
+pub fn snapshot() -> MetricsSnapshot {
+    let mut ops = Vec::new();
+    for op in Op::ALL {
+        for layer in Layer::ALL {
+            let histogram = &METRICS.ops[op as usize][layer as usize];
+            let mut count = 0;
+            let mut buckets = Vec::with_capacity(histogram.buckets.len());
+            for (i, bucket) in histogram.buckets.iter().enumerate() {
+                count += bucket.load(Ordering::Relaxed);
+                buckets.push(LatencyBucket {
+                    le_us: BUCKET_BOUNDS_US.get(i).copied(),
+                    count,
+                });
+            }
+            if count > 0 {
+                ops.push(OpMetrics {
+                    op: op.name(),
+                    layer: layer.name(),
+                    count,
+                    total_us: histogram.sum_us.load(Ordering::Relaxed),
+                    buckets,
+                });
+            }
+        }
+    }
+
+    let caches = Cache::ALL
+        .iter()
+        .map(|&cache| {
+            let counters = &METRICS.caches[cache as usize];
+            CacheMetrics {
+                cache: cache.name(),
+                hits: counters.hits.load(Ordering::Relaxed),
+                misses: counters.misses.load(Ordering::Relaxed),
+            }
+        })
+        .collect();
+
+    MetricsSnapshot {
+        ops,
+        caches,
+        copied_up_bytes: METRICS.copied_up_bytes.load(Ordering::Relaxed),
+        transactions: METRICS.transactions.load(Ordering::Relaxed),
+        durable_commits: METRICS.durable_commits.load(Ordering::Relaxed),
+    }
+}
+
+/// Render the process-wide metrics in the Prometheus text format
+pub fn render_prometheus() -> String {
+    let snapshot = snapshot();
+    let mut out = String::new();
+
+    out.push_str("# HELP agentfs_op_duration_seconds Latency of filesystem operations.\n");
+    out.push_str("# TYPE agentfs_op_duration_seconds histogram\n");
+    for op in &snapshot.ops {
+        let labels = format!("op=\"{}\",layer=\"{}\"", op.op, op.layer);
+        for bucket in &op.buckets {
+            let le = match bucket.le_us {
+                Some(us) => format!("{}", us as f64 / 1e6),
+                None => "+Inf".to_string(),
+            };
+            let _ = writeln!(
+                out,
+                "agentfs_op_duration_seconds_bucket{{{},le=\"{}\"}} {}",
+                labels, le, bucket.count
+            );
+        }
+        let _ = writeln!(
+            out,
+            "agentfs_op_duration_seconds_sum{{{}}} {}",
+            labels,
+            op.total_us as f64 / 1e6
+        );
+        let _ = writeln!(
+            out,
+            "agentfs_op_duration_seconds_count{{{}}} {}",
+            labels, op.count
+        );
+    }
+
+    out.push_str("# HELP agentfs_cache_hits_total Lookups answered by a cache.\n");
+    out.push_str("# TYPE agentfs_cache_hits_total counter\n");
+    for cache in &snapshot.caches {
+        let _ = writeln!(
+            out,
+            "agentfs_cache_hits_total{{cache=\"{}\"}} {}",
+            cache.cache, cache.hits
+        );
+    }
+    out.push_str("# HELP agentfs_cache_misses_total Lookups a cache could not answer.\n");
+    out.push_str("# TYPE agentfs_cache_misses_total counter\n");
+    for cache in &snapshot.caches {
+        let _ = writeln!(
+            out,
+            "agentfs_cache_misses_total{{cache=\"{}\"}} {}",
+            cache.cache, cache.misses
+        );
+    }
+
+    for (name, help, value) in [
+        (
+            "agentfs_copied_up_bytes_total",
+            "Bytes copied from the base layer into the delta layer.",
+            snapshot.copied_up_bytes,
+        ),
+        (
+            "agentfs_transactions_total",
+            "Explicit write transactions run on the database.",
+            snapshot.transactions,
+        ),
+        (
+            "agentfs_durable_commits_total",
+            "Durable commits run for fsync.",
+            snapshot.durable_commits,
+        ),
+    ] {
+        let _ = writeln!(out, "# HELP {} {}", name, help);
+        let _ = writeln!(out, "# TYPE {} counter", name);
+        let _ = writeln!(out, "{} {}", name, value);
+    }
+
+    out
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_histogram_buckets() {
+        let histogram = Histogram::new();
+        histogram.record(5);
+        histogram.record(10);
+        histogram.record(700);
+        histogram.record(10_000_000);
+
+        let counts: Vec<u64> = histogram
+            .buckets
+            .iter()
+            .map(|b| b.load(Ordering::Relaxed))
+            .collect();
+        assert_eq!(counts[0], 2);
+        assert_eq!(counts[4], 1);
+        assert_eq!(counts[BUCKET_BOUNDS_US.len()], 1);
+        assert_eq!(histogram.sum_us.load(Ordering::Relaxed), 10_000_715);
+    }
+
+    #[test]
+    fn test_render_prometheus() {
+        drop(timer(Op::Fsync, Layer::Base));
+        cache_lookup(Cache::DeltaDir, true);
+
+        let text = render_prometheus();
+        assert!(text.contains("# TYPE agentfs_op_duration_seconds histogram"));
+        assert!(text.contains(
+            "agentfs_op_duration_seconds_bucket{op=\"fsync\",layer=\"base\",le=\"+Inf\"}"
+        ));
+        assert!(text.contains("agentfs_op_duration_seconds_count{op=\"fsync\",layer=\"base\"}"));
+        assert!(text.contains("agentfs_cache_hits_total{cache=\"delta_dir\"}"));
+        assert!(text.contains("agentfs_durable_commits_total"));
+    }
+}
@@ -1,12 +1,31 @@
 use crate::error::{Error, Result};
 use serde::{Deserialize, Serialize};
 use std::{
+    collections::{BTreeMap, HashMap, HashSet},
     fmt,
-    sync::Arc,
-    time::{SystemTime, UNIX_EPOCH},
+    sync::{
+        atomic::{AtomicI64, Ordering},
+        mpsc, Arc, Mutex,
+    },
+    thread::JoinHandle,
+    time::{Duration, Instant, SystemTime, UNIX_EPOCH},
 };
+use tokio::sync::oneshot;
 use turso::{Builder, Connection, Value};
 
+/// How long the buffered writer lets events accumulate before flushing
+const AUDIT_FLUSH_INTERVAL: Duration = Duration::from_millis(50);
+
+/// Queued events that trigger a flush without waiting for the interval
+const AUDIT_FLUSH_EVENTS: usize = 256;
+
+/// Rows per multi-row INSERT when flushing
+const AUDIT_ROWS_PER_INSERT: usize = 64;
+
+/// Started calls whose name and start time are kept in memory; past this,
+/// those already stored are looked up in the database on completion
+const AUDIT_PENDING_MAX: usize = 4096;
+
 /// Status of a tool call
 #[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
 #[serde(rename_all = "lowercase")]
@@ -55,7 +74,36 @@ pub struct ToolCall {
     pub duration_ms: Option<i64>,
 }
 
+/// Position of a tool call in the timeline, which is ordered by
+/// `(started_at, id)`
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct TimelineCursor {
+    pub started_at: i64,
+    pub id: i64,
+}
+
+impl From<&ToolCall> for TimelineCursor {
+    fn from(call: &ToolCall) -> Self {
+        Self {
+            started_at: call.started_at,
+            id: call.id,
+        }
+    }
+}
+
+/// Restricts timeline queries to matching tool calls
+#[derive(Debug, Clone, Default)]
+pub struct TimelineFilter {
+    /// Only calls of this tool
+    pub name: Option<String>,
+    /// Only calls with this status
+    pub status: Option<ToolCallStatus>,
+}
+
 /// Statistics for a specific tool
+///
+/// The percentiles are estimated from the duration histogram: each is the
+/// mean duration of the bucket it falls in.
 #[derive(Debug, Clone, Serialize, Deserialize)]
 pub struct ToolCallStats {
     pub name: String,
@@ -63,12 +111,488 @@ pub struct ToolCallStats {
     pub successful: i64,
     pub failed: i64,
     pub avg_duration_ms: f64,
+    pub p50_duration_ms: f64,
+    pub p95_duration_ms: f64,
+    pub p99_duration_ms: f64,
+    /// Durations of completed calls, in power-of-two buckets. Empty buckets
+    /// are left out.
+    pub histogram: Vec<DurationBucket>,
+}
+
+/// One bucket of a tool's duration histogram
+#[derive(Debug, Clone, Serialize, Deserialize, PartialEq)]
+pub struct DurationBucket {
+    /// Shortest duration that falls in this bucket, in milliseconds
+    pub min_ms: i64,
+    /// Longest duration that falls in this bucket, in milliseconds
+    pub max_ms: i64,
+    /// Number of calls in this bucket
+    pub count: i64,
+    /// Sum of their durations, in milliseconds
+    pub total_ms: i64,
+}
+
+impl DurationBucket {
+    /// Histogram bucket of a duration: 0 for zero, otherwise `b` for
+    /// `2^(b-1) <= duration_ms < 2^b`
+    fn index(duration_ms: i64) -> i64 {
+        (64 - (duration_ms.max(0) as u64).leading_zeros()) as i64
+    }
+
+    fn new(index: i64, count: i64, total_ms: i64) -> Self {
+        let (min_ms, max_ms) = match index {
+            0 => (0, 0),
+            b => (1i64 << (b - 1), ((1u64 << b) - 1) as i64),
+        };
+        Self {
+            min_ms,
+            max_ms,
+            count,
+            total_ms,
+        }
+    }
+}
+
+/// Estimate the `q` quantile of a histogram as the mean of its bucket
+fn percentile(histogram: &[DurationBucket], q: f64) -> f64 {
+    let total: i64 = histogram.iter().map(|b| b.count).sum();
+    if total == 0 {
+        return 0.0;
+    }
+    let rank = ((q * total as f64).ceil() as i64).max(1);
+    let mut seen = 0;
+    for bucket in histogram {
+        seen += bucket.count;
+        if seen >= rank {
+            return bucket.total_ms as f64 / bucket.count as f64;
+        }
+    }
+    0.0
 }
 
 /// Tool calls tracker backed by SQLite
 #[derive(Clone)]
 pub struct ToolCalls {
     conn: Arc<Connection>,
+    /// Background writer, when created with `from_connection_buffered`
+    audit: Option<Arc<AuditWriter>>,
+}
+
+/// How a tool call ended
+#[derive(Debug, Clone)]
+struct Completion {
+    /// Serialized result; `None` leaves the column as it is
+    result: Option<String>,
+    /// Error message; `None` leaves the column as it is
+    error: Option<String>,
+    status: &'static str,
+    completed_at: i64,
+    duration_ms: i64,
+}
+
+/// A change to the audit log waiting to be written
+enum AuditEvent {
+    /// A new row, still pending if `completion` is `None`
+    Insert {
+        id: i64,
+        name: String,
+        parameters: Option<String>,
+        started_at: i64,
+        completion: Option<Completion>,
+    },
+    /// Completion of a call whose row may already be stored
+    Complete {
+        id: i64,
+        name: String,
+        completion: Completion,
+    },
+}
+
+#[derive(Default)]
+struct AuditQueue {
+    events: Vec<AuditEvent>,
+    /// Calls started through this tracker and not completed yet:
+    /// id -> (name, started_at)
+    pending: HashMap<i64, (String, i64)>,
+    /// Error of the last background flush, reported by the next `flush`
+    error: Option<String>,
+}
+
+impl AuditQueue {
+    /// Put events that failed to be written back ahead of those queued since
+    fn requeue(&mut self, mut events: Vec<AuditEvent>) {
+        events.append(&mut self.events);
+        self.events = events;
+    }
+
+    /// Forget calls completed by `written`, and once too many are pending,
+    /// those whose row is stored
+    fn prune(&mut self, written: &[AuditEvent]) {
+        for event in written {
+            match event {
+                AuditEvent::Insert {
+                    completion: Some(_),
+                    id,
+                    ..
+                }
+                | AuditEvent::Complete { id, .. } => {
+                    self.pending.remove(id);
+                }
+                AuditEvent::Insert { .. } => {}
+            }
+        }
+        if self.pending.len() > AUDIT_PENDING_MAX {
+            let queued: HashSet<i64> = self
+                .events
+                .iter()
+                .filter_map(|event| match event {
+                    AuditEvent::Insert { id, .. } => Some(*id),
+                    AuditEvent::Complete { .. } => None,
+                })
+                .collect();
+            self.pending.retain(|id, _| queued.contains(id));
+        }
+    }
+}
+
+enum AuditCommand {
+    /// Flush once the interval has passed
+    Wake,
+    /// Flush now, reporting the result if asked to
+    Flush(Option<oneshot::Sender<std::result::Result<(), String>>>),
+}
+
+/// Writes tool call events from a queue on a thread of its own.
+///
+/// Events are written in multi-row statements, one transaction per batch,
+/// at most `AUDIT_FLUSH_INTERVAL` after the first one was queued, on a
+/// connection only the thread uses. A batch that fails stays queued and is
+/// retried. Dropping the writer flushes whatever is left before the thread
+/// exits.
+struct AuditWriter {
+    queue: Arc<Mutex<AuditQueue>>,
+    /// Next tool call ID to hand out
+    next_id: AtomicI64,
+    commands: Mutex<Option<mpsc::Sender<AuditCommand>>>,
+    thread: Mutex<Option<JoinHandle<()>>>,
+}
+
+impl AuditWriter {
+    async fn new(conn: Connection) -> Result<Self> {
+        let mut rows = conn
+            .query("SELECT COALESCE(MAX(id), 0) FROM tool_calls", ())
+            .await?;
+        let max_id = match rows.next().await? {
+            Some(row) => row
+                .get_value(0)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0),
+            None => 0,
+        };
+
+        let queue = Arc::new(Mutex::new(AuditQueue::default()));
+        let (tx, rx) = mpsc::channel();
+        let thread = {
+            let queue = queue.clone();
+            std::thread::Builder::new()
+                .name("agentfs-audit".to_string())
+                .spawn(move || Self::run(conn, queue, rx))?
+        };
+        Ok(Self {
+            queue,
+            next_id: AtomicI64::new(max_id + 1),
+            commands: Mutex::new(Some(tx)),
+            thread: Mutex::new(Some(thread)),
+        })
+    }
+
+    fn next_id(&self) -> i64 {
+        self.next_id.fetch_add(1, Ordering::Relaxed)
+    }
+
+    fn send(&self, command: AuditCommand) {
+        if let Some(commands) = self.commands.lock().unwrap().as_ref() {
+            let _ = commands.send(command);
+        }
+    }
+
+    /// Queue an event, waking the writer thread if needed
+    fn push(&self, event: AuditEvent) {
+        let queued = {
+            let mut queue = self.queue.lock().unwrap();
+            match &event {
+                AuditEvent::Insert {
+                    id,
+                    name,
+                    started_at,
+                    completion: None,
+                    ..
+                } => {
+                    queue.pending.insert(*id, (name.clone(), *started_at));
+                }
+                AuditEvent::Insert { .. } | AuditEvent::Complete { .. } => {}
+            }
+            queue.events.push(event);
+            queue.events.len()
+        };
+        if queued == 1 {
+            self.send(AuditCommand::Wake);
+        } else if queued == AUDIT_FLUSH_EVENTS {
+            self.send(AuditCommand::Flush(None));
+        }
+    }
+
+    /// Name and start time of a call started through this tracker
+    fn take_pending(&self, id: i64) -> Option<(String, i64)> {
+        self.queue.lock().unwrap().pending.remove(&id)
+    }
+
+    /// Write everything queued so far
+    async fn flush(&self) -> Result<()> {
+        let (tx, rx) = oneshot::channel();
+        self.send(AuditCommand::Flush(Some(tx)));
+        let result = rx
+            .await
+            .unwrap_or_else(|_| Err("audit writer exited".to_string()));
+        let earlier = self.queue.lock().unwrap().error.take();
+        match (result, earlier) {
+            (Err(e), _) | (Ok(()), Some(e)) => Err(Error::Internal(e)),
+            (Ok(()), None) => Ok(()),
+        }
+    }
+
+    fn run(
+        conn: Connection,
+        queue: Arc<Mutex<AuditQueue>>,
+        commands: mpsc::Receiver<AuditCommand>,
+    ) {
+        let runtime = match tokio::runtime::Builder::new_current_thread()
+            .enable_all()
+            .build()
+        {
+            Ok(runtime) => runtime,
+            Err(e) => {
+                queue.lock().unwrap().error = Some(e.to_string());
+                return;
+            }
+        };
+        let flush = || {
+            let events = std::mem::take(&mut queue.lock().unwrap().events);
+            let result = runtime.block_on(write_batch(&conn, &events));
+            let mut queue = queue.lock().unwrap();
+            match result {
+                Ok(()) => {
+                    queue.prune(&events);
+                    Ok(())
+                }
+                Err(e) => {
+                    queue.requeue(events);
+                    Err(format!("failed to write tool calls: {}", e))
+                }
+            }
+        };
+        // Failed batches are retried after the interval
+        let retry = || Some(Instant::now() + AUDIT_FLUSH_INTERVAL);
+
+        let mut deadline: Option<Instant> = None;
+        loop {
+            let command = match deadline {
+                Some(deadline) => {
+                    commands.recv_timeout(deadline.saturating_duration_since(Instant::now()))
+                }
+                None => commands
+                    .recv()
+                    .map_err(|_| mpsc::RecvTimeoutError::Disconnected),
+            };
+            match command {
+                Ok(AuditCommand::Wake) => {
+                    deadline.get_or_insert_with(|| Instant::now() + AUDIT_FLUSH_INTERVAL);
+                }
+                Ok(AuditCommand::Flush(ack)) => {
+                    let result = flush();
+                    deadline = result.is_err().then(retry).flatten();
+                    match ack {
+                        Some(ack) => {
+                            let _ = ack.send(result);
+                        }
+                        None => {
+                            if let Err(e) = result {
+                                queue.lock().unwrap().error = Some(e);
+                            }
+                        }
+                    }
+                }
+                Err(mpsc::RecvTimeoutError::Timeout) => {
+                    deadline = None;
+                    if let Err(e) = flush() {
+                        queue.lock().unwrap().error = Some(e);
+                        deadline = retry();
+                    }
+                }
+                Err(mpsc::RecvTimeoutError::Disconnected) => {
+                    // The writer was dropped; nobody is left to report to
+                    let _ = flush();
+                    return;
+                }
+            }
+        }
+    }
+}
+
+impl Drop for AuditWriter {
+    fn drop(&mut self) {
+        // Closing the channel makes the thread flush and exit
+        self.commands.lock().unwrap().take();
+        if let Some(thread) = self.thread.lock().unwrap().take() {
+            let _ = thread.join();
+        }
+    }
+}
+
+/// Write queued events in one transaction
+async fn write_batch(conn: &Connection, events: &[AuditEvent]) -> Result<()> {
+    if events.is_empty() {
+        return Ok(());
+    }
+
+    conn.prepare_cached("BEGIN IMMEDIATE")
+        .await?
+        .execute(())
+        .await?;
+    let result = async {
+        write_events(conn, events).await?;
+        conn.prepare_cached("COMMIT").await?.execute(()).await?;
+        Ok(())
+    }
+    .await;
+    if result.is_err() {
+        let _ = conn.prepare_cached("ROLLBACK").await?.execute(()).await;
+    }
+    result
+}
+
+/// Write queued events, merging the completion of a call into its INSERT
+/// when both are in the same batch
+async fn write_events(conn: &Connection, events: &[AuditEvent]) -> Result<()> {
+    let mut inserts: BTreeMap<i64, (&str, Option<&str>, i64, Option<&Completion>)> =
+        BTreeMap::new();
+    let mut updates = Vec::new();
+    for event in events {
+        match event {
+            AuditEvent::Insert {
+                id,
+                name,
+                parameters,
+                started_at,
+                completion,
+            } => {
+                inserts.insert(
+                    *id,
+                    (
+                        name,
+                        parameters.as_deref(),
+                        *started_at,
+                        completion.as_ref(),
+                    ),
+                );
+            }
+            AuditEvent::Complete {
+                id,
+                name,
+                completion,
+            } => match inserts.get_mut(id) {
+                Some(insert) => insert.3 = Some(completion),
+                None => updates.push((*id, name, completion)),
+            },
+        }
+    }
+
+    let mut histogram: HashMap<(String, i64), (i64, i64)> = HashMap::new();
+    let mut count = |name: &str, duration_ms: i64| {
+        let entry = histogram
+            .entry((name.to_string(), DurationBucket::index(duration_ms)))
+            .or_default();
+        entry.0 += 1;
+        entry.1 += duration_ms;
+    };
+
+    let rows: Vec<_> = inserts.into_iter().collect();
+    for batch in rows.chunks(AUDIT_ROWS_PER_INSERT) {
+        let mut params = Vec::with_capacity(batch.len() * 9);
+        for (id, (name, parameters, started_at, completion)) in batch {
+            params.push(Value::Integer(*id));
+            params.push(Value::Text(name.to_string()));
+            params.push(Value::Text(parameters.unwrap_or_default().to_string()));
+            match completion {
+                Some(c) => {
+                    count(name, c.duration_ms);
+                    params.push(c.result.clone().map_or(Value::Null, Value::Text));
+                    params.push(c.error.clone().map_or(Value::Null, Value::Text));
+                    params.push(Value::Text(c.status.to_string()));
+                    params.push(Value::Integer(*started_at));
+                    params.push(Value::Integer(c.completed_at));
+                    params.push(Value::Integer(c.duration_ms));
+                }
+                None => {
+                    params.push(Value::Null);
+                    params.push(Value::Null);
+                    params.push(Value::Text("pending".to_string()));
+                    params.push(Value::Integer(*started_at));
+                    params.push(Value::Null);
+                    params.push(Value::Null);
+                }
+            }
+        }
+        let sql = format!(
+            "INSERT INTO tool_calls (id, name, parameters, result, error, status, started_at, completed_at, duration_ms)
+            VALUES {}",
+            vec!["(?, ?, ?, ?, ?, ?, ?, ?, ?)"; batch.len()].join(", ")
+        );
+        conn.execute(&sql, params).await?;
+    }
+
+    for (id, name, completion) in updates {
+        count(name, completion.duration_ms);
+        let mut stmt = conn
+            .prepare_cached(
+                "UPDATE tool_calls
+                SET result = COALESCE(?, result), error = COALESCE(?, error),
+                    status = ?, completed_at = ?, duration_ms = ?
+                WHERE id = ?",
+            )
+            .await?;
+        stmt.execute((
+            completion.result.clone(),
+            completion.error.clone(),
+            completion.status,
+            completion.completed_at,
+            completion.duration_ms,
+            id,
+        ))
+        .await?;
+    }
+
+    let buckets: Vec<_> = histogram.into_iter().collect();
+    for batch in buckets.chunks(AUDIT_ROWS_PER_INSERT) {
+        let mut params = Vec::with_capacity(batch.len() * 4);
+        for ((name, bucket), (count, total_ms)) in batch {
+            params.push(Value::Text(name.clone()));
+            params.push(Value::Integer(*bucket));
+            params.push(Value::Integer(*count));
+            params.push(Value::Integer(*total_ms));
+        }
+        let sql = format!(
+            "INSERT INTO tool_call_histogram (name, bucket, count, total_ms)
+            VALUES {}
+            ON CONFLICT(name, bucket) DO UPDATE SET
+                count = count + excluded.count,
+                total_ms = total_ms + excluded.total_ms",
+            vec!["(?, ?, ?, ?)"; batch.len()].join(", ")
+        );
+        conn.execute(&sql, params).await?;
+    }
+    Ok(())
 }
 
 impl ToolCalls {
@@ -78,6 +602,7 @@ impl ToolCalls {
         let conn = db.connect()?;
         let tc = Self {
             conn: Arc::new(conn),
+            audit: None,
         };
         tc.initialize().await?;
         Ok(tc)
@@ -85,11 +610,46 @@ impl ToolCalls {
 
     /// Create a tool calls tracker from an existing connection
     pub async fn from_connection(conn: Arc<Connection>) -> Result<Self> {
-        let tc = Self { conn };
+        let tc = Self { conn, audit: None };
+        tc.initialize().await?;
+        Ok(tc)
+    }
+
+    /// Create a tool calls tracker that writes in the background
+    ///
+    /// `start`, `success`, `error` and `record` only queue the change; a
+    /// writer thread stores queued changes in batches, at most 50ms after
+    /// they were made. Reads through this tracker flush the queue first, and
+    /// dropping the last clone flushes what is left. Other connections see
+    /// changes once they are flushed (see [`ToolCalls::flush`]).
+    ///
+    /// The writer thread uses `writer`, a connection of its own to the same
+    /// database, so its transactions never interleave with those on `conn`.
+    ///
+    /// IDs are handed out in memory, so the tracker must be the only writer
+    /// of the `tool_calls` table while it is open.
+    pub async fn from_connection_buffered(
+        conn: Arc<Connection>,
+        writer: Connection,
+    ) -> Result<Self> {
+        let mut tc = Self { conn, audit: None };
         tc.initialize().await?;
+        writer.execute("PRAGMA busy_timeout = 5000", ()).await?;
+        tc.audit = Some(Arc::new(AuditWriter::new(writer).await?));
         Ok(tc)
     }
 
+    /// Write all queued changes of a buffered tracker
+    ///
+    /// Also reports a failure of an earlier background write. Does nothing
+    /// for unbuffered trackers.
+    pub async fn flush(&self) -> Result<()> {
+        match &self.audit {
+            Some(audit) => audit.flush().await,
+            None => Ok(()),
+        }
+    }
+
     /// Initialize the database schema
     async fn initialize(&self) -> Result<()> {
         self.conn
@@ -125,15 +685,141 @@ impl ToolCalls {
             )
             .await?;
 
+        let mut rows = self
+            .conn
+            .query(
+                "SELECT name FROM sqlite_schema WHERE type = 'table' AND name = 'tool_call_histogram'",
+                (),
+            )
+            .await?;
+        let has_histogram = rows.next().await?.is_some();
+        drop(rows);
+        if !has_histogram {
+            self.conn
+                .execute(
+                    "CREATE TABLE IF NOT EXISTS tool_call_histogram (
+                        name TEXT NOT NULL,
+                        bucket INTEGER NOT NULL,
+                        count INTEGER NOT NULL,
+                        total_ms INTEGER NOT NULL,
+                        PRIMARY KEY (name, bucket)
+                    )",
+                    (),
+                )
+                .await?;
+            self.backfill_histogram().await?;
+        }
+
+        Ok(())
+    }
+
+    /// Build the duration histogram from the calls recorded before it existed
+    async fn backfill_histogram(&self) -> Result<()> {
+        let mut rows = self
+            .conn
+            .query(
+                "SELECT name, duration_ms FROM tool_calls WHERE duration_ms IS NOT NULL",
+                (),
+            )
+            .await?;
+        let mut histogram: BTreeMap<(String, i64), (i64, i64)> = BTreeMap::new();
+        while let Some(row) = rows.next().await? {
+            let Ok(Value::Text(name)) = row.get_value(0) else {
+                continue;
+            };
+            let duration_ms = row
+                .get_value(1)
+                .ok()
+                .and_then(|v| v.as_integer().copied())
+                .unwrap_or(0);
+            let entry = histogram
+                .entry((name, DurationBucket::index(duration_ms)))
+                .or_default();
+            entry.0 += 1;
+            entry.1 += duration_ms;
+        }
+        drop(rows);
+
+        for ((name, bucket), (count, total_ms)) in histogram {
+            self.conn
+                .execute(
+                    "INSERT INTO tool_call_histogram (name, bucket, count, total_ms)
+                    VALUES (?, ?, ?, ?)",
+                    (name.as_str(), bucket, count, total_ms),
+                )
+                .await?;
+        }
+        Ok(())
+    }
+
+    /// Count a completed call in the duration histogram
+    async fn add_to_histogram(&self, name: &str, duration_ms: i64) -> Result<()> {
+        let mut stmt = self
+            .conn
+            .prepare_cached(
+                "INSERT INTO tool_call_histogram (name, bucket, count, total_ms)
+                VALUES (?, ?, 1, ?)
+                ON CONFLICT(name, bucket) DO UPDATE SET
+                    count = count + 1,
+                    total_ms = total_ms + excluded.total_ms",
+            )
+            .await?;
+        stmt.execute((name, DurationBucket::index(duration_ms), duration_ms))
+            .await?;
         Ok(())
     }
 
+    /// Name and start time of a call that is about to complete
+    async fn started_call(&self, id: i64) -> Result<(String, i64)> {
+        if let Some(audit) = &self.audit {
+            if let Some(started) = audit.take_pending(id) {
+                return Ok(started);
+            }
+            // Started before this tracker existed, or completed twice
+            audit.flush().await?;
+        }
+
+        let mut rows = self
+            .conn
+            .query(
+                "SELECT name, started_at FROM tool_calls WHERE id = ?",
+                (id,),
+            )
+            .await?;
+
+        let Some(row) = rows.next().await? else {
+            return Err(Error::ToolCallNotFound);
+        };
+        let name = match row.get_value(0) {
+            Ok(Value::Text(name)) => name,
+            _ => return Err(Error::Internal("invalid name value".to_string())),
+        };
+        let started_at = row
+            .get_value(1)
+            .ok()
+            .and_then(|v| v.as_integer().copied())
+            .ok_or_else(|| Error::Internal("invalid started_at value".to_string()))?;
+        Ok((name, started_at))
+    }
+
     /// Start a new tool call and mark it as pending
     /// Returns the ID of the created tool call record
     pub async fn start(&self, name: &str, parameters: Option<serde_json::Value>) -> Result<i64> {
         let serialized_params = parameters.map(|p| serde_json::to_string(&p)).transpose()?;
         let started_at = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
 
+        if let Some(audit) = &self.audit {
+            let id = audit.next_id();
+            audit.push(AuditEvent::Insert {
+                id,
+                name: name.to_string(),
+                parameters: serialized_params,
+                started_at,
+                completion: None,
+            });
+            return Ok(id);
+        }
+
         let mut stmt = self
             .conn
             .prepare(
@@ -159,22 +845,24 @@ impl ToolCalls {
         let completed_at = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
 
         // Get the started_at time to calculate duration
-        let mut rows = self
-            .conn
-            .query("SELECT started_at FROM tool_calls WHERE id = ?", (id,))
-            .await?;
-
-        let started_at = if let Some(row) = rows.next().await? {
-            row.get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .ok_or_else(|| Error::Internal("invalid started_at value".to_string()))?
-        } else {
-            return Err(Error::ToolCallNotFound);
-        };
-
+        let (name, started_at) = self.started_call(id).await?;
         let duration_ms = (completed_at - started_at) * 1000;
 
+        if let Some(audit) = &self.audit {
+            audit.push(AuditEvent::Complete {
+                id,
+                name,
+                completion: Completion {
+                    result: Some(serialized_result.unwrap_or_default()),
+                    error: None,
+                    status: "success",
+                    completed_at,
+                    duration_ms,
+                },
+            });
+            return Ok(());
+        }
+
         self.conn
             .execute(
                 "UPDATE tool_calls
@@ -189,7 +877,7 @@ impl ToolCalls {
             )
             .await?;
 
-        Ok(())
+        self.add_to_histogram(&name, duration_ms).await
     }
 
     /// Record a completed tool call (spec-compliant insert-only method)
@@ -209,6 +897,24 @@ impl ToolCalls {
         let duration_ms = (completed_at - started_at) * 1000;
         let status = if error.is_some() { "error" } else { "success" };
 
+        if let Some(audit) = &self.audit {
+            let id = audit.next_id();
+            audit.push(AuditEvent::Insert {
+                id,
+                name: name.to_string(),
+                parameters: serialized_params,
+                started_at,
+                completion: Some(Completion {
+                    result: Some(serialized_result.unwrap_or_default()),
+                    error: Some(error.unwrap_or_default().to_string()),
+                    status,
+                    completed_at,
+                    duration_ms,
+                }),
+            });
+            return Ok(id);
+        }
+
         let mut stmt = self.conn
             .prepare(
                 "INSERT INTO tool_calls (name, parameters, result, error, status, started_at, completed_at, duration_ms)
@@ -233,6 +939,8 @@ impl ToolCalls {
             .ok()
             .and_then(|v| v.as_integer().copied())
             .ok_or_else(|| Error::Internal("failed to get tool call ID".to_string()))?;
+        drop(stmt);
+        self.add_to_histogram(name, duration_ms).await?;
         Ok(id)
     }
 
@@ -241,22 +949,24 @@ impl ToolCalls {
         let completed_at = SystemTime::now().duration_since(UNIX_EPOCH)?.as_secs() as i64;
 
         // Get the started_at time to calculate duration
-        let mut rows = self
-            .conn
-            .query("SELECT started_at FROM tool_calls WHERE id = ?", (id,))
-            .await?;
-
-        let started_at = if let Some(row) = rows.next().await? {
-            row.get_value(0)
-                .ok()
-                .and_then(|v| v.as_integer().copied())
-                .ok_or_else(|| Error::Internal("invalid started_at value".to_string()))?
-        } else {
-            return Err(Error::ToolCallNotFound);
-        };
-
+        let (name, started_at) = self.started_call(id).await?;
         let duration_ms = (completed_at - started_at) * 1000;
 
+        if let Some(audit) = &self.audit {
+            audit.push(AuditEvent::Complete {
+                id,
+                name,
+                completion: Completion {
+                    result: None,
+                    error: Some(error.to_string()),
+                    status: "error",
+                    completed_at,
+                    duration_ms,
+                },
+            });
+            return Ok(());
+        }
+
         self.conn
             .execute(
                 "UPDATE tool_calls
@@ -266,11 +976,12 @@ impl ToolCalls {
             )
             .await?;
 
-        Ok(())
+        self.add_to_histogram(&name, duration_ms).await
     }
 
     /// Get a tool call by ID
     pub async fn get(&self, id: i64) -> Result<Option<ToolCall>> {
+        self.flush().await?;
         let mut rows = self
             .conn
             .query(
@@ -290,6 +1001,7 @@ impl ToolCalls {
     /// Get recent tool calls with optional limit
     pub async fn recent(&self, limit: Option<i64>) -> Result<Vec<ToolCall>> {
         let limit = limit.unwrap_or(100);
+        self.flush().await?;
         let mut rows = self
             .conn
             .query(
@@ -309,8 +1021,101 @@ impl ToolCalls {
         Ok(calls)
     }
 
+    /// Get a page of the timeline, newest first
+    ///
+    /// Returns up to `limit` matching calls that come before `before` in
+    /// `(started_at, id)` order, or the newest ones if `before` is `None`.
+    /// Pass the last call of a page as the cursor of the next one; each page
+    /// is a range scan of `idx_tool_calls_started_at`, however deep it is.
+    pub async fn page_before(
+        &self,
+        filter: &TimelineFilter,
+        before: Option<TimelineCursor>,
+        limit: i64,
+    ) -> Result<Vec<ToolCall>> {
+        self.flush().await?;
+        let before = before.unwrap_or(TimelineCursor {
+            started_at: i64::MAX,
+            id: i64::MAX,
+        });
+        let name = filter.name.as_deref();
+        let status = filter.status.as_ref().map(|s| s.to_string());
+        let mut stmt = self
+            .conn
+            .prepare_cached(
+                "SELECT id, name, parameters, result, error, status, started_at, completed_at, duration_ms
+                FROM tool_calls
+                WHERE started_at <= ? AND (started_at < ? OR id < ?)
+                    AND (? IS NULL OR name = ?) AND (? IS NULL OR status = ?)
+                ORDER BY started_at DESC, id DESC
+                LIMIT ?",
+            )
+            .await?;
+        let mut rows = stmt
+            .query((
+                before.started_at,
+                before.started_at,
+                before.id,
+                name,
+                name,
+                status.as_deref(),
+                status.as_deref(),
+                limit,
+            ))
+            .await?;
+
+        let mut calls = Vec::new();
+        while let Some(row) = rows.next().await? {
+            calls.push(self.row_to_tool_call(&row)?);
+        }
+        Ok(calls)
+    }
+
+    /// Get up to `limit` matching calls inserted after the call `after_id`,
+    /// in insertion order
+    ///
+    /// IDs only grow, so polling with the last ID seen tails new calls with a
+    /// primary key range scan.
+    pub async fn inserted_after(
+        &self,
+        filter: &TimelineFilter,
+        after_id: i64,
+        limit: i64,
+    ) -> Result<Vec<ToolCall>> {
+        self.flush().await?;
+        let name = filter.name.as_deref();
+        let status = filter.status.as_ref().map(|s| s.to_string());
+        let mut stmt = self
+            .conn
+            .prepare_cached(
+                "SELECT id, name, parameters, result, error, status, started_at, completed_at, duration_ms
+                FROM tool_calls
+                WHERE id > ? AND (? IS NULL OR name = ?) AND (? IS NULL OR status = ?)
+                ORDER BY id
+                LIMIT ?",
+            )
+            .await?;
+        let mut rows = stmt
+            .query((
+                after_id,
+                name,
+                name,
+                status.as_deref(),
+                status.as_deref(),
+                limit,
+            ))
+            .await?;
+
+        let mut calls = Vec::new();
+        while let Some(row) = rows.next().await? {
+            calls.push(self.row_to_tool_call(&row)?);
+        }
+        Ok(calls)
+    }
+
     /// Get statistics for a specific tool
     pub async fn stats_for(&self, name: &str) -> Result<Option<ToolCallStats>> {
+        self.flush().await?;
         let mut rows = self
             .conn
             .query(
@@ -327,15 +1132,18 @@ impl ToolCalls {
             )
             .await?;
 
-        if let Some(row) = rows.next().await? {
-            Ok(Some(self.row_to_stats(&row)?))
-        } else {
-            Ok(None)
-        }
+        let Some(row) = rows.next().await? else {
+            return Ok(None);
+        };
+        let mut stats = self.row_to_stats(&row)?;
+        drop(rows);
+        self.add_percentiles(&mut stats).await?;
+        Ok(Some(stats))
     }
 
     /// Get statistics for all tools
     pub async fn stats(&self) -> Result<Vec<ToolCallStats>> {
+        self.flush().await?;
         let mut rows = self
             .conn
             .query(
@@ -356,10 +1164,46 @@ impl ToolCalls {
         while let Some(row) = rows.next().await? {
             stats.push(self.row_to_stats(&row)?);
         }
+        drop(rows);
 
+        for tool in &mut stats {
+            self.add_percentiles(tool).await?;
+        }
         Ok(stats)
     }
 
+    /// Fill in the histogram and percentiles of a tool from its stored
+    /// histogram, which is kept up to date as calls complete
+    async fn add_percentiles(&self, stats: &mut ToolCallStats) -> Result<()> {
+        let mut stmt = self
+            .conn
+            .prepare_cached(
+                "SELECT bucket, count, total_ms FROM tool_call_histogram
+                WHERE name = ? ORDER BY bucket",
+            )
+            .await?;
+        let mut rows = stmt.query((stats.name.as_str(),)).await?;
+
+        let mut histogram = Vec::new();
+        while let Some(row) = rows.next().await? {
+            let column = |i| {
+                row.get_value(i)
+                    .ok()
+                    .and_then(|v| v.as_integer().copied())
+                    .unwrap_or(0)
+            };
+            if column(1) > 0 {
+                histogram.push(DurationBucket::new(column(0), column(1), column(2)));
+            }
+        }
+
+        stats.p50_duration_ms = percentile(&histogram, 0.50);
+        stats.p95_duration_ms = percentile(&histogram, 0.95);
+        stats.p99_duration_ms = percentile(&histogram, 0.99);
+        stats.histogram = histogram;
+        Ok(())
+    }
+
     fn row_to_tool_call(&self, row: &turso::Row) -> Result<ToolCall> {
         let id = row
             .get_value(0)
@@ -497,6 +1341,104 @@ impl ToolCalls {
             successful,
             failed,
             avg_duration_ms,
+            p50_duration_ms: 0.0,
+            p95_duration_ms: 0.0,
+            p99_duration_ms: 0.0,
+            histogram: Vec::new(),
         })
     }
 }
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_duration_buckets() {
+        assert_eq!(DurationBucket::index(0), 0);
+        assert_eq!(DurationBucket::index(1), 1);
+        assert_eq!(DurationBucket::index(1000), 10);
+        assert_eq!(DurationBucket::index(1023), 10);
+        assert_eq!(DurationBucket::index(1024), 11);
+
+        let bucket = DurationBucket::new(10, 1, 1000);
+        assert_eq!((bucket.min_ms, bucket.max_ms), (512, 1023));
+        assert_eq!(DurationBucket::new(0, 1, 0).max_ms, 0);
+    }
+
+    #[test]
+    fn test_percentiles() {
+        // 90 calls of 0ms, 9 of about 1s and one of 8s
+        let histogram = vec![
+            DurationBucket::new(0, 90, 0),
+            DurationBucket::new(10, 9, 9000),
+            DurationBucket::new(13, 1, 8000),
+        ];
+        assert_eq!(percentile(&histogram, 0.50), 0.0);
+        assert_eq!(percentile(&histogram, 0.95), 1000.0);
+        assert_eq!(percentile(&histogram, 0.99), 1000.0);
+        assert_eq!(percentile(&histogram, 1.0), 8000.0);
+        assert_eq!(percentile(&[], 0.5), 0.0);
+    }
+
+    fn insert(id: i64) -> AuditEvent {
+        AuditEvent::Insert {
+            id,
+            name: "read".to_string(),
+            parameters: None,
+            started_at: 0,
+            completion: None,
+        }
+    }
+
+    fn complete(id: i64) -> AuditEvent {
+        AuditEvent::Complete {
+            id,
+            name: "read".to_string(),
+            completion: Completion {
+                result: None,
+                error: None,
+                status: "success",
+                completed_at: 1,
+                duration_ms: 1,
+            },
+        }
+    }
+
+    fn ids(events: &[AuditEvent]) -> Vec<i64> {
+        events
+            .iter()
+            .map(|event| match event {
+                AuditEvent::Insert { id, .. } | AuditEvent::Complete { id, .. } => *id,
+            })
+            .collect()
+    }
+
+    #[test]
+    fn test_audit_queue_requeue() {
+        let mut queue = AuditQueue::default();
+        queue.events = vec![insert(3)];
+        queue.requeue(vec![insert(1), complete(2)]);
+        assert_eq!(ids(&queue.events), vec![1, 2, 3]);
+    }
+
+    #[test]
+    fn test_audit_queue_prune() {
+        let mut queue = AuditQueue::default();
+        for id in 1..=3 {
+            queue.pending.insert(id, ("read".to_string(), 0));
+        }
+        queue.prune(&[insert(1), complete(2)]);
+        let mut pending: Vec<_> = queue.pending.keys().copied().collect();
+        pending.sort();
+        assert_eq!(pending, vec![1, 3]);
+
+        // Past the cap only calls whose row is still queued are kept
+        for id in 10..10 + AUDIT_PENDING_MAX as i64 {
+            queue.pending.insert(id, ("read".to_string(), 0));
+        }
+        queue.events = vec![insert(10)];
+        queue.prune(&[]);
+        assert_eq!(queue.pending.keys().copied().collect::<Vec<_>>(), vec![10]);
+    }
+}
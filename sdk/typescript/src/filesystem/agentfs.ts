@@ -29,6 +29,12 @@ import {
 
 const DEFAULT_CHUNK_SIZE = 4096;
 
+/**
+ * fs_config keys for storage layouts this SDK cannot read or write; a
+ * filesystem that sets any of them is refused rather than misread
+ */
+const UNSUPPORTED_CONFIG_KEYS = ['dedup', 'compression', 'extent_size'];
+
 /**
  * An open file handle for AgentFS.
  */
@@ -302,6 +308,16 @@ export class AgentFS implements FileSystem {
       chunkSize = parseInt(config.value, 10) || DEFAULT_CHUNK_SIZE;
     }
 
+    const unsupportedStmt = this.db.prepare(
+      `SELECT key, value FROM fs_config WHERE key IN (${UNSUPPORTED_CONFIG_KEYS.map(() => '?').join(', ')})`
+    );
+    const unsupported = await unsupportedStmt.get(...UNSUPPORTED_CONFIG_KEYS) as { key: string; value: string } | undefined;
+    if (unsupported) {
+      throw new Error(
+        `Unsupported filesystem: fs_config sets ${unsupported.key} = '${unsupported.value}', which this SDK does not implement`
+      );
+    }
+
     const stmt = this.db.prepare('SELECT ino FROM fs_inode WHERE ino = ?');
     const root = await stmt.get(this.rootIno);
 
@@ -18,6 +18,7 @@ export class AgentFS extends AgentFSCore {
 
 export { AgentFSOptions } from './agentfs.js';
 export { KvStore } from './kvstore.js';
+export type { KvStoreOptions, KvScanOptions } from './kvstore.js';
 export { AgentFS as Filesystem } from './filesystem/index.js';
 export type { Stats, DirEntry, FilesystemStats, FileHandle, FileSystem } from './filesystem/index.js';
 export { ToolCalls } from './toolcalls.js';
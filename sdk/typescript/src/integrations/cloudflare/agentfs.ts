@@ -24,6 +24,12 @@ import {
 
 const DEFAULT_CHUNK_SIZE = 4096;
 
+/**
+ * fs_config keys for storage layouts this SDK cannot read or write; a
+ * filesystem that sets any of them is refused rather than misread
+ */
+const UNSUPPORTED_CONFIG_KEYS = ['dedup', 'compression', 'extent_size'];
+
 /**
  * Cloudflare Durable Objects SqlStorage cursor interface
  */
@@ -385,6 +391,16 @@ export class AgentFS implements FileSystem {
       chunkSize = parseInt(configRows[0].value, 10) || DEFAULT_CHUNK_SIZE;
     }
 
+    const unsupported = this.storage.sql.exec<{ key: string; value: string }>(
+      `SELECT key, value FROM fs_config WHERE key IN (${UNSUPPORTED_CONFIG_KEYS.map(() => '?').join(', ')})`,
+      ...UNSUPPORTED_CONFIG_KEYS
+    ).toArray();
+    if (unsupported.length > 0) {
+      throw new Error(
+        `Unsupported filesystem: fs_config sets ${unsupported[0].key} = '${unsupported[0].value}', which this SDK does not implement`
+      );
+    }
+
     const rootRows = this.storage.sql.exec<{ ino: number }>(
       'SELECT ino FROM fs_inode WHERE ino = ?',
       this.rootIno
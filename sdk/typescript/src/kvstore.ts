@@ -1,21 +1,82 @@
 import type { DatabasePromise } from '@tursodatabase/database-common';
 
+// Keys per statement in batched operations, well below SQLite's limit on
+// bound parameters
+const KEYS_PER_STATEMENT = 256;
+
+export interface KvStoreOptions {
+  /**
+   * Keep up to this many recently read values in memory. Writes through this
+   * store keep the cache coherent; writes through other connections are not
+   * seen, so only use it when this store is the only writer.
+   */
+  cacheSize?: number;
+}
+
+export interface KvScanOptions {
+  /** Only return keys after this one; pass the last key of a page to get the next */
+  after?: string;
+  /** Maximum number of entries to return (default: 100) */
+  limit?: number;
+}
+
 export class KvStore {
   private db: DatabasePromise;
+  // Serialized values (null for missing keys), least recently used first
+  private cache?: Map<string, string | null>;
+  private cacheSize: number;
+  // Bumped by every write, so a read that overlapped one doesn't fill the
+  // cache with the old value
+  private generation = 0;
 
-  private constructor(db: DatabasePromise) {
+  private constructor(db: DatabasePromise, options: KvStoreOptions = {}) {
     this.db = db;
+    this.cacheSize = options.cacheSize ?? 0;
+    if (this.cacheSize > 0) {
+      this.cache = new Map();
+    }
   }
 
   /**
    * Create a KvStore from an existing database connection
    */
-  static async fromDatabase(db: DatabasePromise): Promise<KvStore> {
-    const kv = new KvStore(db);
+  static async fromDatabase(db: DatabasePromise, options: KvStoreOptions = {}): Promise<KvStore> {
+    const kv = new KvStore(db, options);
     await kv.initialize();
     return kv;
   }
 
+  private cacheGet(key: string): string | null | undefined {
+    if (!this.cache || !this.cache.has(key)) {
+      return undefined;
+    }
+    const value = this.cache.get(key)!;
+    this.cache.delete(key);
+    this.cache.set(key, value);
+    return value;
+  }
+
+  private cacheFill(generation: number, key: string, value: string | null): void {
+    if (!this.cache || generation !== this.generation) {
+      return;
+    }
+    this.cache.delete(key);
+    this.cache.set(key, value);
+    while (this.cache.size > this.cacheSize) {
+      this.cache.delete(this.cache.keys().next().value!);
+    }
+  }
+
+  private invalidate(keys: Iterable<string>): void {
+    if (!this.cache) {
+      return;
+    }
+    this.generation++;
+    for (const key of keys) {
+      this.cache.delete(key);
+    }
+  }
+
   private async initialize(): Promise<void> {
     // Create the key-value store table if it doesn't exist
     await this.db.exec(`
@@ -48,18 +109,92 @@ export class KvStore {
     `);
 
     await stmt.run(key, serializedValue);
+    this.invalidate([key]);
+  }
+
+  /**
+   * Set several key-value pairs in one transaction
+   */
+  async setMany(entries: Record<string, any> | [string, any][]): Promise<void> {
+    const pairs = Array.isArray(entries) ? entries : Object.entries(entries);
+    if (pairs.length === 0) {
+      return;
+    }
+
+    const stmt = this.db.prepare(`
+      INSERT INTO kv_store (key, value, updated_at)
+      VALUES (?, ?, unixepoch())
+      ON CONFLICT(key) DO UPDATE SET
+        value = excluded.value,
+        updated_at = unixepoch()
+    `);
+    await this.db.exec('BEGIN');
+    try {
+      for (const [key, value] of pairs) {
+        await stmt.run(key, JSON.stringify(value));
+      }
+      await this.db.exec('COMMIT');
+    } catch (e) {
+      await this.db.exec('ROLLBACK');
+      throw e;
+    } finally {
+      this.invalidate(pairs.map(([key]) => key));
+    }
   }
 
   async get<T = any>(key: string): Promise<T | undefined> {
-    const stmt = this.db.prepare(`SELECT value FROM kv_store WHERE key = ?`);
-    const row = await stmt.get(key) as { value: string } | undefined;
+    let serialized = this.cacheGet(key);
+    if (serialized === undefined) {
+      const generation = this.generation;
+      const stmt = this.db.prepare(`SELECT value FROM kv_store WHERE key = ?`);
+      const row = await stmt.get(key) as { value: string } | undefined;
+      serialized = row ? row.value : null;
+      this.cacheFill(generation, key, serialized);
+    }
 
-    if (!row) {
+    if (serialized === null) {
       return undefined;
     }
 
     // Deserialize the JSON value
-    return JSON.parse(row.value) as T;
+    return JSON.parse(serialized) as T;
+  }
+
+  /**
+   * Get the values of several keys, in the order of `keys`, with one query
+   * per 256 keys
+   */
+  async getMany<T = any>(keys: string[]): Promise<(T | undefined)[]> {
+    const found = new Map<string, string | null>();
+    const missing: string[] = [];
+    for (const key of keys) {
+      const cached = this.cacheGet(key);
+      if (cached !== undefined) {
+        found.set(key, cached);
+      } else if (!found.has(key)) {
+        found.set(key, null);
+        missing.push(key);
+      }
+    }
+
+    const generation = this.generation;
+    for (let start = 0; start < missing.length; start += KEYS_PER_STATEMENT) {
+      const batch = missing.slice(start, start + KEYS_PER_STATEMENT);
+      const placeholders = batch.map(() => '?').join(', ');
+      const stmt = this.db.prepare(`SELECT key, value FROM kv_store WHERE key IN (${placeholders})`);
+      const rows = await stmt.all(...batch) as { key: string, value: string }[];
+      for (const row of rows) {
+        found.set(row.key, row.value);
+      }
+      for (const key of batch) {
+        this.cacheFill(generation, key, found.get(key)!);
+      }
+    }
+
+    return keys.map(key => {
+      const serialized = found.get(key);
+      return serialized == null ? undefined : JSON.parse(serialized) as T;
+    });
   }
 
   async list(prefix: string): Promise<{ key: string, value: any }[]> {
@@ -69,8 +204,76 @@ export class KvStore {
     return rows.map(r => ({ key: r.key, value: JSON.parse(r.value) }));
   }
 
+  /**
+   * List a page of the keys matching a prefix, in key order
+   *
+   * Each page is a range scan of the primary key, so paging through a large
+   * prefix costs one pass over it.
+   */
+  async scan(prefix: string, options: KvScanOptions = {}): Promise<{ key: string, value: any }[]> {
+    const upper = prefixUpperBound(prefix);
+    const after = options.after ?? null;
+    const stmt = this.db.prepare(`
+      SELECT key, value FROM kv_store
+      WHERE key >= ? AND (? IS NULL OR key < ?) AND (? IS NULL OR key > ?)
+      ORDER BY key
+      LIMIT ?
+    `);
+    const rows = await stmt.all(prefix, upper, upper, after, after, options.limit ?? 100) as { key: string, value: string }[];
+    return rows.map(r => ({ key: r.key, value: JSON.parse(r.value) }));
+  }
+
   async delete(key: string): Promise<void> {
     const stmt = this.db.prepare(`DELETE FROM kv_store WHERE key = ?`);
     await stmt.run(key);
+    this.invalidate([key]);
+  }
+
+  /**
+   * Delete several keys in one transaction
+   */
+  async deleteMany(keys: string[]): Promise<void> {
+    if (keys.length === 0) {
+      return;
+    }
+
+    await this.db.exec('BEGIN');
+    try {
+      for (let start = 0; start < keys.length; start += KEYS_PER_STATEMENT) {
+        const batch = keys.slice(start, start + KEYS_PER_STATEMENT);
+        const placeholders = batch.map(() => '?').join(', ');
+        const stmt = this.db.prepare(`DELETE FROM kv_store WHERE key IN (${placeholders})`);
+        await stmt.run(...batch);
+      }
+      await this.db.exec('COMMIT');
+    } catch (e) {
+      await this.db.exec('ROLLBACK');
+      throw e;
+    } finally {
+      this.invalidate(keys);
+    }
+  }
+}
+
+/**
+ * Smallest string greater than every string starting with `prefix`, or null
+ * if there is none
+ *
+ * SQLite compares text as UTF-8 bytes, which orders like code points, so
+ * bumping the last character that can be bumped gives the bound.
+ */
+function prefixUpperBound(prefix: string): string | null {
+  const chars = Array.from(prefix);
+  while (chars.length > 0) {
+    let code = chars.pop()!.codePointAt(0)! + 1;
+    // Surrogates can't be encoded as UTF-8
+    if (code >= 0xd800 && code <= 0xdfff) {
+      code = 0xe000;
+    }
+    if (code <= 0x10ffff) {
+      chars.push(String.fromCodePoint(code));
+      return chars.join('');
+    }
   }
+  return null;
 }
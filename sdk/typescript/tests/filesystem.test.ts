@@ -893,6 +893,18 @@ describe("Filesystem Integration Tests", () => {
       expect(result).toBeDefined();
       expect(result!.value).toBe("4096");
     });
+
+    it("should refuse filesystems using storage layouts it does not implement", async () => {
+      for (const [key, value] of [
+        ["dedup", "sha256"],
+        ["compression", "zstd"],
+        ["extent_size", "65536"],
+      ]) {
+        await db.prepare("INSERT INTO fs_config (key, value) VALUES (?, ?)").run(key, value);
+        await expect(Filesystem.fromDatabase(db)).rejects.toThrow(key);
+        await db.prepare("DELETE FROM fs_config WHERE key = ?").run(key);
+      }
+    });
   });
 
   // ==================== Schema Tests ====================
@@ -197,6 +197,40 @@ describe("KvStore Integration Tests", () => {
     });
   });
 
+  describe("Batch Operations", () => {
+    it("should set, get and delete several keys at once", async () => {
+      await kvStore.setMany({ "step:1": 1, "step:2": { done: true } });
+      const values = await kvStore.getMany(["step:2", "missing", "step:1"]);
+      expect(values).toEqual([{ done: true }, undefined, 1]);
+
+      await kvStore.deleteMany(["step:1", "missing"]);
+      expect(await kvStore.getMany(["step:1", "step:2"])).toEqual([undefined, { done: true }]);
+    });
+
+    it("should page through keys with a prefix", async () => {
+      await kvStore.setMany([
+        ...Array.from({ length: 5 }, (_, i) => [`g1:k${i}`, i] as [string, number]),
+        ["g2:k0", 0],
+      ]);
+
+      const first = await kvStore.scan("g1:", { limit: 2 });
+      expect(first).toEqual([{ key: "g1:k0", value: 0 }, { key: "g1:k1", value: 1 }]);
+      const rest = await kvStore.scan("g1:", { after: first[1].key, limit: 10 });
+      expect(rest.map(r => r.key)).toEqual(["g1:k2", "g1:k3", "g1:k4"]);
+    });
+
+    it("should keep cached values in step with writes", async () => {
+      const cached = await KvStore.fromDatabase(db, { cacheSize: 16 });
+      expect(await cached.get("key")).toBeUndefined();
+      await cached.set("key", "first");
+      expect(await cached.get("key")).toBe("first");
+      await cached.setMany({ key: "second" });
+      expect(await cached.getMany(["key"])).toEqual(["second"]);
+      await cached.delete("key");
+      expect(await cached.get("key")).toBeUndefined();
+    });
+  });
+
   describe("Persistence", () => {
     it("should persist data across KvStore instances", async () => {
       await kvStore.set("persist-key", "persist-value");